@@ -0,0 +1,26 @@
+
+// The half float accumulation, enabled when UniformBufferObject.HalfAccumulationSamples is not zero (see Vulkan::RayTracing::Application).
+// Its sums have 11 bits of precision, the pixels keep at most that many samples and the new ones are rounded stochastically.
+
+// Rescales the history so that it holds at most maxSamples once the new samples are added, the mean is unchanged.
+void CapAccumulationHistory(inout vec4 history, inout vec2 historyMoments, const float newSamples, const uint maxSamples)
+{
+	if (maxSamples != 0 && history.w + newSamples > maxSamples)
+	{
+		const float scale = max(maxSamples - newSamples, 0) / history.w;
+
+		history *= scale;
+		historyMoments *= scale;
+	}
+}
+
+// Rounds the color sums to one of their two neighbouring half floats, the upper one with a probability u of their distance to the lower one.
+// Unlike rounding to the nearest, the small contributions of the late samples are kept on average rather than lost. The sample count is exact.
+vec4 RoundAccumulationToHalf(const vec4 accumulated, const float u)
+{
+	const vec3 sums = clamp(accumulated.rgb, 0, 65504);
+	const vec3 ulp = exp2(max(floor(log2(max(sums, 1e-30))), -14) - 10);
+	const vec3 lower = floor(sums / ulp) * ulp;
+
+	return vec4(lower + step(vec3(u), (sums - lower) / ulp) * ulp, accumulated.w);
+}
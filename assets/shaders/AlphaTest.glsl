@@ -0,0 +1,31 @@
+
+// The alpha test of the cut out triangles, run by the any-hit shader and the ray query traversal loops on the non opaque geometry only.
+// Expects SceneBuffers.glsl and the Textures and TextureSampler bindings to be declared, as well as Vertex.glsl.
+
+bool IsAlphaTestPassed(const uint customIndex, const uint primitiveIndex, const vec2 attributes)
+{
+	const Instance instance = Instances.Values[customIndex];
+	const int materialIndex = instance.MaterialIndex >= 0 ? instance.MaterialIndex : TriangleMaterialArray(instance.TriangleMaterialAddress).Values[primitiveIndex];
+	const Material material = FetchMaterial(materialIndex);
+
+	if (material.AlphaCutoff <= 0)
+	{
+		return true;
+	}
+
+	float alpha = material.Diffuse.a;
+
+	if (material.DiffuseTextureId >= 0)
+	{
+		const IndexArray indices = IndexArray(instance.IndexAddress);
+		const VertexArray vertices = VertexArray(instance.VertexAddress);
+		const vec2 t0 = UnpackVertex(vertices, FetchIndex(indices, instance.ShortIndices, primitiveIndex * 3 + 0)).TexCoord;
+		const vec2 t1 = UnpackVertex(vertices, FetchIndex(indices, instance.ShortIndices, primitiveIndex * 3 + 1)).TexCoord;
+		const vec2 t2 = UnpackVertex(vertices, FetchIndex(indices, instance.ShortIndices, primitiveIndex * 3 + 2)).TexCoord;
+		const vec2 texCoord = t0 * (1.0 - attributes.x - attributes.y) + t1 * attributes.x + t2 * attributes.y;
+
+		alpha *= textureLod(sampler2D(Textures[nonuniformEXT(material.DiffuseTextureId)], TextureSampler), texCoord, 0).a;
+	}
+
+	return alpha >= material.AlphaCutoff;
+}
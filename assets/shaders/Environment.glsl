@@ -0,0 +1,77 @@
+// The environment map lighting the misses in place of the sky, equirectangular with the up axis along its rows (see Assets::Environment).
+// Expects SceneBuffers.glsl and Light.glsl, a zero EnvironmentWidth meaning there is none.
+
+const float EnvironmentPi = 3.1415926535897932384626433832795;
+
+vec3 EnvironmentTexel(const ivec2 texel)
+{
+	const uvec4 value = Environment.Values[texel.y * EnvironmentWidth + texel.x];
+
+	return vec3(unpackHalf2x16(value.x), unpackHalf2x16(value.y).x);
+}
+
+vec2 EnvironmentUv(const vec3 direction)
+{
+	return vec2(atan(direction.x, -direction.z) / (2 * EnvironmentPi) + 0.5, acos(clamp(direction.y, -1, 1)) / EnvironmentPi);
+}
+
+vec3 EnvironmentDirection(const vec2 uv)
+{
+	const float phi = (uv.x - 0.5) * 2 * EnvironmentPi;
+	const float theta = uv.y * EnvironmentPi;
+
+	return vec3(sin(theta) * sin(phi), cos(theta), -sin(theta) * cos(phi));
+}
+
+// Bilinearly filtered, wrapping around horizontally.
+vec3 EnvironmentRadiance(const vec3 direction)
+{
+	const ivec2 size = ivec2(EnvironmentWidth, EnvironmentHeight);
+	const vec2 position = EnvironmentUv(normalize(direction)) * vec2(size) - 0.5;
+	const ivec2 first = ivec2(floor(position));
+	const vec2 fraction = position - vec2(first);
+
+	const int x0 = (first.x % size.x + size.x) % size.x;
+	const int x1 = (x0 + 1) % size.x;
+	const int y0 = clamp(first.y, 0, size.y - 1);
+	const int y1 = clamp(first.y + 1, 0, size.y - 1);
+
+	return mix(
+		mix(EnvironmentTexel(ivec2(x0, y0)), EnvironmentTexel(ivec2(x1, y0)), fraction.x),
+		mix(EnvironmentTexel(ivec2(x0, y1)), EnvironmentTexel(ivec2(x1, y1)), fraction.x),
+		fraction.y);
+}
+
+// The texels are sampled uniformly in uv, hence the ratio of the sines of their center and of the direction.
+float EnvironmentTexelPdf(const ivec2 texel, const float v)
+{
+	const float sinTheta = sin(v * EnvironmentPi);
+	const float texelSinTheta = sin((texel.y + 0.5) / EnvironmentHeight * EnvironmentPi);
+
+	return sinTheta > 0 ? Luminance(EnvironmentTexel(texel)) * texelSinTheta / sinTheta * EnvironmentPdfScale : 0;
+}
+
+// The solid angle pdf of SampleEnvironment() returning the direction.
+float EnvironmentPdf(const vec3 direction)
+{
+	const ivec2 size = ivec2(EnvironmentWidth, EnvironmentHeight);
+	const vec2 uv = EnvironmentUv(normalize(direction));
+
+	return EnvironmentTexelPdf(min(ivec2(uv * vec2(size)), size - 1), uv.y);
+}
+
+// Picks a texel through the alias table, then a uniform point of it. Expects four uniform random numbers.
+vec3 SampleEnvironment(const vec4 random, out float pdf)
+{
+	const uint count = EnvironmentWidth * EnvironmentHeight;
+	const uint column = min(uint(random.x * count), count - 1);
+	const uvec4 entry = Environment.Values[column];
+	const uint index = random.y < uintBitsToFloat(entry.z) ? column : entry.w;
+
+	const ivec2 texel = ivec2(index % EnvironmentWidth, index / EnvironmentWidth);
+	const vec2 uv = (vec2(texel) + random.zw) / vec2(EnvironmentWidth, EnvironmentHeight);
+
+	pdf = EnvironmentTexelPdf(texel, uv.y);
+
+	return EnvironmentDirection(uv);
+}
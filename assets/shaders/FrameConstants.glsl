@@ -0,0 +1,16 @@
+
+// The per-frame fields of UniformBufferObject, pushed as constants when Enabled is set.
+// SampleTiles is always pushed, the launch then only covers the active tiles of AdaptiveSampling.comp.
+// RowOffset is always pushed too, a frame budget launches a band of rows at a time.
+struct FrameConstants
+{
+	uint TotalNumberOfSamples;
+	uint NumberOfSamples;
+	uint RandomSeed;
+	uint Enabled;
+	uint SampleTiles;
+	uint RowOffset;
+};
+
+// Matches Vulkan::RayTracing::AdaptiveSamplingPipeline::TileSize.
+const uint SampleTileSize = 8;
@@ -2,29 +2,42 @@
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_EXT_nonuniform_qualifier : require
 #extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
 #include "Material.glsl"
+#include "Vertex.glsl"
 
 layout(binding = 1) readonly buffer MaterialArray { Material[] Materials; };
-layout(binding = 2) uniform sampler2D[] TextureSamplers;
+layout(binding = 2) uniform texture2D[] Textures;
+layout(binding = 5) uniform sampler TextureSampler;
 
-layout(location = 0) in vec3 FragColor;
-layout(location = 1) in vec3 FragNormal;
-layout(location = 2) in vec2 FragTexCoord;
-layout(location = 3) in flat int FragMaterialIndex;
+layout(location = 0) in vec3 FragNormal;
+layout(location = 1) in vec2 FragTexCoord;
+layout(location = 2) in flat int FragMaterialIndex;
+layout(location = 3) in flat uvec2 FragTriangleMaterialAddress;
 
 layout(location = 0) out vec4 OutColor;
 
 void main() 
 {
-	const int textureId = Materials[FragMaterialIndex].DiffuseTextureId;
+	// Without an instance override, the material comes from the triangle.
+	const int materialIndex = FragMaterialIndex >= 0 ? FragMaterialIndex : TriangleMaterialArray(FragTriangleMaterialAddress).Values[gl_PrimitiveID];
+	const Material material = Materials[materialIndex];
+	const int textureId = material.DiffuseTextureId;
 	const vec3 lightVector = normalize(vec3(5, 4, 3));
 	const float d = max(dot(lightVector, normalize(FragNormal)), 0.2);
 	
-	vec3 c = FragColor * d;
+	vec4 c = vec4(material.Diffuse.xyz * d, material.Diffuse.a);
 	if (textureId >= 0)
 	{
-		c *= texture(TextureSamplers[textureId], FragTexCoord).rgb;
+		c *= texture(sampler2D(Textures[textureId], TextureSampler), FragTexCoord);
 	}
 
-    OutColor = vec4(c, 1);
-}
\ No newline at end of file
+	// The cut out parts of the alpha tested materials, as in AlphaTest.glsl.
+	if (material.AlphaCutoff > 0 && c.a < material.AlphaCutoff)
+	{
+		discard;
+	}
+
+    OutColor = vec4(c.rgb, 1);
+}
@@ -1,21 +1,21 @@
 #version 460
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_GOOGLE_include_directive : require
-#include "Material.glsl"
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+#include "Instance.glsl"
 #include "UniformBufferObject.glsl"
 
 layout(binding = 0) readonly uniform UniformBufferObjectStruct { UniformBufferObject Camera; };
-layout(binding = 1) readonly buffer MaterialArray { Material[] Materials; };
+layout(binding = 3) readonly buffer InstanceArray { Instance[] Instances; };
+layout(binding = 4) readonly buffer SphereArray { vec4[] Spheres; };
 
-layout(location = 0) in vec3 InPosition;
-layout(location = 1) in vec3 InNormal;
-layout(location = 2) in vec2 InTexCoord;
-layout(location = 3) in int InMaterialIndex;
+#include "Vertex.glsl"
 
-layout(location = 0) out vec3 FragColor;
-layout(location = 1) out vec3 FragNormal;
-layout(location = 2) out vec2 FragTexCoord;
-layout(location = 3) out flat int FragMaterialIndex;
+layout(location = 0) out vec3 FragNormal;
+layout(location = 1) out vec2 FragTexCoord;
+layout(location = 2) out flat int FragMaterialIndex;
+layout(location = 3) out flat uvec2 FragTriangleMaterialAddress;
 
 out gl_PerVertex
 {
@@ -24,11 +24,18 @@ out gl_PerVertex
 
 void main() 
 {
-	Material m = Materials[InMaterialIndex];
+	// The vertices are pulled from the model geometry like in the ray tracing shaders, the indices are relative to the model.
+	const Instance instance = Instances[gl_InstanceIndex];
+	const Vertex v = UnpackVertex(VertexArray(instance.VertexAddress), gl_VertexIndex);
 
-    gl_Position = Camera.Projection * Camera.ModelView * vec4(InPosition, 1.0);
-    FragColor = m.Diffuse.xyz;
-	FragNormal = vec3(Camera.ModelView * vec4(InNormal, 0.0)); // technically not correct, should be ModelInverseTranspose
-	FragTexCoord = InTexCoord;
-	FragMaterialIndex = InMaterialIndex;
+	// The procedural spheres share a unit sphere mesh, scaled and moved here. Their single material is that of their first triangle.
+	const vec4 sphere = Spheres[instance.ModelIndex];
+	const bool isSphere = sphere.w > 0;
+	const vec3 position = isSphere ? sphere.xyz + sphere.w * v.Position : v.Position;
+
+    gl_Position = Camera.Projection * Camera.ModelView * instance.Transform * vec4(position, 1.0);
+	FragNormal = vec3(Camera.ModelView * instance.Transform * vec4(v.Normal, 0.0)); // technically not correct, should be ModelInverseTranspose
+	FragTexCoord = v.TexCoord;
+	FragMaterialIndex = instance.MaterialIndex >= 0 || !isSphere ? instance.MaterialIndex : TriangleMaterialArray(instance.TriangleMaterialAddress).Values[0];
+	FragTriangleMaterialAddress = instance.TriangleMaterialAddress;
 }
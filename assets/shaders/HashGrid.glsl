@@ -0,0 +1,44 @@
+
+// The cells of the world space hash grids of RadianceCache.glsl and PathGuiding.glsl, keyed by their quantized position, their size
+// doubling with the camera distance so that they cover about the same number of pixels, and by the dominant axis of the surface normal.
+// Every grid probes its own table of keys from the hashed slot of a cell.
+
+struct HashGridCell
+{
+	uint Hash; // The hashed slot in a table of any power of two capacity, where the probing starts.
+	uint Key; // A second hash, nonzero.
+	float Size;
+};
+
+uint HashGridHash(const uint value)
+{
+	// PCG, "Hash Functions for GPU Rendering" (Jarzynski and Olano, 2020).
+	const uint state = value * 747796405u + 2891336453u;
+	const uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+
+	return (word >> 22u) ^ word;
+}
+
+uint HashGridHash(const uint seed, const ivec3 cell, const uint levelAndFace)
+{
+	uint hash = HashGridHash(seed + uint(cell.x));
+	hash = HashGridHash(hash + uint(cell.y));
+	hash = HashGridHash(hash + uint(cell.z));
+
+	return HashGridHash(hash + levelAndFace);
+}
+
+// The cell of the point, its size being the power of two closest above the footprint of the given pixels at that distance.
+HashGridCell GetHashGridCell(const vec3 position, const vec3 normal, const float cameraDistance, const float pixelSpreadAngle, const float pixels)
+{
+	const float level = clamp(ceil(log2(max(cameraDistance * pixelSpreadAngle * pixels, 1e-6))), -16.0, 15.0);
+	const float size = exp2(level);
+	const ivec3 cell = ivec3(floor(position / size));
+
+	const vec3 magnitude = abs(normal);
+	const uint axis = magnitude.x > magnitude.y && magnitude.x > magnitude.z ? 0 : magnitude.y > magnitude.z ? 1 : 2;
+	const uint face = axis * 2 + (normal[axis] < 0 ? 1 : 0);
+	const uint levelAndFace = (uint(level + 16) << 3) | face;
+
+	return HashGridCell(HashGridHash(0x9e3779b9u, cell, levelAndFace), HashGridHash(0x85ebca6bu, cell, levelAndFace) | 1, size);
+}
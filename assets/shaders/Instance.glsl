@@ -0,0 +1,34 @@
+
+struct Instance
+{
+	mat4 Transform;
+	uint ModelIndex;
+	int MaterialIndex;
+	uint ShortIndices; // Non zero when the model indices are 16-bit, see FetchIndex() in Vertex.glsl.
+	uint RayMask; // The rays that can hit it, see BounceRayMask().
+
+	// Device addresses of the first vertex, index and triangle material of the model (see Vertex.glsl).
+	uvec2 VertexAddress;
+	uvec2 IndexAddress;
+	uvec2 TriangleMaterialAddress;
+	uint LightOffset; // The first light index of its triangles in SceneBufferTable.LightIndices, ~0 without emissive triangles.
+	uint Reserved2;
+};
+
+// Instance custom index of the single BLAS holding all the procedurals (see Vulkan::RayTracing::Application).
+// Its primitives are the AABBs of every model, hence the primitive index is the model index.
+const uint MergedProceduralsInstance = 0xFFFFFF;
+
+// The instance mask bits tested by the rays (see Assets::ModelInstance::RayMask), the deepest bounces sharing the last one.
+const uint ShadowRayMask = 0x80;
+
+uint BounceRayMask(const uint bounce)
+{
+	return 1u << min(bounce, 6u);
+}
+
+// The rays from the opaque depth of the scene on skip the alpha tests (see SceneFile.hpp), 0 = never.
+bool IsOpaqueBounce(const uint bounce, const uint opaqueDepth)
+{
+	return opaqueDepth != 0 && bounce >= opaqueDepth;
+}
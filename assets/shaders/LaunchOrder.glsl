@@ -0,0 +1,51 @@
+// The order the pixels of a launch are handed to the invocations, set from UserSettings::LaunchOrder when the pipelines are created.
+// Neighbouring invocations then trace neighbouring pixels, whose camera and first bounce rays traverse the same nodes.
+// - LaunchOrderLinear: the rows of the launch, as it comes.
+// - LaunchOrderTiled: 8x8 tiles in row order, the pixels of a tile in row order.
+// - LaunchOrderMorton: 32x32 blocks in row order, the pixels of a block along the Z-order curve.
+// The partial blocks of the right and bottom edges keep the row order within them, the mapping stays one to one over any size.
+const uint LaunchOrderLinear = 0;
+const uint LaunchOrderTiled = 1;
+const uint LaunchOrderMorton = 2;
+layout(constant_id = 9) const uint LaunchOrder = LaunchOrderLinear;
+
+// Compacts the even bits of a Morton code.
+uint MortonCompact(uint x)
+{
+	x &= 0x55555555u;
+	x = (x | (x >> 1)) & 0x33333333u;
+	x = (x | (x >> 2)) & 0x0f0f0f0fu;
+	x = (x | (x >> 4)) & 0x00ff00ffu;
+	x = (x | (x >> 8)) & 0x0000ffffu;
+	return x;
+}
+
+// The pixel of the index-th invocation of a launch covering the given size in pixels.
+uvec2 LaunchPixel(const uint index, const uvec2 size)
+{
+	if (LaunchOrder == LaunchOrderLinear)
+	{
+		return uvec2(index % size.x, index / size.x);
+	}
+
+	const uint blockSize = LaunchOrder == LaunchOrderMorton ? 32 : 8;
+
+	// The rows of blocks, the last one may be shorter.
+	const uint blockRow = index / (blockSize * size.x);
+	const uint blockHeight = min(blockSize, size.y - blockRow * blockSize);
+	const uint inRow = index - blockRow * blockSize * size.x;
+
+	// The blocks of the row, the last one may be narrower.
+	const uint blockColumn = inRow / (blockSize * blockHeight);
+	const uint blockWidth = min(blockSize, size.x - blockColumn * blockSize);
+	const uint inBlock = inRow - blockColumn * blockSize * blockHeight;
+
+	const uvec2 corner = uvec2(blockColumn, blockRow) * blockSize;
+
+	if (LaunchOrder == LaunchOrderMorton && blockWidth == blockSize && blockHeight == blockSize)
+	{
+		return corner + uvec2(MortonCompact(inBlock), MortonCompact(inBlock >> 1));
+	}
+
+	return corner + uvec2(inBlock % blockWidth, inBlock / blockWidth);
+}
@@ -0,0 +1,27 @@
+
+// An emissive triangle in world space, see Assets::Scene. The lights are picked proportionally to their power,
+// so that the area pdf of any point of the light list is Luminance(emission) / UniformBufferObject.LightPower,
+// or else through the light tree (see LightSelection.glsl).
+struct Light
+{
+	vec4 Position; // xyz + w (the branches from the root of the light tree to its leaf, as uint bits)
+	vec4 Edge1;
+	vec4 Edge2;
+	vec4 EmissionAndCdf; // rgb + w (cumulative selection probability, up to this light included)
+};
+
+// A node of the light tree, see Assets::LightTree.
+struct LightNode
+{
+	vec4 BoundsMinAndPower;
+	vec4 BoundsMaxAndCosine; // xyz + w (cosine of the half angle of the normal cone, the normals being up to their sign)
+	vec3 Axis;
+	uint Child; // The second child (the first one follows the node), or LightLeafBit | the light index.
+};
+
+const uint LightLeafBit = 0x80000000u;
+
+float Luminance(const vec3 color)
+{
+	return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
@@ -0,0 +1,179 @@
+
+// The light of the light list picked for a shading point, either proportionally to its power through the cumulative probabilities,
+// or by traversing the light tree (see Assets::LightTree) when UniformBufferObject.LightTree is set. At every node the traversal picks
+// one of the children proportionally to a conservative estimate of the light they send to the point, after "Importance Sampling of
+// Many Lights with Adaptive Tree Splitting" (Conty Estevez and Kulla, 2018) and pbrt-v4. Expects Light.glsl, SceneBuffers.glsl and the
+// Camera uniform buffer.
+
+// The light of the cumulative probability, the binary search of the sorted light list.
+uint PickLight(const float u)
+{
+	uint first = 0;
+	uint last = Camera.LightCount - 1;
+
+	while (first < last)
+	{
+		const uint middle = (first + last) / 2;
+
+		if (Lights.Values[middle].EmissionAndCdf.w > u)
+		{
+			last = middle;
+		}
+		else
+		{
+			first = middle + 1;
+		}
+	}
+
+	return first;
+}
+
+vec3 LightPoint(const Light light, const vec2 barycentrics)
+{
+	return light.Position.xyz + barycentrics.x * light.Edge1.xyz + barycentrics.y * light.Edge2.xyz;
+}
+
+float LightArea(const Light light)
+{
+	return 0.5 * length(cross(light.Edge1.xyz, light.Edge2.xyz));
+}
+
+// cos(max(0, a - b)) and sin(max(0, a - b)) from the cosines and sines of the angles, both in [0, pi].
+float CosSubClamped(const float sinA, const float cosA, const float sinB, const float cosB)
+{
+	return cosA > cosB ? 1.0 : cosA * cosB + sinA * sinB;
+}
+
+float SinSubClamped(const float sinA, const float cosA, const float sinB, const float cosB)
+{
+	return cosA > cosB ? 0.0 : sinA * cosB - cosA * sinB;
+}
+
+// An upper bound of the light the two-sided Lambertian emitters of the node send to the point, up to a common factor.
+// The angles of the normal cone and of the receiving cosine are both narrowed by the angle the bounds subtend from the point.
+float LightNodeImportance(const LightNode node, const vec3 position, const vec3 normal)
+{
+	const vec3 center = (node.BoundsMinAndPower.xyz + node.BoundsMaxAndCosine.xyz) * 0.5;
+	const vec3 toPoint = position - center;
+	const vec3 halfExtent = node.BoundsMaxAndCosine.xyz - center;
+	const float radiusSquared = dot(halfExtent, halfExtent);
+	const float distanceSquared = dot(toPoint, toPoint);
+	const vec3 direction = toPoint * inversesqrt(max(distanceSquared, 1e-20));
+
+	const float cosB = distanceSquared > radiusSquared ? sqrt(1 - radiusSquared / distanceSquared) : -1.0;
+	const float sinB = sqrt(max(1 - cosB * cosB, 0.0));
+
+	// The normals closest to the direction of the point.
+	const float cosW = abs(dot(node.Axis, direction));
+	const float sinW = sqrt(max(1 - cosW * cosW, 0.0));
+	const float cosO = node.BoundsMaxAndCosine.w;
+	const float sinO = sqrt(max(1 - cosO * cosO, 0.0));
+	const float cosX = CosSubClamped(sinW, cosW, sinO, cosO);
+	const float sinX = SinSubClamped(sinW, cosW, sinO, cosO);
+	const float cosEmission = CosSubClamped(sinX, cosX, sinB, cosB);
+
+	// Facing the point's side of the surface. The points of the participating media have no normal, they receive from everywhere.
+	const float cosI = dot(normal, -direction);
+	const float sinI = sqrt(max(1 - cosI * cosI, 0.0));
+	const float cosReception = normal == vec3(0) ? 1.0 : CosSubClamped(sinI, cosI, sinB, cosB);
+
+	if (cosEmission <= 0 || cosReception <= 0)
+	{
+		return 0.0;
+	}
+
+	// Inside the bounds, the distance is clamped to their radius.
+	return node.BoundsMinAndPower.w * cosEmission * cosReception / max(distanceSquared, radiusSquared);
+}
+
+// The probability of the first child of the internal node, negative when neither child reaches the point.
+float LightTreeBranchProbability(const uint node, const vec3 position, const vec3 normal)
+{
+	const float first = LightNodeImportance(LightNodes.Values[node + 1], position, normal);
+	const float second = LightNodeImportance(LightNodes.Values[LightNodes.Values[node].Child], position, normal);
+
+	return first + second > 0 ? first / (first + second) : -1.0;
+}
+
+uint SampleLightTree(const vec3 position, const vec3 normal, float u, out float probability)
+{
+	uint node = 0;
+	probability = 1;
+
+	while ((LightNodes.Values[node].Child & LightLeafBit) == 0)
+	{
+		const float p = LightTreeBranchProbability(node, position, normal);
+
+		if (p < 0)
+		{
+			probability = 0;
+			return 0;
+		}
+
+		// The random number is rescaled to the branch taken, rather than drawing one per level.
+		if (u < p)
+		{
+			node = node + 1;
+			u = min(u / p, 0.99999994);
+			probability *= p;
+		}
+		else
+		{
+			node = LightNodes.Values[node].Child;
+			u = min((u - p) / (1 - p), 0.99999994);
+			probability *= 1 - p;
+		}
+	}
+
+	return LightNodes.Values[node].Child & ~LightLeafBit;
+}
+
+// The probability of SampleLightTree() picking the light, following its branches down from the root.
+float LightTreeProbability(const vec3 position, const vec3 normal, const uint light)
+{
+	const uint branches = floatBitsToUint(Lights.Values[light].Position.w);
+	uint node = 0;
+	float probability = 1;
+
+	for (uint depth = 0; (LightNodes.Values[node].Child & LightLeafBit) == 0; ++depth)
+	{
+		const float p = LightTreeBranchProbability(node, position, normal);
+
+		if (p < 0)
+		{
+			return 0.0;
+		}
+
+		const bool isSecond = ((branches >> depth) & 1) != 0;
+
+		node = isSecond ? LightNodes.Values[node].Child : node + 1;
+		probability *= isSecond ? 1 - p : p;
+	}
+
+	return probability;
+}
+
+// Picks a light for the point, returning its index and the probability it had (zero if none could be picked).
+uint SelectLight(const vec3 position, const vec3 normal, const float u, out float probability)
+{
+	if (Camera.LightTree)
+	{
+		return SampleLightTree(position, normal, u, probability);
+	}
+
+	const uint light = PickLight(u);
+	probability = Luminance(Lights.Values[light].EmissionAndCdf.rgb) * LightArea(Lights.Values[light]) / Camera.LightPower;
+
+	return light;
+}
+
+// The probability of SelectLight() picking the light, for weighting the lights reached by the scattered rays.
+float LightSelectionProbability(const vec3 position, const vec3 normal, const uint light)
+{
+	if (Camera.LightTree)
+	{
+		return LightTreeProbability(position, normal, light);
+	}
+
+	return Luminance(Lights.Values[light].EmissionAndCdf.rgb) * LightArea(Lights.Values[light]) / Camera.LightPower;
+}
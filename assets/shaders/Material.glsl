@@ -12,4 +12,23 @@ struct Material
 	float Fuzziness;
 	float RefractionIndex;
 	uint MaterialModel;
+	float AlphaCutoff;
+	float Density;
 };
+
+// The 16 bytes encoding of --compact-materials, see Assets::CompactMaterial.
+Material UnpackMaterial(const uvec4 packed)
+{
+	const vec2 parameterAndAlphaCutoff = unpackHalf2x16(packed.w);
+
+	Material material;
+	material.Diffuse = vec4(unpackHalf2x16(packed.x), unpackHalf2x16(packed.y));
+	material.DiffuseTextureId = int(packed.z & 0x0fffffffu) - 1;
+	material.Fuzziness = parameterAndAlphaCutoff.x;
+	material.RefractionIndex = parameterAndAlphaCutoff.x;
+	material.Density = parameterAndAlphaCutoff.x;
+	material.MaterialModel = packed.z >> 28;
+	material.AlphaCutoff = parameterAndAlphaCutoff.y;
+
+	return material;
+}
@@ -0,0 +1,230 @@
+
+// Participating media, the instances of the isotropic material (see Assets::Scene::MediumCount()): the box of their model bounds or the
+// sphere inscribed in it, of a constant extinction or one scaled by the nearest voxel of a density grid (see Assets::DensityGrid).
+// The scattered rays sample their free flights by delta tracking and the shadow rays estimate their transmittance by ratio tracking
+// ("Monte Carlo Methods for Volumetric Light Transport Simulation", Novák et al. 2018). Both walk the majorant grid of the blocks of
+// voxels with a 3D DDA, so that the tentative collisions follow the local maximum density: their count scales with the optical depth
+// of the ray rather than with its length times the densest voxel. The media absorb and scatter isotropically, they emit nothing.
+// Expects SceneBuffers.glsl.
+
+const float MediumPhasePdf = 1 / (4 * 3.1415926535897932384626433832795); // The isotropic phase function, in solid angle.
+const float MediumConeSpread = 0.3; // Ray cone spread after a scattering, as wide as the Lambertian one.
+const uint MediumMajorantBlock = 8; // Matches Assets::DensityGrid::MajorantBlock.
+const uint MediumMaxSteps = 256; // Tentative collisions and majorant cells per medium and ray, the path goes through past these.
+
+// The collision a scattered ray sampled, the nearest one of all the media.
+struct MediumCollision
+{
+	float Distance;
+	vec3 Albedo;
+};
+
+// Independent of the sampler, the tracking draws as many numbers as it takes collisions and has its own sequence.
+float MediumRandom(inout uint seed)
+{
+	seed = 1664525 * seed + 1013904223;
+	return float(seed & 0x00FFFFFF) / float(0x01000000);
+}
+
+// The reciprocal, finite along the axes the direction does not move on.
+vec3 MediumSafeInverse(const vec3 v)
+{
+	return vec3(
+		abs(v.x) > 1e-12 ? 1 / v.x : 1e30,
+		abs(v.y) > 1e-12 ? 1 / v.y : 1e30,
+		abs(v.z) > 1e-12 ? 1 / v.z : 1e30);
+}
+
+// The range of the local ray inside the medium, empty when it misses. The local direction is the transformed world one,
+// so that the ray parameters stay world distances.
+vec2 IntersectMedium(const Medium medium, const vec3 origin, const vec3 direction)
+{
+	const vec3 boundsMin = medium.BoundsMinAndShape.xyz;
+	const vec3 boundsMax = medium.BoundsMaxAndDensity.xyz;
+
+	if (medium.BoundsMinAndShape.w != 0)
+	{
+		const vec3 center = (boundsMin + boundsMax) * 0.5;
+		const float radius = (boundsMax.x - boundsMin.x) * 0.5;
+		const vec3 oc = origin - center;
+		const float a = dot(direction, direction);
+		const float b = dot(oc, direction);
+		const float discriminant = b * b - a * (dot(oc, oc) - radius * radius);
+
+		if (discriminant <= 0)
+		{
+			return vec2(1, 0);
+		}
+
+		const float root = sqrt(discriminant);
+
+		return vec2(-b - root, -b + root) / a;
+	}
+
+	const vec3 inverse = MediumSafeInverse(direction);
+	const vec3 t0 = (boundsMin - origin) * inverse;
+	const vec3 t1 = (boundsMax - origin) * inverse;
+	const vec3 near = min(t0, t1);
+	const vec3 far = max(t0, t1);
+
+	return vec2(max(max(near.x, near.y), near.z), min(min(far.x, far.y), far.z));
+}
+
+// The density of the nearest voxel of the grid at the local point.
+float MediumDensity(const Medium medium, const vec3 position)
+{
+	const vec3 boundsMin = medium.BoundsMinAndShape.xyz;
+	const vec3 extent = medium.BoundsMaxAndDensity.xyz - boundsMin;
+	const ivec3 resolution = ivec3(medium.Grid.xyz);
+	const ivec3 voxel = clamp(ivec3((position - boundsMin) / extent * vec3(resolution)), ivec3(0), resolution - 1);
+
+	return MediumVoxels.Values[medium.Grid.w + (voxel.z * resolution.y + voxel.y) * resolution.x + voxel.x];
+}
+
+// Tracks the world ray over [0, tMax] through the medium. Ratio tracking returns the transmittance estimate, delta tracking either
+// zero with the distance of the collision it sampled or one when the ray went through.
+float TrackMedium(const Medium medium, const vec3 origin, const vec3 direction, const float tMax, const bool isRatioTracking, inout uint seed, out float collision)
+{
+	collision = tMax;
+
+	const vec3 localOrigin = (medium.WorldToLocal * vec4(origin, 1)).xyz;
+	const vec3 localDirection = mat3(medium.WorldToLocal) * direction;
+	const vec2 range = IntersectMedium(medium, localOrigin, localDirection);
+	const float tEnd = min(range.y, tMax);
+	const float density = medium.BoundsMaxAndDensity.w;
+	float t = max(range.x, 0.0);
+
+	if (t >= tEnd || density <= 0)
+	{
+		return 1.0;
+	}
+
+	// The homogeneous media have closed forms.
+	if (medium.Grid.x == 0)
+	{
+		if (isRatioTracking)
+		{
+			return exp(-density * (tEnd - t));
+		}
+
+		t -= log(1 - MediumRandom(seed)) / density;
+		collision = t;
+
+		return t < tEnd ? 0.0 : 1.0;
+	}
+
+	// The majorant grid in units of its cells, a block of voxels each.
+	const vec3 boundsMin = medium.BoundsMinAndShape.xyz;
+	const vec3 scale = vec3(medium.Grid.xyz) / (float(MediumMajorantBlock) * (medium.BoundsMaxAndDensity.xyz - boundsMin));
+	const vec3 gridOrigin = (localOrigin - boundsMin) * scale;
+	const vec3 gridDirection = localDirection * scale;
+	const vec3 inverse = MediumSafeInverse(gridDirection);
+	const ivec3 cells = ivec3(medium.MajorantGrid.xyz);
+	const ivec3 cellStep = ivec3(sign(gridDirection));
+	const vec3 delta = abs(inverse);
+
+	ivec3 cell = clamp(ivec3(floor(gridOrigin + t * gridDirection)), ivec3(0), cells - 1);
+	vec3 next = (vec3(cell) + vec3(greaterThan(gridDirection, vec3(0))) - gridOrigin) * inverse;
+	next = mix(next, vec3(1e30), lessThanEqual(abs(gridDirection), vec3(1e-12)));
+
+	float transmittance = 1;
+
+	for (uint steps = 0; t < tEnd && steps < MediumMaxSteps; ++steps)
+	{
+		const float cellEnd = min(min(min(next.x, next.y), next.z), tEnd);
+		const float majorant = density * MediumVoxels.Values[medium.MajorantGrid.w + (cell.z * cells.y + cell.y) * cells.x + cell.x];
+
+		// The exponential flights are memoryless, they start over at every cell boundary with the majorant of the next cell.
+		while (majorant > 0 && steps < MediumMaxSteps)
+		{
+			const float flight = t - log(1 - MediumRandom(seed)) / majorant;
+
+			if (flight >= cellEnd)
+			{
+				break;
+			}
+
+			t = flight;
+			++steps;
+
+			const float ratio = density * MediumDensity(medium, localOrigin + t * localDirection) / majorant;
+
+			if (isRatioTracking)
+			{
+				transmittance *= 1 - ratio;
+
+				if (transmittance <= 0)
+				{
+					return 0.0;
+				}
+			}
+			else if (MediumRandom(seed) < ratio)
+			{
+				collision = t;
+				return 0.0;
+			}
+		}
+
+		t = cellEnd;
+
+		if (next.x <= next.y && next.x <= next.z)
+		{
+			cell.x += cellStep.x;
+			next.x += delta.x;
+		}
+		else if (next.y <= next.z)
+		{
+			cell.y += cellStep.y;
+			next.y += delta.y;
+		}
+		else
+		{
+			cell.z += cellStep.z;
+			next.z += delta.z;
+		}
+
+		if (any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(cell, cells)))
+		{
+			break;
+		}
+	}
+
+	return isRatioTracking ? transmittance : 1.0;
+}
+
+// The nearest collision of the ray with the media before tMax, the direction being normalized. Every medium samples its own flight,
+// the nearest of them is a flight through their sum.
+bool SampleMediumCollision(const vec3 origin, const vec3 direction, const float tMax, inout uint seed, out MediumCollision collision)
+{
+	collision = MediumCollision(tMax, vec3(0));
+
+	bool isCollided = false;
+
+	for (uint i = 0; i != MediumCount; ++i)
+	{
+		const Medium medium = Media.Values[i];
+		float distance;
+
+		if (TrackMedium(medium, origin, direction, collision.Distance, false, seed, distance) == 0)
+		{
+			collision = MediumCollision(distance, medium.Albedo.rgb);
+			isCollided = true;
+		}
+	}
+
+	return isCollided;
+}
+
+// The transmittance of the media along the shadow ray, the direction being normalized.
+float MediumTransmittance(const vec3 origin, const vec3 direction, const float tMax, inout uint seed)
+{
+	float transmittance = 1;
+
+	for (uint i = 0; i != MediumCount && transmittance > 0; ++i)
+	{
+		float distance;
+		transmittance *= TrackMedium(Media.Values[i], origin, direction, tMax, true, seed, distance);
+	}
+
+	return transmittance;
+}
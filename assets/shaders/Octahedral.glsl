@@ -0,0 +1,33 @@
+
+// Octahedral unit vector encoding (Cigolle et al., "A Survey of Efficient Representations for Independent Unit Vectors").
+// Included by both Vertex.glsl and RayPayload.glsl, hence the guard.
+#ifndef OCTAHEDRAL_GLSL
+#define OCTAHEDRAL_GLSL
+
+vec2 OctahedralEncode(const vec3 v)
+{
+	const float l1 = abs(v.x) + abs(v.y) + abs(v.z);
+
+	if (l1 == 0)
+	{
+		return vec2(0);
+	}
+
+	const vec2 p = v.xy / l1;
+
+	return v.z >= 0 ? p : (1.0 - abs(p.yx)) * vec2(p.x >= 0 ? 1.0 : -1.0, p.y >= 0 ? 1.0 : -1.0);
+}
+
+vec3 OctahedralDecode(const vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+
+	if (n.z < 0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0 ? 1.0 : -1.0, n.y >= 0 ? 1.0 : -1.0);
+	}
+
+	return normalize(n);
+}
+
+#endif
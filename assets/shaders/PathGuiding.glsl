@@ -0,0 +1,134 @@
+
+// Online path guiding of the diffuse bounces of the ray tracing pipeline, towards the directions their incident radiance comes from
+// ("Practical Path Guiding for Efficient Light-Transport Simulation", Müller et al. 2017, with the von Mises-Fisher lobes of
+// "On-line Learning of Parametric Mixture Models for Light Transport Simulation", Vorba et al. 2014). The cells of a hash grid
+// (see HashGrid.glsl) learn a single lobe each: every path adds the directions it scattered to from their diffuse vertices to the sums of
+// their cell, weighted by the incident radiance they brought back over their pdf, and PathGuiding.comp blends these into the mean
+// direction of the cell once per frame. The bounces then sample the lobe of their cell or the cosine distribution of the Lambertian BRDF,
+// their one-sample MIS weight being the mixture of both pdfs. Expects HashGrid.glsl and Light.glsl.
+
+struct PathGuidingEntry
+{
+	int Sums[3]; // The weighted directions added this frame in fixed point (see PathGuidingUnit).
+	uint Weight; // The sum of their weights in fixed point.
+	vec3 Mean; // The resolved weighted mean direction, its length the concentration of the lobe.
+	uint SamplesAndAge; // The samples behind Mean (bits 0-15) and the frames since the cell was last trained (bits 16-31).
+	uint SampleCount; // The samples added this frame.
+	uint Reserved[3];
+};
+
+// The lobe a bounce samples, Probability being zero when the cell has not learnt one yet.
+struct PathGuidingLobe
+{
+	vec3 Direction;
+	float Sharpness; // The concentration parameter (kappa) of the von Mises-Fisher distribution.
+	float Probability; // Of sampling the lobe rather than the cosine distribution.
+};
+
+const uint PathGuidingCapacity = 1u << 18; // Matches Vulkan::RayTracing::PathGuidingPipeline::Capacity.
+const uint PathGuidingProbes = 8; // The slots from the hashed one where the key of a cell may be.
+const float PathGuidingUnit = 256; // The fixed point scale of the sums.
+const float PathGuidingMaxWeight = 64; // The sample weights are clamped, the fireflies would swing the lobes and the sums overflow otherwise.
+const uint PathGuidingMaxSamples = 1024; // Past these, the resolved mean is an exponential moving average.
+const uint PathGuidingMinSamples = 64; // Below these, the cell does not guide the bounces yet.
+const uint PathGuidingMaxAge = 64; // The frames without training after which a cell is evicted.
+const uint PathGuidingVertices = 4; // The diffuse vertices of a path that train their cell, the first ones.
+const float PathGuidingPixels = 32; // The approximate width of the cells in pixels, coarser than the radiance cache so that they learn quicker.
+const float PathGuidingProbability = 0.5; // The guided share of the bounces, the cosine distribution keeps the others unbiased where the lobe is wrong.
+const float PathGuidingMaxSharpness = 1000;
+const float PathGuidingPi = 3.1415926535897932384626433832795;
+
+// The buffer shared by the ray tracing pipeline and the resolve pass, the keys first. A zero key is an empty slot.
+layout(binding = 25) buffer PathGuidingArray { uint PathGuidingKeys[PathGuidingCapacity]; PathGuidingEntry PathGuidingEntries[]; };
+
+// The cell of the point (see HashGrid.glsl), about PathGuidingPixels wide.
+HashGridCell GetPathGuidingCell(const vec3 position, const vec3 normal, const float cameraDistance, const float pixelSpreadAngle)
+{
+	return GetHashGridCell(position, normal, cameraDistance, pixelSpreadAngle, PathGuidingPixels);
+}
+
+// The slot of the cell, inserting it when missing, or PathGuidingCapacity when all the probed slots are taken.
+uint InsertPathGuidingCell(const HashGridCell cell)
+{
+	for (uint i = 0; i != PathGuidingProbes; ++i)
+	{
+		const uint slot = (cell.Hash + i) & (PathGuidingCapacity - 1);
+		const uint previous = atomicCompSwap(PathGuidingKeys[slot], 0, cell.Key);
+
+		if (previous == 0 || previous == cell.Key)
+		{
+			return slot;
+		}
+	}
+
+	return PathGuidingCapacity;
+}
+
+// The lobe learnt by the cell of the slot, the concentration estimated from the length of the mean direction (Banerjee et al. 2005).
+PathGuidingLobe LoadPathGuidingLobe(const uint slot)
+{
+	if (slot == PathGuidingCapacity || (PathGuidingEntries[slot].SamplesAndAge & 0xFFFF) < PathGuidingMinSamples)
+	{
+		return PathGuidingLobe(vec3(0, 0, 1), 0, 0);
+	}
+
+	const vec3 mean = PathGuidingEntries[slot].Mean;
+	const float meanLength = min(length(mean), 0.999);
+
+	if (meanLength < 1e-3)
+	{
+		return PathGuidingLobe(vec3(0, 0, 1), 0, 0);
+	}
+
+	const float sharpness = clamp(meanLength * (3 - meanLength * meanLength) / (1 - meanLength * meanLength), 1e-2, PathGuidingMaxSharpness);
+
+	return PathGuidingLobe(normalize(mean), sharpness, PathGuidingProbability);
+}
+
+// The von Mises-Fisher pdf in solid angle, written to stay finite for the sharp lobes.
+float PathGuidingLobePdf(const PathGuidingLobe lobe, const vec3 direction)
+{
+	const float k = lobe.Sharpness;
+
+	return k / (2 * PathGuidingPi * (1 - exp(-2 * k))) * exp(k * (dot(lobe.Direction, direction) - 1));
+}
+
+// Samples the lobe through the inverse of its cosine distribution ("Numerically stable sampling of the von Mises Fisher distribution on
+// S2", Jakob 2012), around the orthonormal basis of "Building an Orthonormal Basis, Revisited" (Duff et al. 2017).
+vec3 SamplePathGuidingLobe(const PathGuidingLobe lobe, const vec2 u)
+{
+	const float k = lobe.Sharpness;
+	const float w = clamp(1 + log(u.x + (1 - u.x) * exp(-2 * k)) / k, -1.0, 1.0);
+	const float phi = 2 * PathGuidingPi * u.y;
+	const float r = sqrt(max(1 - w * w, 0.0));
+
+	const vec3 n = lobe.Direction;
+	const float sign = n.z >= 0 ? 1.0 : -1.0;
+	const float a = -1 / (sign + n.z);
+	const float b = n.x * n.y * a;
+	const vec3 tangent = vec3(1 + sign * n.x * n.x * a, sign * b, -sign * n.x);
+	const vec3 bitangent = vec3(b, sign + n.y * n.y * a, -n.y);
+
+	return normalize(r * cos(phi) * tangent + r * sin(phi) * bitangent + w * n);
+}
+
+// The pdf of the guided bounce in solid angle, the mixture of the lobe and the cosine distribution around the normal.
+float PathGuidingPdf(const PathGuidingLobe lobe, const vec3 normal, const vec3 direction)
+{
+	const float cosinePdf = max(dot(normal, direction), 0) / PathGuidingPi;
+
+	return lobe.Probability != 0 ? mix(cosinePdf, PathGuidingLobePdf(lobe, direction), lobe.Probability) : cosinePdf;
+}
+
+// The radiance is that of a single direction, brought back by a path whose bounce had the given pdf.
+void AddPathGuidingSample(const uint slot, const vec3 direction, const vec3 radiance, const float pdf)
+{
+	const float weight = min(Luminance(radiance) / max(pdf, 1e-6), PathGuidingMaxWeight);
+	const ivec3 sums = ivec3(round(direction * weight * PathGuidingUnit));
+
+	atomicAdd(PathGuidingEntries[slot].Sums[0], sums.x);
+	atomicAdd(PathGuidingEntries[slot].Sums[1], sums.y);
+	atomicAdd(PathGuidingEntries[slot].Sums[2], sums.z);
+	atomicAdd(PathGuidingEntries[slot].Weight, uint(weight * PathGuidingUnit + 0.5));
+	atomicAdd(PathGuidingEntries[slot].SampleCount, 1);
+}
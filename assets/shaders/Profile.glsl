@@ -0,0 +1,31 @@
+
+// The GPU clocks of the ray tracing stages, summed per bounce with --profile-stages or the heatmap (see Vulkan::RayTracing::Application::ReadStageClocks()).
+// Every sum is a 64-bit counter split into two words, the high one taking the carries of the low one.
+// Expects GL_ARB_gpu_shader_int64 and GL_ARB_shader_clock.
+const uint ProfileStageRayGeneration = 0; // The ray generation shader itself, without the rays it traces.
+const uint ProfileStageTrace = 1; // The bounce rays: traversal, intersection, any hit and closest hit shaders.
+const uint ProfileStageLightSampling = 2; // The light sampling and its shadow rays.
+const uint ProfileStageClosestHit = 3; // Within the closest hit shaders, texture fetches included. All bounces go in the first bucket.
+const uint ProfileStageIntersection = 4; // Within the procedural intersection shader, shadow rays included. Same.
+const uint ProfileStageCount = 5;
+const uint ProfileBounceCount = 8; // The last bucket also takes the deeper bounces.
+
+layout(constant_id = 6) const bool ProfileStages = false;
+
+layout(binding = 21) buffer StageClockArray { uint StageClocks[]; };
+
+uint64_t ProfileClock()
+{
+	return ProfileStages ? clockARB() : 0;
+}
+
+void AddStageClocks(const uint stage, const uint bounce, const uint clocks)
+{
+	const uint index = (stage * ProfileBounceCount + min(bounce, ProfileBounceCount - 1)) * 2;
+	const uint previous = atomicAdd(StageClocks[index + 0], clocks);
+
+	if (previous + clocks < previous)
+	{
+		atomicAdd(StageClocks[index + 1], 1);
+	}
+}
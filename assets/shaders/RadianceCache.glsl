@@ -0,0 +1,81 @@
+
+// A world space cache of the radiance scattered by the diffuse surfaces, into which the paths of the ray tracing pipeline end past their
+// first diffuse bounce (after NVIDIA's spatially hashed radiance cache, SHaRC), in the cells of a hash grid (see HashGrid.glsl).
+// A sparse set of training paths add the radiance they gather past every diffuse vertex to the sums of its cell, which RadianceCache.comp
+// blends into the resolved radiance once per frame. The cached radiance includes the albedo of the surfaces. Expects HashGrid.glsl.
+
+struct RadianceCacheEntry
+{
+	uint Sums[3]; // The radiance added this frame in fixed point (see RadianceCacheUnit).
+	uint SampleCount; // The samples added this frame.
+	vec3 Radiance; // The resolved mean.
+	uint SamplesAndAge; // The samples behind Radiance (bits 0-15) and the frames since the cell was last trained (bits 16-31).
+};
+
+const uint RadianceCacheCapacity = 1u << 20; // Matches Vulkan::RayTracing::RadianceCachePipeline::Capacity.
+const uint RadianceCacheProbes = 8; // The slots from the hashed one where the key of a cell may be.
+const float RadianceCacheUnit = 256; // The fixed point scale of the sums.
+const float RadianceCacheMaxRadiance = 64; // The samples are clamped, the fireflies would linger and the sums of a busy cell overflow otherwise.
+const uint RadianceCacheMaxSamples = 256; // Past these, the resolved radiance is an exponential moving average.
+const uint RadianceCacheMinSamples = 16; // Below these, the cell is not queried yet.
+const uint RadianceCacheMaxAge = 64; // The frames without training after which a cell is evicted.
+const uint RadianceCacheTrainingRatio = 16; // One sample in this many traces a training path.
+const uint RadianceCacheVertices = 8; // The diffuse vertices of a training path that train their cell, the first ones.
+const float RadianceCachePixels = 8; // The approximate width of the cells in pixels.
+
+// The buffer shared by the ray tracing pipeline and the resolve pass, the keys first. A zero key is an empty slot.
+layout(binding = 24) buffer RadianceCacheArray { uint RadianceCacheKeys[RadianceCacheCapacity]; RadianceCacheEntry RadianceCacheEntries[]; };
+
+// The cell of the point (see HashGrid.glsl), about RadianceCachePixels wide.
+HashGridCell GetRadianceCacheCell(const vec3 position, const vec3 normal, const float cameraDistance, const float pixelSpreadAngle)
+{
+	return GetHashGridCell(position, normal, cameraDistance, pixelSpreadAngle, RadianceCachePixels);
+}
+
+// The slot of the cell, inserting it when missing, or RadianceCacheCapacity when all the probed slots are taken.
+// An evicted slot ahead of the cell's one can take it a second time, the stale copy is evicted in turn.
+uint InsertRadianceCacheCell(const HashGridCell cell)
+{
+	for (uint i = 0; i != RadianceCacheProbes; ++i)
+	{
+		const uint slot = (cell.Hash + i) & (RadianceCacheCapacity - 1);
+		const uint previous = atomicCompSwap(RadianceCacheKeys[slot], 0, cell.Key);
+
+		if (previous == 0 || previous == cell.Key)
+		{
+			return slot;
+		}
+	}
+
+	return RadianceCacheCapacity;
+}
+
+// The resolved radiance of the cell, false when it has not been trained enough or is missing.
+bool FindRadianceCacheCell(const HashGridCell cell, out vec3 radiance)
+{
+	for (uint i = 0; i != RadianceCacheProbes; ++i)
+	{
+		const uint slot = (cell.Hash + i) & (RadianceCacheCapacity - 1);
+
+		if (RadianceCacheKeys[slot] == cell.Key)
+		{
+			radiance = RadianceCacheEntries[slot].Radiance;
+
+			return (RadianceCacheEntries[slot].SamplesAndAge & 0xFFFF) >= RadianceCacheMinSamples;
+		}
+	}
+
+	radiance = vec3(0);
+
+	return false;
+}
+
+void AddRadianceCacheSample(const uint slot, const vec3 radiance)
+{
+	const uvec3 sums = uvec3(clamp(radiance, vec3(0), vec3(RadianceCacheMaxRadiance)) * RadianceCacheUnit + 0.5);
+
+	atomicAdd(RadianceCacheEntries[slot].Sums[0], sums.x);
+	atomicAdd(RadianceCacheEntries[slot].Sums[1], sums.y);
+	atomicAdd(RadianceCacheEntries[slot].Sums[2], sums.z);
+	atomicAdd(RadianceCacheEntries[slot].SampleCount, 1);
+}
@@ -1,5 +1,13 @@
 #extension GL_EXT_control_flow_attributes : require
 
+// Set from UserSettings::Sampler, the random sequence is selected when the pipeline is created.
+// - SamplerRandom: a TEA-seeded LCG, the seed is the generator state.
+// - SamplerSobol: Owen-scrambled Sobol (0,2)-sequences padded per pair of dimensions (Burley, "Practical Hash-based Owen Scrambling").
+//   The seed packs the shuffled sample index (bits 0-15), the next dimension (bits 16-23) and a few pixel bits (24-31), see InitSamplerSeed().
+const uint SamplerRandom = 0;
+const uint SamplerSobol = 1;
+layout(constant_id = 1) const uint Sampler = SamplerRandom;
+
 // Generates a seed for a random number generator from 2 inputs plus a backoff
 // https://github.com/nvpro-samples/optix_prime_baking/blob/332a886f1ac46c0b3eea9e89a59593470c755a0e/random.h
 // https://github.com/nvpro-samples/vk_raytracing_tutorial_KHR/tree/master/ray_tracing_jitter_cam
@@ -25,8 +33,84 @@ uint RandomInt(inout uint seed)
     return (seed = 1664525 * seed + 1013904223);
 }
 
+// Laine-Karras style permutation, only the lower bits affect the higher ones.
+uint LaineKarrasPermutation(uint x, const uint seed)
+{
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return x;
+}
+
+// Nested uniform (Owen) scramble in base 2, each bit is flipped depending on the higher ones.
+uint NestedUniformScramble(const uint x, const uint seed)
+{
+	return bitfieldReverse(LaineKarrasPermutation(bitfieldReverse(x), seed));
+}
+
+// The same on 16-bit values, the sample indices.
+uint NestedUniformScramble16(const uint x, const uint seed)
+{
+	return NestedUniformScramble(x << 16, seed) >> 16;
+}
+
+uint HashCombine(const uint seed, const uint value)
+{
+	return seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+// The second dimension of the Sobol sequence, the first one being the bit reversed index.
+uint SobolSecondDimension(uint index)
+{
+	uint result = 0;
+
+	for (uint v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1)
+	{
+		if ((index & 1) != 0)
+		{
+			result ^= v;
+		}
+	}
+
+	return result;
+}
+
+// The seed of the sample of a pixel, every pixel gets its own shuffle of the sequence.
+uint InitSamplerSeed(const uint pixelHash, const uint sampleIndex)
+{
+	if (Sampler == SamplerSobol)
+	{
+		return NestedUniformScramble16(sampleIndex & 0xffff, pixelHash) | (pixelHash & 0xff000000);
+	}
+
+	return InitRandomSeed(pixelHash, sampleIndex);
+}
+
+float SobolFloat(inout uint seed)
+{
+	const uint index = seed & 0xffff;
+	const uint dimension = (seed >> 16) & 0xff;
+	const uint pixelBits = seed >> 24;
+
+	seed = (seed & 0xff00ffff) | (((dimension + 1) & 0xff) << 16);
+
+	// Every pair of dimensions is a (0,2)-sequence, decorrelated from the other pairs by its index shuffle.
+	const uint pairIndex = NestedUniformScramble16(index, HashCombine(pixelBits, dimension >> 1));
+	const uint value = (dimension & 1) == 0 ? bitfieldReverse(pairIndex) : SobolSecondDimension(pairIndex);
+	const uint scrambled = NestedUniformScramble(value, HashCombine(HashCombine(pixelBits, dimension), 0x68bc21ebu));
+
+	return float(scrambled >> 8) / float(0x01000000);
+}
+
 float RandomFloat(inout uint seed)
 {
+	if (Sampler == SamplerSobol)
+	{
+		return SobolFloat(seed);
+	}
+
 	//// Float version using bitmask from Numerical Recipes
 	//const uint one = 0x3f800000;
 	//const uint msk = 0x007fffff;
@@ -36,26 +120,30 @@ float RandomFloat(inout uint seed)
 	return (float(RandomInt(seed) & 0x00FFFFFF) / float(0x01000000));
 }
 
+// Concentric mapping of the square (Shirley and Chiu), branch free and consuming exactly two dimensions.
 vec2 RandomInUnitDisk(inout uint seed)
 {
-	for (;;)
-	{
-		const vec2 p = 2 * vec2(RandomFloat(seed), RandomFloat(seed)) - 1;
-		if (dot(p, p) < 1)
-		{
-			return p;
-		}
-	}
+	const float quarterPi = 0.78539816339744830961566084581988;
+	const vec2 p = 2 * vec2(RandomFloat(seed), RandomFloat(seed)) - 1;
+	const bool isHorizontal = abs(p.x) > abs(p.y);
+	const float r = isHorizontal ? p.x : p.y;
+	const float phi = isHorizontal ? quarterPi * p.y / p.x : 2 * quarterPi - quarterPi * p.x / (p.y != 0 ? p.y : 1);
+
+	return r * vec2(cos(phi), sin(phi));
+}
+
+vec3 RandomUnitVector(inout uint seed)
+{
+	const float z = 2 * RandomFloat(seed) - 1;
+	const float phi = 2 * 3.1415926535897932384626433832795 * RandomFloat(seed);
+	const float r = sqrt(max(1 - z * z, 0));
+
+	return vec3(r * cos(phi), r * sin(phi), z);
 }
 
+// A direction scaled by the cube root of a uniform radius, branch free and consuming exactly three dimensions.
 vec3 RandomInUnitSphere(inout uint seed)
 {
-	for (;;)
-	{
-		const vec3 p = 2 * vec3(RandomFloat(seed), RandomFloat(seed), RandomFloat(seed)) - 1;
-		if (dot(p, p) < 1)
-		{
-			return p;
-		}
-	}
+	const vec3 direction = RandomUnitVector(seed);
+	return direction * pow(RandomFloat(seed), 1.0 / 3.0);
 }
@@ -0,0 +1,64 @@
+
+// The ray counts of a frame (see Vulkan::RayTracing::Application::ReadRayCounters()), counted per invocation then summed per subgroup.
+// Every count is a 64-bit counter split into two words, the high one taking the carries of the low one.
+// Expects GL_KHR_shader_subgroup_arithmetic.
+const uint RayCounterTraceCalls = 0; // Every traceRayEXT() call, the shadow rays included.
+const uint RayCounterShadowRays = 1;
+const uint RayCounterMisses = 2; // The bounce rays leaving the scene.
+const uint RayCounterAbsorptions = 3; // The paths ending on a surface that does not scatter, the lights included.
+const uint RayCounterRoulette = 4; // The paths ended by Russian roulette.
+const uint RayCounterBounceLimit = 5; // The paths still scattering after the last bounce.
+const uint RayCounterRadianceCache = 6; // The paths ended in the radiance cache (see RadianceCache.glsl).
+const uint RayCounterMediumCollisions = 7; // The scatterings inside the participating media (see Medium.glsl).
+const uint RayCounterBounceRays = 8; // The bounce rays per depth, the camera rays first. The last one also takes the deeper bounces.
+const uint RayCounterBounceCount = 8;
+const uint RayCounterCount = RayCounterBounceRays + RayCounterBounceCount;
+
+// Whether the ray generation stage supports the subgroup arithmetic, each invocation adds its own counts otherwise.
+layout(constant_id = 7) const bool SubgroupRayCounters = true;
+
+layout(binding = 22) buffer RayCounterArray { uint RayCounters[]; };
+
+uint PixelRayCounts[RayCounterCount];
+
+void CountRay(const uint counter)
+{
+	PixelRayCounts[counter]++;
+}
+
+void CountBounceRay(const uint bounce)
+{
+	PixelRayCounts[RayCounterTraceCalls]++;
+	PixelRayCounts[RayCounterBounceRays + min(bounce, RayCounterBounceCount - 1)]++;
+}
+
+void AddRayCount(const uint counter, const uint count)
+{
+	const uint previous = atomicAdd(RayCounters[counter * 2 + 0], count);
+
+	if (previous + count < previous)
+	{
+		atomicAdd(RayCounters[counter * 2 + 1], 1);
+	}
+}
+
+// Once per invocation, with a single atomic per subgroup and counter.
+void AddPixelRayCounts()
+{
+	for (uint i = 0; i != RayCounterCount; ++i)
+	{
+		if (SubgroupRayCounters)
+		{
+			const uint count = subgroupAdd(PixelRayCounts[i]);
+
+			if (subgroupElect() && count != 0)
+			{
+				AddRayCount(i, count);
+			}
+		}
+		else if (PixelRayCounts[i] != 0)
+		{
+			AddRayCount(i, PixelRayCounts[i]);
+		}
+	}
+}
@@ -0,0 +1,34 @@
+// The origin of a ray leaving a surface, offset past the rounding errors of the hit position so that the ray can start at tMin = 0.
+// From "A Fast and Robust Method for Avoiding Self-Intersection" (Wächter and Binder, Ray Tracing Gems, 2019): the offset is a number
+// of float ulps along the normal, which scales with the magnitude of the position, with a fixed one close to the origin instead.
+// The normal is flipped to the side the ray leaves to. Without one (e.g. the isotropic volumes), the origin moves along the ray by
+// a fraction of the scene radius.
+vec3 OffsetRayOrigin(const vec3 position, const vec3 normal, const vec3 direction, const float sceneRadius)
+{
+	if (normal == vec3(0))
+	{
+		return position + normalize(direction) * (sceneRadius * 1e-6);
+	}
+
+	const float originThreshold = 1.0 / 32.0;
+	const float floatScale = 1.0 / 65536.0;
+	const float intScale = 256.0;
+
+	const vec3 n = dot(normal, direction) < 0 ? -normal : normal;
+	const ivec3 offset = ivec3(intScale * n);
+	const vec3 offsetPosition = intBitsToFloat(floatBitsToInt(position) + ivec3(
+		position.x < 0 ? -offset.x : offset.x,
+		position.y < 0 ? -offset.y : offset.y,
+		position.z < 0 ? -offset.z : offset.z));
+
+	return vec3(
+		abs(position.x) < originThreshold ? position.x + floatScale * n.x : offsetPosition.x,
+		abs(position.y) < originThreshold ? position.y + floatScale * n.y : offsetPosition.y,
+		abs(position.z) < originThreshold ? position.z + floatScale * n.z : offsetPosition.z);
+}
+
+// The farthest a hit can be from a ray origin, the scene bounding sphere (Camera.SceneSphere) enclosing every instance.
+float SceneRayMax(const vec4 sceneSphere, const vec3 origin)
+{
+	return length(origin - sceneSphere.xyz) + sceneSphere.w;
+}
@@ -1,7 +1,103 @@
+// What the ray generation shader can do with a hit surface, stored in RayPayload.Normal.w.
+const float SurfaceSpecular = 0; // Nothing, lights can only be reached by scattering (xyz is the shading normal, only used by the denoiser).
+const float SurfaceDiffuse = 1; // Lambertian, the lights get sampled explicitly (xyz is the shading normal).
+const float SurfaceLight = 2; // Emitter of the light list, weighted against the light sampling (xyz is the geometric normal).
+
+// The payload is only accessed through the functions below, PACKED_RAY_PAYLOAD (see assets/CMakeLists.txt) selects the 32 bytes layout.
+#ifdef PACKED_RAY_PAYLOAD
+#include "Octahedral.glsl"
+
+struct RayPayload
+{
+	uvec2 ColorAndFlags; // rgb half floats, the flags in the top 16 bits
+	float Distance;
+	uint ScatterDirection; // Octahedral, normalized.
+	uint Normal; // Octahedral.
+	uint RandomSeed;
+	vec2 Cone; // Ray cone width at the ray origin + spread angle, selects the texture LOD.
+};
+
+const uint PayloadScattered = 1u << 16;
+const uint PayloadZeroNormal = 1u << 17;
+const uint PayloadSurfaceShift = 18;
+
+RayPayload MakeRayPayload(const vec4 colorAndDistance, const vec4 scatterDirection, const vec4 normal, const uint seed, const vec2 cone)
+{
+	const uint flags =
+		(scatterDirection.w > 0 ? PayloadScattered : 0u) |
+		(normal.xyz == vec3(0) ? PayloadZeroNormal : 0u) |
+		(uint(normal.w) << PayloadSurfaceShift);
+
+	return RayPayload(
+		uvec2(packHalf2x16(colorAndDistance.rg), (packHalf2x16(vec2(colorAndDistance.b, 0)) & 0xFFFFu) | flags),
+		colorAndDistance.w,
+		packSnorm2x16(OctahedralEncode(scatterDirection.xyz)),
+		packSnorm2x16(OctahedralEncode(normal.xyz)),
+		seed,
+		cone);
+}
+
+vec4 PayloadColorAndDistance(const RayPayload payload)
+{
+	return vec4(unpackHalf2x16(payload.ColorAndFlags.x), unpackHalf2x16(payload.ColorAndFlags.y & 0xFFFFu).x, payload.Distance);
+}
+
+vec4 PayloadScatterDirection(const RayPayload payload)
+{
+	return vec4(OctahedralDecode(unpackSnorm2x16(payload.ScatterDirection)), (payload.ColorAndFlags.y & PayloadScattered) != 0 ? 1 : 0);
+}
+
+vec4 PayloadNormal(const RayPayload payload)
+{
+	const vec3 normal = (payload.ColorAndFlags.y & PayloadZeroNormal) != 0 ? vec3(0) : OctahedralDecode(unpackSnorm2x16(payload.Normal));
+
+	return vec4(normal, float(payload.ColorAndFlags.y >> PayloadSurfaceShift));
+}
+
+// Keeps the scatter flag, the miss shader does not touch it.
+void SetPayloadColorAndDistance(inout RayPayload payload, const vec4 colorAndDistance)
+{
+	payload.ColorAndFlags = uvec2(
+		packHalf2x16(colorAndDistance.rg),
+		(packHalf2x16(vec2(colorAndDistance.b, 0)) & 0xFFFFu) | (payload.ColorAndFlags.y & 0xFFFF0000u));
+	payload.Distance = colorAndDistance.w;
+}
+
+void SetPayloadNormal(inout RayPayload payload, const vec4 normal)
+{
+	payload.ColorAndFlags.y = (payload.ColorAndFlags.y & (0xFFFFu | PayloadScattered)) |
+		(normal.xyz == vec3(0) ? PayloadZeroNormal : 0u) |
+		(uint(normal.w) << PayloadSurfaceShift);
+	payload.Normal = packSnorm2x16(OctahedralEncode(normal.xyz));
+}
+
+// The light list index of a SurfaceLight hit, in place of the scatter direction it does not have.
+void SetPayloadLightIndex(inout RayPayload payload, const uint light) { payload.ScatterDirection = light; }
+uint PayloadLightIndex(const RayPayload payload) { return payload.ScatterDirection; }
+
+#else
 
 struct RayPayload
 {
 	vec4 ColorAndDistance; // rgb + t
 	vec4 ScatterDirection; // xyz + w (is scatter needed)
+	vec4 Normal; // xyz + w (surface kind), xyz is zero for emissive spheres.
 	uint RandomSeed;
+	vec2 Cone; // Ray cone width at the ray origin + spread angle, selects the texture LOD.
 };
+
+RayPayload MakeRayPayload(const vec4 colorAndDistance, const vec4 scatterDirection, const vec4 normal, const uint seed, const vec2 cone)
+{
+	return RayPayload(colorAndDistance, scatterDirection, normal, seed, cone);
+}
+
+vec4 PayloadColorAndDistance(const RayPayload payload) { return payload.ColorAndDistance; }
+vec4 PayloadScatterDirection(const RayPayload payload) { return payload.ScatterDirection; }
+vec4 PayloadNormal(const RayPayload payload) { return payload.Normal; }
+
+void SetPayloadColorAndDistance(inout RayPayload payload, const vec4 colorAndDistance) { payload.ColorAndDistance = colorAndDistance; }
+void SetPayloadNormal(inout RayPayload payload, const vec4 normal) { payload.Normal = normal; }
+void SetPayloadLightIndex(inout RayPayload payload, const uint light) { payload.ScatterDirection.x = uintBitsToFloat(light); }
+uint PayloadLightIndex(const RayPayload payload) { return floatBitsToUint(payload.ScatterDirection.x); }
+
+#endif
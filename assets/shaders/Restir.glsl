@@ -0,0 +1,149 @@
+
+// Spatiotemporal reservoir resampling of the light list at the first hit of the camera rays (ReSTIR DI, Bitterli et al. 2020).
+// Every pixel resamples a few candidates picked proportionally to their power, then the reservoirs of the previous frame
+// around its reprojection, before tracing a single shadow ray to the sample it ends up with.
+// The targets are the unshadowed contributions, and the reused reservoirs are weighted by their sample counts only, which is biased
+// where their visibility or surfaces differ. Expects LightSelection.glsl, Random.glsl and their own dependencies.
+
+// A sample of the light list and what it stands for, 16 bytes per pixel.
+struct Reservoir
+{
+	uint LightIndex;
+	uint Barycentrics; // Unorm 2x16, the point on the light.
+	float Weight; // The unbiased contribution weight of the sample, zero once found occluded.
+	uint CountAndDistance; // Half 2x16, the candidates it was resampled from and the camera distance of its shading point.
+};
+
+// The reservoirs of two frames, the one written and the one of the previous frame (see UniformBufferObject::RestirFrame).
+layout(binding = 23) buffer ReservoirArray { Reservoir[] Reservoirs; };
+
+const uint RestirCandidates = 8; // Light list samples per pixel and frame.
+const float RestirHistoryCap = 20 * RestirCandidates; // The candidates a reused reservoir stands for at most, so that the lighting changes catch up.
+const uint RestirNeighbours = 2; // Reservoirs of the previous frame reused around the reprojected one.
+const float RestirRadius = 16; // In pixels.
+
+// The resampling state while streaming the candidates in.
+struct RestirState
+{
+	uint LightIndex;
+	vec2 Barycentrics;
+	float TargetPdf;
+	float WeightSum;
+	float Count;
+};
+
+// Independent of the sampler, the light resampling has its own sequence.
+float RestirRandom(inout uint seed)
+{
+	return float(RandomInt(seed) & 0x00FFFFFF) / float(0x01000000);
+}
+
+// The unshadowed contribution of the point of the light in area measure, without the albedo / pi of the Lambertian BRDF.
+float RestirTargetPdf(const vec3 position, const vec3 normal, const Light light, const vec2 barycentrics)
+{
+	const vec3 toLight = LightPoint(light, barycentrics) - position;
+	const float distanceSquared = max(dot(toLight, toLight), 1e-12);
+	const vec3 direction = toLight * inversesqrt(distanceSquared);
+	const float cosine = dot(normal, direction);
+	const float lightCosine = abs(dot(normalize(cross(light.Edge1.xyz, light.Edge2.xyz)), direction));
+
+	return cosine > 0 ? Luminance(light.EmissionAndCdf.rgb) * cosine * lightCosine / distanceSquared : 0.0;
+}
+
+void StreamSample(inout RestirState state, const uint lightIndex, const vec2 barycentrics, const float targetPdf, const float weight, const float count, inout uint seed)
+{
+	state.WeightSum += weight;
+	state.Count += count;
+
+	if (weight > 0 && RestirRandom(seed) * state.WeightSum < weight)
+	{
+		state.LightIndex = lightIndex;
+		state.Barycentrics = barycentrics;
+		state.TargetPdf = targetPdf;
+	}
+}
+
+// New candidates from the light list, its area pdf being Luminance(emission) / LightPower.
+void StreamCandidates(inout RestirState state, const vec3 position, const vec3 normal, inout uint seed)
+{
+	for (uint i = 0; i != RestirCandidates; ++i)
+	{
+		const uint lightIndex = PickLight(RestirRandom(seed));
+		const Light light = Lights.Values[lightIndex];
+		vec2 barycentrics = vec2(RestirRandom(seed), RestirRandom(seed));
+		barycentrics = barycentrics.x + barycentrics.y > 1 ? 1 - barycentrics : barycentrics;
+
+		const float targetPdf = RestirTargetPdf(position, normal, light, barycentrics);
+		const float sourcePdf = Luminance(light.EmissionAndCdf.rgb) / Camera.LightPower;
+
+		StreamSample(state, lightIndex, barycentrics, targetPdf, targetPdf / sourcePdf, 1, seed);
+	}
+}
+
+// A stored reservoir, its sample retargeted to the current shading point.
+void StreamReservoir(inout RestirState state, const Reservoir reservoir, const vec3 position, const vec3 normal, inout uint seed)
+{
+	const float count = min(unpackHalf2x16(reservoir.CountAndDistance).x, RestirHistoryCap);
+
+	if (count <= 0 || reservoir.LightIndex >= Camera.LightCount)
+	{
+		return;
+	}
+
+	const vec2 barycentrics = unpackUnorm2x16(reservoir.Barycentrics);
+	const float targetPdf = RestirTargetPdf(position, normal, Lights.Values[reservoir.LightIndex], barycentrics);
+
+	StreamSample(state, reservoir.LightIndex, barycentrics, targetPdf, targetPdf * reservoir.Weight * count, count, seed);
+}
+
+// The reservoirs of the previous frame at the reprojection of the point and around it, those of other surfaces being skipped.
+void StreamHistory(inout RestirState state, const vec3 position, const vec3 normal, const ivec2 size, inout uint seed)
+{
+	if (Camera.RestirFrame == 0)
+	{
+		return;
+	}
+
+	const vec4 previousView = Camera.PreviousModelView * vec4(position, 1);
+	const vec4 clip = Camera.Projection * previousView;
+
+	if (clip.w <= 0)
+	{
+		return;
+	}
+
+	const ivec2 previousPixel = ivec2(floor((clip.xy / clip.w * 0.5 + 0.5) * size));
+	const float previousDistance = length(previousView.xyz);
+	const uint previousOffset = ((Camera.RestirFrame - 1) & 1) * uint(size.x * size.y);
+
+	for (uint i = 0; i <= RestirNeighbours; ++i)
+	{
+		const vec2 offset = i == 0 ? vec2(0) : (vec2(RestirRandom(seed), RestirRandom(seed)) * 2 - 1) * RestirRadius;
+		const ivec2 pixel = previousPixel + ivec2(offset);
+
+		if (any(lessThan(pixel, ivec2(0))) || any(greaterThanEqual(pixel, size)))
+		{
+			continue;
+		}
+
+		const Reservoir reservoir = Reservoirs[previousOffset + pixel.y * size.x + pixel.x];
+
+		if (abs(unpackHalf2x16(reservoir.CountAndDistance).y - previousDistance) < 0.05 * previousDistance)
+		{
+			StreamReservoir(state, reservoir, position, normal, seed);
+		}
+	}
+}
+
+// The reservoir of the selected sample, its weight still to be zeroed if it turns out occluded.
+Reservoir MakeReservoir(const RestirState state, const float cameraDistance)
+{
+	const float weight = state.TargetPdf > 0 ? state.WeightSum / (state.Count * state.TargetPdf) : 0.0;
+
+	return Reservoir(state.LightIndex, packUnorm2x16(state.Barycentrics), weight, packHalf2x16(vec2(state.Count, cameraDistance)));
+}
+
+void StoreReservoir(const Reservoir reservoir, const ivec2 pixel, const ivec2 size)
+{
+	Reservoirs[(Camera.RestirFrame & 1) * uint(size.x * size.y) + pixel.y * size.x + pixel.x] = reservoir;
+}
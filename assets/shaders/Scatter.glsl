@@ -3,6 +3,38 @@
 #include "Random.glsl"
 #include "RayPayload.glsl"
 
+// The material model baked into the specialized closest hit shaders, whose material is their shader record (see Vulkan::RayTracing::RayTracingPipeline).
+// The generic ones (all ones) fetch the material from the buffer and switch on its model at runtime.
+layout(constant_id = 5) const uint SpecializedMaterial = 0xFFFFFFFFu;
+const bool IsMaterialSpecialized = SpecializedMaterial != 0xFFFFFFFFu;
+
+// Ray cone spread after a diffuse bounce, a heuristic stand-in for the width of the cosine lobe.
+const float LambertianConeSpread = 0.3;
+
+// Ray cones texture LOD (Akenine-Moller et al., "Texture Level of Detail Strategies for Real-Time Ray Tracing").
+// The LOD bias relates the texture coordinates area to the world space area of the surface (0.5 * log2(uvArea / worldArea)).
+// The footprint, independent of the resident texture size, is also requested from the texture streamer.
+vec4 SampleDiffuse(const Material m, const vec2 texCoord, const vec3 direction, const vec3 normal, const float lodBias, const float coneWidth)
+{
+	if (m.DiffuseTextureId < 0)
+	{
+		return vec4(1);
+	}
+
+	const vec2 size = textureSize(sampler2D(Textures[nonuniformEXT(m.DiffuseTextureId)], TextureSampler), 0);
+	const float cosine = max(abs(dot(direction, normal)), 0.001);
+	const float footprint = lodBias + log2(max(coneWidth, 1e-9) / cosine);
+	const int request = int(floor(footprint));
+
+	// Most rays hit textures that have already been requested at that level, skip the atomic then.
+	if (TextureRequests[m.DiffuseTextureId] > request)
+	{
+		atomicMin(TextureRequests[m.DiffuseTextureId], request);
+	}
+
+	return textureLod(sampler2D(Textures[nonuniformEXT(m.DiffuseTextureId)], TextureSampler), texCoord, footprint + 0.5 * log2(size.x * size.y));
+}
+
 // Polynomial approximation by Christophe Schlick
 float Schlick(const float cosine, const float refractionIndex)
 {
@@ -11,32 +43,32 @@ float Schlick(const float cosine, const float refractionIndex)
 	return r0 + (1 - r0) * pow(1 - cosine, 5);
 }
 
-// Lambertian
-RayPayload ScatterLambertian(const Material m, const vec3 direction, const vec3 normal, const vec2 texCoord, const float t, inout uint seed)
+// Lambertian, cosine distributed (the light sampling in the ray generation shader relies on its cos / pi pdf).
+RayPayload ScatterLambertian(const Material m, const vec3 direction, const vec3 normal, const vec2 texCoord, const float t, const float lodBias, const vec2 cone, inout uint seed)
 {
 	const bool isScattered = dot(direction, normal) < 0;
-	const vec4 texColor = m.DiffuseTextureId >= 0 ? texture(TextureSamplers[nonuniformEXT(m.DiffuseTextureId)], texCoord) : vec4(1);
+	const vec4 texColor = SampleDiffuse(m, texCoord, direction, normal, lodBias, cone.x);
 	const vec4 colorAndDistance = vec4(m.Diffuse.rgb * texColor.rgb, t);
-	const vec4 scatter = vec4(normal + RandomInUnitSphere(seed), isScattered ? 1 : 0);
+	const vec4 scatter = vec4(normal + RandomUnitVector(seed), isScattered ? 1 : 0);
 
-	return RayPayload(colorAndDistance, scatter, seed);
+	return MakeRayPayload(colorAndDistance, scatter, vec4(normal, SurfaceDiffuse), seed, vec2(cone.x, max(cone.y, LambertianConeSpread)));
 }
 
 // Metallic
-RayPayload ScatterMetallic(const Material m, const vec3 direction, const vec3 normal, const vec2 texCoord, const float t, inout uint seed)
+RayPayload ScatterMetallic(const Material m, const vec3 direction, const vec3 normal, const vec2 texCoord, const float t, const float lodBias, const vec2 cone, inout uint seed)
 {
 	const vec3 reflected = reflect(direction, normal);
 	const bool isScattered = dot(reflected, normal) > 0;
 
-	const vec4 texColor = m.DiffuseTextureId >= 0 ? texture(TextureSamplers[nonuniformEXT(m.DiffuseTextureId)], texCoord) : vec4(1);
+	const vec4 texColor = SampleDiffuse(m, texCoord, direction, normal, lodBias, cone.x);
 	const vec4 colorAndDistance = vec4(m.Diffuse.rgb * texColor.rgb, t);
 	const vec4 scatter = vec4(reflected + m.Fuzziness*RandomInUnitSphere(seed), isScattered ? 1 : 0);
 
-	return RayPayload(colorAndDistance, scatter, seed);
+	return MakeRayPayload(colorAndDistance, scatter, vec4(normal, SurfaceSpecular), seed, vec2(cone.x, cone.y + m.Fuzziness));
 }
 
 // Dielectric
-RayPayload ScatterDieletric(const Material m, const vec3 direction, const vec3 normal, const vec2 texCoord, const float t, inout uint seed)
+RayPayload ScatterDieletric(const Material m, const vec3 direction, const vec3 normal, const vec2 texCoord, const float t, const float lodBias, const vec2 cone, inout uint seed)
 {
 	const float dot = dot(direction, normal);
 	const vec3 outwardNormal = dot > 0 ? -normal : normal;
@@ -46,36 +78,47 @@ RayPayload ScatterDieletric(const Material m, const vec3 direction, const vec3 n
 	const vec3 refracted = refract(direction, outwardNormal, niOverNt);
 	const float reflectProb = refracted != vec3(0) ? Schlick(cosine, m.RefractionIndex) : 1;
 
-	const vec4 texColor = m.DiffuseTextureId >= 0 ? texture(TextureSamplers[nonuniformEXT(m.DiffuseTextureId)], texCoord) : vec4(1);
+	const vec4 texColor = SampleDiffuse(m, texCoord, direction, normal, lodBias, cone.x);
 	
 	return RandomFloat(seed) < reflectProb
-		? RayPayload(vec4(texColor.rgb, t), vec4(reflect(direction, normal), 1), seed)
-		: RayPayload(vec4(texColor.rgb, t), vec4(refracted, 1), seed);
+		? MakeRayPayload(vec4(texColor.rgb, t), vec4(reflect(direction, normal), 1), vec4(normal, SurfaceSpecular), seed, cone)
+		: MakeRayPayload(vec4(texColor.rgb, t), vec4(refracted, 1), vec4(normal, SurfaceSpecular), seed, cone);
+}
+
+// Isotropic, the surfaces of the isotropic models that are not media (see Medium.glsl) let the rays through unchanged.
+RayPayload ScatterIsotropic(const vec3 direction, const float t, const vec2 cone, inout uint seed)
+{
+	return MakeRayPayload(vec4(1, 1, 1, t), vec4(direction, 1), vec4(0, 0, 0, SurfaceSpecular), seed, cone);
 }
 
 // Diffuse Light
-RayPayload ScatterDiffuseLight(const Material m, const float t, inout uint seed)
+RayPayload ScatterDiffuseLight(const Material m, const float t, const vec2 cone, inout uint seed)
 {
 	const vec4 colorAndDistance = vec4(m.Diffuse.rgb, t);
 	const vec4 scatter = vec4(1, 0, 0, 0);
 
-	return RayPayload(colorAndDistance, scatter, seed);
+	return MakeRayPayload(colorAndDistance, scatter, vec4(0), seed, cone);
 }
 
-RayPayload Scatter(const Material m, const vec3 direction, const vec3 normal, const vec2 texCoord, const float t, inout uint seed)
+// The incoming cone is the one of the ray being scattered, its width is moved to the hit point.
+// The returned cone is the one of the scattered ray, starting at the hit point.
+RayPayload Scatter(const Material m, const vec3 direction, const vec3 normal, const vec2 texCoord, const float t, const float lodBias, const vec2 incomingCone, inout uint seed)
 {
 	const vec3 normDirection = normalize(direction);
+	const vec2 cone = vec2(incomingCone.x + incomingCone.y * t, incomingCone.y);
 
-	switch (m.MaterialModel)
+	switch (IsMaterialSpecialized ? SpecializedMaterial : m.MaterialModel)
 	{
 	case MaterialLambertian:
-		return ScatterLambertian(m, normDirection, normal, texCoord, t, seed);
+		return ScatterLambertian(m, normDirection, normal, texCoord, t, lodBias, cone, seed);
 	case MaterialMetallic:
-		return ScatterMetallic(m, normDirection, normal, texCoord, t, seed);
+		return ScatterMetallic(m, normDirection, normal, texCoord, t, lodBias, cone, seed);
 	case MaterialDielectric:
-		return ScatterDieletric(m, normDirection, normal, texCoord, t, seed);
+		return ScatterDieletric(m, normDirection, normal, texCoord, t, lodBias, cone, seed);
+	case MaterialIsotropic:
+		return ScatterIsotropic(normDirection, t, cone, seed);
 	case MaterialDiffuseLight:
-		return ScatterDiffuseLight(m, t, seed);
+		return ScatterDiffuseLight(m, t, cone, seed);
 	}
 }
 
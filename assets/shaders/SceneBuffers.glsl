@@ -0,0 +1,61 @@
+
+// The scene buffers, reached through the device addresses of a single table (see Assets::Scene::SceneBufferTable()).
+// Expects GL_EXT_buffer_reference, as well as Instance.glsl, Light.glsl and Material.glsl.
+
+// A participating medium in the local space of its instance (see Assets::Scene::MediumCount() and Medium.glsl).
+struct Medium
+{
+	mat4 WorldToLocal;
+	vec4 BoundsMinAndShape; // xyz + w (1 for the sphere inscribed in the bounds, 0 for the box)
+	vec4 BoundsMaxAndDensity; // xyz + w (the extinction per world unit, scaled by the densities of the grid)
+	vec4 Albedo;
+	uvec4 Grid; // The density grid resolution (zero when homogeneous) + w (its first voxel in MediumVoxels)
+	uvec4 MajorantGrid; // The same for the maximum densities of its blocks.
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer SceneMaterialArray { Material Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 8) readonly buffer SceneOffsetArray { uvec2 Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer SceneSphereArray { vec4 Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer SceneInstanceArray { Instance Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer SceneTriangleMaterialArray { int Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer SceneLightArray { Light Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer SceneEnvironmentArray { uvec4 Values[]; }; // See Environment.glsl.
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer SceneCompactMaterialArray { uvec4 Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer SceneLightNodeArray { LightNode Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer SceneLightIndexArray { uint Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer SceneMediumArray { Medium Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer SceneMediumVoxelArray { float Values[]; };
+
+layout(set = 1, binding = 0) readonly uniform SceneBufferTable
+{
+	SceneMaterialArray Materials;
+	SceneOffsetArray Offsets;
+	SceneSphereArray Spheres;
+	SceneInstanceArray Instances;
+	SceneTriangleMaterialArray TriangleMaterials; // Of the whole scene, the procedurals are looked up from their model offsets.
+	SceneLightArray Lights;
+	SceneEnvironmentArray Environment;
+	uint EnvironmentWidth; // Zero without environment map.
+	uint EnvironmentHeight;
+	float EnvironmentPdfScale;
+	uint MediumCount; // The participating media, see Medium.glsl.
+	SceneCompactMaterialArray CompactMaterials; // The same materials packed, see FetchMaterial().
+	SceneLightNodeArray LightNodes; // The light tree, see LightSelection.glsl.
+	SceneLightIndexArray LightIndices; // The light of every triangle from Instance.LightOffset on, ~0 if not in the light list.
+	SceneMediumArray Media;
+	SceneMediumVoxelArray MediumVoxels; // The density grids and their majorants.
+};
+
+// Baked by the pipeline variants (see Vulkan::RayTracing::RayTracingPipeline::Variant), selecting the material layout the hits are shaded from.
+layout(constant_id = 8) const bool UseCompactMaterials = false;
+
+Material FetchMaterial(const int index)
+{
+	return UseCompactMaterials ? UnpackMaterial(CompactMaterials.Values[index]) : Materials.Values[index];
+}
+
+// Only the word holding the model in the compact layout.
+uint FetchMaterialModel(const int index)
+{
+	return UseCompactMaterials ? CompactMaterials.Values[index].z >> 28 : Materials.Values[index].MaterialModel;
+}
@@ -5,6 +5,8 @@ struct UniformBufferObject
 	mat4 Projection;
 	mat4 ModelViewInverse;
 	mat4 ProjectionInverse;
+	mat4 PreviousModelView;
+	vec4 SceneSphere;
 	float Aperture;
 	float FocusDistance;
 	float HeatmapScale;
@@ -14,4 +16,33 @@ struct UniformBufferObject
 	uint RandomSeed;
 	bool HasSky;
 	bool ShowHeatmap;
+	uint RussianRouletteDepth;
+	bool LightSampling;
+	uint LightCount;
+	float LightPower;
+	uint ReprojectedSamples;
+	uint HalfAccumulationSamples;
+	uint SampleStreamIndex;
+	uint SampleStreamCount;
+	uint HeatmapStage;
+	uint HeatmapBounce;
+	uint InterleavePattern;
+	uint InterleaveFrame;
+	uint OpaqueDepth;
+	bool Restir;
+	uint RestirFrame;
+	bool LightTree;
+	bool RadianceCache;
+	uint RadianceCacheFrame;
+	bool PathGuiding;
+	uint ViewCount;
+	mat4 ViewModelViewInverse[8];
+	vec4 ProbeOrigin;
+	vec4 ProbeSpacing;
+	uvec4 ProbeGrid;
+	bool ProbeBake;
+	uint ProbeFirst;
+	uint ProbeEnd;
+	uint RayIsolation;
+	bool SampleMap;
 };
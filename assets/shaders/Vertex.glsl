@@ -1,23 +1,52 @@
 
+#include "Octahedral.glsl"
+#include "VertexLayout.glsl"
+
+// Set from Assets::Scene::CompactVertices(), the strides and offsets of both layouts come from Assets::VertexLayout.
+layout(constant_id = 0) const bool CompactVertices = false;
+
+// The geometry of a model, reached through the device addresses of its instance record (requires GL_EXT_buffer_reference_uvec2).
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer VertexArray { float Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer IndexArray { uint Values[]; };
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer TriangleMaterialArray { int Values[]; };
+
+// The models with short indices pack two per word, the low half first (see Assets::Scene::IndexType() and Instance.glsl).
+uint FetchIndex(const IndexArray indices, const uint shortIndices, const uint i)
+{
+	return shortIndices != 0 ? (indices.Values[i >> 1] >> ((i & 1) << 4)) & 0xFFFF : indices.Values[i];
+}
+
 struct Vertex
 {
   vec3 Position;
   vec3 Normal;
   vec2 TexCoord;
-  int MaterialIndex;
 };
 
-Vertex UnpackVertex(uint index)
+Vertex UnpackVertex(const VertexArray vertices, const uint index)
 {
-	const uint vertexSize = 9;
-	const uint offset = index * vertexSize;
-	
 	Vertex v;
-	
-	v.Position = vec3(Vertices[offset + 0], Vertices[offset + 1], Vertices[offset + 2]);
-	v.Normal = vec3(Vertices[offset + 3], Vertices[offset + 4], Vertices[offset + 5]);
-	v.TexCoord = vec2(Vertices[offset + 6], Vertices[offset + 7]);
-	v.MaterialIndex = floatBitsToInt(Vertices[offset + 8]);
+
+	if (CompactVertices)
+	{
+		const uint offset = index * CompactVertexWords;
+		const uint position = offset + CompactVertexPositionWord;
+
+		v.Position = vec3(vertices.Values[position + 0], vertices.Values[position + 1], vertices.Values[position + 2]);
+		v.Normal = OctahedralDecode(unpackSnorm2x16(floatBitsToUint(vertices.Values[offset + CompactVertexNormalWord])));
+		v.TexCoord = unpackHalf2x16(floatBitsToUint(vertices.Values[offset + CompactVertexTexCoordWord]));
+	}
+	else
+	{
+		const uint offset = index * VertexWords;
+		const uint position = offset + VertexPositionWord;
+		const uint normal = offset + VertexNormalWord;
+		const uint texCoord = offset + VertexTexCoordWord;
+
+		v.Position = vec3(vertices.Values[position + 0], vertices.Values[position + 1], vertices.Values[position + 2]);
+		v.Normal = vec3(vertices.Values[normal + 0], vertices.Values[normal + 1], vertices.Values[normal + 2]);
+		v.TexCoord = vec2(vertices.Values[texCoord + 0], vertices.Values[texCoord + 1]);
+	}
 
 	return v;
 }
@@ -0,0 +1,52 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+#include "Instance.glsl"
+#include "Material.glsl"
+#include "Vertex.glsl"
+
+layout(binding = 1) readonly buffer MaterialArray { Material[] Materials; };
+layout(binding = 2) uniform texture2D[] Textures;
+layout(binding = 3) readonly buffer InstanceArray { Instance[] Instances; };
+layout(binding = 5) uniform sampler TextureSampler;
+
+layout(location = 0) in vec2 FragTexCoord;
+layout(location = 1) in flat uint FragInstanceIndex;
+layout(location = 2) in flat uint FragIsSphere;
+
+// The instance index + 1 and the primitive index of the closest surface, 0 where the camera ray misses.
+layout(location = 0) out uvec2 OutVisibility;
+
+void main() 
+{
+	const Instance instance = Instances[FragInstanceIndex];
+
+	// The instances hidden from the camera rays (see Assets::ModelInstance::RayMask).
+	if ((instance.RayMask & BounceRayMask(0)) == 0)
+	{
+		discard;
+	}
+
+	// The cut out parts of the alpha tested triangles, at the same texture level as AlphaTest.glsl. The procedurals never are.
+	if (FragIsSphere == 0)
+	{
+		const int materialIndex = instance.MaterialIndex >= 0 ? instance.MaterialIndex : TriangleMaterialArray(instance.TriangleMaterialAddress).Values[gl_PrimitiveID];
+		const Material material = Materials[materialIndex];
+		float alpha = material.Diffuse.a;
+
+		if (material.AlphaCutoff > 0 && material.DiffuseTextureId >= 0)
+		{
+			alpha *= textureLod(sampler2D(Textures[nonuniformEXT(material.DiffuseTextureId)], TextureSampler), FragTexCoord, 0).a;
+		}
+
+		if (material.AlphaCutoff > 0 && alpha < material.AlphaCutoff)
+		{
+			discard;
+		}
+	}
+
+	OutVisibility = uvec2(FragInstanceIndex + 1, gl_PrimitiveID);
+}
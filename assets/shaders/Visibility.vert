@@ -0,0 +1,43 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+#include "Instance.glsl"
+#include "UniformBufferObject.glsl"
+
+// The primary visibility of the hybrid mode (see Vulkan::VisibilityPipeline), drawn like Graphics.vert.
+layout(binding = 0) readonly uniform UniformBufferObjectStruct { UniformBufferObject Camera; };
+layout(binding = 3) readonly buffer InstanceArray { Instance[] Instances; };
+layout(binding = 4) readonly buffer SphereArray { vec4[] Spheres; };
+
+#include "Vertex.glsl"
+
+// The clip space offset moving the sample of every pixel onto the jittered camera ray of the frame (see Wavefront.Generate.comp).
+layout(push_constant) uniform VisibilityConstants { vec2 Jitter; };
+
+layout(location = 0) out vec2 FragTexCoord;
+layout(location = 1) out flat uint FragInstanceIndex;
+layout(location = 2) out flat uint FragIsSphere;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main() 
+{
+	const Instance instance = Instances[gl_InstanceIndex];
+	const Vertex v = UnpackVertex(VertexArray(instance.VertexAddress), gl_VertexIndex);
+
+	// The procedural spheres share a unit sphere mesh, scaled and moved here.
+	const vec4 sphere = Spheres[instance.ModelIndex];
+	const bool isSphere = sphere.w > 0;
+	const vec3 position = isSphere ? sphere.xyz + sphere.w * v.Position : v.Position;
+
+	gl_Position = Camera.Projection * Camera.ModelView * instance.Transform * vec4(position, 1.0);
+	gl_Position.xy += Jitter * gl_Position.w;
+	FragTexCoord = v.TexCoord;
+	FragInstanceIndex = gl_InstanceIndex;
+	FragIsSphere = isSphere ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+
+// The queues of the wavefront path tracer (see Vulkan::RayTracing::WavefrontPipeline).
+// Every kernel handles one stage of all the paths at once: generate the camera rays, extend them to their closest hit,
+// shade the hits into the next rays and the shadow rays, then connect the shadow rays to the lights.
+
+struct WavefrontRay
+{
+	vec4 Origin; // xyz + ray cone width
+	vec4 Direction; // xyz + ray cone spread angle
+	vec3 Throughput;
+	float BsdfPdf; // The solid angle pdf of the direction, zero when the lights could not be sampled from its origin.
+	uint Pixel;
+	uint RandomSeed;
+	uint LightSampleNormal; // Octahedral snorm, the normal the lights were selected for from the origin (see LightSelection.glsl).
+	uint Reserved1;
+};
+
+// The surface found by the extend kernel for the ray of the same index.
+struct WavefrontHit
+{
+	vec4 NormalAndDistance; // World space shading normal + t, negative on a miss.
+	vec4 GeometricNormal; // xyz + w (1 + the light list index of the emissive triangles, exact below 2^24 lights, 0 otherwise)
+	vec2 TexCoord;
+	float LodBias;
+	int MaterialIndex;
+};
+
+struct WavefrontShadowRay
+{
+	vec4 Origin; // xyz + distance to the light
+	vec4 Direction;
+	vec3 Radiance; // Added to the pixel if the light is not occluded.
+	uint Pixel;
+};
+
+struct WavefrontPixel
+{
+	vec4 SampleColor; // The radiance gathered so far by the path of the current sample.
+	vec4 ColorSum; // The previous samples of the frame.
+	vec4 Moments; // Their luminance sum and sum of squares.
+};
+
+// Count + the indirect dispatch arguments, the producers add a group every WavefrontGroupSize entries.
+struct WavefrontQueue
+{
+	uint Count;
+	uint GroupCountX;
+	uint GroupCountY;
+	uint GroupCountZ;
+};
+
+const uint WavefrontGroupSize = 64;
+const uint ShadowQueue = 2; // The ray queues 0 and 1 ping-pong between the bounces.
+
+layout(push_constant) uniform WavefrontConstants
+{
+	uint TotalNumberOfSamples;
+	uint NumberOfSamples;
+	uint Sample;
+	uint Bounce;
+	uint InputQueue;
+	uint Hybrid; // Non zero when the camera rays start from the rasterized visibility image, see Wavefront.Extend.comp.
+	vec2 PrimaryJitter; // The subpixel position the visibility image was rasterized at, shared by all the samples of the frame.
+};
+
+layout(binding = 21) buffer RayArray { WavefrontRay Rays[]; }; // Two queues of one ray per pixel.
+layout(binding = 22) buffer HitArray { WavefrontHit Hits[]; };
+layout(binding = 23) buffer ShadowRayArray { WavefrontShadowRay ShadowRays[]; };
+layout(binding = 24) buffer QueueArray { WavefrontQueue Queues[3]; };
+layout(binding = 25) buffer PixelArray { WavefrontPixel Pixels[]; };
+
+uint PushQueue(const uint queue)
+{
+	const uint index = atomicAdd(Queues[queue].Count, 1);
+
+	if (index % WavefrontGroupSize == 0)
+	{
+		atomicAdd(Queues[queue].GroupCountX, 1);
+	}
+
+	return index;
+}
@@ -0,0 +1,64 @@
+
+// The procedurals and alpha tested triangles of the ray queries, the intersection and any-hit shaders have no equivalent there
+// (see RayTracing.Procedural.rint and RayTracing.rahit). Expects SceneBuffers.glsl and AlphaTest.glsl.
+
+vec4 GetSphere(const uint customIndex, const uint primitiveIndex)
+{
+	const uint modelIndex = customIndex == MergedProceduralsInstance ? primitiveIndex : Instances.Values[customIndex].ModelIndex;
+
+	return Spheres.Values[modelIndex];
+}
+
+// The nearest intersection of the object space ray with the sphere within [tMin, tMax), negative if none.
+float IntersectSphere(const vec4 sphere, const vec3 origin, const vec3 direction, const float tMin, const float tMax)
+{
+	const vec3 oc = origin - sphere.xyz;
+	const float a = dot(direction, direction);
+	const float b = dot(oc, direction);
+	const float c = dot(oc, oc) - sphere.w * sphere.w;
+	const float discriminant = b * b - a * c;
+
+	if (discriminant < 0)
+	{
+		return -1;
+	}
+
+	const float t1 = (-b - sqrt(discriminant)) / a;
+	const float t2 = (-b + sqrt(discriminant)) / a;
+
+	return (tMin <= t1 && t1 < tMax) ? t1 : (tMin <= t2 && t2 < tMax) ? t2 : -1;
+}
+
+// Reports the sphere hits of the bounding boxes found by the traversal. The opaque triangles are committed by the traversal itself,
+// the candidate ones only come from the non opaque bottom level structures and are committed when they pass the alpha test.
+void ProceedRayQuery(rayQueryEXT rayQuery, const float tMin, const float tMax)
+{
+	while (rayQueryProceedEXT(rayQuery))
+	{
+		if (rayQueryGetIntersectionTypeEXT(rayQuery, false) == gl_RayQueryCandidateIntersectionTriangleEXT)
+		{
+			if (IsAlphaTestPassed(
+				uint(rayQueryGetIntersectionInstanceCustomIndexEXT(rayQuery, false)),
+				uint(rayQueryGetIntersectionPrimitiveIndexEXT(rayQuery, false)),
+				rayQueryGetIntersectionBarycentricsEXT(rayQuery, false)))
+			{
+				rayQueryConfirmIntersectionEXT(rayQuery);
+			}
+		}
+		else if (rayQueryGetIntersectionTypeEXT(rayQuery, false) == gl_RayQueryCandidateIntersectionAABBEXT)
+		{
+			const bool hasCommitted = rayQueryGetIntersectionTypeEXT(rayQuery, true) != gl_RayQueryCommittedIntersectionNoneEXT;
+			const float committedT = hasCommitted ? rayQueryGetIntersectionTEXT(rayQuery, true) : tMax;
+			const vec4 sphere = GetSphere(uint(rayQueryGetIntersectionInstanceCustomIndexEXT(rayQuery, false)), uint(rayQueryGetIntersectionPrimitiveIndexEXT(rayQuery, false)));
+			const float t = IntersectSphere(sphere,
+				rayQueryGetIntersectionObjectRayOriginEXT(rayQuery, false),
+				rayQueryGetIntersectionObjectRayDirectionEXT(rayQuery, false),
+				tMin, committedT);
+
+			if (t >= 0)
+			{
+				rayQueryGenerateIntersectionEXT(rayQuery, t);
+			}
+		}
+	}
+}
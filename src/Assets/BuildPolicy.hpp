@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Assets
+{
+
+	// Acceleration structure build preference, trading trace performance against build time or memory.
+	enum class BuildPolicy : uint32_t
+	{
+		FastTrace,
+		FastBuild,
+		LowMemory
+	};
+
+}
@@ -0,0 +1,128 @@
+#include "DensityGrid.hpp"
+#include "Utilities/Exception.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace Assets {
+
+namespace
+{
+	// The lattice values of the noise, a hash of their integer coordinates.
+	float LatticeValue(const glm::ivec3& p, const uint32_t seed)
+	{
+		uint32_t h = seed ^ (static_cast<uint32_t>(p.x) * 0x8da6b343u) ^ (static_cast<uint32_t>(p.y) * 0xd8163841u) ^ (static_cast<uint32_t>(p.z) * 0xcb1ab31fu);
+		h ^= h >> 16;
+		h *= 0x7feb352du;
+		h ^= h >> 15;
+		h *= 0x846ca68bu;
+		h ^= h >> 16;
+
+		return static_cast<float>(h >> 8) / static_cast<float>(1u << 24);
+	}
+
+	float ValueNoise(const glm::vec3& p, const uint32_t seed)
+	{
+		const glm::vec3 cell = glm::floor(p);
+		const glm::vec3 f = p - cell;
+		const glm::vec3 u = f * f * (3.0f - 2.0f * f);
+		const glm::ivec3 i(cell);
+
+		const auto value = [&](const int x, const int y, const int z) { return LatticeValue(i + glm::ivec3(x, y, z), seed); };
+
+		return glm::mix(
+			glm::mix(glm::mix(value(0, 0, 0), value(1, 0, 0), u.x), glm::mix(value(0, 1, 0), value(1, 1, 0), u.x), u.y),
+			glm::mix(glm::mix(value(0, 0, 1), value(1, 0, 1), u.x), glm::mix(value(0, 1, 1), value(1, 1, 1), u.x), u.y),
+			u.z);
+	}
+}
+
+DensityGrid DensityGrid::CreateNoise(const uint32_t resolution, const float frequency, const uint32_t seed)
+{
+	if (resolution == 0)
+	{
+		Throw(std::runtime_error("density grid resolution must be positive"));
+	}
+
+	std::vector<float> densities(size_t(resolution) * resolution * resolution);
+
+	for (uint32_t z = 0; z != resolution; ++z)
+	{
+		for (uint32_t y = 0; y != resolution; ++y)
+		{
+			for (uint32_t x = 0; x != resolution; ++x)
+			{
+				const glm::vec3 p = (glm::vec3(x, y, z) + 0.5f) / static_cast<float>(resolution);
+
+				// Four octaves, the lower densities cut off into empty space between the puffs.
+				float noise = 0;
+				float amplitude = 0.5f;
+				float scale = frequency;
+
+				for (uint32_t octave = 0; octave != 4; ++octave)
+				{
+					noise += amplitude * ValueNoise(p * scale, seed + octave);
+					amplitude *= 0.5f;
+					scale *= 2;
+				}
+
+				const float falloff = glm::clamp(1.0f - glm::length(2.0f * p - 1.0f), 0.0f, 1.0f);
+
+				densities[(size_t(z) * resolution + y) * resolution + x] = glm::clamp((noise - 0.35f) / 0.4f, 0.0f, 1.0f) * glm::min(4.0f * falloff, 1.0f);
+			}
+		}
+	}
+
+	return DensityGrid(glm::uvec3(resolution), std::move(densities));
+}
+
+DensityGrid DensityGrid::LoadRaw(const std::string& filename, const glm::uvec3& resolution)
+{
+	if (resolution.x == 0 || resolution.y == 0 || resolution.z == 0)
+	{
+		Throw(std::runtime_error("density grid resolution must be positive"));
+	}
+
+	std::ifstream file(filename, std::ios::binary);
+
+	if (!file.is_open())
+	{
+		Throw(std::runtime_error("cannot open density grid '" + filename + "'"));
+	}
+
+	std::vector<char> bytes(size_t(resolution.x) * resolution.y * resolution.z);
+
+	if (!file.read(bytes.data(), static_cast<std::streamsize>(bytes.size())))
+	{
+		Throw(std::runtime_error("density grid '" + filename + "' is smaller than its resolution"));
+	}
+
+	std::vector<float> densities(bytes.size());
+	std::transform(bytes.begin(), bytes.end(), densities.begin(), [](const char byte) { return static_cast<unsigned char>(byte) / 255.0f; });
+
+	return DensityGrid(resolution, std::move(densities));
+}
+
+DensityGrid::DensityGrid(const glm::uvec3& resolution, std::vector<float>&& densities) :
+	resolution_(resolution),
+	densities_(std::move(densities))
+{
+	// The voxels are looked up nearest, the maximum of a block covers all of them.
+	const auto blocks = MajorantResolution();
+	majorants_.resize(size_t(blocks.x) * blocks.y * blocks.z);
+
+	for (uint32_t z = 0; z != resolution_.z; ++z)
+	{
+		for (uint32_t y = 0; y != resolution_.y; ++y)
+		{
+			for (uint32_t x = 0; x != resolution_.x; ++x)
+			{
+				auto& majorant = majorants_[(size_t(z / MajorantBlock) * blocks.y + y / MajorantBlock) * blocks.x + x / MajorantBlock];
+
+				majorant = std::max(majorant, densities_[(size_t(z) * resolution_.y + y) * resolution_.x + x]);
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Utilities/Glm.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Assets
+{
+	// The densities in [0, 1] of a heterogeneous participating medium, a voxel grid over the bounds of its model scaling the extinction
+	// of its isotropic material (see Medium.glsl). The maximum density of every block of MajorantBlock^3 voxels bounds the extinction
+	// delta and ratio tracking step through, so that the empty and thin parts of the grid cost few steps.
+	// The voxels are stored x first, then y and z.
+	class DensityGrid final
+	{
+	public:
+
+		static constexpr uint32_t MajorantBlock = 8;
+
+		// Fractal value noise of the given frequency over the unit cube, fading out towards the surface of its inscribed sphere.
+		static DensityGrid CreateNoise(uint32_t resolution, float frequency, uint32_t seed);
+
+		// The 8-bit densities of a raw volume file of the given resolution.
+		static DensityGrid LoadRaw(const std::string& filename, const glm::uvec3& resolution);
+
+		const glm::uvec3& Resolution() const { return resolution_; }
+		glm::uvec3 MajorantResolution() const { return (resolution_ + MajorantBlock - 1u) / MajorantBlock; }
+
+		const std::vector<float>& Densities() const { return densities_; }
+		const std::vector<float>& Majorants() const { return majorants_; }
+
+	private:
+
+		DensityGrid(const glm::uvec3& resolution, std::vector<float>&& densities);
+
+		glm::uvec3 resolution_;
+		std::vector<float> densities_;
+		std::vector<float> majorants_;
+	};
+}
@@ -0,0 +1,138 @@
+#include "Environment.hpp"
+#include "Utilities/Exception.hpp"
+#include "Utilities/StbImage.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace Assets {
+
+Environment Environment::Load(const std::string& filename, const float intensity, Utilities::TaskSystem& tasks)
+{
+	const auto timer = std::chrono::high_resolution_clock::now();
+
+	int width, height, channels;
+	const std::unique_ptr<float, void (*) (void*)> pixels(stbi_loadf(filename.c_str(), &width, &height, &channels, STBI_rgb), stbi_image_free);
+
+	if (!pixels)
+	{
+		Throw(std::runtime_error("failed to load environment map '" + filename + "'"));
+	}
+
+	Environment environment;
+	environment.width_ = static_cast<uint32_t>(width);
+	environment.height_ = static_cast<uint32_t>(height);
+	environment.texels_.resize(size_t(width) * height);
+
+	// Pack the radiance and weight the texels by their luminance and solid angle, one task per band of rows.
+	// The weights come from the half radiance, so that the shaders find the exact pdf the texels are sampled with.
+	const float pi = 3.14159265358979f;
+	const int bandRows = std::max(1, height / static_cast<int>(4 * tasks.ThreadCount()));
+	std::vector<double> weights(environment.texels_.size());
+	std::vector<std::future<double>> bands;
+
+	for (int first = 0; first < height; first += bandRows)
+	{
+		bands.push_back(tasks.Run([&, first]()
+		{
+			double sum = 0;
+
+			for (int y = first; y != std::min(first + bandRows, height); ++y)
+			{
+				const float sinTheta = std::sin(pi * (y + 0.5f) / height);
+
+				for (int x = 0; x != width; ++x)
+				{
+					const size_t i = size_t(y) * width + x;
+					const glm::vec3 radiance = glm::clamp(glm::make_vec3(pixels.get() + 3 * i) * intensity, glm::vec3(0), glm::vec3(65504)); // The half range.
+					auto& texel = environment.texels_[i];
+
+					texel.x = glm::packHalf2x16(glm::vec2(radiance.r, radiance.g));
+					texel.y = glm::packHalf2x16(glm::vec2(radiance.b, 0));
+
+					const glm::vec3 stored(glm::unpackHalf2x16(texel.x), glm::unpackHalf2x16(texel.y).x);
+
+					weights[i] = glm::dot(stored, glm::vec3(0.2126f, 0.7152f, 0.0722f)) * sinTheta;
+					sum += weights[i];
+				}
+			}
+
+			return sum;
+		}));
+	}
+
+	double total = 0;
+
+	for (auto& band : bands)
+	{
+		total += band.get();
+	}
+
+	if (!(total > 0))
+	{
+		Throw(std::runtime_error("environment map '" + filename + "' emits no light"));
+	}
+
+	// Vose's alias table: every texel keeps the probability of picking itself, the rest of its column goes to its alias.
+	const size_t count = environment.texels_.size();
+	std::vector<uint32_t> small, large;
+
+	for (size_t i = 0; i != count; ++i)
+	{
+		weights[i] *= count / total;
+		(weights[i] < 1 ? small : large).push_back(static_cast<uint32_t>(i));
+	}
+
+	while (!small.empty() && !large.empty())
+	{
+		const uint32_t less = small.back();
+		const uint32_t more = large.back();
+		small.pop_back();
+
+		environment.texels_[less].z = glm::floatBitsToUint(static_cast<float>(weights[less]));
+		environment.texels_[less].w = more;
+
+		weights[more] -= 1 - weights[less];
+
+		if (weights[more] < 1)
+		{
+			large.pop_back();
+			small.push_back(more);
+		}
+	}
+
+	// The leftovers are only short of one by rounding errors.
+	for (const auto i : small)
+	{
+		environment.texels_[i].z = glm::floatBitsToUint(1.0f);
+		environment.texels_[i].w = i;
+	}
+
+	for (const auto i : large)
+	{
+		environment.texels_[i].z = glm::floatBitsToUint(1.0f);
+		environment.texels_[i].w = i;
+	}
+
+	// A texel is picked with the probability weight / total, spread over the sin(theta) 2 pi^2 / (width height) solid angle.
+	environment.pdfScale_ = static_cast<float>(double(width) * height / (2 * pi * pi * total));
+
+	const auto elapsed = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - timer).count();
+
+	std::ostringstream out;
+	out << "- loading environment '" << filename << "'... ";
+	out << "(" << width << " x " << height << ") ";
+	out << elapsed << "s" << std::endl;
+	std::cout << out.str() << std::flush;
+
+	return environment;
+}
+
+}
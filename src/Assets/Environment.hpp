@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Utilities/Glm.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Utilities
+{
+	class TaskSystem;
+}
+
+namespace Assets
+{
+	// An equirectangular HDR image lighting the scene in place of the sky (see --environment), with the alias table sampling
+	// its texels proportionally to their luminance times the solid angle they cover (see Environment.glsl).
+	// Every texel is packed as a uvec4: the half RGB radiance in x and y, the alias probability (float bits) in z and the alias in w.
+	class Environment final
+	{
+	public:
+
+		static Environment Load(const std::string& filename, float intensity, Utilities::TaskSystem& tasks);
+
+		uint32_t Width() const { return width_; }
+		uint32_t Height() const { return height_; }
+		const std::vector<glm::uvec4>& Texels() const { return texels_; }
+
+		// The solid angle pdf of a direction is the luminance of its texel times this scale, see EnvironmentPdf() in Environment.glsl.
+		float PdfScale() const { return pdfScale_; }
+
+	private:
+
+		uint32_t width_{};
+		uint32_t height_{};
+		float pdfScale_{};
+		std::vector<glm::uvec4> texels_;
+	};
+}
@@ -0,0 +1,430 @@
+#include "LightTree.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <limits>
+
+namespace Assets {
+
+namespace
+{
+	constexpr float Pi = 3.14159265358979323846f;
+	constexpr size_t BinCount = 12;
+	constexpr size_t TaskLights = 4096; // The subtrees of at most this many lights are built by a single task.
+
+	// The normals of the lights up to their sign, within the half angle of the axis.
+	struct Cone final
+	{
+		glm::vec3 Axis{};
+		float Cosine{ 2 }; // More than one when empty.
+	};
+
+	// After "Importance Sampling of Many Lights with Adaptive Tree Splitting" (Conty Estevez and Kulla, 2018) and pbrt-v4,
+	// the normals of the other cone being flipped towards this one first since the lights are two-sided.
+	Cone Union(const Cone& a, Cone b)
+	{
+		if (a.Cosine > 1) return b;
+		if (b.Cosine > 1) return a;
+
+		if (glm::dot(a.Axis, b.Axis) < 0)
+		{
+			b.Axis = -b.Axis;
+		}
+
+		const float thetaA = std::acos(std::clamp(a.Cosine, -1.0f, 1.0f));
+		const float thetaB = std::acos(std::clamp(b.Cosine, -1.0f, 1.0f));
+		const float thetaD = std::acos(std::clamp(glm::dot(a.Axis, b.Axis), -1.0f, 1.0f));
+
+		if (std::min(thetaD + thetaB, Pi) <= thetaA) return a;
+		if (std::min(thetaD + thetaA, Pi) <= thetaB) return b;
+
+		// Up to their sign, a right angle holds all the directions.
+		const float theta = (thetaA + thetaD + thetaB) / 2;
+		const glm::vec3 rotationAxis = glm::cross(a.Axis, b.Axis);
+
+		if (theta >= Pi / 2 || glm::dot(rotationAxis, rotationAxis) == 0)
+		{
+			return { a.Axis, 0 };
+		}
+
+		const glm::vec3 axis = glm::mat3(glm::rotate(glm::mat4(1), theta - thetaA, glm::normalize(rotationAxis))) * a.Axis;
+
+		return { glm::normalize(axis), std::cos(theta) };
+	}
+
+	struct LightBounds final
+	{
+		glm::vec3 Min{ std::numeric_limits<float>::max() };
+		glm::vec3 Max{ -std::numeric_limits<float>::max() };
+		float Power{};
+		Cone Normals;
+
+		void Add(const LightBounds& other)
+		{
+			Min = glm::min(Min, other.Min);
+			Max = glm::max(Max, other.Max);
+			Power += other.Power;
+			Normals = Union(Normals, other.Normals);
+		}
+
+		float SurfaceArea() const
+		{
+			const auto d = glm::max(Max - Min, glm::vec3(0));
+			return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+	};
+
+	// The solid angle the light of a cone of normals reaches, weighted by the cosine of its Lambertian emission.
+	float OrientationCost(const float cosine)
+	{
+		const float thetaO = std::acos(std::clamp(cosine, -1.0f, 1.0f));
+		const float thetaW = std::min(thetaO + Pi / 2, Pi);
+		const float sinThetaO = std::sqrt(std::max(0.0f, 1 - cosine * cosine));
+
+		return 2 * Pi * (1 - cosine) + Pi / 2 * (2 * thetaW * sinThetaO - std::cos(thetaO - 2 * thetaW) - 2 * thetaO * sinThetaO + cosine);
+	}
+
+	// The surface area orientation heuristic, the aspect factor penalizing the splits across the thin sides of the node.
+	float Cost(const LightBounds& bounds, const float aspect)
+	{
+		return bounds.Power * OrientationCost(bounds.Normals.Cosine) * bounds.SurfaceArea() * aspect;
+	}
+
+	struct Item final
+	{
+		LightBounds Bounds;
+		glm::vec3 Centroid;
+		uint32_t Light;
+	};
+
+	uint32_t CeilLog2(const size_t count)
+	{
+		uint32_t log = 0;
+
+		while ((size_t(1) << log) < count)
+		{
+			++log;
+		}
+
+		return log;
+	}
+
+	LightBounds BoundsOf(const Item* const first, const Item* const last)
+	{
+		LightBounds bounds;
+
+		for (auto* item = first; item != last; ++item)
+		{
+			bounds.Add(item->Bounds);
+		}
+
+		return bounds;
+	}
+
+	LightBounds BoundsOf(const LightTree::Node& node)
+	{
+		LightBounds bounds;
+		bounds.Min = glm::vec3(node.BoundsMinAndPower);
+		bounds.Max = glm::vec3(node.BoundsMaxAndCosine);
+		bounds.Power = node.BoundsMinAndPower.w;
+		bounds.Normals = { node.Axis, node.BoundsMaxAndCosine.w };
+
+		return bounds;
+	}
+
+	LightBounds BoundsOf(const LightTree::Triangle& triangle)
+	{
+		LightBounds bounds;
+		bounds.Min = glm::min(triangle.P0, glm::min(triangle.P1, triangle.P2));
+		bounds.Max = glm::max(triangle.P0, glm::max(triangle.P1, triangle.P2));
+		bounds.Power = triangle.Power;
+		bounds.Normals = { glm::normalize(glm::cross(triangle.P1 - triangle.P0, triangle.P2 - triangle.P0)), 1 };
+
+		return bounds;
+	}
+
+	LightTree::Node MakeNode(const LightBounds& bounds, const uint32_t child)
+	{
+		return { glm::vec4(bounds.Min, bounds.Power), glm::vec4(bounds.Max, bounds.Normals.Cosine), bounds.Normals.Axis, child };
+	}
+
+	// Partitions the lights along the cheapest of the binned planes, or in two halves once the depth limit gets close:
+	// the halving keeps depth + CeilLog2(count) constant, so that no leaf ends up deeper than MaxDepth.
+	Item* Split(Item* const first, Item* const last, const uint32_t depth, const LightBounds& bounds)
+	{
+		const size_t count = last - first;
+		glm::vec3 centroidMin(std::numeric_limits<float>::max());
+		glm::vec3 centroidMax(-std::numeric_limits<float>::max());
+
+		for (auto* item = first; item != last; ++item)
+		{
+			centroidMin = glm::min(centroidMin, item->Centroid);
+			centroidMax = glm::max(centroidMax, item->Centroid);
+		}
+
+		const auto centroidExtent = centroidMax - centroidMin;
+		const auto extent = glm::max(bounds.Max - bounds.Min, glm::vec3(1e-20f));
+		const float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+		const auto binOf = [&](const Item& item, const int axis)
+		{
+			return std::min(BinCount - 1, static_cast<size_t>(BinCount * (item.Centroid[axis] - centroidMin[axis]) / centroidExtent[axis]));
+		};
+
+		float bestCost = std::numeric_limits<float>::infinity();
+		int bestAxis = -1;
+		size_t bestBin = 0;
+
+		for (int axis = 0; depth + CeilLog2(count) < LightTree::MaxDepth && axis != 3; ++axis)
+		{
+			if (centroidExtent[axis] <= 0)
+			{
+				continue;
+			}
+
+			LightBounds bins[BinCount];
+
+			for (auto* item = first; item != last; ++item)
+			{
+				bins[binOf(*item, axis)].Add(item->Bounds);
+			}
+
+			// The costs of the bins below every plane, then of those above it.
+			float belowCosts[BinCount - 1];
+			float belowPowers[BinCount - 1];
+			LightBounds below;
+
+			for (size_t i = 0; i != BinCount - 1; ++i)
+			{
+				below.Add(bins[i]);
+				belowCosts[i] = below.Power > 0 ? Cost(below, maxExtent / extent[axis]) : 0;
+				belowPowers[i] = below.Power;
+			}
+
+			LightBounds above;
+
+			for (size_t i = BinCount - 1; i != 0; --i)
+			{
+				above.Add(bins[i]);
+
+				const float cost = belowCosts[i - 1] + (above.Power > 0 ? Cost(above, maxExtent / extent[axis]) : 0);
+
+				if (belowPowers[i - 1] > 0 && above.Power > 0 && cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = i - 1;
+				}
+			}
+		}
+
+		if (bestAxis >= 0)
+		{
+			auto* const middle = std::partition(first, last, [&](const Item& item) { return binOf(item, bestAxis) <= bestBin; });
+
+			if (middle != first && middle != last)
+			{
+				return middle;
+			}
+		}
+
+		const int axis = centroidExtent.x >= centroidExtent.y && centroidExtent.x >= centroidExtent.z ? 0 : centroidExtent.y >= centroidExtent.z ? 1 : 2;
+		auto* const middle = first + count / 2;
+
+		std::nth_element(first, middle, last, [axis](const Item& a, const Item& b) { return a.Centroid[axis] < b.Centroid[axis]; });
+
+		return middle;
+	}
+
+	// Appends the subtree in depth first order, its second child indices local to the vector.
+	void BuildNodes(std::vector<LightTree::Node>& nodes, Item* const first, Item* const last, const uint32_t depth)
+	{
+		const size_t index = nodes.size();
+
+		if (last - first == 1)
+		{
+			nodes.push_back(MakeNode(first->Bounds, LightTree::LeafBit | first->Light));
+			return;
+		}
+
+		const auto bounds = BoundsOf(first, last);
+		nodes.push_back(MakeNode(bounds, 0));
+
+		auto* const middle = Split(first, last, depth, bounds);
+
+		BuildNodes(nodes, first, middle, depth + 1);
+		nodes[index].Child = static_cast<uint32_t>(nodes.size());
+		BuildNodes(nodes, middle, last, depth + 1);
+	}
+
+	// The top levels of the tree, split serially until the subtrees are small enough to be built by a task each.
+	struct TopNode final
+	{
+		LightBounds Bounds;
+		size_t Second; // The top node of the second child.
+		size_t Subtree; // Or the subtree it is, if not internal.
+		Item* First;
+		Item* Last;
+		uint32_t Depth;
+	};
+
+	constexpr size_t NoSubtree = std::numeric_limits<size_t>::max();
+
+	void PlanTopNodes(std::vector<TopNode>& top, size_t& subtreeCount, Item* const first, Item* const last, const uint32_t depth)
+	{
+		if (static_cast<size_t>(last - first) <= TaskLights)
+		{
+			top.push_back({ {}, 0, subtreeCount++, first, last, depth });
+			return;
+		}
+
+		const size_t index = top.size();
+		const auto bounds = BoundsOf(first, last);
+		top.push_back({ bounds, 0, NoSubtree, first, last, depth });
+
+		auto* const middle = Split(first, last, depth, bounds);
+
+		PlanTopNodes(top, subtreeCount, first, middle, depth + 1);
+		top[index].Second = top.size();
+		PlanTopNodes(top, subtreeCount, middle, last, depth + 1);
+	}
+}
+
+void LightTree::Build(const std::vector<Triangle>& triangles, Utilities::TaskSystem& tasks)
+{
+	nodes_.clear();
+	parents_.clear();
+	leaves_.assign(triangles.size(), 0);
+	branches_.assign(triangles.size(), 0);
+
+	if (triangles.empty())
+	{
+		nodes_.push_back(MakeNode(LightBounds{ glm::vec3(0), glm::vec3(0), 0, { glm::vec3(0, 1, 0), 1 } }, LeafBit));
+		parents_.push_back(0);
+		return;
+	}
+
+	std::vector<Item> items(triangles.size());
+
+	for (size_t i = 0; i != triangles.size(); ++i)
+	{
+		const auto bounds = BoundsOf(triangles[i]);
+		items[i] = { bounds, (bounds.Min + bounds.Max) * 0.5f, static_cast<uint32_t>(i) };
+	}
+
+	// The subtrees partition disjoint ranges of the items, they are built side by side.
+	std::vector<TopNode> top;
+	size_t subtreeCount = 0;
+
+	PlanTopNodes(top, subtreeCount, items.data(), items.data() + items.size(), 0);
+
+	std::vector<std::vector<Node>> subtrees(subtreeCount);
+	std::vector<std::future<void>> builds;
+
+	for (const auto& node : top)
+	{
+		if (node.Subtree != NoSubtree)
+		{
+			auto& subtree = subtrees[node.Subtree];
+			builds.push_back(tasks.Run([&subtree, &node]() { BuildNodes(subtree, node.First, node.Last, node.Depth); }));
+		}
+	}
+
+	for (auto& build : builds)
+	{
+		build.get();
+	}
+
+	// Stitch the top nodes and the subtrees together in depth first order.
+	std::vector<size_t> topNodeIndices(top.size());
+
+	for (size_t i = 0; i != top.size(); ++i)
+	{
+		topNodeIndices[i] = nodes_.size();
+
+		if (top[i].Subtree == NoSubtree)
+		{
+			nodes_.push_back(MakeNode(top[i].Bounds, 0));
+			continue;
+		}
+
+		const auto offset = static_cast<uint32_t>(nodes_.size());
+
+		for (auto node : subtrees[top[i].Subtree])
+		{
+			node.Child += (node.Child & LeafBit) != 0 ? 0 : offset;
+			nodes_.push_back(node);
+		}
+	}
+
+	for (size_t i = 0; i != top.size(); ++i)
+	{
+		if (top[i].Subtree == NoSubtree)
+		{
+			nodes_[topNodeIndices[i]].Child = static_cast<uint32_t>(topNodeIndices[top[i].Second]);
+		}
+	}
+
+	// The children always come after their parent.
+	std::vector<uint32_t> depths(nodes_.size());
+	std::vector<uint32_t> branches(nodes_.size());
+	parents_.assign(nodes_.size(), 0);
+
+	for (uint32_t i = 0; i != nodes_.size(); ++i)
+	{
+		const auto child = nodes_[i].Child;
+
+		if ((child & LeafBit) != 0)
+		{
+			leaves_[child & ~LeafBit] = i;
+			branches_[child & ~LeafBit] = branches[i];
+			continue;
+		}
+
+		for (const uint32_t next : { i + 1, child })
+		{
+			parents_[next] = i;
+			depths[next] = depths[i] + 1;
+			branches[next] = branches[i] | (next == child ? 1u << depths[i] : 0u);
+		}
+	}
+}
+
+std::vector<uint32_t> LightTree::Refit(const std::vector<Triangle>& triangles, const std::vector<uint32_t>& lights)
+{
+	std::vector<uint32_t> nodes;
+
+	for (const auto light : lights)
+	{
+		auto node = leaves_[light];
+		nodes_[node] = MakeNode(BoundsOf(triangles[light]), LeafBit | light);
+		nodes.push_back(node);
+
+		while (node != 0)
+		{
+			node = parents_[node];
+			nodes.push_back(node);
+		}
+	}
+
+	// The children before their parents, i.e. from the last node up.
+	std::sort(nodes.begin(), nodes.end(), std::greater<uint32_t>());
+	nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+	for (const auto node : nodes)
+	{
+		if ((nodes_[node].Child & LeafBit) == 0)
+		{
+			auto bounds = BoundsOf(nodes_[node + 1]);
+			bounds.Add(BoundsOf(nodes_[nodes_[node].Child]));
+			nodes_[node] = MakeNode(bounds, nodes_[node].Child);
+		}
+	}
+
+	std::reverse(nodes.begin(), nodes.end());
+
+	return nodes;
+}
+
+}
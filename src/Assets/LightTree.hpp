@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Utilities/Glm.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Utilities
+{
+	class TaskSystem;
+}
+
+namespace Assets
+{
+	// A bounding volume hierarchy over the light list, importance sampled from the shading points (see LightSelection.glsl).
+	// Every node bounds the positions, the power and the normals of its lights, the leaves being single lights. The light triangles
+	// are two-sided, so the normal cones hold the normals up to their sign. The nodes are in depth first order: an internal node
+	// is followed by its first child and holds the index of the second one.
+	class LightTree final
+	{
+	public:
+
+		// Matches the LightNode struct in Light.glsl.
+		struct Node final
+		{
+			glm::vec4 BoundsMinAndPower;
+			glm::vec4 BoundsMaxAndCosine; // xyz + w (cosine of the half angle of the normal cone)
+			glm::vec3 Axis;
+			uint32_t Child; // The second child, or LeafBit | the light index.
+		};
+
+		// An emissive triangle of the light list in world space, its power being the luminance of its emission times its area.
+		struct Triangle final
+		{
+			glm::vec3 P0;
+			glm::vec3 P1;
+			glm::vec3 P2;
+			float Power;
+		};
+
+		static constexpr uint32_t LeafBit = 0x80000000u;
+		static constexpr uint32_t MaxDepth = 32; // The branches from the root to every light fit in 32 bits.
+
+		// The subtrees of the top levels are built in parallel. Without lights, the tree is a single empty leaf.
+		void Build(const std::vector<Triangle>& triangles, Utilities::TaskSystem& tasks);
+
+		// Moves the leaves of the given lights and refits their ancestors, the topology is kept.
+		// Returns the nodes that changed, in increasing order.
+		std::vector<uint32_t> Refit(const std::vector<Triangle>& triangles, const std::vector<uint32_t>& lights);
+
+		const std::vector<Node>& Nodes() const { return nodes_; }
+
+		// Bit i is set when the path from the root to the leaf of the light takes the second child at depth i.
+		uint32_t Branches(const uint32_t light) const { return branches_[light]; }
+
+	private:
+
+		std::vector<Node> nodes_;
+		std::vector<uint32_t> parents_;
+		std::vector<uint32_t> leaves_; // The node of every light.
+		std::vector<uint32_t> branches_;
+	};
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Utilities/Glm.hpp"
+#include <glm/gtc/packing.hpp>
+#include <cstdint>
 
 namespace Assets
 {
@@ -9,27 +11,28 @@ namespace Assets
 	{
 		static Material Lambertian(const glm::vec3& diffuse, const int32_t textureId = -1)
 		{
-			return Material{ glm::vec4(diffuse, 1), textureId, 0.0f, 0.0f, Enum::Lambertian };
+			return Material{ glm::vec4(diffuse, 1), textureId, 0.0f, 0.0f, Enum::Lambertian, 0.0f, 0.0f };
 		}
 
 		static Material Metallic(const glm::vec3& diffuse, const float fuzziness, const int32_t textureId = -1)
 		{
-			return Material{ glm::vec4(diffuse, 1), textureId, fuzziness, 0.0f, Enum::Metallic };
+			return Material{ glm::vec4(diffuse, 1), textureId, fuzziness, 0.0f, Enum::Metallic, 0.0f, 0.0f };
 		}
 
 		static Material Dielectric(const float refractionIndex, const int32_t textureId = -1)
 		{
-			return Material{ glm::vec4(0.7f, 0.7f, 1.0f, 1), textureId,  0.0f, refractionIndex, Enum::Dielectric };
+			return Material{ glm::vec4(0.7f, 0.7f, 1.0f, 1), textureId,  0.0f, refractionIndex, Enum::Dielectric, 0.0f, 0.0f };
 		}
 
-		static Material Isotropic(const glm::vec3& diffuse, const int32_t textureId = -1)
+		// A participating medium filling its model (see Scene::MediumCount()), the diffuse colour being its single scattering albedo.
+		static Material Isotropic(const glm::vec3& diffuse, const float density = 1.0f, const int32_t textureId = -1)
 		{
-			return Material{ glm::vec4(diffuse, 1), textureId, 0.0f, 0.0f, Enum::Isotropic };
+			return Material{ glm::vec4(diffuse, 1), textureId, 0.0f, 0.0f, Enum::Isotropic, 0.0f, density };
 		}
 
 		static Material DiffuseLight(const glm::vec3& diffuse, const int32_t textureId = -1)
 		{
-			return Material{ glm::vec4(diffuse, 1), textureId, 0.0f, 0.0f, Enum::DiffuseLight };
+			return Material{ glm::vec4(diffuse, 1), textureId, 0.0f, 0.0f, Enum::DiffuseLight, 0.0f, 0.0f };
 		}
 
 		enum class Enum : uint32_t
@@ -55,6 +58,39 @@ namespace Assets
 
 		// Which material are we dealing with
 		Enum MaterialModel;
+
+		// Alpha tested when positive, the surface is cut out where the diffuse alpha (times the texture one) is below it.
+		float AlphaCutoff;
+
+		// Isotropic medium extinction per world unit, scaled by the density grid of its model if it has one (see DensityGrid).
+		float Density;
+	};
+
+	// The 16 bytes device side encoding of --compact-materials (see UnpackMaterial() in Material.glsl), a single load rather than two:
+	// the half diffuse color, the texture id + 1 and the model in the low 28 and high 4 bits, and the half model parameter and alpha cutoff.
+	// The parameter is the fuzziness of the metals, the refraction index of the dielectrics and the density of the isotropic media.
+	struct CompactMaterial final
+	{
+		uint32_t DiffuseRG;
+		uint32_t DiffuseBA;
+		uint32_t TextureIdAndModel;
+		uint32_t ParameterAndAlphaCutoff;
+
+		static CompactMaterial Pack(const Material& material)
+		{
+			const float parameter =
+				material.MaterialModel == Material::Enum::Dielectric ? material.RefractionIndex :
+				material.MaterialModel == Material::Enum::Isotropic ? material.Density :
+				material.Fuzziness;
+
+			return CompactMaterial
+			{
+				glm::packHalf2x16(glm::vec2(material.Diffuse.r, material.Diffuse.g)),
+				glm::packHalf2x16(glm::vec2(material.Diffuse.b, material.Diffuse.a)),
+				(static_cast<uint32_t>(material.DiffuseTextureId + 1) & 0x0fffffff) | (static_cast<uint32_t>(material.MaterialModel) << 28),
+				glm::packHalf2x16(glm::vec2(parameter, material.AlphaCutoff))
+			};
+		}
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "MaterialRegistry.hpp"
+#include <functional>
+
+namespace Assets {
+
+namespace
+{
+	void Combine(size_t& seed, const size_t hash)
+	{
+		seed ^= hash + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+
+	// Adding zero turns -0 into 0, which compare equal.
+	size_t HashFloat(const float value)
+	{
+		return std::hash<float>()(value + 0.0f);
+	}
+}
+
+int32_t MaterialRegistry::Add(const Material& material)
+{
+	++addedCount_;
+
+	const auto [entry, isAdded] = indices_.emplace(material, static_cast<int32_t>(materials_.size()));
+
+	if (isAdded)
+	{
+		materials_.push_back(material);
+	}
+
+	return entry->second;
+}
+
+// The struct has padding, the fields are compared one by one rather than the bytes.
+size_t MaterialRegistry::Hash::operator () (const Material& material) const
+{
+	size_t seed = 0;
+
+	for (int i = 0; i != 4; ++i)
+	{
+		Combine(seed, HashFloat(material.Diffuse[i]));
+	}
+
+	Combine(seed, std::hash<int32_t>()(material.DiffuseTextureId));
+	Combine(seed, HashFloat(material.Fuzziness));
+	Combine(seed, HashFloat(material.RefractionIndex));
+	Combine(seed, std::hash<uint32_t>()(static_cast<uint32_t>(material.MaterialModel)));
+	Combine(seed, HashFloat(material.AlphaCutoff));
+	Combine(seed, HashFloat(material.Density));
+
+	return seed;
+}
+
+bool MaterialRegistry::Equal::operator () (const Material& a, const Material& b) const
+{
+	return
+		a.Diffuse == b.Diffuse &&
+		a.DiffuseTextureId == b.DiffuseTextureId &&
+		a.Fuzziness == b.Fuzziness &&
+		a.RefractionIndex == b.RefractionIndex &&
+		a.MaterialModel == b.MaterialModel &&
+		a.AlphaCutoff == b.AlphaCutoff &&
+		a.Density == b.Density;
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Material.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Assets
+{
+	// The materials of a scene, each distinct value stored once. The models and instance overrides get shared indices into it,
+	// e.g. the 480 spheres of the one weekend scenes only use a handful of different materials.
+	class MaterialRegistry final
+	{
+	public:
+
+		// The index of the material, added unless an equal one is already there.
+		int32_t Add(const Material& material);
+
+		const std::vector<Material>& Materials() const { return materials_; }
+		size_t AddedCount() const { return addedCount_; } // Including the duplicates.
+
+	private:
+
+		struct Hash final
+		{
+			size_t operator () (const Material& material) const;
+		};
+
+		struct Equal final
+		{
+			bool operator () (const Material& a, const Material& b) const;
+		};
+
+		std::vector<Material> materials_;
+		std::unordered_map<Material, int32_t, Hash, Equal> indices_;
+		size_t addedCount_{};
+	};
+}
@@ -0,0 +1,252 @@
+#include "MeshCache.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/MappedFile.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+namespace Assets {
+
+namespace
+{
+	const char Magic[8] = { 'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0' };
+	const uint32_t Version = 7;
+
+	// FNV-1a on 64-bit words, the source files are large and only need telling apart.
+	uint64_t HashFile(const Utilities::MappedFile& file)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		const size_t wordCount = file.Size() / sizeof(uint64_t);
+
+		for (size_t i = 0; i != wordCount; ++i)
+		{
+			uint64_t word;
+			std::memcpy(&word, file.Data() + i * sizeof(uint64_t), sizeof(word));
+			hash = (hash ^ word) * 1099511628211ull;
+		}
+
+		for (size_t i = wordCount * sizeof(uint64_t); i != file.Size(); ++i)
+		{
+			hash = (hash ^ file.Data()[i]) * 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	uint64_t HashCombine(const uint64_t hash, const uint64_t value)
+	{
+		return (hash ^ value) * 1099511628211ull;
+	}
+
+	// The size, modification time and content of every material library the OBJ file names, in order.
+	// A missing library still counts, creating it invalidates the entry.
+	uint64_t HashMaterialLibraries(const std::string& filename, const Utilities::MappedFile& source)
+	{
+		const auto directory = std::filesystem::path(filename).parent_path();
+		const auto* const text = reinterpret_cast<const char*>(source.Data());
+		const auto* const end = text + source.Size();
+		uint64_t hash = 14695981039346656037ull;
+
+		for (const char* line = text; line < end; )
+		{
+			const char* lineEnd = std::find(line, end, '\n');
+			const char* word = line;
+
+			while (word != lineEnd && (*word == ' ' || *word == '\t')) ++word;
+
+			if (lineEnd - word > 7 && std::strncmp(word, "mtllib", 6) == 0 && (word[6] == ' ' || word[6] == '\t'))
+			{
+				std::istringstream libraries(std::string(word + 7, lineEnd));
+
+				for (std::string library; libraries >> library; )
+				{
+					const auto path = (directory / library).string();
+					const Utilities::MappedFile file(path);
+
+					std::error_code error;
+					const auto time = std::filesystem::last_write_time(path, error);
+
+					hash = HashCombine(hash, std::hash<std::string>()(library));
+					hash = HashCombine(hash, file.Size());
+					hash = HashCombine(hash, error ? 0 : static_cast<uint64_t>(time.time_since_epoch().count()));
+					hash = HashCombine(hash, file.IsMapped() ? HashFile(file) : 0);
+				}
+			}
+
+			line = lineEnd + 1;
+		}
+
+		return hash;
+	}
+}
+
+MeshCache::MeshCache(const std::string& filename) :
+	path_(filename + ".rtmesh")
+{
+	const Utilities::MappedFile source(filename);
+
+	std::error_code error;
+	const auto time = std::filesystem::last_write_time(filename, error);
+
+	sourceSize_ = source.Size();
+	sourceTime_ = error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+	sourceHash_ = source.IsMapped() ? HashFile(source) : 0;
+	materialHash_ = source.IsMapped() ? HashMaterialLibraries(filename, source) : 0;
+}
+
+bool MeshCache::Load(Mesh& mesh) const
+{
+	const Utilities::MappedFile file(path_);
+
+	if (!file.IsMapped() || file.Size() < sizeof(Header))
+	{
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, file.Data(), sizeof(Header));
+
+	const auto expected = ExpectedHeader();
+
+	if (std::memcmp(header.Magic, expected.Magic, sizeof(Magic)) != 0 ||
+		header.Version != expected.Version ||
+		header.VertexSize != expected.VertexSize ||
+		header.MaterialSize != expected.MaterialSize ||
+		header.SourceSize != expected.SourceSize ||
+		header.SourceTime != expected.SourceTime ||
+		header.SourceHash != expected.SourceHash ||
+		header.MaterialHash != expected.MaterialHash)
+	{
+		return false;
+	}
+
+	const size_t verticesSize = header.VertexCount * sizeof(Vertex);
+	const size_t indicesSize = header.IndexCount * sizeof(uint32_t);
+	const size_t materialsSize = header.MaterialCount * sizeof(Material);
+
+	const size_t lodCountsSize = header.LevelOfDetailCount * sizeof(uint64_t);
+
+	if (file.Size() < sizeof(Header) + verticesSize + indicesSize + materialsSize + lodCountsSize)
+	{
+		return false;
+	}
+
+	const uint8_t* data = file.Data() + sizeof(Header);
+	std::vector<uint64_t> lodCounts(header.LevelOfDetailCount);
+	size_t lodIndicesSize = 0;
+
+	std::memcpy(lodCounts.data(), data + verticesSize + indicesSize + materialsSize, lodCountsSize);
+
+	for (const auto count : lodCounts)
+	{
+		lodIndicesSize += count * sizeof(uint32_t);
+	}
+
+	if (file.Size() != sizeof(Header) + verticesSize + indicesSize + materialsSize + lodCountsSize + lodIndicesSize)
+	{
+		return false;
+	}
+
+	mesh.Vertices.resize(header.VertexCount);
+	mesh.Indices.resize(header.IndexCount);
+	mesh.Materials.resize(header.MaterialCount);
+	mesh.SourceVertexCount = header.SourceVertexCount;
+	mesh.CacheMissRatioBefore = header.CacheMissRatioBefore;
+	mesh.CacheMissRatioAfter = header.CacheMissRatioAfter;
+	mesh.HasNormals = header.HasNormals != 0;
+
+	std::memcpy(mesh.Vertices.data(), data, verticesSize);
+	std::memcpy(mesh.Indices.data(), data + verticesSize, indicesSize);
+	std::memcpy(mesh.Materials.data(), data + verticesSize + indicesSize, materialsSize);
+
+	const uint8_t* lodData = data + verticesSize + indicesSize + materialsSize + lodCountsSize;
+	mesh.LevelsOfDetail.resize(lodCounts.size());
+
+	for (size_t i = 0; i != lodCounts.size(); ++i)
+	{
+		mesh.LevelsOfDetail[i].resize(lodCounts[i]);
+		std::memcpy(mesh.LevelsOfDetail[i].data(), lodData, lodCounts[i] * sizeof(uint32_t));
+		lodData += lodCounts[i] * sizeof(uint32_t);
+	}
+
+	return true;
+}
+
+void MeshCache::Store(const Mesh& mesh) const
+{
+	auto header = ExpectedHeader();
+	header.SourceVertexCount = mesh.SourceVertexCount;
+	header.CacheMissRatioBefore = mesh.CacheMissRatioBefore;
+	header.CacheMissRatioAfter = mesh.CacheMissRatioAfter;
+	header.HasNormals = mesh.HasNormals ? 1 : 0;
+	header.VertexCount = mesh.Vertices.size();
+	header.IndexCount = mesh.Indices.size();
+	header.MaterialCount = mesh.Materials.size();
+	header.LevelOfDetailCount = static_cast<uint32_t>(mesh.LevelsOfDetail.size());
+
+	// Write to a temporary file first, so that an interrupted run never leaves a truncated entry behind.
+	const std::string tempPath = path_ + ".tmp";
+
+	bool isWritten;
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(mesh.Vertices.data()), mesh.Vertices.size() * sizeof(Vertex));
+		file.write(reinterpret_cast<const char*>(mesh.Indices.data()), mesh.Indices.size() * sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(mesh.Materials.data()), mesh.Materials.size() * sizeof(Material));
+
+		for (const auto& lod : mesh.LevelsOfDetail)
+		{
+			const uint64_t count = lod.size();
+			file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+		}
+
+		for (const auto& lod : mesh.LevelsOfDetail)
+		{
+			file.write(reinterpret_cast<const char*>(lod.data()), lod.size() * sizeof(uint32_t));
+		}
+
+		isWritten = static_cast<bool>(file);
+	}
+
+	// A read-only asset directory is not an error, the model just gets parsed every time.
+	std::error_code error;
+
+	if (!isWritten)
+	{
+		std::filesystem::remove(tempPath, error);
+
+		Utilities::Console::Write(Utilities::Severity::Warning, [this]()
+		{
+			std::cerr << "WARNING: failed to write mesh cache '" + path_ + "'" << std::endl;
+		});
+
+		return;
+	}
+
+	std::filesystem::rename(tempPath, path_, error);
+}
+
+MeshCache::Header MeshCache::ExpectedHeader() const
+{
+	Header header = {};
+
+	std::memcpy(header.Magic, Magic, sizeof(Magic));
+	header.Version = Version;
+	header.VertexSize = sizeof(Vertex);
+	header.MaterialSize = sizeof(Material);
+	header.SourceSize = sourceSize_;
+	header.SourceTime = sourceTime_;
+	header.SourceHash = sourceHash_;
+	header.MaterialHash = materialHash_;
+
+	return header;
+}
+
+}
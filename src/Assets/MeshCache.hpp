@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Material.hpp"
+#include "Vertex.hpp"
+#include "Vulkan/Vulkan.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Assets
+{
+	// Binary cache of the final (deduplicated, with normals unless left to the GPU, reordered by MeshOptimizer, with its simplified levels of detail) OBJ geometry, stored next to the source as <file>.rtmesh.
+	// Entries are validated against the source file size, modification time and content hash, and the same of its material libraries (mtllib).
+	class MeshCache final
+	{
+	public:
+
+		struct Mesh final
+		{
+			std::vector<Vertex> Vertices;
+			std::vector<uint32_t> Indices;
+			std::vector<Material> Materials;
+			uint64_t SourceVertexCount{}; // As reported by the OBJ loader, only used for logging.
+			float CacheMissRatioBefore{}; // The ACMR before and after the mesh optimization, only used for logging.
+			float CacheMissRatioAfter{};
+			std::vector<std::vector<uint32_t>> LevelsOfDetail; // Simplified index lists over the same vertices, coarser each (see Model::LevelsOfDetail()).
+			bool HasNormals{}; // False when they were left to the GPU, the vertex normals are then zero (see Model::NeedsNormals()).
+		};
+
+		VULKAN_NON_COPIABLE(MeshCache)
+
+		explicit MeshCache(const std::string& filename);
+		~MeshCache() = default;
+
+		// Returns false if the entry is missing or stale.
+		bool Load(Mesh& mesh) const;
+		void Store(const Mesh& mesh) const;
+
+	private:
+
+		struct Header final
+		{
+			char Magic[8];
+			uint32_t Version;
+			uint32_t VertexSize;
+			uint32_t MaterialSize;
+			float CacheMissRatioBefore;
+			float CacheMissRatioAfter;
+			uint32_t LevelOfDetailCount;
+			uint32_t HasNormals;
+			uint64_t SourceSize;
+			int64_t SourceTime;
+			uint64_t SourceHash;
+			uint64_t MaterialHash;
+			uint64_t SourceVertexCount;
+			uint64_t VertexCount;
+			uint64_t IndexCount;
+			uint64_t MaterialCount;
+		};
+
+		Header ExpectedHeader() const;
+
+		const std::string path_;
+		uint64_t sourceSize_{};
+		int64_t sourceTime_{};
+		uint64_t sourceHash_{};
+		uint64_t materialHash_{};
+	};
+
+}
@@ -0,0 +1,359 @@
+#include "MeshOptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace Assets {
+
+namespace
+{
+	constexpr uint32_t NoTriangle = std::numeric_limits<uint32_t>::max();
+
+	// The vertex score from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation": vertices of the last triangle
+	// score a fixed amount, the others decay with their cache position, and vertices with few triangles left get a boost.
+	float VertexScore(const int32_t cachePosition, const uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+
+		if (cachePosition >= 0)
+		{
+			score = cachePosition < 3
+				? 0.75f
+				: std::pow(1.0f - float(cachePosition - 3) / float(MeshOptimizer::CacheSize - 3), 1.5f);
+		}
+
+		return score + 2.0f / std::sqrt(float(remainingTriangles));
+	}
+
+	// The grid cell of every vertex, the material in the upper half so that materials never merge.
+	void ComputeCells(const std::vector<Vertex>& vertices, const glm::vec3& origin, const float scale, const uint32_t gridSize, std::vector<uint64_t>& cells)
+	{
+		for (size_t v = 0; v != vertices.size(); ++v)
+		{
+			const auto cell = glm::clamp(glm::ivec3((vertices[v].Position - origin) * scale * float(gridSize)), glm::ivec3(0), glm::ivec3(gridSize - 1));
+			const auto index = (static_cast<uint64_t>(cell.x) * gridSize + cell.y) * gridSize + cell.z;
+
+			cells[v] = index | (static_cast<uint64_t>(static_cast<uint32_t>(vertices[v].MaterialIndex)) << 32);
+		}
+	}
+
+	size_t CountClusteredIndices(const std::vector<uint32_t>& indices, const std::vector<uint64_t>& cells)
+	{
+		size_t count = 0;
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const auto c0 = cells[indices[i + 0]];
+			const auto c1 = cells[indices[i + 1]];
+			const auto c2 = cells[indices[i + 2]];
+
+			count += c0 != c1 && c1 != c2 && c0 != c2 ? 3 : 0;
+		}
+
+		return count;
+	}
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, const size_t vertexCount)
+{
+	const auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// The triangles using each vertex.
+	std::vector<uint32_t> remaining(vertexCount);
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+
+	for (uint32_t i = 0; i != triangleCount * 3; ++i)
+	{
+		++remaining[indices[i]];
+	}
+
+	for (size_t v = 0; v != vertexCount; ++v)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+	}
+
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+		for (uint32_t i = 0; i != triangleCount * 3; ++i)
+		{
+			adjacency[fill[indices[i]]++] = i / 3;
+		}
+	}
+
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount);
+
+	for (size_t v = 0; v != vertexCount; ++v)
+	{
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+	}
+
+	for (uint32_t t = 0; t != triangleCount; ++t)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+	}
+
+	std::vector<uint32_t> optimized;
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	uint32_t nextUnemitted = 0;
+
+	optimized.reserve(indices.size());
+	cache.reserve(CacheSize + 3);
+	nextCache.reserve(CacheSize + 3);
+
+	while (optimized.size() != indices.size())
+	{
+		// The best triangle around the cached vertices, or the next one in the original order when none is left.
+		uint32_t best = NoTriangle;
+		float bestScore = -1.0f;
+
+		for (const auto v : cache)
+		{
+			for (uint32_t a = adjacencyOffsets[v]; a != adjacencyOffsets[v + 1]; ++a)
+			{
+				const auto t = adjacency[a];
+
+				if (!emitted[t] && triangleScores[t] > bestScore)
+				{
+					best = t;
+					bestScore = triangleScores[t];
+				}
+			}
+		}
+
+		if (best == NoTriangle)
+		{
+			while (emitted[nextUnemitted])
+			{
+				++nextUnemitted;
+			}
+
+			best = nextUnemitted;
+		}
+
+		// Emit it and push its vertices to the front of the cache.
+		emitted[best] = true;
+		nextCache.clear();
+
+		for (uint32_t i = 0; i != 3; ++i)
+		{
+			const auto v = indices[best * 3 + i];
+
+			optimized.push_back(v);
+			--remaining[v];
+
+			if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+			{
+				nextCache.push_back(v);
+			}
+		}
+
+		for (const auto v : cache)
+		{
+			if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+			{
+				nextCache.push_back(v);
+			}
+		}
+
+		// Update the scores of the vertices whose position changed, including the ones falling out of the cache.
+		for (size_t i = 0; i != nextCache.size(); ++i)
+		{
+			const auto v = nextCache[i];
+			cachePositions[v] = i < CacheSize ? static_cast<int32_t>(i) : -1;
+			vertexScores[v] = VertexScore(cachePositions[v], remaining[v]);
+		}
+
+		for (const auto v : nextCache)
+		{
+			for (uint32_t a = adjacencyOffsets[v]; a != adjacencyOffsets[v + 1]; ++a)
+			{
+				const auto t = adjacency[a];
+
+				if (!emitted[t])
+				{
+					triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				}
+			}
+		}
+
+		if (nextCache.size() > CacheSize)
+		{
+			nextCache.resize(CacheSize);
+		}
+
+		cache.swap(nextCache);
+	}
+
+	indices.swap(optimized);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	// Number the vertices in the order the index buffer first uses them, unused ones go last.
+	constexpr uint32_t Unused = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> remap(vertices.size(), Unused);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+
+	for (auto& index : indices)
+	{
+		if (remap[index] == Unused)
+		{
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	for (size_t v = 0; v != vertices.size(); ++v)
+	{
+		if (remap[v] == Unused)
+		{
+			reordered.push_back(vertices[v]);
+		}
+	}
+
+	vertices.swap(reordered);
+}
+
+std::vector<uint32_t> MeshOptimizer::SimplifySloppy(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const size_t targetIndexCount)
+{
+	if (vertices.empty() || indices.size() <= targetIndexCount)
+	{
+		return indices;
+	}
+
+	glm::vec3 minimum = vertices[0].Position;
+	glm::vec3 maximum = vertices[0].Position;
+
+	for (const auto& vertex : vertices)
+	{
+		minimum = glm::min(minimum, vertex.Position);
+		maximum = glm::max(maximum, vertex.Position);
+	}
+
+	const auto extent = maximum - minimum;
+	const float scale = 1.0f / std::max(std::max(extent.x, std::max(extent.y, extent.z)), std::numeric_limits<float>::min());
+
+	// Binary search of the finest grid under the target, the index count grows with the grid size.
+	std::vector<uint64_t> cells(vertices.size());
+	uint32_t low = 1;
+	uint32_t high = 1024;
+
+	while (low + 1 < high)
+	{
+		const auto middle = (low + high) / 2;
+
+		ComputeCells(vertices, minimum, scale, middle, cells);
+
+		if (CountClusteredIndices(indices, cells) <= targetIndexCount)
+		{
+			low = middle;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	ComputeCells(vertices, minimum, scale, low, cells);
+
+	// The centroid of every cell, then its closest vertex.
+	std::unordered_map<uint64_t, uint32_t> cellSlots;
+	std::vector<glm::vec4> centroids;
+	std::vector<uint32_t> slots(vertices.size());
+
+	for (size_t v = 0; v != vertices.size(); ++v)
+	{
+		const auto [slot, isNew] = cellSlots.emplace(cells[v], static_cast<uint32_t>(centroids.size()));
+
+		if (isNew)
+		{
+			centroids.emplace_back(0);
+		}
+
+		slots[v] = slot->second;
+		centroids[slot->second] += glm::vec4(vertices[v].Position, 1);
+	}
+
+	std::vector<uint32_t> representatives(centroids.size(), std::numeric_limits<uint32_t>::max());
+	std::vector<float> distances(centroids.size(), std::numeric_limits<float>::max());
+
+	for (size_t v = 0; v != vertices.size(); ++v)
+	{
+		const auto slot = slots[v];
+		const auto centroid = glm::vec3(centroids[slot]) / centroids[slot].w;
+		const auto delta = vertices[v].Position - centroid;
+		const auto distance = glm::dot(delta, delta);
+
+		if (distance < distances[slot])
+		{
+			distances[slot] = distance;
+			representatives[slot] = static_cast<uint32_t>(v);
+		}
+	}
+
+	// Only the triangles spanning three cells survive.
+	std::vector<uint32_t> simplified;
+	simplified.reserve(CountClusteredIndices(indices, cells));
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const auto s0 = slots[indices[i + 0]];
+		const auto s1 = slots[indices[i + 1]];
+		const auto s2 = slots[indices[i + 2]];
+
+		if (s0 != s1 && s1 != s2 && s0 != s2)
+		{
+			simplified.push_back(representatives[s0]);
+			simplified.push_back(representatives[s1]);
+			simplified.push_back(representatives[s2]);
+		}
+	}
+
+	return simplified;
+}
+
+float MeshOptimizer::AverageCacheMissRatio(const std::vector<uint32_t>& indices, const size_t vertexCount)
+{
+	if (indices.size() < 3)
+	{
+		return 0.0f;
+	}
+
+	// A FIFO cache, each vertex remembers when it last entered it.
+	std::vector<size_t> timestamps(vertexCount, 0);
+	size_t time = CacheSize + 1;
+	size_t misses = 0;
+
+	for (const auto index : indices)
+	{
+		if (time - timestamps[index] > CacheSize)
+		{
+			timestamps[index] = time++;
+			++misses;
+		}
+	}
+
+	return float(misses) / float(indices.size() / 3);
+}
+
+}
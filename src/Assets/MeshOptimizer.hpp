@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Vertex.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Assets
+{
+
+	// Reorders the triangles of an indexed mesh for the post-transform vertex cache (Forsyth's linear-speed algorithm),
+	// then the vertices in the order they are first referenced so that the index fetches walk the vertex buffer.
+	class MeshOptimizer final
+	{
+	public:
+
+		// The number of entries of the simulated vertex cache.
+		static constexpr uint32_t CacheSize = 32;
+
+		static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+		static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+		// Simplifies a mesh by vertex clustering on a uniform grid, in the spirit of meshoptimizer's meshopt_simplifySloppy().
+		// The grid is the finest one keeping at most the target number of indices, each cell collapses to its vertex closest to the cell centroid.
+		// Vertices of different materials never share a cell. The returned indices reference the original vertices.
+		static std::vector<uint32_t> SimplifySloppy(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount);
+
+		// Average number of vertices transformed per triangle through a FIFO cache, between 0.5 and 3 (lower is better).
+		static float AverageCacheMissRatio(const std::vector<uint32_t>& indices, size_t vertexCount);
+	};
+
+}
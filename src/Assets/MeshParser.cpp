@@ -0,0 +1,983 @@
+#include "MeshParser.hpp"
+#include "Utilities/Exception.hpp"
+#include "Utilities/MappedFile.hpp"
+#include "Utilities/ParallelFor.hpp"
+
+#include <tiny_obj_loader.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string_view>
+#include <thread>
+
+using namespace glm;
+using Utilities::ParallelFor;
+
+namespace
+{
+	using Assets::Vertex;
+
+	// Smaller chunks are not worth a thread.
+	constexpr size_t MinChunkSize = 1 << 20;
+
+	// The OBJ attribute indices of a face corner, equal keys always produce equal vertices.
+	struct VertexKey final
+	{
+		int32_t Vertex;
+		int32_t Normal;
+		int32_t TexCoord;
+		int32_t Material;
+
+		bool operator == (const VertexKey& other) const
+		{
+			return Vertex == other.Vertex && Normal == other.Normal && TexCoord == other.TexCoord && Material == other.Material;
+		}
+	};
+
+	// Open addressing (linear probing) map from keys to vertex indices, a lookup and an insertion share a single probe.
+	class VertexKeyMap final
+	{
+	public:
+
+		explicit VertexKeyMap(const size_t expectedSize)
+		{
+			size_t capacity = 16;
+
+			while (capacity < 2 * expectedSize)
+			{
+				capacity *= 2;
+			}
+
+			Allocate(capacity);
+		}
+
+		// Returns the index already mapped to the key, or maps it to the given one.
+		std::pair<uint32_t, bool> Insert(const VertexKey& key, const uint32_t index)
+		{
+			// Keep the load factor under one half, the probe sequences stay short.
+			if (2 * (size_ + 1) > entries_.size())
+			{
+				Grow();
+			}
+
+			for (size_t slot = Hash(key) & mask_; ; slot = (slot + 1) & mask_)
+			{
+				auto& entry = entries_[slot];
+
+				if (entry.Key.Vertex < 0)
+				{
+					entry = Entry{ key, index };
+					++size_;
+					return { index, true };
+				}
+
+				if (entry.Key == key)
+				{
+					return { entry.Index, false };
+				}
+			}
+		}
+
+	private:
+
+		struct Entry final
+		{
+			VertexKey Key;
+			uint32_t Index;
+		};
+
+		void Allocate(const size_t capacity)
+		{
+			entries_.assign(capacity, Entry{ { -1, -1, -1, -1 }, 0 });
+			mask_ = capacity - 1;
+			size_ = 0;
+		}
+
+		void Grow()
+		{
+			const auto entries = std::move(entries_);
+
+			Allocate(2 * entries.size());
+
+			for (const auto& entry : entries)
+			{
+				if (entry.Key.Vertex >= 0)
+				{
+					Insert(entry.Key, entry.Index);
+				}
+			}
+		}
+
+		static size_t Hash(const VertexKey& key)
+		{
+			uint64_t hash = (static_cast<uint64_t>(static_cast<uint32_t>(key.Vertex)) << 32) | static_cast<uint32_t>(key.Normal);
+			hash ^= ((static_cast<uint64_t>(static_cast<uint32_t>(key.TexCoord)) << 32) | static_cast<uint32_t>(key.Material)) * 0x9e3779b97f4a7c15ull;
+			hash *= 0xff51afd7ed558ccdull;
+			return static_cast<size_t>(hash ^ (hash >> 32));
+		}
+
+		std::vector<Entry> entries_;
+		size_t mask_{};
+		size_t size_{};
+	};
+
+	[[noreturn]] void Fail(const std::string& filename, const std::string& message)
+	{
+		Throw(std::runtime_error("failed to load model '" + filename + "': " + message));
+	}
+
+	// Splits [begin, end) into ranges of whole lines, a few per hardware thread.
+	std::vector<std::string_view> SplitLines(const char* const begin, const char* const end)
+	{
+		const size_t size = static_cast<size_t>(end - begin);
+		const size_t count = std::clamp<size_t>(size / MinChunkSize, 1, 4 * std::max(1u, std::thread::hardware_concurrency()));
+		std::vector<std::string_view> chunks;
+
+		for (const char* first = begin; first != end; )
+		{
+			const char* last = std::max(first, begin + size * (chunks.size() + 1) / count);
+			last = std::find(last, end, '\n');
+			last = last == end ? end : last + 1;
+
+			chunks.emplace_back(first, static_cast<size_t>(last - first));
+			first = last;
+		}
+
+		return chunks;
+	}
+
+	template <class Function>
+	void ForEachLine(const std::string_view text, const Function& function)
+	{
+		for (size_t begin = 0; begin < text.size(); )
+		{
+			const size_t end = std::min(text.find('\n', begin), text.size());
+			function(text.substr(begin, end - begin));
+			begin = end + 1;
+		}
+	}
+
+	bool IsSpace(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	// Removes the next whitespace separated word from the line, empty at its end.
+	std::string_view NextWord(std::string_view& line)
+	{
+		size_t begin = 0;
+
+		while (begin != line.size() && IsSpace(line[begin]))
+		{
+			++begin;
+		}
+
+		size_t end = begin;
+
+		while (end != line.size() && !IsSpace(line[end]))
+		{
+			++end;
+		}
+
+		const auto word = line.substr(begin, end - begin);
+		line.remove_prefix(end);
+		return word;
+	}
+
+	// The mapping is not null terminated, the numbers are parsed with from_chars.
+	float ParseFloat(const std::string& filename, const std::string_view word)
+	{
+		const char* const begin = word.data() + (!word.empty() && word[0] == '+' ? 1 : 0);
+		const char* const end = word.data() + word.size();
+		float value = 0;
+		const auto result = std::from_chars(begin, end, value);
+
+		if (result.ec != std::errc() || result.ptr != end)
+		{
+			Fail(filename, "invalid number '" + std::string(word) + "'");
+		}
+
+		return value;
+	}
+
+	int64_t ParseInteger(const std::string& filename, const std::string_view word)
+	{
+		const char* const begin = word.data() + (!word.empty() && word[0] == '+' ? 1 : 0);
+		const char* const end = word.data() + word.size();
+		int64_t value = 0;
+		const auto result = std::from_chars(begin, end, value);
+
+		if (result.ec != std::errc() || result.ptr != end)
+		{
+			Fail(filename, "invalid index '" + std::string(word) + "'");
+		}
+
+		return value;
+	}
+
+	std::vector<Assets::Material> DefaultMaterials()
+	{
+		Assets::Material m{};
+
+		m.Diffuse = vec4(0.7f, 0.7f, 0.7f, 1.0);
+		m.DiffuseTextureId = -1;
+
+		return { m };
+	}
+
+	// What the first pass over an OBJ chunk finds, and where the second one writes.
+	struct ObjChunk final
+	{
+		std::string_view Text;
+
+		size_t PositionCount{};
+		size_t NormalCount{};
+		size_t TexCoordCount{};
+		size_t TriangleCount{};
+		bool HasMaterial{};
+		std::string_view LastMaterial; // Of the last usemtl, its faces run into the next chunks.
+		std::vector<std::string_view> Libraries;
+
+		size_t FirstPosition{};
+		size_t FirstNormal{};
+		size_t FirstTexCoord{};
+		size_t FirstIndex{};
+		int32_t Material{};
+		std::vector<Vertex> Vertices; // Deduplicated within the chunk, their indices are local until the chunks are concatenated.
+	};
+
+	// Converts a 1-based or relative (negative) OBJ index, given the number of elements defined so far.
+	int32_t ResolveIndex(const std::string& filename, const std::string_view word, const size_t defined, const size_t total)
+	{
+		const int64_t index = ParseInteger(filename, word);
+		const int64_t resolved = index < 0 ? static_cast<int64_t>(defined) + index : index - 1;
+
+		if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(total))
+		{
+			Fail(filename, "face index '" + std::string(word) + "' is out of range");
+		}
+
+		return static_cast<int32_t>(resolved);
+	}
+
+	Assets::MeshParser::Mesh ParseObj(const std::string& filename, const Utilities::MappedFile& file)
+	{
+		Assets::MeshParser::Mesh mesh;
+
+		const auto* const text = reinterpret_cast<const char*>(file.Data());
+		std::vector<ObjChunk> chunks;
+
+		for (const auto range : SplitLines(text, text + file.Size()))
+		{
+			chunks.emplace_back().Text = range;
+		}
+
+		// Count the attributes and triangles of every chunk.
+		ParallelFor(chunks.size(), [&](const size_t i)
+		{
+			auto& chunk = chunks[i];
+
+			ForEachLine(chunk.Text, [&](std::string_view line)
+			{
+				const auto keyword = NextWord(line);
+
+				if (keyword == "v") chunk.PositionCount++;
+				else if (keyword == "vn") chunk.NormalCount++;
+				else if (keyword == "vt") chunk.TexCoordCount++;
+				else if (keyword == "f")
+				{
+					size_t corners = 0;
+
+					while (!NextWord(line).empty())
+					{
+						corners++;
+					}
+
+					chunk.TriangleCount += corners >= 3 ? corners - 2 : 0;
+				}
+				else if (keyword == "usemtl")
+				{
+					chunk.HasMaterial = true;
+					chunk.LastMaterial = NextWord(line);
+				}
+				else if (keyword == "mtllib")
+				{
+					for (auto library = NextWord(line); !library.empty(); library = NextWord(line))
+					{
+						chunk.Libraries.push_back(library);
+					}
+				}
+			});
+		});
+
+		// The materials, the chunks start with the one of the last usemtl before them.
+		std::vector<tinyobj::material_t> objMaterials;
+		std::map<std::string, int> materialIds;
+		const auto directory = std::filesystem::path(filename).parent_path();
+
+		for (const auto& chunk : chunks)
+		{
+			for (const auto library : chunk.Libraries)
+			{
+				std::ifstream stream(directory / std::string(library));
+
+				if (!stream)
+				{
+					mesh.Warning += "material library '" + std::string(library) + "' not found\n";
+					continue;
+				}
+
+				std::string warning, error;
+				tinyobj::LoadMtl(&materialIds, &objMaterials, &stream, &warning, &error);
+				mesh.Warning += warning + error;
+			}
+		}
+
+		size_t positionCount = 0, normalCount = 0, texCoordCount = 0, indexCount = 0;
+		std::string_view material;
+
+		for (auto& chunk : chunks)
+		{
+			const auto id = materialIds.find(std::string(material));
+
+			chunk.FirstPosition = positionCount;
+			chunk.FirstNormal = normalCount;
+			chunk.FirstTexCoord = texCoordCount;
+			chunk.FirstIndex = indexCount;
+			chunk.Material = id != materialIds.end() ? std::max(0, id->second) : 0;
+
+			positionCount += chunk.PositionCount;
+			normalCount += chunk.NormalCount;
+			texCoordCount += chunk.TexCoordCount;
+			indexCount += 3 * chunk.TriangleCount;
+			material = chunk.HasMaterial ? chunk.LastMaterial : material;
+		}
+
+		if (positionCount > static_cast<size_t>(std::numeric_limits<int32_t>::max()) || indexCount > static_cast<size_t>(std::numeric_limits<uint32_t>::max()))
+		{
+			Fail(filename, "too many vertices");
+		}
+
+		// Every chunk writes its attributes at its own offsets.
+		std::vector<vec3> positions(positionCount);
+		std::vector<vec3> normals(normalCount);
+		std::vector<vec2> texCoords(texCoordCount);
+
+		ParallelFor(chunks.size(), [&](const size_t i)
+		{
+			auto& chunk = chunks[i];
+			auto* position = positions.data() + chunk.FirstPosition;
+			auto* normal = normals.data() + chunk.FirstNormal;
+			auto* texCoord = texCoords.data() + chunk.FirstTexCoord;
+
+			ForEachLine(chunk.Text, [&](std::string_view line)
+			{
+				const auto keyword = NextWord(line);
+
+				if (keyword == "v" || keyword == "vn")
+				{
+					const float x = ParseFloat(filename, NextWord(line));
+					const float y = ParseFloat(filename, NextWord(line));
+					const float z = ParseFloat(filename, NextWord(line));
+
+					*(keyword == "v" ? position++ : normal++) = vec3(x, y, z);
+				}
+				else if (keyword == "vt")
+				{
+					const float u = ParseFloat(filename, NextWord(line));
+					const auto v = NextWord(line);
+
+					*texCoord++ = vec2(u, 1 - (v.empty() ? 0 : ParseFloat(filename, v)));
+				}
+			});
+		});
+
+		// Then its faces, the vertices referenced from other chunks are duplicated like those of the OBJ shapes used to be.
+		mesh.Indices.resize(indexCount);
+
+		ParallelFor(chunks.size(), [&](const size_t i)
+		{
+			auto& chunk = chunks[i];
+			auto* index = mesh.Indices.data() + chunk.FirstIndex;
+			size_t definedPositions = chunk.FirstPosition;
+			size_t definedNormals = chunk.FirstNormal;
+			size_t definedTexCoords = chunk.FirstTexCoord;
+			int32_t materialId = chunk.Material;
+
+			// Closed meshes have about one unique vertex for every six face corners.
+			VertexKeyMap uniqueVertices(chunk.TriangleCount / 2);
+
+			const auto corner = [&](std::string_view word)
+			{
+				const auto slash = word.find('/');
+				const auto secondSlash = slash == std::string_view::npos ? slash : word.find('/', slash + 1);
+				const auto texCoordWord = slash == std::string_view::npos ? std::string_view() : word.substr(slash + 1, secondSlash - slash - 1);
+				const auto normalWord = secondSlash == std::string_view::npos ? std::string_view() : word.substr(secondSlash + 1);
+
+				const VertexKey key
+				{
+					ResolveIndex(filename, word.substr(0, slash), definedPositions, positions.size()),
+					normalWord.empty() ? -1 : ResolveIndex(filename, normalWord, definedNormals, normals.size()),
+					texCoordWord.empty() ? -1 : ResolveIndex(filename, texCoordWord, definedTexCoords, texCoords.size()),
+					materialId
+				};
+
+				const auto [vertexIndex, isNew] = uniqueVertices.Insert(key, static_cast<uint32_t>(chunk.Vertices.size()));
+
+				if (isNew)
+				{
+					chunk.Vertices.push_back(Vertex
+					{
+						positions[key.Vertex],
+						key.Normal >= 0 ? normals[key.Normal] : vec3(0),
+						key.TexCoord >= 0 ? texCoords[key.TexCoord] : vec2(0),
+						key.Material
+					});
+				}
+
+				return vertexIndex;
+			};
+
+			ForEachLine(chunk.Text, [&](std::string_view line)
+			{
+				const auto keyword = NextWord(line);
+
+				if (keyword == "v") definedPositions++;
+				else if (keyword == "vn") definedNormals++;
+				else if (keyword == "vt") definedTexCoords++;
+				else if (keyword == "usemtl")
+				{
+					const auto id = materialIds.find(std::string(NextWord(line)));
+					materialId = id != materialIds.end() ? std::max(0, id->second) : 0;
+				}
+				else if (keyword == "f")
+				{
+					// Fan triangulation of the polygons.
+					const auto first = NextWord(line);
+					const auto second = NextWord(line);
+
+					if (second.empty())
+					{
+						return;
+					}
+
+					const uint32_t i0 = corner(first);
+					uint32_t i1 = corner(second);
+
+					for (auto word = NextWord(line); !word.empty(); word = NextWord(line))
+					{
+						const uint32_t i2 = corner(word);
+
+						*index++ = i0;
+						*index++ = i1;
+						*index++ = i2;
+						i1 = i2;
+					}
+				}
+			});
+		});
+
+		mesh.SourceVertexCount = positions.size();
+		mesh.HasNormals = !normals.empty();
+
+		// The attributes are done with before the chunk vertices are concatenated.
+		std::vector<vec3>().swap(positions);
+		std::vector<vec3>().swap(normals);
+		std::vector<vec2>().swap(texCoords);
+
+		std::vector<size_t> firstVertices;
+		size_t vertexCount = 0;
+
+		for (const auto& chunk : chunks)
+		{
+			firstVertices.push_back(vertexCount);
+			vertexCount += chunk.Vertices.size();
+		}
+
+		mesh.Vertices.resize(vertexCount);
+
+		ParallelFor(chunks.size(), [&](const size_t i)
+		{
+			auto& chunk = chunks[i];
+			const auto firstVertex = static_cast<uint32_t>(firstVertices[i]);
+
+			std::copy(chunk.Vertices.begin(), chunk.Vertices.end(), mesh.Vertices.begin() + firstVertices[i]);
+			std::vector<Vertex>().swap(chunk.Vertices);
+
+			for (size_t j = chunk.FirstIndex; j != chunk.FirstIndex + 3 * chunk.TriangleCount; ++j)
+			{
+				mesh.Indices[j] += firstVertex;
+			}
+		});
+
+		for (const auto& material : objMaterials)
+		{
+			Assets::Material m{};
+
+			m.Diffuse = vec4(material.diffuse[0], material.diffuse[1], material.diffuse[2], 1.0);
+			m.DiffuseTextureId = -1;
+
+			mesh.Materials.emplace_back(m);
+		}
+
+		if (mesh.Materials.empty())
+		{
+			mesh.Materials = DefaultMaterials();
+		}
+
+		return mesh;
+	}
+
+	enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+	// The vertex properties the parser keeps, as the slots of a vertex (see PlyVertex()).
+	enum PlySlot { PlyX, PlyY, PlyZ, PlyNx, PlyNy, PlyNz, PlyU, PlyV, PlySlotCount, PlyIgnored = PlySlotCount };
+
+	struct PlyProperty final
+	{
+		std::string Name;
+		PlyType Type;
+		bool IsList;
+		PlyType CountType;
+		int Slot;
+	};
+
+	struct PlyElement final
+	{
+		std::string Name;
+		size_t Count;
+		std::vector<PlyProperty> Properties;
+	};
+
+	size_t PlySize(const PlyType type)
+	{
+		switch (type)
+		{
+		case PlyType::Int8: case PlyType::UInt8: return 1;
+		case PlyType::Int16: case PlyType::UInt16: return 2;
+		case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+		default: return 8;
+		}
+	}
+
+	PlyType ParsePlyType(const std::string& filename, const std::string_view name)
+	{
+		if (name == "char" || name == "int8") return PlyType::Int8;
+		if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+		if (name == "short" || name == "int16") return PlyType::Int16;
+		if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+		if (name == "int" || name == "int32") return PlyType::Int32;
+		if (name == "uint" || name == "uint32") return PlyType::UInt32;
+		if (name == "float" || name == "float32") return PlyType::Float32;
+		if (name == "double" || name == "float64") return PlyType::Float64;
+
+		Fail(filename, "unknown PLY type '" + std::string(name) + "'");
+	}
+
+	int PlyVertexSlot(const std::string_view name)
+	{
+		if (name == "x") return PlyX;
+		if (name == "y") return PlyY;
+		if (name == "z") return PlyZ;
+		if (name == "nx") return PlyNx;
+		if (name == "ny") return PlyNy;
+		if (name == "nz") return PlyNz;
+		if (name == "u" || name == "s" || name == "texture_u" || name == "texture_s") return PlyU;
+		if (name == "v" || name == "t" || name == "texture_v" || name == "texture_t") return PlyV;
+		return PlyIgnored;
+	}
+
+	Vertex PlyVertex(const float (&slots)[PlySlotCount + 1], const bool hasTexCoords)
+	{
+		return Vertex
+		{
+			vec3(slots[PlyX], slots[PlyY], slots[PlyZ]),
+			vec3(slots[PlyNx], slots[PlyNy], slots[PlyNz]),
+			hasTexCoords ? vec2(slots[PlyU], 1 - slots[PlyV]) : vec2(0),
+			0
+		};
+	}
+
+	// Bounds checked reads of the binary PLY values, the hosts are little endian.
+	class PlyReader final
+	{
+	public:
+
+		PlyReader(const std::string& filename, const uint8_t* const data, const uint8_t* const end, const bool isBigEndian) :
+			filename_(filename), data_(data), end_(end), isBigEndian_(isBigEndian)
+		{
+		}
+
+		const uint8_t* Data() const { return data_; }
+		void Skip(const size_t size) { Check(size); data_ += size; }
+
+		double Read(const PlyType type)
+		{
+			const size_t size = PlySize(type);
+			uint8_t bytes[8];
+
+			Check(size);
+			std::memcpy(bytes, data_, size);
+			data_ += size;
+
+			if (isBigEndian_)
+			{
+				std::reverse(bytes, bytes + size);
+			}
+
+			return Convert(type, bytes);
+		}
+
+		static double Convert(const PlyType type, const uint8_t* const bytes)
+		{
+			switch (type)
+			{
+			case PlyType::Int8: return Load<int8_t>(bytes);
+			case PlyType::UInt8: return Load<uint8_t>(bytes);
+			case PlyType::Int16: return Load<int16_t>(bytes);
+			case PlyType::UInt16: return Load<uint16_t>(bytes);
+			case PlyType::Int32: return Load<int32_t>(bytes);
+			case PlyType::UInt32: return Load<uint32_t>(bytes);
+			case PlyType::Float32: return Load<float>(bytes);
+			default: return Load<double>(bytes);
+			}
+		}
+
+	private:
+
+		template <class T>
+		static double Load(const uint8_t* const bytes)
+		{
+			T value;
+			std::memcpy(&value, bytes, sizeof(T));
+			return static_cast<double>(value);
+		}
+
+		void Check(const size_t size) const
+		{
+			if (static_cast<size_t>(end_ - data_) < size)
+			{
+				Fail(filename_, "the PLY data is truncated");
+			}
+		}
+
+		const std::string& filename_;
+		const uint8_t* data_;
+		const uint8_t* const end_;
+		const bool isBigEndian_;
+	};
+
+	Assets::MeshParser::Mesh ParsePly(const std::string& filename, const Utilities::MappedFile& file)
+	{
+		Assets::MeshParser::Mesh mesh;
+
+		// The header, up to the end_header line.
+		const std::string_view text(reinterpret_cast<const char*>(file.Data()), file.Size());
+		std::vector<PlyElement> elements;
+		std::string_view format;
+		size_t dataOffset = std::string_view::npos;
+
+		for (size_t begin = 0; begin < text.size() && dataOffset == std::string_view::npos; )
+		{
+			const size_t end = std::min(text.find('\n', begin), text.size());
+			auto line = text.substr(begin, end - begin);
+			const auto keyword = NextWord(line);
+
+			begin = end + 1;
+
+			if (keyword == "format")
+			{
+				format = NextWord(line);
+			}
+			else if (keyword == "element")
+			{
+				const auto name = NextWord(line);
+				elements.push_back({ std::string(name), static_cast<size_t>(std::max<int64_t>(0, ParseInteger(filename, NextWord(line)))), {} });
+			}
+			else if (keyword == "property")
+			{
+				if (elements.empty())
+				{
+					Fail(filename, "PLY property outside of an element");
+				}
+
+				auto& element = elements.back();
+				PlyProperty property{};
+
+				if (const auto type = NextWord(line); type == "list")
+				{
+					property.IsList = true;
+					property.CountType = ParsePlyType(filename, NextWord(line));
+					property.Type = ParsePlyType(filename, NextWord(line));
+				}
+				else
+				{
+					property.Type = ParsePlyType(filename, type);
+				}
+
+				property.Name = NextWord(line);
+				property.Slot = element.Name == "vertex" && !property.IsList ? PlyVertexSlot(property.Name) : PlyIgnored;
+				element.Properties.push_back(property);
+			}
+			else if (keyword == "end_header")
+			{
+				dataOffset = begin;
+			}
+		}
+
+		const bool isAscii = format == "ascii";
+		const bool isBigEndian = format == "binary_big_endian";
+
+		if (dataOffset == std::string_view::npos || (!isAscii && !isBigEndian && format != "binary_little_endian"))
+		{
+			Fail(filename, "invalid PLY header");
+		}
+
+		const auto vertexElement = std::find_if(elements.begin(), elements.end(), [](const PlyElement& element) { return element.Name == "vertex"; });
+		const auto faceElement = std::find_if(elements.begin(), elements.end(), [](const PlyElement& element) { return element.Name == "face"; });
+
+		if (vertexElement == elements.end() || vertexElement->Count > static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+		{
+			Fail(filename, "missing or invalid PLY vertex element");
+		}
+
+		const auto hasSlot = [&vertexElement](const int slot)
+		{
+			return std::any_of(vertexElement->Properties.begin(), vertexElement->Properties.end(), [slot](const PlyProperty& property) { return property.Slot == slot; });
+		};
+
+		const bool hasTexCoords = hasSlot(PlyU) && hasSlot(PlyV);
+		const PlyProperty* faceIndices = nullptr;
+
+		if (faceElement != elements.end())
+		{
+			for (const auto& property : faceElement->Properties)
+			{
+				faceIndices = property.IsList && (property.Name == "vertex_indices" || property.Name == "vertex_index") ? &property : faceIndices;
+			}
+		}
+
+		mesh.SourceVertexCount = vertexElement->Count;
+		mesh.HasNormals = hasSlot(PlyNx) && hasSlot(PlyNy) && hasSlot(PlyNz);
+		mesh.Materials = DefaultMaterials();
+		mesh.Vertices.resize(vertexElement->Count);
+
+		if (faceElement != elements.end())
+		{
+			mesh.Indices.reserve(3 * faceElement->Count);
+		}
+
+		// Appends the fan triangulation of a face.
+		std::vector<int64_t> polygon;
+
+		const auto addFace = [&]()
+		{
+			for (const auto index : polygon)
+			{
+				if (index < 0 || index >= static_cast<int64_t>(mesh.Vertices.size()))
+				{
+					Fail(filename, "face index " + std::to_string(index) + " is out of range");
+				}
+			}
+
+			for (size_t i = 2; i < polygon.size(); ++i)
+			{
+				mesh.Indices.push_back(static_cast<uint32_t>(polygon[0]));
+				mesh.Indices.push_back(static_cast<uint32_t>(polygon[i - 1]));
+				mesh.Indices.push_back(static_cast<uint32_t>(polygon[i]));
+			}
+		};
+
+		if (isAscii)
+		{
+			// One line per element, read in a single pass.
+			size_t begin = dataOffset;
+
+			const auto nextLine = [&]()
+			{
+				if (begin >= text.size())
+				{
+					Fail(filename, "the PLY data is truncated");
+				}
+
+				const size_t end = std::min(text.find('\n', begin), text.size());
+				const auto line = text.substr(begin, end - begin);
+				begin = end + 1;
+				return line;
+			};
+
+			const auto nextValue = [&](std::string_view& line)
+			{
+				const auto word = NextWord(line);
+
+				if (word.empty())
+				{
+					Fail(filename, "the PLY data is truncated");
+				}
+
+				return word;
+			};
+
+			for (auto element = elements.begin(); element != elements.end(); ++element)
+			{
+				for (size_t i = 0; i != element->Count; ++i)
+				{
+					auto line = nextLine();
+					float slots[PlySlotCount + 1] = {};
+
+					polygon.clear();
+
+					for (const auto& property : element->Properties)
+					{
+						if (!property.IsList)
+						{
+							slots[property.Slot] = ParseFloat(filename, nextValue(line));
+							continue;
+						}
+
+						const auto count = ParseInteger(filename, nextValue(line));
+
+						for (int64_t j = 0; j < count; ++j)
+						{
+							const auto value = nextValue(line);
+
+							if (&property == faceIndices)
+							{
+								polygon.push_back(ParseInteger(filename, value));
+							}
+						}
+					}
+
+					if (element == vertexElement)
+					{
+						mesh.Vertices[i] = PlyVertex(slots, hasTexCoords);
+					}
+					else if (element == faceElement)
+					{
+						addFace();
+					}
+				}
+			}
+
+			return mesh;
+		}
+
+		PlyReader reader(filename, file.Data() + dataOffset, file.Data() + file.Size(), isBigEndian);
+
+		for (auto element = elements.begin(); element != elements.end(); ++element)
+		{
+			const bool isFixedSize = std::none_of(element->Properties.begin(), element->Properties.end(), [](const PlyProperty& property) { return property.IsList; });
+
+			if (element == vertexElement && isFixedSize)
+			{
+				// The vertices have a fixed stride, they are converted in parallel ranges straight into place.
+				size_t stride = 0;
+				std::vector<size_t> offsets;
+
+				for (const auto& property : element->Properties)
+				{
+					offsets.push_back(stride);
+					stride += PlySize(property.Type);
+				}
+
+				const auto* const data = reader.Data();
+				reader.Skip(stride * element->Count);
+
+				const size_t rangeSize = std::max<size_t>(1, MinChunkSize / std::max<size_t>(stride, 1));
+				const size_t rangeCount = (element->Count + rangeSize - 1) / rangeSize;
+
+				ParallelFor(rangeCount, [&](const size_t range)
+				{
+					for (size_t i = range * rangeSize; i != std::min(element->Count, (range + 1) * rangeSize); ++i)
+					{
+						float slots[PlySlotCount + 1] = {};
+
+						for (size_t p = 0; p != element->Properties.size(); ++p)
+						{
+							const auto& property = element->Properties[p];
+							uint8_t bytes[8];
+
+							std::memcpy(bytes, data + i * stride + offsets[p], PlySize(property.Type));
+
+							if (isBigEndian)
+							{
+								std::reverse(bytes, bytes + PlySize(property.Type));
+							}
+
+							slots[property.Slot] = static_cast<float>(PlyReader::Convert(property.Type, bytes));
+						}
+
+						mesh.Vertices[i] = PlyVertex(slots, hasTexCoords);
+					}
+				});
+
+				continue;
+			}
+
+			// The other elements, and the faces of variable length, are read in order.
+			for (size_t i = 0; i != element->Count; ++i)
+			{
+				float slots[PlySlotCount + 1] = {};
+
+				polygon.clear();
+
+				for (const auto& property : element->Properties)
+				{
+					if (!property.IsList)
+					{
+						slots[property.Slot] = static_cast<float>(reader.Read(property.Type));
+						continue;
+					}
+
+					const auto count = static_cast<int64_t>(reader.Read(property.CountType));
+
+					if (&property != faceIndices)
+					{
+						reader.Skip(static_cast<size_t>(std::max<int64_t>(0, count)) * PlySize(property.Type));
+						continue;
+					}
+
+					for (int64_t j = 0; j < count; ++j)
+					{
+						polygon.push_back(static_cast<int64_t>(reader.Read(property.Type)));
+					}
+				}
+
+				if (element == vertexElement)
+				{
+					mesh.Vertices[i] = PlyVertex(slots, hasTexCoords);
+				}
+				else if (element == faceElement)
+				{
+					addFace();
+				}
+			}
+		}
+
+		return mesh;
+	}
+}
+
+namespace Assets {
+
+MeshParser::Mesh MeshParser::Parse(const std::string& filename)
+{
+	const Utilities::MappedFile file(filename);
+
+	if (!file.IsMapped())
+	{
+		Fail(filename, "cannot open the file");
+	}
+
+	auto extension = std::filesystem::path(filename).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	return extension == ".ply" ? ParsePly(filename, file) : ParseObj(filename, file);
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Material.hpp"
+#include "Vertex.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Assets
+{
+	// Streaming OBJ and PLY (ASCII or binary) parser for the multi-gigabyte scanned meshes. The file is memory mapped and split
+	// into chunks of whole lines parsed on all the hardware threads, which write straight into the final vertex and index layout:
+	// the attributes are counted first, so that every chunk knows where its own ones go, then each chunk deduplicates its face corners.
+	// The OBJ attributes are the only intermediate copy, the PLY vertices are already indexed and parsed in place.
+	class MeshParser final
+	{
+	public:
+
+		struct Mesh final
+		{
+			std::vector<Vertex> Vertices;
+			std::vector<uint32_t> Indices;
+			std::vector<Material> Materials; // At least one.
+			uint64_t SourceVertexCount{}; // The positions of the file.
+			bool HasNormals{};
+			std::string Warning;
+		};
+
+		// Picks the format from the extension, anything but .ply is read as OBJ.
+		static Mesh Parse(const std::string& filename);
+	};
+
+}
@@ -1,175 +1,200 @@
 #include "Model.hpp"
 #include "CornellBox.hpp"
+#include "MeshCache.hpp"
+#include "MeshParser.hpp"
+#include "MeshOptimizer.hpp"
 #include "Procedural.hpp"
 #include "Sphere.hpp"
 #include "Utilities/Exception.hpp"
 #include "Utilities/Console.hpp"
+#include "Utilities/ParallelFor.hpp"
+#include "Utilities/Profiler.hpp"
 
-#define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/matrix_inverse.hpp>
-#include <glm/gtx/hash.hpp>
 
-#include <tiny_obj_loader.h>
+#include <algorithm>
 #include <chrono>
-#include <filesystem>
 #include <iostream>
-#include <unordered_map>
+#include <sstream>
 #include <vector>
 
 using namespace glm;
 
-namespace std
+namespace
 {
-	template<> struct hash<Assets::Vertex> final
+	// The coarsest level of detail keeps at least this many indices.
+	constexpr size_t MinLevelOfDetailIndices = 3 * 256;
+
+	// The vertices or triangles given to each thread of the geometry passes.
+	constexpr size_t GeometryRangeSize = 1 << 16;
+
+	// Smooth normals averaging the face normals of the triangles around each vertex. Each vertex gathers its own triangles,
+	// found through a vertex to triangle table, rather than the triangles scattering into their vertices: the threads never
+	// write the same vertex, and the sums are taken in the triangle order, the same as the single threaded pass they replace.
+	void GenerateSmoothNormals(std::vector<Assets::Vertex>& vertices, const std::vector<uint32_t>& indices)
 	{
-		size_t operator()(Assets::Vertex const& vertex) const noexcept
+		const size_t triangleCount = indices.size() / 3;
+		std::vector<vec3> faceNormals(triangleCount);
+
+		Utilities::ParallelForRanges(triangleCount, GeometryRangeSize, [&](const size_t begin, const size_t end)
+		{
+			for (size_t t = begin; t != end; ++t)
+			{
+				const auto& p0 = vertices[indices[3 * t + 0]].Position;
+				const auto& p1 = vertices[indices[3 * t + 1]].Position;
+				const auto& p2 = vertices[indices[3 * t + 2]].Position;
+
+				faceNormals[t] = normalize(cross(p1 - p0, p2 - p0));
+			}
+		});
+
+		// Counting sort of the face corners by vertex.
+		std::vector<uint32_t> firstCorners(vertices.size() + 1);
+
+		for (size_t i = 0; i != 3 * triangleCount; ++i)
 		{
-			return
-				Combine(hash<vec3>()(vertex.Position),
-					Combine(hash<vec3>()(vertex.Normal),
-						Combine(hash<vec2>()(vertex.TexCoord),
-							hash<int>()(vertex.MaterialIndex))));
+			firstCorners[indices[i] + 1]++;
 		}
 
-	private:
+		for (size_t v = 0; v != vertices.size(); ++v)
+		{
+			firstCorners[v + 1] += firstCorners[v];
+		}
+
+		std::vector<uint32_t> cornerTriangles(3 * triangleCount);
+		std::vector<uint32_t> next(firstCorners.begin(), firstCorners.end() - 1);
 
-		static size_t Combine(size_t hash0, size_t hash1)
+		for (size_t i = 0; i != 3 * triangleCount; ++i)
 		{
-			return hash0 ^ (hash1 + 0x9e3779b9 + (hash0 << 6) + (hash0 >> 2));
+			cornerTriangles[next[indices[i]]++] = static_cast<uint32_t>(i / 3);
 		}
-	};
+
+		Utilities::ParallelForRanges(vertices.size(), GeometryRangeSize, [&](const size_t begin, const size_t end)
+		{
+			for (size_t v = begin; v != end; ++v)
+			{
+				vec3 normal = vertices[v].Normal;
+
+				for (uint32_t c = firstCorners[v]; c != firstCorners[v + 1]; ++c)
+				{
+					normal += faceNormals[cornerTriangles[c]];
+				}
+
+				vertices[v].Normal = normalize(normal);
+			}
+		});
+	}
 }
 
 namespace Assets {
 
-Model Model::LoadModel(const std::string& filename)
+Model Model::LoadModel(const std::string& filename, const bool deferNormals)
 {
-	std::cout << "- loading '" << filename << "'... " << std::flush;
-
+	PROFILE_ZONE("LoadModel");
 	const auto timer = std::chrono::high_resolution_clock::now();
-	const std::string materialPath = std::filesystem::path(filename).parent_path().string();
-	
-	tinyobj::ObjReader objReader;
-	
-	if (!objReader.ParseFromFile(filename))
-	{
-		Throw(std::runtime_error("failed to load model '" + filename + "':\n" + objReader.Error()));
-	}
 
-	if (!objReader.Warning().empty())
+	// Skip the parsing, deduplication and normals generation altogether when the cache is up to date.
+	const MeshCache cache(filename);
+	MeshCache::Mesh cached;
+
+	if (cache.Load(cached))
 	{
-		Utilities::Console::Write(Utilities::Severity::Warning, [&objReader]()
+		// The cache was filled for the GPU normals, the reordered vertices still get the same ones here.
+		if (!cached.HasNormals && !deferNormals)
 		{
-			std::cout << "\nWARNING: " << objReader.Warning() << std::flush;
-		});
-	}
+			GenerateSmoothNormals(cached.Vertices, cached.Indices);
+		}
 
-	// Materials
-	std::vector<Material> materials;
+		const auto elapsed = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - timer).count();
 
-	for (const auto& material : objReader.GetMaterials())
-	{
-		Material m{};
+		// The whole line is written at once, models can be loaded from several threads.
+		std::ostringstream out;
+		out << "- loading '" << filename << "'... ";
+		out << "(" << cached.SourceVertexCount << " vertices, " << cached.Vertices.size() << " unique vertices, " << cached.Materials.size() << " materials, ";
+		out << "ACMR " << cached.CacheMissRatioBefore << " -> " << cached.CacheMissRatioAfter << ") ";
+		out << elapsed << "s (warm mesh cache)" << std::endl;
+		std::cout << out.str() << std::flush;
 
-		m.Diffuse = vec4(material.diffuse[0], material.diffuse[1], material.diffuse[2], 1.0);
-		m.DiffuseTextureId = -1;
+		Model model(std::move(cached.Vertices), std::move(cached.Indices), std::move(cached.Materials), nullptr);
+		model.lods_ = std::move(cached.LevelsOfDetail);
+		model.needsNormals_ = !cached.HasNormals && deferNormals;
 
-		materials.emplace_back(m);
+		return model;
 	}
+	
+	// Parse straight into the final layout, the vertices are already deduplicated.
+	const auto parseTimer = std::chrono::high_resolution_clock::now();
+	auto parsed = MeshParser::Parse(filename);
+	const auto parseElapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - parseTimer).count();
 
-	if (materials.empty())
+	if (!parsed.Warning.empty())
 	{
-		Material m{};
-
-		m.Diffuse = vec4(0.7f, 0.7f, 0.7f, 1.0);
-		m.DiffuseTextureId = -1;
-
-		materials.emplace_back(m);
+		Utilities::Console::Write(Utilities::Severity::Warning, [&parsed, &filename]()
+		{
+			std::cout << "WARNING: '" + filename + "': " + parsed.Warning + "\n" << std::flush;
+		});
 	}
 
-	// Geometry
-	const auto& objAttrib = objReader.GetAttrib();
+	auto& vertices = parsed.Vertices;
+	auto& indices = parsed.Indices;
+	auto& materials = parsed.Materials;
 
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
-	std::unordered_map<Vertex, uint32_t> uniqueVertices(objAttrib.vertices.size());
-	size_t faceId = 0;
+	// If the model did not specify normals, then create smooth normals that conserve the same number of vertices.
+	// Using flat normals would mean creating more vertices than we currently have, so for simplicity and better visuals we don't do it.
+	// See https://stackoverflow.com/questions/12139840/obj-file-averaging-normals.
+	// With deferNormals, the same is done on the GPU once the vertices are uploaded (see Vulkan::NormalsPipeline).
+	const bool needsNormals = !parsed.HasNormals && deferNormals;
 
-	for (const auto& shape : objReader.GetShapes())
+	if (!parsed.HasNormals && !deferNormals)
 	{
-		const auto& mesh = shape.mesh;
-
-		for (const auto& index : mesh.indices)
-		{
-			Vertex vertex = {};
-
-			vertex.Position =
-			{
-				objAttrib.vertices[3 * index.vertex_index + 0],
-				objAttrib.vertices[3 * index.vertex_index + 1],
-				objAttrib.vertices[3 * index.vertex_index + 2],
-			};
-
-			if (!objAttrib.normals.empty())
-			{
-				vertex.Normal =
-				{
-					objAttrib.normals[3 * index.normal_index + 0],
-					objAttrib.normals[3 * index.normal_index + 1],
-					objAttrib.normals[3 * index.normal_index + 2]
-				};
-			}
+		GenerateSmoothNormals(vertices, indices);
+	}
 
-			if (!objAttrib.texcoords.empty())
-			{
-				vertex.TexCoord =
-				{
-					objAttrib.texcoords[2 * index.texcoord_index + 0],
-					1 - objAttrib.texcoords[2 * index.texcoord_index + 1]
-				};
-			}
+	// Reorder the triangles for the vertex cache, then the vertices for the index fetches. Only done on a cold cache.
+	const auto cacheMissRatioBefore = MeshOptimizer::AverageCacheMissRatio(indices, vertices.size());
 
-			vertex.MaterialIndex = std::max(0, mesh.material_ids[faceId++ / 3]);
+	MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+	MeshOptimizer::OptimizeVertexFetch(vertices, indices);
 
-			if (uniqueVertices.count(vertex) == 0)
-			{
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-			}
+	const auto cacheMissRatioAfter = MeshOptimizer::AverageCacheMissRatio(indices, vertices.size());
 
-			indices.push_back(uniqueVertices[vertex]);
-		}
-	}
+	// The levels of detail, simplified from the full mesh down to a few hundred triangles.
+	std::vector<std::vector<uint32_t>> lods;
 
-	// If the model did not specify normals, then create smooth normals that conserve the same number of vertices.
-	// Using flat normals would mean creating more vertices than we currently have, so for simplicity and better visuals we don't do it.
-	// See https://stackoverflow.com/questions/12139840/obj-file-averaging-normals.
-	if (objAttrib.normals.empty())
+	for (size_t target = indices.size() / 4; target >= MinLevelOfDetailIndices; target /= 4)
 	{
-		std::vector<vec3> normals(vertices.size());
-		
-		for (size_t i = 0; i < indices.size(); i += 3)
-		{
-			const auto normal = normalize(cross(
-				vec3(vertices[indices[i + 1]].Position) - vec3(vertices[indices[i]].Position),
-				vec3(vertices[indices[i + 2]].Position) - vec3(vertices[indices[i]].Position)));
-
-			vertices[indices[i + 0]].Normal += normal;
-			vertices[indices[i + 1]].Normal += normal;
-			vertices[indices[i + 2]].Normal += normal;			
-		}
+		auto lod = MeshOptimizer::SimplifySloppy(vertices, indices, target);
 
-		for (auto& vertex : vertices)
+		if (lod.empty() || lod.size() >= (lods.empty() ? indices : lods.back()).size())
 		{
-			vertex.Normal = normalize(vertex.Normal);
+			break;
 		}
+
+		MeshOptimizer::OptimizeVertexCache(lod, vertices.size());
+		lods.push_back(std::move(lod));
 	}
 
 	const auto elapsed = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - timer).count();
 
-	std::cout << "(" << objAttrib.vertices.size() << " vertices, " << uniqueVertices.size() << " unique vertices, " << materials.size() << " materials) ";
-	std::cout << elapsed << "s" << std::endl;
+	std::ostringstream out;
+	out << "- loading '" << filename << "'... ";
+	out << "(" << parsed.SourceVertexCount << " vertices, " << vertices.size() << " unique vertices parsed in " << parseElapsed << "ms, " << materials.size() << " materials, ";
+	out << "ACMR " << cacheMissRatioBefore << " -> " << cacheMissRatioAfter << ", " << lods.size() << " levels of detail) ";
+	out << elapsed << "s (cold mesh cache)" << std::endl;
+	std::cout << out.str() << std::flush;
+
+	MeshCache::Mesh mesh{ std::move(vertices), std::move(indices), std::move(materials), parsed.SourceVertexCount, cacheMissRatioBefore, cacheMissRatioAfter, std::move(lods), !needsNormals };
+	cache.Store(mesh);
+
+	Model model(std::move(mesh.Vertices), std::move(mesh.Indices), std::move(mesh.Materials), nullptr);
+	model.lods_ = std::move(mesh.LevelsOfDetail);
+	model.needsNormals_ = needsNormals;
 
+	return model;
+}
+
+Model Model::CreateMesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, std::vector<Material>&& materials)
+{
 	return Model(std::move(vertices), std::move(indices), std::move(materials), nullptr);
 }
 
@@ -243,6 +268,12 @@ Model Model::CreateBox(const vec3& p0, const vec3& p1, const Material& material)
 
 Model Model::CreateSphere(const vec3& center, float radius, const Material& material, const bool isProcedural)
 {
+	// The procedural spheres only need their parameters, the rasterizer draws them from a mesh shared by the scene.
+	if (isProcedural)
+	{
+		return Model(std::vector<Vertex>(), std::vector<uint32_t>(), std::vector<Material>{material}, new Sphere(center, radius));
+	}
+
 	const int slices = 32;
 	const int stacks = 16;
 	
@@ -308,7 +339,7 @@ Model Model::CreateSphere(const vec3& center, float radius, const Material& mate
 		std::move(vertices),
 		std::move(indices),
 		std::vector<Material>{material},
-		isProcedural ? new Sphere(center, radius) : nullptr);
+		nullptr);
 }
 
 void Model::SetMaterial(const Material& material)
@@ -321,22 +352,93 @@ void Model::SetMaterial(const Material& material)
 	materials_[0] = material;
 }
 
-void Model::Transform(const mat4& transform)
+Model Model::CreateLevelOfDetail(const size_t level) const
+{
+	auto vertices = vertices_;
+	auto indices = lods_[level];
+
+	// Only keep the vertices the simplified mesh references, they come first once reordered.
+	MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+
+	uint32_t vertexCount = 0;
+
+	for (const auto index : indices)
+	{
+		vertexCount = std::max(vertexCount, index + 1);
+	}
+
+	vertices.resize(vertexCount);
+
+	Model model(std::move(vertices), std::move(indices), std::vector<Material>(materials_), nullptr);
+	model.needsNormals_ = needsNormals_;
+
+	return model;
+}
+
+void Model::ReleaseGeometry()
+{
+	HashGeometry();
+
+	vertices_ = std::vector<Vertex>();
+	indices_ = std::vector<uint32_t>();
+	lods_ = std::vector<std::vector<uint32_t>>();
+}
+
+void Model::HashGeometry()
 {
-	const auto transformIT = inverseTranspose(transform);
+	if (!vertices_.empty())
+	{
+		boundingBox_ = { vertices_[0].Position, vertices_[0].Position };
+	}
+
+	// FNV-1a over the positions and the indices, the only parts that end up in an acceleration structure.
+	uint64_t hash = 14695981039346656037ull;
+
+	const auto add = [&hash](const void* const data, const size_t size)
+	{
+		const auto* const bytes = static_cast<const uint8_t*>(data);
 
-	for (auto& vertex : vertices_)
+		for (size_t i = 0; i != size; ++i)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+
+	for (const auto& vertex : vertices_)
 	{
-		vertex.Position = transform * vec4(vertex.Position, 1);
-		vertex.Normal = transformIT * vec4(vertex.Normal, 0);
+		boundingBox_.first = min(boundingBox_.first, vertex.Position);
+		boundingBox_.second = max(boundingBox_.second, vertex.Position);
+		add(&vertex.Position, sizeof(vertex.Position));
 	}
+
+	add(indices_.data(), indices_.size() * sizeof(uint32_t));
+	geometryHash_ = hash;
+}
+
+void Model::Transform(const mat4& transform)
+{
+	// The normals only need the upper 3x3 of the inverse transpose. Plain loops over ranges of vertices, which the compiler vectorizes.
+	const mat3 normalTransform(inverseTranspose(transform));
+
+	Utilities::ParallelForRanges(vertices_.size(), GeometryRangeSize, [&](const size_t begin, const size_t end)
+	{
+		for (size_t i = begin; i != end; ++i)
+		{
+			auto& vertex = vertices_[i];
+
+			vertex.Position = vec3(transform * vec4(vertex.Position, 1));
+			vertex.Normal = normalTransform * vertex.Normal;
+		}
+	});
 }
 
 Model::Model(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, std::vector<Material>&& materials, const class Procedural* procedural) :
 	vertices_(std::move(vertices)), 
 	indices_(std::move(indices)),
 	materials_(std::move(materials)),
-	procedural_(procedural)
+	procedural_(procedural),
+	vertexCount_(static_cast<uint32_t>(vertices_.size())),
+	indexCount_(static_cast<uint32_t>(indices_.size()))
 {
 }
 
@@ -1,22 +1,31 @@
 #pragma once
 
+#include "BuildPolicy.hpp"
 #include "Material.hpp"
 #include "Procedural.hpp"
 #include "Vertex.hpp"
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace Assets
 {
+	class DensityGrid;
+
 	class Model final
 	{
 	public:
 
-		static Model LoadModel(const std::string& filename);
+		// The missing normals are left to the GPU with deferNormals (see NeedsNormals()), otherwise generated here.
+		static Model LoadModel(const std::string& filename, bool deferNormals = false);
 		static Model CreateCornellBox(const float scale);
 		static Model CreateBox(const glm::vec3& p0, const glm::vec3& p1, const Material& material);
 		static Model CreateSphere(const glm::vec3& center, float radius, const Material& material, bool isProcedural);
+
+		// A triangle model of already loaded geometry, e.g. a glTF mesh (see GltfScene).
+		static Model CreateMesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, std::vector<Material>&& materials);
 		
 		Model& operator = (const Model&) = delete;
 		Model& operator = (Model&&) = delete;
@@ -28,6 +37,18 @@ namespace Assets
 
 		void SetMaterial(const Material& material);
 		void Transform(const glm::mat4& transform);
+		void SetBuildPolicy(Assets::BuildPolicy policy) { buildPolicy_ = policy; }
+
+		// Frees the host vertices and indices once they have been uploaded, only their counts, bounds and hash are kept.
+		void ReleaseGeometry();
+
+		// Only computes the bounds and hash, the host geometry being still needed (see Scene::ReleaseHostGeometry()).
+		void HashGeometry();
+
+		// The simplified index lists of an OBJ model over its own vertices, a quarter of the triangles each (see MeshOptimizer::SimplifySloppy()).
+		// A level of detail becomes a model of its own, with only the vertices it references, before the geometry is released.
+		const std::vector<std::vector<uint32_t>>& LevelsOfDetail() const { return lods_; }
+		Model CreateLevelOfDetail(size_t level) const;
 
 		const std::vector<Vertex>& Vertices() const { return vertices_; }
 		const std::vector<uint32_t>& Indices() const { return indices_; }
@@ -35,10 +56,24 @@ namespace Assets
 
 		const class Procedural* Procedural() const { return procedural_.get(); }
 
-		uint32_t NumberOfVertices() const { return static_cast<uint32_t>(vertices_.size()); }
-		uint32_t NumberOfIndices() const { return static_cast<uint32_t>(indices_.size()); }
+		// The densities of the heterogeneous medium filling the model bounds, when its material is isotropic (see Scene::MediumCount()).
+		const class DensityGrid* DensityGrid() const { return densityGrid_.get(); }
+		void SetDensityGrid(std::shared_ptr<const class DensityGrid> densityGrid) { densityGrid_ = std::move(densityGrid); }
+
+		// The vertex normals are zero, to be generated in place once uploaded (see Vulkan::NormalsPipeline).
+		bool NeedsNormals() const { return needsNormals_; }
+
+		// Overrides the application wide acceleration structure build policy when set.
+		const std::optional<Assets::BuildPolicy>& BuildPolicy() const { return buildPolicy_; }
+
+		uint32_t NumberOfVertices() const { return vertexCount_; }
+		uint32_t NumberOfIndices() const { return indexCount_; }
 		uint32_t NumberOfMaterials() const { return static_cast<uint32_t>(materials_.size()); }
 
+		// The vertex bounds and the hash of the positions and indices, computed when the geometry is released.
+		const std::pair<glm::vec3, glm::vec3>& BoundingBox() const { return boundingBox_; }
+		uint64_t GeometryHash() const { return geometryHash_; }
+
 	private:
 
 		Model(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, std::vector<Material>&& materials, const class Procedural* procedural);
@@ -46,7 +81,15 @@ namespace Assets
 		std::vector<Vertex> vertices_;
 		std::vector<uint32_t> indices_;
 		std::vector<Material> materials_;
+		std::vector<std::vector<uint32_t>> lods_;
 		std::shared_ptr<const class Procedural> procedural_;
+		std::shared_ptr<const class DensityGrid> densityGrid_;
+		std::optional<Assets::BuildPolicy> buildPolicy_;
+		uint32_t vertexCount_{};
+		uint32_t indexCount_{};
+		std::pair<glm::vec3, glm::vec3> boundingBox_{};
+		uint64_t geometryHash_{};
+		bool needsNormals_{};
 	};
 
 }
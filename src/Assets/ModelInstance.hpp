@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Material.hpp"
+#include "Utilities/Glm.hpp"
+#include <optional>
+
+namespace Assets
+{
+
+	// The instance mask bits tested by each kind of ray (see Instance.glsl): bit n by the rays of bounce n (the camera rays being
+	// bounce 0, the last bit being shared by the deeper ones), the top bit by the shadow rays.
+	constexpr uint32_t BounceRayMaskCount = 7;
+	constexpr uint32_t ShadowRayMask = 0x80;
+
+	// Placement of a scene model. The model geometry is uploaded and built only once,
+	// each instance simply references it with its own transform.
+	struct ModelInstance final
+	{
+		uint32_t ModelId;
+		glm::mat4 Transform;
+		std::optional<Material> MaterialOverride;
+		uint32_t RayMask = 0xFF; // The rays that can hit it.
+	};
+
+}
@@ -1,47 +1,294 @@
 #include "Scene.hpp"
+#include "DensityGrid.hpp"
+#include "Environment.hpp"
+#include "MaterialRegistry.hpp"
+#include "MeshOptimizer.hpp"
 #include "Model.hpp"
 #include "Sphere.hpp"
 #include "Texture.hpp"
-#include "TextureImage.hpp"
+#include "TextureStreamer.hpp"
+#include "VertexLayout.hpp"
+#include "Vulkan/Buffer.hpp"
 #include "Vulkan/BufferUtil.hpp"
-#include "Vulkan/ImageView.hpp"
-#include "Vulkan/Sampler.hpp"
+#include "Vulkan/Device.hpp"
+#include "Vulkan/NormalsPipeline.hpp"
+#include "Vulkan/SamplerCache.hpp"
+#include "Vulkan/StagingRing.hpp"
+#include "Utilities/Arena.hpp"
 #include "Utilities/Exception.hpp"
-#include "Vulkan/SingleTimeCommands.hpp"
+#include "Utilities/Profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <limits>
+#include <numeric>
 
 
 namespace Assets {
 
-Scene::Scene(Vulkan::CommandPool& commandPool, std::vector<Model>&& models, std::vector<Texture>&& textures) :
+namespace
+{
+	// The geometry proxies keep about a ProxyRatio-th of the triangles of their model, the models that would not shrink below
+	// ProxyMinTriangles get none.
+	constexpr size_t ProxyRatio = 32;
+	constexpr size_t ProxyMinTriangles = 256;
+
+	// Matches the Instance struct in Instance.glsl.
+	struct alignas(16) InstanceData final
+	{
+		glm::mat4 Transform;
+		uint32_t ModelIndex;
+		int32_t MaterialIndex;
+		uint32_t ShortIndices;
+		uint32_t RayMask;
+		VkDeviceAddress VertexAddress;
+		VkDeviceAddress IndexAddress;
+		VkDeviceAddress TriangleMaterialAddress;
+		uint32_t LightOffset;
+		uint32_t Reserved2;
+	};
+
+	// The part of an instance record that depends on its model, rewritten when the instance switches models (see Scene::SetInstanceModels()).
+	struct InstanceGeometryData final
+	{
+		uint32_t ModelIndex;
+		int32_t MaterialIndex;
+		uint32_t ShortIndices;
+		uint32_t RayMask;
+		VkDeviceAddress VertexAddress;
+		VkDeviceAddress IndexAddress;
+		VkDeviceAddress TriangleMaterialAddress;
+	};
+
+	static_assert(offsetof(InstanceData, TriangleMaterialAddress) - offsetof(InstanceData, ModelIndex) == offsetof(InstanceGeometryData, TriangleMaterialAddress),
+		"InstanceGeometryData does not match InstanceData");
+
+	// The draw of the other index width of a switched instance.
+	constexpr uint32_t NoDraw = ~0u;
+
+	// Matches the Medium struct in Medium.glsl.
+	struct alignas(16) MediumData final
+	{
+		glm::mat4 WorldToLocal;
+		glm::vec4 BoundsMinAndShape; // xyz + w (1 for the sphere inscribed in the bounds, 0 for the box)
+		glm::vec4 BoundsMaxAndDensity;
+		glm::vec4 Albedo;
+		glm::uvec4 Grid; // The density grid resolution (zero when homogeneous) + w (its first voxel)
+		glm::uvec4 MajorantGrid; // The same for the block majorants.
+	};
+
+	// Matches the Draw struct in Culling.comp.
+	struct alignas(16) DrawData final
+	{
+		glm::vec4 BoundsMin;
+		glm::vec4 BoundsMax;
+		uint32_t IndexCount;
+		uint32_t FirstIndex; // In indices of the draw's width.
+		uint32_t InstanceIndex;
+		uint32_t Reserved0;
+	};
+
+	// Matches the Light struct in Light.glsl.
+	struct LightData final
+	{
+		glm::vec4 Position; // xyz + w (the branches to the leaf of the light tree, as uint bits)
+		glm::vec4 Edge1;
+		glm::vec4 Edge2;
+		glm::vec4 EmissionAndCdf;
+	};
+
+	LightTree::Triangle TransformLight(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& emission, const glm::mat4& transform)
+	{
+		LightTree::Triangle triangle;
+		triangle.P0 = glm::vec3(transform * glm::vec4(p0, 1));
+		triangle.P1 = glm::vec3(transform * glm::vec4(p1, 1));
+		triangle.P2 = glm::vec3(transform * glm::vec4(p2, 1));
+
+		const auto area = 0.5f * glm::length(glm::cross(triangle.P1 - triangle.P0, triangle.P2 - triangle.P0));
+		triangle.Power = glm::dot(emission, glm::vec3(0.2126f, 0.7152f, 0.0722f)) * area;
+
+		return triangle;
+	}
+
+	LightData MakeLight(const LightTree::Triangle& triangle, const glm::vec4& emissionAndCdf, const uint32_t branches)
+	{
+		float position;
+		std::memcpy(&position, &branches, sizeof(position));
+
+		return { glm::vec4(triangle.P0, position), glm::vec4(triangle.P1 - triangle.P0, 0), glm::vec4(triangle.P2 - triangle.P0, 0), emissionAndCdf };
+	}
+
+	void InsertMemoryBarrier(
+		VkCommandBuffer commandBuffer,
+		const VkPipelineStageFlags srcStageMask,
+		const VkAccessFlags srcAccessMask,
+		const VkPipelineStageFlags dstStageMask,
+		const VkAccessFlags dstAccessMask)
+	{
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = srcAccessMask;
+		memoryBarrier.dstAccessMask = dstAccessMask;
+
+		vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	// Updates parts of a buffer the previous frames may still be reading, from the command buffer of the frame.
+	// The runs are short ones, e.g. the lights of the moving instances and the nodes above them.
+	template <class T>
+	void UpdateBufferRuns(const VkCommandBuffer commandBuffer, const Vulkan::Buffer& buffer, const std::vector<uint32_t>& elements, const std::function<T(uint32_t)>& element)
+	{
+		constexpr size_t MaxUpdateElements = 65536 / sizeof(T); // The limit of vkCmdUpdateBuffer.
+		std::vector<T> run;
+
+		for (size_t i = 0; i != elements.size(); )
+		{
+			const auto first = elements[i];
+			run.clear();
+
+			for (; i != elements.size() && elements[i] == first + run.size() && run.size() != MaxUpdateElements; ++i)
+			{
+				run.push_back(element(elements[i]));
+			}
+
+			vkCmdUpdateBuffer(commandBuffer, buffer.Handle(), first * sizeof(T), run.size() * sizeof(T), run.data());
+		}
+	}
+
+	// Matches the SceneBufferTable block in SceneBuffers.glsl.
+	struct SceneBufferTableData final
+	{
+		VkDeviceAddress Materials;
+		VkDeviceAddress Offsets;
+		VkDeviceAddress Spheres;
+		VkDeviceAddress Instances;
+		VkDeviceAddress TriangleMaterials;
+		VkDeviceAddress Lights;
+		VkDeviceAddress Environment;
+		uint32_t EnvironmentWidth; // Zero without environment.
+		uint32_t EnvironmentHeight;
+		float EnvironmentPdfScale;
+		uint32_t MediumCount;
+		VkDeviceAddress CompactMaterials;
+		VkDeviceAddress LightNodes;
+		VkDeviceAddress LightIndices;
+		VkDeviceAddress Media;
+		VkDeviceAddress MediumVoxels;
+	};
+
+	// The models whose indices fit in 16 bits store them two per word of the index buffer, the low half first.
+	bool HasShortIndices(const Model& model)
+	{
+		return model.NumberOfVertices() <= 65536;
+	}
+
+	size_t IndexWordCount(const Model& model)
+	{
+		return HasShortIndices(model) ? (size_t(model.NumberOfIndices()) + 1) / 2 : model.NumberOfIndices();
+	}
+
+	// The bytes the Scene constructor reserves for its temporaries below, given the model materials and the proxies it is about to add.
+	// The light indices and the medium voxels are not known yet, the arena grows when the scene has any.
+	size_t BuildArenaSize(const std::vector<Model>& models, const size_t instanceCount, const bool geometryProxies)
+	{
+		const size_t modelCount = models.size();
+		const size_t proxyCount = geometryProxies ? modelCount : 0;
+		const size_t materialCount = std::accumulate(models.begin(), models.end(), size_t(0), [](const size_t sum, const Model& model) { return sum + model.Materials().size(); });
+		const size_t meshCount = modelCount + 1 + proxyCount;
+
+		return
+			(2 * meshCount + modelCount + 2) * sizeof(size_t) +
+			modelCount * (sizeof(std::pmr::vector<int32_t>) + sizeof(glm::vec4) + sizeof(VkAabbPositionsKHR) + sizeof(glm::uvec2) + sizeof(std::pair<glm::vec3, glm::vec3>)) +
+			materialCount * sizeof(int32_t) +
+			instanceCount * ((proxyCount != 0 ? 2 : 1) * sizeof(InstanceData) + 2 * sizeof(DrawData) + 1) +
+			(materialCount + instanceCount) * sizeof(CompactMaterial) +
+			// The alignment padding of every container.
+			64 * alignof(std::max_align_t);
+	}
+
+	// Splits the elements [first, first + count) of the concatenated models into per model ranges,
+	// calling copy(model, first element in the model, first element in the piece, count) for each.
+	template <class Function>
+	void ForEachModelRange(const std::pmr::vector<size_t>& modelOffsets, const size_t first, const size_t count, const Function& copy)
+	{
+		auto model = static_cast<size_t>(std::upper_bound(modelOffsets.begin(), modelOffsets.end(), first) - modelOffsets.begin()) - 1;
+
+		for (size_t done = 0; done != count; ++model)
+		{
+			const auto begin = first + done;
+			const auto size = std::min(modelOffsets[model + 1] - begin, count - done);
+
+			copy(model, begin - modelOffsets[model], done, size);
+			done += size;
+		}
+	}
+}
+
+Scene::Scene(Vulkan::StagingRing& stagingRing, Utilities::TaskSystem& tasks, std::vector<Model>&& models, std::vector<Texture>&& textures, std::vector<ModelInstance>&& instances, const Environment* const environment, const VkDeviceSize textureBudget, const bool compactVertices, const bool positionStream, const bool keepHostGeometry, const bool geometryProxies, const std::vector<uint32_t>& switchedInstances) :
 	models_(std::move(models)),
-	textures_(std::move(textures))
+	instances_(std::move(instances)),
+	compactVertices_(compactVertices),
+	isHostGeometryKept_(keepHostGeometry),
+	hasEnvironment_(environment != nullptr)
 {
-	// Concatenate all the models
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
-	std::vector<Material> materials;
-	std::vector<glm::vec4> procedurals;
-	std::vector<VkAabbPositionsKHR> aabbs;
-	std::vector<glm::uvec2> offsets;
+	PROFILE_ZONE("Scene");
+
+	// Without explicit instances, every model is placed once as is.
+	if (instances_.empty())
+	{
+		for (uint32_t i = 0; i != models_.size(); ++i)
+		{
+			instances_.push_back({ i, glm::mat4(1), {} });
+		}
+	}
+
+	// The temporaries below live in a single arena, sized upfront from the model counts and released at once with the constructor,
+	// once uploaded. Declared first, it outlives all of them.
+	Utilities::Arena arena(BuildArenaSize(models_, instances_.size(), geometryProxies));
+	auto* const resource = arena.Resource();
+
+	const size_t proxyCount = geometryProxies ? models_.size() : 0;
+	const size_t meshCount = models_.size() + 1 + proxyCount;
+
+	// Lay the models out one after the other, the vertices and indices are only concatenated in the staging ring.
+	// The index offsets are in 32-bit words.
+	std::pmr::vector<size_t> vertexOffsets(1, 0, resource);
+	std::pmr::vector<size_t> indexOffsets(1, 0, resource);
+	std::pmr::vector<size_t> triangleOffsets(1, 0, resource);
+	std::pmr::vector<std::pmr::vector<int32_t>> materialIndices(resource); // Of every model material in the registry.
+	MaterialRegistry materials;
+	std::pmr::vector<glm::vec4> procedurals(resource);
+	std::pmr::vector<VkAabbPositionsKHR> aabbs(resource);
+	std::pmr::vector<glm::uvec2> offsets(resource);
+
+	vertexOffsets.reserve(models_.size() + 2);
+	indexOffsets.reserve(meshCount + 1);
+	triangleOffsets.reserve(models_.size() + proxyCount + 1);
+	materialIndices.reserve(models_.size());
+	procedurals.reserve(models_.size());
+	aabbs.reserve(models_.size());
+	offsets.reserve(models_.size());
 
 	for (const auto& model : models_)
 	{
-		// Remember the index, vertex offsets.
-		const auto indexOffset = static_cast<uint32_t>(indices.size());
-		const auto vertexOffset = static_cast<uint32_t>(vertices.size());
-		const auto materialOffset = static_cast<uint32_t>(materials.size());
+		// Remember the first triangle material and vertex offsets.
+		offsets.emplace_back(static_cast<uint32_t>(triangleOffsets.back()), static_cast<uint32_t>(vertexOffsets.back()));
 
-		offsets.emplace_back(indexOffset, vertexOffset);
+		// The procedurals have no geometry, only the triangle material entry their shaders read.
+		vertexOffsets.push_back(vertexOffsets.back() + model.NumberOfVertices());
+		indexOffsets.push_back(indexOffsets.back() + IndexWordCount(model));
+		triangleOffsets.push_back(triangleOffsets.back() + (model.Procedural() != nullptr ? 1 : model.NumberOfIndices() / 3));
 
-		// Copy model data one after the other.
-		vertices.insert(vertices.end(), model.Vertices().begin(), model.Vertices().end());
-		indices.insert(indices.end(), model.Indices().begin(), model.Indices().end());
-		materials.insert(materials.end(), model.Materials().begin(), model.Materials().end());
+		// Register the model materials, the identical ones of other models are shared.
+		auto& modelMaterials = materialIndices.emplace_back();
+		modelMaterials.reserve(model.Materials().size());
 
-		// Adjust the material id.
-		for (size_t i = vertexOffset; i != vertices.size(); ++i)
+		for (const auto& material : model.Materials())
 		{
-			vertices[i].MaterialIndex += materialOffset;
+			modelMaterials.push_back(materials.Add(material));
 		}
 
 		// Add optional procedurals.
@@ -54,52 +301,774 @@ Scene::Scene(Vulkan::CommandPool& commandPool, std::vector<Model>&& models, std:
 		}
 		else
 		{
-			aabbs.emplace_back();
+			// A NaN minimum makes the AABB inactive, so that it can safely be part of a merged procedural BLAS.
+			const auto nan = std::numeric_limits<float>::quiet_NaN();
+			aabbs.push_back({nan, 0, 0, 0, 0, 0});
 			procedurals.emplace_back();
 		}
 	}
 
+	// The rasterizer draws the procedural spheres from a single unit sphere mesh laid out after the models (see Graphics.vert),
+	// the vertex and index writes see it as one more model.
+	const bool hasSpheres = std::any_of(procedurals.begin(), procedurals.end(), [](const glm::vec4& sphere) { return sphere.w > 0; });
+	const Model sphereMesh = Model::CreateSphere(glm::vec3(0), 1, Material::Lambertian(glm::vec3(1)), false);
+	const size_t sphereMeshIndex = models_.size();
+
+	if (hasSpheres)
+	{
+		vertexOffsets.push_back(vertexOffsets.back() + sphereMesh.NumberOfVertices());
+		indexOffsets.push_back(indexOffsets.back() + IndexWordCount(sphereMesh));
+	}
+
+	const auto geometry = [this, &sphereMesh](const size_t model) -> const Model& { return model < models_.size() ? models_[model] : sphereMesh; };
+
+	// The proxies are simplified on the worker threads, then laid out after the models and the sphere mesh as more models,
+	// the index writes see them from firstProxyMesh on.
+	std::vector<std::vector<uint32_t>> proxies(proxyCount);
+	std::vector<std::future<void>> simplifications;
+
+	for (size_t i = 0; i != proxies.size(); ++i)
+	{
+		const auto& model = models_[i];
+		const auto target = std::max(size_t(model.NumberOfIndices()) / ProxyRatio, ProxyMinTriangles * 3);
+
+		if (model.Procedural() == nullptr && target < model.NumberOfIndices())
+		{
+			simplifications.push_back(tasks.Run([&model, &proxy = proxies[i], target]()
+			{
+				proxy = MeshOptimizer::SimplifySloppy(model.Vertices(), model.Indices(), target);
+			}));
+		}
+	}
+
+	// All the tasks reference the proxies, the first failure is only rethrown once they are done.
+	for (auto& simplification : simplifications)
+	{
+		simplification.wait();
+	}
+
+	for (auto& simplification : simplifications)
+	{
+		simplification.get();
+	}
+
+	const size_t firstProxyMesh = indexOffsets.size() - 1;
+
+	for (size_t i = 0; i != proxies.size(); ++i)
+	{
+		indexOffsets.push_back(indexOffsets.back() + (HasShortIndices(models_[i]) ? (proxies[i].size() + 1) / 2 : proxies[i].size()));
+		triangleOffsets.push_back(triangleOffsets.back() + proxies[i].size() / 3);
+	}
+
+	const auto meshModel = [&geometry, firstProxyMesh](const size_t mesh) -> const Model& { return geometry(mesh < firstProxyMesh ? mesh : mesh - firstProxyMesh); };
+	const auto meshIndices = [&geometry, &proxies, firstProxyMesh](const size_t mesh) -> const std::vector<uint32_t>& { return mesh < firstProxyMesh ? geometry(mesh).Indices() : proxies[mesh - firstProxyMesh]; };
+
+	// Per instance transform and optional material override.
+	// The instances of an isotropic material are participating media rather than surfaces, no ray hits their boundary.
+	std::pmr::vector<InstanceData> instanceData(resource);
+	std::pmr::vector<std::pair<size_t, Material>> mediumInstances(resource);
+	std::pmr::vector<bool> isMedium(instances_.size(), false, resource);
+
+	instanceData.reserve(instances_.size() * (proxyCount != 0 ? 2 : 1));
+
+	for (auto& instance : instances_)
+	{
+		if (instance.ModelId >= models_.size())
+		{
+			Throw(std::runtime_error("instance model id is out of range"));
+		}
+
+		int32_t materialIndex = -1;
+
+		if (instance.MaterialOverride)
+		{
+			materialIndex = materials.Add(*instance.MaterialOverride);
+		}
+
+		// The procedural spheres are rasterized from the sphere mesh, whose indices are short.
+		const auto& model = models_[instance.ModelId];
+		const auto* const material = instance.MaterialOverride ? &*instance.MaterialOverride : model.Materials().size() == 1 ? &model.Materials()[0] : nullptr;
+
+		if (material != nullptr && material->MaterialModel == Material::Enum::Isotropic)
+		{
+			isMedium[instanceData.size()] = true;
+			mediumInstances.emplace_back(instanceData.size(), *material);
+			instance.RayMask = 0;
+		}
+
+		const uint32_t shortIndices = model.Procedural() != nullptr || HasShortIndices(model) ? 1 : 0;
+
+		instanceData.push_back({ instance.Transform, instance.ModelId, materialIndex, shortIndices, instance.RayMask, 0, 0, 0, ~0u, 0 });
+	}
+
+	// Every emissive triangle of every instance, moved to world space. The shaders pick them proportionally to their power,
+	// or through the light tree. Their hits find them back through the per triangle light indices of their instance.
+	std::vector<LightTree::Triangle> lightTriangles;
+	std::pmr::vector<uint32_t> lightIndices(resource);
+
+	for (size_t i = 0; i != instances_.size(); ++i)
+	{
+		const auto& instance = instances_[i];
+		const auto& model = models_[instance.ModelId];
+		const auto& vertices = model.Vertices();
+		const auto& indices = model.Indices();
+		const auto lightOffset = lightIndices.size();
+
+		if (model.Procedural() != nullptr)
+		{
+			continue;
+		}
+
+		lightIndices.resize(lightOffset + indices.size() / 3, ~0u);
+
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			const auto materialIndex = instanceData[i].MaterialIndex >= 0
+				? instanceData[i].MaterialIndex
+				: materialIndices[instance.ModelId][vertices[indices[t]].MaterialIndex];
+			const auto& material = materials.Materials()[materialIndex];
+
+			if (material.MaterialModel != Material::Enum::DiffuseLight)
+			{
+				continue;
+			}
+
+			const LightSource source = {
+				static_cast<uint32_t>(i),
+				vertices[indices[t + 0]].Position,
+				vertices[indices[t + 1]].Position,
+				vertices[indices[t + 2]].Position,
+				glm::vec4(glm::vec3(material.Diffuse), 0) };
+			const auto triangle = TransformLight(source.P0, source.P1, source.P2, glm::vec3(source.EmissionAndCdf), instance.Transform);
+
+			if (triangle.Power > 0)
+			{
+				lightIndices[lightOffset + t / 3] = static_cast<uint32_t>(lightSources_.size());
+				lightSources_.push_back(source);
+				lightTriangles.push_back(triangle);
+			}
+		}
+
+		if (std::all_of(lightIndices.begin() + lightOffset, lightIndices.end(), [](const uint32_t light) { return light == ~0u; }))
+		{
+			lightIndices.resize(lightOffset);
+		}
+		else
+		{
+			instanceData[i].LightOffset = static_cast<uint32_t>(lightOffset);
+		}
+	}
+
+	// The light tree is always built, its leaves keep their lights in the order of the light list.
+	lightTree_.Build(lightTriangles, tasks);
+	lightTriangles_ = std::move(lightTriangles);
+	lightTransforms_.resize(instances_.size());
+	std::transform(instances_.begin(), instances_.end(), lightTransforms_.begin(), [](const ModelInstance& instance) { return instance.Transform; });
+
+	UpdateLightProbabilities();
+
+	// Keep valid buffers without lights.
+	std::pmr::vector<LightData> lights(std::max<size_t>(lightSources_.size(), 1), resource);
+
+	for (size_t i = 0; i != lightSources_.size(); ++i)
+	{
+		lights[i] = MakeLight(lightTriangles_[i], lightSources_[i].EmissionAndCdf, lightTree_.Branches(static_cast<uint32_t>(i)));
+	}
+
+	lightCount_ = static_cast<uint32_t>(lightSources_.size());
+	lightIndices.resize(std::max<size_t>(lightIndices.size(), 1));
+
 	constexpr auto flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
 
-	Vulkan::BufferUtil::CreateDeviceBuffer(commandPool, "Vertices", VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | flags, vertices, vertexBuffer_, vertexBufferMemory_);
-	Vulkan::BufferUtil::CreateDeviceBuffer(commandPool, "Indices", VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | flags, indices, indexBuffer_, indexBufferMemory_);
-	Vulkan::BufferUtil::CreateDeviceBuffer(commandPool, "Materials", flags, materials, materialBuffer_, materialBufferMemory_);
-	Vulkan::BufferUtil::CreateDeviceBuffer(commandPool, "Offsets", flags, offsets, offsetBuffer_, offsetBufferMemory_);
+	// The vertices are copied (or packed) on their way to the write combined staging memory, which is never read back.
+	// Their material indices stay those of their model, the shaders only read the per triangle ones.
+	const std::function<void(Vertex*, size_t, size_t)> writeVertices = [&vertexOffsets, &geometry](Vertex* const vertices, const size_t first, const size_t count)
+	{
+		ForEachModelRange(vertexOffsets, first, count, [&](const size_t model, const size_t begin, const size_t offset, const size_t size)
+		{
+			std::copy_n(geometry(model).Vertices().begin() + begin, size, vertices + offset);
+		});
+	};
+
+	const std::function<void(CompactVertex*, size_t, size_t)> writeCompactVertices = [&vertexOffsets, &geometry](CompactVertex* const vertices, const size_t first, const size_t count)
+	{
+		ForEachModelRange(vertexOffsets, first, count, [&](const size_t model, const size_t begin, const size_t offset, const size_t size)
+		{
+			const auto& source = geometry(model).Vertices();
+
+			for (size_t i = 0; i != size; ++i)
+			{
+				vertices[offset + i] = CompactVertex::Pack(source[begin + i]);
+			}
+		});
+	};
+
+	// A triangle uses the material of its first vertex, moved to the registry. A procedural has its single material.
+	const std::function<void(glm::vec3*, size_t, size_t)> writePositions = [&vertexOffsets, &geometry](glm::vec3* const positions, const size_t first, const size_t count)
+	{
+		ForEachModelRange(vertexOffsets, first, count, [&](const size_t model, const size_t begin, const size_t offset, const size_t size)
+		{
+			const auto& source = geometry(model).Vertices();
+
+			for (size_t i = 0; i != size; ++i)
+			{
+				positions[offset + i] = source[begin + i].Position;
+			}
+		});
+	};
+
+	// The proxy triangles follow the same rule, their first vertex being one of their model.
+	const std::function<void(int32_t*, size_t, size_t)> writeTriangleMaterials = [this, &triangleOffsets, &materialIndices, &proxies](int32_t* const materials, const size_t first, const size_t count)
+	{
+		ForEachModelRange(triangleOffsets, first, count, [&](const size_t mesh, const size_t begin, const size_t offset, const size_t size)
+		{
+			const size_t model = mesh < models_.size() ? mesh : mesh - models_.size();
+			const auto& vertices = models_[model].Vertices();
+			const auto& indices = mesh < models_.size() ? models_[model].Indices() : proxies[model];
+			const auto& modelMaterials = materialIndices[model];
+
+			if (models_[model].Procedural() != nullptr)
+			{
+				std::fill_n(materials + offset, size, modelMaterials[0]);
+				return;
+			}
 
-	Vulkan::BufferUtil::CreateDeviceBuffer(commandPool, "AABBs", VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | flags, aabbs, aabbBuffer_, aabbBufferMemory_);
-	Vulkan::BufferUtil::CreateDeviceBuffer(commandPool, "Procedurals", flags, procedurals, proceduralBuffer_, proceduralBufferMemory_);
+			for (size_t i = 0; i != size; ++i)
+			{
+				materials[offset + i] = modelMaterials[vertices[indices[(begin + i) * 3]].MaterialIndex];
+			}
+		});
+	};
+
+	const std::function<void(uint32_t*, size_t, size_t)> writeIndices = [&indexOffsets, &meshModel, &meshIndices](uint32_t* const indices, const size_t first, const size_t count)
+	{
+		ForEachModelRange(indexOffsets, first, count, [&](const size_t mesh, const size_t begin, const size_t offset, const size_t size)
+		{
+			const auto& modelIndices = meshIndices(mesh);
 
-	
-	// Upload all textures
-	textureImages_.reserve(textures_.size());
-	textureImageViewHandles_.resize(textures_.size());
-	textureSamplerHandles_.resize(textures_.size());
+			if (!HasShortIndices(meshModel(mesh)))
+			{
+				std::copy_n(modelIndices.begin() + begin, size, indices + offset);
+				return;
+			}
+
+			// An odd index count leaves the high half of the last word zero.
+			for (size_t i = 0; i != size; ++i)
+			{
+				const size_t index = 2 * (begin + i);
+				const uint32_t high = index + 1 < modelIndices.size() ? modelIndices[index + 1] : 0;
+
+				indices[offset + i] = modelIndices[index] | high << 16;
+			}
+		});
+	};
+
+	if (compactVertices_)
+	{
+		Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Vertices", VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | flags, vertexOffsets.back(), writeCompactVertices, vertexBuffer_, vertexBufferMemory_);
+	}
+	else
+	{
+		Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Vertices", VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | flags, vertexOffsets.back(), writeVertices, vertexBuffer_, vertexBufferMemory_);
+	}
+
+	// The builds then fetch 12 rather than 20 or 36 bytes per vertex, the shaders keep reading the interleaved vertices.
+	if (positionStream)
+	{
+		Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Positions", VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | flags, vertexOffsets.back(), writePositions, positionBuffer_, positionBufferMemory_);
+	}
+
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Indices", VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | flags, indexOffsets.back(), writeIndices, indexBuffer_, indexBufferMemory_);
+
+	// The normals left to the GPU are generated in place once the vertices and indices are uploaded, like the texture mipmaps.
+	// The pipeline lives until the uploads are flushed below.
+	std::vector<Vulkan::NormalsPipeline::Range> normalRanges;
+	std::unique_ptr<Vulkan::NormalsPipeline> normalsPipeline;
+
+	for (size_t i = 0; i != models_.size(); ++i)
+	{
+		if (models_[i].NeedsNormals())
+		{
+			normalRanges.push_back({ static_cast<uint32_t>(vertexOffsets[i]), models_[i].NumberOfVertices(), static_cast<uint32_t>(indexOffsets[i]), models_[i].NumberOfIndices(), HasShortIndices(models_[i]) });
+		}
+	}
+
+	if (!normalRanges.empty())
+	{
+		normalsPipeline.reset(new Vulkan::NormalsPipeline(stagingRing.Device(), *vertexBuffer_, *indexBuffer_, compactVertices_, normalRanges));
+		normalsPipeline->Dispatch(stagingRing.GraphicsCommandBuffer());
+	}
+
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Materials", flags, materials.Materials(), materialBuffer_, materialBufferMemory_);
+
+	materialCount_ = static_cast<uint32_t>(materials.Materials().size());
+	modelMaterialCount_ = static_cast<uint32_t>(materials.AddedCount());
+
+	// The packed copy is small enough to always be there, the pipeline variants pick either layout (see --compact-materials).
+	std::pmr::vector<CompactMaterial> compactMaterials(materials.Materials().size(), resource);
+	std::transform(materials.Materials().begin(), materials.Materials().end(), compactMaterials.begin(), &CompactMaterial::Pack);
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Compact Materials", flags, compactMaterials, compactMaterialBuffer_, compactMaterialBufferMemory_);
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Triangle Materials", flags, triangleOffsets.back(), writeTriangleMaterials, triangleMaterialBuffer_, triangleMaterialBufferMemory_);
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Offsets", flags, offsets, offsetBuffer_, offsetBufferMemory_);
+
+	for (size_t i = 0; i != models_.size(); ++i)
+	{
+		indexOffsets_.push_back(indexOffsets[i] * sizeof(uint32_t));
+		indexTypes_.push_back(HasShortIndices(models_[i]) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+	}
 
-	for (size_t i = 0; i != textures_.size(); ++i)
+	for (size_t i = 0; i != proxies.size(); ++i)
 	{
-	   textureImages_.emplace_back(new TextureImage(commandPool, textures_[i]));
-	   textureImageViewHandles_[i] = textureImages_[i]->ImageView().Handle();
-	   textureSamplerHandles_[i] = textureImages_[i]->Sampler().Handle();
+		proxyIndexCounts_.push_back(static_cast<uint32_t>(proxies[i].size()));
+		proxyIndexOffsets_.push_back(indexOffsets[firstProxyMesh + i] * sizeof(uint32_t));
 	}
+
+	// The instances point straight at their model geometry, sparing the shaders the offsets lookup.
+	const auto vertexAddress = vertexBuffer_->GetDeviceAddress();
+	const auto indexAddress = indexBuffer_->GetDeviceAddress();
+	const auto triangleMaterialAddress = triangleMaterialBuffer_->GetDeviceAddress();
+
+	for (auto& instance : instanceData)
+	{
+		const size_t mesh = procedurals[instance.ModelIndex].w > 0 ? sphereMeshIndex : instance.ModelIndex;
+
+		instance.VertexAddress = vertexAddress + vertexOffsets[mesh] * VertexStride();
+		instance.IndexAddress = indexAddress + indexOffsets[mesh] * sizeof(uint32_t);
+		instance.TriangleMaterialAddress = triangleMaterialAddress + triangleOffsets[instance.ModelIndex] * sizeof(int32_t);
+	}
+
+	// The proxy records only differ by their geometry. They have no lights, the emissive models are never traced through their proxy.
+	for (size_t i = 0, count = proxies.empty() ? 0 : instanceData.size(); i != count; ++i)
+	{
+		auto proxy = instanceData[i];
+
+		proxy.IndexAddress = indexAddress + indexOffsets[firstProxyMesh + proxy.ModelIndex] * sizeof(uint32_t);
+		proxy.TriangleMaterialAddress = triangleMaterialAddress + triangleOffsets[models_.size() + proxy.ModelIndex] * sizeof(int32_t);
+		proxy.LightOffset = ~0u;
+
+		instanceData.push_back(proxy);
+	}
+
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Instances", flags, instanceData, instanceBuffer_, instanceBufferMemory_);
+
+	// The rasterizer draws every instance with its own indirect draw, the culling pass only needs the model bounds and index range.
+	// The model bounding boxes are only kept once the geometry is released, they are computed from the vertices here.
+	std::pmr::vector<std::pair<glm::vec3, glm::vec3>> modelBounds(resource);
+	modelBounds.reserve(models_.size());
+
+	for (const auto& model : models_)
+	{
+		if (model.Procedural() != nullptr)
+		{
+			modelBounds.push_back(model.Procedural()->BoundingBox());
+			continue;
+		}
+
+		const auto& vertices = model.Vertices();
+		auto bounds = vertices.empty() ? std::make_pair(glm::vec3(0), glm::vec3(0)) : std::make_pair(vertices[0].Position, vertices[0].Position);
+
+		for (const auto& vertex : vertices)
+		{
+			bounds.first = glm::min(bounds.first, vertex.Position);
+			bounds.second = glm::max(bounds.second, vertex.Position);
+		}
+
+		modelBounds.push_back(bounds);
+	}
+
+	// The records and draws of any model a switched instance may point at.
+	for (size_t i = 0, count = switchedInstances.empty() ? 0 : models_.size(); i != count; ++i)
+	{
+		const bool isShort = HasShortIndices(models_[i]);
+
+		modelGeometries_.push_back({
+			vertexAddress + vertexOffsets[i] * VertexStride(),
+			indexAddress + indexOffsets[i] * sizeof(uint32_t),
+			triangleMaterialAddress + triangleOffsets[i] * sizeof(int32_t),
+			isShort ? 1u : 0u,
+			models_[i].NumberOfIndices(),
+			static_cast<uint32_t>(indexOffsets[i] * (isShort ? 2 : 1)),
+			modelBounds[i].first,
+			modelBounds[i].second });
+	}
+
+	// The media keep the bounds of their model in the local space of their instance, at its initial transform.
+	// The density grids are laid out one after the other in the voxel buffer, each followed by its majorants.
+	std::pmr::vector<MediumData> media(resource);
+	std::pmr::vector<float> mediumVoxels(resource);
+
+	for (const auto& [index, material] : mediumInstances)
+	{
+		const auto& instance = instances_[index];
+		const auto& bounds = modelBounds[instance.ModelId];
+		const auto* const grid = models_[instance.ModelId].DensityGrid();
+		MediumData medium{};
+
+		medium.WorldToLocal = glm::inverse(instance.Transform);
+		medium.BoundsMinAndShape = glm::vec4(bounds.first, procedurals[instance.ModelId].w > 0 ? 1 : 0);
+		medium.BoundsMaxAndDensity = glm::vec4(bounds.second, material.Density);
+		medium.Albedo = glm::vec4(glm::vec3(material.Diffuse), 0);
+
+		if (grid != nullptr)
+		{
+			medium.Grid = glm::uvec4(grid->Resolution(), static_cast<uint32_t>(mediumVoxels.size()));
+			mediumVoxels.insert(mediumVoxels.end(), grid->Densities().begin(), grid->Densities().end());
+			medium.MajorantGrid = glm::uvec4(grid->MajorantResolution(), static_cast<uint32_t>(mediumVoxels.size()));
+			mediumVoxels.insert(mediumVoxels.end(), grid->Majorants().begin(), grid->Majorants().end());
+		}
+
+		media.push_back(medium);
+	}
+
+	mediumCount_ = static_cast<uint32_t>(media.size());
+
+	// Keep valid buffers without media.
+	media.resize(std::max<size_t>(media.size(), 1));
+	mediumVoxels.resize(std::max<size_t>(mediumVoxels.size(), 1));
+
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Media", flags, media, mediumBuffer_, mediumBufferMemory_);
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Medium Voxels", flags, mediumVoxels, mediumVoxelBuffer_, mediumVoxelBufferMemory_);
+
+	// The draws of the instances with short indices come first, the rasterizer binds the index buffer once per width.
+	// The media have no surface to rasterize, their draws are empty. The switched instances have a draw of either width,
+	// the one their model does not have being empty.
+	std::pmr::vector<DrawData> draws(resource);
+	std::pmr::vector<DrawData> longIndexDraws(resource);
+
+	draws.reserve(instances_.size());
+	longIndexDraws.reserve(instances_.size());
+
+	std::pmr::vector<bool> isSwitched(instances_.size(), false, resource);
+
+	if (!switchedInstances.empty())
+	{
+		switchedInstances_.assign(instances_.size(), { NoDraw, NoDraw, -1 });
+	}
+
+	for (const auto i : switchedInstances)
+	{
+		if (i >= instances_.size() || isMedium[i] || instanceData[i].LightOffset != ~0u)
+		{
+			Throw(std::runtime_error("switched instance " + std::to_string(i) + " is out of range, emissive or a medium"));
+		}
+
+		isSwitched[i] = true;
+		switchedInstances_[i].MaterialIndex = instanceData[i].MaterialIndex;
+	}
+
+	for (size_t i = 0; i != instances_.size(); ++i)
+	{
+		const auto& instance = instances_[i];
+		const auto& bounds = modelBounds[instance.ModelId];
+		const bool isSphere = procedurals[instance.ModelId].w > 0;
+		const size_t mesh = isSphere ? sphereMeshIndex : instance.ModelId;
+		const uint32_t indexCount = isMedium[i] ? 0 : isSphere ? sphereMesh.NumberOfIndices() : models_[instance.ModelId].NumberOfIndices();
+		const bool isShort = instanceData[i].ShortIndices != 0;
+		const DrawData draw = {
+			glm::vec4(bounds.first, 0), glm::vec4(bounds.second, 0), indexCount,
+			static_cast<uint32_t>(indexOffsets[mesh] * (isShort ? 2 : 1)), static_cast<uint32_t>(i), 0 };
+
+		if (!isSwitched[i])
+		{
+			(isShort ? draws : longIndexDraws).push_back(draw);
+			continue;
+		}
+
+		const DrawData empty = { draw.BoundsMin, draw.BoundsMax, 0, 0, draw.InstanceIndex, 0 };
+
+		switchedInstances_[i].ShortDraw = static_cast<uint32_t>(draws.size());
+		switchedInstances_[i].LongDraw = static_cast<uint32_t>(longIndexDraws.size());
+		draws.push_back(isShort ? draw : empty);
+		longIndexDraws.push_back(isShort ? empty : draw);
+	}
+
+	shortIndexDrawCount_ = static_cast<uint32_t>(draws.size());
+	draws.insert(draws.end(), longIndexDraws.begin(), longIndexDraws.end());
+	drawCount_ = static_cast<uint32_t>(draws.size());
+
+	for (auto& switched : switchedInstances_)
+	{
+		switched.LongDraw += switched.LongDraw != NoDraw ? shortIndexDrawCount_ : 0;
+	}
+
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Draws", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, draws, drawBuffer_, drawBufferMemory_);
+
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "AABBs", VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | flags, aabbs, aabbBuffer_, aabbBufferMemory_);
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Procedurals", flags, procedurals, proceduralBuffer_, proceduralBufferMemory_);
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Lights", flags, lights, lightBuffer_, lightBufferMemory_);
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Light Nodes", flags, lightTree_.Nodes(), lightNodeBuffer_, lightNodeBufferMemory_);
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Light Indices", flags, lightIndices, lightIndexBuffer_, lightIndexBufferMemory_);
+
+	// Keep a valid buffer without environment, the shaders check its width.
+	const std::vector<glm::uvec4> noEnvironment(1);
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Environment", flags, environment ? environment->Texels() : noEnvironment, environmentBuffer_, environmentBufferMemory_);
+
+	// The shaders reach all the scene buffers through this single table, the pipelines only bind it once.
+	const std::vector<SceneBufferTableData> table =
+	{
+		{
+			materialBuffer_->GetDeviceAddress(),
+			offsetBuffer_->GetDeviceAddress(),
+			proceduralBuffer_->GetDeviceAddress(),
+			instanceBuffer_->GetDeviceAddress(),
+			triangleMaterialBuffer_->GetDeviceAddress(),
+			lightBuffer_->GetDeviceAddress(),
+			environmentBuffer_->GetDeviceAddress(),
+			environment ? environment->Width() : 0,
+			environment ? environment->Height() : 0,
+			environment ? environment->PdfScale() : 0,
+			mediumCount_,
+			compactMaterialBuffer_->GetDeviceAddress(),
+			lightNodeBuffer_->GetDeviceAddress(),
+			lightIndexBuffer_->GetDeviceAddress(),
+			mediumBuffer_->GetDeviceAddress(),
+			mediumVoxelBuffer_->GetDeviceAddress()
+		}
+	};
+
+	Vulkan::BufferUtil::CreateDeviceBuffer(stagingRing, "Scene Buffer Table", VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, table, sceneBufferTable_, sceneBufferTableMemory_);
+
+	// Upload the low resolution version of all textures, the rest is streamed in on demand.
+	// The sampler does not clamp the levels, whatever the image views of the streamed textures hold.
+	Vulkan::SamplerConfig samplerConfig;
+	samplerConfig.MaxLod = VK_LOD_CLAMP_NONE;
+
+	textureSampler_ = &stagingRing.Device().Samplers().Get(samplerConfig);
+	textureStreamer_.reset(new TextureStreamer(stagingRing, std::move(textures), textureBudget));
+
+	// Submit all the recorded uploads at once, the host geometry is no longer needed after that.
+	stagingRing.Flush();
+
+	for (auto& model : models_)
+	{
+		keepHostGeometry ? model.HashGeometry() : model.ReleaseGeometry();
+	}
+
+	buildArenaSize_ = arena.Size();
+	buildArenaBlockCount_ = arena.BlockCount();
+}
+
+void Scene::UpdateLights(const VkCommandBuffer commandBuffer, const std::vector<glm::mat4>& transforms)
+{
+	std::vector<uint32_t> moved;
+	bool isPowerChanged = false;
+
+	for (uint32_t light = 0; light != lightSources_.size(); ++light)
+	{
+		const auto& source = lightSources_[light];
+		const auto& transform = transforms[source.Instance];
+
+		if (transform == lightTransforms_[source.Instance])
+		{
+			continue;
+		}
+
+		// Only scaling changes the power of a light, and then the selection probabilities of all of them.
+		const auto triangle = TransformLight(source.P0, source.P1, source.P2, glm::vec3(source.EmissionAndCdf), transform);
+
+		isPowerChanged |= std::abs(triangle.Power - lightTriangles_[light].Power) > 1e-4f * lightTriangles_[light].Power;
+		lightTriangles_[light] = triangle;
+		moved.push_back(light);
+	}
+
+	lightTransforms_ = transforms;
+
+	if (moved.empty())
+	{
+		return;
+	}
+
+	const auto nodes = lightTree_.Refit(lightTriangles_, moved);
+
+	if (isPowerChanged)
+	{
+		UpdateLightProbabilities();
+		moved.resize(lightSources_.size());
+		std::iota(moved.begin(), moved.end(), 0u);
+	}
+
+	// The previous frames may still be sampling the lights, from either backend.
+	InsertMemoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	UpdateBufferRuns<LightData>(commandBuffer, *lightBuffer_, moved, [this](const uint32_t light)
+	{
+		return MakeLight(lightTriangles_[light], lightSources_[light].EmissionAndCdf, lightTree_.Branches(light));
+	});
+
+	UpdateBufferRuns<LightTree::Node>(commandBuffer, *lightNodeBuffer_, nodes, [this](const uint32_t node)
+	{
+		return lightTree_.Nodes()[node];
+	});
+
+	InsertMemoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void Scene::SetInstanceModels(const VkCommandBuffer commandBuffer, const std::vector<std::pair<uint32_t, uint32_t>>& instanceModels)
+{
+	if (instanceModels.empty())
+	{
+		return;
+	}
+
+	// The previous frames may still be reading the records and the draws, from either backend or the rasterizer.
+	constexpr VkPipelineStageFlags readers =
+		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	InsertMemoryBarrier(commandBuffer, readers, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	for (const auto& [index, modelId] : instanceModels)
+	{
+		if (index >= switchedInstances_.size() || switchedInstances_[index].ShortDraw == NoDraw || modelId >= models_.size())
+		{
+			Throw(std::runtime_error("instance " + std::to_string(index) + " cannot switch to model " + std::to_string(modelId)));
+		}
+
+		auto& instance = instances_[index];
+		const auto& switched = switchedInstances_[index];
+		const auto& geometry = modelGeometries_[modelId];
+
+		instance.ModelId = modelId;
+
+		const InstanceGeometryData record = {
+			modelId, switched.MaterialIndex, geometry.ShortIndices, instance.RayMask,
+			geometry.VertexAddress, geometry.IndexAddress, geometry.TriangleMaterialAddress };
+
+		vkCmdUpdateBuffer(commandBuffer, instanceBuffer_->Handle(), index * sizeof(InstanceData) + offsetof(InstanceData, ModelIndex), sizeof(record), &record);
+
+		const DrawData draw = { glm::vec4(geometry.BoundsMin, 0), glm::vec4(geometry.BoundsMax, 0), geometry.IndexCount, geometry.FirstIndex, index, 0 };
+		const DrawData empty = { draw.BoundsMin, draw.BoundsMax, 0, 0, index, 0 };
+		const bool isShort = geometry.ShortIndices != 0;
+
+		vkCmdUpdateBuffer(commandBuffer, drawBuffer_->Handle(), switched.ShortDraw * sizeof(DrawData), sizeof(DrawData), isShort ? &draw : &empty);
+		vkCmdUpdateBuffer(commandBuffer, drawBuffer_->Handle(), switched.LongDraw * sizeof(DrawData), sizeof(DrawData), isShort ? &empty : &draw);
+	}
+
+	InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, readers, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void Scene::UpdateLightProbabilities()
+{
+	// Turn the powers into cumulative probabilities.
+	float cumulativePower = 0;
+	lightPower_ = 0;
+
+	for (const auto& triangle : lightTriangles_)
+	{
+		lightPower_ += triangle.Power;
+	}
+
+	for (size_t i = 0; i != lightSources_.size(); ++i)
+	{
+		cumulativePower += lightTriangles_[i].Power;
+		lightSources_[i].EmissionAndCdf.w = cumulativePower / lightPower_;
+	}
+
+	if (!lightSources_.empty())
+	{
+		lightSources_.back().EmissionAndCdf.w = 1;
+	}
+}
+
+void Scene::ReleaseHostGeometry()
+{
+	if (!isHostGeometryKept_)
+	{
+		return;
+	}
+
+	for (auto& model : models_)
+	{
+		model.ReleaseGeometry();
+	}
+
+	isHostGeometryKept_ = false;
 }
 
 Scene::~Scene()
 {
-	textureSamplerHandles_.clear();
-	textureImageViewHandles_.clear();
-	textureImages_.clear();
+	textureStreamer_.reset();
+	sceneBufferTable_.reset();
+	sceneBufferTableMemory_.reset(); // release memory after bound buffer has been destroyed
+	environmentBuffer_.reset();
+	environmentBufferMemory_.reset(); // release memory after bound buffer has been destroyed
+	lightBuffer_.reset();
+	lightBufferMemory_.reset(); // release memory after bound buffer has been destroyed
 	proceduralBuffer_.reset();
 	proceduralBufferMemory_.reset(); // release memory after bound buffer has been destroyed
 	aabbBuffer_.reset();
 	aabbBufferMemory_.reset(); // release memory after bound buffer has been destroyed
+	drawBuffer_.reset();
+	drawBufferMemory_.reset(); // release memory after bound buffer has been destroyed
+	instanceBuffer_.reset();
+	instanceBufferMemory_.reset(); // release memory after bound buffer has been destroyed
 	offsetBuffer_.reset();
 	offsetBufferMemory_.reset(); // release memory after bound buffer has been destroyed
+	triangleMaterialBuffer_.reset();
+	triangleMaterialBufferMemory_.reset(); // release memory after bound buffer has been destroyed
+	compactMaterialBuffer_.reset();
+	compactMaterialBufferMemory_.reset(); // release memory after bound buffer has been destroyed
 	materialBuffer_.reset();
 	materialBufferMemory_.reset(); // release memory after bound buffer has been destroyed
 	indexBuffer_.reset();
 	indexBufferMemory_.reset(); // release memory after bound buffer has been destroyed
+	positionBuffer_.reset();
+	positionBufferMemory_.reset(); // release memory after bound buffer has been destroyed
 	vertexBuffer_.reset();
 	vertexBufferMemory_.reset(); // release memory after bound buffer has been destroyed
 }
 
+VkDeviceSize Scene::VertexStride() const
+{
+	return compactVertices_ ? VertexLayout<CompactVertex>::Stride : VertexLayout<Vertex>::Stride;
+}
+
+VkDeviceSize Scene::VertexPositionOffset() const
+{
+	return compactVertices_ ? VertexLayout<CompactVertex>::Position.Offset : VertexLayout<Vertex>::Position.Offset;
+}
+
+VkDeviceSize Scene::TextureMemorySize() const
+{
+	return textureStreamer_->MemorySize();
+}
+
+VkDeviceSize Scene::TextureBudget() const
+{
+	return textureStreamer_->Budget();
+}
+
+uint32_t Scene::CompressedTextureCount() const
+{
+	return textureStreamer_->CompressedTextureCount();
+}
+
+uint32_t Scene::TextureCount() const
+{
+	return textureStreamer_->TextureCount();
+}
+
+void Scene::UpdateTextures(Vulkan::StagingRing& stagingRing, Utilities::TaskSystem& tasks, const std::vector<int32_t>& requests, const size_t framesInFlight)
+{
+	textureStreamer_->Update(stagingRing, tasks, requests, framesInFlight);
+}
+
+uint64_t Scene::TextureGeneration() const
+{
+	return textureStreamer_->Generation();
+}
+
+const std::vector<VkDescriptorImageInfo>& Scene::TextureImageInfos() const
+{
+	return textureStreamer_->ImageInfos();
+}
+
+VkSampler Scene::TextureSampler() const
+{
+	return textureSampler_->Handle();
+}
+
 }
@@ -1,22 +1,32 @@
 #pragma once
 
+#include "LightTree.hpp"
+#include "ModelInstance.hpp"
 #include "Vulkan/Vulkan.hpp"
 #include <memory>
+#include <utility>
 #include <vector>
 
+namespace Utilities
+{
+	class TaskSystem;
+}
+
 namespace Vulkan
 {
 	class Buffer;
-	class CommandPool;
 	class DeviceMemory;
 	class Image;
+	class Sampler;
+	class StagingRing;
 }
 
 namespace Assets
 {
+	class Environment;
 	class Model;
 	class Texture;
-	class TextureImage;
+	class TextureStreamer;
 
 	class Scene final
 	{
@@ -27,47 +37,214 @@ namespace Assets
 		Scene& operator = (const Scene&) = delete;
 		Scene& operator = (Scene&&) = delete;
 
-		Scene(Vulkan::CommandPool& commandPool, std::vector<Model>&& models, std::vector<Texture>&& textures);
+		Scene(Vulkan::StagingRing& stagingRing, Utilities::TaskSystem& tasks, std::vector<Model>&& models, std::vector<Texture>&& textures, std::vector<ModelInstance>&& instances, const Environment* environment, VkDeviceSize textureBudget, bool compactVertices, bool positionStream, bool keepHostGeometry, bool geometryProxies, const std::vector<uint32_t>& switchedInstances);
 		~Scene();
 
+		// The host vertices and indices are kept after the upload when building the acceleration structures on the host, until this is called.
+		void ReleaseHostGeometry();
+
 		const std::vector<Model>& Models() const { return models_; }
+		const std::vector<ModelInstance>& Instances() const { return instances_; }
 		bool HasProcedurals() const { return static_cast<bool>(proceduralBuffer_); }
 
+		// The emissive triangles in world space, for the explicit light sampling (see Light.glsl).
+		// The power is the sum of the triangle areas weighted by the luminance of their emission.
+		uint32_t LightCount() const { return lightCount_; }
+		float LightPower() const { return lightPower_; }
+
+		// The instances of an isotropic material, which are participating media rather than surfaces (see Medium.glsl).
+		// They fill the bounds of their model at their initial transform, or its sphere for the procedural ones, and get a zero ray mask.
+		uint32_t MediumCount() const { return mediumCount_; }
+
+		// Moves the lights of the instances whose transform changed and refits the light tree over them, recording the uploads
+		// of what changed into the frame command buffer. The tree keeps the topology of the initial transforms.
+		void UpdateLights(VkCommandBuffer commandBuffer, const std::vector<glm::mat4>& transforms);
+
+		// Points the switched instances given at construction (the view-dependent levels of detail) at other models, recording the uploads
+		// of their instance records and draws into the frame command buffer. Each of them has a draw of either index width, one of them empty.
+		void SetInstanceModels(VkCommandBuffer commandBuffer, const std::vector<std::pair<uint32_t, uint32_t>>& instanceModels);
+
+		// The distinct materials in the material buffer, and how many the models and instance overrides had between them.
+		uint32_t MaterialCount() const { return materialCount_; }
+		uint32_t ModelMaterialCount() const { return modelMaterialCount_; }
+
+		// The heap bytes and blocks the arena of the construction temporaries took, released once the scene was uploaded.
+		size_t BuildArenaSize() const { return buildArenaSize_; }
+		size_t BuildArenaBlockCount() const { return buildArenaBlockCount_; }
+
+		bool HasEnvironment() const { return hasEnvironment_; } // Lighting the misses in place of the sky, see Environment.
+
+		// The device vertex buffer holds either Vertex or CompactVertex elements, the material indices are per triangle in both cases.
+		bool CompactVertices() const { return compactVertices_; }
+		VkDeviceSize VertexStride() const;
+		VkDeviceSize VertexPositionOffset() const; // Of the position within a vertex, see Assets::VertexLayout.
+
+		// Optionally, the positions alone are also tightly packed in their own buffer, at the same vertex offsets, for the acceleration structure builds.
+		bool HasPositionBuffer() const { return static_cast<bool>(positionBuffer_); }
+
+		// The models with at most 65536 vertices have 16-bit indices, packed two per word (see FetchIndex() in Vertex.glsl).
+		// The offsets are in bytes from the start of the index buffer, always 4 byte aligned.
+		VkIndexType IndexType(size_t model) const { return indexTypes_[model]; }
+		VkDeviceSize IndexOffset(size_t model) const { return indexOffsets_[model]; }
+		uint32_t ShortIndexDrawCount() const { return shortIndexDrawCount_; } // The first draws of the draw buffer, the others have 32-bit indices.
+		uint32_t DrawCount() const { return drawCount_; }
+
+		// With geometry proxies (see --geometry-budget), the large triangle models also have a coarse simplification of their triangles,
+		// indexing their vertices in the width of their own indices. The proxies are laid out after the models in the index and triangle
+		// material buffers, the instance records from ProxyInstanceOffset() on are those of the instances traced through their proxy.
+		// A model without proxy has a zero index count.
+		bool HasProxies() const { return !proxyIndexCounts_.empty(); }
+		uint32_t ProxyInstanceOffset() const { return static_cast<uint32_t>(instances_.size()); }
+		uint32_t ProxyIndexCount(size_t model) const { return proxyIndexCounts_[model]; }
+		VkDeviceSize ProxyIndexOffset(size_t model) const { return proxyIndexOffsets_[model]; }
+
+		// Device memory used by the texture images, their streaming budget and the number of block compressed ones.
+		VkDeviceSize TextureMemorySize() const;
+		VkDeviceSize TextureBudget() const;
+		uint32_t CompressedTextureCount() const;
+		uint32_t TextureCount() const;
+
+		// Streams the textures in and out according to the footprints sampled by the frame (see TextureStreamer).
+		// The texture image infos change whenever the texture generation does.
+		void UpdateTextures(Vulkan::StagingRing& stagingRing, Utilities::TaskSystem& tasks, const std::vector<int32_t>& requests, size_t framesInFlight);
+		uint64_t TextureGeneration() const;
+
 		const Vulkan::Buffer& VertexBuffer() const { return *vertexBuffer_; }
+		const Vulkan::Buffer& PositionBuffer() const { return *positionBuffer_; }
 		const Vulkan::Buffer& IndexBuffer() const { return *indexBuffer_; }
 		const Vulkan::Buffer& MaterialBuffer() const { return *materialBuffer_; }
+		const Vulkan::Buffer& TriangleMaterialBuffer() const { return *triangleMaterialBuffer_; }
 		const Vulkan::Buffer& OffsetsBuffer() const { return *offsetBuffer_; }
+		const Vulkan::Buffer& InstanceBuffer() const { return *instanceBuffer_; }
+		const Vulkan::Buffer& DrawBuffer() const { return *drawBuffer_; } // The model bounds, index range and instance of every draw, see Vulkan::CullingPipeline.
 		const Vulkan::Buffer& AabbBuffer() const { return *aabbBuffer_; }
 		const Vulkan::Buffer& ProceduralBuffer() const { return *proceduralBuffer_; }
-		const std::vector<VkImageView> TextureImageViews() const { return textureImageViewHandles_; }
-		const std::vector<VkSampler> TextureSamplers() const { return textureSamplerHandles_; }
+		const Vulkan::Buffer& LightBuffer() const { return *lightBuffer_; }
+		const Vulkan::Buffer& LightNodeBuffer() const { return *lightNodeBuffer_; } // See LightTree.
+		const Vulkan::Buffer& LightIndexBuffer() const { return *lightIndexBuffer_; } // The light of every triangle of the instances with some.
+		const Vulkan::Buffer& EnvironmentBuffer() const { return *environmentBuffer_; }
+		const Vulkan::Buffer& MediumBuffer() const { return *mediumBuffer_; }
+		const Vulkan::Buffer& MediumVoxelBuffer() const { return *mediumVoxelBuffer_; } // The density grids and their majorants, see DensityGrid.
+		const Vulkan::Buffer& SceneBufferTable() const { return *sceneBufferTable_; } // The device addresses of the buffers above, see SceneBuffers.glsl.
+		const std::vector<VkDescriptorImageInfo>& TextureImageInfos() const; // Of the sampled images, see TextureStreamer::ImageInfos().
+		VkSampler TextureSampler() const; // Shared by all the texture image views, bound on its own (see Scatter.glsl).
 
 	private:
 
-		const std::vector<Model> models_;
-		const std::vector<Texture> textures_;
+		// An emissive triangle of the light list, in the object space of its instance.
+		struct LightSource final
+		{
+			uint32_t Instance;
+			glm::vec3 P0;
+			glm::vec3 P1;
+			glm::vec3 P2;
+			glm::vec4 EmissionAndCdf;
+		};
+
+		// The geometry of a model as its instance records and draws see it, kept for the switched instances.
+		struct ModelGeometry final
+		{
+			VkDeviceAddress VertexAddress;
+			VkDeviceAddress IndexAddress;
+			VkDeviceAddress TriangleMaterialAddress;
+			uint32_t ShortIndices;
+			uint32_t IndexCount;
+			uint32_t FirstIndex; // In indices of its width.
+			glm::vec3 BoundsMin;
+			glm::vec3 BoundsMax;
+		};
+
+		// The draws of a switched instance in either index width, and its material override.
+		struct SwitchedInstance final
+		{
+			uint32_t ShortDraw;
+			uint32_t LongDraw;
+			int32_t MaterialIndex;
+		};
+
+		void UpdateLightProbabilities();
+
+		std::vector<Model> models_;
+		std::vector<ModelInstance> instances_;
+		const bool compactVertices_;
+		bool isHostGeometryKept_;
+		uint32_t lightCount_{};
+		float lightPower_{};
+		uint32_t mediumCount_{};
+		std::vector<LightSource> lightSources_;
+		std::vector<LightTree::Triangle> lightTriangles_; // In world space, at the last instance transforms.
+		std::vector<glm::mat4> lightTransforms_;
+		LightTree lightTree_;
+		bool hasEnvironment_{};
+		uint32_t materialCount_{};
+		uint32_t modelMaterialCount_{};
+		size_t buildArenaSize_{};
+		size_t buildArenaBlockCount_{};
+		std::vector<VkDeviceSize> indexOffsets_;
+		std::vector<VkIndexType> indexTypes_;
+		uint32_t shortIndexDrawCount_{};
+		uint32_t drawCount_{};
+		std::vector<ModelGeometry> modelGeometries_; // Empty without switched instances.
+		std::vector<SwitchedInstance> switchedInstances_; // Per instance, those not switched have no draws.
+		std::vector<uint32_t> proxyIndexCounts_;
+		std::vector<VkDeviceSize> proxyIndexOffsets_;
 
 		std::unique_ptr<Vulkan::Buffer> vertexBuffer_;
 		std::unique_ptr<Vulkan::DeviceMemory> vertexBufferMemory_;
 
+		std::unique_ptr<Vulkan::Buffer> positionBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> positionBufferMemory_;
+
 		std::unique_ptr<Vulkan::Buffer> indexBuffer_;
 		std::unique_ptr<Vulkan::DeviceMemory> indexBufferMemory_;
 
 		std::unique_ptr<Vulkan::Buffer> materialBuffer_;
 		std::unique_ptr<Vulkan::DeviceMemory> materialBufferMemory_;
 
+		std::unique_ptr<Vulkan::Buffer> compactMaterialBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> compactMaterialBufferMemory_;
+
+		std::unique_ptr<Vulkan::Buffer> triangleMaterialBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> triangleMaterialBufferMemory_;
+
 		std::unique_ptr<Vulkan::Buffer> offsetBuffer_;
 		std::unique_ptr<Vulkan::DeviceMemory> offsetBufferMemory_;
 
+		std::unique_ptr<Vulkan::Buffer> instanceBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> instanceBufferMemory_;
+
+		std::unique_ptr<Vulkan::Buffer> drawBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> drawBufferMemory_;
+
 		std::unique_ptr<Vulkan::Buffer> aabbBuffer_;
 		std::unique_ptr<Vulkan::DeviceMemory> aabbBufferMemory_;
 
 		std::unique_ptr<Vulkan::Buffer> proceduralBuffer_;
 		std::unique_ptr<Vulkan::DeviceMemory> proceduralBufferMemory_;
 
-		std::vector<std::unique_ptr<TextureImage>> textureImages_;
-		std::vector<VkImageView> textureImageViewHandles_;
-		std::vector<VkSampler> textureSamplerHandles_;
+		std::unique_ptr<Vulkan::Buffer> lightBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> lightBufferMemory_;
+
+		std::unique_ptr<Vulkan::Buffer> lightNodeBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> lightNodeBufferMemory_;
+
+		std::unique_ptr<Vulkan::Buffer> lightIndexBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> lightIndexBufferMemory_;
+
+		std::unique_ptr<Vulkan::Buffer> environmentBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> environmentBufferMemory_;
+
+		std::unique_ptr<Vulkan::Buffer> mediumBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> mediumBufferMemory_;
+
+		std::unique_ptr<Vulkan::Buffer> mediumVoxelBuffer_;
+		std::unique_ptr<Vulkan::DeviceMemory> mediumVoxelBufferMemory_;
+
+		std::unique_ptr<Vulkan::Buffer> sceneBufferTable_;
+		std::unique_ptr<Vulkan::DeviceMemory> sceneBufferTableMemory_;
+
+		const Vulkan::Sampler* textureSampler_{};
+		std::unique_ptr<TextureStreamer> textureStreamer_;
 	};
 
 }
@@ -1,16 +1,331 @@
 #include "Texture.hpp"
-#include "Utilities/StbImage.hpp"
+#include "TextureCache.hpp"
 #include "Utilities/Exception.hpp"
+#include "Utilities/MappedFile.hpp"
+#include "Utilities/Profiler.hpp"
+#include "Utilities/StbImage.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <sstream>
+#include <vector>
 
 namespace Assets {
 
+namespace
+{
+	struct Ktx2Header
+	{
+		uint8_t Identifier[12];
+		uint32_t VkFormat;
+		uint32_t TypeSize;
+		uint32_t PixelWidth;
+		uint32_t PixelHeight;
+		uint32_t PixelDepth;
+		uint32_t LayerCount;
+		uint32_t FaceCount;
+		uint32_t LevelCount;
+		uint32_t SupercompressionScheme;
+		uint32_t DfdByteOffset;
+		uint32_t DfdByteLength;
+		uint32_t KvdByteOffset;
+		uint32_t KvdByteLength;
+		uint64_t SgdByteOffset;
+		uint64_t SgdByteLength;
+	};
+
+	struct Ktx2Level
+	{
+		uint64_t ByteOffset;
+		uint64_t ByteLength;
+		uint64_t UncompressedByteLength;
+	};
+
+	struct DdsHeader
+	{
+		uint32_t Magic;
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		uint32_t PixelFormatSize;
+		uint32_t PixelFormatFlags;
+		uint32_t FourCC;
+		uint32_t RgbBitCount;
+		uint32_t BitMasks[4];
+		uint32_t Caps[4];
+		uint32_t Reserved2;
+	};
+
+	struct DdsHeaderDx10
+	{
+		uint32_t DxgiFormat;
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;
+		uint32_t ArraySize;
+		uint32_t MiscFlags2;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 80, "unexpected KTX2 header layout");
+	static_assert(sizeof(DdsHeader) == 128, "unexpected DDS header layout");
+
+	constexpr uint8_t Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	constexpr uint32_t FourCC(const char a, const char b, const char c, const char d)
+	{
+		return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+	}
+
+	// The shaders treat the texels as raw values, sRGB formats are loaded as their UNORM equivalent like the PNG and JPEG files.
+	VkFormat ToSupportedFormat(const VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB: return VK_FORMAT_R8G8B8A8_UNORM;
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK: return VK_FORMAT_BC7_UNORM_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	VkFormat FromDxgiFormat(const uint32_t dxgiFormat)
+	{
+		switch (dxgiFormat)
+		{
+		case 28: // DXGI_FORMAT_R8G8B8A8_UNORM
+		case 29: return VK_FORMAT_R8G8B8A8_UNORM; // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+		case 71: // DXGI_FORMAT_BC1_UNORM
+		case 72: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK; // DXGI_FORMAT_BC1_UNORM_SRGB
+		case 98: // DXGI_FORMAT_BC7_UNORM
+		case 99: return VK_FORMAT_BC7_UNORM_BLOCK; // DXGI_FORMAT_BC7_UNORM_SRGB
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	const char* ToString(const VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: return "BC1";
+		case VK_FORMAT_BC7_UNORM_BLOCK: return "BC7";
+		default: return "RGBA8";
+		}
+	}
+
+	size_t LevelSize(const uint32_t width, const uint32_t height, const VkFormat format)
+	{
+		if (format == VK_FORMAT_R8G8B8A8_UNORM)
+		{
+			return size_t(width) * height * 4;
+		}
+
+		const size_t blockSize = format == VK_FORMAT_BC7_UNORM_BLOCK ? 16 : 8;
+		return size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+	}
+
+	void CopyLevel(const std::string& filename, const Utilities::MappedFile& file, const uint64_t offset, const size_t size, unsigned char* const pixels)
+	{
+		if (offset > file.Size() || size > file.Size() - offset)
+		{
+			Throw(std::runtime_error("truncated texture file '" + filename + "'"));
+		}
+
+		std::memcpy(pixels, file.Data() + offset, size);
+	}
+
+	uint32_t MaxMipLevels(const uint32_t width, const uint32_t height)
+	{
+		uint32_t levels = 1;
+
+		for (auto extent = std::max(width, height); extent > 1; extent /= 2)
+		{
+			++levels;
+		}
+
+		return levels;
+	}
+}
+
 Texture Texture::LoadTexture(const std::string& filename, const Vulkan::SamplerConfig& samplerConfig)
 {
-	std::cout << "- loading '" << filename << "'... " << std::flush;
+	PROFILE_ZONE("LoadTexture");
 	const auto timer = std::chrono::high_resolution_clock::now();
 
+	if (auto cached = TextureCache::Find(filename))
+	{
+		const auto elapsed = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - timer).count();
+
+		std::ostringstream out;
+		out << "- loading '" << filename << "'... ";
+		out << "(" << cached->Width() << " x " << cached->Height() << " " << ToString(cached->Format()) << ", cached) ";
+		out << elapsed << "s" << std::endl;
+		std::cout << out.str() << std::flush;
+
+		cached->samplerConfig_ = samplerConfig;
+		return *cached;
+	}
+
+	Texture texture = Decode(filename);
+	TextureCache::Store(filename, texture);
+	texture.samplerConfig_ = samplerConfig;
+
+	return texture;
+}
+
+Texture Texture::Decode(const std::string& filename)
+{
+	const auto timer = std::chrono::high_resolution_clock::now();
+
+	// Prefer the offline block compressed version of the image when there is one.
+	for (const auto* const extension : { ".ktx2", ".dds" })
+	{
+		const auto compressed = std::filesystem::path(filename).replace_extension(extension).string();
+
+		if (compressed == filename || !std::filesystem::exists(compressed))
+		{
+			continue;
+		}
+
+		const Utilities::MappedFile file(compressed);
+
+		if (!file.IsMapped())
+		{
+			Throw(std::runtime_error("failed to open texture file '" + compressed + "'"));
+		}
+
+		uint32_t width = 0, height = 0, mipLevels = 1;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		std::vector<uint64_t> levelOffsets;
+
+		if (extension == std::string(".ktx2"))
+		{
+			Ktx2Header header{};
+
+			if (file.Size() < sizeof(header) || std::memcmp(file.Data(), Ktx2Identifier, sizeof(Ktx2Identifier)) != 0)
+			{
+				Throw(std::runtime_error("invalid KTX2 file '" + compressed + "'"));
+			}
+
+			// Only plain 2D textures without supercompression.
+			std::memcpy(&header, file.Data(), sizeof(header));
+
+			if (header.SupercompressionScheme != 0 || header.PixelDepth > 1 || header.LayerCount > 1 || header.FaceCount != 1)
+			{
+				Throw(std::runtime_error("unsupported KTX2 layout in '" + compressed + "'"));
+			}
+
+			width = header.PixelWidth;
+			height = header.PixelHeight;
+			format = ToSupportedFormat(static_cast<VkFormat>(header.VkFormat));
+			mipLevels = std::min(std::max(header.LevelCount, 1u), MaxMipLevels(width, height));
+
+			if (file.Size() < sizeof(header) + mipLevels * sizeof(Ktx2Level))
+			{
+				Throw(std::runtime_error("truncated texture file '" + compressed + "'"));
+			}
+
+			// The level index starts with the base level, wherever the levels are stored in the file.
+			for (uint32_t i = 0; i != mipLevels; ++i)
+			{
+				Ktx2Level level{};
+				std::memcpy(&level, file.Data() + sizeof(header) + i * sizeof(level), sizeof(level));
+				levelOffsets.push_back(level.ByteOffset);
+			}
+		}
+		else
+		{
+			DdsHeader header{};
+			DdsHeaderDx10 dx10{};
+
+			if (file.Size() < sizeof(header))
+			{
+				Throw(std::runtime_error("invalid DDS file '" + compressed + "'"));
+			}
+
+			std::memcpy(&header, file.Data(), sizeof(header));
+			uint64_t offset = sizeof(header);
+
+			if (header.Magic != FourCC('D', 'D', 'S', ' '))
+			{
+				Throw(std::runtime_error("invalid DDS file '" + compressed + "'"));
+			}
+
+			if (header.FourCC == FourCC('D', 'X', '1', '0') && file.Size() >= sizeof(header) + sizeof(dx10))
+			{
+				std::memcpy(&dx10, file.Data() + sizeof(header), sizeof(dx10));
+				offset += sizeof(dx10);
+				format = FromDxgiFormat(dx10.DxgiFormat);
+			}
+			else if (header.FourCC == FourCC('D', 'X', 'T', '1'))
+			{
+				format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+			}
+
+			width = header.Width;
+			height = header.Height;
+
+			// DDSD_MIPMAPCOUNT, the levels are stored one after the other.
+			if (header.Flags & 0x20000)
+			{
+				mipLevels = std::min(std::max(header.MipMapCount, 1u), MaxMipLevels(width, height));
+			}
+
+			for (uint32_t i = 0; i != mipLevels; ++i)
+			{
+				levelOffsets.push_back(offset);
+				offset += LevelSize(std::max(width >> i, 1u), std::max(height >> i, 1u), format);
+			}
+		}
+
+		if (format == VK_FORMAT_UNDEFINED)
+		{
+			Throw(std::runtime_error("unsupported texture format in '" + compressed + "' (BC1, BC7 or RGBA8 expected)"));
+		}
+
+		size_t size = 0;
+
+		for (uint32_t i = 0; i != mipLevels; ++i)
+		{
+			size += LevelSize(std::max(width >> i, 1u), std::max(height >> i, 1u), format);
+		}
+
+		std::unique_ptr<unsigned char, void (*) (void*)> pixels(static_cast<unsigned char*>(std::malloc(size)), std::free);
+		size_t pixelsOffset = 0;
+
+		for (uint32_t i = 0; i != mipLevels; ++i)
+		{
+			const auto levelSize = LevelSize(std::max(width >> i, 1u), std::max(height >> i, 1u), format);
+
+			CopyLevel(compressed, file, levelOffsets[i], levelSize, pixels.get() + pixelsOffset);
+			pixelsOffset += levelSize;
+		}
+		const auto elapsed = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - timer).count();
+
+		std::ostringstream out;
+		out << "- loading '" << compressed << "'... ";
+		out << "(" << width << " x " << height << " " << ToString(format) << ", " << mipLevels << " mip levels) ";
+		out << elapsed << "s" << std::endl;
+		std::cout << out.str() << std::flush;
+
+		Texture texture(static_cast<int>(width), static_cast<int>(height), format, mipLevels, size, pixels.release());
+		texture.filename_ = filename;
+
+		return texture;
+	}
+
 	// Load the texture in normal host memory.
 	int width, height, channels;
 	const auto pixels = stbi_load(filename.c_str(), &width, &height, &channels, STBI_rgb_alpha);
@@ -21,18 +336,68 @@ Texture Texture::LoadTexture(const std::string& filename, const Vulkan::SamplerC
 	}
 
 	const auto elapsed = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - timer).count();
-	std::cout << "(" << width << " x " << height << " x " << channels << ") ";
-	std::cout << elapsed << "s" << std::endl;
 
-	return Texture(width, height, channels, pixels);
+	// The whole line is written at once, textures can be loaded from several threads.
+	std::ostringstream out;
+	out << "- loading '" << filename << "'... ";
+	out << "(" << width << " x " << height << " x " << channels << ") ";
+	out << elapsed << "s" << std::endl;
+	std::cout << out.str() << std::flush;
+
+	Texture texture(width, height, channels, pixels);
+	texture.filename_ = filename;
+
+	return texture;
+}
+
+size_t Texture::LevelOffset(const uint32_t level) const
+{
+	size_t offset = 0;
+
+	for (uint32_t i = 0; i != level; ++i)
+	{
+		offset += LevelSize(i);
+	}
+
+	return offset;
+}
+
+size_t Texture::LevelSize(const uint32_t level) const
+{
+	return Assets::LevelSize(std::max(uint32_t(width_) >> level, 1u), std::max(uint32_t(height_) >> level, 1u), format_);
+}
+
+uint32_t Texture::BlockSize() const
+{
+	switch (format_)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: return 8;
+	case VK_FORMAT_BC7_UNORM_BLOCK: return 16;
+	default: return 4;
+	}
 }
 
 Texture::Texture(int width, int height, int channels, unsigned char* const pixels) :
 	width_(width),
 	height_(height),
 	channels_(channels),
+	format_(VK_FORMAT_R8G8B8A8_UNORM),
+	mipLevels_(1),
+	size_(size_t(width) * height * 4),
 	pixels_(pixels, stbi_image_free)
 {
 }
+
+Texture::Texture(int width, int height, const VkFormat format, const uint32_t mipLevels, const size_t size, unsigned char* const pixels) :
+	width_(width),
+	height_(height),
+	channels_(4),
+	format_(format),
+	mipLevels_(mipLevels),
+	size_(size),
+	pixels_(pixels, std::free)
+{
+}
 	
 }
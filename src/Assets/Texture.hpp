@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vulkan/Sampler.hpp"
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -10,6 +11,8 @@ namespace Assets
 	{
 	public:
 
+		// A block compressed .ktx2 or .dds next to the image (see assets/CMakeLists.txt) is loaded in its place.
+		// Images decoded earlier in the process come from the TextureCache while their files are unchanged.
 		static Texture LoadTexture(const std::string& filename, const Vulkan::SamplerConfig& samplerConfig);
 
 		Texture& operator = (const Texture&) = delete;
@@ -20,19 +23,43 @@ namespace Assets
 		Texture(Texture&&) = default;
 		~Texture() = default;
 
+		// The image the texture was loaded from, it is decoded again to stream in levels that are no longer in host memory.
+		const std::string& Filename() const { return filename_; }
+		const Vulkan::SamplerConfig& SamplerConfig() const { return samplerConfig_; }
+
+		// Shared between the copies of the texture, e.g. with the TextureCache.
 		const unsigned char* Pixels() const { return pixels_.get(); }
 		int Width() const { return width_; }
 		int Height() const { return height_; }
+		VkFormat Format() const { return format_; }
+		size_t Size() const { return size_; }
+
+		// The mip levels stored in the file, tightly packed one after the other. Only the first one for PNG and JPEG images.
+		uint32_t MipLevels() const { return mipLevels_; }
+		size_t LevelOffset(uint32_t level) const;
+		size_t LevelSize(uint32_t level) const;
+
+		// Texel blocks of block compressed formats are 4x4, those of the uncompressed one a single texel.
+		bool IsCompressed() const { return format_ != VK_FORMAT_R8G8B8A8_UNORM; }
+		uint32_t BlockExtent() const { return IsCompressed() ? 4 : 1; }
+		uint32_t BlockSize() const;
 
 	private:
 
+		static Texture Decode(const std::string& filename);
+
 		Texture(int width, int height, int channels, unsigned char* pixels);
+		Texture(int width, int height, VkFormat format, uint32_t mipLevels, size_t size, unsigned char* pixels);
 
+		std::string filename_;
 		Vulkan::SamplerConfig samplerConfig_;
 		int width_;
 		int height_;
 		int channels_;
-		std::unique_ptr<unsigned char, void (*) (void*)> pixels_;
+		VkFormat format_;
+		uint32_t mipLevels_;
+		size_t size_;
+		std::shared_ptr<unsigned char> pixels_;
 	};
 
 }
@@ -0,0 +1,179 @@
+#include "TextureCache.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace Assets {
+
+namespace
+{
+	// The size and modification time of the image and of the .ktx2 and .dds files that would be loaded in its place, zero when missing.
+	struct FileStamps final
+	{
+		uint64_t Sizes[3];
+		int64_t Times[3];
+
+		bool operator == (const FileStamps& other) const
+		{
+			return std::equal(std::begin(Sizes), std::end(Sizes), std::begin(other.Sizes)) && std::equal(std::begin(Times), std::end(Times), std::begin(other.Times));
+		}
+	};
+
+	FileStamps GetFileStamps(const std::string& filename)
+	{
+		FileStamps stamps{};
+		const std::string paths[3] =
+		{
+			filename,
+			std::filesystem::path(filename).replace_extension(".ktx2").string(),
+			std::filesystem::path(filename).replace_extension(".dds").string()
+		};
+
+		for (size_t i = 0; i != 3; ++i)
+		{
+			std::error_code error;
+			const auto size = std::filesystem::file_size(paths[i], error);
+
+			if (error)
+			{
+				continue;
+			}
+
+			const auto time = std::filesystem::last_write_time(paths[i], error);
+
+			stamps.Sizes[i] = size;
+			stamps.Times[i] = error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+		}
+
+		return stamps;
+	}
+
+	struct Entry final
+	{
+		std::string Filename;
+		FileStamps Stamps;
+		Texture Image;
+	};
+
+	// Most recently used first.
+	struct Cache final
+	{
+		std::mutex Mutex;
+		std::list<Entry> Entries;
+		std::unordered_map<std::string, std::list<Entry>::iterator> Index;
+		size_t Budget = size_t(512) * 1024 * 1024;
+		size_t MemorySize{};
+
+		void Erase(const std::list<Entry>::iterator entry)
+		{
+			MemorySize -= entry->Image.Size();
+			Index.erase(entry->Filename);
+			Entries.erase(entry);
+		}
+
+		void Trim()
+		{
+			while (MemorySize > Budget)
+			{
+				Erase(std::prev(Entries.end()));
+			}
+		}
+	};
+
+	Cache& GetCache()
+	{
+		static Cache cache;
+		return cache;
+	}
+}
+
+void TextureCache::SetBudget(const size_t budget)
+{
+	auto& cache = GetCache();
+	std::lock_guard<std::mutex> lock(cache.Mutex);
+
+	cache.Budget = budget;
+	cache.Trim();
+}
+
+size_t TextureCache::Budget()
+{
+	auto& cache = GetCache();
+	std::lock_guard<std::mutex> lock(cache.Mutex);
+
+	return cache.Budget;
+}
+
+size_t TextureCache::MemorySize()
+{
+	auto& cache = GetCache();
+	std::lock_guard<std::mutex> lock(cache.Mutex);
+
+	return cache.MemorySize;
+}
+
+std::optional<Texture> TextureCache::Find(const std::string& filename)
+{
+	auto& cache = GetCache();
+	std::unique_lock<std::mutex> lock(cache.Mutex);
+
+	if (cache.Index.find(filename) == cache.Index.end())
+	{
+		return std::nullopt;
+	}
+
+	// The files are looked up outside of the lock, the entry may have gone in the meantime.
+	lock.unlock();
+	const auto stamps = GetFileStamps(filename);
+	lock.lock();
+
+	const auto found = cache.Index.find(filename);
+
+	if (found == cache.Index.end())
+	{
+		return std::nullopt;
+	}
+
+	if (!(found->second->Stamps == stamps))
+	{
+		cache.Erase(found->second);
+		return std::nullopt;
+	}
+
+	cache.Entries.splice(cache.Entries.begin(), cache.Entries, found->second);
+
+	return cache.Entries.front().Image;
+}
+
+void TextureCache::Store(const std::string& filename, const Texture& texture)
+{
+	const auto stamps = GetFileStamps(filename);
+
+	auto& cache = GetCache();
+	std::lock_guard<std::mutex> lock(cache.Mutex);
+
+	if (texture.Size() > cache.Budget)
+	{
+		return;
+	}
+
+	// Another thread may have decoded the same image.
+	const auto found = cache.Index.find(filename);
+
+	if (found != cache.Index.end())
+	{
+		cache.Erase(found->second);
+	}
+
+	cache.Entries.push_front(Entry{ filename, stamps, texture });
+	cache.Index.emplace(filename, cache.Entries.begin());
+	cache.MemorySize += texture.Size();
+	cache.Trim();
+}
+
+}
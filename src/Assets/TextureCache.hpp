@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Texture.hpp"
+#include <cstddef>
+#include <optional>
+#include <string>
+
+namespace Assets
+{
+	// The textures decoded so far in the process, so that switching back to a scene, reloading it or streaming a texture in again skips
+	// reading and decoding its image. Entries are keyed by path and validated against the size and modification time of the image and
+	// of its block compressed versions. The least recently used ones are dropped over the host memory budget (see --texture-cache).
+	// Textures are loaded from the task system threads, hence the lock.
+	class TextureCache final
+	{
+	public:
+
+		TextureCache() = delete;
+
+		// Zero disables the cache. Entries over a new budget are dropped right away.
+		static void SetBudget(size_t budget);
+		static size_t Budget();
+		static size_t MemorySize();
+
+		// The pixels are shared with the cached entry. Empty if the entry is missing or stale.
+		static std::optional<Texture> Find(const std::string& filename);
+		static void Store(const std::string& filename, const Texture& texture);
+	};
+
+}
@@ -1,48 +1,196 @@
 #include "TextureImage.hpp"
 #include "Texture.hpp"
+#include "Utilities/Exception.hpp"
 #include "Vulkan/Buffer.hpp"
-#include "Vulkan/CommandPool.hpp"
+#include "Vulkan/Device.hpp"
 #include "Vulkan/ImageView.hpp"
 #include "Vulkan/Image.hpp"
-#include "Vulkan/Sampler.hpp"
-#include <cstring>
+#include "Vulkan/StagingRing.hpp"
+#include <algorithm>
+#include <vector>
 
 namespace Assets {
 
-TextureImage::TextureImage(Vulkan::CommandPool& commandPool, const Texture& texture)
+namespace
 {
-	// Create a host staging buffer and copy the image into it.
-	const VkDeviceSize imageSize = texture.Width() * texture.Height() * 4;
-	const auto& device = commandPool.Device();
+	// Block compressed textures keep the mip levels stored in their file, the others get a full chain blitted from the first level.
+	bool GeneratesMipmaps(const Vulkan::Device& device, const Texture& texture)
+	{
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(device.PhysicalDevice(), texture.Format(), &formatProperties);
 
-	auto stagingBuffer = std::make_unique<Vulkan::Buffer>(device, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	auto stagingBufferMemory = stagingBuffer->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
 
-	const auto data = stagingBufferMemory.Map(0, imageSize);
-	std::memcpy(data, texture.Pixels(), imageSize);
-	stagingBufferMemory.Unmap();
+		return
+			texture.MipLevels() == 1 &&
+			!texture.IsCompressed() &&
+			(formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+	}
 
-	// Create the device side image, memory, view and sampler.
-	image_.reset(new Vulkan::Image(device, VkExtent2D{ static_cast<uint32_t>(texture.Width()), static_cast<uint32_t>(texture.Height()) }, VK_FORMAT_R8G8B8A8_UNORM));
-	imageMemory_.reset(new Vulkan::DeviceMemory(image_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
-	imageView_.reset(new Vulkan::ImageView(device, image_->Handle(), image_->Format(), VK_IMAGE_ASPECT_COLOR_BIT));
-	sampler_.reset(new Vulkan::Sampler(device, Vulkan::SamplerConfig()));
+	// Box filters the first level of an RGBA8 texture down to the given level, for generated chains that do not start at the first level.
+	std::vector<unsigned char> Downsample(const Texture& texture, const uint32_t level)
+	{
+		auto width = static_cast<uint32_t>(texture.Width());
+		auto height = static_cast<uint32_t>(texture.Height());
+		std::vector<unsigned char> pixels(texture.Pixels(), texture.Pixels() + texture.LevelSize(0));
+
+		for (uint32_t i = 0; i != level; ++i)
+		{
+			const auto nextWidth = std::max(width / 2, 1u);
+			const auto nextHeight = std::max(height / 2, 1u);
+			std::vector<unsigned char> next(size_t(nextWidth) * nextHeight * 4);
+
+			for (uint32_t y = 0; y != nextHeight; ++y)
+			{
+				const auto y0 = std::min(2 * y, height - 1);
+				const auto y1 = std::min(2 * y + 1, height - 1);
+
+				for (uint32_t x = 0; x != nextWidth; ++x)
+				{
+					const auto x0 = std::min(2 * x, width - 1);
+					const auto x1 = std::min(2 * x + 1, width - 1);
+
+					for (uint32_t c = 0; c != 4; ++c)
+					{
+						const uint32_t sum =
+							pixels[(size_t(y0) * width + x0) * 4 + c] + pixels[(size_t(y0) * width + x1) * 4 + c] +
+							pixels[(size_t(y1) * width + x0) * 4 + c] + pixels[(size_t(y1) * width + x1) * 4 + c];
+
+						next[(size_t(y) * nextWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+					}
+				}
+			}
+
+			pixels.swap(next);
+			width = nextWidth;
+			height = nextHeight;
+		}
+
+		return pixels;
+	}
+}
+
+uint32_t TextureImage::MipLevels(const Vulkan::Device& device, const Texture& texture)
+{
+	if (!GeneratesMipmaps(device, texture))
+	{
+		return texture.MipLevels();
+	}
+
+	uint32_t mipLevels = 1;
 
-	// Transfer the data to device side.
-	image_->TransitionImageLayout(commandPool, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	image_->CopyFrom(commandPool, *stagingBuffer);
-	image_->TransitionImageLayout(commandPool, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	for (auto extent = static_cast<uint32_t>(std::max(texture.Width(), texture.Height())); extent > 1; extent /= 2)
+	{
+		++mipLevels;
+	}
 
-	// Delete the buffer before the memory
-	stagingBuffer.reset();
+	return mipLevels;
+}
+
+TextureImage::TextureImage(Vulkan::StagingRing& stagingRing, const Texture& texture, const uint32_t firstLevel)
+{
+	const auto& device = stagingRing.Device();
+	const auto width = static_cast<uint32_t>(texture.Width());
+	const auto height = static_cast<uint32_t>(texture.Height());
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(device.PhysicalDevice(), texture.Format(), &formatProperties);
+
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+	{
+		Throw(std::runtime_error("the device cannot sample the texture format (BC textures require textureCompressionBC)"));
+	}
+
+	const bool generateMipmaps = GeneratesMipmaps(device, texture);
+	const uint32_t totalMipLevels = MipLevels(device, texture);
+
+	if (firstLevel >= totalMipLevels)
+	{
+		Throw(std::out_of_range("texture first level is out of range"));
+	}
+
+	// Create the device side image, memory and view, the scene samples them all with the same sampler (see Scene::TextureSampler()).
+	CreateImage(device, VkExtent2D{ std::max(width >> firstLevel, 1u), std::max(height >> firstLevel, 1u) }, totalMipLevels - firstLevel, texture.Format());
+
+	// Stage the pixels through the ring (in whole rows) and record the transfer to device side.
+	image_->TransitionImageLayout(stagingRing.CommandBuffer(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	// A generated chain below the first level starts from a host side downsampled copy.
+	const std::vector<unsigned char> downsampled = generateMipmaps && firstLevel != 0 ? Downsample(texture, firstLevel) : std::vector<unsigned char>();
+	const uint32_t lastLevel = generateMipmaps ? firstLevel + 1 : texture.MipLevels();
+
+	for (uint32_t level = firstLevel; level != lastLevel; ++level)
+	{
+		// Block compressed textures are staged in whole rows of 4x4 texel blocks.
+		const uint32_t mipLevel = level - firstLevel;
+		const uint32_t levelWidth = std::max(width >> level, 1u);
+		const uint32_t levelHeight = std::max(height >> level, 1u);
+		const uint32_t rowHeight = texture.BlockExtent();
+		const VkDeviceSize rowSize = VkDeviceSize((levelWidth + rowHeight - 1) / rowHeight) * texture.BlockSize();
+
+		const auto* const pixels = downsampled.empty() ? texture.Pixels() + texture.LevelOffset(level) : downsampled.data();
+		const auto levelSize = downsampled.empty() ? texture.LevelSize(level) : downsampled.size();
+
+		stagingRing.Upload(pixels, levelSize, rowSize,
+			[this, mipLevel, rowSize, rowHeight, levelHeight](VkCommandBuffer commandBuffer, const Vulkan::Buffer& stagingBuffer, VkDeviceSize stagingOffset, VkDeviceSize offset, VkDeviceSize size)
+		{
+			// The last row of blocks may extend past the bottom of the image.
+			const auto firstRow = static_cast<uint32_t>(offset / rowSize) * rowHeight;
+			const auto rowCount = std::min(static_cast<uint32_t>(size / rowSize) * rowHeight, levelHeight - firstRow);
+
+			image_->CopyFrom(commandBuffer, stagingBuffer, stagingOffset, mipLevel, firstRow, rowCount);
+		});
+	}
+
+	// Blits need a graphics queue, the mip chain is generated once the image has been handed over.
+	if (generateMipmaps)
+	{
+		stagingRing.Release(*image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		image_->GenerateMipmaps(stagingRing.GraphicsCommandBuffer());
+	}
+	else
+	{
+		stagingRing.Release(*image_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+}
+
+TextureImage::TextureImage(Vulkan::StagingRing& stagingRing, TextureImage& source, const uint32_t firstLevel)
+{
+	const auto& sourceImage = *source.image_;
+	const auto extent = sourceImage.Extent();
+
+	if (firstLevel >= sourceImage.MipLevels())
+	{
+		Throw(std::out_of_range("texture first level is out of range"));
+	}
+
+	CreateImage(stagingRing.Device(), VkExtent2D{ std::max(extent.width >> firstLevel, 1u), std::max(extent.height >> firstLevel, 1u) }, sourceImage.MipLevels() - firstLevel, sourceImage.Format());
+
+	// The source is owned by the graphics queue family, copy on a graphics queue after the frames already sampling it.
+	const auto commandBuffer = stagingRing.GraphicsCommandBuffer();
+
+	image_->TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	image_->CopyFrom(commandBuffer, *source.image_, firstLevel);
+	image_->TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
 TextureImage::~TextureImage()
 {
-	sampler_.reset();
 	imageView_.reset();
 	image_.reset();
 	imageMemory_.reset();
 }
 
+void TextureImage::CreateImage(const Vulkan::Device& device, const VkExtent2D extent, const uint32_t mipLevels, const VkFormat format)
+{
+	// Streamed images may later be copied into a smaller one when evicted.
+	const VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+	image_.reset(new Vulkan::Image(device, extent, mipLevels, format, VK_IMAGE_TILING_OPTIMAL, usage));
+	imageMemory_.reset(new Vulkan::DeviceMemory(image_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+	memorySize_ = image_->GetMemoryRequirements().size;
+	device.DebugUtils().SetObjectName(image_->Handle(), "Texture Image");
+	imageView_.reset(new Vulkan::ImageView(device, image_->Handle(), image_->Format(), VK_IMAGE_ASPECT_COLOR_BIT, mipLevels));
+}
+
 }
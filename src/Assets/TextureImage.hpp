@@ -1,14 +1,15 @@
 #pragma once
 
+#include "Vulkan/Vulkan.hpp"
 #include <memory>
 
 namespace Vulkan
 {
-	class CommandPool;
+	class Device;
 	class DeviceMemory;
 	class Image;
 	class ImageView;
-	class Sampler;
+	class StagingRing;
 }
 
 namespace Assets
@@ -24,18 +25,29 @@ namespace Assets
 		TextureImage& operator = (const TextureImage&) = delete;
 		TextureImage& operator = (TextureImage&&) = delete;
 
-		TextureImage(Vulkan::CommandPool& commandPool, const Texture& texture);
+		// The number of levels of the full mip chain, either stored in the texture or generated from its first level.
+		static uint32_t MipLevels(const Vulkan::Device& device, const Texture& texture);
+
+		// Only the levels from firstLevel onwards are uploaded, the image extent being the one of that level.
+		TextureImage(Vulkan::StagingRing& stagingRing, const Texture& texture, uint32_t firstLevel = 0);
+
+		// Keeps the coarser levels of another texture image (from its own firstLevel onwards) with a copy on the GPU.
+		TextureImage(Vulkan::StagingRing& stagingRing, TextureImage& source, uint32_t firstLevel);
+
 		~TextureImage();
 
 		const Vulkan::ImageView& ImageView() const { return *imageView_; }
-		const Vulkan::Sampler& Sampler() const { return *sampler_; }
+		VkDeviceSize MemorySize() const { return memorySize_; }
 
 	private:
 
+		void CreateImage(const Vulkan::Device& device, VkExtent2D extent, uint32_t mipLevels, VkFormat format);
+
+		VkDeviceSize memorySize_{};
+
 		std::unique_ptr<Vulkan::Image> image_;
 		std::unique_ptr<Vulkan::DeviceMemory> imageMemory_;
 		std::unique_ptr<Vulkan::ImageView> imageView_;
-		std::unique_ptr<Vulkan::Sampler> sampler_;
 	};
 
 }
@@ -0,0 +1,290 @@
+#include "TextureStreamer.hpp"
+#include "TextureImage.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include "Vulkan/ImageView.hpp"
+#include "Vulkan/Sampler.hpp"
+#include "Vulkan/StagingRing.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace Assets {
+
+namespace
+{
+	// The low resolution version of a texture, resident from the start, is at most this wide and high.
+	constexpr uint32_t LowResolutionExtent = 64;
+
+	// Decoded textures are uploaded a few at a time, the staging ring flush waits for them.
+	constexpr uint32_t MaxUploadsPerFrame = 2;
+}
+
+TextureStreamer::TextureStreamer(Vulkan::StagingRing& stagingRing, std::vector<Texture>&& textures, const VkDeviceSize budget) :
+	budget_(budget)
+{
+	const auto& device = stagingRing.Device();
+
+	entries_.reserve(textures.size());
+	imageInfos_.reserve(textures.size());
+
+	for (const auto& texture : textures)
+	{
+		Entry entry{};
+		entry.Filename = texture.Filename();
+		entry.SamplerConfig = texture.SamplerConfig();
+		entry.Width = static_cast<uint32_t>(texture.Width());
+		entry.Height = static_cast<uint32_t>(texture.Height());
+		entry.MipLevels = TextureImage::MipLevels(device, texture);
+		entry.BlockSize = texture.BlockSize();
+		entry.BlockExtent = texture.BlockExtent();
+
+		// Textures that cannot be decoded again are kept at full resolution.
+		while (!entry.Filename.empty() &&
+			entry.LowestLevel + 1 < entry.MipLevels &&
+			std::max(entry.Width, entry.Height) >> entry.LowestLevel > LowResolutionExtent)
+		{
+			++entry.LowestLevel;
+		}
+
+		entry.ResidentLevel = entry.LowestLevel;
+		entry.WantedLevel = entry.LowestLevel;
+		entry.Image.reset(new TextureImage(stagingRing, texture, entry.LowestLevel));
+
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = entry.Image->ImageView().Handle();
+
+		imageInfos_.push_back(imageInfo);
+		memorySize_ += entry.Image->MemorySize();
+		compressedTextureCount_ += texture.IsCompressed() ? 1 : 0;
+
+		entries_.push_back(std::move(entry));
+	}
+
+	// The pixels have been copied into the staging ring, drop the host copies.
+	textures.clear();
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// The pending loads only own their own texture, let them complete before releasing the images.
+	for (auto& entry : entries_)
+	{
+		if (entry.Load.valid())
+		{
+			entry.Load.wait();
+		}
+	}
+
+	retired_.clear();
+	entries_.clear();
+}
+
+void TextureStreamer::Update(Vulkan::StagingRing& stagingRing, Utilities::TaskSystem& tasks, const std::vector<int32_t>& requests, const size_t framesInFlight)
+{
+	const auto generation = generation_;
+	++frame_;
+
+	// Release the replaced images once every frame that could still sample them has completed.
+	retired_.erase(std::remove_if(retired_.begin(), retired_.end(), [this, framesInFlight](const auto& retired)
+	{
+		return retired.first + framesInFlight <= frame_;
+	}), retired_.end());
+
+	// Turn the requested footprints into levels, the first level has sqrt(width * height) texels across.
+	for (size_t i = 0; i != entries_.size(); ++i)
+	{
+		auto& entry = entries_[i];
+		const int64_t request = requests.empty() ? std::numeric_limits<int32_t>::min() : i < requests.size() ? requests[i] : NoRequest;
+
+		if (request == NoRequest)
+		{
+			continue;
+		}
+
+		const auto levelOffset = static_cast<int64_t>(std::floor(0.5 * std::log2(double(entry.Width) * entry.Height)));
+		const auto level = std::clamp<int64_t>(request + levelOffset, 0, entry.LowestLevel);
+
+		entry.WantedLevel = std::min(entry.WantedLevel, static_cast<uint32_t>(level));
+		entry.LastUsedFrame = frame_;
+	}
+
+	// Upload the decoded textures, at the finest level that fits in the budget.
+	uint32_t uploads = 0;
+
+	for (size_t i = 0; i != entries_.size() && uploads != MaxUploadsPerFrame; ++i)
+	{
+		auto& entry = entries_[i];
+
+		if (!entry.Load.valid() || entry.Load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			continue;
+		}
+
+		const auto texture = entry.Load.get();
+
+		if (static_cast<uint32_t>(texture.Width()) != entry.Width ||
+			static_cast<uint32_t>(texture.Height()) != entry.Height ||
+			TextureImage::MipLevels(stagingRing.Device(), texture) != entry.MipLevels)
+		{
+			// The file has changed since the scene was loaded, decoding it again would not help.
+			entry.HasFailed = true;
+
+			Utilities::Console::Write(Utilities::Severity::Warning, [&entry]()
+			{
+				std::cerr << "WARNING: texture '" << entry.Filename << "' has changed size on disk, it is no longer streamed" << std::endl;
+			});
+
+			continue;
+		}
+
+		auto level = entry.WantedLevel;
+
+		while (level < entry.ResidentLevel && !MakeRoom(stagingRing, EstimatedSize(entry, level) - std::min(EstimatedSize(entry, level), entry.Image->MemorySize()), i))
+		{
+			++level;
+		}
+
+		if (level < entry.ResidentLevel)
+		{
+			Replace(i, std::unique_ptr<TextureImage>(new TextureImage(stagingRing, texture, level)), level);
+			++uploads;
+		}
+	}
+
+	// Start decoding the textures the furthest away from their wanted level, as long as one more level fits in the budget.
+	std::vector<size_t> candidates;
+	size_t pendingLoads = 0;
+
+	for (size_t i = 0; i != entries_.size(); ++i)
+	{
+		const auto& entry = entries_[i];
+
+		if (entry.Load.valid())
+		{
+			++pendingLoads;
+		}
+		else if (!entry.HasFailed && entry.WantedLevel < entry.ResidentLevel)
+		{
+			candidates.push_back(i);
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [this](const size_t a, const size_t b)
+	{
+		return entries_[a].ResidentLevel - entries_[a].WantedLevel > entries_[b].ResidentLevel - entries_[b].WantedLevel;
+	});
+
+	for (const auto i : candidates)
+	{
+		if (pendingLoads >= tasks.ThreadCount())
+		{
+			break;
+		}
+
+		auto& entry = entries_[i];
+		const auto size = EstimatedSize(entry, entry.ResidentLevel - 1);
+
+		if (memorySize_ - entry.Image->MemorySize() + size > budget_ + ReclaimableSize(i))
+		{
+			continue;
+		}
+
+		entry.Load = tasks.Run([filename = entry.Filename, samplerConfig = entry.SamplerConfig]()
+		{
+			return Texture::LoadTexture(filename, samplerConfig);
+		});
+
+		++pendingLoads;
+	}
+
+	// Submit the uploads and evictions before the frame samples the new images.
+	if (generation_ != generation)
+	{
+		stagingRing.Flush();
+	}
+}
+
+VkDeviceSize TextureStreamer::EstimatedSize(const Entry& entry, const uint32_t firstLevel)
+{
+	VkDeviceSize size = 0;
+
+	for (uint32_t level = firstLevel; level < entry.MipLevels; ++level)
+	{
+		const auto width = std::max(entry.Width >> level, 1u);
+		const auto height = std::max(entry.Height >> level, 1u);
+
+		size += VkDeviceSize((width + entry.BlockExtent - 1) / entry.BlockExtent) * ((height + entry.BlockExtent - 1) / entry.BlockExtent) * entry.BlockSize;
+	}
+
+	return size;
+}
+
+VkDeviceSize TextureStreamer::ReclaimableSize(const size_t excluded) const
+{
+	VkDeviceSize size = 0;
+
+	for (size_t i = 0; i != entries_.size(); ++i)
+	{
+		const auto& entry = entries_[i];
+
+		if (i != excluded && entry.LastUsedFrame != frame_ && entry.ResidentLevel < entry.LowestLevel)
+		{
+			size += entry.Image->MemorySize() - std::min(entry.Image->MemorySize(), EstimatedSize(entry, entry.LowestLevel));
+		}
+	}
+
+	return size;
+}
+
+bool TextureStreamer::MakeRoom(Vulkan::StagingRing& stagingRing, const VkDeviceSize size, const size_t excluded)
+{
+	// The replaced images are only released a few frames later, they are not counted against the budget.
+	while (memorySize_ + size > budget_)
+	{
+		// Evict the least recently used texture that is not sampled by the current frames.
+		size_t victim = entries_.size();
+
+		for (size_t i = 0; i != entries_.size(); ++i)
+		{
+			const auto& entry = entries_[i];
+
+			if (i != excluded && entry.LastUsedFrame != frame_ && entry.ResidentLevel < entry.LowestLevel &&
+				(victim == entries_.size() || entry.LastUsedFrame < entries_[victim].LastUsedFrame))
+			{
+				victim = i;
+			}
+		}
+
+		if (victim == entries_.size())
+		{
+			return false;
+		}
+
+		auto& entry = entries_[victim];
+
+		Replace(victim, std::unique_ptr<TextureImage>(new TextureImage(stagingRing, *entry.Image, entry.LowestLevel - entry.ResidentLevel)), entry.LowestLevel);
+		entry.WantedLevel = entry.LowestLevel;
+	}
+
+	return true;
+}
+
+void TextureStreamer::Replace(const size_t index, std::unique_ptr<TextureImage> image, const uint32_t firstLevel)
+{
+	auto& entry = entries_[index];
+
+	memorySize_ = memorySize_ - entry.Image->MemorySize() + image->MemorySize();
+	imageInfos_[index].imageView = image->ImageView().Handle();
+
+	retired_.emplace_back(frame_, std::move(entry.Image));
+	entry.Image = std::move(image);
+	entry.ResidentLevel = firstLevel;
+
+	++generation_;
+}
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Texture.hpp"
+#include "Vulkan/Vulkan.hpp"
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Utilities
+{
+	class TaskSystem;
+}
+
+namespace Vulkan
+{
+	class StagingRing;
+}
+
+namespace Assets
+{
+	class TextureImage;
+
+	// Keeps the scene textures resident within a device memory budget. Every texture starts with its lowest mip levels,
+	// the finer ones are decoded again from their file and uploaded when the shaders ask for them (see Scatter.glsl).
+	// Over budget, the least recently used textures are brought back down to their lowest levels with a GPU copy.
+	// The host pixels are never kept once uploaded, though the TextureCache may still hold them.
+	class TextureStreamer final
+	{
+	public:
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer(TextureStreamer&&) = delete;
+		TextureStreamer& operator = (const TextureStreamer&) = delete;
+		TextureStreamer& operator = (TextureStreamer&&) = delete;
+
+		// The value of a texture that has not been sampled in a frame.
+		static constexpr int32_t NoRequest = INT32_MAX;
+
+		TextureStreamer(Vulkan::StagingRing& stagingRing, std::vector<Texture>&& textures, VkDeviceSize budget);
+		~TextureStreamer();
+
+		// Indexed by texture id, as written to the descriptor sets. They change (along with the generation) whenever a texture is streamed in or evicted.
+		const std::vector<VkDescriptorImageInfo>& ImageInfos() const { return imageInfos_; }
+		uint64_t Generation() const { return generation_; }
+
+		VkDeviceSize MemorySize() const { return memorySize_; }
+		VkDeviceSize Budget() const { return budget_; }
+		uint32_t CompressedTextureCount() const { return compressedTextureCount_; }
+		uint32_t TextureCount() const { return static_cast<uint32_t>(entries_.size()); }
+
+		// Called once per frame after its fence wait, the images replaced more than framesInFlight frames ago are then released.
+		// The requests hold the finest level footprint sampled in each texture (log2 of the texel size for a 1x1 texture).
+		// Without requests, every texture is wanted at full resolution.
+		void Update(Vulkan::StagingRing& stagingRing, Utilities::TaskSystem& tasks, const std::vector<int32_t>& requests, size_t framesInFlight);
+
+	private:
+
+		struct Entry
+		{
+			std::string Filename;
+			Vulkan::SamplerConfig SamplerConfig;
+			uint32_t Width;
+			uint32_t Height;
+			uint32_t MipLevels;
+			uint32_t BlockSize;
+			uint32_t BlockExtent;
+
+			uint32_t LowestLevel;   // The first level of the low resolution version, always resident.
+			uint32_t ResidentLevel; // The first level of the current image.
+			uint32_t WantedLevel;   // The finest level requested since the texture was last evicted.
+			uint64_t LastUsedFrame;
+			bool HasFailed; // The file no longer matches the texture, which then keeps its resident levels.
+
+			std::unique_ptr<TextureImage> Image;
+			std::future<Texture> Load;
+		};
+
+		static VkDeviceSize EstimatedSize(const Entry& entry, uint32_t firstLevel);
+		VkDeviceSize ReclaimableSize(size_t excluded) const;
+		bool MakeRoom(Vulkan::StagingRing& stagingRing, VkDeviceSize size, size_t excluded);
+		void Replace(size_t index, std::unique_ptr<TextureImage> image, uint32_t firstLevel);
+
+		const VkDeviceSize budget_;
+		std::vector<Entry> entries_;
+		std::vector<std::pair<uint64_t, std::unique_ptr<TextureImage>>> retired_;
+		std::vector<VkDescriptorImageInfo> imageInfos_;
+		VkDeviceSize memorySize_{};
+		uint32_t compressedTextureCount_{};
+		uint64_t generation_{};
+		uint64_t frame_{};
+	};
+
+}
@@ -1,5 +1,6 @@
 #include "UniformBuffer.hpp"
 #include "Vulkan/Buffer.hpp"
+#include "Vulkan/Device.hpp"
 #include <cstring>
 
 namespace Assets {
@@ -9,26 +10,52 @@ UniformBuffer::UniformBuffer(const Vulkan::Device& device)
 	const auto bufferSize = sizeof(UniformBufferObject);
 
 	buffer_.reset(new Vulkan::Buffer(device, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT));
-	memory_.reset(new Vulkan::DeviceMemory(buffer_->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)));
+
+	// Prefer the device local host visible heap (e.g. resizable BAR) so the shaders don't read across the bus.
+	const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	const VkMemoryPropertyFlags deviceLocalHostVisible = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | hostVisible;
+	const auto memoryTypeBits = buffer_->GetMemoryRequirements().memoryTypeBits;
+
+	memory_.reset(new Vulkan::DeviceMemory(buffer_->AllocateMemory(
+		device.Allocator().HasMemoryType(memoryTypeBits, deviceLocalHostVisible) ? deviceLocalHostVisible : hostVisible)));
+
+	// Mapped for the lifetime of the buffer.
+	mappedData_ = memory_->Map(0, bufferSize);
 }
 
 UniformBuffer::UniformBuffer(UniformBuffer&& other) noexcept :
 	buffer_(other.buffer_.release()),
-	memory_(other.memory_.release())
+	memory_(other.memory_.release()),
+	mappedData_(other.mappedData_),
+	value_(other.value_),
+	hasValue_(other.hasValue_)
 {
+	other.mappedData_ = nullptr;
 }
 
 UniformBuffer::~UniformBuffer()
 {
+	if (mappedData_ != nullptr)
+	{
+		memory_->Unmap();
+		mappedData_ = nullptr;
+	}
+
 	buffer_.reset();
 	memory_.reset(); // release memory after bound buffer has been destroyed
 }
 
 void UniformBuffer::SetValue(const UniformBufferObject& ubo)
 {
-	const auto data = memory_->Map(0, sizeof(UniformBufferObject));
-	std::memcpy(data, &ubo, sizeof(ubo));
-	memory_->Unmap();
+	// Keep a host copy rather than reading back from (possibly write-combined) mapped memory.
+	if (hasValue_ && std::memcmp(&value_, &ubo, sizeof(ubo)) == 0)
+	{
+		return;
+	}
+
+	std::memcpy(mappedData_, &ubo, sizeof(ubo));
+	value_ = ubo;
+	hasValue_ = true;
 }
 
 }
@@ -20,6 +20,8 @@ namespace Assets
 		glm::mat4 Projection;
 		glm::mat4 ModelViewInverse;
 		glm::mat4 ProjectionInverse;
+		glm::mat4 PreviousModelView; // The camera of the last frame, only used when reprojecting.
+		glm::vec4 SceneSphere; // The center and radius of a sphere enclosing every instance, bounding the ray lengths.
 		float Aperture;
 		float FocusDistance;
 		float HeatmapScale;
@@ -29,6 +31,48 @@ namespace Assets
 		uint32_t RandomSeed;
 		uint32_t HasSky; // bool
 		uint32_t ShowHeatmap; // bool
+		uint32_t RussianRouletteDepth; // 0 = disabled
+		uint32_t LightSampling; // bool
+		uint32_t LightCount;
+		float LightPower;
+		uint32_t ReprojectedSamples; // The history samples kept per pixel when the camera has moved, 0 = not reprojecting.
+		uint32_t HalfAccumulationSamples; // The samples kept per pixel by the half float accumulation image, 0 = single float.
+		uint32_t SampleStreamIndex; // Sample i of a pixel is the i * SampleStreamCount + SampleStreamIndex one of its sequence,
+		uint32_t SampleStreamCount; // i.e. an interleaved share of several devices or the offset of a render farm range.
+		uint32_t HeatmapStage; // 0 = the whole ray generation shader, otherwise 1 + the profiled stage (see Profile.glsl).
+		uint32_t HeatmapBounce; // 0 = all the bounces, otherwise 1 + the bounce shown by the stage heatmap.
+		uint32_t InterleavePattern; // The pixels tracing new samples while reprojecting, 0 = all of them (see UserSettings::Interleave).
+		uint32_t InterleaveFrame; // Rotates the pixels tracing new samples.
+		uint32_t OpaqueDepth; // The bounce from which the rays skip the alpha tests, 0 = never.
+		uint32_t Restir; // bool, resample the light list at the camera ray hits (see Restir.glsl).
+		uint32_t RestirFrame; // Frames since the reservoirs were last valid, 0 = none. Its parity selects the half of the reservoir buffer written.
+		uint32_t LightTree; // bool, select the sampled lights through the light tree rather than by their power alone.
+		uint32_t RadianceCache; // bool, end the paths in the radiance cache past their first diffuse bounce (see RadianceCache.glsl).
+		uint32_t RadianceCacheFrame; // Rotates the samples tracing the training paths.
+		uint32_t PathGuiding; // bool, guide the diffuse bounces by the lobes learnt in world space (see PathGuiding.glsl).
+		uint32_t ViewCount; // The cameras traced by the launch depth, 1 = only the main one (see Vulkan::RayTracing::Application::MaxViewCount).
+		glm::mat4 ViewModelViewInverse[8]; // The first one is ModelViewInverse, they all share its projection, aperture and focus distance.
+		glm::vec4 ProbeOrigin; // The position of the first probe of a bake (see ProbeBaker), w unused.
+		glm::vec4 ProbeSpacing; // Between neighbouring probes, w unused.
+		glm::uvec4 ProbeGrid; // The probes along each axis, w the probe tiles per row of the traced image.
+		uint32_t ProbeBake; // bool, trace the directions around the probes of the batch rather than the camera view.
+		uint32_t ProbeFirst; // The probes of the batch.
+		uint32_t ProbeEnd;
+		uint32_t RayIsolation; // 0 = whole paths, 1 = the camera rays only, 2 = the camera rays traced as shadow rays.
+		uint32_t SampleMap; // bool, the pixels trace the fraction of their samples in the sample map (see SampleMap.comp).
+	};
+
+	// Matches FrameConstants.glsl, the per-frame fields of UniformBufferObject as push constants.
+	class FrameConstants
+	{
+	public:
+
+		uint32_t TotalNumberOfSamples;
+		uint32_t NumberOfSamples;
+		uint32_t RandomSeed;
+		uint32_t Enabled; // bool
+		uint32_t SampleTiles; // bool, always set
+		uint32_t RowOffset; // The first row of the launch, always set
 	};
 
 	class UniformBuffer
@@ -45,12 +89,16 @@ namespace Assets
 
 		const Vulkan::Buffer& Buffer() const { return *buffer_; }
 
+		// Writes through the persistent mapping, skipped when the value is unchanged.
 		void SetValue(const UniformBufferObject& ubo);
 
 	private:
 
 		std::unique_ptr<Vulkan::Buffer> buffer_;
 		std::unique_ptr<Vulkan::DeviceMemory> memory_;
+		void* mappedData_{};
+		UniformBufferObject value_{};
+		bool hasValue_{};
 	};
 
 }
\ No newline at end of file
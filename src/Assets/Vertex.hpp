@@ -1,8 +1,8 @@
 #pragma once
 
 #include "Utilities/Glm.hpp"
-#include "Vulkan/Vulkan.hpp"
-#include <array>
+#include <glm/gtc/packing.hpp>
+#include <cstdint>
 
 namespace Assets
 {
@@ -22,41 +22,25 @@ namespace Assets
 				TexCoord == other.TexCoord &&
 				MaterialIndex == other.MaterialIndex;
 		}
+	};
 
-		static VkVertexInputBindingDescription GetBindingDescription()
-		{
-			VkVertexInputBindingDescription bindingDescription = {};
-			bindingDescription.binding = 0;
-			bindingDescription.stride = sizeof(Vertex);
-			bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-			return bindingDescription;
-		}
+	// The compact device side layout (see Vertex.glsl): full precision positions for the acceleration structures,
+	// an octahedral encoded normal and half float texture coordinates. The material index moves to a per triangle buffer.
+	struct CompactVertex final
+	{
+		glm::vec3 Position;
+		uint32_t Normal;
+		uint32_t TexCoord;
 
-		static std::array<VkVertexInputAttributeDescription, 4> GetAttributeDescriptions()
+		static CompactVertex Pack(const Vertex& vertex)
 		{
-			std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions = {};
-
-			attributeDescriptions[0].binding = 0;
-			attributeDescriptions[0].location = 0;
-			attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-			attributeDescriptions[0].offset = offsetof(Vertex, Position);
-
-			attributeDescriptions[1].binding = 0;
-			attributeDescriptions[1].location = 1;
-			attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-			attributeDescriptions[1].offset = offsetof(Vertex, Normal);
-
-			attributeDescriptions[2].binding = 0;
-			attributeDescriptions[2].location = 2;
-			attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-			attributeDescriptions[2].offset = offsetof(Vertex, TexCoord);
-
-			attributeDescriptions[3].binding = 0;
-			attributeDescriptions[3].location = 3;
-			attributeDescriptions[3].format = VK_FORMAT_R32_SINT;
-			attributeDescriptions[3].offset = offsetof(Vertex, MaterialIndex);
+			// Project the normal on the octahedron, then fold the lower hemisphere over the upper one.
+			const float length = glm::dot(glm::abs(vertex.Normal), glm::vec3(1));
+			const glm::vec3 n = length > 0 ? vertex.Normal / length : glm::vec3(0, 0, 1);
+			const glm::vec2 sign(n.x >= 0 ? 1.0f : -1.0f, n.y >= 0 ? 1.0f : -1.0f);
+			const glm::vec2 octahedral = n.z >= 0 ? glm::vec2(n) : (1.0f - glm::abs(glm::vec2(n.y, n.x))) * sign;
 
-			return attributeDescriptions;
+			return CompactVertex{ vertex.Position, glm::packSnorm2x16(octahedral), glm::packHalf2x16(vertex.TexCoord) };
 		}
 	};
 
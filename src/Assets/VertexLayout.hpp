@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Vertex.hpp"
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Assets
+{
+	// A vertex attribute the shaders read, at its byte offset in the vertex. The format is the one of its data as stored, e.g. the
+	// acceleration structure builds take the position format as is.
+	struct VertexAttribute final
+	{
+		const char* Name;
+		uint32_t Offset;
+		VkFormat Format;
+	};
+
+	// The device side layouts of the vertex buffer, the single definition behind the scene vertex stride, the acceleration structure
+	// builds and the GLSL constants of VertexLayout.glsl (generated by Tools/VertexLayoutGlsl.cpp at build time, see Vertex.glsl).
+	// A new compact layout is a new specialization listed in VertexLayouts below, the shaders then get its constants too.
+	template <class V>
+	struct VertexLayout;
+
+	template <>
+	struct VertexLayout<Vertex> final
+	{
+		static constexpr const char* Name = "Vertex";
+		static constexpr uint32_t Stride = sizeof(Vertex);
+		static constexpr VertexAttribute Position{ "Position", offsetof(Vertex, Position), VK_FORMAT_R32G32B32_SFLOAT };
+		static constexpr VertexAttribute Normal{ "Normal", offsetof(Vertex, Normal), VK_FORMAT_R32G32B32_SFLOAT };
+		static constexpr VertexAttribute TexCoord{ "TexCoord", offsetof(Vertex, TexCoord), VK_FORMAT_R32G32_SFLOAT };
+	};
+
+	template <>
+	struct VertexLayout<CompactVertex> final
+	{
+		static constexpr const char* Name = "CompactVertex";
+		static constexpr uint32_t Stride = sizeof(CompactVertex);
+		static constexpr VertexAttribute Position{ "Position", offsetof(CompactVertex, Position), VK_FORMAT_R32G32B32_SFLOAT };
+		static constexpr VertexAttribute Normal{ "Normal", offsetof(CompactVertex, Normal), VK_FORMAT_R16G16_SNORM }; // Octahedral.
+		static constexpr VertexAttribute TexCoord{ "TexCoord", offsetof(CompactVertex, TexCoord), VK_FORMAT_R16G16_SFLOAT };
+	};
+
+	template <class V>
+	constexpr std::array<VertexAttribute, 3> VertexAttributes()
+	{
+		return { VertexLayout<V>::Position, VertexLayout<V>::Normal, VertexLayout<V>::TexCoord };
+	}
+
+	// The shaders read the vertices as 32-bit words, the acceleration structures take their positions in place.
+	template <class V>
+	constexpr bool IsValidVertexLayout()
+	{
+		for (const auto& attribute : VertexAttributes<V>())
+		{
+			if (attribute.Offset % 4 != 0 || attribute.Offset >= VertexLayout<V>::Stride)
+			{
+				return false;
+			}
+		}
+
+		return VertexLayout<V>::Stride % 4 == 0 && VertexLayout<V>::Position.Format == VK_FORMAT_R32G32B32_SFLOAT;
+	}
+
+	static_assert(IsValidVertexLayout<Vertex>(), "invalid vertex layout");
+	static_assert(IsValidVertexLayout<CompactVertex>(), "invalid compact vertex layout");
+
+	// Every layout VertexLayout.glsl has the constants of.
+	template <class... V>
+	struct VertexLayoutList final
+	{
+		template <class Function>
+		static void ForEach(const Function& function)
+		{
+			(function(VertexLayout<V>::Name, VertexLayout<V>::Stride, VertexAttributes<V>()), ...);
+		}
+	};
+
+	using VertexLayouts = VertexLayoutList<Vertex, CompactVertex>;
+}
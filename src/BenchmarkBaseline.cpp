@@ -0,0 +1,354 @@
+#include "BenchmarkBaseline.hpp"
+#include "Utilities/Exception.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+	// Just enough JSON for the benchmark reports: objects, arrays, strings, numbers and literals.
+	struct JsonValue final
+	{
+		enum class Type { Null, Boolean, Number, String, Array, Object };
+
+		Type Kind{};
+		bool Boolean{};
+		double Number{};
+		std::string String;
+		std::vector<JsonValue> Values; // The array elements, or the object members.
+		std::vector<std::string> Keys; // Of the object members.
+
+		const JsonValue* Find(const std::string& key) const
+		{
+			for (size_t i = 0; i != Keys.size(); ++i)
+			{
+				if (Keys[i] == key)
+				{
+					return &Values[i];
+				}
+			}
+
+			return nullptr;
+		}
+
+		double NumberOr(const std::string& key, const double otherwise) const
+		{
+			const auto* const value = Find(key);
+			return value != nullptr && value->Kind == Type::Number ? value->Number : otherwise;
+		}
+
+		std::string StringOr(const std::string& key, const std::string& otherwise) const
+		{
+			const auto* const value = Find(key);
+			return value != nullptr && value->Kind == Type::String ? value->String : otherwise;
+		}
+	};
+
+	class JsonParser final
+	{
+	public:
+
+		JsonParser(const std::string& path, const std::string& text) :
+			path_(path), text_(text)
+		{
+		}
+
+		JsonValue Parse()
+		{
+			auto value = ParseValue();
+
+			SkipSpaces();
+
+			if (position_ != text_.size())
+			{
+				Fail("unexpected trailing characters");
+			}
+
+			return value;
+		}
+
+	private:
+
+		JsonValue ParseValue()
+		{
+			SkipSpaces();
+
+			JsonValue value;
+
+			if (Accept('{'))
+			{
+				value.Kind = JsonValue::Type::Object;
+
+				for (bool isFirst = true; !Accept('}'); isFirst = false)
+				{
+					if (!isFirst)
+					{
+						Expect(',');
+					}
+
+					SkipSpaces();
+					value.Keys.push_back(ParseString());
+					Expect(':');
+					value.Values.push_back(ParseValue());
+				}
+			}
+			else if (Accept('['))
+			{
+				value.Kind = JsonValue::Type::Array;
+
+				for (bool isFirst = true; !Accept(']'); isFirst = false)
+				{
+					if (!isFirst)
+					{
+						Expect(',');
+					}
+
+					value.Values.push_back(ParseValue());
+				}
+			}
+			else if (Peek() == '"')
+			{
+				value.Kind = JsonValue::Type::String;
+				value.String = ParseString();
+			}
+			else if (AcceptWord("true"))
+			{
+				value.Kind = JsonValue::Type::Boolean;
+				value.Boolean = true;
+			}
+			else if (AcceptWord("false"))
+			{
+				value.Kind = JsonValue::Type::Boolean;
+			}
+			else if (AcceptWord("null"))
+			{
+				value.Kind = JsonValue::Type::Null;
+			}
+			else
+			{
+				const char* const begin = text_.c_str() + position_;
+				char* end = nullptr;
+
+				value.Kind = JsonValue::Type::Number;
+				value.Number = std::strtod(begin, &end);
+
+				if (end == begin)
+				{
+					Fail("invalid value");
+				}
+
+				position_ += end - begin;
+			}
+
+			return value;
+		}
+
+		std::string ParseString()
+		{
+			Expect('"');
+
+			std::string string;
+
+			while (position_ < text_.size() && text_[position_] != '"')
+			{
+				char c = text_[position_++];
+
+				// The escapes the report writes, the other \u code points are kept as they are.
+				if (c == '\\' && position_ < text_.size())
+				{
+					c = text_[position_++];
+					c = c == 'n' ? '\n' : c == 't' ? '\t' : c;
+				}
+
+				string += c;
+			}
+
+			Expect('"');
+
+			return string;
+		}
+
+		void SkipSpaces()
+		{
+			while (position_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[position_])))
+			{
+				++position_;
+			}
+		}
+
+		char Peek()
+		{
+			SkipSpaces();
+			return position_ < text_.size() ? text_[position_] : '\0';
+		}
+
+		bool Accept(const char c)
+		{
+			if (Peek() != c)
+			{
+				return false;
+			}
+
+			++position_;
+			return true;
+		}
+
+		bool AcceptWord(const char* const word)
+		{
+			const std::string expected(word);
+
+			if (text_.compare(position_, expected.size(), expected) != 0)
+			{
+				return false;
+			}
+
+			position_ += expected.size();
+			return true;
+		}
+
+		void Expect(const char c)
+		{
+			if (!Accept(c))
+			{
+				Fail(std::string("expected '") + c + "'");
+			}
+		}
+
+		[[noreturn]] void Fail(const std::string& message) const
+		{
+			Throw(std::runtime_error("invalid benchmark baseline '" + path_ + "' at offset " + std::to_string(position_) + ": " + message));
+		}
+
+		const std::string& path_;
+		const std::string& text_;
+		size_t position_{};
+	};
+
+	BenchmarkReport::Summary ReadSummary(const JsonValue& summary)
+	{
+		BenchmarkReport::Summary result{};
+
+		result.Mean = summary.NumberOr("mean", 0);
+		result.Median = summary.NumberOr("median", 0);
+		result.P1 = summary.NumberOr("p1", 0);
+		result.P99 = summary.NumberOr("p99", 0);
+		result.InlierMean = summary.NumberOr("inlier_mean", result.Mean);
+		result.StdDev = summary.NumberOr("stddev", 0);
+		result.Confidence = summary.NumberOr("ci95", 0);
+		result.Count = static_cast<size_t>(summary.NumberOr("count", 0));
+		result.Outliers = static_cast<size_t>(summary.NumberOr("outliers", 0));
+
+		return result;
+	}
+}
+
+BenchmarkBaseline::BenchmarkBaseline(const std::string& path, const double threshold) :
+	path_(path),
+	threshold_(threshold)
+{
+	std::ifstream file(path);
+
+	if (!file)
+	{
+		Throw(std::runtime_error("cannot open benchmark baseline '" + path + "'"));
+	}
+
+	std::ostringstream text;
+	text << file.rdbuf();
+
+	const auto contents = text.str();
+	const auto report = JsonParser(path, contents).Parse();
+	const auto* const scenes = report.Find("scenes");
+
+	if (scenes == nullptr || scenes->Kind != JsonValue::Type::Array)
+	{
+		Throw(std::runtime_error("benchmark baseline '" + path + "' has no scenes, only the JSON reports can be compared against"));
+	}
+
+	for (const auto& record : scenes->Values)
+	{
+		const auto* const frameTimes = record.Find("frame_time_ms");
+		const auto* const traceTimes = record.Find("trace_time_ms");
+
+		if (frameTimes == nullptr)
+		{
+			continue;
+		}
+
+		Scene scene{};
+		scene.SceneName = record.StringOr("scene_name", "");
+		scene.SweepPoint = record.StringOr("sweep", "");
+		scene.Width = static_cast<uint32_t>(record.NumberOr("width", 0));
+		scene.Height = static_cast<uint32_t>(record.NumberOr("height", 0));
+		scene.FrameTimes = ReadSummary(*frameTimes);
+		scene.HasTraceTimes = traceTimes != nullptr;
+		scene.TraceTimes = traceTimes != nullptr ? ReadSummary(*traceTimes) : BenchmarkReport::Summary{};
+
+		scenes_.push_back(scene);
+	}
+
+	std::cout << "Benchmark: comparing against " << scenes_.size() << " scenes of '" << path_ << "'" << std::endl;
+}
+
+void BenchmarkBaseline::Compare(BenchmarkRecord& record)
+{
+	record.BaselineTime = -1;
+	record.BaselineChange = 0;
+	record.Regression = false;
+
+	const Scene* baseline = nullptr;
+
+	for (const auto& scene : scenes_)
+	{
+		if (scene.SceneName == record.SceneName && scene.SweepPoint == record.SweepPoint && scene.Width == record.Width && scene.Height == record.Height)
+		{
+			baseline = &scene;
+			break;
+		}
+	}
+
+	if (baseline == nullptr || record.FrameTimes.empty())
+	{
+		std::cout << "Benchmark: scene #" << record.SceneIndex << " is not in the baseline" << std::endl;
+		return;
+	}
+
+	// The GPU trace times are less noisy than the frame times, which also hold the host and the presentation.
+	const bool isTraced = baseline->HasTraceTimes && !record.TraceTimes.empty();
+	const auto current = BenchmarkReport::Summarize(isTraced ? record.TraceTimes : record.FrameTimes);
+	const auto& previous = isTraced ? baseline->TraceTimes : baseline->FrameTimes;
+
+	if (previous.InlierMean <= 0)
+	{
+		return;
+	}
+
+	record.BaselineTime = previous.InlierMean;
+	record.BaselineChange = current.InlierMean / previous.InlierMean - 1;
+
+	// Welch's t statistic, without the variances of an old baseline there is no test.
+	const double standardError = std::sqrt(
+		(current.Count != 0 ? current.StdDev * current.StdDev / current.Count : 0) +
+		(previous.Count != 0 ? previous.StdDev * previous.StdDev / previous.Count : 0));
+	const bool isTested = previous.Count > 1 && current.Count > 1 && standardError > 0;
+	const double t = isTested ? (current.InlierMean - previous.InlierMean) / standardError : 0;
+
+	record.Regression = isTested && t > 1.96 && record.BaselineChange > threshold_;
+	regressionCount_ += record.Regression ? 1 : 0;
+
+	std::cout << "Benchmark: scene #" << record.SceneIndex << " " << (isTraced ? "trace" : "frame") << " time " << std::fixed << std::setprecision(3)
+		<< current.InlierMean << " ms (+/- " << current.Confidence << ") against " << previous.InlierMean << " ms (+/- " << previous.Confidence << "), "
+		<< std::showpos << std::setprecision(1) << record.BaselineChange * 100 << std::noshowpos << "%";
+
+	if (isTested)
+	{
+		std::cout << std::setprecision(2) << ", t = " << t;
+	}
+
+	std::cout << std::defaultfloat << (record.Regression ? " REGRESSION" : isTested && t < -1.96 ? " (faster)" : "") << std::endl;
+}
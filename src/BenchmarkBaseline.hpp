@@ -0,0 +1,44 @@
+#pragma once
+#include "BenchmarkReport.hpp"
+#include "Vulkan/Vulkan.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The scenes of a previous JSON benchmark report (see --compare-baseline), the new records being tested against them for regressions.
+// A record is matched by its scene, sweep point and extent. Its GPU trace times are compared when both reports have them, its frame
+// times otherwise, with Welch's t-test on the inlier means (see BenchmarkReport::Summary). A regression is slower than the baseline by
+// more than the threshold, and significant at the 95% level (t above 1.96, the frame counts being large enough for the normal approximation).
+// The baselines written before the inlier statistics only get the relative change.
+class BenchmarkBaseline final
+{
+public:
+
+	VULKAN_NON_COPIABLE(BenchmarkBaseline)
+
+	BenchmarkBaseline(const std::string& path, double threshold);
+	~BenchmarkBaseline() = default;
+
+	// Fills in the baseline fields of the record and prints the verdict.
+	void Compare(BenchmarkRecord& record);
+
+	uint32_t RegressionCount() const { return regressionCount_; }
+
+private:
+
+	struct Scene final
+	{
+		std::string SceneName;
+		std::string SweepPoint;
+		uint32_t Width;
+		uint32_t Height;
+		BenchmarkReport::Summary FrameTimes;
+		BenchmarkReport::Summary TraceTimes;
+		bool HasTraceTimes;
+	};
+
+	const std::string path_;
+	const double threshold_;
+	std::vector<Scene> scenes_;
+	uint32_t regressionCount_{};
+};
@@ -0,0 +1,562 @@
+#include "BenchmarkReport.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/Exception.hpp"
+#include "Utilities/StbImage.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <ostream>
+#include <sstream>
+
+namespace
+{
+	std::string EscapeJson(const std::string& text)
+	{
+		std::ostringstream out;
+
+		for (const char c : text)
+		{
+			switch (c)
+			{
+			case '"': out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			case '\n': out << "\\n"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+				}
+				else
+				{
+					out << c;
+				}
+			}
+		}
+
+		return out.str();
+	}
+
+	std::string EscapeCsv(const std::string& text)
+	{
+		std::string escaped = "\"";
+
+		for (const char c : text)
+		{
+			escaped += c == '"' ? std::string("\"\"") : std::string(1, c);
+		}
+
+		return escaped + "\"";
+	}
+
+	// The stages of Profile.glsl, each followed by its bounce buckets in the stage clocks.
+	const char* const ProfileStageNames[] = { "ray_generation", "trace", "light_sampling", "closest_hit", "intersection" };
+	const size_t ProfileStageCount = std::size(ProfileStageNames);
+
+	// The counters of RayCounters.glsl, followed by the rays per bounce.
+	const char* const RayCounterNames[] = { "rays", "shadow_rays", "misses", "absorptions", "roulette", "bounce_limit", "radiance_cache_paths", "medium_collisions" };
+	const size_t RayCounterCount = std::size(RayCounterNames);
+
+	const char* RayIsolationString(const uint32_t rayIsolation)
+	{
+		return rayIsolation == 1 ? "primary" : rayIsolation == 2 ? "shadow" : "full";
+	}
+
+	std::string HashString(const uint64_t hash)
+	{
+		std::ostringstream out;
+		out << std::hex << std::setw(16) << std::setfill('0') << hash;
+		return out.str();
+	}
+}
+
+BenchmarkReport::BenchmarkReport(const std::string& path) :
+	path_(path),
+	isCsv_(std::filesystem::path(path).extension() == ".csv")
+{
+}
+
+void BenchmarkReport::Add(const BenchmarkRecord& record)
+{
+	records_.push_back(record);
+	Write();
+}
+
+void BenchmarkReport::CompareWithReference(const std::string& referencePath, const VkExtent2D extent, const std::vector<float>& pixels, double& psnr, double& ssim)
+{
+	psnr = -1;
+	ssim = -1;
+
+	int width, height, channels;
+	stbi_uc* const reference = stbi_load(referencePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+	if (reference == nullptr || static_cast<uint32_t>(width) != extent.width || static_cast<uint32_t>(height) != extent.height)
+	{
+		stbi_image_free(reference);
+
+		Utilities::Console::Write(Utilities::Severity::Warning, [&referencePath]()
+		{
+			std::cout << "WARNING: benchmark reference '" << referencePath << "' is missing or does not match the framebuffer size" << std::endl;
+		});
+
+		return;
+	}
+
+	// Quantized like the PNG export, so that the reference can be a previous export of the same scene.
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	std::vector<float> lumas(pixelCount * 2);
+	double squaredError = 0;
+
+	for (size_t i = 0; i != pixelCount; ++i)
+	{
+		const float scale = 1.0f / std::max(pixels[i * 4 + 3], 1.0f);
+		int values[3];
+
+		for (size_t c = 0; c != 3; ++c)
+		{
+			values[c] = static_cast<int>(std::clamp(std::sqrt(pixels[i * 4 + c] * scale), 0.0f, 1.0f) * 255.0f + 0.5f);
+			const auto error = static_cast<double>(values[c] - reference[i * 4 + c]);
+			squaredError += error * error;
+		}
+
+		lumas[i * 2 + 0] = 0.299f * values[0] + 0.587f * values[1] + 0.114f * values[2];
+		lumas[i * 2 + 1] = 0.299f * reference[i * 4 + 0] + 0.587f * reference[i * 4 + 1] + 0.114f * reference[i * 4 + 2];
+	}
+
+	stbi_image_free(reference);
+
+	// Identical images are capped, infinity does not fit in the JSON report.
+	const double meanSquaredError = std::max(squaredError / (pixelCount * 3), 1e-10);
+	psnr = 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+
+	// The mean SSIM of the luma over 8x8 windows, overlapping by half.
+	const int window = 8;
+	const int stride = window / 2;
+	const double c1 = (0.01 * 255) * (0.01 * 255);
+	const double c2 = (0.03 * 255) * (0.03 * 255);
+	double ssimSum = 0;
+	size_t windowCount = 0;
+
+	for (int y = 0; y + window <= height; y += stride)
+	{
+		for (int x = 0; x + window <= width; x += stride)
+		{
+			double sumA = 0, sumB = 0, sumAA = 0, sumBB = 0, sumAB = 0;
+
+			for (int j = y; j != y + window; ++j)
+			{
+				for (int i = x; i != x + window; ++i)
+				{
+					const double a = lumas[(static_cast<size_t>(j) * width + i) * 2 + 0];
+					const double b = lumas[(static_cast<size_t>(j) * width + i) * 2 + 1];
+
+					sumA += a;
+					sumB += b;
+					sumAA += a * a;
+					sumBB += b * b;
+					sumAB += a * b;
+				}
+			}
+
+			const double n = window * window;
+			const double meanA = sumA / n;
+			const double meanB = sumB / n;
+			const double varianceA = sumAA / n - meanA * meanA;
+			const double varianceB = sumBB / n - meanB * meanB;
+			const double covariance = sumAB / n - meanA * meanB;
+
+			ssimSum += (2 * meanA * meanB + c1) * (2 * covariance + c2) / ((meanA * meanA + meanB * meanB + c1) * (varianceA + varianceB + c2));
+			windowCount++;
+		}
+	}
+
+	ssim = windowCount != 0 ? std::max(ssimSum / windowCount, 0.0) : -1;
+}
+
+double BenchmarkReport::TimeNormalizedPsnr(const double psnr, const double renderTime)
+{
+	return psnr - 10.0 * std::log10(std::max(renderTime, 1e-3) / 1000.0);
+}
+
+double BenchmarkReport::ConvergenceRate(const double psnr, const double renderTime)
+{
+	return std::pow(10.0, psnr / 10.0) / std::max(renderTime, 1e-3);
+}
+
+double BenchmarkReport::JoulesPerFrame(const BenchmarkRecord& record)
+{
+	return !record.FrameTimes.empty() ? record.Energy / record.FrameTimes.size() : 0;
+}
+
+double BenchmarkReport::GraysPerJoule(const double grays, const double power)
+{
+	return power > 0 ? grays / power : 0;
+}
+
+uint64_t BenchmarkReport::ComputeHash(const std::vector<float>& pixels)
+{
+	const auto* const bytes = reinterpret_cast<const uint8_t*>(pixels.data());
+	uint64_t hash = 14695981039346656037ull;
+
+	for (size_t i = 0; i != pixels.size() * sizeof(float); ++i)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+
+	return hash;
+}
+
+BenchmarkReport::Summary BenchmarkReport::Summarize(std::vector<double> values)
+{
+	if (values.empty())
+	{
+		return Summary{};
+	}
+
+	std::sort(values.begin(), values.end());
+
+	// Nearest rank percentiles.
+	const auto percentile = [&values](const double p)
+	{
+		const auto rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+		return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+	};
+
+	Summary summary{};
+	summary.Mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+	summary.Median = percentile(50);
+	summary.P1 = percentile(1);
+	summary.P99 = percentile(99);
+
+	// The median absolute deviation scaled to a standard deviation for normally distributed times. Nothing is an outlier if most times are equal.
+	std::vector<double> deviations(values.size());
+	std::transform(values.begin(), values.end(), deviations.begin(), [&summary](const double value) { return std::abs(value - summary.Median); });
+	std::nth_element(deviations.begin(), deviations.begin() + deviations.size() / 2, deviations.end());
+
+	const double scaledDeviation = 1.4826 * deviations[deviations.size() / 2];
+	double sum = 0;
+	double squaredSum = 0;
+
+	for (const double value : values)
+	{
+		if (scaledDeviation > 0 && std::abs(value - summary.Median) / scaledDeviation > 3.5)
+		{
+			summary.Outliers++;
+			continue;
+		}
+
+		sum += value;
+		squaredSum += value * value;
+		summary.Count++;
+	}
+
+	const double n = static_cast<double>(summary.Count);
+
+	summary.InlierMean = sum / n;
+	summary.StdDev = summary.Count > 1 ? std::sqrt(std::max(squaredSum - sum * sum / n, 0.0) / (n - 1)) : 0;
+	summary.Confidence = 1.96 * summary.StdDev / std::sqrt(n);
+
+	return summary;
+}
+
+void BenchmarkReport::Write() const
+{
+	std::ofstream file(path_, std::ios::trunc);
+
+	if (!file)
+	{
+		Throw(std::runtime_error("failed to open benchmark output '" + path_ + "'"));
+	}
+
+	file << std::setprecision(6);
+	isCsv_ ? WriteCsv(file) : WriteJson(file);
+}
+
+void BenchmarkReport::WriteCsv(std::ostream& out) const
+{
+	out << "scene_index,scene_name,sweep,device,driver_version,width,height,samples,bounces,roulette_depth,reorder,regenerate_paths,wavefront,hybrid,restir,light_tree,radiance_cache,path_guiding,rays,views,tessellated_spheres,launch_order,total_samples,scene_load_s,as_build_s,instances,tlas_build_ms,blas_build_ms,position_stream,host_visible_sbt,instance_upload_ms,device_memory_bytes,"
+		"device_local_usage_bytes,device_local_budget_bytes,geometry_bytes,texture_bytes,blas_bytes,tlas_bytes,scratch_bytes,image_bytes,frames,grays,"
+		"frame_mean_ms,frame_median_ms,frame_p1_ms,frame_p99_ms,trace_mean_ms,trace_median_ms,trace_p1_ms,trace_p99_ms,render_ms,psnr_db,ssim,psnr_1s_db,convergence_per_ms,sample_limit_s,accumulation_hash";
+
+	for (const auto* const stage : ProfileStageNames)
+	{
+		out << ',' << stage << "_clocks";
+	}
+
+	out << ",total_grays";
+
+	for (const auto* const counter : RayCounterNames)
+	{
+		out << ',' << counter;
+	}
+
+	out << ",frame_inlier_mean_ms,frame_stddev_ms,frame_ci95_ms,frame_outliers,trace_inlier_mean_ms,trace_stddev_ms,trace_ci95_ms,trace_outliers,baseline_ms,baseline_change,regression,power_w,energy_j,joules_per_frame,grays_per_joule,total_grays_per_joule";
+	out << '\n';
+
+	for (const auto& record : records_)
+	{
+		const auto frames = Summarize(record.FrameTimes);
+		const auto trace = Summarize(record.TraceTimes);
+
+		out << record.SceneIndex << ',' << EscapeCsv(record.SceneName) << ',' << EscapeCsv(record.SweepPoint) << ',' << EscapeCsv(record.DeviceName) << ',' << EscapeCsv(record.DriverVersion) << ','
+			<< record.Width << ',' << record.Height << ',' << record.Samples << ',' << record.Bounces << ','
+			<< record.RouletteDepth << ',' << record.InvocationReorder << ',' << record.RegeneratePaths << ',' << record.Wavefront << ',' << record.Hybrid << ',' << record.Restir << ',' << record.LightTree << ',' << record.RadianceCache << ',' << record.PathGuiding << ',' << RayIsolationString(record.RayIsolation) << ',' << record.Views << ',' << record.TessellatedSpheres << ',' << record.LaunchOrder << ',' << record.TotalSamples << ','
+			<< record.SceneLoadTime << ',' << record.BuildTime << ',' << record.InstanceCount << ',' << record.TopLevelBuildTime << ','
+			<< record.BottomLevelBuildTime << ',' << record.PositionStream << ',' << record.HostVisibleShaderBindingTable << ','
+			<< record.InstanceUploadTime << ',' << record.DeviceMemoryUsed << ','
+			<< record.DeviceLocalUsage << ',' << record.DeviceLocalBudget << ',' << record.GeometryMemory << ',' << record.TextureMemory << ','
+			<< record.BottomLevelMemory << ',' << record.TopLevelMemory << ',' << record.ScratchMemory << ',' << record.ImageMemory << ','
+			<< record.FrameTimes.size() << ',' << record.Grays << ','
+			<< frames.Mean << ',' << frames.Median << ',' << frames.P1 << ',' << frames.P99 << ',';
+
+		// Empty fields when the GPU trace time has not been measured.
+		if (!record.TraceTimes.empty())
+		{
+			out << trace.Mean << ',' << trace.Median << ',' << trace.P1 << ',' << trace.P99;
+		}
+		else
+		{
+			out << ",,,";
+		}
+
+		out << ',' << record.RenderTime;
+
+		// Empty fields without a reference image.
+		out << ',';
+
+		if (record.Psnr >= 0)
+		{
+			out << record.Psnr << ',' << record.Ssim << ',' << TimeNormalizedPsnr(record.Psnr, record.RenderTime) << ',' << ConvergenceRate(record.Psnr, record.RenderTime);
+		}
+		else
+		{
+			out << ",,,";
+		}
+
+		// Empty fields outside of the deterministic mode.
+		out << ',';
+
+		if (record.SampleLimitTime >= 0)
+		{
+			out << record.SampleLimitTime << ',' << HashString(record.AccumulationHash);
+		}
+		else
+		{
+			out << ',';
+		}
+
+		// The stage totals over the bounces, empty fields without profiling.
+		for (size_t stage = 0; stage != ProfileStageCount; ++stage)
+		{
+			out << ',';
+
+			if (!record.StageClocks.empty())
+			{
+				const size_t bounceCount = record.StageClocks.size() / ProfileStageCount;
+				const auto first = record.StageClocks.begin() + stage * bounceCount;
+				out << std::accumulate(first, first + bounceCount, uint64_t(0));
+			}
+		}
+
+		out << ',' << record.TotalGrays;
+
+		for (size_t counter = 0; counter != RayCounterCount; ++counter)
+		{
+			out << ',';
+
+			if (counter < record.RayCounters.size())
+			{
+				out << record.RayCounters[counter];
+			}
+		}
+
+		out << ',' << frames.InlierMean << ',' << frames.StdDev << ',' << frames.Confidence << ',' << frames.Outliers << ',';
+
+		if (!record.TraceTimes.empty())
+		{
+			out << trace.InlierMean << ',' << trace.StdDev << ',' << trace.Confidence << ',' << trace.Outliers;
+		}
+		else
+		{
+			out << ",,,";
+		}
+
+		// Empty fields without a baseline.
+		out << ',';
+
+		if (record.BaselineTime >= 0)
+		{
+			out << record.BaselineTime << ',' << record.BaselineChange << ',' << record.Regression;
+		}
+		else
+		{
+			out << ",,";
+		}
+
+		// Empty fields without a power sensor.
+		out << ',';
+
+		if (record.Power >= 0)
+		{
+			out << record.Power << ',' << record.Energy << ',' << JoulesPerFrame(record) << ',' << GraysPerJoule(record.Grays, record.Power) << ',' << GraysPerJoule(record.TotalGrays, record.Power);
+		}
+		else
+		{
+			out << ",,,,";
+		}
+
+		out << '\n';
+	}
+}
+
+void BenchmarkReport::WriteJson(std::ostream& out) const
+{
+	const auto writeSummary = [&out](const char* const name, const Summary& summary)
+	{
+		out << "      \"" << name << "\": { \"mean\": " << summary.Mean << ", \"median\": " << summary.Median
+			<< ", \"p1\": " << summary.P1 << ", \"p99\": " << summary.P99 << ", \"inlier_mean\": " << summary.InlierMean
+			<< ", \"stddev\": " << summary.StdDev << ", \"ci95\": " << summary.Confidence << ", \"count\": " << summary.Count
+			<< ", \"outliers\": " << summary.Outliers << " }";
+	};
+
+	out << "{\n  \"scenes\": [";
+
+	for (size_t i = 0; i != records_.size(); ++i)
+	{
+		const auto& record = records_[i];
+
+		out << (i == 0 ? "\n" : ",\n");
+		out << "    {\n";
+		out << "      \"scene_index\": " << record.SceneIndex << ",\n";
+		out << "      \"scene_name\": \"" << EscapeJson(record.SceneName) << "\",\n";
+
+		if (!record.SweepPoint.empty())
+		{
+			out << "      \"sweep\": \"" << EscapeJson(record.SweepPoint) << "\",\n";
+		}
+
+		out << "      \"device\": \"" << EscapeJson(record.DeviceName) << "\",\n";
+		out << "      \"driver_version\": \"" << EscapeJson(record.DriverVersion) << "\",\n";
+		out << "      \"width\": " << record.Width << ",\n";
+		out << "      \"height\": " << record.Height << ",\n";
+		out << "      \"samples\": " << record.Samples << ",\n";
+		out << "      \"bounces\": " << record.Bounces << ",\n";
+		out << "      \"roulette_depth\": " << record.RouletteDepth << ",\n";
+		out << "      \"reorder\": " << (record.InvocationReorder ? "true" : "false") << ",\n";
+		out << "      \"regenerate_paths\": " << (record.RegeneratePaths ? "true" : "false") << ",\n";
+		out << "      \"wavefront\": " << (record.Wavefront ? "true" : "false") << ",\n";
+		out << "      \"hybrid\": " << (record.Hybrid ? "true" : "false") << ",\n";
+		out << "      \"restir\": " << (record.Restir ? "true" : "false") << ",\n";
+		out << "      \"light_tree\": " << (record.LightTree ? "true" : "false") << ",\n";
+		out << "      \"radiance_cache\": " << (record.RadianceCache ? "true" : "false") << ",\n";
+		out << "      \"path_guiding\": " << (record.PathGuiding ? "true" : "false") << ",\n";
+		out << "      \"rays\": \"" << RayIsolationString(record.RayIsolation) << "\",\n";
+		out << "      \"views\": " << record.Views << ",\n";
+		out << "      \"tessellated_spheres\": " << (record.TessellatedSpheres ? "true" : "false") << ",\n";
+		out << "      \"launch_order\": " << record.LaunchOrder << ",\n";
+		out << "      \"total_samples\": " << record.TotalSamples << ",\n";
+		out << "      \"scene_load_s\": " << record.SceneLoadTime << ",\n";
+		out << "      \"as_build_s\": " << record.BuildTime << ",\n";
+		out << "      \"instances\": " << record.InstanceCount << ",\n";
+		out << "      \"tlas_build_ms\": " << record.TopLevelBuildTime << ",\n";
+		out << "      \"blas_build_ms\": " << record.BottomLevelBuildTime << ",\n";
+		out << "      \"position_stream\": " << (record.PositionStream ? "true" : "false") << ",\n";
+		out << "      \"host_visible_sbt\": " << (record.HostVisibleShaderBindingTable ? "true" : "false") << ",\n";
+		out << "      \"instance_upload_ms\": " << record.InstanceUploadTime << ",\n";
+		out << "      \"device_memory_bytes\": " << record.DeviceMemoryUsed << ",\n";
+		out << "      \"device_local_usage_bytes\": " << record.DeviceLocalUsage << ",\n";
+		out << "      \"device_local_budget_bytes\": " << record.DeviceLocalBudget << ",\n";
+		out << "      \"memory_bytes\": { \"geometry\": " << record.GeometryMemory << ", \"textures\": " << record.TextureMemory
+			<< ", \"blas\": " << record.BottomLevelMemory << ", \"tlas\": " << record.TopLevelMemory
+			<< ", \"scratch\": " << record.ScratchMemory << ", \"images\": " << record.ImageMemory << " },\n";
+		out << "      \"frames\": " << record.FrameTimes.size() << ",\n";
+		out << "      \"grays\": " << record.Grays << ",\n";
+		out << "      \"total_grays\": " << record.TotalGrays << ",\n";
+
+		// The rays counted on the GPU, then the bounce rays per depth.
+		if (record.RayCounters.size() > RayCounterCount)
+		{
+			out << "      \"ray_counts\": {";
+
+			for (size_t counter = 0; counter != RayCounterCount; ++counter)
+			{
+				out << (counter == 0 ? " \"" : ", \"") << RayCounterNames[counter] << "\": " << record.RayCounters[counter];
+			}
+
+			out << ", \"per_bounce\": [";
+
+			for (size_t bounce = RayCounterCount; bounce != record.RayCounters.size(); ++bounce)
+			{
+				out << (bounce == RayCounterCount ? "" : ", ") << record.RayCounters[bounce];
+			}
+
+			out << "] },\n";
+		}
+
+		writeSummary("frame_time_ms", Summarize(record.FrameTimes));
+
+		if (!record.TraceTimes.empty())
+		{
+			out << ",\n";
+			writeSummary("trace_time_ms", Summarize(record.TraceTimes));
+		}
+
+		out << ",\n      \"render_ms\": " << record.RenderTime;
+
+		if (record.Psnr >= 0)
+		{
+			out << ",\n      \"psnr_db\": " << record.Psnr;
+			out << ",\n      \"ssim\": " << record.Ssim;
+			out << ",\n      \"psnr_1s_db\": " << TimeNormalizedPsnr(record.Psnr, record.RenderTime);
+			out << ",\n      \"convergence_per_ms\": " << ConvergenceRate(record.Psnr, record.RenderTime);
+		}
+
+		if (record.SampleLimitTime >= 0)
+		{
+			out << ",\n      \"sample_limit_s\": " << record.SampleLimitTime;
+			out << ",\n      \"accumulation_hash\": \"" << HashString(record.AccumulationHash) << "\"";
+		}
+
+		// The clocks of every stage per bounce, the hit shaders only fill the first bucket.
+		if (!record.StageClocks.empty())
+		{
+			const size_t bounceCount = record.StageClocks.size() / ProfileStageCount;
+
+			out << ",\n      \"stage_clocks\": {";
+
+			for (size_t stage = 0; stage != ProfileStageCount; ++stage)
+			{
+				out << (stage == 0 ? " \"" : ", \"") << ProfileStageNames[stage] << "\": [";
+
+				for (size_t bounce = 0; bounce != bounceCount; ++bounce)
+				{
+					out << (bounce == 0 ? "" : ", ") << record.StageClocks[stage * bounceCount + bounce];
+				}
+
+				out << "]";
+			}
+
+			out << " }";
+		}
+
+		if (record.Power >= 0)
+		{
+			out << ",\n      \"power\": { \"watts\": " << record.Power << ", \"joules\": " << record.Energy << ", \"joules_per_frame\": " << JoulesPerFrame(record)
+				<< ", \"grays_per_joule\": " << GraysPerJoule(record.Grays, record.Power) << ", \"total_grays_per_joule\": " << GraysPerJoule(record.TotalGrays, record.Power) << " }";
+		}
+
+		if (record.BaselineTime >= 0)
+		{
+			out << ",\n      \"baseline\": { \"time_ms\": " << record.BaselineTime << ", \"change\": " << record.BaselineChange
+				<< ", \"regression\": " << (record.Regression ? "true" : "false") << " }";
+		}
+
+		out << "\n    }";
+	}
+
+	out << "\n  ]\n}\n";
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "Vulkan/Vulkan.hpp"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// The benchmark results of a single scene.
+struct BenchmarkRecord final
+{
+	uint32_t SceneIndex;
+	std::string SceneName;
+	std::string SweepPoint; // The swept parameter values, empty without --sweep
+	std::string DeviceName;
+	std::string DriverVersion;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Samples;
+	uint32_t Bounces;
+	uint32_t RouletteDepth; // 0 if disabled
+	bool InvocationReorder;
+	bool RegeneratePaths; // Not with the wavefront backend.
+	bool Wavefront;
+	bool Hybrid; // Rasterized primary visibility, with the wavefront backend only.
+	bool Restir; // Reservoir resampling of the lights, with the light sampling only.
+	bool LightTree; // With the light sampling only.
+	bool RadianceCache; // Not with the wavefront backend.
+	bool PathGuiding; // Not with the wavefront backend.
+	uint32_t RayIsolation; // See UserSettings::RayIsolation, 0 with the wavefront backend.
+	uint32_t Views; // Cameras traced by every launch, 1 with the wavefront backend.
+	bool TessellatedSpheres;
+	uint32_t LaunchOrder; // See LaunchOrder.glsl
+	uint32_t TotalSamples; // accumulated per pixel
+	double SceneLoadTime; // seconds
+	double BuildTime; // seconds, negative if unknown
+	uint32_t InstanceCount; // TLAS instances
+	double TopLevelBuildTime; // GPU milliseconds, negative if unknown
+	double BottomLevelBuildTime; // GPU milliseconds, negative if unknown
+	bool PositionStream; // whether the BLAS builds read the packed position buffer
+	bool HostVisibleShaderBindingTable; // whether the SBT records are fetched from host visible memory rather than device local
+	double InstanceUploadTime; // milliseconds
+	uint64_t DeviceMemoryUsed; // bytes allocated by the memory allocator
+	uint64_t DeviceLocalUsage; // bytes of the device local heaps used by the process (only by the allocator without VK_EXT_memory_budget)
+	uint64_t DeviceLocalBudget; // bytes of the device local heaps the process can use (their size without VK_EXT_memory_budget)
+	uint64_t GeometryMemory; // bytes, as are the other categories of allocations below
+	uint64_t TextureMemory;
+	uint64_t BottomLevelMemory;
+	uint64_t TopLevelMemory;
+	uint64_t ScratchMemory;
+	uint64_t ImageMemory;
+	std::vector<double> FrameTimes; // milliseconds
+	std::vector<double> TraceTimes; // GPU milliseconds, empty without timestamps
+	double Grays; // billion primary rays per second over the whole scene
+	double TotalGrays; // billion rays counted on the GPU per second over the whole scene, the bounce and shadow rays included
+	std::vector<uint64_t> RayCounters; // summed over the scene (see RayCounters.glsl), empty or zero when not counted
+	double RenderTime; // milliseconds, of GPU tracing when measured and of the whole scene otherwise
+	double Psnr; // dB against the reference image, negative if unknown
+	double Ssim; // against the reference image, negative if unknown
+	double SampleLimitTime; // seconds to the sample limit in deterministic mode, negative otherwise
+	uint64_t AccumulationHash; // of the accumulation sums in deterministic mode, 0 otherwise
+	std::vector<uint64_t> StageClocks; // GPU clocks per profiled stage and bounce (see Profile.glsl), empty without --profile-stages
+	double Power; // average watts of the GPU board over the scene, negative without --measure-power or a sensor
+	double Energy; // joules over the scene, negative as the power
+	double BaselineTime; // milliseconds per frame (or per trace) of the same scene in the baseline report, negative without one
+	double BaselineChange; // relative to the baseline time, positive when slower
+	bool Regression; // significantly slower than the baseline, see BenchmarkBaseline
+};
+
+// Writes the benchmark records as JSON, or as CSV when the file extension is .csv.
+// The whole file is rewritten after every scene, so an interrupted run still leaves a valid report.
+class BenchmarkReport final
+{
+public:
+
+	VULKAN_NON_COPIABLE(BenchmarkReport)
+
+	explicit BenchmarkReport(const std::string& path);
+	~BenchmarkReport() = default;
+
+	void Add(const BenchmarkRecord& record);
+
+	// PSNR and SSIM of the accumulation sums against an 8-bit reference image, both with the PNG export gamma correction.
+	// Both negative if the reference cannot be loaded or does not match the extent.
+	static void CompareWithReference(const std::string& referencePath, VkExtent2D extent, const std::vector<float>& pixels, double& psnr, double& ssim);
+
+	// The PSNR the same settings would reach in one second of rendering, the error variance being inversely proportional to the render time.
+	// Unlike the PSNR, it weighs the quality against the cost of settings that trace more or fewer samples in the same time.
+	static double TimeNormalizedPsnr(double psnr, double renderTime);
+
+	// The inverse of the error variance (the PSNR once back out of decibels) gained per millisecond of rendering.
+	// The same as the time normalized PSNR but linear, the ratio of two settings is how much faster one converges.
+	static double ConvergenceRate(double psnr, double renderTime);
+
+	// The energy of the average frame of the scene, and the billion rays traced per joule at the given ray rate (Grays/s over watts).
+	static double JoulesPerFrame(const BenchmarkRecord& record);
+	static double GraysPerJoule(double grays, double power);
+
+	// FNV-1a of the accumulation sums, the same on every run of a deterministic benchmark unless the rendering has changed.
+	static uint64_t ComputeHash(const std::vector<float>& pixels);
+
+	// The outliers are the times whose modified z-score (their distance to the median in median absolute deviations) is above 3.5,
+	// after Iglewicz and Hoaglin: a shader compile, a texture upload or a hitch on the host. The inlier statistics leave them out,
+	// their confidence interval assuming independent times.
+	struct Summary final
+	{
+		double Mean;
+		double Median;
+		double P1;
+		double P99;
+		double InlierMean;
+		double StdDev; // Of the inliers.
+		double Confidence; // Half width of the 95% confidence interval of the inlier mean.
+		size_t Count; // Inliers.
+		size_t Outliers;
+	};
+
+	static Summary Summarize(std::vector<double> values);
+
+private:
+
+	void Write() const;
+	void WriteCsv(std::ostream& out) const;
+	void WriteJson(std::ostream& out) const;
+
+	const std::string path_;
+	const bool isCsv_;
+	std::vector<BenchmarkRecord> records_;
+};
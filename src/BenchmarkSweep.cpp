@@ -0,0 +1,161 @@
+#include "BenchmarkSweep.hpp"
+#include "Utilities/Exception.hpp"
+#include <sstream>
+
+namespace
+{
+	std::vector<std::string> Split(const std::string& text, const char separator)
+	{
+		std::vector<std::string> values;
+		std::istringstream in(text);
+		std::string value;
+
+		while (std::getline(in, value, separator))
+		{
+			values.push_back(value);
+		}
+
+		return values;
+	}
+
+	uint32_t ParseCount(const std::string& parameter, const std::string& value)
+	{
+		size_t end = 0;
+		unsigned long count = 0;
+
+		try
+		{
+			count = std::stoul(value, &end);
+		}
+		catch (const std::exception&)
+		{
+			end = 0;
+		}
+
+		if (end == 0 || end != value.size() || count == 0 || count > 65536)
+		{
+			Throw(std::invalid_argument("invalid sweep value '" + value + "' for " + parameter));
+		}
+
+		return static_cast<uint32_t>(count);
+	}
+
+	VkExtent2D ParseResolution(const std::string& value)
+	{
+		if (value == "720p") return { 1280, 720 };
+		if (value == "1080p") return { 1920, 1080 };
+		if (value == "1440p") return { 2560, 1440 };
+		if (value == "4K" || value == "4k" || value == "2160p") return { 3840, 2160 };
+
+		const auto separator = value.find('x');
+
+		if (separator == std::string::npos)
+		{
+			Throw(std::invalid_argument("invalid sweep resolution '" + value + "'"));
+		}
+
+		return { ParseCount("res", value.substr(0, separator)), ParseCount("res", value.substr(separator + 1)) };
+	}
+
+	bool ParseMaterials(const std::string& value)
+	{
+		if (value != "full" && value != "compact")
+		{
+			Throw(std::invalid_argument("invalid sweep material layout '" + value + "'"));
+		}
+
+		return value == "compact";
+	}
+
+	bool ParseSwitch(const std::string& parameter, const std::string& value)
+	{
+		if (value != "off" && value != "on")
+		{
+			Throw(std::invalid_argument("invalid sweep value '" + value + "' for " + parameter));
+		}
+
+		return value == "on";
+	}
+
+	uint32_t ParseRays(const std::string& value)
+	{
+		if (value != "full" && value != "primary" && value != "shadow")
+		{
+			Throw(std::invalid_argument("invalid sweep rays '" + value + "'"));
+		}
+
+		return value == "full" ? 0 : value == "primary" ? 1 : 2;
+	}
+
+	float ParseScale(const std::string& value)
+	{
+		size_t end = 0;
+		float scale = 0;
+
+		try
+		{
+			scale = std::stof(value, &end);
+		}
+		catch (const std::exception&)
+		{
+			end = 0;
+		}
+
+		if (end == 0 || end != value.size() || scale < 0.25f || scale > 1.0f)
+		{
+			Throw(std::invalid_argument("invalid sweep render scale '" + value + "'"));
+		}
+
+		return scale;
+	}
+}
+
+BenchmarkSweep::BenchmarkSweep(const std::vector<std::string>& parameters, const uint32_t samples, const uint32_t bounces, const float renderScale, const VkExtent2D extent, const bool compactMaterials, const bool regeneratePaths, const bool radianceCache, const bool pathGuiding, const uint32_t rayIsolation)
+{
+	points_.push_back(Point{ samples, bounces, renderScale, extent, compactMaterials, regeneratePaths, radianceCache, pathGuiding, rayIsolation, "" });
+
+	for (const auto& parameter : parameters)
+	{
+		const auto separator = parameter.find('=');
+		const auto name = parameter.substr(0, separator);
+		const auto values = separator == std::string::npos ? std::vector<std::string>() : Split(parameter.substr(separator + 1), ',');
+
+		if (name != "samples" && name != "bounces" && name != "scale" && name != "res" && name != "materials" && name != "regen" && name != "cache" && name != "guiding" && name != "rays")
+		{
+			Throw(std::invalid_argument("unknown sweep parameter '" + name + "'"));
+		}
+
+		if (values.empty())
+		{
+			Throw(std::invalid_argument("no values for sweep parameter '" + name + "'"));
+		}
+
+		isExtentSwept_ |= name == "res";
+
+		// Every point so far is combined with every value of the new parameter.
+		std::vector<Point> points;
+
+		for (const auto& previous : points_)
+		{
+			for (const auto& value : values)
+			{
+				Point point = previous;
+
+				if (name == "samples") point.Samples = ParseCount(name, value);
+				if (name == "bounces") point.Bounces = ParseCount(name, value);
+				if (name == "scale") point.RenderScale = ParseScale(value);
+				if (name == "res") point.Extent = ParseResolution(value);
+				if (name == "materials") point.CompactMaterials = ParseMaterials(value);
+				if (name == "regen") point.RegeneratePaths = ParseSwitch(name, value);
+				if (name == "cache") point.RadianceCache = ParseSwitch(name, value);
+				if (name == "guiding") point.PathGuiding = ParseSwitch(name, value);
+				if (name == "rays") point.RayIsolation = ParseRays(value);
+
+				point.Name += (point.Name.empty() ? "" : " ") + name + "=" + value;
+				points.push_back(point);
+			}
+		}
+
+		points_ = std::move(points);
+	}
+}
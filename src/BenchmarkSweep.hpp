@@ -0,0 +1,44 @@
+#pragma once
+#include "Vulkan/Vulkan.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The points of a benchmark parameter sweep (see --sweep), every combination of the swept values in order, the last parameter varying fastest.
+// Each parameter is given as name=value,value,... with samples, bounces, scale (the render scale), res (720p, 1080p, 1440p, 4K or WxH)
+// materials (full or compact, the material layout fetched by the hit shaders, see --compact-materials), regen (off or on, see --regenerate-paths),
+// cache (off or on, see --radiance-cache), guiding (off or on, see --path-guiding) or rays (full, primary or shadow, see --isolate-rays).
+// The parameters that are not swept keep their command line value.
+class BenchmarkSweep final
+{
+public:
+
+	VULKAN_NON_COPIABLE(BenchmarkSweep)
+
+	struct Point final
+	{
+		uint32_t Samples;
+		uint32_t Bounces;
+		float RenderScale;
+		VkExtent2D Extent;
+		bool CompactMaterials;
+		bool RegeneratePaths;
+		bool RadianceCache;
+		bool PathGuiding;
+		uint32_t RayIsolation;
+		std::string Name; // e.g. "samples=4 res=1920x1080"
+	};
+
+	BenchmarkSweep(const std::vector<std::string>& parameters, uint32_t samples, uint32_t bounces, float renderScale, VkExtent2D extent, bool compactMaterials, bool regeneratePaths, bool radianceCache, bool pathGuiding, uint32_t rayIsolation);
+	~BenchmarkSweep() = default;
+
+	const std::vector<Point>& Points() const { return points_; }
+
+	// The resolution can only be swept headless, the window is sized by the user.
+	bool IsExtentSwept() const { return isExtentSwept_; }
+
+private:
+
+	std::vector<Point> points_;
+	bool isExtentSwept_{};
+};
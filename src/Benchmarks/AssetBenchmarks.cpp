@@ -0,0 +1,156 @@
+#include "Assets/MeshParser.hpp"
+#include "Assets/Model.hpp"
+#include "Assets/Texture.hpp"
+#include "Assets/TextureCache.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include "SceneList.hpp"
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <streambuf>
+#include <string>
+
+// The CPU micro-benchmarks of the asset and scene code, run from the same directory as the application (e.g. build/linux/bin).
+// Every measured function works on the files of ../assets only, and the fixtures of the geometry ones are loaded once, so that
+// the runs of two builds are comparable. The caches are part of the picture: LoadModel reads the .rtmesh of lucy.obj (written
+// by the warm-up load if missing), whereas the texture cache is disabled so that every texture load decodes its file.
+
+namespace
+{
+	const std::string LucyObj = "../assets/models/lucy.obj";
+	const std::string CubeObj = "../assets/models/cube_multi.obj";
+
+	// The loaders log every file, which would drown the benchmark output.
+	class QuietScope final
+	{
+	public:
+
+		QuietScope() : previous_(std::cout.rdbuf(&sink_)) {}
+		~QuietScope() { std::cout.rdbuf(previous_); }
+
+	private:
+
+		struct NullBuffer final : std::streambuf
+		{
+			int overflow(const int c) override { return c; }
+		};
+
+		NullBuffer sink_;
+		std::streambuf* const previous_;
+	};
+
+	const Assets::Model& Lucy()
+	{
+		static const Assets::Model lucy = []()
+		{
+			const QuietScope quiet;
+			return Assets::Model::LoadModel(LucyObj);
+		}();
+
+		return lucy;
+	}
+
+	// The streaming OBJ parser, the per chunk deduplication of the face corners included.
+	void ParseMesh(benchmark::State& state, const std::string& filename)
+	{
+		size_t vertexCount = 0;
+
+		for (auto _ : state)
+		{
+			const auto mesh = Assets::MeshParser::Parse(filename);
+			vertexCount = mesh.Vertices.size();
+			benchmark::DoNotOptimize(mesh.Indices.data());
+		}
+
+		state.counters["vertices"] = static_cast<double>(vertexCount);
+		state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * vertexCount));
+	}
+
+	// The whole load of a model, from its mesh cache entry.
+	void LoadModel(benchmark::State& state, const std::string& filename)
+	{
+		const QuietScope quiet;
+		Assets::Model::LoadModel(filename);
+
+		for (auto _ : state)
+		{
+			auto model = Assets::Model::LoadModel(filename);
+			benchmark::DoNotOptimize(model.Vertices().data());
+		}
+	}
+
+	void TransformModel(benchmark::State& state)
+	{
+		// A rotation, the vertices stay within the same bounds however many iterations run.
+		Assets::Model model(Lucy());
+		const auto transform = glm::rotate(glm::mat4(1), glm::radians(1.0f), glm::vec3(0, 1, 0));
+
+		for (auto _ : state)
+		{
+			model.Transform(transform);
+			benchmark::ClobberMemory();
+		}
+
+		state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * model.Vertices().size()));
+	}
+
+	void LoadTexture(benchmark::State& state, const std::string& filename)
+	{
+		const QuietScope quiet;
+
+		for (auto _ : state)
+		{
+			auto texture = Assets::Texture::LoadTexture(filename, Vulkan::SamplerConfig());
+			benchmark::DoNotOptimize(texture.Pixels());
+		}
+	}
+
+	// The assets of a scene, on the worker threads of the application.
+	void CreateScene(benchmark::State& state, const size_t sceneIndex, const bool tessellatedSpheres)
+	{
+		const QuietScope quiet;
+		Utilities::TaskSystem tasks;
+
+		for (auto _ : state)
+		{
+			SceneList::CameraInitialSate camera{};
+			auto assets = SceneList::AllScenes[sceneIndex].second(camera, SceneList::SceneOptions{ tessellatedSpheres, false }, tasks);
+			benchmark::DoNotOptimize(std::get<0>(assets).data());
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Assets::TextureCache::SetBudget(0);
+
+	benchmark::RegisterBenchmark("MeshParser::Parse/cube_multi", ParseMesh, CubeObj)->Unit(benchmark::kMillisecond);
+	benchmark::RegisterBenchmark("MeshParser::Parse/lucy", ParseMesh, LucyObj)->Unit(benchmark::kMillisecond);
+	benchmark::RegisterBenchmark("Model::LoadModel/lucy", LoadModel, LucyObj)->Unit(benchmark::kMillisecond);
+	benchmark::RegisterBenchmark("Model::Transform/lucy", TransformModel)->Unit(benchmark::kMillisecond);
+
+	for (const auto* const texture : { "2k_mars.jpg", "land_ocean_ice_cloud_2048.png" })
+	{
+		benchmark::RegisterBenchmark(("Texture::LoadTexture/" + std::string(texture)).c_str(), LoadTexture, "../assets/textures/" + std::string(texture))->Unit(benchmark::kMillisecond);
+	}
+
+	for (size_t i = 0; i != SceneList::AllScenes.size(); ++i)
+	{
+		for (const bool tessellated : { false, true })
+		{
+			const auto name = "SceneList/" + SceneList::AllScenes[i].first + (tessellated ? "/tessellated" : "");
+			benchmark::RegisterBenchmark(name.c_str(), CreateScene, i, tessellated)->Unit(benchmark::kMillisecond);
+		}
+	}
+
+	benchmark::Initialize(&argc, argv);
+
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+	{
+		return 1;
+	}
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	return 0;
+}
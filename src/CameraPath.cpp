@@ -0,0 +1,225 @@
+#include "CameraPath.hpp"
+#include "Utilities/Exception.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace glm;
+
+namespace
+{
+	// The whitespace separated tokens of one line, see the scene file statements.
+	class Statement final
+	{
+	public:
+
+		Statement(const std::string& path, const size_t line, const std::string& text) :
+			path_(path), line_(line), tokens_(text.substr(0, text.find('#')))
+		{
+		}
+
+		bool IsEnd()
+		{
+			tokens_ >> std::ws;
+			return tokens_.eof();
+		}
+
+		bool Accept(const std::string& keyword)
+		{
+			if (IsEnd())
+			{
+				return false;
+			}
+
+			const auto position = tokens_.tellg();
+			std::string word;
+			tokens_ >> word;
+
+			if (word == keyword)
+			{
+				return true;
+			}
+
+			tokens_.seekg(position);
+			return false;
+		}
+
+		std::string Word(const char* const what)
+		{
+			std::string word;
+
+			if (!(tokens_ >> word))
+			{
+				Fail(std::string("missing ") + what);
+			}
+
+			return word;
+		}
+
+		float Float(const char* const what)
+		{
+			const std::string token = Word(what);
+			size_t end = 0;
+			float value = 0;
+
+			try
+			{
+				value = std::stof(token, &end);
+			}
+			catch (const std::exception&)
+			{
+				end = 0;
+			}
+
+			if (end != token.size())
+			{
+				Fail(std::string("invalid ") + what + " '" + token + "'");
+			}
+
+			return value;
+		}
+
+		vec3 Vec3(const char* const what)
+		{
+			const float x = Float(what);
+			const float y = Float(what);
+			const float z = Float(what);
+
+			return vec3(x, y, z);
+		}
+
+		[[noreturn]] void Fail(const std::string& message) const
+		{
+			Throw(std::runtime_error(path_ + ":" + std::to_string(line_) + ": " + message));
+		}
+
+	private:
+
+		const std::string& path_;
+		const size_t line_;
+		std::istringstream tokens_;
+	};
+
+	vec3 CatmullRom(const vec3& p0, const vec3& p1, const vec3& p2, const vec3& p3, const float t)
+	{
+		const float t2 = t * t;
+		const float t3 = t2 * t;
+
+		return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+	}
+}
+
+mat4 CameraPath::Key::ModelView() const
+{
+	return lookAt(Eye, Target, Up);
+}
+
+CameraPath CameraPath::Load(const std::string& path)
+{
+	std::ifstream file(path);
+
+	if (!file)
+	{
+		Throw(std::runtime_error("cannot open camera path '" + path + "'"));
+	}
+
+	CameraPath cameraPath;
+	Key key{ 0, vec3(0, 0, 1), vec3(0), vec3(0, 1, 0), 45, 0, 1 };
+	std::string line;
+	size_t lineNumber = 0;
+
+	while (std::getline(file, line))
+	{
+		Statement statement(path, ++lineNumber, line);
+
+		if (statement.IsEnd())
+		{
+			continue;
+		}
+
+		const auto keyword = statement.Word("statement");
+
+		if (keyword == "fps")
+		{
+			cameraPath.framesPerSecond_ = statement.Float("frame rate");
+
+			if (!(cameraPath.framesPerSecond_ > 0))
+			{
+				statement.Fail("invalid frame rate");
+			}
+		}
+		else if (keyword == "key")
+		{
+			key.Time = statement.Float("key time");
+
+			if (!cameraPath.keys_.empty() && key.Time <= cameraPath.keys_.back().Time)
+			{
+				statement.Fail("the keys must come in increasing time order");
+			}
+
+			while (!statement.IsEnd())
+			{
+				if (statement.Accept("eye")) key.Eye = statement.Vec3("eye position");
+				else if (statement.Accept("target")) key.Target = statement.Vec3("target position");
+				else if (statement.Accept("up")) key.Up = statement.Vec3("up vector");
+				else if (statement.Accept("fov")) key.FieldOfView = statement.Float("field of view");
+				else if (statement.Accept("aperture")) key.Aperture = statement.Float("aperture");
+				else if (statement.Accept("focus")) key.FocusDistance = statement.Float("focus distance");
+				else statement.Fail("unexpected '" + statement.Word("key property") + "'");
+			}
+
+			cameraPath.keys_.push_back(key);
+		}
+		else
+		{
+			statement.Fail("unknown statement '" + keyword + "'");
+		}
+	}
+
+	if (cameraPath.keys_.empty())
+	{
+		Throw(std::runtime_error("camera path '" + path + "' has no key"));
+	}
+
+	return cameraPath;
+}
+
+uint32_t CameraPath::FrameCount() const
+{
+	return static_cast<uint32_t>(std::floor((keys_.back().Time - keys_.front().Time) * framesPerSecond_ + 1e-3f)) + 1;
+}
+
+CameraPath::Key CameraPath::Sample(const uint32_t frame) const
+{
+	const float time = keys_.front().Time + frame / framesPerSecond_;
+
+	// The segment the time falls in, the end keys being repeated past the ends of the path.
+	const auto next = std::upper_bound(keys_.begin(), keys_.end(), time, [](const float t, const Key& key) { return t < key.Time; });
+
+	if (next == keys_.begin() || next == keys_.end())
+	{
+		Key key = next == keys_.end() ? keys_.back() : keys_.front();
+		key.Time = time;
+		return key;
+	}
+
+	const size_t i = static_cast<size_t>(next - keys_.begin()) - 1;
+	const Key& k0 = keys_[i == 0 ? 0 : i - 1];
+	const Key& k1 = keys_[i];
+	const Key& k2 = keys_[i + 1];
+	const Key& k3 = keys_[std::min(i + 2, keys_.size() - 1)];
+	const float t = (time - k1.Time) / (k2.Time - k1.Time);
+
+	Key key{};
+	key.Time = time;
+	key.Eye = CatmullRom(k0.Eye, k1.Eye, k2.Eye, k3.Eye, t);
+	key.Target = CatmullRom(k0.Target, k1.Target, k2.Target, k3.Target, t);
+	key.Up = normalize(mix(k1.Up, k2.Up, t));
+	key.FieldOfView = mix(k1.FieldOfView, k2.FieldOfView, t);
+	key.Aperture = mix(k1.Aperture, k2.Aperture, t);
+	key.FocusDistance = mix(k1.FocusDistance, k2.FocusDistance, t);
+
+	return key;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "Utilities/Glm.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The camera keyframes of an image sequence (see --camera-path), one statement per line in the spirit of the scene files:
+//
+//   # A comment.
+//   fps 30
+//   key <seconds> eye <x y z> target <x y z> [up <x y z>] [fov <degrees>] [aperture <a>] [focus <d>]
+//
+// The keys come in increasing time order, the optional values carrying over from the previous key. The eye and target follow
+// Catmull-Rom splines through the keys, so that the camera does not turn sharply at each of them, the lens values are interpolated linearly.
+class CameraPath final
+{
+public:
+
+	struct Key final
+	{
+		float Time; // seconds
+		glm::vec3 Eye;
+		glm::vec3 Target;
+		glm::vec3 Up;
+		float FieldOfView; // degrees
+		float Aperture;
+		float FocusDistance;
+
+		glm::mat4 ModelView() const;
+	};
+
+	static CameraPath Load(const std::string& path);
+
+	float FramesPerSecond() const { return framesPerSecond_; }
+	uint32_t FrameCount() const; // From the first to the last key, both included.
+	Key Sample(uint32_t frame) const;
+
+private:
+
+	float framesPerSecond_{ 30 };
+	std::vector<Key> keys_;
+};
@@ -0,0 +1,240 @@
+#include "Bvh.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace Cpu {
+
+namespace
+{
+	constexpr uint32_t BinCount = 12;
+
+	// The surface area heuristic only compares the halves of a node, the constant factor is left out.
+	float HalfArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		const auto extent = glm::max(boundsMax - boundsMin, glm::vec3(0));
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+}
+
+struct Bvh::BuildNode final
+{
+	glm::vec3 BoundsMin;
+	glm::vec3 BoundsMax;
+	uint32_t First; // Leaves only, in primitives_.
+	uint32_t Count; // 0 for the inner nodes.
+	uint32_t Children[2];
+};
+
+Bvh::Bvh(const std::vector<std::pair<glm::vec3, glm::vec3>>& bounds)
+{
+	if (bounds.empty())
+	{
+		return;
+	}
+
+	std::vector<glm::vec3> centroids;
+	centroids.reserve(bounds.size());
+	primitives_.reserve(bounds.size());
+
+	for (const auto& [boundsMin, boundsMax] : bounds)
+	{
+		centroids.push_back((boundsMin + boundsMax) * 0.5f);
+		primitives_.push_back(static_cast<uint32_t>(primitives_.size()));
+	}
+
+	std::vector<BuildNode> tree;
+	tree.reserve(bounds.size() * 2);
+
+	const auto root = Build(tree, bounds, centroids, 0, static_cast<uint32_t>(bounds.size()), 0);
+
+	bounds_ = std::make_pair(tree[root].BoundsMin, tree[root].BoundsMax);
+	nodes_.reserve(tree.size() / 3 + 1);
+
+	Collapse(tree, root);
+}
+
+uint32_t Bvh::Build(std::vector<BuildNode>& tree, const std::vector<std::pair<glm::vec3, glm::vec3>>& bounds, const std::vector<glm::vec3>& centroids, const uint32_t begin, const uint32_t end, const uint32_t depth)
+{
+	const auto index = static_cast<uint32_t>(tree.size());
+	tree.push_back({ glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()), begin, end - begin, { 0, 0 } });
+
+	glm::vec3 centroidMin(std::numeric_limits<float>::max());
+	glm::vec3 centroidMax(-std::numeric_limits<float>::max());
+
+	for (uint32_t i = begin; i != end; ++i)
+	{
+		const auto primitive = primitives_[i];
+
+		tree[index].BoundsMin = glm::min(tree[index].BoundsMin, bounds[primitive].first);
+		tree[index].BoundsMax = glm::max(tree[index].BoundsMax, bounds[primitive].second);
+		centroidMin = glm::min(centroidMin, centroids[primitive]);
+		centroidMax = glm::max(centroidMax, centroids[primitive]);
+	}
+
+	if (end - begin <= MaxLeafSize)
+	{
+		return index;
+	}
+
+	// Split along the widest axis of the centroids, at the cheapest of the bin boundaries.
+	const auto extent = centroidMax - centroidMin;
+	const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+	uint32_t middle = begin + (end - begin) / 2;
+
+	// The coincident centroids and the deep branches are split at the object median instead, which bounds the depth.
+	if (extent[axis] > 0 && depth < MaxDepth / 2)
+	{
+		const float scale = BinCount / extent[axis];
+		const auto bin = [&](const uint32_t primitive)
+		{
+			return std::min(static_cast<uint32_t>((centroids[primitive][axis] - centroidMin[axis]) * scale), BinCount - 1);
+		};
+
+		uint32_t counts[BinCount] = {};
+		glm::vec3 binMin[BinCount];
+		glm::vec3 binMax[BinCount];
+
+		std::fill_n(binMin, BinCount, glm::vec3(std::numeric_limits<float>::max()));
+		std::fill_n(binMax, BinCount, glm::vec3(-std::numeric_limits<float>::max()));
+
+		for (uint32_t i = begin; i != end; ++i)
+		{
+			const auto primitive = primitives_[i];
+			const auto b = bin(primitive);
+
+			counts[b]++;
+			binMin[b] = glm::min(binMin[b], bounds[primitive].first);
+			binMax[b] = glm::max(binMax[b], bounds[primitive].second);
+		}
+
+		// The cost of the left side of every boundary, swept from the left, then the right one swept back.
+		float leftCosts[BinCount - 1];
+		glm::vec3 sweepMin(std::numeric_limits<float>::max());
+		glm::vec3 sweepMax(-std::numeric_limits<float>::max());
+		uint32_t sweepCount = 0;
+
+		for (uint32_t b = 0; b != BinCount - 1; ++b)
+		{
+			sweepMin = glm::min(sweepMin, binMin[b]);
+			sweepMax = glm::max(sweepMax, binMax[b]);
+			sweepCount += counts[b];
+			leftCosts[b] = sweepCount != 0 ? HalfArea(sweepMin, sweepMax) * sweepCount : 0;
+		}
+
+		float bestCost = std::numeric_limits<float>::max();
+		uint32_t bestSplit = 0;
+
+		sweepMin = glm::vec3(std::numeric_limits<float>::max());
+		sweepMax = glm::vec3(-std::numeric_limits<float>::max());
+		sweepCount = 0;
+
+		for (uint32_t b = BinCount - 1; b != 0; --b)
+		{
+			sweepMin = glm::min(sweepMin, binMin[b]);
+			sweepMax = glm::max(sweepMax, binMax[b]);
+			sweepCount += counts[b];
+
+			const float cost = leftCosts[b - 1] + (sweepCount != 0 ? HalfArea(sweepMin, sweepMax) * sweepCount : 0);
+
+			if (sweepCount != 0 && sweepCount != end - begin && cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		if (bestSplit != 0)
+		{
+			middle = static_cast<uint32_t>(std::partition(primitives_.begin() + begin, primitives_.begin() + end,
+				[&](const uint32_t primitive) { return bin(primitive) < bestSplit; }) - primitives_.begin());
+		}
+		else
+		{
+			std::nth_element(primitives_.begin() + begin, primitives_.begin() + middle, primitives_.begin() + end,
+				[&](const uint32_t a, const uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+		}
+	}
+
+	const auto left = Build(tree, bounds, centroids, begin, middle, depth + 1);
+	const auto right = Build(tree, bounds, centroids, middle, end, depth + 1);
+
+	tree[index].Count = 0;
+	tree[index].Children[0] = left;
+	tree[index].Children[1] = right;
+
+	return index;
+}
+
+uint32_t Bvh::Collapse(const std::vector<BuildNode>& tree, const uint32_t root)
+{
+	const auto index = static_cast<uint32_t>(nodes_.size());
+	nodes_.emplace_back();
+
+	// Open the largest of the inner children until the node is full, a leaf root is the only child of its node.
+	std::vector<uint32_t> children;
+
+	if (tree[root].Count != 0)
+	{
+		children.push_back(root);
+	}
+	else
+	{
+		children.assign(tree[root].Children, tree[root].Children + 2);
+	}
+
+	while (children.size() < Width)
+	{
+		auto largest = children.end();
+		float largestArea = -1;
+
+		for (auto i = children.begin(); i != children.end(); ++i)
+		{
+			const auto& child = tree[*i];
+			const float area = HalfArea(child.BoundsMin, child.BoundsMax);
+
+			if (child.Count == 0 && area > largestArea)
+			{
+				largest = i;
+				largestArea = area;
+			}
+		}
+
+		if (largest == children.end())
+		{
+			break;
+		}
+
+		const auto opened = *largest;
+		*largest = tree[opened].Children[0];
+		children.push_back(tree[opened].Children[1]);
+	}
+
+	// The inner children are collapsed first, nodes_ may grow meanwhile.
+	uint32_t lanes[Width];
+
+	for (uint32_t lane = 0; lane != Width; ++lane)
+	{
+		lanes[lane] = lane < children.size() && tree[children[lane]].Count == 0 ? Collapse(tree, children[lane]) : Empty;
+	}
+
+	auto& node = nodes_[index];
+
+	for (uint32_t lane = 0; lane != Width; ++lane)
+	{
+		const bool isUsed = lane < children.size();
+		const auto& child = tree[isUsed ? children[lane] : root];
+
+		for (int axis = 0; axis != 3; ++axis)
+		{
+			node.BoundsMin[axis][lane] = isUsed ? child.BoundsMin[axis] : 0.0f;
+			node.BoundsMax[axis][lane] = isUsed ? child.BoundsMax[axis] : 0.0f;
+		}
+
+		node.Child[lane] = !isUsed ? Empty : child.Count != 0 ? child.First : lanes[lane];
+		node.Count[lane] = isUsed ? child.Count : 0;
+	}
+
+	return index;
+}
+
+}
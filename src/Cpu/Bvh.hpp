@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Utilities/Glm.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Cpu
+{
+	// A four wide bounding volume hierarchy over the bounds of some primitives, the CPU counterpart of an acceleration structure.
+	// Built by binned SAH splits into a binary tree, which is then collapsed so that every node holds up to four children. Their
+	// bounds are stored lane by lane (Embree style), the slab tests of the four children being a single loop the compiler vectorizes.
+	// The traversal visits the hit children nearest first and asks the caller to intersect the primitives of the leaves it reaches.
+	class Bvh final
+	{
+	public:
+
+		static constexpr uint32_t Width = 4;
+		static constexpr uint32_t MaxLeafSize = 4;
+		static constexpr uint32_t MaxDepth = 64; // Past it, the build splits at the object median.
+		static constexpr uint32_t Empty = ~0u; // A lane without a child.
+
+		// Every lane is either an inner node (Count == 0) or a leaf of Count primitives from Child in Primitives().
+		struct alignas(64) Node final
+		{
+			float BoundsMin[3][Width];
+			float BoundsMax[3][Width];
+			uint32_t Child[Width];
+			uint32_t Count[Width];
+		};
+
+		Bvh() = default;
+		explicit Bvh(const std::vector<std::pair<glm::vec3, glm::vec3>>& bounds);
+
+		const std::vector<Node>& Nodes() const { return nodes_; }
+		const std::vector<uint32_t>& Primitives() const { return primitives_; }
+		const std::pair<glm::vec3, glm::vec3>& Bounds() const { return bounds_; }
+
+		// Calls intersect(primitive, tMax) for the primitives the ray may hit before tMax, which shortens tMax when it hits one.
+		// The inverse direction is that of the ray, its components being finite.
+		template <class Intersect>
+		void Traverse(const glm::vec3& origin, const glm::vec3& inverseDirection, float& tMax, const Intersect& intersect) const;
+
+	private:
+
+		struct BuildNode;
+
+		uint32_t Build(std::vector<BuildNode>& tree, const std::vector<std::pair<glm::vec3, glm::vec3>>& bounds, const std::vector<glm::vec3>& centroids, uint32_t begin, uint32_t end, uint32_t depth);
+		uint32_t Collapse(const std::vector<BuildNode>& tree, uint32_t root);
+
+		std::vector<Node> nodes_;
+		std::vector<uint32_t> primitives_;
+		std::pair<glm::vec3, glm::vec3> bounds_{ glm::vec3(0), glm::vec3(0) };
+	};
+
+	template <class Intersect>
+	void Bvh::Traverse(const glm::vec3& origin, const glm::vec3& inverseDirection, float& tMax, const Intersect& intersect) const
+	{
+		if (nodes_.empty())
+		{
+			return;
+		}
+
+		// The nodes are at most MaxDepth levels deep, each leaves at most three siblings on the stack.
+		struct Entry final
+		{
+			uint32_t Node;
+			float Distance;
+		};
+
+		Entry stack[MaxDepth * (Width - 1) + 1];
+		uint32_t size = 0;
+
+		stack[size++] = { 0, 0.0f };
+
+		const float o[3] = { origin.x, origin.y, origin.z };
+		const float d[3] = { inverseDirection.x, inverseDirection.y, inverseDirection.z };
+
+		while (size != 0)
+		{
+			const auto entry = stack[--size];
+
+			// Culled by a closer hit found since it was pushed.
+			if (entry.Distance > tMax)
+			{
+				continue;
+			}
+
+			const auto& node = nodes_[entry.Node];
+			float tNear[Width];
+			float tFar[Width];
+
+			for (uint32_t lane = 0; lane != Width; ++lane)
+			{
+				tNear[lane] = 0.0f;
+				tFar[lane] = tMax;
+			}
+
+			for (uint32_t axis = 0; axis != 3; ++axis)
+			{
+				for (uint32_t lane = 0; lane != Width; ++lane)
+				{
+					const float t0 = (node.BoundsMin[axis][lane] - o[axis]) * d[axis];
+					const float t1 = (node.BoundsMax[axis][lane] - o[axis]) * d[axis];
+
+					tNear[lane] = std::max(tNear[lane], std::min(t0, t1));
+					tFar[lane] = std::min(tFar[lane], std::max(t0, t1));
+				}
+			}
+
+			// The hit lanes, nearest first.
+			uint32_t hits[Width];
+			uint32_t hitCount = 0;
+
+			for (uint32_t lane = 0; lane != Width; ++lane)
+			{
+				if (tNear[lane] <= tFar[lane] && node.Child[lane] != Empty)
+				{
+					uint32_t i = hitCount++;
+
+					for (; i != 0 && tNear[hits[i - 1]] > tNear[lane]; --i)
+					{
+						hits[i] = hits[i - 1];
+					}
+
+					hits[i] = lane;
+				}
+			}
+
+			// The leaves are intersected right away, the inner nodes pushed farthest first.
+			for (uint32_t i = 0; i != hitCount; ++i)
+			{
+				const uint32_t lane = hits[i];
+
+				if (node.Count[lane] != 0 && tNear[lane] <= tMax)
+				{
+					for (uint32_t j = node.Child[lane], end = node.Child[lane] + node.Count[lane]; j != end; ++j)
+					{
+						intersect(primitives_[j], tMax);
+					}
+				}
+			}
+
+			for (uint32_t i = hitCount; i-- != 0;)
+			{
+				const uint32_t lane = hits[i];
+
+				if (node.Count[lane] == 0)
+				{
+					stack[size++] = { node.Child[lane], tNear[lane] };
+				}
+			}
+		}
+	}
+}
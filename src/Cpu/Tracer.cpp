@@ -0,0 +1,629 @@
+#include "Tracer.hpp"
+#include "Assets/Environment.hpp"
+#include "Assets/Model.hpp"
+#include "Assets/ModelInstance.hpp"
+#include "Assets/Sphere.hpp"
+#include "Assets/Texture.hpp"
+#include "Utilities/ParallelFor.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include "SceneFile.hpp"
+#include "UserSettings.hpp"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace Cpu {
+
+namespace
+{
+	constexpr uint32_t TileSize = 16; // Pixels per side, the unit of work of the threads.
+	constexpr float Pi = 3.1415926535897932384626433832795f;
+
+	// The SamplerRandom sequence of Random.glsl, a TEA seeded LCG.
+	uint32_t InitRandomSeed(const uint32_t val0, const uint32_t val1)
+	{
+		uint32_t v0 = val0, v1 = val1, s0 = 0;
+
+		for (uint32_t n = 0; n < 16; n++)
+		{
+			s0 += 0x9e3779b9;
+			v0 += ((v1 << 4) + 0xa341316c) ^ (v1 + s0) ^ ((v1 >> 5) + 0xc8013ea4);
+			v1 += ((v0 << 4) + 0xad90777d) ^ (v0 + s0) ^ ((v0 >> 5) + 0x7e95761e);
+		}
+
+		return v0;
+	}
+
+	float RandomFloat(uint32_t& seed)
+	{
+		seed = 1664525 * seed + 1013904223;
+		return static_cast<float>(seed & 0x00FFFFFF) / static_cast<float>(0x01000000);
+	}
+
+	glm::vec2 RandomInUnitDisk(uint32_t& seed)
+	{
+		const float quarterPi = Pi / 4;
+		const float x = 2 * RandomFloat(seed) - 1;
+		const float y = 2 * RandomFloat(seed) - 1;
+		const bool isHorizontal = std::abs(x) > std::abs(y);
+		const float r = isHorizontal ? x : y;
+		const float phi = isHorizontal ? quarterPi * y / x : 2 * quarterPi - quarterPi * x / (y != 0 ? y : 1);
+
+		return r * glm::vec2(std::cos(phi), std::sin(phi));
+	}
+
+	glm::vec3 RandomUnitVector(uint32_t& seed)
+	{
+		const float z = 2 * RandomFloat(seed) - 1;
+		const float phi = 2 * Pi * RandomFloat(seed);
+		const float r = std::sqrt(std::max(1 - z * z, 0.0f));
+
+		return glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+	}
+
+	glm::vec3 RandomInUnitSphere(uint32_t& seed)
+	{
+		const auto direction = RandomUnitVector(seed);
+		return direction * std::pow(RandomFloat(seed), 1.0f / 3.0f);
+	}
+
+	float Schlick(const float cosine, const float refractionIndex)
+	{
+		float r0 = (1 - refractionIndex) / (1 + refractionIndex);
+		r0 *= r0;
+		return r0 + (1 - r0) * std::pow(1 - cosine, 5.0f);
+	}
+
+	// The ray origin offset of RayOffset.glsl.
+	glm::vec3 OffsetRayOrigin(const glm::vec3& position, const glm::vec3& normal, const glm::vec3& direction, const float sceneRadius)
+	{
+		if (normal == glm::vec3(0))
+		{
+			return position + glm::normalize(direction) * (sceneRadius * 1e-6f);
+		}
+
+		const float originThreshold = 1.0f / 32.0f;
+		const float floatScale = 1.0f / 65536.0f;
+		const float intScale = 256.0f;
+
+		const glm::vec3 n = glm::dot(normal, direction) < 0 ? -normal : normal;
+		glm::vec3 result;
+
+		for (int axis = 0; axis != 3; ++axis)
+		{
+			int32_t bits;
+			std::memcpy(&bits, &position[axis], sizeof(bits));
+
+			const auto offset = static_cast<int32_t>(intScale * n[axis]);
+			bits += position[axis] < 0 ? -offset : offset;
+
+			float offsetPosition;
+			std::memcpy(&offsetPosition, &bits, sizeof(bits));
+
+			result[axis] = std::abs(position[axis]) < originThreshold ? position[axis] + floatScale * n[axis] : offsetPosition;
+		}
+
+		return result;
+	}
+
+	// The reciprocal, finite along the axes the direction does not move on.
+	glm::vec3 SafeInverse(const glm::vec3& v)
+	{
+		return glm::vec3(
+			std::abs(v.x) > 1e-12f ? 1 / v.x : 1e30f,
+			std::abs(v.y) > 1e-12f ? 1 / v.y : 1e30f,
+			std::abs(v.z) > 1e-12f ? 1 / v.z : 1e30f);
+	}
+
+	glm::vec2 SphereTexCoord(const glm::vec3& point)
+	{
+		const float phi = std::atan2(point.x, point.z);
+		const float theta = std::asin(std::clamp(point.y, -1.0f, 1.0f));
+
+		return glm::vec2((phi + Pi) / (2 * Pi), 1 - (theta + Pi / 2) / Pi);
+	}
+
+	glm::vec3 EnvironmentTexel(const Assets::Environment& environment, const uint32_t x, const uint32_t y)
+	{
+		const auto& value = environment.Texels()[size_t(y) * environment.Width() + x];
+
+		return glm::vec3(glm::unpackHalf2x16(value.x), glm::unpackHalf2x16(value.y).x);
+	}
+}
+
+struct Tracer::Instance final
+{
+	glm::mat4 WorldToObject;
+	glm::mat3 NormalToWorld; // The inverse transpose of the object to world transform.
+	uint32_t ModelId;
+	uint32_t RayMask;
+	const Assets::Material* Material; // The override or the single material of the model, null when per triangle.
+	const Assets::Sphere* Sphere; // The procedural ones.
+};
+
+struct Tracer::Hit final
+{
+	float T;
+	uint32_t Instance;
+	uint32_t Primitive;
+	glm::vec2 Barycentrics; // Of the second and third vertices, as the triangle hit attributes.
+};
+
+Tracer::Tracer(const UserSettings& userSettings, const VkExtent2D extent) :
+	extent_(extent),
+	numberOfBounces_(userSettings.NumberOfBounces),
+	russianRouletteDepth_(userSettings.RussianRouletteDepth)
+{
+	const auto loadStart = std::chrono::steady_clock::now();
+
+	// The meshes get their normals on the host, there is no device to generate them.
+	{
+		Utilities::TaskSystem tasks;
+		const SceneList::SceneOptions options{ userSettings.TessellatedSpheres, false };
+		const auto sceneIndex = static_cast<size_t>(userSettings.SceneIndex);
+
+		assets_ = sceneIndex == SceneList::AllScenes.size()
+			? SceneFile::Load(userSettings.SceneFile, camera_, options, tasks)
+			: SceneList::AllScenes[sceneIndex].second(camera_, options, tasks);
+
+		if (userSettings.LevelOfDetail)
+		{
+			SceneList::SelectLevelsOfDetail(assets_, camera_, static_cast<float>(extent.height), nullptr);
+		}
+
+		if (!userSettings.Environment.empty())
+		{
+			environment_.reset(new Assets::Environment(Assets::Environment::Load(userSettings.Environment, userSettings.EnvironmentIntensity, tasks)));
+		}
+	}
+
+	const auto buildStart = std::chrono::steady_clock::now();
+
+	// The camera of RayTracer::GetUniformBufferObject().
+	auto projection = glm::perspective(glm::radians(camera_.FieldOfView), extent.width / static_cast<float>(extent.height), 0.1f, 10000.0f);
+	projection[1][1] *= -1;
+
+	projectionInverse_ = glm::inverse(projection);
+	modelViewInverse_ = glm::inverse(camera_.ModelView);
+
+	// The bottom level, one hierarchy per model built on all the threads.
+	const auto& models = std::get<0>(assets_);
+	size_t triangleCount = 0;
+
+	models_.resize(models.size());
+
+	Utilities::ParallelFor(models.size(), [&](const size_t i)
+	{
+		const auto& model = models[i];
+
+		if (model.Procedural() != nullptr)
+		{
+			models_[i] = Bvh(std::vector<std::pair<glm::vec3, glm::vec3>>{ model.Procedural()->BoundingBox() });
+			return;
+		}
+
+		const auto& vertices = model.Vertices();
+		const auto& indices = model.Indices();
+		std::vector<std::pair<glm::vec3, glm::vec3>> bounds;
+		bounds.reserve(indices.size() / 3);
+
+		for (size_t j = 0; j + 2 < indices.size(); j += 3)
+		{
+			const auto& p0 = vertices[indices[j + 0]].Position;
+			const auto& p1 = vertices[indices[j + 1]].Position;
+			const auto& p2 = vertices[indices[j + 2]].Position;
+
+			bounds.emplace_back(glm::min(p0, glm::min(p1, p2)), glm::max(p0, glm::max(p1, p2)));
+		}
+
+		models_[i] = Bvh(bounds);
+	});
+
+	for (const auto& model : models)
+	{
+		triangleCount += model.Procedural() != nullptr ? 0 : model.Indices().size() / 3;
+	}
+
+	// The top level over the world bounds of the instances. The media and the instances no ray can hit are left out.
+	std::vector<std::pair<glm::vec3, glm::vec3>> instanceBounds;
+
+	for (const auto& instance : std::get<2>(assets_))
+	{
+		const auto& model = models[instance.ModelId];
+		const auto* const material = instance.MaterialOverride ? &*instance.MaterialOverride : model.Materials().size() == 1 ? &model.Materials()[0] : nullptr;
+		const auto& [boundsMin, boundsMax] = models_[instance.ModelId].Bounds();
+
+		if ((material != nullptr && material->MaterialModel == Assets::Material::Enum::Isotropic) || instance.RayMask == 0 || models_[instance.ModelId].Nodes().empty())
+		{
+			continue;
+		}
+
+		glm::vec3 worldMin(std::numeric_limits<float>::max());
+		glm::vec3 worldMax(-std::numeric_limits<float>::max());
+
+		for (uint32_t corner = 0; corner != 8; ++corner)
+		{
+			const glm::vec3 point((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z);
+			const glm::vec3 world(instance.Transform * glm::vec4(point, 1));
+
+			worldMin = glm::min(worldMin, world);
+			worldMax = glm::max(worldMax, world);
+		}
+
+		const auto worldToObject = glm::inverse(instance.Transform);
+
+		instances_.push_back({ worldToObject, glm::transpose(glm::mat3(worldToObject)), instance.ModelId, instance.RayMask, material, dynamic_cast<const Assets::Sphere*>(model.Procedural()) });
+		instanceBounds.emplace_back(worldMin, worldMax);
+	}
+
+	top_ = Bvh(instanceBounds);
+	sceneRadius_ = glm::length(top_.Bounds().second - top_.Bounds().first) * 0.5f;
+
+	const auto loadTime = std::chrono::duration<double>(buildStart - loadStart).count();
+	const auto buildTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+
+	std::cout << "CPU tracer: " << models.size() << " models (" << triangleCount << " triangles), " << instances_.size() << " instances, ";
+	std::cout << "loaded in " << loadTime << "s, hierarchies built in " << buildTime << "s" << std::endl;
+}
+
+Tracer::~Tracer()
+{
+}
+
+void Tracer::Render(const uint32_t firstSample, const uint32_t sampleCount, std::vector<float>& sums) const
+{
+	sums.resize(size_t(extent_.width) * extent_.height * 4);
+
+	const uint32_t tilesX = (extent_.width + TileSize - 1) / TileSize;
+	const uint32_t tilesY = (extent_.height + TileSize - 1) / TileSize;
+
+	Utilities::ParallelFor(size_t(tilesX) * tilesY, [&](const size_t tile)
+	{
+		const uint32_t x0 = static_cast<uint32_t>(tile % tilesX) * TileSize;
+		const uint32_t y0 = static_cast<uint32_t>(tile / tilesX) * TileSize;
+
+		for (uint32_t y = y0; y != std::min(y0 + TileSize, extent_.height); ++y)
+		{
+			for (uint32_t x = x0; x != std::min(x0 + TileSize, extent_.width); ++x)
+			{
+				glm::vec3 color(0);
+
+				for (uint32_t s = 0; s != sampleCount; ++s)
+				{
+					color += TracePath(x, y, firstSample + s);
+				}
+
+				float* const pixel = sums.data() + (size_t(y) * extent_.width + x) * 4;
+
+				pixel[0] += color.r;
+				pixel[1] += color.g;
+				pixel[2] += color.b;
+				pixel[3] += static_cast<float>(sampleCount);
+			}
+		}
+	});
+}
+
+bool Tracer::Trace(const glm::vec3& origin, const glm::vec3& direction, const uint32_t bounce, Hit& hit) const
+{
+	const uint32_t mask = 1u << std::min(bounce, Assets::BounceRayMaskCount - 1);
+	const bool isOpaque = camera_.OpaqueDepth != 0 && bounce >= camera_.OpaqueDepth;
+	const auto& models = std::get<0>(assets_);
+	float tMax = std::numeric_limits<float>::max();
+
+	hit.T = -1;
+
+	// The object space direction is not normalized, the distances are the same at both levels.
+	top_.Traverse(origin, SafeInverse(direction), tMax, [&](const uint32_t i, float& tInstance)
+	{
+		const auto& instance = instances_[i];
+
+		if ((instance.RayMask & mask) == 0)
+		{
+			return;
+		}
+
+		const glm::vec3 o(instance.WorldToObject * glm::vec4(origin, 1));
+		const glm::vec3 d(glm::mat3(instance.WorldToObject) * direction);
+
+		if (instance.Sphere != nullptr)
+		{
+			const glm::vec3 oc = o - instance.Sphere->Center;
+			const float a = glm::dot(d, d);
+			const float b = glm::dot(oc, d);
+			const float c = glm::dot(oc, oc) - instance.Sphere->Radius * instance.Sphere->Radius;
+			const float discriminant = b * b - a * c;
+
+			if (discriminant >= 0)
+			{
+				const float t1 = (-b - std::sqrt(discriminant)) / a;
+				const float t2 = (-b + std::sqrt(discriminant)) / a;
+				const float t = t1 >= 0 ? t1 : t2;
+
+				if (t >= 0 && t < tInstance)
+				{
+					tInstance = t;
+					hit = { t, i, 0, glm::vec2(0) };
+				}
+			}
+
+			return;
+		}
+
+		const auto& model = models[instance.ModelId];
+		const auto& vertices = model.Vertices();
+		const auto& indices = model.Indices();
+
+		models_[instance.ModelId].Traverse(o, SafeInverse(d), tInstance, [&](const uint32_t triangle, float& tTriangle)
+		{
+			// Moller-Trumbore, both faces.
+			const auto& v0 = vertices[indices[triangle * 3 + 0]];
+			const auto& v1 = vertices[indices[triangle * 3 + 1]];
+			const auto& v2 = vertices[indices[triangle * 3 + 2]];
+			const glm::vec3 e1 = v1.Position - v0.Position;
+			const glm::vec3 e2 = v2.Position - v0.Position;
+			const glm::vec3 p = glm::cross(d, e2);
+			const float determinant = glm::dot(e1, p);
+
+			if (std::abs(determinant) < 1e-20f)
+			{
+				return;
+			}
+
+			const float inverse = 1 / determinant;
+			const glm::vec3 s = o - v0.Position;
+			const float u = glm::dot(s, p) * inverse;
+
+			if (u < 0 || u > 1)
+			{
+				return;
+			}
+
+			const glm::vec3 q = glm::cross(s, e1);
+			const float v = glm::dot(d, q) * inverse;
+			const float t = glm::dot(e2, q) * inverse;
+
+			if (v < 0 || u + v > 1 || t <= 0 || t >= tTriangle)
+			{
+				return;
+			}
+
+			// The alpha test of AlphaTest.glsl, on the finest level of the texture.
+			if (!isOpaque)
+			{
+				const auto& material = instance.Material != nullptr ? *instance.Material : model.Materials()[v0.MaterialIndex];
+
+				if (material.AlphaCutoff > 0)
+				{
+					const glm::vec2 texCoord = v0.TexCoord * (1 - u - v) + v1.TexCoord * u + v2.TexCoord * v;
+
+					if (material.Diffuse.a * SampleTexture(material.DiffuseTextureId, texCoord).a < material.AlphaCutoff)
+					{
+						return;
+					}
+				}
+			}
+
+			tTriangle = t;
+			hit = { t, i, triangle, glm::vec2(u, v) };
+		});
+	});
+
+	return hit.T >= 0;
+}
+
+glm::vec3 Tracer::TracePath(const uint32_t x, const uint32_t y, const uint32_t sample) const
+{
+	const auto& models = std::get<0>(assets_);
+
+	// Every sample of every pixel has its own sequence, the anti-aliasing and the depth of field included.
+	const uint32_t pixelHash = InitRandomSeed(x, y);
+	uint32_t seed = InitRandomSeed(pixelHash, sample);
+
+	const glm::vec2 pixel(x + RandomFloat(seed), y + RandomFloat(seed));
+	const glm::vec2 uv = pixel / glm::vec2(extent_.width, extent_.height) * 2.0f - 1.0f;
+	const glm::vec2 offset = camera_.Aperture / 2 * RandomInUnitDisk(seed);
+	const glm::vec4 target = projectionInverse_ * glm::vec4(uv.x, uv.y, 1, 1);
+
+	glm::vec3 origin(modelViewInverse_ * glm::vec4(offset, 0, 1));
+	glm::vec3 direction(modelViewInverse_ * glm::vec4(glm::normalize(glm::vec3(target) * camera_.FocusDistance - glm::vec3(offset, 0)), 0));
+	glm::vec3 radiance(0);
+	glm::vec3 throughput(1);
+
+	for (uint32_t b = 0; b < numberOfBounces_; ++b)
+	{
+		Hit hit{};
+
+		if (!Trace(origin, direction, b, hit))
+		{
+			radiance += throughput * Miss(direction);
+			break;
+		}
+
+		// The hit point properties of the closest hit shaders.
+		const auto& instance = instances_[hit.Instance];
+		const auto& model = models[instance.ModelId];
+		const glm::vec3 position = origin + hit.T * direction;
+		const Assets::Material* material = instance.Material;
+		glm::vec3 normal;
+		glm::vec2 texCoord;
+
+		if (instance.Sphere != nullptr)
+		{
+			const glm::vec3 point(instance.WorldToObject * glm::vec4(position, 1));
+			const glm::vec3 objectNormal = (point - instance.Sphere->Center) / instance.Sphere->Radius;
+
+			normal = glm::normalize(instance.NormalToWorld * objectNormal);
+			texCoord = SphereTexCoord(objectNormal);
+			material = material != nullptr ? material : &model.Materials()[0];
+		}
+		else
+		{
+			const auto& v0 = model.Vertices()[model.Indices()[hit.Primitive * 3 + 0]];
+			const auto& v1 = model.Vertices()[model.Indices()[hit.Primitive * 3 + 1]];
+			const auto& v2 = model.Vertices()[model.Indices()[hit.Primitive * 3 + 2]];
+			const glm::vec3 barycentrics(1 - hit.Barycentrics.x - hit.Barycentrics.y, hit.Barycentrics.x, hit.Barycentrics.y);
+			const glm::vec3 objectNormal = v0.Normal * barycentrics.x + v1.Normal * barycentrics.y + v2.Normal * barycentrics.z;
+
+			// The meshes without normals fall back to the face one.
+			normal = glm::normalize(instance.NormalToWorld * (objectNormal != glm::vec3(0) ? objectNormal : glm::cross(v1.Position - v0.Position, v2.Position - v0.Position)));
+			texCoord = v0.TexCoord * barycentrics.x + v1.TexCoord * barycentrics.y + v2.TexCoord * barycentrics.z;
+			material = material != nullptr ? material : &model.Materials()[v0.MaterialIndex];
+		}
+
+		// Scatter.glsl, the emitted or absorbed colour ends the path.
+		const glm::vec3 incoming = glm::normalize(direction);
+		glm::vec3 color;
+		glm::vec3 scattered;
+		glm::vec3 offsetNormal = normal;
+		bool isScattered = true;
+
+		switch (material->MaterialModel)
+		{
+		case Assets::Material::Enum::Lambertian:
+			isScattered = glm::dot(incoming, normal) < 0;
+			color = glm::vec3(material->Diffuse) * glm::vec3(SampleTexture(material->DiffuseTextureId, texCoord));
+			scattered = normal + RandomUnitVector(seed);
+			break;
+
+		case Assets::Material::Enum::Metallic:
+		{
+			const glm::vec3 reflected = glm::reflect(incoming, normal);
+
+			isScattered = glm::dot(reflected, normal) > 0;
+			color = glm::vec3(material->Diffuse) * glm::vec3(SampleTexture(material->DiffuseTextureId, texCoord));
+			scattered = reflected + material->Fuzziness * RandomInUnitSphere(seed);
+			break;
+		}
+
+		case Assets::Material::Enum::Dielectric:
+		{
+			const float cosine = glm::dot(incoming, normal);
+			const glm::vec3 outwardNormal = cosine > 0 ? -normal : normal;
+			const float niOverNt = cosine > 0 ? material->RefractionIndex : 1 / material->RefractionIndex;
+			const glm::vec3 refracted = glm::refract(incoming, outwardNormal, niOverNt);
+			const float reflectProb = refracted != glm::vec3(0) ? Schlick(cosine > 0 ? material->RefractionIndex * cosine : -cosine, material->RefractionIndex) : 1;
+
+			color = glm::vec3(SampleTexture(material->DiffuseTextureId, texCoord));
+			scattered = RandomFloat(seed) < reflectProb ? glm::reflect(incoming, normal) : refracted;
+			break;
+		}
+
+		case Assets::Material::Enum::Isotropic:
+			color = glm::vec3(1);
+			scattered = incoming;
+			offsetNormal = glm::vec3(0);
+			break;
+
+		default:
+			color = glm::vec3(material->Diffuse);
+			isScattered = false;
+			break;
+		}
+
+		if (!isScattered)
+		{
+			radiance += throughput * color;
+			break;
+		}
+
+		throughput *= color;
+		origin = OffsetRayOrigin(position, offsetNormal, scattered, sceneRadius_);
+		direction = scattered;
+
+		if (russianRouletteDepth_ != 0 && b + 1 >= russianRouletteDepth_)
+		{
+			const float survival = std::clamp(std::max(throughput.r, std::max(throughput.g, throughput.b)), 0.05f, 1.0f);
+
+			if (RandomFloat(seed) >= survival)
+			{
+				break;
+			}
+
+			throughput /= survival;
+		}
+	}
+
+	return radiance;
+}
+
+glm::vec4 Tracer::SampleTexture(const int32_t textureId, const glm::vec2& texCoord) const
+{
+	const auto& textures = std::get<1>(assets_);
+
+	if (textureId < 0 || static_cast<size_t>(textureId) >= textures.size())
+	{
+		return glm::vec4(1);
+	}
+
+	const auto& texture = textures[textureId];
+
+	if (texture.IsCompressed() || texture.Pixels() == nullptr)
+	{
+		return glm::vec4(1);
+	}
+
+	// Bilinear, repeated or clamped to the edges as the sampler of the texture.
+	const int width = texture.Width();
+	const int height = texture.Height();
+	const bool isRepeated = texture.SamplerConfig().AddressModeU == VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	const glm::vec2 position = texCoord * glm::vec2(width, height) - 0.5f;
+	const glm::ivec2 first(static_cast<int>(std::floor(position.x)), static_cast<int>(std::floor(position.y)));
+	const glm::vec2 fraction = position - glm::vec2(first);
+
+	const auto texel = [&](int tx, int ty)
+	{
+		tx = isRepeated ? (tx % width + width) % width : std::clamp(tx, 0, width - 1);
+		ty = isRepeated ? (ty % height + height) % height : std::clamp(ty, 0, height - 1);
+
+		const unsigned char* const p = texture.Pixels() + (size_t(ty) * width + tx) * 4;
+
+		return glm::vec4(p[0], p[1], p[2], p[3]) / 255.0f;
+	};
+
+	return glm::mix(
+		glm::mix(texel(first.x, first.y), texel(first.x + 1, first.y), fraction.x),
+		glm::mix(texel(first.x, first.y + 1), texel(first.x + 1, first.y + 1), fraction.x),
+		fraction.y);
+}
+
+glm::vec3 Tracer::Miss(const glm::vec3& direction) const
+{
+	const glm::vec3 d = glm::normalize(direction);
+
+	// The bilinear EnvironmentRadiance() of Environment.glsl, wrapping around horizontally.
+	if (environment_)
+	{
+		const auto width = static_cast<int>(environment_->Width());
+		const auto height = static_cast<int>(environment_->Height());
+		const glm::vec2 uv(std::atan2(d.x, -d.z) / (2 * Pi) + 0.5f, std::acos(std::clamp(d.y, -1.0f, 1.0f)) / Pi);
+		const glm::vec2 position = uv * glm::vec2(width, height) - 0.5f;
+		const int firstX = static_cast<int>(std::floor(position.x));
+		const int firstY = static_cast<int>(std::floor(position.y));
+		const glm::vec2 fraction = position - glm::vec2(firstX, firstY);
+
+		const auto x0 = static_cast<uint32_t>((firstX % width + width) % width);
+		const auto x1 = (x0 + 1) % width;
+		const auto y0 = static_cast<uint32_t>(std::clamp(firstY, 0, height - 1));
+		const auto y1 = static_cast<uint32_t>(std::clamp(firstY + 1, 0, height - 1));
+
+		return glm::mix(
+			glm::mix(EnvironmentTexel(*environment_, x0, y0), EnvironmentTexel(*environment_, x1, y0), fraction.x),
+			glm::mix(EnvironmentTexel(*environment_, x0, y1), EnvironmentTexel(*environment_, x1, y1), fraction.x),
+			fraction.y);
+	}
+
+	if (camera_.HasSky)
+	{
+		const float t = 0.5f * (d.y + 1);
+		return glm::mix(glm::vec3(1.0f), glm::vec3(0.5f, 0.7f, 1.0f), t);
+	}
+
+	return glm::vec3(0);
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Bvh.hpp"
+#include "SceneList.hpp"
+#include "Vulkan/Vulkan.hpp"
+#include <memory>
+#include <vector>
+
+namespace Assets
+{
+	class Environment;
+}
+
+struct UserSettings;
+
+namespace Cpu
+{
+	// The headless renderer of the machines without a ray tracing device (see --cpu), e.g. the CPU only nodes of a render farm.
+	// It loads the same scenes and traces the paths of the default GPU configuration: the scattering of Scatter.glsl without light
+	// sampling, the sky or the environment on a miss, the Russian roulette of IsPathTerminated(). The result is the RGBA32F sums of
+	// the accumulation image, alpha being the sample count, so that its images and render farm ranges merge with the GPU ones.
+	// Every model has its own Bvh and the instances one over them, the two levels of the GPU acceleration structures. The image is
+	// traced in tiles that all the hardware threads pull in turn (see Utilities::ParallelFor()), the faster threads taking more.
+	// Left out: the participating media (whose instances are not traced, as on the GPU), the block compressed textures (sampled
+	// as white) and everything the GPU path only does with an option (light sampling, radiance cache, path guiding, ...).
+	class Tracer final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(Tracer)
+
+		Tracer(const UserSettings& userSettings, VkExtent2D extent);
+		~Tracer();
+
+		VkExtent2D Extent() const { return extent_; }
+
+		// Traces the samples [firstSample, firstSample + sampleCount) of every pixel, adding them to the RGBA32F sums.
+		void Render(uint32_t firstSample, uint32_t sampleCount, std::vector<float>& sums) const;
+
+	private:
+
+		struct Instance;
+		struct Hit;
+
+		bool Trace(const glm::vec3& origin, const glm::vec3& direction, uint32_t bounce, Hit& hit) const;
+		glm::vec3 TracePath(uint32_t x, uint32_t y, uint32_t sample) const;
+		glm::vec4 SampleTexture(int32_t textureId, const glm::vec2& texCoord) const;
+		glm::vec3 Miss(const glm::vec3& direction) const;
+
+		const VkExtent2D extent_;
+		const uint32_t numberOfBounces_;
+		const uint32_t russianRouletteDepth_;
+
+		SceneList::CameraInitialSate camera_{};
+		SceneAssets assets_;
+		std::unique_ptr<Assets::Environment> environment_;
+
+		glm::mat4 projectionInverse_{};
+		glm::mat4 modelViewInverse_{};
+		float sceneRadius_{};
+
+		std::vector<Bvh> models_; // Over the triangles of the triangle models, a single primitive for the procedural spheres.
+		std::vector<Instance> instances_; // The traced ones, the media left out.
+		Bvh top_;
+	};
+}
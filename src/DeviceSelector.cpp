@@ -0,0 +1,353 @@
+#include "DeviceSelector.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/Exception.hpp"
+#include "Vulkan/Enumerate.hpp"
+#include "Vulkan/Strings.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	bool IsSuitable(const VkPhysicalDevice device)
+	{
+		// We want a device with geometry shader support.
+		VkPhysicalDeviceFeatures deviceFeatures;
+		vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+
+		if (!deviceFeatures.geometryShader)
+		{
+			return false;
+		}
+
+		// We want a device that supports the ray tracing extension.
+		const auto extensions = Vulkan::GetEnumerateVector(device, static_cast<const char*>(nullptr), vkEnumerateDeviceExtensionProperties);
+		const auto hasRayTracing = std::find_if(extensions.begin(), extensions.end(), [](const VkExtensionProperties& extension)
+		{
+			return strcmp(extension.extensionName, VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME) == 0;
+		});
+
+		if (hasRayTracing == extensions.end())
+		{
+			return false;
+		}
+
+		// We want a device with a graphics queue.
+		const auto queueFamilies = Vulkan::GetEnumerateVector(device, vkGetPhysicalDeviceQueueFamilyProperties);
+		const auto hasGraphicsQueue = std::find_if(queueFamilies.begin(), queueFamilies.end(), [](const VkQueueFamilyProperties& queueFamily)
+		{
+			return queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+		});
+
+		return hasGraphicsQueue != queueFamilies.end();
+	}
+
+	double TypeScore(const VkPhysicalDeviceType type)
+	{
+		switch (type)
+		{
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return 1000;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return 300;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 200;
+		default: return 0;
+		}
+	}
+
+	// Whatever the probe managed to create before failing is released with it.
+	struct ProbeObjects final
+	{
+		VkDevice Device{};
+		VkBuffer Buffer{};
+		VkDeviceMemory Memory{};
+		VkCommandPool CommandPool{};
+		VkQueryPool QueryPool{};
+
+		~ProbeObjects()
+		{
+			if (Device == nullptr)
+			{
+				return;
+			}
+
+			vkDeviceWaitIdle(Device);
+			vkDestroyQueryPool(Device, QueryPool, nullptr);
+			vkDestroyCommandPool(Device, CommandPool, nullptr);
+			vkDestroyBuffer(Device, Buffer, nullptr);
+			vkFreeMemory(Device, Memory, nullptr);
+			vkDestroyDevice(Device, nullptr);
+		}
+	};
+
+	// The GB/s of a few fills of a device local buffer, measured with timestamps on a throwaway logical device. Negative when the device has
+	// no queue with timestamps to measure it.
+	double ProbeBandwidth(const VkPhysicalDevice physicalDevice, const VkPhysicalDeviceProperties& properties)
+	{
+		constexpr VkDeviceSize bufferSize = 64 * 1024 * 1024;
+		constexpr uint32_t fillCount = 8;
+
+		const auto queueFamilies = Vulkan::GetEnumerateVector(physicalDevice, vkGetPhysicalDeviceQueueFamilyProperties);
+		const auto family = std::find_if(queueFamilies.begin(), queueFamilies.end(), [](const VkQueueFamilyProperties& queueFamily)
+		{
+			return queueFamily.queueCount > 0 && queueFamily.timestampValidBits != 0 && queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+		});
+
+		if (family == queueFamilies.end() || properties.limits.timestampPeriod <= 0)
+		{
+			return -1;
+		}
+
+		const uint32_t familyIndex = static_cast<uint32_t>(family - queueFamilies.begin());
+		const float queuePriority = 1.0f;
+		ProbeObjects objects;
+
+		VkDeviceQueueCreateInfo queueCreateInfo = {};
+		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueCreateInfo.queueFamilyIndex = familyIndex;
+		queueCreateInfo.queueCount = 1;
+		queueCreateInfo.pQueuePriorities = &queuePriority;
+
+		VkDeviceCreateInfo deviceCreateInfo = {};
+		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceCreateInfo.queueCreateInfoCount = 1;
+		deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+
+		Vulkan::Check(vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &objects.Device),
+			"create probe device");
+
+		VkQueue queue{};
+		vkGetDeviceQueue(objects.Device, familyIndex, 0, &queue);
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = bufferSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		Vulkan::Check(vkCreateBuffer(objects.Device, &bufferInfo, nullptr, &objects.Buffer),
+			"create probe buffer");
+
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(objects.Device, objects.Buffer, &requirements);
+
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+		uint32_t memoryType = memoryProperties.memoryTypeCount;
+		for (uint32_t i = 0; i != memoryProperties.memoryTypeCount && memoryType == memoryProperties.memoryTypeCount; ++i)
+		{
+			if ((requirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+			{
+				memoryType = i;
+			}
+		}
+
+		if (memoryType == memoryProperties.memoryTypeCount)
+		{
+			return -1;
+		}
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = requirements.size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		Vulkan::Check(vkAllocateMemory(objects.Device, &allocInfo, nullptr, &objects.Memory),
+			"allocate probe memory");
+		Vulkan::Check(vkBindBufferMemory(objects.Device, objects.Buffer, objects.Memory, 0),
+			"bind probe memory");
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = familyIndex;
+
+		Vulkan::Check(vkCreateCommandPool(objects.Device, &poolInfo, nullptr, &objects.CommandPool),
+			"create probe command pool");
+
+		VkQueryPoolCreateInfo queryPoolInfo = {};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = 2;
+
+		Vulkan::Check(vkCreateQueryPool(objects.Device, &queryPoolInfo, nullptr, &objects.QueryPool),
+			"create probe query pool");
+
+		VkCommandBufferAllocateInfo commandBufferInfo = {};
+		commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		commandBufferInfo.commandPool = objects.CommandPool;
+		commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		commandBufferInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer{};
+		Vulkan::Check(vkAllocateCommandBuffers(objects.Device, &commandBufferInfo, &commandBuffer),
+			"allocate probe command buffer");
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		Vulkan::Check(vkBeginCommandBuffer(commandBuffer, &beginInfo),
+			"begin probe command buffer");
+
+		// The first fill warms the memory up, the timed ones start once it is done.
+		vkCmdResetQueryPool(commandBuffer, objects.QueryPool, 0, 2);
+		vkCmdFillBuffer(commandBuffer, objects.Buffer, 0, VK_WHOLE_SIZE, 0);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, objects.QueryPool, 0);
+
+		for (uint32_t i = 0; i != fillCount; ++i)
+		{
+			vkCmdFillBuffer(commandBuffer, objects.Buffer, 0, VK_WHOLE_SIZE, i);
+		}
+
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, objects.QueryPool, 1);
+
+		Vulkan::Check(vkEndCommandBuffer(commandBuffer),
+			"end probe command buffer");
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+
+		Vulkan::Check(vkQueueSubmit(queue, 1, &submitInfo, nullptr),
+			"submit probe");
+		Vulkan::Check(vkQueueWaitIdle(queue),
+			"wait for probe");
+
+		uint64_t timestamps[2] = {};
+		Vulkan::Check(vkGetQueryPoolResults(objects.Device, objects.QueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT),
+			"get probe timestamps");
+
+		const uint64_t mask = family->timestampValidBits == 64 ? ~uint64_t(0) : (uint64_t(1) << family->timestampValidBits) - 1;
+		const double nanoseconds = double((timestamps[1] - timestamps[0]) & mask) * properties.limits.timestampPeriod;
+
+		// Bytes per nanosecond are GB/s.
+		return nanoseconds > 0 ? double(bufferSize) * fillCount / nanoseconds : -1;
+	}
+}
+
+DeviceSelector::DeviceSelector(const std::vector<VkPhysicalDevice>& physicalDevices, const bool probe)
+{
+	for (uint32_t i = 0; i != physicalDevices.size(); ++i)
+	{
+		const auto device = physicalDevices[i];
+
+		if (!IsSuitable(device))
+		{
+			continue;
+		}
+
+		VkPhysicalDeviceRayTracingPipelinePropertiesKHR rayTracingProp{};
+		rayTracingProp.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR;
+
+		VkPhysicalDeviceProperties2 deviceProp{};
+		deviceProp.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		deviceProp.pNext = &rayTracingProp;
+		vkGetPhysicalDeviceProperties2(device, &deviceProp);
+
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+
+		VkDeviceSize deviceLocalMemory = 0;
+		for (uint32_t j = 0; j != memoryProperties.memoryHeapCount; ++j)
+		{
+			if (memoryProperties.memoryHeaps[j].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			{
+				deviceLocalMemory += memoryProperties.memoryHeaps[j].size;
+			}
+		}
+
+		Candidate candidate{};
+		candidate.Index = i;
+		candidate.Device = device;
+		candidate.Name = deviceProp.properties.deviceName;
+		candidate.Type = deviceProp.properties.deviceType;
+		candidate.DeviceLocalMemory = deviceLocalMemory;
+		candidate.MaxRayRecursionDepth = rayTracingProp.maxRayRecursionDepth;
+		candidate.ShaderGroupHandleSize = rayTracingProp.shaderGroupHandleSize;
+		candidate.ProbeBandwidth = -1;
+
+		if (probe)
+		{
+			try
+			{
+				candidate.ProbeBandwidth = ProbeBandwidth(device, deviceProp.properties);
+			}
+			catch (const std::exception& exception)
+			{
+				Utilities::Console::Write(Utilities::Severity::Warning, [&candidate, &exception]()
+				{
+					std::cerr << "WARNING: cannot probe device '" << candidate.Name << "': " << exception.what() << std::endl;
+				});
+			}
+		}
+
+		// The integrated GPUs report the shared system memory as device local, hence the cap. A larger handle makes a larger shader
+		// binding table, fetched by every ray.
+		const double memoryGiB = std::min(double(deviceLocalMemory) / (1024 * 1024 * 1024), 64.0);
+
+		candidate.Score =
+			TypeScore(candidate.Type) +
+			10 * memoryGiB +
+			2 * std::min(candidate.MaxRayRecursionDepth, 31u) -
+			candidate.ShaderGroupHandleSize / 8.0 +
+			2 * std::max(candidate.ProbeBandwidth, 0.0);
+
+		candidates_.push_back(candidate);
+	}
+
+	// Equal scores keep the enumeration order.
+	std::stable_sort(candidates_.begin(), candidates_.end(), [](const Candidate& left, const Candidate& right)
+	{
+		return left.Score > right.Score;
+	});
+}
+
+uint32_t DeviceSelector::Select(const int32_t deviceIndex) const
+{
+	if (candidates_.empty())
+	{
+		Throw(std::runtime_error("cannot find a suitable device"));
+	}
+
+	if (deviceIndex < 0)
+	{
+		return candidates_.front().Index;
+	}
+
+	const auto candidate = std::find_if(candidates_.begin(), candidates_.end(), [deviceIndex](const Candidate& c)
+	{
+		return c.Index == static_cast<uint32_t>(deviceIndex);
+	});
+
+	if (candidate == candidates_.end())
+	{
+		Throw(std::invalid_argument("device " + std::to_string(deviceIndex) + " is missing or not suitable"));
+	}
+
+	return candidate->Index;
+}
+
+void DeviceSelector::Print() const
+{
+	std::cout << "Suitable Devices (best first): " << std::endl;
+
+	for (const auto& candidate : candidates_)
+	{
+		std::cout << "- " << candidate.Index << ": '" << candidate.Name << "' (";
+		std::cout << Vulkan::Strings::DeviceType(candidate.Type) << ", ";
+		std::cout << candidate.DeviceLocalMemory / (1024 * 1024) << " MiB device local, ";
+		std::cout << "max recursion depth " << candidate.MaxRayRecursionDepth << ", ";
+		std::cout << "group handle size " << candidate.ShaderGroupHandleSize;
+
+		if (candidate.ProbeBandwidth >= 0)
+		{
+			std::cout << ", probe " << std::fixed << std::setprecision(1) << candidate.ProbeBandwidth << " GB/s" << std::defaultfloat;
+		}
+
+		std::cout << ") score " << std::fixed << std::setprecision(1) << candidate.Score << std::defaultfloat << std::endl;
+	}
+
+	std::cout << std::endl;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Vulkan/Vulkan.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Ranks the physical devices able to run the application (geometry shaders, ray tracing pipelines and a graphics queue), the best first.
+// The score favours the discrete GPUs over the virtual and integrated ones, then the device local memory and the ray tracing limits
+// (maxRayRecursionDepth, the smaller shaderGroupHandleSize). With --device-probe, each candidate also fills a device local buffer for a
+// few milliseconds and the measured bandwidth is added, which tells apart two GPUs of the same type (e.g. on mixed-GPU nodes).
+class DeviceSelector final
+{
+public:
+
+	VULKAN_NON_COPIABLE(DeviceSelector)
+
+	struct Candidate final
+	{
+		uint32_t Index; // In the enumeration order of the instance, see --device.
+		VkPhysicalDevice Device;
+		std::string Name;
+		VkPhysicalDeviceType Type;
+		VkDeviceSize DeviceLocalMemory;
+		uint32_t MaxRayRecursionDepth;
+		uint32_t ShaderGroupHandleSize;
+		double ProbeBandwidth; // GB/s, negative when not probed.
+		double Score;
+	};
+
+	DeviceSelector(const std::vector<VkPhysicalDevice>& physicalDevices, bool probe);
+	~DeviceSelector() = default;
+
+	// The suitable devices only, by decreasing score.
+	const std::vector<Candidate>& Candidates() const { return candidates_; }
+
+	// The enumeration index of the device to use, the given one when not negative (which must be suitable), the best one otherwise.
+	uint32_t Select(int32_t deviceIndex) const;
+
+	void Print() const;
+
+private:
+
+	std::vector<Candidate> candidates_;
+};
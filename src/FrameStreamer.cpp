@@ -0,0 +1,267 @@
+#include "FrameStreamer.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/Exception.hpp"
+#include "Utilities/StbImage.hpp"
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <iostream>
+
+using boost::asio::ip::tcp;
+
+struct FrameStreamConnection final
+{
+	boost::asio::io_context Context; // Never run, the streamer only makes synchronous calls.
+	tcp::socket Socket{ Context };
+};
+
+namespace
+{
+	const uint32_t FrameMagic = 0x4d415246; // "FRAM"
+	const size_t MaxPendingSends = 64;
+}
+
+FrameStreamer::FrameStreamer(const uint16_t port, const int quality) :
+	port_(port),
+	quality_(std::clamp(quality, 1, 100)),
+	thread_([this]() { Run(); })
+{
+}
+
+FrameStreamer::~FrameStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isStopping_ = true;
+	}
+
+	condition_.notify_all();
+	thread_.join();
+}
+
+bool FrameStreamer::IsReady() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return isConnected_ && !hasFrame_ && !isEncoding_;
+}
+
+void FrameStreamer::Send(const VkExtent2D extent, std::vector<uint8_t>&& rgba)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		frameExtent_ = extent;
+		frame_ = std::move(rgba);
+		hasFrame_ = true;
+	}
+
+	condition_.notify_all();
+}
+
+std::vector<FrameStreamer::InputMessage> FrameStreamer::TakeInput()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::vector<InputMessage> input;
+	input.swap(input_);
+	return input;
+}
+
+FrameStreamer::Statistics FrameStreamer::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto statistics = statistics_;
+	statistics.IsConnected = isConnected_;
+	return statistics;
+}
+
+void FrameStreamer::Run()
+{
+	boost::asio::io_context context;
+	tcp::acceptor acceptor(context, tcp::endpoint(tcp::v4(), port_));
+	acceptor.non_blocking(true);
+
+	std::cout << "Streaming: waiting for a viewer on port " << port_ << std::endl;
+
+	// The acceptor is polled, so that it gives up once stopping.
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			if (isStopping_)
+			{
+				return;
+			}
+		}
+
+		FrameStreamConnection connection;
+		boost::system::error_code error;
+		acceptor.accept(connection.Socket, error);
+
+		if (error)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			continue;
+		}
+
+		connection.Socket.set_option(tcp::no_delay(true), error);
+
+		const auto endpoint = connection.Socket.remote_endpoint(error);
+		std::cout << "Streaming: viewer connected from " << (error ? std::string("unknown") : endpoint.address().to_string()) << std::endl;
+
+		Serve(connection);
+
+		std::cout << "Streaming: viewer disconnected" << std::endl;
+	}
+}
+
+void FrameStreamer::Serve(FrameStreamConnection& connection)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isConnected_ = true;
+		hasFrame_ = false;
+		sendTimes_.clear();
+		input_.clear();
+		periodStart_ = Clock::now();
+		periodFrames_ = 0;
+		periodBytes_ = 0;
+		periodEncodeTime_ = 0;
+		statistics_ = Statistics{ true, 0, 0, 0, -1 };
+	}
+
+	std::thread receiver([this, &connection]() { Receive(connection); });
+	std::vector<uint8_t> jpeg;
+	uint32_t sequence = 0;
+
+	try
+	{
+		for (;;)
+		{
+			std::vector<uint8_t> rgba;
+			VkExtent2D extent;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				condition_.wait(lock, [this]() { return isStopping_ || hasFrame_ || !isConnected_; });
+
+				if (isStopping_ || !isConnected_)
+				{
+					break;
+				}
+
+				rgba = std::move(frame_);
+				extent = frameExtent_;
+				hasFrame_ = false;
+				isEncoding_ = true;
+			}
+
+			const auto start = Clock::now();
+			const auto append = [](void* const context, void* const data, const int size)
+			{
+				auto& bytes = *static_cast<std::vector<uint8_t>*>(context);
+				bytes.insert(bytes.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+			};
+
+			// The output image alpha is unused, the JPEG only keeps the colors.
+			jpeg.clear();
+
+			if (stbi_write_jpg_to_func(append, &jpeg, static_cast<int>(extent.width), static_cast<int>(extent.height), 4, rgba.data(), quality_) == 0)
+			{
+				Throw(std::runtime_error("failed to encode the frame"));
+			}
+
+			const auto encoded = Clock::now();
+			const FrameMessage message{ FrameMagic, ++sequence, extent.width, extent.height, jpeg.size() };
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				sendTimes_.emplace_back(sequence, encoded);
+
+				if (sendTimes_.size() > MaxPendingSends)
+				{
+					sendTimes_.pop_front();
+				}
+			}
+
+			boost::asio::write(connection.Socket, boost::asio::buffer(&message, sizeof(message)));
+			boost::asio::write(connection.Socket, boost::asio::buffer(jpeg));
+
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			isEncoding_ = false;
+			periodFrames_++;
+			periodBytes_ += sizeof(message) + jpeg.size();
+			periodEncodeTime_ += std::chrono::duration<double, std::milli>(encoded - start).count();
+
+			const double period = std::chrono::duration<double>(Clock::now() - periodStart_).count();
+
+			if (period >= 1)
+			{
+				statistics_.FrameRate = static_cast<float>(periodFrames_ / period);
+				statistics_.BitRate = static_cast<float>(periodBytes_ * 8 / period / 1000000);
+				statistics_.EncodeTime = static_cast<float>(periodEncodeTime_ / periodFrames_);
+				periodStart_ = Clock::now();
+				periodFrames_ = 0;
+				periodBytes_ = 0;
+				periodEncodeTime_ = 0;
+			}
+		}
+	}
+	catch (const std::exception& exception)
+	{
+		Utilities::Console::Write(Utilities::Severity::Warning, [&exception]()
+		{
+			std::cerr << "WARNING: streaming failed: " << exception.what() << std::endl;
+		});
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isConnected_ = false;
+		isEncoding_ = false;
+	}
+
+	// Unblocks the receiver.
+	boost::system::error_code error;
+	connection.Socket.shutdown(tcp::socket::shutdown_both, error);
+	receiver.join();
+}
+
+void FrameStreamer::Receive(FrameStreamConnection& connection)
+{
+	try
+	{
+		for (;;)
+		{
+			InputMessage message{};
+			boost::asio::read(connection.Socket, boost::asio::buffer(&message, sizeof(message)));
+
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			if (message.Type != InputFrameShown)
+			{
+				input_.push_back(message);
+				continue;
+			}
+
+			const auto sent = std::find_if(sendTimes_.begin(), sendTimes_.end(), [&message](const auto& send) { return send.first == message.Sequence; });
+
+			if (sent != sendTimes_.end())
+			{
+				statistics_.RoundTrip = static_cast<float>(std::chrono::duration<double, std::milli>(Clock::now() - sent->second).count());
+				sendTimes_.erase(sendTimes_.begin(), sent + 1);
+			}
+		}
+	}
+	catch (const std::exception&)
+	{
+		// The viewer has disconnected, or the connection has been shut down.
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isConnected_ = false;
+	}
+
+	condition_.notify_all();
+}
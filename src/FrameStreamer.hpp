@@ -0,0 +1,105 @@
+#pragma once
+#include "Vulkan/Vulkan.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct FrameStreamConnection; // The TCP socket, kept out of the header.
+
+// Streams the displayed image to a remote viewer over TCP, for the GPU servers without a usable desktop (see --stream).
+// A single viewer at a time. The render loop only hands over the latest output readback, which the streaming thread JPEG encodes
+// and sends as a FrameMessage followed by its bytes, the frames the viewer or the network is too slow for are dropped rather than queued.
+// The viewer sends back InputMessages: its GLFW key, mouse and scroll events, routed to the window handlers, and a FrameShown
+// once it has displayed a frame, which gives the round trip latency from the send to the display. The messages are little endian.
+class FrameStreamer final
+{
+public:
+
+	VULKAN_NON_COPIABLE(FrameStreamer)
+
+	enum InputType : uint32_t
+	{
+		InputKey, // Values: key, scancode, action, mods.
+		InputCursorPosition, // X, Y in pixels of the streamed frame.
+		InputMouseButton, // Values: button, action, mods.
+		InputScroll, // X, Y offsets.
+		InputFrameShown // Sequence of the frame.
+	};
+
+	struct InputMessage final
+	{
+		uint32_t Type;
+		int32_t Values[4];
+		float X;
+		float Y;
+		uint32_t Sequence;
+	};
+
+	struct FrameMessage final
+	{
+		uint32_t Magic;
+		uint32_t Sequence;
+		uint32_t Width;
+		uint32_t Height;
+		uint64_t Size; // JPEG bytes following.
+	};
+
+	struct Statistics final
+	{
+		bool IsConnected;
+		float FrameRate; // Frames sent per second.
+		float BitRate; // Mbit/s
+		float EncodeTime; // Milliseconds per frame.
+		float RoundTrip; // Milliseconds from the send of a frame to the viewer showing it, negative until measured.
+	};
+
+	FrameStreamer(uint16_t port, int quality);
+	~FrameStreamer();
+
+	// Connected, and done with the last frame handed over. The render loop only reads the output image back then.
+	bool IsReady() const;
+
+	// Replaces the frame waiting to be sent, if any.
+	void Send(VkExtent2D extent, std::vector<uint8_t>&& rgba);
+
+	// The input events received since the last call, in order.
+	std::vector<InputMessage> TakeInput();
+
+	Statistics GetStatistics() const;
+
+private:
+
+	using Clock = std::chrono::steady_clock;
+
+	void Run();
+	void Serve(FrameStreamConnection& connection);
+	void Receive(FrameStreamConnection& connection);
+
+	const uint16_t port_;
+	const int quality_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable condition_;
+	bool isStopping_{};
+	bool isConnected_{};
+	bool hasFrame_{};
+	bool isEncoding_{};
+	VkExtent2D frameExtent_{};
+	std::vector<uint8_t> frame_;
+	std::vector<InputMessage> input_;
+	std::deque<std::pair<uint32_t, Clock::time_point>> sendTimes_; // Of the last frames sent, until shown.
+
+	// Averaged over about a second.
+	Clock::time_point periodStart_{};
+	uint32_t periodFrames_{};
+	uint64_t periodBytes_{};
+	double periodEncodeTime_{};
+	Statistics statistics_{};
+
+	std::thread thread_;
+};
@@ -0,0 +1,825 @@
+#include "GltfScene.hpp"
+#include "Assets/Material.hpp"
+#include "Assets/Model.hpp"
+#include "Assets/ModelInstance.hpp"
+#include "Assets/Texture.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/Exception.hpp"
+#include "Utilities/MappedFile.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+using namespace glm;
+using Assets::Material;
+using Assets::Model;
+using Assets::ModelInstance;
+using Assets::Texture;
+using Assets::Vertex;
+
+namespace
+{
+	const uint32_t GlbMagic = 0x46546c67; // "glTF"
+	const uint32_t JsonChunk = 0x4e4f534a; // "JSON"
+	const uint32_t BinChunk = 0x004e4942; // "BIN"
+
+	// Just enough JSON for the glTF documents: a tree of values, the objects keeping the order of their members.
+	class Json final
+	{
+	public:
+
+		enum class Kind { Null, Boolean, Number, String, Array, Object };
+
+		Kind Type = Kind::Null;
+		bool Boolean{};
+		double Number{};
+		std::string String;
+		std::vector<Json> Elements;
+		std::vector<std::pair<std::string, Json>> Members;
+
+		const Json* Find(const std::string_view key) const
+		{
+			const auto member = std::find_if(Members.begin(), Members.end(), [key](const auto& member) { return member.first == key; });
+			return member != Members.end() ? &member->second : nullptr;
+		}
+
+		double Get(const std::string_view key, const double fallback) const
+		{
+			const auto* const value = Find(key);
+			return value != nullptr && value->Type == Kind::Number ? value->Number : fallback;
+		}
+
+		const std::vector<Json>& Array(const std::string_view key) const
+		{
+			static const std::vector<Json> empty;
+			const auto* const value = Find(key);
+			return value != nullptr ? value->Elements : empty;
+		}
+
+		std::string Text(const std::string_view key) const
+		{
+			const auto* const value = Find(key);
+			return value != nullptr ? value->String : std::string();
+		}
+	};
+
+	class JsonParser final
+	{
+	public:
+
+		JsonParser(const std::string& path, const std::string_view text) : path_(path), text_(text)
+		{
+		}
+
+		Json Parse()
+		{
+			auto value = Value(0);
+			Skip();
+
+			if (position_ != text_.size())
+			{
+				Fail("unexpected data after the JSON document");
+			}
+
+			return value;
+		}
+
+	private:
+
+		Json Value(const int depth)
+		{
+			if (depth > 64)
+			{
+				Fail("the JSON document is nested too deeply");
+			}
+
+			Json value;
+			Skip();
+
+			switch (Peek())
+			{
+			case '{':
+				value.Type = Json::Kind::Object;
+				++position_;
+
+				if (!Accept('}'))
+				{
+					do
+					{
+						Skip();
+						auto key = String();
+						Expect(':');
+						value.Members.emplace_back(std::move(key), Value(depth + 1));
+					}
+					while (Accept(','));
+
+					Expect('}');
+				}
+
+				break;
+
+			case '[':
+				value.Type = Json::Kind::Array;
+				++position_;
+
+				if (!Accept(']'))
+				{
+					do
+					{
+						value.Elements.push_back(Value(depth + 1));
+					}
+					while (Accept(','));
+
+					Expect(']');
+				}
+
+				break;
+
+			case '"':
+				value.Type = Json::Kind::String;
+				value.String = String();
+				break;
+
+			case 't': Keyword("true"); value.Type = Json::Kind::Boolean; value.Boolean = true; break;
+			case 'f': Keyword("false"); value.Type = Json::Kind::Boolean; break;
+			case 'n': Keyword("null"); break;
+
+			default:
+				value.Type = Json::Kind::Number;
+				value.Number = Number();
+				break;
+			}
+
+			return value;
+		}
+
+		std::string String()
+		{
+			Expect('"');
+			std::string string;
+
+			for (;;)
+			{
+				const char c = Next();
+
+				if (c == '"')
+				{
+					return string;
+				}
+
+				if (c != '\\')
+				{
+					string += c;
+					continue;
+				}
+
+				switch (const char escape = Next())
+				{
+				case 'b': string += '\b'; break;
+				case 'f': string += '\f'; break;
+				case 'n': string += '\n'; break;
+				case 'r': string += '\r'; break;
+				case 't': string += '\t'; break;
+				case 'u':
+				{
+					// Basic multilingual plane only, encoded as UTF-8.
+					uint32_t code = 0;
+
+					for (int i = 0; i != 4; ++i)
+					{
+						const char digit = Next();
+						code = code * 16 + (std::isdigit(static_cast<unsigned char>(digit)) ? digit - '0' : (std::tolower(static_cast<unsigned char>(digit)) - 'a' + 10) & 15);
+					}
+
+					if (code < 0x80) string += static_cast<char>(code);
+					else if (code < 0x800) string += { static_cast<char>(0xc0 | (code >> 6)), static_cast<char>(0x80 | (code & 0x3f)) };
+					else string += { static_cast<char>(0xe0 | (code >> 12)), static_cast<char>(0x80 | ((code >> 6) & 0x3f)), static_cast<char>(0x80 | (code & 0x3f)) };
+					break;
+				}
+				default: string += escape; break;
+				}
+			}
+		}
+
+		double Number()
+		{
+			const size_t begin = position_;
+
+			while (position_ != text_.size() && std::strchr("+-0123456789.eE", text_[position_]) != nullptr)
+			{
+				++position_;
+			}
+
+			const std::string number(text_.substr(begin, position_ - begin));
+			size_t end = 0;
+			double value = 0;
+
+			try
+			{
+				value = std::stod(number, &end);
+			}
+			catch (const std::exception&)
+			{
+				end = 0;
+			}
+
+			if (number.empty() || end != number.size())
+			{
+				Fail("invalid JSON value at offset " + std::to_string(begin));
+			}
+
+			return value;
+		}
+
+		void Keyword(const std::string_view keyword)
+		{
+			if (text_.substr(position_, keyword.size()) != keyword)
+			{
+				Fail("invalid JSON value at offset " + std::to_string(position_));
+			}
+
+			position_ += keyword.size();
+		}
+
+		void Skip()
+		{
+			while (position_ != text_.size() && std::isspace(static_cast<unsigned char>(text_[position_])))
+			{
+				++position_;
+			}
+		}
+
+		char Peek() const
+		{
+			return position_ != text_.size() ? text_[position_] : '\0';
+		}
+
+		char Next()
+		{
+			if (position_ == text_.size())
+			{
+				Fail("the JSON document is truncated");
+			}
+
+			return text_[position_++];
+		}
+
+		bool Accept(const char c)
+		{
+			Skip();
+
+			if (Peek() != c)
+			{
+				return false;
+			}
+
+			++position_;
+			return true;
+		}
+
+		void Expect(const char c)
+		{
+			if (!Accept(c))
+			{
+				Fail(std::string("expected '") + c + "' at offset " + std::to_string(position_));
+			}
+		}
+
+		[[noreturn]] void Fail(const std::string& message) const
+		{
+			Throw(std::runtime_error("failed to load glTF file '" + path_ + "': " + message));
+		}
+
+		const std::string& path_;
+		const std::string_view text_;
+		size_t position_{};
+	};
+
+	// The typed view of an accessor into the binary chunk.
+	struct Accessor final
+	{
+		const uint8_t* Data;
+		size_t Count;
+		size_t Stride;
+		uint32_t ComponentType;
+		uint32_t Components;
+		bool IsNormalized;
+
+		float Component(const size_t element, const uint32_t component) const
+		{
+			const uint8_t* const data = Data + element * Stride;
+
+			switch (ComponentType)
+			{
+			case 5120: return Load<int8_t>(data, component, 127.0f);
+			case 5121: return Load<uint8_t>(data, component, 255.0f);
+			case 5122: return Load<int16_t>(data, component, 32767.0f);
+			case 5123: return Load<uint16_t>(data, component, 65535.0f);
+			case 5125: return Load<uint32_t>(data, component, 4294967295.0f);
+			default: return Load<float>(data, component, 1.0f);
+			}
+		}
+
+		uint32_t Index(const size_t element) const
+		{
+			const uint8_t* const data = Data + element * Stride;
+
+			switch (ComponentType)
+			{
+			case 5121: return *data;
+			case 5123: { uint16_t index; std::memcpy(&index, data, sizeof(index)); return index; }
+			default: { uint32_t index; std::memcpy(&index, data, sizeof(index)); return index; }
+			}
+		}
+
+	private:
+
+		template <class T>
+		float Load(const uint8_t* const data, const uint32_t component, const float scale) const
+		{
+			T value;
+			std::memcpy(&value, data + component * sizeof(T), sizeof(T));
+			return IsNormalized ? std::max(static_cast<float>(value) / scale, -1.0f) : static_cast<float>(value);
+		}
+	};
+
+	class GltfDocument final
+	{
+	public:
+
+		GltfDocument(const std::string& path, const Utilities::MappedFile& file) : path_(path)
+		{
+			struct Header { uint32_t Magic, Version, Length; };
+			struct ChunkHeader { uint32_t Length, Type; };
+
+			Header header{};
+
+			if (file.Size() < sizeof(header))
+			{
+				Fail("not a binary glTF file");
+			}
+
+			std::memcpy(&header, file.Data(), sizeof(header));
+
+			if (header.Magic != GlbMagic || header.Version != 2 || header.Length > file.Size())
+			{
+				Fail("not a binary glTF 2.0 file");
+			}
+
+			for (size_t offset = sizeof(header); offset + sizeof(ChunkHeader) <= header.Length; )
+			{
+				ChunkHeader chunk{};
+				std::memcpy(&chunk, file.Data() + offset, sizeof(chunk));
+				offset += sizeof(chunk);
+
+				if (chunk.Length > header.Length - offset)
+				{
+					Fail("truncated chunk");
+				}
+
+				if (chunk.Type == JsonChunk && root_.Type == Json::Kind::Null)
+				{
+					root_ = JsonParser(path, std::string_view(reinterpret_cast<const char*>(file.Data() + offset), chunk.Length)).Parse();
+				}
+				else if (chunk.Type == BinChunk && binary_ == nullptr)
+				{
+					binary_ = file.Data() + offset;
+					binarySize_ = chunk.Length;
+				}
+
+				offset += (chunk.Length + 3) & ~3u;
+			}
+
+			if (root_.Type != Json::Kind::Object)
+			{
+				Fail("missing JSON chunk");
+			}
+		}
+
+		const Json& Root() const { return root_; }
+
+		const Json& Element(const char* const array, const double index) const
+		{
+			const auto& elements = root_.Array(array);
+
+			if (!(index >= 0 && index < static_cast<double>(elements.size())))
+			{
+				Fail(std::string(array) + " index " + std::to_string(index) + " is out of range");
+			}
+
+			return elements[static_cast<size_t>(index)];
+		}
+
+		Accessor GetAccessor(const double index, const std::vector<uint32_t>& componentTypes) const
+		{
+			const auto& accessor = Element("accessors", index);
+
+			if (accessor.Find("sparse") != nullptr || accessor.Find("bufferView") == nullptr)
+			{
+				Fail("sparse accessors and accessors without buffer view are not supported");
+			}
+
+			const auto& view = Element("bufferViews", accessor.Get("bufferView", -1));
+			const auto& buffer = Element("buffers", view.Get("buffer", -1));
+
+			if (buffer.Find("uri") != nullptr || binary_ == nullptr)
+			{
+				Fail("only the buffer of the binary chunk is supported");
+			}
+
+			const std::string type = accessor.Text("type");
+			const uint32_t components = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+			const auto componentType = static_cast<uint32_t>(accessor.Get("componentType", 0));
+
+			if (components == 0 || std::find(componentTypes.begin(), componentTypes.end(), componentType) == componentTypes.end())
+			{
+				Fail("unsupported accessor type " + type + " of component type " + std::to_string(componentType));
+			}
+
+			const size_t componentSize = componentType == 5126 || componentType == 5125 ? 4 : componentType == 5122 || componentType == 5123 ? 2 : 1;
+			const size_t elementSize = components * componentSize;
+			const auto count = static_cast<size_t>(accessor.Get("count", 0));
+			const auto stride = static_cast<size_t>(view.Get("byteStride", static_cast<double>(elementSize)));
+			const auto viewOffset = static_cast<size_t>(view.Get("byteOffset", 0));
+			const auto viewLength = static_cast<size_t>(view.Get("byteLength", 0));
+			const auto offset = static_cast<size_t>(accessor.Get("byteOffset", 0));
+
+			if (viewOffset > binarySize_ || viewLength > binarySize_ - viewOffset || stride < elementSize ||
+				(count != 0 && offset + (count - 1) * stride + elementSize > viewLength))
+			{
+				Fail("accessor " + std::to_string(static_cast<size_t>(index)) + " is out of its buffer view");
+			}
+
+			const auto* normalized = accessor.Find("normalized");
+			return Accessor{ binary_ + viewOffset + offset, count, stride, componentType, components, normalized != nullptr && normalized->Boolean };
+		}
+
+		[[noreturn]] void Fail(const std::string& message) const
+		{
+			Throw(std::runtime_error("failed to load glTF file '" + path_ + "': " + message));
+		}
+
+	private:
+
+		const std::string& path_;
+		Json root_;
+		const uint8_t* binary_{};
+		size_t binarySize_{};
+	};
+
+	vec4 Vector(const Json* const value, const vec4& fallback)
+	{
+		vec4 vector = fallback;
+
+		for (size_t i = 0; value != nullptr && i != std::min<size_t>(value->Elements.size(), 4); ++i)
+		{
+			vector[static_cast<int>(i)] = static_cast<float>(value->Elements[i].Number);
+		}
+
+		return vector;
+	}
+
+	std::string DecodeUri(const std::string& uri)
+	{
+		std::string decoded;
+
+		for (size_t i = 0; i < uri.size(); ++i)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size())
+			{
+				decoded += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+				i += 2;
+			}
+			else
+			{
+				decoded += uri[i];
+			}
+		}
+
+		return decoded;
+	}
+
+	Material ToMaterial(const Json& material, const std::vector<int32_t>& textureIds)
+	{
+		const Json empty;
+		const auto* const pbr = material.Find("pbrMetallicRoughness");
+		const auto& parameters = pbr != nullptr ? *pbr : empty;
+		const auto* const extensions = material.Find("extensions");
+		const auto* const transmission = extensions != nullptr ? extensions->Find("KHR_materials_transmission") : nullptr;
+		const auto* const ior = extensions != nullptr ? extensions->Find("KHR_materials_ior") : nullptr;
+		const auto* const strength = extensions != nullptr ? extensions->Find("KHR_materials_emissive_strength") : nullptr;
+
+		const vec4 baseColor = Vector(parameters.Find("baseColorFactor"), vec4(1));
+		const vec3 emissive = vec3(Vector(material.Find("emissiveFactor"), vec4(0))) * static_cast<float>(strength != nullptr ? strength->Get("emissiveStrength", 1) : 1);
+		const float metallic = static_cast<float>(parameters.Get("metallicFactor", 1));
+		const float roughness = static_cast<float>(parameters.Get("roughnessFactor", 1));
+
+		int32_t textureId = -1;
+
+		if (const auto* const texture = parameters.Find("baseColorTexture"))
+		{
+			const auto index = texture->Get("index", -1);
+			textureId = index >= 0 && index < static_cast<double>(textureIds.size()) ? textureIds[static_cast<size_t>(index)] : -1;
+		}
+
+		Material result =
+			emissive != vec3(0) ? Material::DiffuseLight(emissive) :
+			transmission != nullptr && transmission->Get("transmissionFactor", 0) > 0 ? Material::Dielectric(static_cast<float>(ior != nullptr ? ior->Get("ior", 1.5) : 1.5)) :
+			metallic >= 0.5f ? Material::Metallic(vec3(baseColor), roughness, textureId) :
+			Material::Lambertian(vec3(baseColor), textureId);
+
+		result.Diffuse.a = result.MaterialModel == Material::Enum::DiffuseLight ? 1.0f : baseColor.a;
+
+		if (material.Text("alphaMode") == "MASK")
+		{
+			result.AlphaCutoff = static_cast<float>(material.Get("alphaCutoff", 0.5));
+		}
+
+		return result;
+	}
+
+	mat4 LocalTransform(const Json& node)
+	{
+		if (const auto* const matrix = node.Find("matrix"); matrix != nullptr && matrix->Elements.size() == 16)
+		{
+			mat4 transform;
+
+			for (int i = 0; i != 16; ++i)
+			{
+				transform[i / 4][i % 4] = static_cast<float>(matrix->Elements[i].Number);
+			}
+
+			return transform;
+		}
+
+		const vec3 translation(Vector(node.Find("translation"), vec4(0)));
+		const vec4 rotation = Vector(node.Find("rotation"), vec4(0, 0, 0, 1));
+		const vec3 scaling(Vector(node.Find("scale"), vec4(1)));
+
+		return translate(mat4(1), translation) * mat4_cast(quat(rotation.w, rotation.x, rotation.y, rotation.z)) * scale(mat4(1), scaling);
+	}
+
+	// All the triangle primitives of a mesh in a single model, each with its own material. Empty without triangles.
+	std::vector<Model> LoadMesh(const GltfDocument& document, const Json& mesh, const std::vector<Material>& materials)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<Material> modelMaterials;
+		std::vector<int32_t> materialSlots(materials.size() + 1, -1); // The last one for the primitives without material.
+
+		for (const auto& primitive : mesh.Array("primitives"))
+		{
+			const auto* const attributes = primitive.Find("attributes");
+
+			if (primitive.Get("mode", 4) != 4 || attributes == nullptr || attributes->Find("POSITION") == nullptr)
+			{
+				continue;
+			}
+
+			const auto material = primitive.Get("material", -1);
+			const size_t materialIndex = material >= 0 && material < static_cast<double>(materials.size()) ? static_cast<size_t>(material) : materials.size();
+
+			if (materialSlots[materialIndex] < 0)
+			{
+				materialSlots[materialIndex] = static_cast<int32_t>(modelMaterials.size());
+				modelMaterials.push_back(materialIndex != materials.size() ? materials[materialIndex] : Material::Lambertian(vec3(0.7f)));
+			}
+
+			const auto positions = document.GetAccessor(attributes->Get("POSITION", -1), { 5126 });
+			const bool hasNormals = attributes->Find("NORMAL") != nullptr;
+			const bool hasTexCoords = attributes->Find("TEXCOORD_0") != nullptr;
+			const auto normals = hasNormals ? document.GetAccessor(attributes->Get("NORMAL", -1), { 5126 }) : positions;
+			const auto texCoords = hasTexCoords ? document.GetAccessor(attributes->Get("TEXCOORD_0", -1), { 5121, 5123, 5126 }) : positions;
+			const auto firstVertex = static_cast<uint32_t>(vertices.size());
+			const auto firstIndex = indices.size();
+
+			if ((hasNormals && normals.Count < positions.Count) || (hasTexCoords && texCoords.Count < positions.Count))
+			{
+				document.Fail("the primitive attributes do not have the same count");
+			}
+
+			// The only conversion: the separate attribute arrays are interleaved into the model vertices.
+			for (size_t i = 0; i != positions.Count; ++i)
+			{
+				vertices.push_back(Vertex
+				{
+					vec3(positions.Component(i, 0), positions.Component(i, 1), positions.Component(i, 2)),
+					hasNormals ? vec3(normals.Component(i, 0), normals.Component(i, 1), normals.Component(i, 2)) : vec3(0),
+					hasTexCoords ? vec2(texCoords.Component(i, 0), texCoords.Component(i, 1)) : vec2(0),
+					materialSlots[materialIndex]
+				});
+			}
+
+			if (primitive.Find("indices") != nullptr)
+			{
+				const auto primitiveIndices = document.GetAccessor(primitive.Get("indices", -1), { 5121, 5123, 5125 });
+
+				for (size_t i = 0; i + 2 < primitiveIndices.Count; i += 3)
+				{
+					for (size_t j = i; j != i + 3; ++j)
+					{
+						const auto index = primitiveIndices.Index(j);
+
+						if (index >= positions.Count)
+						{
+							document.Fail("vertex index " + std::to_string(index) + " is out of range");
+						}
+
+						indices.push_back(firstVertex + index);
+					}
+				}
+			}
+			else
+			{
+				for (uint32_t i = 0; i + 2 < positions.Count; i += 3)
+				{
+					indices.insert(indices.end(), { firstVertex + i, firstVertex + i + 1, firstVertex + i + 2 });
+				}
+			}
+
+			// Smooth normals for the primitives without any, as for the OBJ models.
+			if (!hasNormals)
+			{
+				for (size_t i = firstIndex; i != indices.size(); i += 3)
+				{
+					const auto& p0 = vertices[indices[i]].Position;
+					const auto normal = cross(vertices[indices[i + 1]].Position - p0, vertices[indices[i + 2]].Position - p0);
+
+					vertices[indices[i + 0]].Normal += normal;
+					vertices[indices[i + 1]].Normal += normal;
+					vertices[indices[i + 2]].Normal += normal;
+				}
+
+				for (auto vertex = vertices.begin() + firstVertex; vertex != vertices.end(); ++vertex)
+				{
+					vertex->Normal = vertex->Normal != vec3(0) ? normalize(vertex->Normal) : vec3(0, 1, 0);
+				}
+			}
+		}
+
+		std::vector<Model> models;
+
+		if (!indices.empty())
+		{
+			models.push_back(Model::CreateMesh(std::move(vertices), std::move(indices), std::move(modelMaterials)));
+		}
+
+		return models;
+	}
+}
+
+SceneAssets GltfScene::Load(const std::string& path, const int32_t firstTextureId, Utilities::TaskSystem& tasks)
+{
+	const Utilities::MappedFile file(path);
+
+	if (!file.IsMapped())
+	{
+		Throw(std::runtime_error("cannot open glTF file '" + path + "'"));
+	}
+
+	const GltfDocument document(path, file);
+	const auto& root = document.Root();
+	const auto directory = std::filesystem::path(path).parent_path();
+	std::string warning;
+
+	// The images referenced by URI, the embedded ones cannot be streamed back in by file name.
+	std::vector<std::future<Texture>> textures;
+	std::vector<int32_t> imageTextureIds;
+
+	for (const auto& image : root.Array("images"))
+	{
+		const auto uri = image.Text("uri");
+
+		if (uri.empty() || uri.rfind("data:", 0) == 0)
+		{
+			warning += "embedded image '" + image.Text("name") + "' skipped, the images must be next to the file\n";
+			imageTextureIds.push_back(-1);
+			continue;
+		}
+
+		const auto texturePath = (directory / DecodeUri(uri)).string();
+
+		imageTextureIds.push_back(firstTextureId + static_cast<int32_t>(textures.size()));
+		textures.push_back(tasks.Run([texturePath]() { return Texture::LoadTexture(texturePath, Vulkan::SamplerConfig()); }));
+	}
+
+	std::vector<int32_t> textureIds;
+
+	for (const auto& texture : root.Array("textures"))
+	{
+		const auto source = texture.Get("source", -1);
+		textureIds.push_back(source >= 0 && source < static_cast<double>(imageTextureIds.size()) ? imageTextureIds[static_cast<size_t>(source)] : -1);
+	}
+
+	std::vector<Material> materials;
+
+	for (const auto& material : root.Array("materials"))
+	{
+		materials.push_back(ToMaterial(material, textureIds));
+	}
+
+	// One model per mesh with triangles.
+	std::vector<Model> models;
+	std::vector<int64_t> meshModels;
+
+	for (const auto& mesh : root.Array("meshes"))
+	{
+		auto meshModel = LoadMesh(document, mesh, materials);
+
+		meshModels.push_back(meshModel.empty() ? -1 : static_cast<int64_t>(models.size()));
+		std::move(meshModel.begin(), meshModel.end(), std::back_inserter(models));
+	}
+
+	// The nodes of the default scene, or all the root nodes without scenes, with their world transform.
+	const auto& nodes = root.Array("nodes");
+	std::vector<std::pair<size_t, mat4>> pending;
+	std::vector<bool> visited(nodes.size());
+	std::vector<ModelInstance> instances;
+
+	if (!root.Array("scenes").empty())
+	{
+		for (const auto& node : document.Element("scenes", root.Get("scene", 0)).Array("nodes"))
+		{
+			pending.emplace_back(static_cast<size_t>(node.Number), mat4(1));
+		}
+	}
+	else
+	{
+		std::vector<bool> isChild(nodes.size());
+
+		for (const auto& node : nodes)
+		{
+			for (const auto& child : node.Array("children"))
+			{
+				isChild[std::min(static_cast<size_t>(child.Number), nodes.size() - 1)] = true;
+			}
+		}
+
+		for (size_t i = 0; i != nodes.size(); ++i)
+		{
+			if (!isChild[i])
+			{
+				pending.emplace_back(i, mat4(1));
+			}
+		}
+	}
+
+	while (!pending.empty())
+	{
+		const auto [index, parent] = pending.back();
+		pending.pop_back();
+
+		if (index >= nodes.size() || visited[index])
+		{
+			document.Fail("invalid node hierarchy");
+		}
+
+		visited[index] = true;
+
+		const auto& node = nodes[index];
+		const auto transform = parent * LocalTransform(node);
+		const auto mesh = node.Get("mesh", -1);
+
+		if (mesh >= 0 && mesh < static_cast<double>(meshModels.size()) && meshModels[static_cast<size_t>(mesh)] >= 0)
+		{
+			instances.push_back({ static_cast<uint32_t>(meshModels[static_cast<size_t>(mesh)]), transform, {} });
+		}
+
+		for (const auto& child : node.Array("children"))
+		{
+			pending.emplace_back(static_cast<size_t>(std::max(0.0, child.Number)), transform);
+		}
+	}
+
+	if (!warning.empty())
+	{
+		Utilities::Console::Write(Utilities::Severity::Warning, [&warning, &path]()
+		{
+			std::cout << "WARNING: '" + path + "': " + warning << std::flush;
+		});
+	}
+
+	if (instances.empty())
+	{
+		Throw(std::runtime_error("glTF file '" + path + "' has no mesh with triangles in its scene"));
+	}
+
+	std::cout << "- loading '" << path << "'... (" << models.size() << " meshes, " << instances.size() << " nodes, " << materials.size() << " materials)" << std::endl;
+
+	std::vector<Texture> loadedTextures;
+
+	for (auto& texture : textures)
+	{
+		loadedTextures.push_back(texture.get());
+	}
+
+	return std::forward_as_tuple(std::move(models), std::move(loadedTextures), std::move(instances));
+}
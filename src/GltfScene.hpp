@@ -0,0 +1,18 @@
+#pragma once
+#include "SceneList.hpp"
+#include <cstdint>
+#include <string>
+
+// The meshes, materials and nodes of a binary glTF 2.0 file (.glb), loaded with --scene-file or the scene file gltf statement.
+// The JSON chunk is the only part parsed, the vertex attributes and indices are read through their accessors straight from
+// the memory mapped binary chunk into the model vertices. Each mesh becomes a model, its triangle primitives keeping their own
+// materials, and each node with a mesh one instance with its world transform, so that the meshes are built once.
+// The base color, metallic, roughness, emissive, alpha mask and KHR_materials_transmission / ior parameters map onto the
+// material models, the base color images are loaded from their URI next to the file.
+class GltfScene final
+{
+public:
+
+	// The material texture ids start at firstTextureId, after the textures already in the scene.
+	static SceneAssets Load(const std::string& path, int32_t firstTextureId, Utilities::TaskSystem& tasks);
+};
@@ -0,0 +1,424 @@
+#include "ImageExporter.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/Exception.hpp"
+#include "Utilities/StbImage.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	template <class T>
+	void WriteValue(std::ostream& out, const T& value)
+	{
+		out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void WriteAttribute(std::ostream& out, const char* const name, const char* const type, const std::string& value)
+	{
+		out.write(name, std::strlen(name) + 1);
+		out.write(type, std::strlen(type) + 1);
+		WriteValue(out, static_cast<int32_t>(value.size()));
+		out.write(value.data(), value.size());
+	}
+
+	template <class... T>
+	std::string Pack(const T&... values)
+	{
+		std::string packed;
+		(packed.append(reinterpret_cast<const char*>(&values), sizeof(values)), ...);
+		return packed;
+	}
+
+	// The accumulated samples averaged, the alpha channel holds their per pixel count.
+	std::vector<float> Average(const std::vector<float>& pixels, const size_t pixelCount)
+	{
+		std::vector<float> rgb(pixelCount * 3);
+
+		for (size_t i = 0; i != pixelCount; ++i)
+		{
+			const float scale = 1.0f / std::max(pixels[i * 4 + 3], 1.0f);
+
+			for (size_t c = 0; c != 3; ++c)
+			{
+				rgb[i * 3 + c] = pixels[i * 4 + c] * scale;
+			}
+		}
+
+		return rgb;
+	}
+
+	// Same gamma correction as the ray generation shader applies to the output image, any channel past RGB is opaque.
+	std::vector<uint8_t> Tonemap(const std::vector<float>& rgb, const size_t pixelCount, const size_t channels)
+	{
+		std::vector<uint8_t> ldr(pixelCount * channels, 255);
+
+		for (size_t i = 0; i != pixelCount; ++i)
+		{
+			for (size_t c = 0; c != 3; ++c)
+			{
+				ldr[i * channels + c] = static_cast<uint8_t>(std::clamp(std::sqrt(rgb[i * 3 + c]), 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+		}
+
+		return ldr;
+	}
+
+	constexpr char CheckpointMagic[8] = { 'R', 'T', 'C', 'K', 'P', 'T', '0', '1' };
+
+	std::string ReplaceAll(std::string text, const std::string& pattern, const std::string& value)
+	{
+		for (size_t i = text.find(pattern); i != std::string::npos; i = text.find(pattern, i + value.size()))
+		{
+			text.replace(i, pattern.size(), value);
+		}
+
+		return text;
+	}
+
+	// Minimal single part, uncompressed, scanline OpenEXR file with 32-bit float B, G, R channels (little endian host).
+	void WriteExr(const std::string& path, const VkExtent2D extent, const std::vector<float>& rgb)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+		if (!file)
+		{
+			Throw(std::runtime_error("failed to open '" + path + "'"));
+		}
+
+		const int32_t width = static_cast<int32_t>(extent.width);
+		const int32_t height = static_cast<int32_t>(extent.height);
+		const int32_t floatPixelType = 2;
+
+		// Channels have to be listed in alphabetical order.
+		std::string channels;
+		for (const char* name : { "B", "G", "R" })
+		{
+			channels.append(name, 2);
+			channels += Pack(floatPixelType, uint8_t(0), uint8_t(0), uint8_t(0), uint8_t(0), int32_t(1), int32_t(1));
+		}
+		channels += '\0';
+
+		const auto window = Pack(int32_t(0), int32_t(0), width - 1, height - 1);
+
+		WriteValue(file, int32_t(20000630));
+		WriteValue(file, int32_t(2));
+		WriteAttribute(file, "channels", "chlist", channels);
+		WriteAttribute(file, "compression", "compression", std::string(1, '\0'));
+		WriteAttribute(file, "dataWindow", "box2i", window);
+		WriteAttribute(file, "displayWindow", "box2i", window);
+		WriteAttribute(file, "lineOrder", "lineOrder", std::string(1, '\0'));
+		WriteAttribute(file, "pixelAspectRatio", "float", Pack(1.0f));
+		WriteAttribute(file, "screenWindowCenter", "v2f", Pack(0.0f, 0.0f));
+		WriteAttribute(file, "screenWindowWidth", "float", Pack(1.0f));
+		file.put('\0');
+
+		// One scanline per chunk, the offset table points at each of them.
+		const int32_t lineSize = width * 3 * static_cast<int32_t>(sizeof(float));
+		const uint64_t tableEnd = static_cast<uint64_t>(file.tellp()) + sizeof(uint64_t) * height;
+
+		for (int32_t y = 0; y != height; ++y)
+		{
+			WriteValue(file, tableEnd + static_cast<uint64_t>(y) * (2 * sizeof(int32_t) + lineSize));
+		}
+
+		std::vector<float> line(static_cast<size_t>(width) * 3);
+
+		for (int32_t y = 0; y != height; ++y)
+		{
+			for (int32_t x = 0; x != width; ++x)
+			{
+				const auto* const pixel = &rgb[(static_cast<size_t>(y) * width + x) * 3];
+				line[x] = pixel[2];
+				line[width + x] = pixel[1];
+				line[2 * width + x] = pixel[0];
+			}
+
+			WriteValue(file, y);
+			WriteValue(file, lineSize);
+			file.write(reinterpret_cast<const char*>(line.data()), lineSize);
+		}
+
+		if (!file)
+		{
+			Throw(std::runtime_error("failed to write '" + path + "'"));
+		}
+	}
+}
+
+ImageExporter::ImageExporter() :
+	thread_([this]() { Run(); })
+{
+}
+
+ImageExporter::~ImageExporter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isStopping_ = true;
+	}
+
+	condition_.notify_one();
+	thread_.join();
+
+	if (stream_ != nullptr)
+	{
+#ifdef _WIN32
+		_pclose(stream_);
+#else
+		pclose(stream_);
+#endif
+	}
+}
+
+void ImageExporter::Export(const std::string& path, const VkExtent2D extent, const uint32_t samples, std::shared_ptr<const std::vector<float>> pixels)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(Job{ path, extent, samples, std::move(pixels), 0 });
+		++pendingJobs_;
+	}
+
+	condition_.notify_one();
+}
+
+void ImageExporter::Stream(const std::string& command, const float framesPerSecond, const VkExtent2D extent, std::shared_ptr<const std::vector<float>> pixels)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(Job{ command, extent, 0, std::move(pixels), framesPerSecond });
+		++pendingJobs_;
+	}
+
+	condition_.notify_one();
+}
+
+void ImageExporter::Checkpoint(const std::string& path, const VkExtent2D extent, const uint32_t samples, const std::string& signature, std::shared_ptr<const std::vector<float>> pixels)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(Job{ path, extent, samples, std::move(pixels), 0, signature, true });
+		++pendingJobs_;
+	}
+
+	condition_.notify_one();
+}
+
+bool ImageExporter::ReadCheckpoint(const std::string& path, const VkExtent2D extent, const std::string& signature, uint32_t& samples, std::vector<float>& pixels)
+{
+	std::ifstream file(path, std::ios::binary);
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	char magic[sizeof(CheckpointMagic)] = {};
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t signatureSize = 0;
+
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(&width), sizeof(width));
+	file.read(reinterpret_cast<char*>(&height), sizeof(height));
+	file.read(reinterpret_cast<char*>(&samples), sizeof(samples));
+	file.read(reinterpret_cast<char*>(&signatureSize), sizeof(signatureSize));
+
+	std::string fileSignature(file && signatureSize == signature.size() ? signatureSize : 0, '\0');
+	file.read(fileSignature.data(), static_cast<std::streamsize>(fileSignature.size()));
+
+	// The extent and the signature must be those of this render, another one is started over.
+	pixels.resize(static_cast<size_t>(extent.width) * extent.height * 4);
+
+	if (!file ||
+		std::memcmp(magic, CheckpointMagic, sizeof(magic)) != 0 ||
+		width != extent.width ||
+		height != extent.height ||
+		fileSignature != signature ||
+		!file.read(reinterpret_cast<char*>(pixels.data()), static_cast<std::streamsize>(pixels.size() * sizeof(float))))
+	{
+		pixels.clear();
+		samples = 0;
+		std::cout << "Checkpoint: '" << path << "' is another render, starting over" << std::endl;
+		return false;
+	}
+
+	std::cout << "Checkpoint: resuming '" << path << "' at " << samples << " samples" << std::endl;
+
+	return true;
+}
+
+void ImageExporter::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	idleCondition_.wait(lock, [this]() { return pendingJobs_ == 0; });
+}
+
+void ImageExporter::Run()
+{
+	for (;;)
+	{
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [this]() { return isStopping_ || !jobs_.empty(); });
+
+			// Drain the queue before stopping, nothing requested gets lost on exit.
+			if (jobs_.empty())
+			{
+				return;
+			}
+
+			job = std::move(jobs_.front());
+			jobs_.pop_front();
+		}
+
+		try
+		{
+			if (job.FramesPerSecond != 0)
+			{
+				WriteStream(job);
+			}
+			else if (job.IsCheckpoint)
+			{
+				WriteCheckpoint(job);
+			}
+			else
+			{
+				Write(job);
+			}
+		}
+		catch (const std::exception& exception)
+		{
+			Utilities::Console::Write(Utilities::Severity::Error, [&exception]()
+			{
+				std::cerr << "ERROR: " << exception.what() << std::endl;
+			});
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			--pendingJobs_;
+		}
+
+		idleCondition_.notify_all();
+	}
+}
+
+void ImageExporter::Write(const Job& job)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	const std::filesystem::path path = job.Path;
+	const size_t pixelCount = static_cast<size_t>(job.Extent.width) * job.Extent.height;
+
+	if (path.has_parent_path())
+	{
+		std::filesystem::create_directories(path.parent_path());
+	}
+
+	const auto rgb = Average(*job.Pixels, pixelCount);
+
+	if (path.extension() == ".exr")
+	{
+		WriteExr(job.Path, job.Extent, rgb);
+	}
+	else
+	{
+		const auto ldr = Tonemap(rgb, pixelCount, 4);
+		const auto width = static_cast<int>(job.Extent.width);
+
+		if (stbi_write_png(job.Path.c_str(), width, static_cast<int>(job.Extent.height), 4, ldr.data(), width * 4) == 0)
+		{
+			Throw(std::runtime_error("failed to write '" + job.Path + "'"));
+		}
+	}
+
+	const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	std::cout << "- exported " << job.Path << " (" << job.Extent.width << "x" << job.Extent.height << ", " << job.Samples << " samples) in " << elapsed << "ms" << std::endl;
+}
+
+void ImageExporter::WriteCheckpoint(const Job& job)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	const std::filesystem::path path = job.Path;
+
+	if (path.has_parent_path())
+	{
+		std::filesystem::create_directories(path.parent_path());
+	}
+
+	// Written aside then renamed over the previous one, a render interrupted while saving keeps its last checkpoint.
+	const std::string temporary = job.Path + ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			Throw(std::runtime_error("cannot write the checkpoint to '" + temporary + "'"));
+		}
+
+		file.write(CheckpointMagic, sizeof(CheckpointMagic));
+		WriteValue(file, job.Extent.width);
+		WriteValue(file, job.Extent.height);
+		WriteValue(file, job.Samples);
+		WriteValue(file, static_cast<uint32_t>(job.Signature.size()));
+		file.write(job.Signature.data(), static_cast<std::streamsize>(job.Signature.size()));
+		file.write(reinterpret_cast<const char*>(job.Pixels->data()), static_cast<std::streamsize>(job.Pixels->size() * sizeof(float)));
+
+		if (!file)
+		{
+			Throw(std::runtime_error("cannot write the checkpoint to '" + temporary + "'"));
+		}
+	}
+
+	std::filesystem::rename(temporary, path);
+
+	const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	std::cout << "- checkpointed " << job.Path << " (" << job.Samples << " samples) in " << elapsed << "ms" << std::endl;
+}
+
+void ImageExporter::WriteStream(const Job& job)
+{
+	if (stream_ == nullptr)
+	{
+		auto command = ReplaceAll(job.Path, "{size}", std::to_string(job.Extent.width) + "x" + std::to_string(job.Extent.height));
+		command = ReplaceAll(command, "{fps}", std::to_string(job.FramesPerSecond));
+
+		std::cout << "- streaming the frames to '" << command << "'" << std::endl;
+
+#ifdef _WIN32
+		stream_ = _popen(command.c_str(), "wb");
+#else
+		stream_ = popen(command.c_str(), "w");
+#endif
+
+		if (stream_ == nullptr)
+		{
+			Throw(std::runtime_error("failed to start '" + command + "'"));
+		}
+
+		streamExtent_ = job.Extent;
+	}
+
+	// The raw video of the encoder has a single size.
+	if (job.Extent.width != streamExtent_.width || job.Extent.height != streamExtent_.height)
+	{
+		Throw(std::runtime_error("the streamed frames must keep the size of the first one"));
+	}
+
+	const size_t pixelCount = static_cast<size_t>(job.Extent.width) * job.Extent.height;
+	const auto ldr = Tonemap(Average(*job.Pixels, pixelCount), pixelCount, 3);
+
+	if (std::fwrite(ldr.data(), 1, ldr.size(), stream_) != ldr.size())
+	{
+		Throw(std::runtime_error("failed to write the frame to the streaming process"));
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "Vulkan/Vulkan.hpp"
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Encodes read back accumulation images on a worker thread, so that the render loop never waits on file IO.
+// Files ending in .exr get the linear HDR average, anything else a tonemapped PNG.
+// The frames of an image sequence can also be streamed to the standard input of a process, e.g. a video encoder,
+// and the sums of a long render checkpointed as they are.
+class ImageExporter final
+{
+public:
+
+	VULKAN_NON_COPIABLE(ImageExporter)
+
+	ImageExporter();
+	~ImageExporter(); // Finishes the pending exports.
+
+	// The pixels are the RGBA32F accumulation sums, they get divided by their sample count (alpha). The samples are only logged.
+	void Export(const std::string& path, VkExtent2D extent, uint32_t samples, std::shared_ptr<const std::vector<float>> pixels);
+
+	// Writes the frame as raw tonemapped RGB8 to the standard input of the command, started with the first frame and closed with the exporter.
+	// The first frame size and the frame rate replace {size} (WxH) and {fps} in the command, see --sequence-pipe.
+	void Stream(const std::string& command, float framesPerSecond, VkExtent2D extent, std::shared_ptr<const std::vector<float>> pixels);
+
+	// Writes the sums as they are, with their sample count and the signature of the render (its scene and settings), for ReadCheckpoint()
+	// to resume it after a crash. The previous checkpoint is only replaced once the new one is complete.
+	void Checkpoint(const std::string& path, VkExtent2D extent, uint32_t samples, const std::string& signature, std::shared_ptr<const std::vector<float>> pixels);
+
+	// The sums and sample count of a checkpoint, false if there is none or if it is of another render (extent or signature).
+	static bool ReadCheckpoint(const std::string& path, VkExtent2D extent, const std::string& signature, uint32_t& samples, std::vector<float>& pixels);
+
+	// Blocks until the files of the exports requested so far are written, e.g. before reporting a render job done.
+	void Wait();
+
+private:
+
+	struct Job final
+	{
+		std::string Path; // The command when streamed.
+		VkExtent2D Extent;
+		uint32_t Samples;
+		std::shared_ptr<const std::vector<float>> Pixels;
+		float FramesPerSecond; // Zero unless streamed.
+		std::string Signature{}; // The render of a checkpoint.
+		bool IsCheckpoint{};
+	};
+
+	void Run();
+	void WriteStream(const Job& job);
+	static void Write(const Job& job);
+	static void WriteCheckpoint(const Job& job);
+
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	std::condition_variable idleCondition_;
+	std::deque<Job> jobs_;
+	size_t pendingJobs_{}; // Queued or being written.
+	bool isStopping_{};
+	std::FILE* stream_{}; // Only used by the worker thread.
+	VkExtent2D streamExtent_{};
+	std::thread thread_;
+};
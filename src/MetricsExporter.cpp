@@ -0,0 +1,389 @@
+#include "MetricsExporter.hpp"
+#include "Utilities/Console.hpp"
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using boost::asio::ip::tcp;
+
+struct MetricsConnection final
+{
+	boost::asio::io_context Context; // Never run, the exporter only makes synchronous calls.
+	tcp::socket Socket{ Context };
+};
+
+struct MetricsExporter::Summary final
+{
+	uint32_t Frames; // Averaged, over about the last second.
+	double FrameTime;
+	double MaxFrameTime;
+	double TraceTime; // Negative when none was measured.
+	double SampleRate; // Samples per pixel per second.
+	double RayRate;
+	double TotalRayRate; // Negative when none was counted.
+	Sample Latest;
+	uint32_t SceneIndex;
+	std::string SceneName;
+};
+
+namespace
+{
+	// The longest the render loop waits for the exporter to pick up a stop, and the poll period of the acceptor.
+	const auto PollPeriod = std::chrono::milliseconds(100);
+
+	// Only the newer half of the history is read, the render loop overwriting the older one meanwhile.
+	const size_t MaxSummarizedFrames = 256;
+
+	// A scrape that has not sent its request (or taken its response) by then is dropped, as is a request header larger than that.
+	const auto RequestTimeout = std::chrono::seconds(2);
+	const auto RequestPollPeriod = std::chrono::milliseconds(10);
+	const size_t MaxRequestSize = 8192;
+
+	std::string Escape(const std::string& text)
+	{
+		std::string escaped;
+
+		for (const char c : text)
+		{
+			switch (c)
+			{
+			case '"': escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			default: escaped += c; break;
+			}
+		}
+
+		return escaped;
+	}
+}
+
+MetricsExporter::MetricsExporter(const uint16_t port, const std::string& path) :
+	port_(port),
+	path_(path),
+	startTime_(Clock::now()),
+	thread_([this]() { Run(); })
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isStopping_ = true;
+	}
+
+	condition_.notify_all();
+	thread_.join();
+}
+
+void MetricsExporter::SetScene(const uint32_t sceneIndex, const std::string& sceneName)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	sceneIndex_ = sceneIndex;
+	sceneName_ = sceneName;
+}
+
+void MetricsExporter::Push(const Sample& sample)
+{
+	history_.Push(sample);
+}
+
+void MetricsExporter::Run()
+{
+	try
+	{
+		boost::asio::io_context context;
+		std::unique_ptr<tcp::acceptor> acceptor;
+
+		if (port_ != 0)
+		{
+			acceptor.reset(new tcp::acceptor(context, tcp::endpoint(tcp::v4(), port_)));
+			acceptor->non_blocking(true);
+
+			std::cout << "Metrics: serving on port " << port_ << std::endl;
+		}
+
+		auto nextWrite = Clock::now() + std::chrono::seconds(1);
+
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+
+				if (condition_.wait_for(lock, PollPeriod, [this]() { return isStopping_; }))
+				{
+					return;
+				}
+			}
+
+			// Every pending scrape is answered in turn, each on its own connection.
+			while (acceptor)
+			{
+				MetricsConnection connection;
+				boost::system::error_code error;
+				acceptor->accept(connection.Socket, error);
+
+				if (error)
+				{
+					break;
+				}
+
+				Serve(connection);
+			}
+
+			if (!path_.empty() && Clock::now() >= nextWrite)
+			{
+				std::ofstream file(path_, std::ios::app);
+				file << JsonLine() << '\n';
+				nextWrite += std::chrono::seconds(1);
+			}
+		}
+	}
+	catch (const std::exception& exception)
+	{
+		Utilities::Console::Write(Utilities::Severity::Warning, [&exception]()
+		{
+			std::cerr << "WARNING: metrics export failed: " << exception.what() << std::endl;
+		});
+	}
+}
+
+void MetricsExporter::Serve(MetricsConnection& connection) const
+{
+	// The accepted socket does not inherit the non-blocking acceptor, a client that sends nothing would otherwise hold the exporter
+	// thread (and the destructor joining it) for as long as it stays connected.
+	const auto deadline = Clock::now() + RequestTimeout;
+
+	const auto wait = [this, deadline]()
+	{
+		if (Clock::now() >= deadline || IsStopping())
+		{
+			return false;
+		}
+
+		std::this_thread::sleep_for(RequestPollPeriod);
+		return true;
+	};
+
+	try
+	{
+		connection.Socket.non_blocking(true);
+
+		// Only the request line matters, the headers are read and ignored.
+		boost::asio::streambuf request(MaxRequestSize);
+		boost::system::error_code error;
+
+		for (;;)
+		{
+			boost::asio::read_until(connection.Socket, request, "\r\n\r\n", error);
+
+			if (error != boost::asio::error::would_block)
+			{
+				break;
+			}
+
+			if (!wait())
+			{
+				throw std::runtime_error("the scrape request timed out");
+			}
+		}
+
+		// Also not_found, from a request header filling the whole buffer.
+		if (error)
+		{
+			throw boost::system::system_error(error);
+		}
+
+		std::istream in(&request);
+		std::string method, target;
+		in >> method >> target;
+
+		const bool isMetrics = method == "GET" && (target == "/metrics" || target == "/");
+		const std::string body = isMetrics ? PrometheusText() : "not found\n";
+
+		std::ostringstream response;
+		response << "HTTP/1.1 " << (isMetrics ? "200 OK" : "404 Not Found") << "\r\n";
+		response << "Content-Type: text/plain; version=0.0.4\r\n";
+		response << "Content-Length: " << body.size() << "\r\n";
+		response << "Connection: close\r\n\r\n";
+		response << body;
+
+		const std::string text = response.str();
+
+		for (size_t written = 0; written != text.size(); )
+		{
+			written += boost::asio::write(connection.Socket, boost::asio::buffer(text.data() + written, text.size() - written), error);
+
+			if (error == boost::asio::error::would_block)
+			{
+				if (!wait())
+				{
+					throw std::runtime_error("the scrape response timed out");
+				}
+			}
+			else if (error)
+			{
+				throw boost::system::system_error(error);
+			}
+		}
+	}
+	catch (const std::exception&)
+	{
+		// The scraper has gone away or stalled, it asks again on its next interval.
+	}
+
+	boost::system::error_code error;
+	connection.Socket.shutdown(tcp::socket::shutdown_both, error);
+	connection.Socket.close(error);
+}
+
+bool MetricsExporter::IsStopping() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return isStopping_;
+}
+
+MetricsExporter::Summary MetricsExporter::Summarize() const
+{
+	Summary summary{};
+	summary.TraceTime = -1;
+	summary.TotalRayRate = -1;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		summary.SceneIndex = sceneIndex_;
+		summary.SceneName = sceneName_;
+	}
+
+	const size_t size = history_.Size();
+
+	if (size == 0)
+	{
+		return summary;
+	}
+
+	summary.Latest = history_[size - 1];
+
+	// From the latest frame back, until about a second of them.
+	double elapsed = 0;
+	double samples = 0;
+	double traceTime = 0;
+	double totalRayRate = 0;
+	uint32_t traced = 0;
+	uint32_t counted = 0;
+
+	for (size_t i = 0; i != std::min(size, MaxSummarizedFrames) && elapsed < 1000; ++i)
+	{
+		const auto& sample = history_[size - 1 - i];
+
+		elapsed += sample.FrameTime;
+		samples += sample.Samples;
+		summary.Frames++;
+		summary.MaxFrameTime = std::max(summary.MaxFrameTime, double(sample.FrameTime));
+		summary.RayRate += sample.RayRate;
+
+		if (sample.TraceTime >= 0)
+		{
+			traceTime += sample.TraceTime;
+			traced++;
+		}
+
+		if (sample.TotalRayRate >= 0)
+		{
+			totalRayRate += sample.TotalRayRate;
+			counted++;
+		}
+	}
+
+	summary.FrameTime = elapsed / summary.Frames;
+	summary.SampleRate = elapsed > 0 ? samples * 1000 / elapsed : 0;
+	summary.RayRate /= summary.Frames;
+	summary.TraceTime = traced != 0 ? traceTime / traced : -1;
+	summary.TotalRayRate = counted != 0 ? totalRayRate / counted : -1;
+
+	return summary;
+}
+
+std::string MetricsExporter::PrometheusText() const
+{
+	const auto summary = Summarize();
+	const auto& latest = summary.Latest;
+	std::ostringstream out;
+
+	const auto gauge = [&out](const char* const name, const char* const help, const double value)
+	{
+		out << "# HELP raytracer_" << name << ' ' << help << '\n';
+		out << "# TYPE raytracer_" << name << " gauge\n";
+		out << "raytracer_" << name << ' ' << value << '\n';
+	};
+
+	out << "# HELP raytracer_scene_info The scene being rendered.\n";
+	out << "# TYPE raytracer_scene_info gauge\n";
+	out << "raytracer_scene_info{index=\"" << summary.SceneIndex << "\",name=\"" << Escape(summary.SceneName) << "\"} 1\n";
+
+	gauge("frames_per_second", "Frames over the last second.", summary.FrameTime > 0 ? 1000 / summary.FrameTime : 0);
+	gauge("frame_time_milliseconds", "Mean CPU frame time over the last second.", summary.FrameTime);
+	gauge("frame_time_max_milliseconds", "Longest CPU frame time over the last second.", summary.MaxFrameTime);
+	gauge("samples_per_second", "Samples per pixel traced per second.", summary.SampleRate);
+	gauge("primary_grays", "Billion primary rays per second.", summary.RayRate);
+
+	if (summary.TraceTime >= 0)
+	{
+		gauge("trace_time_milliseconds", "Mean GPU time of the trace pass over the last second.", summary.TraceTime);
+	}
+
+	if (summary.TotalRayRate >= 0)
+	{
+		gauge("total_grays", "Billion rays traced per second, the bounce and shadow rays included.", summary.TotalRayRate);
+	}
+
+	gauge("accumulated_samples", "Samples per pixel accumulated so far.", latest.TotalSamples);
+	gauge("target_samples", "Samples per pixel the render stops at.", latest.MaxSamples);
+	gauge("progress_ratio", "Accumulated over target samples.", latest.MaxSamples != 0 ? std::min(1.0, double(latest.TotalSamples) / latest.MaxSamples) : 0);
+	gauge("device_local_usage_bytes", "Device local memory used by the process.", static_cast<double>(latest.DeviceLocalUsage));
+	gauge("device_local_budget_bytes", "Device local memory the process can use.", static_cast<double>(latest.DeviceLocalBudget));
+
+	if (latest.BuildTime >= 0)
+	{
+		gauge("as_build_seconds", "Time of the last acceleration structures build.", latest.BuildTime);
+	}
+
+	if (latest.TopLevelBuildTime >= 0)
+	{
+		gauge("tlas_build_milliseconds", "GPU time of the last TLAS build.", latest.TopLevelBuildTime);
+	}
+
+	return out.str();
+}
+
+std::string MetricsExporter::JsonLine() const
+{
+	const auto summary = Summarize();
+	const auto& latest = summary.Latest;
+	std::ostringstream out;
+
+	out << "{\"time_s\": " << std::chrono::duration<double>(Clock::now() - startTime_).count();
+	out << ", \"scene_index\": " << summary.SceneIndex;
+	out << ", \"scene_name\": \"" << Escape(summary.SceneName) << '"';
+	out << ", \"frames\": " << summary.Frames;
+	out << ", \"frame_mean_ms\": " << summary.FrameTime;
+	out << ", \"frame_max_ms\": " << summary.MaxFrameTime;
+	out << ", \"trace_mean_ms\": " << summary.TraceTime;
+	out << ", \"samples_per_s\": " << summary.SampleRate;
+	out << ", \"grays\": " << summary.RayRate;
+	out << ", \"total_grays\": " << summary.TotalRayRate;
+	out << ", \"total_samples\": " << latest.TotalSamples;
+	out << ", \"max_samples\": " << latest.MaxSamples;
+	out << ", \"device_local_usage_bytes\": " << latest.DeviceLocalUsage;
+	out << ", \"device_local_budget_bytes\": " << latest.DeviceLocalBudget;
+	out << ", \"as_build_s\": " << latest.BuildTime;
+	out << ", \"tlas_build_ms\": " << latest.TopLevelBuildTime;
+	out << '}';
+
+	return out.str();
+}
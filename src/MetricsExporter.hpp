@@ -0,0 +1,73 @@
+#pragma once
+#include "Utilities/RingBuffer.hpp"
+#include "Vulkan/Vulkan.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct MetricsConnection; // The TCP socket, kept out of the header.
+
+// Exposes the live throughput of the renderer to the monitoring of a render farm (see --metrics-port and --metrics-file).
+// The render loop pushes one Sample per frame, from the same statistics as the overlay, into a lock-free ring buffer. The
+// exporter thread averages the last second of it on demand: as the Prometheus text format for any HTTP GET of /metrics on the
+// port, and as a JSON line appended to the file every second. Neither ever blocks the render loop.
+class MetricsExporter final
+{
+public:
+
+	VULKAN_NON_COPIABLE(MetricsExporter)
+
+	struct Sample final
+	{
+		float FrameTime; // CPU milliseconds since the previous frame.
+		float TraceTime; // GPU milliseconds, negative when not measured.
+		float RayRate; // Billion primary rays per second.
+		float TotalRayRate; // Billion rays traced per second, negative when not counted.
+		uint32_t Samples; // Per pixel, traced by the frame.
+		uint32_t TotalSamples;
+		uint32_t MaxSamples;
+		float BuildTime; // Seconds of the last acceleration structures build, negative until done.
+		float TopLevelBuildTime; // GPU milliseconds of the last TLAS build, negative until measured.
+		VkDeviceSize DeviceLocalUsage;
+		VkDeviceSize DeviceLocalBudget;
+	};
+
+	// A zero port serves nothing, an empty path writes nothing.
+	MetricsExporter(uint16_t port, const std::string& path);
+	~MetricsExporter();
+
+	// Both from the render loop only.
+	void SetScene(uint32_t sceneIndex, const std::string& sceneName);
+	void Push(const Sample& sample);
+
+private:
+
+	using Clock = std::chrono::steady_clock;
+	using History = Utilities::RingBuffer<Sample, 512>;
+
+	struct Summary;
+
+	void Run();
+	void Serve(MetricsConnection& connection) const;
+	bool IsStopping() const;
+	Summary Summarize() const;
+	std::string PrometheusText() const;
+	std::string JsonLine() const;
+
+	const uint16_t port_;
+	const std::string path_;
+	const Clock::time_point startTime_;
+
+	History history_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable condition_;
+	bool isStopping_{};
+	uint32_t sceneIndex_{};
+	std::string sceneName_;
+
+	std::thread thread_;
+};
@@ -1,7 +1,9 @@
 #include "Options.hpp"
+#include "BenchmarkSweep.hpp"
 #include "SceneList.hpp"
 #include "Utilities/Exception.hpp"
 #include <boost/program_options.hpp>
+#include <algorithm>
 #include <iostream>
 
 using namespace boost::program_options;
@@ -14,18 +16,89 @@ Options::Options(const int argc, const char* argv[])
 	benchmark.add_options()
 		("next-scenes", bool_switch(&BenchmarkNextScenes)->default_value(false), "Load the next scene once the sample or time limit is reached.")
 		("max-time", value<uint32_t>(&BenchmarkMaxTime)->default_value(60), "The benchmark time limit per scene (in seconds).")
+		("benchmark-output", value<std::string>(&BenchmarkOutput)->default_value(""), "Write the per-scene benchmark results to this file (CSV if the extension is .csv, JSON otherwise).")
+		("benchmark-reference", value<std::string>(&BenchmarkReference)->default_value(""), "Report the PSNR of the accumulated image against this PNG (e.g. a previous --export with many samples), suffixed like the exports with --next-scenes.")
+		("sweep", value<std::vector<std::string>>(&BenchmarkSweep)->multitoken(), "Benchmark every combination of the given parameters in a single run, e.g. --sweep samples=1,4,8 bounces=4,8,16 res=1080p,4K (res requires --headless, scale sweeps the render scale, materials=full,compact the material layout, regen=off,on the path regeneration, cache=off,on the radiance cache, guiding=off,on the path guiding; implies --benchmark).")
+		("deterministic", bool_switch(&BenchmarkDeterministic)->default_value(false), "Benchmark exactly --max-samples samples per scene without a time limit nor vsync, reporting the time they took and a hash of the accumulated image (implies --benchmark).")
+		("warm-up", value<float>(&BenchmarkWarmUp)->default_value(1), "Leave the first seconds of every scene (the shader compiles, the texture uploads and the clock ramps) out of its statistics (none in deterministic mode).")
+		("compare-baseline", value<std::string>(&BenchmarkBaseline)->default_value(""), "Compare every scene against the same scene of a previous JSON --benchmark-output, reporting the significant regressions and failing the run on any.")
+		("regression-threshold", value<float>(&RegressionThreshold)->default_value(2), "The slowdown against the baseline (in percent) below which a significant change is not a regression.")
+		("measure-power", bool_switch(&MeasurePower)->default_value(false), "Sample the power of the GPU board on a background thread (NVML, or the hwmon sensors of the DRM cards on Linux) and report the average watts, joules per frame and Grays per joule of every scene.")
+		("micro-benchmark", bool_switch(&MicroBenchmark)->default_value(false), "Benchmark the synthetic micro-scenes one after the other (a single triangle, a dense grid, 1K spheres, deep instancing, alpha tests), each with --sweep rays=primary,shadow,full unless the sweep has rays already (implies --benchmark).")
+		("isolate-rays", value<uint32_t>(&RayIsolation)->default_value(0), "Trace only part of the rays to attribute their cost (0 = whole paths, 1 = the camera rays only, shaded but not scattered, 2 = the camera rays as shadow rays, running the any-hit shaders only; ignored by --wavefront).")
+		("profile-stages", bool_switch(&ProfileStages)->default_value(false), "Accumulate the GPU clocks of the ray tracing stages per bounce, as the heatmap does, and add them to the benchmark report.")
 		;
 
 	options_description renderer("Renderer options", lineLength);
 	renderer.add_options()
 		("samples", value<uint32_t>(&Samples)->default_value(8), "The number of ray samples per pixel.")
 		("bounces", value<uint32_t>(&Bounces)->default_value(16), "The maximum number of bounces per ray.")
+		("roulette-depth", value<uint32_t>(&RouletteDepth)->default_value(0), "The number of bounces after which the paths are terminated by Russian roulette on their throughput (0 = disabled).")
+		("light-sampling", bool_switch(&LightSampling)->default_value(false), "Sample the emissive triangles explicitly at every diffuse bounce, combined with the scattered rays through multiple importance sampling.")
+		("light-tree", bool_switch(&LightTree)->default_value(false), "With --light-sampling, select the sampled emissive triangles through a bounding volume hierarchy of their bounds, power and orientations.")
+		("adaptive-threshold", value<float>(&AdaptiveThreshold)->default_value(0.0f), "Only keep sampling the 8x8 tiles whose relative standard error is above this threshold (0 = disabled).")
+		("foveation", value<float>(&Foveation)->default_value(0.0f), "Trace all the samples within this radius of the gaze point, in fractions of the image diagonal, and fewer further away except on the edges and the noisy pixels (0 = disabled).")
+		("foveation-min", value<float>(&FoveationMin)->default_value(0.25f), "The fraction of the samples the pixels far from the gaze point still trace with --foveation.")
+		("gaze-x", value<float>(&GazeX)->default_value(0.5f), "The horizontal position of the gaze point of --foveation, from 0 (left) to 1 (right).")
+		("gaze-y", value<float>(&GazeY)->default_value(0.5f), "The vertical position of the gaze point of --foveation, from 0 (top) to 1 (bottom).")
+		("denoise", value<uint32_t>(&DenoiseIterations)->default_value(0), "The number of edge-avoiding a-trous iterations filtering the displayed image (0 = disabled, at most 5). The exports are not filtered.")
+		("async-denoise", bool_switch(&AsyncDenoise)->default_value(false), "Denoise each frame on the compute queue while the next one is traced, the displayed image then lags one frame behind.")
+		("reproject", value<uint32_t>(&ReprojectedSamples)->default_value(0), "Reproject the accumulated image when the camera moves instead of discarding it, keeping at most this many samples per pixel (0 = disabled).")
+		("interleave", value<uint32_t>(&Interleave)->default_value(0), "While the camera moves, only trace new samples in part of the pixels every frame, the others keeping their reprojected history (0 = disabled, 1 = checkerboard, 2 = one pixel of each 2x2 block, needs --reproject).")
 		("max-samples", value<uint32_t>(&MaxSamples)->default_value(64 * 1024), "The maximum number of accumulated ray samples per pixel.")
+		("frame-budget", value<float>(&FrameBudget)->default_value(0.0f), "Trace the image in bands of rows over several frames, sized from the GPU timestamps to take this many milliseconds per frame (0 = disabled).")
+		("sample-budget", value<float>(&SampleBudget)->default_value(0.0f), "Pick the samples per frame from the GPU timestamps for the trace to take this many milliseconds, up to --samples (0 = always --samples).")
+		("render-scale", value<float>(&RenderScale)->default_value(1.0f), "Trace the images at this fraction of the window size, upscaling and sharpening them into the swap chain ones (from 0.25 to 1, ignored when headless).")
+		("half-accumulation", bool_switch(&HalfAccumulation)->default_value(false), "Accumulate into a half float image rather than a single float one, keeping at most 1024 samples per pixel.")
+		("compact-as", bool_switch(&CompactAccelerationStructures)->default_value(false), "Compact the bottom level acceleration structures after building them.")
+		("merge-procedurals", bool_switch(&MergeProcedurals)->default_value(false), "Build all the procedural models into a single bottom level acceleration structure.")
+		("cache-as", bool_switch(&CacheAccelerationStructures)->default_value(false), "Load the bottom level acceleration structures from an on-disk cache, storing them there when missing.")
+		("host-build-as", bool_switch(&HostBuildAccelerationStructures)->default_value(false), "Build the triangle bottom level acceleration structures on the CPU threads, then copy them to the GPU (requires accelerationStructureHostCommands).")
+		("geometry-budget", value<uint32_t>(&GeometryBudget)->default_value(0), "Page the bottom level acceleration structures of the large triangle models in and out of a device memory pool of this size (in MB), tracing the missing ones through coarse proxies (0 = all resident).")
+		("build-policy", value<uint32_t>(&BuildPolicy)->default_value(0), "The acceleration structure build policy (0 = FastTrace, 1 = FastBuild, 2 = LowMemory).")
+		("animate", bool_switch(&AnimateInstances)->default_value(false), "Animate the scene instances, refitting the top level acceleration structure every frame.")
+		("deform", bool_switch(&DeformVertices)->default_value(false), "Deform the triangle models with a compute shader wave every frame, refitting their bottom level acceleration structures (not with --compact-as).")
+		("deform-rebuild", value<uint32_t>(&DeformRebuildInterval)->default_value(60), "Rebuild the deformed bottom level acceleration structures after this many refits, restoring the trace performance the refits lose (0 = never).")
+		("sampler", value<uint32_t>(&Sampler)->default_value(0), "The random sequence of the path tracer (0 = Random, 1 = Owen-scrambled Sobol).")
+		("launch-order", value<uint32_t>(&LaunchOrder)->default_value(0), "The order the pixels are handed to the ray generation invocations (0 = Rows, 1 = 8x8 tiles, 2 = Morton order in 32x32 blocks).")
+		("push-constants", bool_switch(&PushConstants)->default_value(false), "Push the per-frame sample counts and seed as constants rather than through the uniform buffer.")
+		("host-visible-sbt", bool_switch(&HostVisibleShaderBindingTable)->default_value(false), "Keep the shader binding table in host visible memory rather than staging it into device local memory (to compare their trace times).")
+		("reorder", bool_switch(&InvocationReorder)->default_value(false), "Sort the hits by material before shading them (requires VK_NV_ray_tracing_invocation_reorder).")
+		("wavefront", bool_switch(&Wavefront)->default_value(false), "Trace with the wavefront compute kernels rather than the ray tracing pipeline (requires VK_KHR_ray_query).")
+		("hybrid", bool_switch(&Hybrid)->default_value(false), "With --wavefront, rasterize the primary visibility and only trace the bounces from it.")
+		("restir", bool_switch(&Restir)->default_value(false), "With --light-sampling, resample the lights of the camera ray hits through spatiotemporal reservoirs (not with --wavefront).")
+		("radiance-cache", bool_switch(&RadianceCache)->default_value(false), "End the paths in a world space hash grid of the diffuse radiance past their first diffuse bounce, trained by one sample in 16 (biased, not with --wavefront).")
+		("path-guiding", bool_switch(&PathGuiding)->default_value(false), "Guide the diffuse bounces towards the incident radiance learnt online by a world space hash grid of lobes (not with --wavefront).")
+		("views", value<uint32_t>(&Views)->default_value(1), "Trace this many cameras in every launch, each accumulating into its own layer and exported with its number before the extension (1 to 8, not with --wavefront).")
+		("view-orbit", value<float>(&ViewOrbit)->default_value(10.0f), "The angle in degrees between consecutive --views, orbiting the camera about the vertical axis through its focus point.")
+		("texture-budget", value<uint32_t>(&TextureBudget)->default_value(1024), "The device memory budget of the streamed textures (in MB), the lowest mip levels of every texture stay resident regardless.")
+		("texture-cache", value<uint32_t>(&TextureCache)->default_value(512), "The host memory budget of the decoded textures kept for the next scene loads and streaming (in MB, 0 = disabled).")
+		("compact-vertices", bool_switch(&CompactVertices)->default_value(false), "Store the vertices with octahedral normals and half float texture coordinates (20 rather than 36 bytes).")
+		("position-stream", bool_switch(&PositionStream)->default_value(false), "Also store the vertex positions tightly packed in their own buffer, read by the acceleration structure builds.")
+		("compact-materials", bool_switch(&CompactMaterials)->default_value(false), "Shade the hits from half float packed materials (16 rather than 32 bytes), fetched with a single load.")
+		("regenerate-paths", bool_switch(&RegeneratePaths)->default_value(false), "Start the next sample of a pixel as soon as its path ends, rather than once the whole subgroup has ended its paths (the same image).")
+		("export", value<std::string>(&ExportOutput)->default_value(""), "Export the accumulated image to this file once the sample limit is reached (linear HDR for .exr, tonemapped PNG otherwise).")
+		("output-width", value<uint32_t>(&OutputWidth)->default_value(0), "Render offline at this width rather than the window one, the window showing a downscaled preview until the export (0 = disabled, requires --export and --output-height).")
+		("output-height", value<uint32_t>(&OutputHeight)->default_value(0), "The height of the offline render.")
+		("output-tile", value<uint32_t>(&OutputTile)->default_value(0), "Split the offline render into tiles no larger than this, traced one after the other (0 = only beyond the device image limits).")
+		("camera-path", value<std::string>(&CameraPath)->default_value(""), "Render an image sequence along the camera keyframes of this file (see CameraPath.hpp), each frame accumulating --max-samples and exported with its number before the extension.")
+		("sequence-pipe", value<std::string>(&SequencePipe)->default_value(""), "Stream the frames of the image sequence as raw RGB8 to this command, {size} and {fps} being replaced, e.g. \"ffmpeg -y -f rawvideo -pix_fmt rgb24 -s {size} -r {fps} -i - out.mp4\".")
+		("bake-probes", value<std::string>(&BakeProbes)->default_value(""), "Bake a grid of irradiance probes over the scene bounds into this file instead of rendering the camera view, in batches of one probe per 16x16 pixels each accumulating --max-samples per direction, resuming a matching unfinished bake (see ProbeBaker.hpp).")
+		("checkpoint", value<std::string>(&Checkpoint)->default_value(""), "Save the accumulation of the headless render to this file every --checkpoint-interval, resuming a matching unfinished render from it (see ImageExporter.hpp).")
+		("checkpoint-interval", value<float>(&CheckpointInterval)->default_value(300.0f), "The seconds between the checkpoints of the headless render.")
+		("probe-grid", value<std::vector<uint32_t>>(&ProbeGrid)->multitoken()->default_value({ 8, 8, 8 }, "8 8 8"), "The number of irradiance probes along the x, y and z axes of the scene bounds.")
+		("probe-encoding", value<uint32_t>(&ProbeEncoding)->default_value(0), "The irradiance stored per probe (0 = L2 spherical harmonics, 1 = 8x8 octahedral map).")
 		;
 
 	options_description scene("Scene options", lineLength);
 	scene.add_options()
 		("scene", value<uint32_t>(&SceneIndex)->default_value(1), "The scene to start with.")
+		("scene-file", value<std::string>(&SceneFile)->default_value(""), "Load the scene described by this file rather than a built-in one (see SceneFile.hpp).")
+		("tessellate-spheres", bool_switch(&TessellateSpheres)->default_value(false), "Build the scene spheres as triangle meshes rather than procedural geometry with an intersection shader.")
+		("lod", bool_switch(&LevelOfDetail)->default_value(false), "Trace the distant instances of the OBJ models with simplified meshes, selected by their size on screen and switched as the camera moves.")
+		("gpu-normals", bool_switch(&GpuNormals)->default_value(false), "Generate the smooth normals of the OBJ and PLY models without any on the GPU, once uploaded, rather than when loading them.")
+		("environment", value<std::string>(&Environment)->default_value(""), "Light the scene with this equirectangular HDR image (.hdr) in place of the sky, importance sampled along with the emissive triangles.")
+		("environment-intensity", value<float>(&EnvironmentIntensity)->default_value(1.0f), "The scale of the environment map radiance.")
 		;
 
 	options_description window("Window options", lineLength);
@@ -33,13 +106,34 @@ Options::Options(const int argc, const char* argv[])
 		("width", value<uint32_t>(&Width)->default_value(1280), "The framebuffer width.")
 		("height", value<uint32_t>(&Height)->default_value(720), "The framebuffer height.")
 		("present-mode", value<uint32_t>(&PresentMode)->default_value(2), "The present mode (0 = Immediate, 1 = MailBox, 2 = FIFO, 3 = FIFORelaxed).")
+		("frames-in-flight", value<uint32_t>(&FramesInFlight)->default_value(2), "The maximum number of frames recorded ahead of the GPU, independently of the swap chain image count.")
+		("low-latency", bool_switch(&LowLatency)->default_value(false), "Wait for the previous frame to be presented (VK_KHR_present_wait) or rendered before sampling the input of the next one.")
+		("render-passes", bool_switch(&RenderPasses)->default_value(false), "Draw the raster preview and the UI through render passes and framebuffers, even when VK_KHR_dynamic_rendering is supported.")
+		("keep-drawing", bool_switch(&KeepDrawing)->default_value(false), "Keep drawing frames once the accumulation has converged, rather than waiting for some input.")
+		("render-thread", bool_switch(&RenderThread)->default_value(false), "Draw the frames on a thread of their own, so that the window keeps handling its events (moves, resizes, input) during long frames.")
 		("fullscreen", bool_switch(&Fullscreen)->default_value(false), "Toggle fullscreen vs windowed (default: windowed).")
+		("headless", bool_switch(&Headless)->default_value(false), "Render offscreen at the requested size without a window or swap chain, until the sample limit is reached.")
+		("headless-output", value<std::string>(&HeadlessOutput)->default_value("headless.png"), "The file the headless image is exported to (linear HDR for .exr, tonemapped PNG otherwise).")
+		("coordinator", value<uint32_t>(&Coordinator)->default_value(0), "Coordinate a render farm on this TCP port instead of rendering, merging the sample ranges traced by the workers into the headless output (0 = disabled).")
+		("worker", value<std::string>(&Worker)->default_value(""), "Render headless for the render farm coordinator at this host:port, with the same scene options as the other workers.")
+		("farm-range", value<uint32_t>(&FarmRange)->default_value(64), "The number of samples per pixel of each range handed out by the render farm coordinator.")
+		("queue", value<std::string>(&Queue)->default_value(""), "Render the jobs dropped in this directory one after the other, keeping the device and the scene between them, until a stop file appears (see RenderQueue.hpp).")
+		("stream", value<uint32_t>(&StreamPort)->default_value(0), "Stream the displayed image as JPEG frames to a viewer connecting on this TCP port, its input being routed back to the camera (0 = disabled, see FrameStreamer.hpp).")
+		("stream-quality", value<uint32_t>(&StreamQuality)->default_value(80), "The JPEG quality of the streamed frames (1 to 100).")
+		("metrics-port", value<uint32_t>(&MetricsPort)->default_value(0), "Serve the live throughput, memory and progress metrics in the Prometheus text format on this HTTP port (0 = disabled, see MetricsExporter.hpp).")
+		("metrics-file", value<std::string>(&MetricsFile)->default_value(""), "Append the same metrics to this file as a JSON line every second.")
+		("devices", value<uint32_t>(&Devices)->default_value(1), "Render headless on this many GPUs, each with its own copy of the scene tracing an interleaved share of the samples, merged into the exported image.")
+		("device", value<int32_t>(&Device)->default_value(-1), "Render on this device, as numbered in the list of Vulkan devices, rather than on the one with the best score (-1 = automatic, see DeviceSelector.hpp).")
+		("device-probe", bool_switch(&DeviceProbe)->default_value(false), "Score the suitable devices with a quick bandwidth probe as well, on top of their type, memory and ray tracing limits.")
+		("cpu", bool_switch(&Cpu)->default_value(false), "Render headless on the CPU threads instead of a ray tracing device, with the default path tracer only (for the machines without one, also as a render farm worker).")
 		;
 
 	options_description desc("Application options", lineLength);
 	desc.add_options()
 		("help", "Display help message.")
 		("benchmark", bool_switch(&Benchmark)->default_value(false), "Run the application in benchmark mode.")
+		("shader-directory", value<std::string>(&ShaderDirectory)->default_value(""), "Load the compiled shaders from the .spv files of this directory when they exist (e.g. build/assets/shaders) instead of those embedded into the executable.")
+		("trace", value<std::string>(&TraceOutput)->default_value(""), "Write the timings of the startup phases and of every frame to this file as a Chrome trace (chrome://tracing or Perfetto).")
 		;
 
 	desc.add(benchmark);
@@ -63,9 +157,272 @@ Options::Options(const int argc, const char* argv[])
 		Throw(std::out_of_range("scene index is too large"));
 	}
 
+	// The scene file comes after the built-in scenes.
+	if (!SceneFile.empty())
+	{
+		SceneIndex = static_cast<uint32_t>(SceneList::AllScenes.size());
+	}
+
+	if (RayIsolation > 2)
+	{
+		Throw(std::out_of_range("invalid ray isolation"));
+	}
+
+	// The micro-scenes from the first one, every ray isolation on each.
+	if (MicroBenchmark)
+	{
+		if (!SceneFile.empty())
+		{
+			Throw(std::invalid_argument("a micro-benchmark cannot load a scene file"));
+		}
+
+		const bool isRaysSwept = std::any_of(BenchmarkSweep.begin(), BenchmarkSweep.end(), [](const std::string& parameter) { return parameter.rfind("rays=", 0) == 0; });
+
+		if (!isRaysSwept)
+		{
+			BenchmarkSweep.push_back("rays=primary,shadow,full");
+		}
+
+		SceneIndex = static_cast<uint32_t>(SceneList::FirstMicroScene);
+		BenchmarkNextScenes = true;
+	}
+
+	if (!(EnvironmentIntensity >= 0))
+	{
+		Throw(std::out_of_range("invalid environment intensity"));
+	}
+
+	if (RenderScale < 0.25f || RenderScale > 1.0f)
+	{
+		Throw(std::out_of_range("invalid render scale"));
+	}
+
+	if (!(Foveation >= 0) || !(FoveationMin > 0 && FoveationMin <= 1))
+	{
+		Throw(std::out_of_range("invalid foveation"));
+	}
+
+	if (!(GazeX >= 0 && GazeX <= 1) || !(GazeY >= 0 && GazeY <= 1))
+	{
+		Throw(std::out_of_range("invalid gaze point"));
+	}
+
+	if (BuildPolicy > 2)
+	{
+		Throw(std::out_of_range("invalid build policy"));
+	}
+
+	if (Sampler > 1)
+	{
+		Throw(std::out_of_range("invalid sampler"));
+	}
+
+	if (Interleave > 2)
+	{
+		Throw(std::out_of_range("invalid interleave pattern"));
+	}
+
+	if (LaunchOrder > 2)
+	{
+		Throw(std::out_of_range("invalid launch order"));
+	}
+
 	if (PresentMode > 3)
 	{
 		Throw(std::out_of_range("invalid present mode"));
 	}
+
+	if (Views < 1 || Views > 8)
+	{
+		Throw(std::out_of_range("invalid view count"));
+	}
+
+	// Parsed here to fail early, the renderer parses it again.
+	if (!BenchmarkSweep.empty())
+	{
+		const class BenchmarkSweep sweep(BenchmarkSweep, Samples, Bounces, RenderScale, { Width, Height }, CompactMaterials, RegeneratePaths, RadianceCache, PathGuiding, RayIsolation);
+
+		if (sweep.IsExtentSwept() && !Headless)
+		{
+			Throw(std::invalid_argument("sweeping the resolution requires --headless"));
+		}
+
+		if (Devices > 1 || !Worker.empty())
+		{
+			Throw(std::invalid_argument("a benchmark sweep must run on a single device"));
+		}
+
+		Benchmark = true;
+	}
+
+	// The same image from one run to the next, as fast as the GPU goes.
+	if (BenchmarkDeterministic)
+	{
+		if (AnimateInstances || DeformVertices)
+		{
+			Throw(std::invalid_argument("a deterministic benchmark cannot animate the instances or deform the vertices"));
+		}
+
+		if (Devices > 1 || !Worker.empty())
+		{
+			Throw(std::invalid_argument("a deterministic benchmark must run on a single device"));
+		}
+
+		Benchmark = true;
+		PresentMode = 0;
+
+		if (ExportOutput.empty())
+		{
+			ExportOutput = "deterministic.exr";
+		}
+	}
+
+	if (!(BenchmarkWarmUp >= 0) || !(RegressionThreshold >= 0))
+	{
+		Throw(std::out_of_range("invalid benchmark warm-up or regression threshold"));
+	}
+
+	if (!BenchmarkBaseline.empty() && !Benchmark)
+	{
+		Throw(std::invalid_argument("comparing against a baseline requires --benchmark"));
+	}
+
+	if (MeasurePower && !Benchmark)
+	{
+		Throw(std::invalid_argument("measuring the power requires --benchmark"));
+	}
+
+	if (FramesInFlight < 1 || FramesInFlight > 8)
+	{
+		Throw(std::out_of_range("invalid number of frames in flight"));
+	}
+
+	if (Headless && Fullscreen)
+	{
+		Throw(std::invalid_argument("headless rendering cannot be fullscreen"));
+	}
+
+	if (Headless && RenderThread)
+	{
+		Throw(std::invalid_argument("headless rendering has no window events to handle on a thread of their own"));
+	}
+
+	if (Devices < 1 || Devices > 16)
+	{
+		Throw(std::out_of_range("invalid number of devices"));
+	}
+
+	if (Device < -1 || (Device >= 0 && Devices > 1))
+	{
+		Throw(std::invalid_argument("a device can only be chosen with --devices 1"));
+	}
+
+	if (Devices > 1 && (!Headless || HeadlessOutput.empty()))
+	{
+		Throw(std::invalid_argument("multi-device rendering requires --headless and a headless output"));
+	}
+
+	if (Coordinator > 65535)
+	{
+		Throw(std::out_of_range("invalid render farm coordinator port"));
+	}
+
+	if (StreamPort > 65535 || StreamQuality < 1 || StreamQuality > 100)
+	{
+		Throw(std::out_of_range("invalid streaming port or quality"));
+	}
+
+	if (MetricsPort > 65535)
+	{
+		Throw(std::out_of_range("invalid metrics port"));
+	}
+
+	if (FarmRange < 1)
+	{
+		Throw(std::out_of_range("invalid render farm range"));
+	}
+
+	if (Coordinator != 0 && (!Worker.empty() || HeadlessOutput.empty()))
+	{
+		Throw(std::invalid_argument("a render farm coordinator cannot be a worker and requires a headless output"));
+	}
+
+	if (!Worker.empty() && (!Headless || HeadlessOutput.empty() || Devices > 1))
+	{
+		Throw(std::invalid_argument("a render farm worker requires --headless and a headless output, on a single device"));
+	}
+
+	if (!Queue.empty() && (!Headless || HeadlessOutput.empty() || Benchmark || Devices > 1 || Coordinator != 0 || !Worker.empty() || OutputWidth != 0 || !CameraPath.empty() || !BakeProbes.empty() || Cpu || StreamPort != 0))
+	{
+		Throw(std::invalid_argument("a render queue requires --headless and a headless output, on a single ray tracing device, outside of a benchmark, a render farm, an offline render, an image sequence, a probe bake and streaming"));
+	}
+
+	if (!(CheckpointInterval > 0))
+	{
+		Throw(std::out_of_range("invalid checkpoint interval"));
+	}
+
+	// The checkpoint holds the sums of a single image, traced whole every frame. The moments are not saved, the sampling that depends on them is excluded.
+	if (!Checkpoint.empty() && (!Headless || HeadlessOutput.empty() || Benchmark || Devices > 1 || Coordinator != 0 || !Worker.empty() || !Queue.empty() || OutputWidth != 0 || !CameraPath.empty() || !BakeProbes.empty() || Cpu || StreamPort != 0 || Views > 1 || FrameBudget != 0 || AdaptiveThreshold != 0 || Foveation != 0))
+	{
+		Throw(std::invalid_argument("a checkpoint requires --headless and a headless output, on a single ray tracing device and view, outside of a benchmark, a render farm or queue, an offline render, an image sequence, a probe bake and streaming, without a frame budget, adaptive sampling or foveation"));
+	}
+
+	if ((OutputWidth == 0) != (OutputHeight == 0))
+	{
+		Throw(std::invalid_argument("an offline render requires both --output-width and --output-height"));
+	}
+
+	if (OutputWidth != 0 && ((Headless ? HeadlessOutput : ExportOutput).empty() || Benchmark || Devices > 1 || !Worker.empty()))
+	{
+		Throw(std::invalid_argument("an offline render requires an export, on a single device and outside of a benchmark"));
+	}
+
+	if (StreamPort != 0 && (OutputWidth != 0 || Devices > 1 || Coordinator != 0 || !Worker.empty()))
+	{
+		Throw(std::invalid_argument("streaming requires a single device, outside of an offline render or a render farm"));
+	}
+
+	if ((MetricsPort != 0 || !MetricsFile.empty()) && (Devices > 1 || Coordinator != 0 || Cpu))
+	{
+		Throw(std::invalid_argument("the metrics export requires a single ray tracing device, outside of a render farm coordinator"));
+	}
+
+	if (!SequencePipe.empty() && CameraPath.empty())
+	{
+		Throw(std::invalid_argument("a sequence pipe requires a camera path"));
+	}
+
+	if (!CameraPath.empty() && (((Headless ? HeadlessOutput : ExportOutput).empty() && SequencePipe.empty()) || Benchmark || Devices > 1 || !Worker.empty() || OutputWidth != 0))
+	{
+		Throw(std::invalid_argument("an image sequence requires an export or a sequence pipe, on a single device, outside of a benchmark and of an offline render"));
+	}
+
+	if (ProbeGrid.size() != 3 || std::find(ProbeGrid.begin(), ProbeGrid.end(), 0u) != ProbeGrid.end() || ProbeEncoding > 1)
+	{
+		Throw(std::out_of_range("invalid probe grid or encoding"));
+	}
+
+	if (!BakeProbes.empty() && (!CameraPath.empty() || Benchmark || Devices > 1 || Coordinator != 0 || !Worker.empty() || OutputWidth != 0 || Views > 1 || Wavefront))
+	{
+		Throw(std::invalid_argument("a probe bake requires a single device and view, outside of a benchmark, an image sequence, an offline render and the wavefront backend"));
+	}
+
+	if (Cpu && (!Headless || HeadlessOutput.empty() || Benchmark || Devices > 1 || Coordinator != 0 || OutputWidth != 0 || !CameraPath.empty() || !BakeProbes.empty() || Views > 1))
+	{
+		Throw(std::invalid_argument("CPU rendering requires --headless and a headless output, on a single view, outside of a benchmark, an offline render, an image sequence and a probe bake"));
+	}
+
+	// The paged structures are built in place in the pool, every frame, from the scene geometry.
+	if (GeometryBudget != 0 && (CompactAccelerationStructures || CacheAccelerationStructures || HostBuildAccelerationStructures || AnimateInstances))
+	{
+		Throw(std::invalid_argument("a geometry budget cannot be used with --compact-as, --cache-as, --host-build-as or --animate"));
+	}
+
+	// The deformed structures are rebuilt in their own storage, which the compaction shrinks, and are never paged.
+	if (DeformVertices && (CompactAccelerationStructures || GeometryBudget != 0))
+	{
+		Throw(std::invalid_argument("deforming the vertices cannot be combined with --compact-as or --geometry-budget"));
+	}
 }
 
@@ -2,6 +2,8 @@
 
 #include <cstdint>
 #include <exception>
+#include <string>
+#include <vector>
 
 class Options final
 {
@@ -20,22 +22,114 @@ public:
 
 	// Application options.
 	bool Benchmark{};
+	std::string TraceOutput{};
+	std::string ShaderDirectory{};
 	// 
 	// Benchmark options.
 	bool BenchmarkNextScenes{};
 	uint32_t BenchmarkMaxTime{};
+	std::string BenchmarkOutput{};
+	std::string BenchmarkReference{};
+	bool BenchmarkDeterministic{};
+	float BenchmarkWarmUp{};
+	std::string BenchmarkBaseline{};
+	float RegressionThreshold{};
+	bool MeasurePower{};
+	bool MicroBenchmark{};
+	uint32_t RayIsolation{};
+	bool ProfileStages{};
+	std::vector<std::string> BenchmarkSweep{};
 
 	// Scene options.
 	uint32_t SceneIndex{};
+	std::string SceneFile{};
+	bool TessellateSpheres{};
+	bool LevelOfDetail{};
+	bool GpuNormals{};
+	std::string Environment{};
+	float EnvironmentIntensity{};
 
 	// Renderer options.
 	uint32_t Samples{};
 	uint32_t Bounces{};
+	uint32_t RouletteDepth{};
+	bool LightSampling{};
+	bool LightTree{};
+	float AdaptiveThreshold{};
+	float Foveation{};
+	float FoveationMin{};
+	float GazeX{};
+	float GazeY{};
+	uint32_t DenoiseIterations{};
+	bool AsyncDenoise{};
+	uint32_t ReprojectedSamples{};
+	uint32_t Interleave{};
 	uint32_t MaxSamples{};
+	float FrameBudget{};
+	float SampleBudget{};
+	float RenderScale{};
+	bool HalfAccumulation{};
+	bool CompactAccelerationStructures{};
+	bool MergeProcedurals{};
+	bool CacheAccelerationStructures{};
+	bool HostBuildAccelerationStructures{};
+	uint32_t GeometryBudget{};
+	bool AnimateInstances{};
+	bool DeformVertices{};
+	uint32_t DeformRebuildInterval{};
+	uint32_t BuildPolicy{};
+	uint32_t Sampler{};
+	uint32_t LaunchOrder{};
+	bool PushConstants{};
+	bool HostVisibleShaderBindingTable{};
+	bool InvocationReorder{};
+	bool Wavefront{};
+	bool Hybrid{};
+	bool Restir{};
+	bool RadianceCache{};
+	bool PathGuiding{};
+	uint32_t Views{};
+	float ViewOrbit{};
+	uint32_t TextureBudget{};
+	uint32_t TextureCache{};
+	bool CompactVertices{};
+	bool PositionStream{};
+	bool CompactMaterials{};
+	bool RegeneratePaths{};
+	std::string ExportOutput{};
+	uint32_t OutputWidth{};
+	uint32_t OutputHeight{};
+	uint32_t OutputTile{};
+	std::string CameraPath{};
+	std::string SequencePipe{};
+	std::string BakeProbes{};
+	std::string Checkpoint{};
+	float CheckpointInterval{};
+	std::vector<uint32_t> ProbeGrid{};
+	uint32_t ProbeEncoding{};
 
 	// Window options
 	uint32_t Width{};
 	uint32_t Height{};
 	uint32_t PresentMode{};
+	uint32_t FramesInFlight{};
+	bool LowLatency{};
+	bool RenderPasses{};
+	bool KeepDrawing{};
+	bool RenderThread{};
 	bool Fullscreen{};
+	bool Headless{};
+	std::string HeadlessOutput{};
+	uint32_t Devices{};
+	int32_t Device{};
+	bool DeviceProbe{};
+	bool Cpu{};
+	uint32_t Coordinator{};
+	std::string Worker{};
+	uint32_t FarmRange{};
+	std::string Queue{};
+	uint32_t StreamPort{};
+	uint32_t StreamQuality{};
+	uint32_t MetricsPort{};
+	std::string MetricsFile{};
 };
@@ -0,0 +1,396 @@
+#include "PowerMonitor.hpp"
+#include "Utilities/Console.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+// Either an energy counter in joules, or the current power in watts.
+class PowerSource
+{
+public:
+
+	virtual ~PowerSource() = default;
+
+	virtual std::string Name() const = 0;
+	virtual bool IsEnergyCounter() const = 0;
+	virtual bool Read(double& value) = 0;
+};
+
+namespace
+{
+	const auto PollPeriod = std::chrono::milliseconds(50);
+
+	// The few NVML entry points used, as declared by nvml.h (the handles are opaque pointers, the return codes 0 on success).
+	class NvmlSource final : public PowerSource
+	{
+	public:
+
+		static std::unique_ptr<PowerSource> Open(const uint8_t (&deviceUuid)[VK_UUID_SIZE])
+		{
+			std::unique_ptr<NvmlSource> source(new NvmlSource());
+			return source->Initialize(deviceUuid) ? std::move(source) : nullptr;
+		}
+
+		~NvmlSource() override
+		{
+			if (isInitialized_)
+			{
+				shutdown_();
+			}
+
+			if (library_ != nullptr)
+			{
+#ifdef _WIN32
+				FreeLibrary(static_cast<HMODULE>(library_));
+#else
+				dlclose(library_);
+#endif
+			}
+		}
+
+		std::string Name() const override
+		{
+			return energy_ != nullptr ? "NVML energy counter" : "NVML power";
+		}
+
+		bool IsEnergyCounter() const override
+		{
+			return energy_ != nullptr;
+		}
+
+		bool Read(double& value) override
+		{
+			if (energy_ != nullptr)
+			{
+				unsigned long long millijoules = 0;
+
+				if (energy_(device_, &millijoules) != 0)
+				{
+					return false;
+				}
+
+				value = millijoules / 1000.0;
+				return true;
+			}
+
+			unsigned int milliwatts = 0;
+
+			if (power_(device_, &milliwatts) != 0)
+			{
+				return false;
+			}
+
+			value = milliwatts / 1000.0;
+			return true;
+		}
+
+	private:
+
+		using Device = void*;
+		using Init = int (*)();
+		using Shutdown = int (*)();
+		using GetCount = int (*)(unsigned int*);
+		using GetHandleByIndex = int (*)(unsigned int, Device*);
+		using GetUuid = int (*)(Device, char*, unsigned int);
+		using GetTotalEnergyConsumption = int (*)(Device, unsigned long long*);
+		using GetPowerUsage = int (*)(Device, unsigned int*);
+
+		NvmlSource() = default;
+
+		template <class T>
+		T Function(const char* const name) const
+		{
+#ifdef _WIN32
+			return reinterpret_cast<T>(GetProcAddress(static_cast<HMODULE>(library_), name));
+#else
+			return reinterpret_cast<T>(dlsym(library_, name));
+#endif
+		}
+
+		bool Initialize(const uint8_t (&deviceUuid)[VK_UUID_SIZE])
+		{
+#ifdef _WIN32
+			library_ = LoadLibraryA("nvml.dll");
+#else
+			library_ = dlopen("libnvidia-ml.so.1", RTLD_NOW);
+#endif
+
+			if (library_ == nullptr)
+			{
+				return false;
+			}
+
+			const auto init = Function<Init>("nvmlInit_v2");
+			const auto getCount = Function<GetCount>("nvmlDeviceGetCount_v2");
+			const auto getHandle = Function<GetHandleByIndex>("nvmlDeviceGetHandleByIndex_v2");
+			const auto getUuid = Function<GetUuid>("nvmlDeviceGetUUID");
+			shutdown_ = Function<Shutdown>("nvmlShutdown");
+			power_ = Function<GetPowerUsage>("nvmlDeviceGetPowerUsage");
+
+			if (init == nullptr || getCount == nullptr || getHandle == nullptr || getUuid == nullptr || shutdown_ == nullptr || power_ == nullptr || init() != 0)
+			{
+				return false;
+			}
+
+			isInitialized_ = true;
+
+			// NVML names the devices by the same UUID as Vulkan, as GPU-xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx.
+			std::ostringstream uuid;
+			uuid << "GPU-" << std::hex << std::setfill('0');
+
+			for (size_t i = 0; i != VK_UUID_SIZE; ++i)
+			{
+				uuid << (i == 4 || i == 6 || i == 8 || i == 10 ? "-" : "") << std::setw(2) << static_cast<uint32_t>(deviceUuid[i]);
+			}
+
+			unsigned int count = 0;
+
+			if (getCount(&count) != 0)
+			{
+				return false;
+			}
+
+			for (unsigned int i = 0; i != count; ++i)
+			{
+				char name[96] = {};
+				Device device = nullptr;
+
+				if (getHandle(i, &device) == 0 && getUuid(device, name, sizeof(name)) == 0 && uuid.str() == name)
+				{
+					device_ = device;
+					break;
+				}
+			}
+
+			if (device_ == nullptr)
+			{
+				return false;
+			}
+
+			// The energy counter only exists from Volta onwards.
+			unsigned long long millijoules = 0;
+			energy_ = Function<GetTotalEnergyConsumption>("nvmlDeviceGetTotalEnergyConsumption");
+			energy_ = energy_ != nullptr && energy_(device_, &millijoules) == 0 ? energy_ : nullptr;
+
+			unsigned int milliwatts = 0;
+			return energy_ != nullptr || power_(device_, &milliwatts) == 0;
+		}
+
+		void* library_{};
+		bool isInitialized_{};
+		Device device_{};
+		Shutdown shutdown_{};
+		GetTotalEnergyConsumption energy_{};
+		GetPowerUsage power_{};
+	};
+
+	// The hwmon sensors of a DRM card: energy1_input in microjoules, else power1_average or power1_input in microwatts.
+	class SysfsSource final : public PowerSource
+	{
+	public:
+
+		static std::unique_ptr<PowerSource> Open(const uint32_t vendorId, const uint32_t deviceId)
+		{
+			const std::filesystem::path drm = "/sys/class/drm";
+			std::error_code error;
+
+			if (!std::filesystem::is_directory(drm, error))
+			{
+				return nullptr;
+			}
+
+			for (const auto& card : std::filesystem::directory_iterator(drm, error))
+			{
+				// The connectors are listed as card0-DP-1 and the like.
+				const auto name = card.path().filename().string();
+
+				if (name.rfind("card", 0) != 0 || name.find('-') != std::string::npos)
+				{
+					continue;
+				}
+
+				const auto device = card.path() / "device";
+
+				if (ReadHex(device / "vendor") != vendorId || ReadHex(device / "device") != deviceId || !std::filesystem::is_directory(device / "hwmon", error))
+				{
+					continue;
+				}
+
+				for (const auto& hwmon : std::filesystem::directory_iterator(device / "hwmon", error))
+				{
+					for (const char* const sensor : { "energy1_input", "power1_average", "power1_input" })
+					{
+						std::unique_ptr<SysfsSource> source(new SysfsSource(hwmon.path() / sensor, sensor[0] == 'e'));
+						double value = 0;
+
+						if (source->Read(value))
+						{
+							return source;
+						}
+					}
+				}
+			}
+
+			return nullptr;
+		}
+
+		std::string Name() const override
+		{
+			return path_.string();
+		}
+
+		bool IsEnergyCounter() const override
+		{
+			return isEnergyCounter_;
+		}
+
+		bool Read(double& value) override
+		{
+			std::ifstream file(path_);
+			uint64_t micro = 0;
+
+			if (!(file >> micro))
+			{
+				return false;
+			}
+
+			value = micro / 1000000.0;
+			return true;
+		}
+
+	private:
+
+		SysfsSource(std::filesystem::path path, const bool isEnergyCounter) :
+			path_(std::move(path)),
+			isEnergyCounter_(isEnergyCounter)
+		{
+		}
+
+		static uint32_t ReadHex(const std::filesystem::path& path)
+		{
+			std::ifstream file(path);
+			uint32_t value = 0;
+			file >> std::hex >> value;
+			return value;
+		}
+
+		const std::filesystem::path path_;
+		const bool isEnergyCounter_;
+	};
+}
+
+PowerMonitor::PowerMonitor(const uint32_t vendorId, const uint32_t deviceId, const uint8_t (&deviceUuid)[VK_UUID_SIZE])
+{
+	source_ = NvmlSource::Open(deviceUuid);
+
+#ifndef _WIN32
+	if (!source_)
+	{
+		source_ = SysfsSource::Open(vendorId, deviceId);
+	}
+#else
+	(void)vendorId;
+	(void)deviceId;
+#endif
+
+	if (!source_)
+	{
+		Utilities::Console::Write(Utilities::Severity::Warning, []()
+		{
+			std::cerr << "WARNING: no power sensor found for the device, the benchmark does not measure its energy" << std::endl;
+		});
+
+		return;
+	}
+
+	std::cout << "Power: measuring with " << source_->Name() << std::endl;
+
+	thread_ = std::thread([this]() { Run(); });
+}
+
+PowerMonitor::~PowerMonitor()
+{
+	if (!thread_.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isStopping_ = true;
+	}
+
+	condition_.notify_all();
+	thread_.join();
+}
+
+std::string PowerMonitor::SourceName() const
+{
+	return source_ ? source_->Name() : std::string();
+}
+
+double PowerMonitor::Energy() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return source_ ? energy_ : -1;
+}
+
+void PowerMonitor::Run()
+{
+	using Clock = std::chrono::steady_clock;
+
+	const bool isEnergyCounter = source_->IsEnergyCounter();
+	auto previousTime = Clock::now();
+	double previousCounter = 0;
+	bool hasPreviousCounter = false;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+
+			if (condition_.wait_for(lock, PollPeriod, [this]() { return isStopping_; }))
+			{
+				return;
+			}
+		}
+
+		const auto time = Clock::now();
+		const double elapsed = std::chrono::duration<double>(time - previousTime).count();
+		double value = 0;
+
+		previousTime = time;
+
+		if (!source_->Read(value))
+		{
+			hasPreviousCounter = false;
+			continue;
+		}
+
+		// The counters wrap or restart with the driver, such a poll is skipped. The power is held over the poll period.
+		double energy = 0;
+
+		if (isEnergyCounter)
+		{
+			energy = hasPreviousCounter && value >= previousCounter ? value - previousCounter : 0;
+			previousCounter = value;
+			hasPreviousCounter = true;
+		}
+		else
+		{
+			energy = value * elapsed;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		energy_ += energy;
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Vulkan/Vulkan.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class PowerSource; // The sensor library or files, kept out of the header.
+
+// The energy drawn by the GPU board during the benchmark (see --measure-power), for the watts, joules per frame and Grays per joule
+// of every scene. A background thread polls the sensor of the device every 50 ms and keeps the running total, the render loop
+// only reading it at the start and the end of a measurement. The sensor is NVML when the NVIDIA driver library is found, loaded at
+// run time, and otherwise the hwmon files of the DRM card of the same vendor and device on Linux (amdgpu, i915, xe). Either an
+// energy counter, or else the power integrated over the polls. Nothing is measured without one, Energy() then staying negative.
+class PowerMonitor final
+{
+public:
+
+	VULKAN_NON_COPIABLE(PowerMonitor)
+
+	PowerMonitor(uint32_t vendorId, uint32_t deviceId, const uint8_t (&deviceUuid)[VK_UUID_SIZE]);
+	~PowerMonitor();
+
+	bool IsAvailable() const { return source_ != nullptr; }
+	std::string SourceName() const;
+
+	// Joules since the monitor started, as of the last poll, negative without a sensor.
+	double Energy() const;
+
+private:
+
+	void Run();
+
+	std::unique_ptr<PowerSource> source_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable condition_;
+	bool isStopping_{};
+	double energy_{};
+
+	std::thread thread_;
+};
@@ -0,0 +1,260 @@
+#include "ProbeBaker.hpp"
+#include "Utilities/Exception.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	const char Magic[8] = { 'R', 'T', 'P', 'R', 'O', 'B', 'E', '\0' };
+	const uint32_t Version = 1;
+	const uint32_t SubTexels = 4; // Per side, the solid angle of a texel is integrated over these.
+	const float Pi = 3.1415926535897932384626433832795f;
+
+	// The point of the octahedron the unit vector of e in [-1, 1]^2 goes through, before it is normalized (see Octahedral.glsl).
+	glm::vec3 OctahedronPoint(const glm::vec2& e)
+	{
+		glm::vec3 n(e, 1.0f - std::abs(e.x) - std::abs(e.y));
+
+		if (n.z < 0)
+		{
+			const float x = (1.0f - std::abs(n.y)) * (n.x >= 0 ? 1.0f : -1.0f);
+			const float y = (1.0f - std::abs(n.x)) * (n.y >= 0 ? 1.0f : -1.0f);
+
+			n.x = x;
+			n.y = y;
+		}
+
+		return n;
+	}
+
+	// The direction at the centre of texel (x, y) of an octahedral map of the given size.
+	glm::vec3 TexelDirection(const uint32_t x, const uint32_t y, const uint32_t size)
+	{
+		return glm::normalize(OctahedronPoint((glm::vec2(x, y) + 0.5f) / static_cast<float>(size) * 2.0f - 1.0f));
+	}
+
+	// The real spherical harmonics basis up to L2.
+	void EvaluateHarmonics(const glm::vec3& d, float (&basis)[ProbeBaker::HarmonicsCount])
+	{
+		basis[0] = 0.282095f;
+		basis[1] = 0.488603f * d.y;
+		basis[2] = 0.488603f * d.z;
+		basis[3] = 0.488603f * d.x;
+		basis[4] = 1.092548f * d.x * d.y;
+		basis[5] = 1.092548f * d.y * d.z;
+		basis[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+		basis[7] = 1.092548f * d.x * d.z;
+		basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+	}
+}
+
+ProbeBaker::ProbeBaker(const std::string& path, const glm::uvec3& grid, const Encoding encoding, const uint32_t samples, const glm::vec3& boundsMin, const glm::vec3& boundsMax) :
+	path_(path),
+	grid_(grid),
+	encoding_(encoding),
+	samples_(samples),
+	boundsMin_(boundsMin),
+	boundsMax_(boundsMax)
+{
+	if (grid_.x == 0 || grid_.y == 0 || grid_.z == 0)
+	{
+		Throw(std::runtime_error("the probe grid must have at least one probe per axis"));
+	}
+
+	// The octahedral map does not cover the sphere evenly, a texel subtends dudv / |p|^3 at the octahedron point p
+	// it is centred on. The sum is normalized to the whole sphere.
+	double totalSolidAngle = 0;
+
+	for (uint32_t y = 0; y != TileSize; ++y)
+	{
+		for (uint32_t x = 0; x != TileSize; ++x)
+		{
+			float solidAngle = 0;
+
+			for (uint32_t i = 0; i != SubTexels * SubTexels; ++i)
+			{
+				const glm::vec2 uv = (glm::vec2(x, y) + (glm::vec2(i % SubTexels, i / SubTexels) + 0.5f) / static_cast<float>(SubTexels)) / static_cast<float>(TileSize);
+				const float length = glm::length(OctahedronPoint(uv * 2.0f - 1.0f));
+
+				solidAngle += 1.0f / (length * length * length);
+			}
+
+			texelDirections_.push_back(TexelDirection(x, y, TileSize));
+			texelSolidAngles_.push_back(solidAngle);
+			totalSolidAngle += solidAngle;
+		}
+	}
+
+	for (auto& solidAngle : texelSolidAngles_)
+	{
+		solidAngle = static_cast<float>(solidAngle * 4.0 * Pi / totalSolidAngle);
+	}
+
+	values_.resize(size_t(ProbeCount()) * ValuesPerProbe() * 3);
+
+	Load();
+}
+
+void ProbeBaker::AddBatch(const uint32_t firstProbe, const uint32_t endProbe, const uint32_t width, const std::vector<float>& pixels)
+{
+	// A batch traced before the bake restarted, e.g. for another scene.
+	if (firstProbe != completedProbes_ || endProbe > ProbeCount())
+	{
+		return;
+	}
+
+	const uint32_t tilesPerRow = width / TileSize;
+	const uint32_t texelCount = TileSize * TileSize;
+	const uint32_t valueCount = ValuesPerProbe();
+	std::vector<glm::vec3> radiances(texelCount);
+
+	for (uint32_t probe = firstProbe; probe != endProbe; ++probe)
+	{
+		const uint32_t tile = probe - firstProbe;
+		const uint32_t tileX = tile % tilesPerRow * TileSize;
+		const uint32_t tileY = tile / tilesPerRow * TileSize;
+
+		for (uint32_t i = 0; i != texelCount; ++i)
+		{
+			const size_t pixel = ((size_t(tileY) + i / TileSize) * width + tileX + i % TileSize) * 4;
+
+			radiances[i] = pixel + 3 < pixels.size()
+				? glm::vec3(pixels[pixel], pixels[pixel + 1], pixels[pixel + 2]) / std::max(pixels[pixel + 3], 1.0f)
+				: glm::vec3(0);
+		}
+
+		float* values = values_.data() + size_t(probe) * valueCount * 3;
+		std::fill_n(values, valueCount * 3, 0.0f);
+
+		if (encoding_ == Encoding::SphericalHarmonics)
+		{
+			// The radiance harmonics, convolved with the clamped cosine band by band.
+			const float bands[HarmonicsCount] = { Pi, 2 * Pi / 3, 2 * Pi / 3, 2 * Pi / 3, Pi / 4, Pi / 4, Pi / 4, Pi / 4, Pi / 4 };
+
+			for (uint32_t i = 0; i != texelCount; ++i)
+			{
+				float basis[HarmonicsCount];
+				EvaluateHarmonics(texelDirections_[i], basis);
+
+				for (uint32_t k = 0; k != HarmonicsCount; ++k)
+				{
+					const glm::vec3 value = radiances[i] * (basis[k] * texelSolidAngles_[i] * bands[k]);
+
+					values[k * 3 + 0] += value.r;
+					values[k * 3 + 1] += value.g;
+					values[k * 3 + 2] += value.b;
+				}
+			}
+		}
+		else
+		{
+			for (uint32_t j = 0; j != valueCount; ++j)
+			{
+				const glm::vec3 normal = TexelDirection(j % IrradianceSize, j / IrradianceSize, IrradianceSize);
+				glm::vec3 irradiance(0);
+
+				for (uint32_t i = 0; i != texelCount; ++i)
+				{
+					irradiance += radiances[i] * (std::max(glm::dot(normal, texelDirections_[i]), 0.0f) * texelSolidAngles_[i]);
+				}
+
+				values[j * 3 + 0] = irradiance.r;
+				values[j * 3 + 1] = irradiance.g;
+				values[j * 3 + 2] = irradiance.b;
+			}
+		}
+	}
+
+	completedProbes_ = endProbe;
+
+	Save();
+}
+
+ProbeBaker::Header ProbeBaker::MakeHeader() const
+{
+	Header header{};
+
+	std::memcpy(header.Magic, Magic, sizeof(Magic));
+	header.Version = Version;
+	header.Encoding = static_cast<uint32_t>(encoding_);
+	header.Grid[0] = grid_.x;
+	header.Grid[1] = grid_.y;
+	header.Grid[2] = grid_.z;
+	header.Samples = samples_;
+	header.BoundsMin[0] = boundsMin_.x;
+	header.BoundsMin[1] = boundsMin_.y;
+	header.BoundsMin[2] = boundsMin_.z;
+	header.BoundsMax[0] = boundsMax_.x;
+	header.BoundsMax[1] = boundsMax_.y;
+	header.BoundsMax[2] = boundsMax_.z;
+	header.CompletedProbes = completedProbes_;
+
+	return header;
+}
+
+uint32_t ProbeBaker::ValuesPerProbe() const
+{
+	return encoding_ == Encoding::SphericalHarmonics ? HarmonicsCount : IrradianceSize * IrradianceSize;
+}
+
+void ProbeBaker::Load()
+{
+	std::ifstream file(path_, std::ios::binary);
+
+	if (!file.is_open())
+	{
+		return;
+	}
+
+	Header header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+
+	// The progress aside, the header must be the one of this bake. Another bake is started over.
+	auto expected = MakeHeader();
+	expected.CompletedProbes = header.CompletedProbes;
+
+	if (!file ||
+		header.CompletedProbes > ProbeCount() ||
+		std::memcmp(&header, &expected, sizeof(Header)) != 0 ||
+		!file.read(reinterpret_cast<char*>(values_.data()), static_cast<std::streamsize>(values_.size() * sizeof(float))))
+	{
+		std::fill(values_.begin(), values_.end(), 0.0f);
+		std::cout << "Probes: '" << path_ << "' is another bake, starting over" << std::endl;
+		return;
+	}
+
+	completedProbes_ = header.CompletedProbes;
+
+	std::cout << "Probes: resuming '" << path_ << "' at " << completedProbes_ << "/" << ProbeCount() << std::endl;
+}
+
+void ProbeBaker::Save() const
+{
+	// Written aside then renamed over the previous one, a bake interrupted while saving keeps its last batch.
+	const std::string temporary = path_ + ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			Throw(std::runtime_error("cannot write the probes to '" + temporary + "'"));
+		}
+
+		const auto header = MakeHeader();
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		file.write(reinterpret_cast<const char*>(values_.data()), static_cast<std::streamsize>(values_.size() * sizeof(float)));
+
+		if (!file)
+		{
+			Throw(std::runtime_error("cannot write the probes to '" + temporary + "'"));
+		}
+	}
+
+	std::filesystem::rename(temporary, path_);
+}
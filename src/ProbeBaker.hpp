@@ -0,0 +1,77 @@
+#pragma once
+#include "Utilities/Glm.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The irradiance probes of a bake (see --bake-probes), a grid over the scene bounds with a probe at the centre of every cell.
+// The ray tracing pipeline traces a batch of probes per accumulation, each into a tile of TileSize^2 pixels of the traced image, one
+// octahedral texel of the sphere of directions around the probe per pixel. The radiance of the tiles is then projected into either
+// L2 spherical harmonics or a small octahedral map of irradiance per probe, and the file is rewritten after every batch, so that a bake
+// stopped halfway resumes from the probes it had done when run again with the same scene, grid, encoding and samples:
+//
+//   Header (see below), then for every probe, x first then y and z, its HarmonicsCount or IrradianceSize^2 RGB floats.
+//
+// The harmonics are those of the irradiance (the cosine lobe convolved radiance), evaluated with the real basis of "An Efficient
+// Representation for Irradiance Environment Maps" (Ramamoorthi and Hanrahan 2001). The octahedral maps are laid out as OctahedralEncode().
+class ProbeBaker final
+{
+public:
+
+	enum class Encoding : uint32_t
+	{
+		SphericalHarmonics = 0,
+		Octahedral = 1
+	};
+
+	static constexpr uint32_t TileSize = 16; // Matches RayTracing.rgen.
+	static constexpr uint32_t HarmonicsCount = 9;
+	static constexpr uint32_t IrradianceSize = 8;
+
+	ProbeBaker(const std::string& path, const glm::uvec3& grid, Encoding encoding, uint32_t samples, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	const glm::uvec3& Grid() const { return grid_; }
+	uint32_t ProbeCount() const { return grid_.x * grid_.y * grid_.z; }
+	uint32_t CompletedProbes() const { return completedProbes_; }
+
+	// The first probe position and the spacing between neighbouring ones.
+	glm::vec3 Origin() const { return boundsMin_ + Spacing() * 0.5f; }
+	glm::vec3 Spacing() const { return (boundsMax_ - boundsMin_) / glm::vec3(grid_); }
+
+	// The probes of a batch traced into an atlas of the given width, its accumulation sums (alpha being the sample count).
+	// Batches are only added in order, the file then holds all the probes up to the end of this one.
+	void AddBatch(uint32_t firstProbe, uint32_t endProbe, uint32_t width, const std::vector<float>& pixels);
+
+private:
+
+	struct Header final
+	{
+		char Magic[8];
+		uint32_t Version;
+		uint32_t Encoding;
+		uint32_t Grid[3];
+		uint32_t Samples;
+		float BoundsMin[3];
+		float BoundsMax[3];
+		uint32_t CompletedProbes;
+		uint32_t Reserved;
+	};
+
+	Header MakeHeader() const;
+	uint32_t ValuesPerProbe() const;
+	void Load();
+	void Save() const;
+
+	std::string path_;
+	glm::uvec3 grid_;
+	Encoding encoding_;
+	uint32_t samples_;
+	glm::vec3 boundsMin_;
+	glm::vec3 boundsMax_;
+	uint32_t completedProbes_{};
+	std::vector<float> values_; // All the probes, RGB.
+
+	// The direction and solid angle of every texel of a tile.
+	std::vector<glm::vec3> texelDirections_;
+	std::vector<float> texelSolidAngles_;
+};
@@ -1,16 +1,42 @@
 #include "RayTracer.hpp"
+#include "BenchmarkBaseline.hpp"
+#include "BenchmarkReport.hpp"
+#include "BenchmarkSweep.hpp"
+#include "CameraPath.hpp"
+#include "FrameStreamer.hpp"
+#include "ImageExporter.hpp"
+#include "MetricsExporter.hpp"
+#include "PowerMonitor.hpp"
+#include "ProbeBaker.hpp"
+#include "SceneFile.hpp"
 #include "UserInterface.hpp"
 #include "UserSettings.hpp"
 #include "Assets/Model.hpp"
 #include "Assets/Scene.hpp"
 #include "Assets/Texture.hpp"
 #include "Assets/UniformBuffer.hpp"
+#include "Utilities/Arena.hpp"
 #include "Utilities/Exception.hpp"
 #include "Utilities/Glm.hpp"
+#include "Utilities/Profiler.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include "Utilities/Trace.hpp"
 #include "Vulkan/Device.hpp"
+#include "Vulkan/FrameTimestamps.hpp"
+#include "Vulkan/GpuProfiler.hpp"
+#include "Vulkan/MemoryAllocator.hpp"
 #include "Vulkan/SwapChain.hpp"
+#include "Vulkan/Version.hpp"
 #include "Vulkan/Window.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <numeric>
 #include <sstream>
 
 namespace
@@ -21,43 +47,233 @@ namespace
 #else
 		true;
 #endif
+
+	// The bounce counts baked into the ray generation shader, larger ones read the uniform buffer.
+	const uint32_t MaxSpecializedBounces = 8;
+
+	// Keep one file per scene when benchmarking several of them.
+	std::string GetScenePath(const std::string& filename, const UserSettings& userSettings, const uint32_t sceneIndex)
+	{
+		std::filesystem::path path = filename;
+
+		if (userSettings.Benchmark && userSettings.BenchmarkNextScenes)
+		{
+			path.replace_filename(path.stem().string() + "-" + std::to_string(sceneIndex) + path.extension().string());
+		}
+
+		return path.string();
+	}
+
+	// The frame number goes before the extension, e.g. sequence.0042.png.
+	std::string GetSequencePath(const std::string& filename, const uint32_t frame)
+	{
+		std::filesystem::path path = filename;
+		std::ostringstream number;
+		number << std::setw(4) << std::setfill('0') << frame;
+
+		path.replace_filename(path.stem().string() + "." + number.str() + path.extension().string());
+
+		return path.string();
+	}
+
+	// Likewise the view number of a multi-view launch, e.g. image.view1.exr.
+	std::string GetViewPath(const std::string& filename, const uint32_t view)
+	{
+		std::filesystem::path path = filename;
+
+		path.replace_filename(path.stem().string() + ".view" + std::to_string(view) + path.extension().string());
+
+		return path.string();
+	}
 }
 
 RayTracer::RayTracer(const UserSettings& userSettings, const Vulkan::WindowConfig& windowConfig, const VkPresentModeKHR presentMode) :
 	Application(windowConfig, presentMode, EnableValidationLayers),
 	userSettings_(userSettings)
 {
+	SetCompactAccelerationStructures(userSettings.CompactAccelerationStructures);
+	mergeProcedurals_ = userSettings.MergeProcedurals;
+	cacheAccelerationStructures_ = userSettings.CacheAccelerationStructures;
+	hostBuildAccelerationStructures_ = userSettings.HostBuildAccelerationStructures;
+	// The levels of detail refit the TLAS as their instances switch models, unless geometry paging re-points the instances itself.
+	updatableAccelerationStructures_ = userSettings.AnimateInstances || userSettings.DeformVertices || (userSettings.LevelOfDetail && userSettings.GeometryBudget == 0);
+	deformVertices_ = userSettings.DeformVertices;
+	deformRebuildInterval_ = userSettings.DeformRebuildInterval;
+	geometryBudget_ = VkDeviceSize(userSettings.GeometryBudget) * 1024 * 1024;
+	buildPolicy_ = static_cast<Assets::BuildPolicy>(userSettings.BuildPolicy);
+	usePushConstants_ = userSettings.PushConstants;
+	hostVisibleShaderBindingTable_ = userSettings.HostVisibleShaderBindingTable;
+	asyncDenoise_ = userSettings.AsyncDenoise;
+	sampler_ = userSettings.Sampler;
+	launchOrder_ = userSettings.LaunchOrder;
+	maxFramesInFlight_ = userSettings.FramesInFlight;
+	lowLatency_ = userSettings.LowLatency;
+	useDynamicRendering_ = !userSettings.RenderPasses;
+	viewportHeight_ = static_cast<float>(windowConfig.Height) * userSettings.RenderScale;
+
+	imageExporter_.reset(new ImageExporter());
+
+	if (userSettings.StreamPort != 0)
+	{
+		frameStreamer_.reset(new FrameStreamer(static_cast<uint16_t>(userSettings.StreamPort), static_cast<int>(userSettings.StreamQuality)));
+	}
+
+	if (userSettings.MetricsPort != 0 || !userSettings.MetricsFile.empty())
+	{
+		metricsExporter_.reset(new MetricsExporter(static_cast<uint16_t>(userSettings.MetricsPort), userSettings.MetricsFile));
+	}
+
+	if (!userSettings.CameraPath.empty())
+	{
+		cameraPath_.reset(new CameraPath(CameraPath::Load(userSettings.CameraPath)));
+
+		std::cout << "Sequence: " << cameraPath_->FrameCount() << " frames at " << cameraPath_->FramesPerSecond() << " fps from '" << userSettings.CameraPath << "'" << std::endl;
+	}
+
+	if (userSettings.Benchmark && !userSettings.BenchmarkOutput.empty())
+	{
+		benchmarkReport_.reset(new BenchmarkReport(userSettings.BenchmarkOutput));
+	}
+
+	if (userSettings.Benchmark && !userSettings.BenchmarkBaseline.empty())
+	{
+		benchmarkBaseline_.reset(new BenchmarkBaseline(userSettings.BenchmarkBaseline, userSettings.RegressionThreshold / 100.0));
+	}
+
+	// The swap chain does not exist yet, the first point sets its extent.
+	if (userSettings.Benchmark && !userSettings.BenchmarkSweep.empty())
+	{
+		benchmarkSweep_.reset(new BenchmarkSweep(userSettings.BenchmarkSweep, userSettings.NumberOfSamples, userSettings.NumberOfBounces, userSettings.RenderScale, { windowConfig.Width, windowConfig.Height }, userSettings.CompactMaterials, userSettings.RegeneratePaths, userSettings.RadianceCache, userSettings.PathGuiding, userSettings.RayIsolation));
+		ApplySweepPoint(0);
+		SetHeadlessExtent(headlessExtent_);
+	}
+
 	CheckFramebufferSize();
 }
 
 RayTracer::~RayTracer()
 {
+	// A scene may still be loading in the background.
+	if (sceneLoad_.valid())
+	{
+		sceneLoad_.wait();
+	}
+
+	// The readback callbacks feed the exporter, which finishes writing the files before going away.
+	FlushAccumulationReadbacks();
+	imageExporter_.reset();
+	frameStreamer_.reset();
+	metricsExporter_.reset();
 	scene_.reset();
 }
 
+uint32_t RayTracer::BenchmarkRegressions()
+{
+	// The last records may still be waiting for their readback.
+	FlushAccumulationReadbacks();
+
+	return benchmarkBaseline_ ? benchmarkBaseline_->RegressionCount() : 0;
+}
+
 Assets::UniformBufferObject RayTracer::GetUniformBufferObject(const VkExtent2D extent) const
 {
 	const auto& init = cameraInitialSate_;
 
 	Assets::UniformBufferObject ubo = {};
 	ubo.ModelView = modelViewController_.ModelView();
-	ubo.Projection = glm::perspective(glm::radians(userSettings_.FieldOfView), extent.width / static_cast<float>(extent.height), 0.1f, 10000.0f);
+
+	const auto imageExtent = IsOfflineRender() ? OfflineExtent() : extent;
+
+	ubo.Projection = glm::perspective(glm::radians(userSettings_.FieldOfView), imageExtent.width / static_cast<float>(imageExtent.height), 0.1f, 10000.0f);
 	ubo.Projection[1][1] *= -1; // Inverting Y for Vulkan, https://matthewwellings.com/blog/the-new-vulkan-coordinate-system/
+
+	// An offline tile only covers its part of the image, its clip space is cropped to it.
+	if (IsOfflineRender())
+	{
+		const auto tile = RenderExtent();
+		const auto tileCount = OfflineTileCount();
+		const glm::vec2 imageSize(imageExtent.width, imageExtent.height);
+		const glm::vec2 tileOrigin(offlineTile_ % tileCount.width * tile.width, offlineTile_ / tileCount.width * tile.height);
+		const glm::vec2 tileSize = glm::vec2(tile.width, tile.height) / imageSize * 2.0f;
+		const glm::vec2 tileCenter = tileOrigin / imageSize * 2.0f - 1.0f + tileSize / 2.0f;
+		const glm::vec2 scale = 2.0f / tileSize;
+
+		ubo.Projection = glm::translate(glm::mat4(1), glm::vec3(-tileCenter * scale, 0)) * glm::scale(glm::mat4(1), glm::vec3(scale, 1)) * ubo.Projection;
+	}
+
 	ubo.ModelViewInverse = glm::inverse(ubo.ModelView);
 	ubo.ProjectionInverse = glm::inverse(ubo.Projection);
+	ubo.PreviousModelView = previousModelView_;
+	ubo.SceneSphere = sceneSphere_;
 	ubo.Aperture = userSettings_.Aperture;
 	ubo.FocusDistance = userSettings_.FocusDistance;
 	ubo.TotalNumberOfSamples = totalNumberOfSamples_;
 	ubo.NumberOfSamples = numberOfSamples_;
 	ubo.NumberOfBounces = userSettings_.NumberOfBounces;
-	ubo.RandomSeed = 1;
+	ubo.RussianRouletteDepth = userSettings_.RussianRouletteDepth;
+	ubo.LightSampling = userSettings_.LightSampling;
+	ubo.LightTree = userSettings_.LightTree;
+	ubo.LightCount = scene_->LightCount();
+	ubo.LightPower = scene_->LightPower();
+	ubo.ReprojectedSamples = reprojectAccumulation_ ? userSettings_.ReprojectedSamples : 0;
+	ubo.InterleavePattern = reprojectAccumulation_ ? userSettings_.Interleave : 0;
+	ubo.InterleaveFrame = interleaveFrame_;
+	ubo.Restir = restir_;
+	ubo.RestirFrame = restirFrame_;
+	ubo.RadianceCache = radianceCache_;
+	ubo.RadianceCacheFrame = radianceCacheFrame_;
+	ubo.PathGuiding = pathGuiding_;
+	ubo.ViewCount = wavefront_ ? 1 : viewCount_;
+
+	// The other views orbit the main camera about the vertical axis through its focus point.
+	const glm::vec3 focusPoint(ubo.ModelViewInverse * glm::vec4(0, 0, -userSettings_.FocusDistance, 1));
+
+	for (uint32_t view = 0; view != MaxViewCount; ++view)
+	{
+		const auto orbit = glm::rotate(glm::mat4(1), glm::radians(userSettings_.ViewOrbit * static_cast<float>(view)), glm::vec3(0, 1, 0));
+		ubo.ViewModelViewInverse[view] = glm::translate(glm::mat4(1), focusPoint) * orbit * glm::translate(glm::mat4(1), -focusPoint) * ubo.ModelViewInverse;
+	}
+
+	ubo.ProbeBake = probeBaker_ != nullptr;
+	ubo.ProbeOrigin = probeBaker_ ? glm::vec4(probeBaker_->Origin(), 0) : glm::vec4(0);
+	ubo.ProbeSpacing = probeBaker_ ? glm::vec4(probeBaker_->Spacing(), 0) : glm::vec4(0);
+	ubo.ProbeGrid = probeBaker_ ? glm::uvec4(probeBaker_->Grid(), ProbeTilesPerRow()) : glm::uvec4(1);
+	ubo.ProbeFirst = probeFirst_;
+	ubo.ProbeEnd = probeEnd_;
+	ubo.RayIsolation = userSettings_.RayIsolation;
+	ubo.SampleMap = FoveaRadius() > 0;
+	ubo.HalfAccumulationSamples = halfAccumulation_ ? HalfAccumulationSamples : 0;
+	ubo.RandomSeed = 1 + userSettings_.SampleStreamIndex;
 	ubo.HasSky = init.HasSky;
+	ubo.OpaqueDepth = init.OpaqueDepth;
 	ubo.ShowHeatmap = userSettings_.ShowHeatmap;
 	ubo.HeatmapScale = userSettings_.HeatmapScale;
+	ubo.HeatmapStage = static_cast<uint32_t>(userSettings_.HeatmapStage);
+	ubo.HeatmapBounce = static_cast<uint32_t>(userSettings_.HeatmapBounce);
+	ubo.SampleStreamIndex = userSettings_.SampleStreamIndex;
+	ubo.SampleStreamCount = userSettings_.SampleStreamCount;
+
+	// The per-frame fields are pushed instead, leaving the uniform buffer untouched while the camera is still.
+	if (usePushConstants_)
+	{
+		ubo.TotalNumberOfSamples = 0;
+		ubo.NumberOfSamples = 0;
+		ubo.RandomSeed = 0;
+	}
 
 	return ubo;
 }
 
+Assets::FrameConstants RayTracer::GetFrameConstants() const
+{
+	Assets::FrameConstants frameConstants = {};
+	frameConstants.TotalNumberOfSamples = totalNumberOfSamples_;
+	frameConstants.NumberOfSamples = numberOfSamples_;
+	frameConstants.RandomSeed = 1 + userSettings_.SampleStreamIndex;
+
+	return frameConstants;
+}
+
 void RayTracer::SetPhysicalDevice(
 	VkPhysicalDevice physicalDevice, 
 	std::vector<const char*>& requiredExtensions,
@@ -78,8 +294,16 @@ void RayTracer::SetPhysicalDevice(
 	shaderClockFeatures.shaderSubgroupClock = true;
 	
 	deviceFeatures.fillModeNonSolid = true;
+	deviceFeatures.geometryShader = true; // gl_PrimitiveID in the rasterizer fragment shader
 	deviceFeatures.samplerAnisotropy = true;
 	deviceFeatures.shaderInt64 = true;
+	deviceFeatures.shaderStorageImageReadWithoutFormat = true; // The accumulation image is either RGBA32F or RGBA16F.
+	deviceFeatures.shaderStorageImageWriteWithoutFormat = true;
+
+	// Block compressed textures are only used when the device can sample them.
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
 
 	Application::SetPhysicalDevice(physicalDevice, requiredExtensions, deviceFeatures, &shaderClockFeatures);
 }
@@ -88,15 +312,58 @@ void RayTracer::OnDeviceSet()
 {
 	Application::OnDeviceSet();
 
-	LoadScene(userSettings_.SceneIndex);
+	timestampSamples_.assign(MaxFramesInFlight(), 0);
+	timestampRows_.assign(MaxFramesInFlight(), 0);
+
+	if (userSettings_.InvocationReorder && !SupportsInvocationReorder())
+	{
+		std::cout << "- hit reordering is not supported by this device (VK_NV_ray_tracing_invocation_reorder), disabled" << std::endl;
+		userSettings_.InvocationReorder = false;
+	}
+
+	if (userSettings_.Wavefront && !SupportsRayQuery())
+	{
+		std::cout << "- the wavefront backend is not supported by this device (VK_KHR_ray_query), disabled" << std::endl;
+		userSettings_.Wavefront = false;
+	}
+
+	// The sensor is that of the device, matched by its UUID or its PCI identifiers.
+	if (userSettings_.Benchmark && userSettings_.MeasurePower)
+	{
+		VkPhysicalDeviceIDProperties idProperties = {};
+		idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 properties = {};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &idProperties;
+
+		vkGetPhysicalDeviceProperties2(Device().PhysicalDevice(), &properties);
+		powerMonitor_.reset(new PowerMonitor(properties.properties.vendorID, properties.properties.deviceID, idProperties.deviceUUID));
+	}
+
+	SetScene(LoadSceneAssets(userSettings_.SceneIndex, userSettings_.SceneFile, userSettings_.TessellatedSpheres));
 	CreateAccelerationStructures();
+	scene_->ReleaseHostGeometry();
+	PrintMemoryStatistics();
 }
 
 void RayTracer::CreateSwapChain()
 {
+	renderScale_ = userSettings_.RenderScale;
+	halfAccumulation_ = userSettings_.HalfAccumulation;
+	viewCount_ = std::clamp(userSettings_.Views, 1u, MaxViewCount);
+
 	Application::CreateSwapChain();
 
-	userInterface_.reset(new UserInterface(CommandPool(), SwapChain(), DepthBuffer(), userSettings_));
+	// The reservoir buffer is a new one.
+	restir_ = false;
+
+	// The UI is drawn on top of the swap chain images, there are none when headless.
+	if (!IsHeadless())
+	{
+		userInterface_.reset(new UserInterface(CommandPool(), SwapChain(), DepthBuffer(), DynamicRendering(), Window(), userSettings_));
+	}
+
 	resetAccumulation_ = true;
 
 	CheckFramebufferSize();
@@ -111,181 +378,1062 @@ void RayTracer::DeleteSwapChain()
 
 void RayTracer::DrawFrame()
 {
-	// Check if the scene has been changed by the user.
-	if (sceneIndex_ != static_cast<uint32_t>(userSettings_.SceneIndex))
+	// The input of a remote viewer goes through the same handlers as the window one, before the camera update.
+	if (frameStreamer_)
+	{
+		RouteStreamInput();
+	}
+
+	// Check if the scene (or how its spheres are built) has been changed by the user, the current one keeps rendering while the new one loads.
+	// Swapping it in recreates the swap chain, this frame is then skipped.
+	const bool isSceneChanged =
+		sceneIndex_ != static_cast<uint32_t>(userSettings_.SceneIndex) ||
+		(sceneIndex_ == SceneList::AllScenes.size() && sceneFile_ != userSettings_.SceneFile) ||
+		tessellatedSpheres_ != userSettings_.TessellatedSpheres;
+
+	if ((isSceneChanged || sceneLoad_.valid()) && UpdateSceneLoad())
+	{
+		return;
+	}
+
+	// The traced images are sized after the render scale, the accumulation format and the views, they are recreated with the swap chain.
+	// So are they when a benchmark sweep or a render job changes the headless resolution, the scene and its acceleration structures are kept.
+	const bool isExtentSwept = IsHeadless() && (benchmarkSweep_ || hasRenderJob_) && (headlessExtent_.width != Extent().width || headlessExtent_.height != Extent().height);
+
+	if (renderScale_ != userSettings_.RenderScale || halfAccumulation_ != userSettings_.HalfAccumulation || viewCount_ != std::clamp(userSettings_.Views, 1u, MaxViewCount) || isExtentSwept)
 	{
 		Device().WaitIdle();
 		DeleteSwapChain();
-		DeleteAccelerationStructures();
-		LoadScene(userSettings_.SceneIndex);
-		CreateAccelerationStructures();
+
+		if (isExtentSwept)
+		{
+			SetHeadlessExtent(headlessExtent_);
+		}
+
 		CreateSwapChain();
 		return;
 	}
 
+	// The next range of samples is only asked for once the sums of the previous one are out.
+	if (sampleRangeSource_ && (isAccumulationExported_ || !hasSampleRange_))
+	{
+		FlushAccumulationReadbacks();
+
+		uint32_t firstSample = 0;
+		uint32_t sampleCount = 0;
+
+		if (!sampleRangeSource_(firstSample, sampleCount))
+		{
+			Close();
+			return;
+		}
+
+		userSettings_.SampleStreamIndex = firstSample;
+		userSettings_.SampleStreamCount = 1;
+		userSettings_.MaxNumberOfSamples = sampleCount;
+		hasSampleRange_ = true;
+		resetAccumulation_ = true;
+	}
+
+	// The next job is only asked for once the image of the previous one is written. Its scene and extent are set up by the next frames.
+	if (renderJobSource_ && (!hasRenderJob_ || isRenderJobDone_))
+	{
+		if (hasRenderJob_)
+		{
+			FlushAccumulationReadbacks();
+			imageExporter_->Wait();
+			renderJobReport_(renderJob_, totalNumberOfSamples_, true);
+		}
+
+		if (!renderJobSource_(renderJob_))
+		{
+			Close();
+			return;
+		}
+
+		userSettings_.SceneIndex = static_cast<int>(renderJob_.SceneIndex);
+		userSettings_.SceneFile = renderJob_.SceneFile;
+		userSettings_.MaxNumberOfSamples = renderJob_.Samples;
+		userSettings_.HeadlessOutput = renderJob_.Output;
+		headlessExtent_ = renderJob_.Extent;
+		hasRenderJob_ = true;
+		isRenderJobDone_ = false;
+		resetAccumulation_ = true;
+		return;
+	}
+
 	// Check if the accumulation buffer needs to be reset.
 	if (resetAccumulation_ || 
+		isOfflineTileDone_ ||
+		isSequenceFrameDone_ ||
+		isProbeBatchDone_ ||
 		userSettings_.RequiresAccumulationReset(previousSettings_) || 
 		!userSettings_.AccumulateRays)
 	{
 		totalNumberOfSamples_ = 0;
 		resetAccumulation_ = false;
-	}
+		isAccumulationExported_ = false;
+		nextRow_ = 0;
 
-	previousSettings_ = userSettings_;
+		// A finished offline tile moves on to the next one. A new view or new settings start the whole image again,
+		// the other resets (e.g. streamed textures) only the current tile.
+		if (IsOfflineRender())
+		{
+			const bool restart = isOfflineRestarted_ || !offlineSums_ || userSettings_.RequiresAccumulationReset(previousSettings_);
 
-	// Keep track of our sample count.
-	numberOfSamples_ = glm::clamp(userSettings_.MaxNumberOfSamples - totalNumberOfSamples_, 0u, userSettings_.NumberOfSamples);
-	totalNumberOfSamples_ += numberOfSamples_;
+			offlineTile_ = restart ? 0 : offlineTile_ + (isOfflineTileDone_ ? 1 : 0);
+			isOfflineTileDone_ = false;
+			isOfflineRestarted_ = false;
 
-	Application::DrawFrame();
-}
+			if (restart)
+			{
+				offlineSums_ = std::make_shared<std::vector<float>>(size_t(OfflineExtent().width) * OfflineExtent().height * 4);
+			}
+		}
 
-void RayTracer::Render(VkCommandBuffer commandBuffer, const uint32_t imageIndex)
-{
-	// Record delta time between calls to Render.
-	const auto prevTime = time_;
-	time_ = Window().GetTime();
-	const auto timeDelta = time_ - prevTime;
+		// A finished frame of the sequence moves the camera along its path, the other resets trace the current frame again.
+		if (cameraPath_)
+		{
+			sequenceFrame_ += isSequenceFrameDone_ ? 1 : 0;
+			isSequenceFrameDone_ = false;
 
-	// Update the camera position / angle.
-	resetAccumulation_ = modelViewController_.UpdateCamera(cameraInitialSate_.ControlSpeed, timeDelta);
+			const auto key = cameraPath_->Sample(sequenceFrame_);
 
-	// Check the current state of the benchmark, update it for the new frame.
-	CheckAndUpdateBenchmarkState(prevTime);
+			modelViewController_.Reset(key.ModelView());
+			userSettings_.FieldOfView = key.FieldOfView;
+			userSettings_.Aperture = key.Aperture;
+			userSettings_.FocusDistance = key.FocusDistance;
+		}
 
-	// Render the scene
-	userSettings_.IsRayTraced
-		? Vulkan::RayTracing::Application::Render(commandBuffer, imageIndex)
-		: Vulkan::Application::Render(commandBuffer, imageIndex);
+		// The first accumulation of a render resumes its checkpoint, the sums and the sample sequence carrying on where they were.
+		if (!userSettings_.Checkpoint.empty() && !isCheckpointRead_)
+		{
+			std::vector<float> pixels;
+			uint32_t samples = 0;
 
-	// Render the UI
-	Statistics stats = {};
-	stats.FramebufferSize = Window().FramebufferSize();
-	stats.FrameRate = static_cast<float>(1 / timeDelta);
+			if (ImageExporter::ReadCheckpoint(userSettings_.Checkpoint, RenderExtent(), CheckpointSignature(), samples, pixels))
+			{
+				UploadAccumulation(std::move(pixels));
+				totalNumberOfSamples_ = samples;
+			}
 
-	if (userSettings_.IsRayTraced)
+			isCheckpointRead_ = true;
+			checkpointTime_ = Time();
+		}
+
+		// A render job has its own camera, or the one of its scene.
+		if (hasRenderJob_)
+		{
+			const auto& job = renderJob_;
+
+			modelViewController_.Reset(job.HasCamera ? glm::lookAt(job.Eye, job.Target, job.Up) : cameraInitialSate_.ModelView);
+			userSettings_.FieldOfView = job.FieldOfView.value_or(cameraInitialSate_.FieldOfView);
+			userSettings_.Aperture = job.Aperture.value_or(cameraInitialSate_.Aperture);
+			userSettings_.FocusDistance = job.FocusDistance.value_or(cameraInitialSate_.FocusDistance);
+		}
+
+		// A finished batch of probes moves on to the next one, sized after the traced image.
+		if (probeBaker_)
+		{
+			probeFirst_ = isProbeBatchDone_ ? probeEnd_ : probeFirst_;
+			probeEnd_ = std::min(probeFirst_ + ProbeTilesPerRow() * (RenderExtent().height / ProbeBaker::TileSize), probeBaker_->ProbeCount());
+			isProbeBatchDone_ = false;
+		}
+	}
+
+	// The cached radiance and the guiding lobes depend on most of the settings resetting the accumulation, they start over with them.
+	if (userSettings_.RequiresAccumulationReset(previousSettings_))
 	{
-		const auto extent = SwapChain().Extent();
+		resetRadianceCache_ = true;
+		resetPathGuiding_ = true;
+	}
 
-		stats.RayRate = static_cast<float>(
-			double(extent.width*extent.height)*numberOfSamples_
-			/ (timeDelta * 1000000000));
+	previousSettings_ = userSettings_;
 
-		stats.TotalSamples = totalNumberOfSamples_;
+	// Keep track of our sample count. Under a frame budget, the bands of an image all trace the same samples.
+	if (nextRow_ == 0)
+	{
+		numberOfSamples_ = glm::clamp(userSettings_.MaxNumberOfSamples - totalNumberOfSamples_, 0u, SamplesPerFrame());
+		totalNumberOfSamples_ += numberOfSamples_;
 	}
 
-	userInterface_->Render(commandBuffer, SwapChainFrameBuffer(imageIndex), stats);
-}
+	if (hasRenderJob_ && !isRenderJobDone_)
+	{
+		renderJobReport_(renderJob_, totalNumberOfSamples_, false);
+	}
 
-void RayTracer::OnKey(int key, int scancode, int action, int mods)
-{
-	if (userInterface_->WantsToCaptureKeyboard())
+	// Save the progress of a long render now and then, from a readback of this frame written by the exporter thread.
+	if (!userSettings_.Checkpoint.empty() && numberOfSamples_ != 0 && Time() - checkpointTime_ >= userSettings_.CheckpointInterval)
 	{
-		return;
+		SaveCheckpoint();
 	}
 
-	if (action == GLFW_PRESS)
-	{		
-		switch (key)
+	// Export the accumulated image once all the samples are in, it is the only output when headless.
+	const auto& exportPath = IsHeadless() ? userSettings_.HeadlessOutput : userSettings_.ExportOutput;
+
+	if (probeBaker_)
+	{
+		if (numberOfSamples_ == 0 && !isAccumulationExported_)
 		{
-		case GLFW_KEY_ESCAPE: Window().Close(); break;
-		default: break;
-		}
+			ReadProbeBatch();
+			isAccumulationExported_ = true;
 
-		// Settings (toggle switches)
-		if (!userSettings_.Benchmark)
+			if (IsHeadless() && !isProbeBatchDone_)
+			{
+				Close();
+			}
+		}
+	}
+	else if (cameraPath_)
+	{
+		if (numberOfSamples_ == 0 && !isAccumulationExported_)
 		{
-			switch (key)
+			ExportSequenceFrame(exportPath);
+			isAccumulationExported_ = true;
+
+			if (IsHeadless() && !isSequenceFrameDone_)
 			{
-			case GLFW_KEY_F1: userSettings_.ShowSettings = !userSettings_.ShowSettings; break;
-			case GLFW_KEY_F2: userSettings_.ShowOverlay = !userSettings_.ShowOverlay; break;
-			case GLFW_KEY_R: userSettings_.IsRayTraced = !userSettings_.IsRayTraced; break;
-			case GLFW_KEY_H: userSettings_.ShowHeatmap = !userSettings_.ShowHeatmap; break;
-			case GLFW_KEY_P: isWireFrame_ = !isWireFrame_; break;
-			default: break;
+				Close();
 			}
 		}
 	}
+	else if (IsOfflineRender())
+	{
+		if (numberOfSamples_ == 0 && !isAccumulationExported_)
+		{
+			ReadOfflineTile(exportPath);
+			isAccumulationExported_ = true;
 
-	// Camera motions
-	if (!userSettings_.Benchmark)
+			if (IsHeadless() && !isOfflineTileDone_)
+			{
+				Close();
+			}
+		}
+	}
+	else if (numberOfSamples_ == 0 && !isAccumulationExported_ && !exportPath.empty())
 	{
-		resetAccumulation_ |= modelViewController_.OnKey(key, scancode, action, mods);
+		exportPaths_.push_back(GetScenePath(exportPath, userSettings_, sceneIndex_));
+		isAccumulationExported_ = true;
+		isRenderJobDone_ = hasRenderJob_;
+
+		// The last checkpoint has all the samples, a higher sample limit carries on from it.
+		if (!userSettings_.Checkpoint.empty())
+		{
+			SaveCheckpoint();
+		}
+
+		// The readback completes while shutting down. The benchmark decides by itself whether to move on to the next scene.
+		// A streamed headless render keeps going, the viewer may still move the camera. So does a render queue, with its next job.
+		if (IsHeadless() && !userSettings_.Benchmark && !sampleRangeSource_ && !renderJobSource_ && !frameStreamer_)
+		{
+			Close();
+		}
 	}
-}
 
-void RayTracer::OnCursorPosition(const double xpos, const double ypos)
-{
-	if (!HasSwapChain() ||
-		userSettings_.Benchmark ||
-		userInterface_->WantsToCaptureKeyboard() || 
-		userInterface_->WantsToCaptureMouse())
+	if (isScreenshotRequested_)
 	{
-		return;
+		const auto name = "../screenshots/scene" + std::to_string(sceneIndex_) + "-" + std::to_string(totalNumberOfSamples_) + "spp";
+		exportPaths_.push_back(name + ".png");
+		exportPaths_.push_back(name + ".exr");
+		isScreenshotRequested_ = false;
 	}
 
-	// Camera motions
-	resetAccumulation_ |= modelViewController_.OnCursorPosition(xpos, ypos);
-}
+	if (!exportPaths_.empty())
+	{
+		ExportAccumulation();
+	}
 
-void RayTracer::OnMouseButton(const int button, const int action, const int mods)
-{
-	if (!HasSwapChain() || 
-		userSettings_.Benchmark ||
-		userInterface_->WantsToCaptureMouse())
+	// Only read back once the streamer is done with the previous frame, the slower viewers get fewer of them.
+	if (frameStreamer_ && frameStreamer_->IsReady())
 	{
-		return;
+		RequestOutputReadback([this](const VkExtent2D extent, std::vector<uint8_t>&& pixels) { frameStreamer_->Send(extent, std::move(pixels)); });
 	}
 
-	// Camera motions
-	resetAccumulation_ |= modelViewController_.OnMouseButton(button, action, mods);
+	Application::DrawFrame();
 }
 
-void RayTracer::OnScroll(const double xoffset, const double yoffset)
+void RayTracer::Render(VkCommandBuffer commandBuffer, const uint32_t imageIndex)
 {
-	if (!HasSwapChain() ||
-		userSettings_.Benchmark ||
-		userInterface_->WantsToCaptureMouse())
-	{
-		return;
-	}
+	// Record delta time between calls to Render.
+	// A converged frame may follow an idle wait, its held keys reset the accumulation without moving the camera by the whole wait.
+	const auto prevTime = time_;
+	time_ = Time();
+	const auto timeDelta = numberOfSamples_ != 0 ? time_ - prevTime : 0.0;
 
-	const auto prevFov = userSettings_.FieldOfView;
-	userSettings_.FieldOfView = std::clamp(
-		static_cast<float>(prevFov - yoffset),
-		UserSettings::FieldOfViewMinValue,
-		UserSettings::FieldOfViewMaxValue);
+	// Read back the GPU timings of the previous use of this frame slot, and start measuring the new one.
+	auto& timestamps = FrameTimestamps();
+	const auto frameIndex = static_cast<uint32_t>(CurrentFrame());
+	const auto measuredSamples = timestampSamples_[frameIndex];
+	const auto measuredRows = timestampRows_[frameIndex];
 
-	resetAccumulation_ = prevFov != userSettings_.FieldOfView;
-}
+	timestamps.BeginFrame(commandBuffer, frameIndex);
+	timestampSamples_[frameIndex] = userSettings_.IsRayTraced ? numberOfSamples_ : 0;
 
-void RayTracer::LoadScene(const uint32_t sceneIndex)
-{
-	auto [models, textures] = SceneList::AllScenes[sceneIndex].second(cameraInitialSate_);
+	// Pick the band of rows traced by this frame from the time the last one of this slot took.
+	UpdateTraceRows(measuredSamples != 0 ? measuredRows : 0, timestamps.Milliseconds(TraceTimestampPass));
+	timestampRows_[frameIndex] = traceRowCount_ != 0 ? traceRowCount_ : RenderExtent().height;
 
-	// If there are no texture, add a dummy one. It makes the pipeline setup a lot easier.
-	if (textures.empty())
-	{
-		textures.push_back(Assets::Texture::LoadTexture("../assets/textures/white.png", Vulkan::SamplerConfig()));
-	}
-	
-	scene_.reset(new Assets::Scene(CommandPool(), std::move(models), std::move(textures)));
-	sceneIndex_ = sceneIndex;
+	// Or the samples traced by the next frame, the accumulation weighs every frame by its own sample count.
+	UpdateBudgetSamples(measuredSamples, timestamps.Milliseconds(TraceTimestampPass));
 
-	userSettings_.FieldOfView = cameraInitialSate_.FieldOfView;
-	userSettings_.Aperture = cameraInitialSate_.Aperture;
-	userSettings_.FocusDistance = cameraInitialSate_.FocusDistance;
+	// Update the camera position / angle.
+	const auto previousModelView = modelViewController_.ModelView();
+	const bool isCameraMoved = modelViewController_.UpdateCamera(cameraInitialSate_.ControlSpeed, timeDelta);
 
-	modelViewController_.Reset(cameraInitialSate_.ModelView);
+	// Rather than being reset, a valid accumulation can be reprojected into the new view. The sample count restarts, the pixels keep theirs.
+	// The other views of a multi-view launch have no history to reproject from.
+	reprojectAccumulation_ =
+		isCameraMoved &&
+		userSettings_.ReprojectedSamples != 0 &&
+		viewCount_ == 1 &&
+		!probeBaker_ &&
+		userSettings_.IsRayTraced &&
+		!(userSettings_.Wavefront && SupportsRayQuery()) &&
+		!IsFrameBudgeted() &&
+		!IsOfflineRender() &&
+		totalNumberOfSamples_ != numberOfSamples_;
 
-	periodTotalFrames_ = 0;
-	resetAccumulation_ = true;
-}
+	resetAccumulation_ = isCameraMoved && !reprojectAccumulation_;
+	isOfflineRestarted_ |= isCameraMoved;
 
-void RayTracer::CheckAndUpdateBenchmarkState(double prevTime)
-{
-	if (!userSettings_.Benchmark)
+	if (reprojectAccumulation_)
+	{
+		previousModelView_ = previousModelView;
+		numberOfSamples_ = std::min(SamplesPerFrame(), userSettings_.MaxNumberOfSamples);
+		totalNumberOfSamples_ = numberOfSamples_;
+		timestampSamples_[frameIndex] = numberOfSamples_;
+		isAccumulationExported_ = false;
+		++interleaveFrame_;
+	}
+
+	// The reservoirs are reprojected whether or not the accumulation is.
+	if (userSettings_.Restir)
+	{
+		previousModelView_ = previousModelView;
+	}
+
+	// Stream the textures sampled by the last frame of this slot. The rasterizer does not report them, it gets all of them.
+	const auto textureGeneration = scene_->TextureGeneration();
+	textureRequests_.clear();
+
+	if (userSettings_.IsRayTraced)
+	{
+		ReadTextureRequests(textureRequests_);
+		ReadStageClocks(frameStageClocks_);
+		ReadRayCounters(frameRayCounters_);
+
+		if (IsBenchmarkMeasured())
+		{
+			sceneRayCounters_.resize(frameRayCounters_.size());
+			std::transform(frameRayCounters_.begin(), frameRayCounters_.end(), sceneRayCounters_.begin(), sceneRayCounters_.begin(), std::plus<uint64_t>());
+		}
+
+		if (IsBenchmarkMeasured() && userSettings_.ProfileStages)
+		{
+			sceneStageClocks_.resize(frameStageClocks_.size());
+			std::transform(frameStageClocks_.begin(), frameStageClocks_.end(), sceneStageClocks_.begin(), sceneStageClocks_.begin(), std::plus<uint64_t>());
+		}
+	}
+
+	scene_->UpdateTextures(StagingRing(), TaskSystem(), textureRequests_, MaxFramesInFlight());
+	resetAccumulation_ |= scene_->TextureGeneration() != textureGeneration;
+
+	// Check the current state of the benchmark, update it for the new frame.
+	CheckAndUpdateBenchmarkState(prevTime);
+
+	// Deform the models in place, their BLAS and the TLAS are refitted rather than rebuilt.
+	if (userSettings_.DeformVertices && userSettings_.IsRayTraced)
+	{
+		resetAccumulation_ |= UpdateDeformedStructures(commandBuffer, time_);
+	}
+
+	// Switch the instances to the levels of detail of the new camera, for the rasterizer as well.
+	UpdateLevelsOfDetail(commandBuffer);
+
+	// Move the instances around, the TLAS is refitted rather than rebuilt.
+	if (userSettings_.AnimateInstances && userSettings_.IsRayTraced)
+	{
+		AnimateInstances(commandBuffer);
+	}
+
+	// Page the BLAS of the models nearest the camera in, the others are traced through their proxy meanwhile.
+	if (userSettings_.GeometryBudget != 0 && userSettings_.IsRayTraced)
+	{
+		const glm::vec3 eye(glm::inverse(modelViewController_.ModelView())[3]);
+		resetAccumulation_ |= UpdateGeometryPaging(commandBuffer, eye);
+	}
+
+	// Adaptive sampling needs a few samples everywhere before the variance estimates mean anything.
+	UpdateTileSampling();
+
+	// Foveated sampling, the variance of the accumulated samples only weighs in once there are some.
+	foveaRadius_ = FoveaRadius();
+	foveaMinFraction_ = userSettings_.FoveaMinFraction;
+	gaze_ = glm::vec2(userSettings_.GazeX, userSettings_.GazeY);
+	sampleMapVariance_ = totalNumberOfSamples_ != numberOfSamples_;
+
+	// The heatmap is not an image to filter.
+	denoiseIterations_ = userSettings_.ShowHeatmap ? 0 : userSettings_.DenoiseIterations;
+
+	// The ray tracing pipeline variant, only small bounce counts get their own so that the slider does not compile dozens of them.
+	showHeatmap_ = userSettings_.ShowHeatmap;
+	profileStages_ = userSettings_.ProfileStages;
+	hasSky_ = cameraInitialSate_.HasSky;
+	compactMaterials_ = userSettings_.CompactMaterials;
+	regeneratePaths_ = userSettings_.RegeneratePaths;
+	specializedBounces_ = userSettings_.NumberOfBounces <= MaxSpecializedBounces ? userSettings_.NumberOfBounces : 0;
+	invocationReorder_ = userSettings_.InvocationReorder;
+	wavefront_ = userSettings_.Wavefront && SupportsRayQuery();
+	hybrid_ = wavefront_ && userSettings_.Hybrid;
+
+	// The reservoirs of the previous frame are only reused if it resampled the lights as well.
+	// The reservoirs, the cache cells and the guiding lobes are those of the camera view, a probe bake goes without them.
+	const bool restir = userSettings_.Restir && userSettings_.LightSampling && userSettings_.IsRayTraced && !wavefront_ && !probeBaker_;
+	restirFrame_ = restir && restir_ ? restirFrame_ + 1 : 0;
+	restir_ = restir;
+	radianceCache_ = userSettings_.RadianceCache && userSettings_.IsRayTraced && !wavefront_ && !probeBaker_;
+	radianceCacheFrame_ += radianceCache_ ? 1 : 0;
+	pathGuiding_ = userSettings_.PathGuiding && userSettings_.IsRayTraced && !wavefront_ && !probeBaker_;
+	numberOfBounces_ = userSettings_.NumberOfBounces;
+
+	// Render the scene
+	userSettings_.IsRayTraced
+		? Vulkan::RayTracing::Application::Render(commandBuffer, imageIndex)
+		: Vulkan::Application::Render(commandBuffer, imageIndex);
+
+	// The samples traced with the previous variant are discarded once the new one is in.
+	resetAccumulation_ |= IsPipelineVariantPending();
+
+	if (IsBenchmarkMeasured() && measuredSamples != 0 && timestamps.Milliseconds(TraceTimestampPass) > 0)
+	{
+		sceneTraceTimes_.push_back(timestamps.Milliseconds(TraceTimestampPass));
+	}
+
+	// Nothing is drawn over the frame, the UI pass and its statistics are skipped altogether unless exported.
+	const bool isUserInterfaceDrawn = !IsHeadless() && userInterface_->IsVisible();
+
+	if (!isUserInterfaceDrawn && !metricsExporter_)
+	{
+		return;
+	}
+
+	// Render the UI
+	Statistics stats = {};
+	stats.FramebufferSize = IsHeadless() ? Extent() : Window().FramebufferSize();
+	stats.FrameRate = static_cast<float>(1 / timeDelta);
+	stats.TraceTime = static_cast<float>(timestamps.Milliseconds(TraceTimestampPass));
+	stats.DenoiseTime = static_cast<float>(DenoiseTime());
+	stats.DenoiseOverlapTime = static_cast<float>(DenoiseOverlapTime());
+	stats.CopyTime = static_cast<float>(timestamps.Milliseconds(CopyTimestampPass));
+	stats.UserInterfaceTime = static_cast<float>(timestamps.Milliseconds(UserInterfaceTimestampPass));
+	stats.Latency = static_cast<float>(Latency());
+	stats.FrameTime = static_cast<float>(timeDelta * 1000);
+	stats.PresentWaitTime = static_cast<float>(PresentWaitTime());
+	stats.TopLevelBuildTime = static_cast<float>(TopLevelBuildTime());
+	stats.BuildTime = static_cast<float>(AccelerationStructureBuildTime());
+
+	const auto paging = GeometryPagingStatistics();
+	stats.GeometryPages = paging.PageCount;
+	stats.ResidentPages = paging.ResidentPages;
+	stats.PagePoolSize = paging.PoolSize;
+	stats.PagePoolUsage = paging.UsedSize;
+	stats.PageIns = paging.PageIns;
+	stats.PageEvictions = paging.Evictions;
+	stats.StreamRoundTrip = -1;
+
+	if (frameStreamer_)
+	{
+		const auto streaming = frameStreamer_->GetStatistics();
+		stats.IsStreaming = streaming.IsConnected;
+		stats.StreamFrameRate = streaming.FrameRate;
+		stats.StreamBitRate = streaming.BitRate;
+		stats.StreamEncodeTime = streaming.EncodeTime;
+		stats.StreamRoundTrip = streaming.RoundTrip;
+	}
+
+	// The stage shares of the frame, summed over the bounces.
+	if (userSettings_.IsRayTraced && std::any_of(frameStageClocks_.begin(), frameStageClocks_.end(), [](const uint64_t clocks) { return clocks != 0; }))
+	{
+		stats.StageClocks.assign(ProfileStageCount, 0);
+
+		for (size_t i = 0; i != frameStageClocks_.size(); ++i)
+		{
+			stats.StageClocks[i / ProfileBounceCount] += frameStageClocks_[i];
+		}
+	}
+	stats.HeapBudgets = Device().Allocator().GetHeapBudgets();
+	stats.MemoryCategories = Device().Allocator().GetCategoryBytes();
+
+	stats.TotalRayRate = -1;
+
+	if (userSettings_.IsRayTraced)
+	{
+		const auto extent = RenderExtent();
+
+		// The rays counted by the frame of this slot, over the same trace time as the timestamps.
+		if (!frameRayCounters_.empty() && frameRayCounters_[RayCounterTraceCalls] != 0)
+		{
+			stats.RayCounters = frameRayCounters_;
+			stats.TotalRayRate = timestamps.Milliseconds(TraceTimestampPass) > 0
+				? static_cast<float>(double(frameRayCounters_[RayCounterTraceCalls]) / (timestamps.Milliseconds(TraceTimestampPass) * 1000000))
+				: static_cast<float>(double(frameRayCounters_[RayCounterTraceCalls]) / (timeDelta * 1000000000));
+		}
+
+		// Prefer the measured trace time, the frame time also includes the UI, the copy and presentation.
+		stats.RayRate = timestamps.Milliseconds(TraceTimestampPass) > 0 && measuredSamples != 0
+			? static_cast<float>(double(extent.width*measuredRows)*measuredSamples / (timestamps.Milliseconds(TraceTimestampPass) * 1000000))
+			: static_cast<float>(double(extent.width*timestampRows_[frameIndex])*numberOfSamples_ / (timeDelta * 1000000000));
+
+		stats.TotalSamples = totalNumberOfSamples_;
+	}
+
+	if (metricsExporter_)
+	{
+		PushMetrics(stats);
+	}
+
+	if (!isUserInterfaceDrawn)
+	{
+		return;
+	}
+
+	PROFILE_GPU_ZONE(GpuProfiler(), commandBuffer, "UserInterface");
+	timestamps.BeginPass(commandBuffer, UserInterfaceTimestampPass);
+	userInterface_->Render(commandBuffer, imageIndex, DynamicRendering() ? nullptr : &SwapChainFrameBuffer(imageIndex), stats);
+	timestamps.EndPass(commandBuffer, UserInterfaceTimestampPass);
+}
+
+void RayTracer::OnKey(int key, int scancode, int action, int mods)
+{
+	if (userInterface_->WantsToCaptureKeyboard())
+	{
+		return;
+	}
+
+	if (action == GLFW_PRESS)
+	{		
+		switch (key)
+		{
+		case GLFW_KEY_ESCAPE: Window().Close(); break;
+		default: break;
+		}
+
+		// Settings (toggle switches)
+		if (!userSettings_.Benchmark)
+		{
+			switch (key)
+			{
+			case GLFW_KEY_F1: userSettings_.ShowSettings = !userSettings_.ShowSettings; break;
+			case GLFW_KEY_F2: userSettings_.ShowOverlay = !userSettings_.ShowOverlay; break;
+			case GLFW_KEY_F3: userSettings_.ShowPerformance = !userSettings_.ShowPerformance; break;
+			case GLFW_KEY_R: userSettings_.IsRayTraced = !userSettings_.IsRayTraced; break;
+			case GLFW_KEY_H: userSettings_.ShowHeatmap = !userSettings_.ShowHeatmap; break;
+			case GLFW_KEY_P: isWireFrame_ = !isWireFrame_; break;
+			case GLFW_KEY_F12: isScreenshotRequested_ = true; break;
+			default: break;
+			}
+		}
+	}
+
+	// Camera motions, unless it follows a path or probes are baked.
+	if (!userSettings_.Benchmark && !cameraPath_ && !probeBaker_)
+	{
+		const bool isCameraMoved = modelViewController_.OnKey(key, scancode, action, mods);
+		resetAccumulation_ |= isCameraMoved && userSettings_.ReprojectedSamples == 0;
+		isOfflineRestarted_ |= isCameraMoved;
+	}
+}
+
+void RayTracer::OnCursorPosition(const double xpos, const double ypos)
+{
+	if (!HasSwapChain() ||
+		userSettings_.Benchmark ||
+		cameraPath_ ||
+		probeBaker_ ||
+		userInterface_->WantsToCaptureKeyboard() || 
+		userInterface_->WantsToCaptureMouse())
+	{
+		return;
+	}
+
+	// Camera motions
+	const bool isCameraMoved = modelViewController_.OnCursorPosition(xpos, ypos);
+	resetAccumulation_ |= isCameraMoved && userSettings_.ReprojectedSamples == 0;
+	isOfflineRestarted_ |= isCameraMoved;
+}
+
+void RayTracer::OnMouseButton(const int button, const int action, const int mods)
+{
+	if (!HasSwapChain() || 
+		userSettings_.Benchmark ||
+		cameraPath_ ||
+		probeBaker_ ||
+		userInterface_->WantsToCaptureMouse())
+	{
+		return;
+	}
+
+	// Camera motions
+	const bool isCameraMoved = modelViewController_.OnMouseButton(button, action, mods);
+	resetAccumulation_ |= isCameraMoved && userSettings_.ReprojectedSamples == 0;
+	isOfflineRestarted_ |= isCameraMoved;
+}
+
+void RayTracer::OnScroll(const double xoffset, const double yoffset)
+{
+	if (!HasSwapChain() ||
+		userSettings_.Benchmark ||
+		cameraPath_ ||
+		probeBaker_ ||
+		userInterface_->WantsToCaptureMouse())
+	{
+		return;
+	}
+
+	const auto prevFov = userSettings_.FieldOfView;
+	userSettings_.FieldOfView = std::clamp(
+		static_cast<float>(prevFov - yoffset),
+		UserSettings::FieldOfViewMinValue,
+		UserSettings::FieldOfViewMaxValue);
+
+	resetAccumulation_ = prevFov != userSettings_.FieldOfView;
+}
+
+void RayTracer::OnInputEvent(const Vulkan::Window::InputEvent& event)
+{
+	// The user interface sees the events first, as with the callbacks it installs without a render thread.
+	if (userInterface_)
+	{
+		userInterface_->OnInputEvent(event);
+	}
+}
+
+RayTracer::LoadedScene RayTracer::LoadSceneAssets(const uint32_t sceneIndex, const std::string& sceneFile, const bool tessellatedSpheres) const
+{
+	const Utilities::TraceScope trace("LoadSceneAssets");
+	PROFILE_ZONE("LoadSceneAssets");
+	const auto loadStart = std::chrono::high_resolution_clock::now();
+
+	// The scene factory spreads the model parsing and texture decoding over the task system, everything is joined on return.
+	const double busyStart = TaskSystem().BusyTime();
+
+	LoadedScene loaded{};
+	loaded.Index = sceneIndex;
+	loaded.File = sceneFile;
+	loaded.TessellatedSpheres = tessellatedSpheres;
+	loaded.Assets = sceneIndex == SceneList::AllScenes.size()
+		? SceneFile::Load(sceneFile, loaded.Camera, SceneList::SceneOptions{tessellatedSpheres, userSettings_.GpuNormals}, TaskSystem())
+		: SceneList::AllScenes[sceneIndex].second(loaded.Camera, SceneList::SceneOptions{tessellatedSpheres, userSettings_.GpuNormals}, TaskSystem());
+
+	if (userSettings_.LevelOfDetail)
+	{
+		// Geometry paging keeps the first selection, it rebuilds the TLAS over its own instances.
+		SceneList::SelectLevelsOfDetail(loaded.Assets, loaded.Camera, viewportHeight_, userSettings_.GeometryBudget == 0 ? &loaded.LevelsOfDetail : nullptr);
+	}
+
+	if (!userSettings_.Environment.empty())
+	{
+		loaded.Environment.reset(new Assets::Environment(Assets::Environment::Load(userSettings_.Environment, userSettings_.EnvironmentIntensity, TaskSystem())));
+	}
+
+	auto& textures = std::get<1>(loaded.Assets);
+
+	// If there are no texture, add a dummy one. It makes the pipeline setup a lot easier.
+	if (textures.empty())
+	{
+		textures.push_back(Assets::Texture::LoadTexture("../assets/textures/white.png", Vulkan::SamplerConfig()));
+	}
+
+	const auto assetsElapsed = std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - loadStart).count();
+	const double busyElapsed = TaskSystem().BusyTime() - busyStart;
+
+	std::ostringstream out;
+	out << "- loaded scene assets in " << assetsElapsed << "s (" << busyElapsed << "s of loading tasks on " << TaskSystem().ThreadCount() << " threads)" << std::endl;
+	std::cout << out.str() << std::flush;
+
+	loaded.LoadTime = assetsElapsed;
+
+	return loaded;
+}
+
+bool RayTracer::UpdateSceneLoad()
+{
+	const auto sceneIndex = static_cast<uint32_t>(userSettings_.SceneIndex);
+	const auto sceneFile = userSettings_.SceneFile;
+	const bool tessellatedSpheres = userSettings_.TessellatedSpheres;
+
+	// Parse and decode the new scene on a background thread. Not one of the task system threads, the factory waits on those.
+	if (!sceneLoad_.valid())
+	{
+		sceneLoad_ = std::async(std::launch::async, [this, sceneIndex, sceneFile, tessellatedSpheres]() { return LoadSceneAssets(sceneIndex, sceneFile, tessellatedSpheres); });
+	}
+
+	// The benchmark measures one scene at a time, it does not keep rendering the previous one meanwhile. Nor does a render job.
+	if (userSettings_.Benchmark || renderJobSource_)
+	{
+		sceneLoad_.wait();
+	}
+
+	if (sceneLoad_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return false;
+	}
+
+	auto loaded = sceneLoad_.get();
+
+	// The user picked yet another scene in the meantime, the next frame starts loading that one instead.
+	if (loaded.Index != sceneIndex || loaded.File != sceneFile || loaded.TessellatedSpheres != tessellatedSpheres)
+	{
+		return false;
+	}
+
+	SetScene(std::move(loaded));
+	CreateAccelerationStructures();
+	scene_->ReleaseHostGeometry();
+	CreateSwapChain();
+	PrintMemoryStatistics();
+
+	return true;
+}
+
+void RayTracer::SetScene(LoadedScene&& loaded)
+{
+	const Utilities::TraceScope trace("SetScene");
+	PROFILE_ZONE("SetScene");
+	const auto uploadStart = std::chrono::high_resolution_clock::now();
+
+	// Upload the new scene while the frames in flight still trace the current one.
+	auto& [models, textures, instances] = loaded.Assets;
+	const auto textureBudget = VkDeviceSize(userSettings_.TextureBudget) * 1024 * 1024;
+	std::vector<uint32_t> switchedInstances;
+
+	for (size_t i = 0; i != loaded.LevelsOfDetail.InstanceChains.size(); ++i)
+	{
+		if (loaded.LevelsOfDetail.InstanceChains[i] != SceneList::LevelsOfDetail::NoChain)
+		{
+			switchedInstances.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	std::unique_ptr<Assets::Scene> scene(new Assets::Scene(StagingRing(), TaskSystem(), std::move(models), std::move(textures), std::move(instances), loaded.Environment.get(), textureBudget, userSettings_.CompactVertices, userSettings_.PositionStream,
+		hostBuildAccelerationStructures_ && SupportsHostAccelerationStructureBuild(), userSettings_.GeometryBudget != 0, switchedInstances));
+
+	// Only then release the current scene and everything referencing it, once its last frame has completed.
+	if (scene_)
+	{
+		Device().WaitIdle();
+		DeleteSwapChain();
+		DeleteAccelerationStructures();
+	}
+
+	scene_ = std::move(scene);
+	sceneIndex_ = loaded.Index;
+	sceneFile_ = loaded.File;
+	tessellatedSpheres_ = loaded.TessellatedSpheres;
+	cameraInitialSate_ = loaded.Camera;
+	levelsOfDetail_ = std::move(loaded.LevelsOfDetail);
+	levelOfDetailModelView_ = cameraInitialSate_.ModelView;
+	levelOfDetailFieldOfView_ = cameraInitialSate_.FieldOfView;
+
+	if (metricsExporter_)
+	{
+		metricsExporter_->SetScene(sceneIndex_, SceneName());
+	}
+
+	std::cout << "- texture memory: " << scene_->TextureMemorySize() / (1024.0 * 1024.0) << "MB for " << scene_->TextureCount() << " textures ";
+	std::cout << "(" << scene_->CompressedTextureCount() << " block compressed, " << scene_->TextureBudget() / (1024.0 * 1024.0) << "MB streaming budget)" << std::endl;
+	std::cout << "- materials: " << scene_->MaterialCount() << " distinct out of " << scene_->ModelMaterialCount() << std::endl;
+
+	userSettings_.FieldOfView = cameraInitialSate_.FieldOfView;
+	userSettings_.Aperture = cameraInitialSate_.Aperture;
+	userSettings_.FocusDistance = cameraInitialSate_.FocusDistance;
+
+	modelViewController_.Reset(cameraInitialSate_.ModelView);
+
+	// Bob each instance by a fraction of its model height.
+	// The world bounds of the instances, their amplitude included, then give the longest useful ray.
+	instanceAmplitudes_.clear();
+
+	glm::vec3 sceneMin(std::numeric_limits<float>::max());
+	glm::vec3 sceneMax(-std::numeric_limits<float>::max());
+
+	for (const auto& instance : scene_->Instances())
+	{
+		const auto& model = scene_->Models()[instance.ModelId];
+		const auto box = model.Procedural() != nullptr ? model.Procedural()->BoundingBox() : model.BoundingBox();
+		const float minY = box.first.y;
+		const float maxY = box.second.y;
+
+		instanceAmplitudes_.push_back(0.1f * (maxY - minY) * glm::length(glm::vec3(instance.Transform[1])));
+
+		for (uint32_t i = 0; i != 8; ++i)
+		{
+			const glm::vec3 corner((i & 1) != 0 ? box.second.x : box.first.x, (i & 2) != 0 ? box.second.y : box.first.y, (i & 4) != 0 ? box.second.z : box.first.z);
+			const glm::vec3 world(instance.Transform * glm::vec4(corner, 1));
+
+			sceneMin = glm::min(sceneMin, world - glm::vec3(0, instanceAmplitudes_.back(), 0));
+			sceneMax = glm::max(sceneMax, world + glm::vec3(0, instanceAmplitudes_.back(), 0));
+		}
+	}
+
+	sceneSphere_ = scene_->Instances().empty()
+		? glm::vec4(0, 0, 0, 1)
+		: glm::vec4((sceneMin + sceneMax) * 0.5f, std::max(glm::length(sceneMax - sceneMin) * 0.5f * 1.01f, 1e-3f));
+
+	// The timings still pending in the frame slots belong to the previous scene.
+	std::fill(timestampSamples_.begin(), timestampSamples_.end(), 0);
+
+	sceneLoadTime_ = loaded.LoadTime + std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - uploadStart).count();
+
+	std::cout << "- scene load: " << sceneLoadTime_ << "s, " << scene_->BuildArenaSize() / (1024.0 * 1024.0) << "MB of build temporaries in ";
+	std::cout << scene_->BuildArenaBlockCount() << " arena blocks, peak RSS " << Utilities::PeakResidentSetSize() / (1024.0 * 1024.0) << "MB" << std::endl;
+	periodTotalFrames_ = 0;
+	periodTotalRays_ = 0;
+	periodTracedRays_ = 0;
+	resetAccumulation_ = true;
+	isOfflineRestarted_ = true;
+	sequenceFrame_ = 0;
+	isSequenceFrameDone_ = false;
+
+	// The probe grid spans the bounds of the instances, a bake of another scene starts over.
+	if (!userSettings_.BakeProbes.empty() && !scene_->Instances().empty())
+	{
+		const auto& grid = userSettings_.ProbeGrid;
+
+		probeBaker_.reset(new ProbeBaker(
+			userSettings_.BakeProbes, glm::uvec3(grid[0], grid[1], grid[2]), static_cast<ProbeBaker::Encoding>(userSettings_.ProbeEncoding),
+			userSettings_.MaxNumberOfSamples, sceneMin, sceneMax));
+
+		probeFirst_ = probeBaker_->CompletedProbes();
+		probeEnd_ = probeFirst_;
+		isProbeBatchDone_ = false;
+
+		std::cout << "Probes: " << grid[0] << "x" << grid[1] << "x" << grid[2] << " grid into '" << userSettings_.BakeProbes << "', " << probeFirst_ << " already baked" << std::endl;
+	}
+}
+
+void RayTracer::UpdateTileSampling()
+{
+	constexpr uint32_t minNumberOfSamples = 16;
+	constexpr uint32_t tileUpdatePeriod = 4;
+
+	const auto previousSamples = totalNumberOfSamples_ - numberOfSamples_;
+
+	adaptiveSamplingThreshold_ = userSettings_.AdaptiveSamplingThreshold;
+
+	// The wavefront backend always traces every pixel, like the bands of a frame budget. So do several views, the launch depth being theirs.
+	if (adaptiveSamplingThreshold_ <= 0 || previousSamples < minNumberOfSamples || numberOfSamples_ == 0 || (userSettings_.Wavefront && SupportsRayQuery()) || IsFrameBudgeted() || viewCount_ > 1 || probeBaker_)
+	{
+		tileSampling_ = TileSampling::AllPixels;
+		tileSamplingFrame_ = 0;
+		return;
+	}
+
+	tileSampling_ = tileSamplingFrame_++ % tileUpdatePeriod == 0 ? TileSampling::UpdateActiveTiles : TileSampling::ActiveTiles;
+}
+
+float RayTracer::FoveaRadius() const
+{
+	// A probe bake has no gaze point.
+	return probeBaker_ ? 0.0f : userSettings_.FoveaRadius;
+}
+
+bool RayTracer::IsFrameBudgeted() const
+{
+	return userSettings_.FrameBudget > 0 && userSettings_.IsRayTraced && !(userSettings_.Wavefront && SupportsRayQuery());
+}
+
+void RayTracer::UpdateTraceRows(const uint32_t measuredRows, const double measuredTime)
+{
+	constexpr uint32_t minRows = 8;
+
+	const auto height = RenderExtent().height;
+
+	if (!IsFrameBudgeted())
+	{
+		traceRowOffset_ = 0;
+		traceRowCount_ = 0;
+		budgetRows_ = 0;
+		nextRow_ = 0;
+		return;
+	}
+
+	// Start small, then scale the band by how far the last measured one was from the budget, halfway to damp the timing noise.
+	if (budgetRows_ == 0)
+	{
+		budgetRows_ = std::max(height / 8, minRows);
+	}
+
+	if (measuredRows != 0 && measuredTime > 0)
+	{
+		const double fittingRows = measuredRows * userSettings_.FrameBudget / measuredTime;
+		budgetRows_ = static_cast<uint32_t>(glm::clamp((budgetRows_ + fittingRows) / 2, double(minRows), double(height)));
+	}
+
+	// The extent may have shrunk since the last band.
+	traceRowOffset_ = nextRow_ < height ? nextRow_ : 0;
+	traceRowCount_ = std::min(budgetRows_, height - traceRowOffset_);
+	nextRow_ = traceRowOffset_ + traceRowCount_ < height ? traceRowOffset_ + traceRowCount_ : 0;
+}
+
+bool RayTracer::IsIdle() const
+{
+	// Converged, with nothing left to export, load or stream, and no input or setting asking for new samples.
+	// The benchmarks and the streamed frames go on regardless.
+	return
+		!userSettings_.KeepDrawing &&
+		userSettings_.IsRayTraced &&
+		numberOfSamples_ == 0 &&
+		!resetAccumulation_ &&
+		!userSettings_.RequiresAccumulationReset(previousSettings_) &&
+		!userSettings_.Benchmark &&
+		!frameStreamer_ &&
+		!isScreenshotRequested_ &&
+		!sceneLoad_.valid() &&
+		sceneIndex_ == static_cast<uint32_t>(userSettings_.SceneIndex) &&
+		exportPaths_.empty() &&
+		!HasPendingReadbacks();
+}
+
+bool RayTracer::IsSampleBudgeted() const
+{
+	// The bands of a frame budget already fit the trace time, and the deterministic benchmarks trace the same samples on every device.
+	return userSettings_.SampleBudget > 0 && userSettings_.IsRayTraced && !IsFrameBudgeted() && !userSettings_.BenchmarkDeterministic;
+}
+
+uint32_t RayTracer::SamplesPerFrame() const
+{
+	return IsSampleBudgeted() && budgetSamples_ != 0 ? std::min(budgetSamples_, userSettings_.NumberOfSamples) : userSettings_.NumberOfSamples;
+}
+
+void RayTracer::UpdateBudgetSamples(const uint32_t measuredSamples, const double measuredTime)
+{
+	if (!IsSampleBudgeted())
+	{
+		budgetSamples_ = 0;
+		return;
+	}
+
+	// Start from the requested samples, then scale them by how far the last measured frame was from the budget, halfway to damp the timing noise.
+	// They at most double every frame, a frame of a few cheap samples (e.g. towards the sky) not making the next one blow the budget.
+	if (budgetSamples_ == 0)
+	{
+		budgetSamples_ = std::max(userSettings_.NumberOfSamples, 1u);
+	}
+
+	if (measuredSamples != 0 && measuredTime > 0)
+	{
+		const double fittingSamples = measuredSamples * userSettings_.SampleBudget / measuredTime;
+		const double maxSamples = std::max(std::min(budgetSamples_, userSettings_.NumberOfSamples) * 2.0, 1.0);
+		budgetSamples_ = static_cast<uint32_t>(glm::clamp((budgetSamples_ + fittingSamples) / 2, 1.0, maxSamples));
+	}
+}
+
+void RayTracer::AnimateInstances(VkCommandBuffer commandBuffer)
+{
+	// The first model is the ground or the room in all the scenes, leave it in place.
+	const auto& instances = scene_->Instances();
+	std::vector<glm::mat4> transforms;
+	transforms.reserve(instances.size());
+
+	for (size_t i = 0; i != instances.size(); ++i)
+	{
+		const auto offset = instances[i].ModelId == 0 ? 0.0f : instanceAmplitudes_[i] * static_cast<float>(std::sin(2 * time_ + i));
+		transforms.push_back(glm::translate(glm::mat4(1), glm::vec3(0, offset, 0)) * instances[i].Transform);
+	}
+
+	UpdateTopLevelStructures(commandBuffer, transforms);
+	scene_->UpdateLights(commandBuffer, transforms);
+	resetAccumulation_ = true;
+}
+
+void RayTracer::UpdateLevelsOfDetail(VkCommandBuffer commandBuffer)
+{
+	// The selection of the last camera holds until it moves or zooms again.
+	const auto modelView = modelViewController_.ModelView();
+
+	if (levelsOfDetail_.Chains.empty() || (modelView == levelOfDetailModelView_ && userSettings_.FieldOfView == levelOfDetailFieldOfView_))
+	{
+		return;
+	}
+
+	levelOfDetailModelView_ = modelView;
+	levelOfDetailFieldOfView_ = userSettings_.FieldOfView;
+
+	const auto instanceModels = SceneList::UpdateLevelsOfDetail(levelsOfDetail_, scene_->Instances(), modelView, userSettings_.FieldOfView, viewportHeight_);
+
+	if (instanceModels.empty())
+	{
+		return;
+	}
+
+	scene_->SetInstanceModels(commandBuffer, instanceModels);
+	UpdateInstanceModels(commandBuffer, instanceModels);
+	resetAccumulation_ = true;
+}
+
+void RayTracer::PrintMemoryStatistics() const
+{
+	const auto statistics = Device().Allocator().GetStatistics();
+	const double megabyte = 1024 * 1024;
+
+	std::cout << "- device memory: " << statistics.AllocationCount << " allocations in " << statistics.BlockCount << " blocks, ";
+	std::cout << statistics.UsedBytes / megabyte << "MB used out of " << statistics.BlockBytes / megabyte << "MB ";
+	std::cout << "(" << statistics.TotalAllocations << " allocations, " << statistics.TotalBlockAllocations << " vkAllocateMemory calls so far)" << std::endl;
+
+	const auto heaps = Device().Allocator().GetHeapBudgets();
+
+	for (size_t i = 0; i != heaps.size(); ++i)
+	{
+		std::cout << "- memory heap " << i << " (" << (heaps[i].IsDeviceLocal ? "device" : "host") << "): ";
+		std::cout << heaps[i].Usage / megabyte << "MB used out of a " << heaps[i].Budget / megabyte << "MB budget" << std::endl;
+	}
+
+	const auto categories = Device().Allocator().GetCategoryBytes();
+
+	std::cout << "- allocated memory:";
+
+	for (size_t i = 0; i != categories.size(); ++i)
+	{
+		std::cout << (i == 0 ? " " : ", ") << Vulkan::MemoryAllocator::CategoryName(static_cast<Vulkan::MemoryAllocator::Category>(i)) << " " << categories[i] / megabyte << "MB";
+	}
+
+	std::cout << std::endl;
+}
+
+void RayTracer::PushMetrics(const Statistics& stats)
+{
+	MetricsExporter::Sample sample{};
+	sample.FrameTime = stats.FrameTime;
+	sample.TraceTime = stats.TraceTime;
+	sample.RayRate = stats.RayRate;
+	sample.TotalRayRate = stats.TotalRayRate;
+	sample.Samples = userSettings_.IsRayTraced ? numberOfSamples_ : 0;
+	sample.TotalSamples = stats.TotalSamples;
+	sample.MaxSamples = userSettings_.MaxNumberOfSamples;
+	sample.BuildTime = stats.BuildTime;
+	sample.TopLevelBuildTime = stats.TopLevelBuildTime;
+
+	for (const auto& heap : stats.HeapBudgets)
+	{
+		if (heap.IsDeviceLocal)
+		{
+			sample.DeviceLocalUsage += heap.Usage;
+			sample.DeviceLocalBudget += heap.Budget;
+		}
+	}
+
+	metricsExporter_->Push(sample);
+}
+
+std::string RayTracer::SceneName() const
+{
+	return sceneIndex_ == SceneList::AllScenes.size() ? userSettings_.SceneFile : SceneList::AllScenes[sceneIndex_].first;
+}
+
+void RayTracer::CheckAndUpdateBenchmarkState(double prevTime)
+{
+	if (!userSettings_.Benchmark)
 	{
 		return;
 	}
@@ -294,12 +1442,51 @@ void RayTracer::CheckAndUpdateBenchmarkState(double prevTime)
 	if (periodTotalFrames_ == 0)
 	{
 		std::cout << std::endl;
-		std::cout << "Benchmark: Start scene #" << sceneIndex_ << " '" << SceneList::AllScenes[sceneIndex_].first << "'" << std::endl;
+		std::cout << "Benchmark: Start scene #" << sceneIndex_ << " '" << SceneName() << "'";
+		std::cout << (benchmarkSweep_ ? " [" + benchmarkSweep_->Points()[sweepPoint_].Name + "]" : std::string()) << std::endl;
 		sceneInitialTime_ = time_;
 		periodInitialTime_ = time_;
+		sceneFrameTimes_.clear();
+		sceneTraceTimes_.clear();
+		sceneStageClocks_.clear();
+		sceneRayCounters_.clear();
+		sceneTotalRays_ = 0;
+
+		sceneInitialEnergy_ = PowerEnergy();
+		periodInitialEnergy_ = sceneInitialEnergy_;
+
+		// A deterministic benchmark times its samples from the first one.
+		warmUpEndTime_ = time_ + (userSettings_.BenchmarkDeterministic ? 0 : userSettings_.BenchmarkWarmUp);
+		isWarmingUp_ = warmUpEndTime_ > time_;
+	}
+	else if (isWarmingUp_)
+	{
+		// The statistics and the time limit start over from here, as does the accumulation.
+		if (time_ >= warmUpEndTime_)
+		{
+			std::cout << "Benchmark: warmed up after " << std::fixed << std::setprecision(1) << time_ - sceneInitialTime_ << "s" << std::defaultfloat << std::endl;
+			isWarmingUp_ = false;
+			sceneInitialTime_ = time_;
+			periodInitialTime_ = time_;
+			sceneInitialEnergy_ = PowerEnergy();
+			periodInitialEnergy_ = sceneInitialEnergy_;
+			periodTotalFrames_ = 0;
+			periodTotalRays_ = 0;
+			periodTracedRays_ = 0;
+			sceneFrameTimes_.clear();
+			sceneTraceTimes_.clear();
+			sceneStageClocks_.clear();
+			sceneRayCounters_.clear();
+			sceneTotalRays_ = 0;
+			resetAccumulation_ = true;
+		}
+	}
+	else if (IsBenchmarkMeasured())
+	{
+		sceneFrameTimes_.push_back((time_ - prevTime) * 1000);
 	}
 
-	// Print out the frame rate at regular intervals.
+	// Print out the frame rate and ray rate at regular intervals.
 	{
 		const double period = 5;
 		const double prevTotalTime = prevTime - periodInitialTime_;
@@ -307,24 +1494,66 @@ void RayTracer::CheckAndUpdateBenchmarkState(double prevTime)
 
 		if (periodTotalFrames_ != 0 && static_cast<uint64_t>(prevTotalTime / period) != static_cast<uint64_t>(totalTime / period))
 		{
-			std::cout << "Benchmark: " << periodTotalFrames_ / totalTime << " fps" << std::endl;
+			std::cout << "Benchmark: " << periodTotalFrames_ / totalTime << " fps, " << periodTotalRays_ / (totalTime * 1000000000) << " Grays/s";
+			std::cout << ", " << periodTracedRays_ / (totalTime * 1000000000) << " total Grays/s";
+
+			if (powerMonitor_ && powerMonitor_->IsAvailable())
+			{
+				const double energy = PowerEnergy();
+				std::cout << ", " << (energy - periodInitialEnergy_) / totalTime << " W";
+				periodInitialEnergy_ = energy;
+			}
+
+			std::cout << std::endl;
 			periodInitialTime_ = time_;
 			periodTotalFrames_ = 0;
+			periodTotalRays_ = 0;
+			periodTracedRays_ = 0;
 		}
 
+		const auto extent = RenderExtent();
+
+		const double frameRays = userSettings_.IsRayTraced ? double(extent.width*timestampRows_[CurrentFrame()])*numberOfSamples_ : 0;
+
 		periodTotalFrames_++;
+		periodTotalRays_ += frameRays;
+		periodTracedRays_ += userSettings_.IsRayTraced && !frameRayCounters_.empty() ? double(frameRayCounters_[RayCounterTraceCalls]) : 0;
+		sceneTotalRays_ += frameRays;
 	}
 
 	// If in benchmark mode, bail out from the scene if we've reached the time or sample limit.
 	{
-		const bool timeLimitReached = periodTotalFrames_ != 0 && Window().GetTime() - sceneInitialTime_ > userSettings_.BenchmarkMaxTime;
+		const bool deterministic = userSettings_.BenchmarkDeterministic;
+		const bool timeLimitReached = !deterministic && periodTotalFrames_ != 0 && Time() - sceneInitialTime_ > userSettings_.BenchmarkMaxTime;
 		const bool sampleLimitReached = numberOfSamples_ == 0;
 
-		if (timeLimitReached || sampleLimitReached)
+		if (!isWarmingUp_ && (timeLimitReached || sampleLimitReached))
 		{
-			if (!userSettings_.BenchmarkNextScenes || static_cast<size_t>(userSettings_.SceneIndex) == SceneList::AllScenes.size() - 1)
+			if (IsBenchmarkMeasured() || deterministic)
+			{
+				WriteBenchmarkRecord();
+			}
+
+			// The next point of the sweep renders the same scene, the first one the next scene.
+			if (benchmarkSweep_)
+			{
+				const bool isLastPoint = sweepPoint_ + 1 == benchmarkSweep_->Points().size();
+				ApplySweepPoint(isLastPoint ? 0 : sweepPoint_ + 1);
+
+				if (!isLastPoint)
+				{
+					std::cout << std::endl;
+					return;
+				}
+			}
+
+			// The regular scenes stop before the micro-benchmark ones.
+			const size_t sceneIndex = static_cast<size_t>(userSettings_.SceneIndex);
+			const size_t lastScene = sceneIndex < SceneList::FirstMicroScene ? SceneList::FirstMicroScene - 1 : SceneList::AllScenes.size() - 1;
+
+			if (!userSettings_.BenchmarkNextScenes || sceneIndex >= lastScene)
 			{
-				Window().Close();
+				Close();
 			}
 
 			std::cout << std::endl;
@@ -333,9 +1562,404 @@ void RayTracer::CheckAndUpdateBenchmarkState(double prevTime)
 	}
 }
 
+bool RayTracer::IsBenchmarkMeasured() const
+{
+	return benchmarkReport_ || benchmarkBaseline_;
+}
+
+double RayTracer::PowerEnergy() const
+{
+	return powerMonitor_ ? powerMonitor_->Energy() : -1;
+}
+
+void RayTracer::ApplySweepPoint(const size_t point)
+{
+	const auto& settings = benchmarkSweep_->Points()[point];
+
+	sweepPoint_ = point;
+	headlessExtent_ = settings.Extent;
+	userSettings_.NumberOfSamples = settings.Samples;
+	userSettings_.NumberOfBounces = settings.Bounces;
+	userSettings_.RenderScale = settings.RenderScale;
+	userSettings_.CompactMaterials = settings.CompactMaterials;
+	userSettings_.RegeneratePaths = settings.RegeneratePaths;
+	userSettings_.RadianceCache = settings.RadianceCache;
+	userSettings_.PathGuiding = settings.PathGuiding;
+	userSettings_.RayIsolation = settings.RayIsolation;
+
+	// The benchmark timers start again with the new point.
+	periodTotalFrames_ = 0;
+	periodTotalRays_ = 0;
+	periodTracedRays_ = 0;
+	resetAccumulation_ = true;
+}
+
+void RayTracer::WriteBenchmarkRecord()
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(Device().PhysicalDevice(), &properties);
+
+	std::ostringstream driverVersion;
+	driverVersion << Vulkan::Version(properties.driverVersion, properties.vendorID);
+
+	const auto extent = RenderExtent();
+
+	BenchmarkRecord record{};
+	record.SceneIndex = sceneIndex_;
+	record.SceneName = SceneName();
+	record.SweepPoint = benchmarkSweep_ ? benchmarkSweep_->Points()[sweepPoint_].Name : std::string();
+	record.DeviceName = properties.deviceName;
+	record.DriverVersion = driverVersion.str();
+	record.Width = extent.width;
+	record.Height = extent.height;
+	record.Samples = userSettings_.NumberOfSamples;
+	record.Bounces = userSettings_.NumberOfBounces;
+	record.RouletteDepth = userSettings_.RussianRouletteDepth;
+	record.InvocationReorder = userSettings_.InvocationReorder;
+	record.RegeneratePaths = userSettings_.RegeneratePaths && !userSettings_.Wavefront;
+	record.Wavefront = userSettings_.Wavefront;
+	record.Hybrid = userSettings_.Hybrid && userSettings_.Wavefront;
+	record.Restir = userSettings_.Restir && userSettings_.LightSampling && !userSettings_.Wavefront;
+	record.LightTree = userSettings_.LightTree && userSettings_.LightSampling;
+	record.RadianceCache = userSettings_.RadianceCache && !userSettings_.Wavefront;
+	record.PathGuiding = userSettings_.PathGuiding && !userSettings_.Wavefront;
+	record.RayIsolation = userSettings_.Wavefront ? 0 : userSettings_.RayIsolation;
+	record.Views = userSettings_.Wavefront ? 1 : viewCount_;
+	record.TessellatedSpheres = tessellatedSpheres_;
+	record.LaunchOrder = launchOrder_;
+	record.TotalSamples = totalNumberOfSamples_;
+	record.SceneLoadTime = sceneLoadTime_;
+	record.BuildTime = AccelerationStructureBuildTime();
+	record.InstanceCount = TopLevelInstanceCount();
+	record.TopLevelBuildTime = TopLevelBuildTime();
+	record.BottomLevelBuildTime = BottomLevelBuildTime();
+	record.PositionStream = userSettings_.PositionStream;
+	record.HostVisibleShaderBindingTable = userSettings_.HostVisibleShaderBindingTable;
+	record.InstanceUploadTime = InstanceUploadTime();
+	record.DeviceMemoryUsed = Device().Allocator().GetStatistics().UsedBytes;
+	record.DeviceLocalUsage = 0;
+	record.DeviceLocalBudget = 0;
+
+	for (const auto& heap : Device().Allocator().GetHeapBudgets())
+	{
+		if (heap.IsDeviceLocal)
+		{
+			record.DeviceLocalUsage += heap.Usage;
+			record.DeviceLocalBudget += heap.Budget;
+		}
+	}
+
+	using Category = Vulkan::MemoryAllocator::Category;
+	const auto categories = Device().Allocator().GetCategoryBytes();
+
+	record.GeometryMemory = categories[static_cast<size_t>(Category::Geometry)];
+	record.TextureMemory = categories[static_cast<size_t>(Category::Textures)];
+	record.BottomLevelMemory = categories[static_cast<size_t>(Category::BottomLevel)];
+	record.TopLevelMemory = categories[static_cast<size_t>(Category::TopLevel)];
+	record.ScratchMemory = categories[static_cast<size_t>(Category::Scratch)];
+	record.ImageMemory = categories[static_cast<size_t>(Category::Images)];
+	record.FrameTimes = sceneFrameTimes_;
+	record.TraceTimes = sceneTraceTimes_;
+	record.StageClocks = sceneStageClocks_;
+	record.Grays = time_ > sceneInitialTime_ ? sceneTotalRays_ / ((time_ - sceneInitialTime_) * 1000000000) : 0;
+	record.RayCounters = sceneRayCounters_;
+	record.TotalGrays = time_ > sceneInitialTime_ && !sceneRayCounters_.empty()
+		? double(sceneRayCounters_[RayCounterTraceCalls]) / ((time_ - sceneInitialTime_) * 1000000000)
+		: 0;
+	record.RenderTime = !sceneTraceTimes_.empty()
+		? std::accumulate(sceneTraceTimes_.begin(), sceneTraceTimes_.end(), 0.0)
+		: (Time() - sceneInitialTime_) * 1000;
+	record.Power = -1;
+	record.Energy = -1;
+
+	if (powerMonitor_ && powerMonitor_->IsAvailable() && time_ > sceneInitialTime_)
+	{
+		record.Energy = PowerEnergy() - sceneInitialEnergy_;
+		record.Power = record.Energy / (time_ - sceneInitialTime_);
+	}
+
+	record.Psnr = -1;
+	record.Ssim = -1;
+	record.SampleLimitTime = -1;
+	record.AccumulationHash = 0;
+
+	if (record.Power >= 0)
+	{
+		std::cout << "Benchmark: scene #" << record.SceneIndex << " " << std::fixed << std::setprecision(1) << record.Power << " W, " << std::setprecision(3)
+			<< BenchmarkReport::JoulesPerFrame(record) << " J/frame, " << BenchmarkReport::GraysPerJoule(record.Grays, record.Power) << " Grays/J, "
+			<< BenchmarkReport::GraysPerJoule(record.TotalGrays, record.Power) << " total Grays/J" << std::defaultfloat << std::endl;
+	}
+
+	const bool deterministic = userSettings_.BenchmarkDeterministic && userSettings_.IsRayTraced;
+
+	// The last frame has to finish for the time to the sample limit to be that of the GPU.
+	if (deterministic)
+	{
+		Device().WaitIdle();
+		record.SampleLimitTime = Time() - sceneInitialTime_;
+
+		std::cout << "Benchmark: scene #" << record.SceneIndex << " traced " << record.TotalSamples << " samples in ";
+		std::cout << std::fixed << std::setprecision(3) << record.SampleLimitTime << "s" << std::defaultfloat << std::endl;
+	}
+
+	record.BaselineTime = -1;
+	record.BaselineChange = 0;
+	record.Regression = false;
+
+	if ((userSettings_.BenchmarkReference.empty() && !deterministic) || !userSettings_.IsRayTraced)
+	{
+		if (benchmarkBaseline_)
+		{
+			benchmarkBaseline_->Compare(record);
+		}
+
+		if (benchmarkReport_)
+		{
+			benchmarkReport_->Add(record);
+		}
+
+		return;
+	}
+
+	// The record is added once the accumulation image has been read back, compared and hashed.
+	const auto reference = userSettings_.BenchmarkReference.empty() ? std::string() : GetScenePath(userSettings_.BenchmarkReference, userSettings_, sceneIndex_);
+
+	RequestAccumulationReadback([this, record, reference, deterministic](const VkExtent2D extent, std::vector<float>&& pixels) mutable
+	{
+		if (!reference.empty())
+		{
+			BenchmarkReport::CompareWithReference(reference, extent, pixels, record.Psnr, record.Ssim);
+		}
+
+		if (deterministic)
+		{
+			record.AccumulationHash = BenchmarkReport::ComputeHash(pixels);
+			std::cout << "Benchmark: scene #" << record.SceneIndex << " accumulation hash " << std::hex << std::setw(16) << std::setfill('0') << record.AccumulationHash << std::dec << std::setfill(' ') << std::endl;
+		}
+
+		if (benchmarkBaseline_)
+		{
+			benchmarkBaseline_->Compare(record);
+		}
+
+		if (benchmarkReport_)
+		{
+			benchmarkReport_->Add(record);
+		}
+
+		if (record.Psnr >= 0)
+		{
+			std::cout << "Benchmark: scene #" << record.SceneIndex << " PSNR " << record.Psnr << " dB, SSIM " << record.Ssim << " (" << record.TotalSamples << " samples in ";
+			std::cout << record.RenderTime << " ms, " << BenchmarkReport::TimeNormalizedPsnr(record.Psnr, record.RenderTime) << " dB at 1 s)" << std::endl;
+		}
+	});
+}
+
+void RayTracer::SaveCheckpoint()
+{
+	const auto samples = totalNumberOfSamples_;
+
+	checkpointTime_ = Time();
+
+	RequestAccumulationReadback([this, samples, signature = CheckpointSignature()](const VkExtent2D extent, std::vector<float>&& pixels)
+	{
+		imageExporter_->Checkpoint(userSettings_.Checkpoint, extent, samples, signature, std::make_shared<const std::vector<float>>(std::move(pixels)));
+	});
+}
+
+std::string RayTracer::CheckpointSignature() const
+{
+	// What the sums depend on besides the extent, the sample limit aside.
+	const auto& settings = userSettings_;
+	std::ostringstream signature;
+
+	signature
+		<< "scene=" << SceneName() << " tessellated=" << settings.TessellatedSpheres << " environment=" << settings.Environment << "@" << settings.EnvironmentIntensity
+		<< " bounces=" << settings.NumberOfBounces << " roulette=" << settings.RussianRouletteDepth << " lights=" << settings.LightSampling << settings.LightTree << settings.Restir
+		<< " cache=" << settings.RadianceCache << " guiding=" << settings.PathGuiding << " wavefront=" << settings.Wavefront << settings.Hybrid
+		<< " materials=" << settings.CompactMaterials << " isolation=" << settings.RayIsolation << " sampler=" << settings.Sampler
+		<< " camera=" << settings.FieldOfView << "," << settings.Aperture << "," << settings.FocusDistance << " stream=" << settings.SampleStreamIndex << "/" << settings.SampleStreamCount;
+
+	return signature.str();
+}
+
+void RayTracer::ExportAccumulation()
+{
+	const auto samples = totalNumberOfSamples_;
+	auto paths = std::move(exportPaths_);
+	exportPaths_.clear();
+
+	// The share of the samples traced by one of several devices is merged with the others rather than exported.
+	if (accumulationSink_)
+	{
+		RequestAccumulationReadback(accumulationSink_);
+		return;
+	}
+
+	// Every requested file is encoded from the same readback.
+	RequestAccumulationReadback([this, paths, samples](const VkExtent2D extent, std::vector<float>&& pixels)
+	{
+		const auto shared = std::make_shared<const std::vector<float>>(std::move(pixels));
+
+		for (const auto& path : paths)
+		{
+			imageExporter_->Export(path, extent, samples, shared);
+		}
+	});
+
+	// The other views of a multi-view launch are exported next to the main one, each file with its view number.
+	if (viewCount_ > 1 && !wavefront_)
+	{
+		RequestViewReadback([this, paths, samples](const VkExtent2D extent, const uint32_t view, std::vector<float>&& pixels)
+		{
+			const auto shared = std::make_shared<const std::vector<float>>(std::move(pixels));
+
+			for (const auto& path : paths)
+			{
+				imageExporter_->Export(GetViewPath(path, view), extent, samples, shared);
+			}
+		});
+	}
+}
+
+void RayTracer::ReadOfflineTile(const std::string& exportPath)
+{
+	const auto extent = OfflineExtent();
+	const auto tileCount = OfflineTileCount();
+	const auto tile = RenderExtent();
+	const uint32_t x = offlineTile_ % tileCount.width * tile.width;
+	const uint32_t y = offlineTile_ / tileCount.width * tile.height;
+	const bool isLast = offlineTile_ + 1 == tileCount.width * tileCount.height;
+	const auto samples = totalNumberOfSamples_;
+	const auto path = GetScenePath(exportPath, userSettings_, sceneIndex_);
+	const auto sums = offlineSums_;
+
+	isOfflineTileDone_ = !isLast;
+
+	std::cout << "Offline render: tile " << offlineTile_ + 1 << "/" << tileCount.width * tileCount.height << " (" << tile.width << "x" << tile.height << ") done";
+	std::cout << (isLast ? ", exporting '" + path + "'" : std::string()) << std::endl;
+
+	RequestAccumulationReadback([this, extent, x, y, isLast, samples, path, sums](const VkExtent2D tileExtent, std::vector<float>&& pixels)
+	{
+		// The tiles on the right and bottom edges trace a few pixels past the image.
+		const uint32_t width = std::min(tileExtent.width, extent.width - x);
+		const uint32_t height = std::min(tileExtent.height, extent.height - y);
+
+		for (uint32_t row = 0; row != height; ++row)
+		{
+			std::copy_n(pixels.begin() + size_t(row) * tileExtent.width * 4, size_t(width) * 4, sums->begin() + (size_t(y + row) * extent.width + x) * 4);
+		}
+
+		if (isLast)
+		{
+			imageExporter_->Export(path, extent, samples, sums);
+		}
+	});
+}
+
+void RayTracer::ExportSequenceFrame(const std::string& exportPath)
+{
+	const auto frameCount = cameraPath_->FrameCount();
+	const auto framesPerSecond = cameraPath_->FramesPerSecond();
+	const auto samples = totalNumberOfSamples_;
+	const auto path = exportPath.empty() ? std::string() : GetSequencePath(exportPath, sequenceFrame_);
+	const auto command = userSettings_.SequencePipe;
+
+	isSequenceFrameDone_ = sequenceFrame_ + 1 < frameCount;
+
+	std::cout << "Sequence: frame " << sequenceFrame_ + 1 << "/" << frameCount << " done" << std::endl;
+
+	// The frame is encoded on the exporter thread while the next one is traced.
+	RequestAccumulationReadback([this, path, command, framesPerSecond, samples](const VkExtent2D extent, std::vector<float>&& pixels)
+	{
+		const auto shared = std::make_shared<const std::vector<float>>(std::move(pixels));
+
+		if (!path.empty())
+		{
+			imageExporter_->Export(path, extent, samples, shared);
+		}
+
+		if (!command.empty())
+		{
+			imageExporter_->Stream(command, framesPerSecond, extent, shared);
+		}
+	});
+}
+
+void RayTracer::ReadProbeBatch()
+{
+	const auto first = probeFirst_;
+	const auto end = probeEnd_;
+	const auto count = probeBaker_->ProbeCount();
+
+	isProbeBatchDone_ = end < count;
+
+	if (first == end)
+	{
+		return;
+	}
+
+	// Projected and saved on the main thread once read back, the next batch is traced meanwhile.
+	RequestAccumulationReadback([this, first, end, count](const VkExtent2D extent, std::vector<float>&& pixels)
+	{
+		probeBaker_->AddBatch(first, end, extent.width, pixels);
+
+		std::cout << "Probes: " << end << "/" << count << " baked into '" << userSettings_.BakeProbes << "'" << std::endl;
+	});
+}
+
+uint32_t RayTracer::ProbeTilesPerRow() const
+{
+	return std::max(RenderExtent().width / ProbeBaker::TileSize, 1u);
+}
+
+void RayTracer::RouteStreamInput()
+{
+	for (const auto& input : frameStreamer_->TakeInput())
+	{
+		if (HasSwapChain())
+		{
+			switch (input.Type)
+			{
+			case FrameStreamer::InputKey: OnKey(input.Values[0], input.Values[1], input.Values[2], input.Values[3]); break;
+			case FrameStreamer::InputCursorPosition: OnCursorPosition(input.X, input.Y); break;
+			case FrameStreamer::InputMouseButton: OnMouseButton(input.Values[0], input.Values[1], input.Values[2]); break;
+			case FrameStreamer::InputScroll: OnScroll(input.X, input.Y); break;
+			default: break;
+			}
+
+			continue;
+		}
+
+		// Headless, there is no user interface, only the camera motions apply.
+		if (userSettings_.Benchmark || cameraPath_ || probeBaker_)
+		{
+			continue;
+		}
+
+		bool isCameraMoved = false;
+
+		switch (input.Type)
+		{
+		case FrameStreamer::InputKey: isCameraMoved = modelViewController_.OnKey(input.Values[0], input.Values[1], input.Values[2], input.Values[3]); break;
+		case FrameStreamer::InputCursorPosition: isCameraMoved = modelViewController_.OnCursorPosition(input.X, input.Y); break;
+		case FrameStreamer::InputMouseButton: isCameraMoved = modelViewController_.OnMouseButton(input.Values[0], input.Values[1], input.Values[2]); break;
+		default: break;
+		}
+
+		resetAccumulation_ |= isCameraMoved && userSettings_.ReprojectedSamples == 0;
+		isOfflineRestarted_ |= isCameraMoved;
+	}
+}
+
 void RayTracer::CheckFramebufferSize() const
 {
 	// Check the framebuffer size when requesting a fullscreen window, as it's not guaranteed to match.
+	if (IsHeadless())
+	{
+		return;
+	}
+
 	const auto& cfg = Window().Config();
 	const auto fbSize = Window().FramebufferSize();
 	
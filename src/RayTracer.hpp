@@ -1,9 +1,13 @@
 #pragma once
 
 #include "ModelViewController.hpp"
+#include "RenderQueue.hpp"
 #include "SceneList.hpp"
 #include "UserSettings.hpp"
 #include "Vulkan/RayTracing/Application.hpp"
+#include "Assets/Environment.hpp"
+#include <functional>
+#include <future>
 
 class RayTracer final : public Vulkan::RayTracing::Application
 {
@@ -14,10 +18,30 @@ public:
 	RayTracer(const UserSettings& userSettings, const Vulkan::WindowConfig& windowConfig, VkPresentModeKHR presentMode);
 	~RayTracer();
 
+	// Receives the accumulation sums (RGBA32F, alpha being the sample count) instead of the exporter once all the samples are in.
+	// It runs on the render thread, see --devices.
+	using AccumulationSink = std::function<void(VkExtent2D extent, std::vector<float>&& pixels)>;
+	void SetAccumulationSink(AccumulationSink sink) { accumulationSink_ = std::move(sink); }
+
+	// Traces the given ranges of the sample sequence one after the other when headless, each one going to the sink before the next is asked for.
+	// The application closes once the source returns false, see RenderFarmWorker.
+	using SampleRangeSource = std::function<bool(uint32_t& firstSample, uint32_t& sampleCount)>;
+	void SetSampleRangeSource(SampleRangeSource source) { sampleRangeSource_ = std::move(source); }
+
+	// Renders the given jobs one after the other when headless, keeping the scene while they share it. The report gets the samples
+	// accumulated every frame, and is done once the image of the job is written. The application closes once the source returns false, see RenderQueue.
+	using RenderJobSource = std::function<bool(RenderJob& job)>;
+	using RenderJobReport = std::function<void(const RenderJob& job, uint32_t samples, bool isDone)>;
+	void SetRenderJobSource(RenderJobSource source, RenderJobReport report) { renderJobSource_ = std::move(source); renderJobReport_ = std::move(report); }
+
+	// The scenes significantly slower than with --compare-baseline, once the application has run.
+	uint32_t BenchmarkRegressions();
+
 protected:
 
 	const Assets::Scene& GetScene() const override { return *scene_; }
 	Assets::UniformBufferObject GetUniformBufferObject(VkExtent2D extent) const override;
+	Assets::FrameConstants GetFrameConstants() const override;
 
 	void SetPhysicalDevice(
 		VkPhysicalDevice physicalDevice, 
@@ -30,35 +54,143 @@ protected:
 	void DeleteSwapChain() override;
 	void DrawFrame() override;
 	void Render(VkCommandBuffer commandBuffer, uint32_t imageIndex) override;
+	bool IsIdle() const override;
 
 	void OnKey(int key, int scancode, int action, int mods) override;
 	void OnCursorPosition(double xpos, double ypos) override;
 	void OnMouseButton(int button, int action, int mods) override;
 	void OnScroll(double xoffset, double yoffset) override;
+	void OnInputEvent(const Vulkan::Window::InputEvent& event) override;
 
 private:
 
-	void LoadScene(uint32_t sceneIndex);
+	// The CPU side of a scene, loaded off the render thread. Its GPU resources are created when it is swapped in.
+	struct LoadedScene
+	{
+		uint32_t Index;
+		std::string File; // When Index is past the built-in scenes.
+		bool TessellatedSpheres;
+		SceneList::CameraInitialSate Camera;
+		SceneAssets Assets;
+		std::unique_ptr<Assets::Environment> Environment;
+		SceneList::LevelsOfDetail LevelsOfDetail; // Empty unless the instances switch levels as the camera moves.
+		double LoadTime;
+	};
+
+	LoadedScene LoadSceneAssets(uint32_t sceneIndex, const std::string& sceneFile, bool tessellatedSpheres) const;
+	bool UpdateSceneLoad();
+	void SetScene(LoadedScene&& loaded);
+	void AnimateInstances(VkCommandBuffer commandBuffer);
+	void UpdateLevelsOfDetail(VkCommandBuffer commandBuffer);
+	void UpdateTileSampling();
+	float FoveaRadius() const;
+	void UpdateTraceRows(uint32_t measuredRows, double measuredTime);
+	bool IsFrameBudgeted() const;
+	void UpdateBudgetSamples(uint32_t measuredSamples, double measuredTime);
+	bool IsSampleBudgeted() const;
+	uint32_t SamplesPerFrame() const;
+	void PrintMemoryStatistics() const;
+	void PushMetrics(const struct Statistics& stats);
+	std::string SceneName() const;
 	void CheckAndUpdateBenchmarkState(double prevTime);
+	bool IsBenchmarkMeasured() const;
+	double PowerEnergy() const;
+	void ApplySweepPoint(size_t point);
+	void WriteBenchmarkRecord();
+	void ExportAccumulation();
+	void SaveCheckpoint();
+	std::string CheckpointSignature() const;
+	void ReadOfflineTile(const std::string& exportPath);
+	void ExportSequenceFrame(const std::string& exportPath);
+	void ReadProbeBatch();
+	uint32_t ProbeTilesPerRow() const;
+	void RouteStreamInput();
 	void CheckFramebufferSize() const;
 
 	uint32_t sceneIndex_{};
+	std::string sceneFile_; // The one loaded, a render job may ask for another.
+	bool tessellatedSpheres_{};
+	float viewportHeight_{}; // The traced image height the levels of detail are selected for.
 	UserSettings userSettings_{};
 	UserSettings previousSettings_{};
 	SceneList::CameraInitialSate cameraInitialSate_{};
 	ModelViewController modelViewController_{};
+	glm::mat4 previousModelView_{}; // The camera before the last move, when reprojecting.
+	SceneList::LevelsOfDetail levelsOfDetail_;
+	glm::mat4 levelOfDetailModelView_{}; // The camera the levels of detail were last selected for.
+	float levelOfDetailFieldOfView_{};
 
-	std::unique_ptr<const Assets::Scene> scene_;
+	std::unique_ptr<Assets::Scene> scene_;
 	std::unique_ptr<class UserInterface> userInterface_;
+	std::unique_ptr<class BenchmarkReport> benchmarkReport_;
+	std::unique_ptr<class BenchmarkBaseline> benchmarkBaseline_;
+	std::unique_ptr<class BenchmarkSweep> benchmarkSweep_;
+	std::unique_ptr<class PowerMonitor> powerMonitor_;
+	std::unique_ptr<class ImageExporter> imageExporter_;
+	std::unique_ptr<class FrameStreamer> frameStreamer_;
+	std::unique_ptr<class MetricsExporter> metricsExporter_;
+	std::future<LoadedScene> sceneLoad_; // Destroyed first, the loading thread uses the task system.
+	std::vector<float> instanceAmplitudes_;
+	glm::vec4 sceneSphere_{}; // Encloses the instances wherever their animation takes them.
+	std::vector<int32_t> textureRequests_;
+	std::vector<uint64_t> frameStageClocks_; // The last read back, see ReadStageClocks().
+	std::vector<uint64_t> frameRayCounters_; // Same, see ReadRayCounters().
 
 	double time_{};
 
 	uint32_t totalNumberOfSamples_{};
 	uint32_t numberOfSamples_{};
+	uint32_t tileSamplingFrame_{}; // Frames since adaptive sampling started, the active tiles are only updated every few of them.
+	std::vector<uint32_t> timestampSamples_; // Samples traced in each frame slot, matching the frame timestamps.
+	std::vector<uint32_t> timestampRows_; // Rows traced in each frame slot.
+	uint32_t budgetRows_{}; // The band height fitting the frame budget.
+	uint32_t budgetSamples_{}; // The samples per frame fitting the sample budget.
+	uint32_t nextRow_{}; // The first row of the next band, the samples only advance once a band starts again from the top.
 	bool resetAccumulation_{};
+	bool isAccumulationExported_{};
+	bool isScreenshotRequested_{};
+	uint32_t offlineTile_{}; // The one being traced, then the last one once the offline render is done.
+	bool isOfflineTileDone_{}; // The next accumulation reset moves on to the next tile.
+	bool isOfflineRestarted_{}; // The camera has moved, the next accumulation reset restarts from the first tile.
+	std::shared_ptr<std::vector<float>> offlineSums_; // The accumulation sums of the whole offline render, the tiles are read back into.
+	std::unique_ptr<class CameraPath> cameraPath_; // Drives the camera of an image sequence instead of the input.
+	uint32_t sequenceFrame_{};
+	uint32_t interleaveFrame_{}; // Counts the reprojected frames, rotating the interleaved pixels.
+	uint32_t restirFrame_{}; // Counts the frames since the reservoirs were last valid, its parity selects their half of the buffer.
+	uint32_t radianceCacheFrame_{}; // Counts the frames that used the radiance cache, rotating its training paths.
+	bool isSequenceFrameDone_{}; // The next accumulation reset moves the camera on to the next frame.
+	std::unique_ptr<class ProbeBaker> probeBaker_; // Traces the probes of a bake instead of the camera view.
+	uint32_t probeFirst_{}; // The probes of the batch being traced.
+	uint32_t probeEnd_{};
+	bool isProbeBatchDone_{}; // The next accumulation reset moves on to the next batch.
+	std::vector<std::string> exportPaths_;
+	bool isCheckpointRead_{}; // Only the first accumulation resumes the checkpoint.
+	double checkpointTime_{}; // Of the last one.
+	AccumulationSink accumulationSink_;
+	SampleRangeSource sampleRangeSource_;
+	bool hasSampleRange_{};
+	RenderJobSource renderJobSource_;
+	RenderJobReport renderJobReport_;
+	RenderJob renderJob_{}; // The one being rendered.
+	bool hasRenderJob_{};
+	bool isRenderJobDone_{}; // Its image is exported, the next frame reports it and asks for another one.
 
 	// Benchmark stats
+	size_t sweepPoint_{};
+	VkExtent2D headlessExtent_{}; // The headless extent of the sweep point or of the render job.
 	double sceneInitialTime_{};
+	double warmUpEndTime_{};
+	bool isWarmingUp_{}; // The scene statistics start once its warm-up is over.
 	double periodInitialTime_{};
 	uint32_t periodTotalFrames_{};
+	double periodTotalRays_{};
+	double periodTracedRays_{}; // Counted on the GPU, the bounce and shadow rays included.
+	double sceneTotalRays_{};
+	double sceneInitialEnergy_{}; // Joules of the power monitor, negative without one.
+	double periodInitialEnergy_{};
+	double sceneLoadTime_{};
+	std::vector<double> sceneFrameTimes_; // Milliseconds, for the benchmark report.
+	std::vector<double> sceneTraceTimes_;
+	std::vector<uint64_t> sceneStageClocks_; // Summed over the scene, empty unless profiled.
+	std::vector<uint64_t> sceneRayCounters_; // Summed over the scene.
 };
@@ -0,0 +1,473 @@
+#include "RenderFarm.hpp"
+#include "ImageExporter.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/Exception.hpp"
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+using boost::asio::ip::tcp;
+
+struct RenderFarmConnection final
+{
+	boost::asio::io_context Context; // Never run, the farm only makes synchronous calls.
+	tcp::socket Socket{ Context };
+};
+
+namespace
+{
+	// The messages are sent as is, in the byte order of the machine. The handshake carries markers of it and of the float format
+	// of the sums, each side refuses a peer that differs rather than merging sums it would read wrong.
+	const uint32_t ProtocolMagic = 0x4d524146; // "FARM"
+	const uint32_t ProtocolVersion = 2;
+	const uint32_t ByteOrderMarker = 0x01020304;
+	const float SampleFormatMarker = -0.15625f; // Exact in binary32, its bytes tell the float formats apart.
+
+	static_assert(sizeof(float) == 4 && std::numeric_limits<float>::is_iec559, "the accumulation sums are sent as IEEE 754 binary32");
+
+	// Worker to coordinator, once connected.
+	struct HelloMessage final
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t ByteOrder;
+		float SampleFormat;
+		uint32_t Width;
+		uint32_t Height;
+	};
+
+	// Coordinator to worker, answering the hello. Only an accepted worker is assigned ranges, the others are disconnected.
+	enum class WelcomeStatus : uint32_t
+	{
+		Accepted,
+		Incompatible, // Another protocol version, byte order or float format.
+		WrongExtent,
+		Finished // No range left to trace, all of them being in or in flight on several workers already.
+	};
+
+	struct WelcomeMessage final
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t ByteOrder;
+		float SampleFormat;
+		WelcomeStatus Status;
+	};
+
+	// The magic of a peer that sends in the other byte order.
+	constexpr uint32_t SwapBytes(const uint32_t value)
+	{
+		return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+	}
+
+	bool IsFarmMagic(const uint32_t magic)
+	{
+		return magic == ProtocolMagic || magic == SwapBytes(ProtocolMagic);
+	}
+
+	bool HasSameFormat(const uint32_t byteOrder, const float sampleFormat)
+	{
+		return byteOrder == ByteOrderMarker && sampleFormat == SampleFormatMarker;
+	}
+
+	// Coordinator to worker, an empty range once all the samples are in.
+	struct RangeMessage final
+	{
+		uint32_t FirstSample;
+		uint32_t SampleCount;
+	};
+
+	// Worker to coordinator, followed by the RGBA32F accumulation sums of the range.
+	struct ResultMessage final
+	{
+		uint32_t FirstSample;
+		uint32_t SampleCount;
+		uint64_t Size; // bytes
+	};
+
+	template <class T>
+	void Write(tcp::socket& socket, const T& message)
+	{
+		boost::asio::write(socket, boost::asio::buffer(&message, sizeof(message)));
+	}
+
+	template <class T>
+	T Read(tcp::socket& socket)
+	{
+		T message{};
+		boost::asio::read(socket, boost::asio::buffer(&message, sizeof(message)));
+		return message;
+	}
+}
+
+RenderFarmCoordinator::RenderFarmCoordinator(const uint16_t port, const VkExtent2D extent, const uint32_t totalSamples, const uint32_t rangeSamples) :
+	port_(port),
+	extent_(extent),
+	totalSamples_(totalSamples),
+	sums_(size_t(extent.width) * extent.height * 4)
+{
+	for (uint32_t first = 0; first < totalSamples; first += rangeSamples)
+	{
+		queued_.push_back(Range{ first, std::min(rangeSamples, totalSamples - first), 0 });
+	}
+}
+
+RenderFarmCoordinator::~RenderFarmCoordinator()
+{
+}
+
+void RenderFarmCoordinator::Run(const std::string& outputPath)
+{
+	boost::asio::io_context context;
+	tcp::acceptor acceptor(context, tcp::endpoint(tcp::v4(), port_));
+	acceptor.non_blocking(true);
+
+	std::cout << "Render farm: waiting for workers on port " << port_ << ", " << queued_.size() << " ranges of samples to trace" << std::endl;
+
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::unique_ptr<RenderFarmConnection>> connections;
+	std::vector<std::thread> threads;
+
+	const auto isDone = [this]()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return queued_.empty() && inFlight_.empty();
+	};
+
+	// The acceptor is polled, so that it gives up once the last range is in.
+	while (!isDone())
+	{
+		std::unique_ptr<RenderFarmConnection> connection(new RenderFarmConnection());
+		boost::system::error_code error;
+		acceptor.accept(connection->Socket, error);
+
+		if (error)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			continue;
+		}
+
+		const auto endpoint = connection->Socket.remote_endpoint(error);
+		const auto name = error ? std::string("unknown") : endpoint.address().to_string() + ":" + std::to_string(endpoint.port());
+		size_t worker;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			worker = workers_.size();
+			workers_.push_back(WorkerStatistics{ name, 0, 0, 0 });
+		}
+
+		std::cout << "Render farm: worker " << worker << " connected from " << name << std::endl;
+
+		threads.emplace_back([this, worker, &served = *connection]() { Serve(served, worker); });
+		connections.push_back(std::move(connection));
+	}
+
+	// The workers that connected since the last range came in are told so, rather than left waiting on a port nobody accepts anymore.
+	for (;;)
+	{
+		RenderFarmConnection connection;
+		boost::system::error_code error;
+		acceptor.accept(connection.Socket, error);
+
+		if (error)
+		{
+			break;
+		}
+
+		try
+		{
+			Welcome(connection, true);
+		}
+		catch (const std::exception& exception)
+		{
+			Utilities::Console::Write(Utilities::Severity::Warning, [&exception]()
+			{
+				std::cerr << "WARNING: late render farm worker turned away: " << exception.what() << std::endl;
+			});
+		}
+	}
+
+	acceptor.close();
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	{
+		ImageExporter exporter;
+		exporter.Export(outputPath, extent_, totalSamples_, std::make_shared<const std::vector<float>>(std::move(sums_)));
+	}
+
+	const double pixelCount = double(extent_.width) * extent_.height;
+
+	std::cout << "Render farm: " << totalSamples_ << " samples from " << workers_.size() << " workers in ";
+	std::cout << std::fixed << std::setprecision(2) << elapsed << "s" << std::endl;
+
+	for (size_t i = 0; i != workers_.size(); ++i)
+	{
+		const auto& worker = workers_[i];
+		const double rate = worker.BusyTime > 0 ? pixelCount * worker.Samples / worker.BusyTime / 1000000 : 0;
+
+		std::cout << "- worker " << i << " (" << worker.Name << "): " << worker.Samples << " samples in " << worker.Ranges << " ranges, ";
+		std::cout << rate << " Msamples/s while busy" << std::endl;
+	}
+
+	std::cout << std::endl;
+}
+
+bool RenderFarmCoordinator::HasRange()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	return !queued_.empty() || std::any_of(inFlight_.begin(), inFlight_.end(), [](const Range& r) { return r.Owners == 1; });
+}
+
+bool RenderFarmCoordinator::AcquireRange(Range& range)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+
+	for (;;)
+	{
+		if (!queued_.empty())
+		{
+			range = queued_.front();
+			range.Owners = 1;
+			queued_.pop_front();
+			inFlight_.push_back(range);
+			return true;
+		}
+
+		// Nothing left to hand out, the idle workers race the ones still tracing.
+		const auto straggler = std::find_if(inFlight_.begin(), inFlight_.end(), [](const Range& r) { return r.Owners == 1; });
+
+		if (straggler != inFlight_.end())
+		{
+			straggler->Owners++;
+			range = *straggler;
+			return true;
+		}
+
+		if (inFlight_.empty())
+		{
+			return false;
+		}
+
+		condition_.wait(lock);
+	}
+}
+
+void RenderFarmCoordinator::CompleteRange(const Range& range, const std::vector<float>& sums, const size_t worker, const double time)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto& statistics = workers_[worker];
+	statistics.BusyTime += time;
+
+	// The other copy of a stolen range may already be in.
+	const auto inFlight = std::find_if(inFlight_.begin(), inFlight_.end(), [&range](const Range& r) { return r.FirstSample == range.FirstSample; });
+
+	if (inFlight == inFlight_.end())
+	{
+		return;
+	}
+
+	for (size_t i = 0; i != sums_.size(); ++i)
+	{
+		sums_[i] += sums[i];
+	}
+
+	inFlight_.erase(inFlight);
+	statistics.Samples += range.SampleCount;
+	statistics.Ranges++;
+	condition_.notify_all();
+}
+
+void RenderFarmCoordinator::ReleaseRange(const Range& range)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	const auto inFlight = std::find_if(inFlight_.begin(), inFlight_.end(), [&range](const Range& r) { return r.FirstSample == range.FirstSample; });
+
+	if (inFlight == inFlight_.end())
+	{
+		return;
+	}
+
+	if (inFlight->Owners > 1)
+	{
+		inFlight->Owners--;
+	}
+	else
+	{
+		queued_.push_front(Range{ inFlight->FirstSample, inFlight->SampleCount, 0 });
+		inFlight_.erase(inFlight);
+	}
+
+	condition_.notify_all();
+}
+
+void RenderFarmCoordinator::Serve(RenderFarmConnection& connection, const size_t worker)
+{
+	Range range{};
+	bool hasRange = false;
+
+	try
+	{
+		// A worker joining once every range is handed out (and stolen) would only wait for the end, it is turned away instead.
+		Welcome(connection, !HasRange());
+
+		std::vector<float> sums(sums_.size());
+
+		while (AcquireRange(range))
+		{
+			hasRange = true;
+
+			const auto start = std::chrono::steady_clock::now();
+			Write(connection.Socket, RangeMessage{ range.FirstSample, range.SampleCount });
+
+			const auto result = Read<ResultMessage>(connection.Socket);
+
+			if (result.FirstSample != range.FirstSample || result.SampleCount != range.SampleCount || result.Size != sums.size() * sizeof(float))
+			{
+				Throw(std::runtime_error("unexpected result"));
+			}
+
+			boost::asio::read(connection.Socket, boost::asio::buffer(sums));
+
+			CompleteRange(range, sums, worker, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			hasRange = false;
+		}
+
+		Write(connection.Socket, RangeMessage{ 0, 0 });
+	}
+	catch (const std::exception& exception)
+	{
+		if (hasRange)
+		{
+			ReleaseRange(range);
+		}
+
+		Utilities::Console::Write(Utilities::Severity::Warning, [&exception, worker]()
+		{
+			std::cerr << "WARNING: render farm worker " << worker << " dropped: " << exception.what() << std::endl;
+		});
+	}
+}
+
+void RenderFarmCoordinator::Welcome(RenderFarmConnection& connection, const bool isFinished) const
+{
+	const auto hello = Read<HelloMessage>(connection.Socket);
+
+	if (!IsFarmMagic(hello.Magic))
+	{
+		Throw(std::runtime_error("not a render farm worker"));
+	}
+
+	auto status = WelcomeStatus::Accepted;
+	std::string reason;
+
+	if (!HasSameFormat(hello.ByteOrder, hello.SampleFormat))
+	{
+		status = WelcomeStatus::Incompatible;
+		reason = "the worker has another byte order or float format";
+	}
+	else if (hello.Version != ProtocolVersion)
+	{
+		status = WelcomeStatus::Incompatible;
+		reason = "the worker speaks version " + std::to_string(hello.Version) + " of the protocol";
+	}
+	else if (hello.Width != extent_.width || hello.Height != extent_.height)
+	{
+		status = WelcomeStatus::WrongExtent;
+		reason = "the worker renders at " + std::to_string(hello.Width) + "x" + std::to_string(hello.Height);
+	}
+	else if (isFinished)
+	{
+		status = WelcomeStatus::Finished;
+		reason = "no samples left to trace";
+	}
+
+	Write(connection.Socket, WelcomeMessage{ ProtocolMagic, ProtocolVersion, ByteOrderMarker, SampleFormatMarker, status });
+
+	if (status != WelcomeStatus::Accepted)
+	{
+		Throw(std::runtime_error(reason));
+	}
+}
+
+RenderFarmWorker::RenderFarmWorker(const std::string& coordinator, const VkExtent2D extent) :
+	connection_(new RenderFarmConnection())
+{
+	const auto separator = coordinator.rfind(':');
+
+	if (separator == std::string::npos)
+	{
+		Throw(std::invalid_argument("the render farm coordinator must be given as host:port"));
+	}
+
+	tcp::resolver resolver(connection_->Context);
+	boost::asio::connect(connection_->Socket, resolver.resolve(coordinator.substr(0, separator), coordinator.substr(separator + 1)));
+
+	Write(connection_->Socket, HelloMessage{ ProtocolMagic, ProtocolVersion, ByteOrderMarker, SampleFormatMarker, extent.width, extent.height });
+
+	const auto welcome = Read<WelcomeMessage>(connection_->Socket);
+
+	if (!IsFarmMagic(welcome.Magic))
+	{
+		Throw(std::runtime_error("'" + coordinator + "' is not a render farm coordinator"));
+	}
+
+	if (!HasSameFormat(welcome.ByteOrder, welcome.SampleFormat))
+	{
+		Throw(std::runtime_error("the render farm coordinator has another byte order or float format"));
+	}
+
+	if (welcome.Version != ProtocolVersion)
+	{
+		Throw(std::runtime_error("the render farm coordinator speaks version " + std::to_string(welcome.Version) + " of the protocol"));
+	}
+
+	switch (welcome.Status)
+	{
+	case WelcomeStatus::Accepted: break;
+	case WelcomeStatus::Incompatible: Throw(std::runtime_error("the render farm coordinator refused the worker, its protocol or sample format differs"));
+	case WelcomeStatus::WrongExtent: Throw(std::runtime_error("the render farm coordinator renders at another extent"));
+	case WelcomeStatus::Finished: Throw(std::runtime_error("the render farm coordinator has no samples left to trace"));
+	default: Throw(std::runtime_error("unexpected render farm welcome"));
+	}
+
+	std::cout << "Render farm: connected to " << coordinator << std::endl;
+}
+
+RenderFarmWorker::~RenderFarmWorker()
+{
+}
+
+bool RenderFarmWorker::NextRange(uint32_t& firstSample, uint32_t& sampleCount)
+{
+	const auto range = Read<RangeMessage>(connection_->Socket);
+
+	firstSample_ = firstSample = range.FirstSample;
+	sampleCount_ = sampleCount = range.SampleCount;
+
+	return sampleCount != 0;
+}
+
+void RenderFarmWorker::SendResult(const VkExtent2D extent, const std::vector<float>& pixels)
+{
+	if (pixels.size() != size_t(extent.width) * extent.height * 4)
+	{
+		Throw(std::runtime_error("unexpected accumulation size"));
+	}
+
+	Write(connection_->Socket, ResultMessage{ firstSample_, sampleCount_, pixels.size() * sizeof(float) });
+	boost::asio::write(connection_->Socket, boost::asio::buffer(pixels));
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "Vulkan/Vulkan.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct RenderFarmConnection; // The TCP socket, kept out of the header.
+
+// A render farm over TCP, for the images that take too long to accumulate on a single machine (see --coordinator and --worker).
+// The coordinator splits the samples of every pixel into ranges that the workers pull one at a time, each worker being a headless
+// application rendering the same scene. A worker sends back the RGBA32F accumulation sums of its range before getting the next one,
+// so the faster GPUs simply end up with more ranges. Once the queue is empty, an idle worker steals a copy of the oldest range still
+// being traced and the first result in wins. The range of a worker that disconnects goes back to the queue. A worker joining once
+// there is nothing left to hand out is turned away, as is one with another protocol version, byte order, float format or extent.
+class RenderFarmCoordinator final
+{
+public:
+
+	VULKAN_NON_COPIABLE(RenderFarmCoordinator)
+
+	RenderFarmCoordinator(uint16_t port, VkExtent2D extent, uint32_t totalSamples, uint32_t rangeSamples);
+	~RenderFarmCoordinator();
+
+	// Serves the workers until all the samples are in, then exports the merged accumulation and reports the share of every worker.
+	void Run(const std::string& outputPath);
+
+private:
+
+	struct Range final
+	{
+		uint32_t FirstSample;
+		uint32_t SampleCount;
+		uint32_t Owners; // More than one once stolen.
+	};
+
+	struct WorkerStatistics final
+	{
+		std::string Name;
+		uint32_t Samples;
+		uint32_t Ranges;
+		double BusyTime; // seconds
+	};
+
+	bool HasRange(); // Whether AcquireRange() would hand out a range right away.
+	bool AcquireRange(Range& range);
+	void CompleteRange(const Range& range, const std::vector<float>& sums, size_t worker, double time);
+	void ReleaseRange(const Range& range);
+	void Serve(RenderFarmConnection& connection, size_t worker);
+	void Welcome(RenderFarmConnection& connection, bool isFinished) const; // Answers the hello of a worker, throws unless accepted.
+
+	const uint16_t port_;
+	const VkExtent2D extent_;
+	const uint32_t totalSamples_;
+
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	std::deque<Range> queued_;
+	std::vector<Range> inFlight_; // Oldest first.
+	std::vector<float> sums_;
+	std::vector<WorkerStatistics> workers_;
+};
+
+// The connection of a headless application to the coordinator, see RayTracer::SetSampleRangeSource().
+class RenderFarmWorker final
+{
+public:
+
+	VULKAN_NON_COPIABLE(RenderFarmWorker)
+
+	// The coordinator is given as host:port, the extent must match its own. Throws if the coordinator turns the worker away.
+	RenderFarmWorker(const std::string& coordinator, VkExtent2D extent);
+	~RenderFarmWorker();
+
+	// Blocks until the coordinator assigns the next range of samples, false once there are none left.
+	bool NextRange(uint32_t& firstSample, uint32_t& sampleCount);
+
+	// Sends the accumulation sums of the last assigned range.
+	void SendResult(VkExtent2D extent, const std::vector<float>& pixels);
+
+private:
+
+	std::unique_ptr<RenderFarmConnection> connection_;
+	uint32_t firstSample_{};
+	uint32_t sampleCount_{};
+};
@@ -0,0 +1,437 @@
+#include "RenderQueue.hpp"
+#include "SceneList.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/Exception.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// The whitespace separated tokens of one line, see the scene file statements.
+	class Statement final
+	{
+	public:
+
+		Statement(const std::string& path, const size_t line, const std::string& text) :
+			path_(path), line_(line), tokens_(text.substr(0, text.find('#')))
+		{
+		}
+
+		bool IsEnd()
+		{
+			tokens_ >> std::ws;
+			return tokens_.eof();
+		}
+
+		bool Accept(const std::string& keyword)
+		{
+			if (IsEnd())
+			{
+				return false;
+			}
+
+			const auto position = tokens_.tellg();
+			std::string word;
+			tokens_ >> word;
+
+			if (word == keyword)
+			{
+				return true;
+			}
+
+			tokens_.seekg(position);
+			return false;
+		}
+
+		std::string Word(const char* const what)
+		{
+			std::string word;
+
+			if (!(tokens_ >> word))
+			{
+				Fail(std::string("missing ") + what);
+			}
+
+			return word;
+		}
+
+		float Float(const char* const what)
+		{
+			const std::string token = Word(what);
+			size_t end = 0;
+			float value = 0;
+
+			try
+			{
+				value = std::stof(token, &end);
+			}
+			catch (const std::exception&)
+			{
+				end = 0;
+			}
+
+			if (end != token.size())
+			{
+				Fail(std::string("invalid ") + what + " '" + token + "'");
+			}
+
+			return value;
+		}
+
+		uint32_t UInt(const char* const what)
+		{
+			const std::string token = Word(what);
+
+			if (token.empty() || !std::all_of(token.begin(), token.end(), [](const char c) { return c >= '0' && c <= '9'; }) || token.size() > 9)
+			{
+				Fail(std::string("invalid ") + what + " '" + token + "'");
+			}
+
+			return static_cast<uint32_t>(std::stoul(token));
+		}
+
+		glm::vec3 Vec3(const char* const what)
+		{
+			const float x = Float(what);
+			const float y = Float(what);
+			const float z = Float(what);
+
+			return glm::vec3(x, y, z);
+		}
+
+		[[noreturn]] void Fail(const std::string& message) const
+		{
+			Throw(std::runtime_error(path_ + ":" + std::to_string(line_) + ": " + message));
+		}
+
+	private:
+
+		const std::string& path_;
+		const size_t line_;
+		std::istringstream tokens_;
+	};
+
+	bool IsSceneFile(const RenderJob& job)
+	{
+		return job.SceneIndex == SceneList::AllScenes.size();
+	}
+
+	std::string SceneName(const RenderJob& job)
+	{
+		return IsSceneFile(job) ? job.SceneFile : SceneList::AllScenes[job.SceneIndex].first;
+	}
+
+	// Quoted for the CSV, the names and paths may hold commas.
+	std::string Quote(const std::string& text)
+	{
+		std::string quoted = "\"";
+
+		for (const char c : text)
+		{
+			quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+		}
+
+		return quoted + "\"";
+	}
+
+	double Seconds(const std::chrono::steady_clock::duration duration)
+	{
+		return std::chrono::duration<double>(duration).count();
+	}
+}
+
+RenderQueue::RenderQueue(const std::string& directory, const RenderJob& defaults) :
+	directory_(directory),
+	defaults_(defaults),
+	previousScene_(SceneName(defaults))
+{
+	std::filesystem::create_directories(directory_);
+
+	// A job left running by a previous process may well be what brought it down, it is not tried again.
+	for (const auto& entry : std::filesystem::directory_iterator(directory_))
+	{
+		if (entry.is_regular_file() && entry.path().extension() == ".running")
+		{
+			RenderJob job = defaults_;
+			job.Name = entry.path().stem().string();
+
+			std::error_code error;
+			std::filesystem::rename(entry.path(), JobPath(job.Name, ".failed"), error);
+			Finish(job, "interrupted", 0, 0, 0);
+			++failedCount_;
+		}
+	}
+
+	std::cout << "Render queue: waiting for jobs in '" << directory_ << "'" << std::endl;
+}
+
+RenderQueue::~RenderQueue()
+{
+	std::cout << "Render queue: " << doneCount_ << " jobs done, " << failedCount_ << " failed" << std::endl;
+}
+
+bool RenderQueue::Next(RenderJob& job)
+{
+	constexpr auto pollPeriod = std::chrono::milliseconds(250);
+
+	const auto stopPath = std::filesystem::path(directory_) / "stop";
+
+	for (;;)
+	{
+		// The stop file is left for the other processes serving the directory, it is removed by hand before starting them again.
+		if (std::filesystem::exists(stopPath))
+		{
+			std::cout << "Render queue: stopped" << std::endl;
+			return false;
+		}
+
+		std::vector<std::string> names;
+
+		for (const auto& entry : std::filesystem::directory_iterator(directory_))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".job")
+			{
+				names.push_back(entry.path().stem().string());
+			}
+		}
+
+		std::sort(names.begin(), names.end());
+
+		for (const auto& name : names)
+		{
+			// Another process may have claimed the job in the meantime.
+			std::error_code error;
+			std::filesystem::rename(JobPath(name, ".job"), JobPath(name, ".running"), error);
+
+			if (error)
+			{
+				continue;
+			}
+
+			try
+			{
+				job = Parse(name);
+			}
+			catch (const std::exception& exception)
+			{
+				Utilities::Console::Write(Utilities::Severity::Error, [&exception]()
+				{
+					std::cerr << "ERROR: " << exception.what() << std::endl;
+				});
+
+				RenderJob failed = defaults_;
+				failed.Name = name;
+
+				std::filesystem::rename(JobPath(name, ".running"), JobPath(name, ".failed"), error);
+				Finish(failed, "failed", 0, 0, 0);
+				++failedCount_;
+				continue;
+			}
+
+			takenTime_ = Clock::now();
+			traceTime_ = {};
+			progressTime_ = {};
+
+			std::cout << "Job '" << job.Name << "': " << SceneName(job) << (SceneName(job) == previousScene_ ? " (already loaded)" : "") << ", ";
+			std::cout << job.Extent.width << "x" << job.Extent.height << ", " << job.Samples << " samples to '" << job.Output << "'" << std::endl;
+
+			return true;
+		}
+
+		std::this_thread::sleep_for(pollPeriod);
+	}
+}
+
+void RenderQueue::Report(const RenderJob& job, const uint32_t samples, const bool isDone)
+{
+	constexpr auto progressPeriod = std::chrono::seconds(1);
+
+	const auto now = Clock::now();
+
+	if (samples != 0 && traceTime_ == Clock::time_point{})
+	{
+		traceTime_ = now;
+	}
+
+	const bool isTracing = traceTime_ != Clock::time_point{};
+	const double setupTime = Seconds((isTracing ? traceTime_ : now) - takenTime_);
+	const double traceTime = isTracing ? Seconds(now - traceTime_) : 0;
+	const double rate = traceTime > 0 ? double(job.Extent.width) * job.Extent.height * samples / traceTime / 1000000 : 0;
+
+	if (isDone)
+	{
+		std::error_code error;
+		std::filesystem::rename(JobPath(job.Name, ".running"), JobPath(job.Name, ".done"), error);
+		Finish(job, "done", samples, setupTime, traceTime);
+		previousScene_ = SceneName(job);
+		++doneCount_;
+
+		std::cout << "\rJob '" << job.Name << "': " << samples << " samples in " << std::fixed << std::setprecision(2) << traceTime << "s after ";
+		std::cout << setupTime << "s of setup, " << rate << " Msamples/s" << std::defaultfloat << std::endl;
+		return;
+	}
+
+	if (now - progressTime_ < progressPeriod)
+	{
+		return;
+	}
+
+	progressTime_ = now;
+
+	std::cout << "\rJob '" << job.Name << "': " << samples << "/" << job.Samples << " samples, ";
+	std::cout << std::fixed << std::setprecision(2) << rate << " Msamples/s" << std::defaultfloat << std::flush;
+}
+
+RenderJob RenderQueue::Parse(const std::string& name) const
+{
+	const auto path = JobPath(name, ".running");
+	std::ifstream file(path);
+
+	if (!file)
+	{
+		Throw(std::runtime_error("cannot open render job '" + path + "'"));
+	}
+
+	RenderJob job = defaults_;
+	job.Name = name;
+	job.Output = (std::filesystem::path(directory_) / (name + std::filesystem::path(defaults_.Output).extension().string())).string();
+
+	std::string line;
+	size_t lineNumber = 0;
+
+	while (std::getline(file, line))
+	{
+		Statement statement(path, ++lineNumber, line);
+
+		if (statement.IsEnd())
+		{
+			continue;
+		}
+
+		const auto keyword = statement.Word("statement");
+
+		if (keyword == "scene")
+		{
+			// A number is a built-in scene, anything else a scene file.
+			const auto scene = statement.Word("scene");
+
+			if (std::all_of(scene.begin(), scene.end(), [](const char c) { return c >= '0' && c <= '9'; }) && scene.size() < 9)
+			{
+				job.SceneIndex = static_cast<uint32_t>(std::stoul(scene));
+				job.SceneFile.clear();
+
+				if (job.SceneIndex >= SceneList::AllScenes.size())
+				{
+					statement.Fail("scene index is too large");
+				}
+			}
+			else
+			{
+				job.SceneIndex = static_cast<uint32_t>(SceneList::AllScenes.size());
+				job.SceneFile = scene;
+
+				if (!std::filesystem::is_regular_file(scene))
+				{
+					statement.Fail("cannot find scene file '" + scene + "'");
+				}
+			}
+		}
+		else if (keyword == "camera")
+		{
+			job.HasCamera = true;
+			job.Up = glm::vec3(0, 1, 0);
+
+			bool hasEye = false;
+			bool hasTarget = false;
+
+			while (!statement.IsEnd())
+			{
+				if (statement.Accept("eye")) { job.Eye = statement.Vec3("eye position"); hasEye = true; }
+				else if (statement.Accept("target")) { job.Target = statement.Vec3("target position"); hasTarget = true; }
+				else if (statement.Accept("up")) job.Up = statement.Vec3("up vector");
+				else if (statement.Accept("fov")) job.FieldOfView = statement.Float("field of view");
+				else if (statement.Accept("aperture")) job.Aperture = statement.Float("aperture");
+				else if (statement.Accept("focus")) job.FocusDistance = statement.Float("focus distance");
+				else statement.Fail("unexpected '" + statement.Word("camera property") + "'");
+			}
+
+			if (!hasEye || !hasTarget || job.Eye == job.Target)
+			{
+				statement.Fail("the camera requires distinct eye and target positions");
+			}
+		}
+		else if (keyword == "resolution")
+		{
+			job.Extent.width = statement.UInt("width");
+			job.Extent.height = statement.UInt("height");
+
+			if (job.Extent.width == 0 || job.Extent.height == 0)
+			{
+				statement.Fail("invalid resolution");
+			}
+		}
+		else if (keyword == "samples")
+		{
+			job.Samples = statement.UInt("sample count");
+
+			if (job.Samples == 0)
+			{
+				statement.Fail("invalid sample count");
+			}
+		}
+		else if (keyword == "output")
+		{
+			job.Output = statement.Word("output path");
+		}
+		else
+		{
+			statement.Fail("unknown statement '" + keyword + "'");
+		}
+
+		if (!statement.IsEnd())
+		{
+			statement.Fail("unexpected '" + statement.Word("token") + "'");
+		}
+	}
+
+	return job;
+}
+
+void RenderQueue::Finish(const RenderJob& job, const std::string& status, const uint32_t samples, const double setupTime, const double traceTime) const
+{
+	const auto reportPath = std::filesystem::path(directory_) / "queue.csv";
+	const bool isNew = !std::filesystem::exists(reportPath);
+	std::ofstream report(reportPath, std::ios::app);
+
+	if (!report)
+	{
+		Utilities::Console::Write(Utilities::Severity::Warning, [&reportPath]()
+		{
+			std::cerr << "WARNING: cannot write the render queue report '" << reportPath.string() << "'" << std::endl;
+		});
+
+		return;
+	}
+
+	if (isNew)
+	{
+		report << "job,status,scene,width,height,samples,setup_s,trace_s,msamples_per_s,output\n";
+	}
+
+	const double rate = traceTime > 0 ? double(job.Extent.width) * job.Extent.height * samples / traceTime / 1000000 : 0;
+
+	report << Quote(job.Name) << ',' << status << ',' << Quote(SceneName(job)) << ',' << job.Extent.width << ',' << job.Extent.height << ',' << samples << ','
+		<< std::fixed << std::setprecision(3) << setupTime << ',' << traceTime << ',' << rate << ',' << Quote(job.Output) << '\n';
+}
+
+std::string RenderQueue::JobPath(const std::string& name, const char* const extension) const
+{
+	return (std::filesystem::path(directory_) / (name + extension)).string();
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "Utilities/Glm.hpp"
+#include "Vulkan/Vulkan.hpp"
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// An image to render, see RayTracer::SetRenderJobSource(). What its file leaves out comes from the command line.
+struct RenderJob final
+{
+	std::string Name; // The job file name without its extension.
+	uint32_t SceneIndex;
+	std::string SceneFile; // When SceneIndex is past the built-in scenes.
+	bool HasCamera; // Otherwise the camera of the scene.
+	glm::vec3 Eye;
+	glm::vec3 Target;
+	glm::vec3 Up;
+	std::optional<float> FieldOfView; // degrees, otherwise the one of the scene, like the lens values.
+	std::optional<float> Aperture;
+	std::optional<float> FocusDistance;
+	VkExtent2D Extent;
+	uint32_t Samples;
+	std::string Output;
+};
+
+// The render jobs of --queue, for batches of offline images rendered by one long-lived headless process, keeping the device, the
+// pipelines, the texture cache and the scene while the jobs share it. A job is a file dropped in the queue directory as <name>.job
+// (written elsewhere or under another extension first, then renamed in), one statement per line in the spirit of the scene files:
+//
+//   # A comment.
+//   scene <index> | <scene file>
+//   camera eye <x y z> target <x y z> [up <x y z>] [fov <degrees>] [aperture <a>] [focus <d>]
+//   resolution <width> <height>
+//   samples <count>
+//   output <path>
+//
+// The jobs are taken in file name order and renamed to <name>.running, then <name>.done once their image is written or <name>.failed
+// if they cannot be rendered. Every job, done or failed, gets a line in queue.csv with its setup and trace times and its throughput.
+// Several processes can serve the same directory, the rename claiming a job for one of them. A file named stop in the directory ends
+// the process once the current job is done. The relative paths are those of the working directory, as on the command line.
+class RenderQueue final
+{
+public:
+
+	VULKAN_NON_COPIABLE(RenderQueue)
+
+	RenderQueue(const std::string& directory, const RenderJob& defaults);
+	~RenderQueue();
+
+	// Blocks until a job is submitted, false once the process is asked to stop. The jobs that fail to parse are failed on the way.
+	bool Next(RenderJob& job);
+
+	// The samples accumulated so far by the job Next() returned, every frame, the last time once its image is written.
+	void Report(const RenderJob& job, uint32_t samples, bool isDone);
+
+private:
+
+	using Clock = std::chrono::steady_clock;
+
+	RenderJob Parse(const std::string& path) const;
+	void Finish(const RenderJob& job, const std::string& status, uint32_t samples, double setupTime, double traceTime) const;
+	std::string JobPath(const std::string& name, const char* extension) const;
+
+	const std::string directory_;
+	const RenderJob defaults_;
+	std::string previousScene_; // Of the last job, a new one with the same scene does not load it again.
+	Clock::time_point takenTime_{};
+	Clock::time_point traceTime_{}; // Of the first traced samples, the scene and the images are set up by then.
+	Clock::time_point progressTime_{};
+	uint32_t doneCount_{};
+	uint32_t failedCount_{};
+};
@@ -0,0 +1,516 @@
+#include "SceneFile.hpp"
+#include "GltfScene.hpp"
+#include "Assets/DensityGrid.hpp"
+#include "Assets/Material.hpp"
+#include "Assets/Model.hpp"
+#include "Assets/ModelInstance.hpp"
+#include "Assets/Texture.hpp"
+#include "Utilities/Exception.hpp"
+#include "Utilities/MappedFile.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+using namespace glm;
+using Assets::Material;
+using Assets::Model;
+using Assets::ModelInstance;
+using Assets::Texture;
+
+namespace
+{
+	// The whitespace separated tokens of one line, pointing into the mapped file.
+	class Statement final
+	{
+	public:
+
+		Statement(const std::string& path, const size_t line, std::vector<std::string_view>&& tokens) :
+			path_(path), line_(line), tokens_(std::move(tokens))
+		{
+		}
+
+		bool IsEnd() const { return next_ == tokens_.size(); }
+		bool Accept(const std::string_view keyword)
+		{
+			if (!IsEnd() && tokens_[next_] == keyword)
+			{
+				++next_;
+				return true;
+			}
+
+			return false;
+		}
+
+		std::string_view Word(const char* const what)
+		{
+			if (IsEnd())
+			{
+				Fail(std::string("missing ") + what);
+			}
+
+			return tokens_[next_++];
+		}
+
+		float Float(const char* const what)
+		{
+			const std::string token(Word(what));
+			size_t end = 0;
+			float value = 0;
+
+			try
+			{
+				value = std::stof(token, &end);
+			}
+			catch (const std::exception&)
+			{
+				end = 0;
+			}
+
+			if (end != token.size())
+			{
+				Fail(std::string("invalid ") + what + " '" + token + "'");
+			}
+
+			return value;
+		}
+
+		vec3 Vec3(const char* const what)
+		{
+			const float x = Float(what);
+			const float y = Float(what);
+			const float z = Float(what);
+
+			return vec3(x, y, z);
+		}
+
+		// Only numbers follow, e.g. the three components of a scale rather than a single one.
+		bool IsNumber() const
+		{
+			return !IsEnd() && (std::isdigit(static_cast<unsigned char>(tokens_[next_][0])) || tokens_[next_][0] == '-' || tokens_[next_][0] == '.');
+		}
+
+		void ExpectEnd()
+		{
+			if (!IsEnd())
+			{
+				Fail("unexpected '" + std::string(tokens_[next_]) + "'");
+			}
+		}
+
+		[[noreturn]] void Fail(const std::string& message) const
+		{
+			Throw(std::runtime_error(path_ + ":" + std::to_string(line_) + ": " + message));
+		}
+
+	private:
+
+		const std::string& path_;
+		const size_t line_;
+		const std::vector<std::string_view> tokens_;
+		size_t next_{};
+	};
+
+	template <class Map>
+	uint32_t Find(Statement& statement, const Map& map, const char* const what)
+	{
+		const auto name = statement.Word(what);
+		const auto i = map.find(name);
+
+		if (i == map.end())
+		{
+			statement.Fail(std::string("unknown ") + what + " '" + std::string(name) + "'");
+		}
+
+		return i->second;
+	}
+}
+
+SceneAssets SceneFile::Load(const std::string& path, SceneList::CameraInitialSate& camera, const SceneList::SceneOptions& options, Utilities::TaskSystem& tasks)
+{
+	camera.ModelView = lookAt(vec3(0, 0, 1), vec3(0, 0, 0), vec3(0, 1, 0));
+	camera.FieldOfView = 45;
+	camera.Aperture = 0;
+	camera.FocusDistance = 1;
+	camera.ControlSpeed = 1;
+	camera.GammaCorrection = true;
+	camera.HasSky = true;
+
+	// A glTF file is a scene of its own, framed from the front.
+	if (std::filesystem::path(path).extension() == ".glb")
+	{
+		auto assets = GltfScene::Load(path, 0, tasks);
+		vec3 low(std::numeric_limits<float>::max()), high(-std::numeric_limits<float>::max());
+
+		for (const auto& instance : std::get<2>(assets))
+		{
+			for (const auto& vertex : std::get<0>(assets)[instance.ModelId].Vertices())
+			{
+				const vec3 position = instance.Transform * vec4(vertex.Position, 1);
+				low = min(low, position);
+				high = max(high, position);
+			}
+		}
+
+		const vec3 center = 0.5f * (low + high);
+		const float radius = std::max(0.5f * length(high - low), 1e-3f);
+
+		camera.ModelView = lookAt(center + vec3(0, 0, radius / std::sin(radians(0.5f * camera.FieldOfView))), center, vec3(0, 1, 0));
+		camera.FocusDistance = radius / std::sin(radians(0.5f * camera.FieldOfView));
+		camera.ControlSpeed = radius;
+
+		return assets;
+	}
+
+	const Utilities::MappedFile file(path);
+
+	if (!file.IsMapped())
+	{
+		Throw(std::runtime_error("cannot open scene file '" + path + "'"));
+	}
+
+	// The names only live as long as the mapping, the assets get plain indices.
+	std::unordered_map<std::string_view, uint32_t> textureIds;
+	std::unordered_map<std::string_view, uint32_t> materialIds;
+	std::unordered_map<std::string_view, uint32_t> modelIds;
+
+	std::vector<std::future<Texture>> textures;
+	std::vector<Material> materials;
+	std::vector<std::future<Model>> models;
+	std::vector<ModelInstance> instances;
+
+	const auto* const begin = reinterpret_cast<const char*>(file.Data());
+	const auto* const end = begin + file.Size();
+	size_t lineNumber = 0;
+
+	for (const char* line = begin; line < end; )
+	{
+		const char* lineEnd = line;
+
+		while (lineEnd != end && *lineEnd != '\n')
+		{
+			++lineEnd;
+		}
+
+		++lineNumber;
+
+		std::vector<std::string_view> tokens;
+
+		for (const char* token = line; token != lineEnd && *token != '#'; )
+		{
+			if (std::isspace(static_cast<unsigned char>(*token)))
+			{
+				++token;
+				continue;
+			}
+
+			const char* tokenEnd = token;
+
+			while (tokenEnd != lineEnd && !std::isspace(static_cast<unsigned char>(*tokenEnd)))
+			{
+				++tokenEnd;
+			}
+
+			tokens.emplace_back(token, static_cast<size_t>(tokenEnd - token));
+			token = tokenEnd;
+		}
+
+		line = lineEnd + 1;
+
+		if (tokens.empty())
+		{
+			continue;
+		}
+
+		Statement statement(path, lineNumber, std::move(tokens));
+
+		if (statement.Accept("camera"))
+		{
+			vec3 eye(0, 0, 1), target(0), up(0, 1, 0);
+
+			while (!statement.IsEnd())
+			{
+				if (statement.Accept("eye")) eye = statement.Vec3("camera eye");
+				else if (statement.Accept("target")) target = statement.Vec3("camera target");
+				else if (statement.Accept("up")) up = statement.Vec3("camera up");
+				else if (statement.Accept("fov")) camera.FieldOfView = statement.Float("camera field of view");
+				else if (statement.Accept("aperture")) camera.Aperture = statement.Float("camera aperture");
+				else if (statement.Accept("focus")) camera.FocusDistance = statement.Float("camera focus distance");
+				else if (statement.Accept("speed")) camera.ControlSpeed = statement.Float("camera speed");
+				else if (statement.Accept("gamma")) camera.GammaCorrection = statement.Float("camera gamma") != 0;
+				else if (statement.Accept("sky")) camera.HasSky = statement.Float("camera sky") != 0;
+				else statement.Fail("unknown camera property '" + std::string(statement.Word("camera property")) + "'");
+			}
+
+			camera.ModelView = lookAt(eye, target, up);
+		}
+		else if (statement.Accept("rays"))
+		{
+			while (!statement.IsEnd())
+			{
+				if (statement.Accept("opaque"))
+				{
+					const auto depth = statement.Float("opaque depth");
+
+					if (!(depth >= 0))
+					{
+						statement.Fail("invalid opaque depth");
+					}
+
+					camera.OpaqueDepth = static_cast<uint32_t>(depth);
+				}
+				else statement.Fail("unknown rays property '" + std::string(statement.Word("rays property")) + "'");
+			}
+		}
+		else if (statement.Accept("texture"))
+		{
+			const auto name = statement.Word("texture name");
+			const std::string texturePath(statement.Word("texture path"));
+			statement.ExpectEnd();
+
+			textureIds[name] = static_cast<uint32_t>(textures.size());
+			textures.push_back(tasks.Run([texturePath]() { return Texture::LoadTexture(texturePath, Vulkan::SamplerConfig()); }));
+		}
+		else if (statement.Accept("material"))
+		{
+			const auto name = statement.Word("material name");
+			Material material;
+
+			if (statement.Accept("lambertian")) material = Material::Lambertian(statement.Vec3("lambertian colour"));
+			else if (statement.Accept("metallic"))
+			{
+				const auto colour = statement.Vec3("metallic colour");
+				material = Material::Metallic(colour, statement.Float("metallic fuzziness"));
+			}
+			else if (statement.Accept("dielectric")) material = Material::Dielectric(statement.Float("refraction index"));
+			else if (statement.Accept("isotropic"))
+			{
+				const auto colour = statement.Vec3("isotropic colour");
+				material = Material::Isotropic(colour, statement.Accept("density") ? statement.Float("isotropic density") : 1.0f);
+			}
+			else if (statement.Accept("light")) material = Material::DiffuseLight(statement.Vec3("light colour"));
+			else statement.Fail("unknown material model '" + std::string(statement.Word("material model")) + "'");
+
+			if (statement.Accept("texture"))
+			{
+				material.DiffuseTextureId = static_cast<int32_t>(Find(statement, textureIds, "texture"));
+			}
+
+			if (statement.Accept("alpha"))
+			{
+				material.AlphaCutoff = statement.Float("alpha cutoff");
+			}
+
+			statement.ExpectEnd();
+
+			materialIds[name] = static_cast<uint32_t>(materials.size());
+			materials.push_back(material);
+		}
+		else if (statement.Accept("model"))
+		{
+			const auto name = statement.Word("model name");
+
+			if (statement.Accept("obj") || statement.Accept("ply"))
+			{
+				const std::string modelPath(statement.Word("model path"));
+				models.push_back(tasks.Run([modelPath, gpuNormals = options.GpuNormals]() { return Model::LoadModel(modelPath, gpuNormals); }));
+			}
+			else
+			{
+				std::optional<Model> shape;
+
+				if (statement.Accept("sphere"))
+				{
+					const auto center = statement.Vec3("sphere center");
+					const auto radius = statement.Float("sphere radius");
+					shape.emplace(Model::CreateSphere(center, radius, materials[Find(statement, materialIds, "material")], !options.TessellatedSpheres));
+				}
+				else if (statement.Accept("box"))
+				{
+					const auto p0 = statement.Vec3("box corner");
+					const auto p1 = statement.Vec3("box corner");
+					shape.emplace(Model::CreateBox(p0, p1, materials[Find(statement, materialIds, "material")]));
+				}
+				else if (statement.Accept("cornellbox"))
+				{
+					shape.emplace(Model::CreateCornellBox(statement.Float("cornell box scale")));
+				}
+				else
+				{
+					statement.Fail("unknown model type '" + std::string(statement.Word("model type")) + "'");
+				}
+
+				// The density grid of a heterogeneous medium is generated or loaded on the task system.
+				if (statement.Accept("density"))
+				{
+					std::function<Assets::DensityGrid()> grid;
+
+					if (statement.Accept("noise"))
+					{
+						const auto resolution = statement.Float("noise resolution");
+						const auto frequency = statement.Float("noise frequency");
+						const auto seed = statement.IsNumber() ? statement.Float("noise seed") : 0.0f;
+
+						if (resolution < 1 || resolution > 512 || seed < 0)
+						{
+							statement.Fail("invalid density noise");
+						}
+
+						grid = [resolution, frequency, seed]() { return Assets::DensityGrid::CreateNoise(static_cast<uint32_t>(resolution), frequency, static_cast<uint32_t>(seed)); };
+					}
+					else if (statement.Accept("raw"))
+					{
+						const std::string gridPath(statement.Word("density grid path"));
+						const auto resolution = statement.Vec3("density grid resolution");
+
+						if (any(lessThan(resolution, vec3(1))))
+						{
+							statement.Fail("invalid density grid resolution");
+						}
+
+						grid = [gridPath, resolution]() { return Assets::DensityGrid::LoadRaw(gridPath, uvec3(resolution)); };
+					}
+					else
+					{
+						statement.Fail("unknown density grid '" + std::string(statement.Word("density grid")) + "'");
+					}
+
+					models.push_back(tasks.Run([model = std::move(*shape), grid]() mutable
+					{
+						model.SetDensityGrid(std::make_shared<const Assets::DensityGrid>(grid()));
+						return std::move(model);
+					}));
+				}
+				else
+				{
+					std::promise<Model> model;
+					model.set_value(std::move(*shape));
+					models.push_back(model.get_future());
+				}
+			}
+
+			statement.ExpectEnd();
+			modelIds[name] = static_cast<uint32_t>(models.size() - 1);
+		}
+		else if (statement.Accept("gltf"))
+		{
+			// Its meshes and textures come after those already declared, its nodes add their instances.
+			const std::string gltfPath(statement.Word("glTF path"));
+			statement.ExpectEnd();
+
+			auto [gltfModels, gltfTextures, gltfInstances] = GltfScene::Load(gltfPath, static_cast<int32_t>(textures.size()), tasks);
+
+			for (auto& instance : gltfInstances)
+			{
+				instance.ModelId += static_cast<uint32_t>(models.size());
+				instances.push_back(std::move(instance));
+			}
+
+			for (auto& model : gltfModels)
+			{
+				std::promise<Model> loaded;
+				loaded.set_value(std::move(model));
+				models.push_back(loaded.get_future());
+			}
+
+			for (auto& texture : gltfTextures)
+			{
+				std::promise<Texture> loaded;
+				loaded.set_value(std::move(texture));
+				textures.push_back(loaded.get_future());
+			}
+		}
+		else if (statement.Accept("instance"))
+		{
+			ModelInstance instance{ Find(statement, modelIds, "model"), mat4(1), {} };
+
+			while (!statement.IsEnd())
+			{
+				if (statement.Accept("translate"))
+				{
+					instance.Transform = translate(mat4(1), statement.Vec3("translation")) * instance.Transform;
+				}
+				else if (statement.Accept("rotate"))
+				{
+					const auto degrees = statement.Float("rotation angle");
+					instance.Transform = rotate(mat4(1), radians(degrees), statement.Vec3("rotation axis")) * instance.Transform;
+				}
+				else if (statement.Accept("scale"))
+				{
+					vec3 scaling(statement.Float("scale"));
+
+					if (statement.IsNumber())
+					{
+						scaling.y = statement.Float("scale");
+						scaling.z = statement.Float("scale");
+					}
+
+					instance.Transform = scale(mat4(1), scaling) * instance.Transform;
+				}
+				else if (statement.Accept("material"))
+				{
+					instance.MaterialOverride = materials[Find(statement, materialIds, "material")];
+				}
+				else if (statement.Accept("cull"))
+				{
+					// The bounce rays from this depth on skip it.
+					const auto depth = statement.Float("cull depth");
+
+					if (!(depth >= 0))
+					{
+						statement.Fail("invalid cull depth");
+					}
+
+					for (uint32_t bounce = static_cast<uint32_t>(depth); bounce < Assets::BounceRayMaskCount; ++bounce)
+					{
+						instance.RayMask &= ~(1u << bounce);
+					}
+				}
+				else if (statement.Accept("noshadow"))
+				{
+					instance.RayMask &= ~Assets::ShadowRayMask;
+				}
+				else
+				{
+					statement.Fail("unknown instance property '" + std::string(statement.Word("instance property")) + "'");
+				}
+			}
+
+			instances.push_back(std::move(instance));
+		}
+		else
+		{
+			statement.Fail("unknown statement '" + std::string(statement.Word("statement")) + "'");
+		}
+	}
+
+	if (models.empty())
+	{
+		Throw(std::runtime_error("scene file '" + path + "' has no model"));
+	}
+
+	std::vector<Model> loadedModels;
+	std::vector<Texture> loadedTextures;
+
+	loadedModels.reserve(models.size());
+	loadedTextures.reserve(textures.size());
+
+	for (auto& model : models)
+	{
+		loadedModels.push_back(model.get());
+	}
+
+	for (auto& texture : textures)
+	{
+		loadedTextures.push_back(texture.get());
+	}
+
+	return std::forward_as_tuple(std::move(loadedModels), std::move(loadedTextures), std::move(instances));
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "SceneList.hpp"
+#include <string>
+
+// The scenes described by a text file rather than compiled in (see --scene-file), one statement per line:
+//
+//   # A comment.
+//   camera eye 13 2 3 target 0 0 0 up 0 1 0 fov 20 aperture 0.1 focus 10 speed 5 gamma 1 sky 1
+//   texture <name> <path>
+//   material <name> lambertian <r g b> | metallic <r g b> <fuzziness> | dielectric <index> | isotropic <r g b> [density <d>] | light <r g b> [texture <name>] [alpha <cutoff>]
+//   model <name> obj|ply <path> | sphere <x y z> <radius> <material> | box <x0 y0 z0> <x1 y1 z1> <material> | cornellbox <scale>
+//     [density noise <resolution> <frequency> [<seed>] | density raw <path> <x y z>]
+//   instance <model> [translate <x y z>] [rotate <degrees> <x y z>] [scale <s> | <x y z>] [material <name>] [cull <depth>] [noshadow]
+//   rays opaque <depth>
+//   gltf <path>
+//
+// A gltf statement adds the meshes, textures and node instances of a .glb file (see GltfScene.hpp), a .glb can also be loaded as the scene file itself.
+// A material with an alpha cutoff is cut out where its texture alpha falls below it. The transforms of an instance are applied in order. Without any instance statement, each model is placed once as is.
+// An instance culled from a depth is skipped by the bounce rays of that depth and deeper ones (0 being the camera rays), a noshadow one by the shadow rays.
+// The rays from the opaque depth on, and the shadow rays cast from there, ignore the alpha cutoffs and skip the any hit shaders.
+// The instances of an isotropic material are participating media filling their sphere or model bounds (see Assets::Scene::MediumCount()),
+// of the material density per world unit, scaled by the generated or 8-bit raw density grid of their model if it has one.
+// The file is memory mapped and parsed in a single pass, the instances only reference their model so that large instanced
+// scenes do not duplicate any geometry. The models and textures are loaded concurrently on the task system.
+class SceneFile final
+{
+public:
+
+	static SceneAssets Load(const std::string& path, SceneList::CameraInitialSate& camera, const SceneList::SceneOptions& options, Utilities::TaskSystem& tasks);
+};
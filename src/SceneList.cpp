@@ -1,17 +1,69 @@
 #include "SceneList.hpp"
 #include "Assets/Material.hpp"
 #include "Assets/Model.hpp"
+#include "Assets/ModelInstance.hpp"
 #include "Assets/Texture.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include <algorithm>
+#include <cmath>
 #include <functional>
+#include <iostream>
 #include <random>
 
 using namespace glm;
 using Assets::Material;
 using Assets::Model;
+using Assets::ModelInstance;
 using Assets::Texture;
 
 namespace
 {
+	// The level models not created yet, see SceneList::SelectLevelsOfDetail().
+	const uint32_t NoLevelModel = ~0u;
+
+	// The factor by which an instance covers more or fewer pixels than the threshold of its level before switching to another one.
+	const float LevelOfDetailHysteresis = 1.5f;
+
+	float PixelsPerUnit(const float fieldOfView, const float viewportHeight)
+	{
+		return viewportHeight / (2 * std::tan(radians(fieldOfView) * 0.5f));
+	}
+
+	// The pixels covered by the bounding sphere of an instance, as seen from the camera.
+	float CoveredPixels(const vec4& sphere, const mat4& transform, const mat4& modelView, const float pixelsPerUnit)
+	{
+		const auto center = vec3(modelView * transform * vec4(vec3(sphere), 1));
+		const auto scaling = std::max(length(vec3(transform[0])), std::max(length(vec3(transform[1])), length(vec3(transform[2]))));
+		const auto radius = sphere.w * scaling;
+		const auto distance = std::max(length(center) - radius, radius * 0.01f);
+		const auto projectedRadius = radius / distance * pixelsPerUnit;
+
+		return 3.14159265358979f * projectedRadius * projectedRadius;
+	}
+
+	// The coarsest level that still has a triangle per covered pixel.
+	size_t SelectLevel(const SceneList::LevelsOfDetail::Chain& chain, const float coveredPixels)
+	{
+		size_t level = 0;
+
+		while (level + 1 != chain.TriangleCounts.size() && static_cast<float>(chain.TriangleCounts[level + 1]) >= coveredPixels)
+		{
+			++level;
+		}
+
+		return level;
+	}
+
+	// The emissive instances keep the lights of their initial model, and the media the bounds of theirs (see Assets::Scene).
+	bool IsSwitchable(const Model& model, const ModelInstance& instance)
+	{
+		const auto isSurface = [](const Material& material)
+		{
+			return material.MaterialModel != Material::Enum::DiffuseLight && material.MaterialModel != Material::Enum::Isotropic;
+		};
+
+		return instance.MaterialOverride ? isSurface(*instance.MaterialOverride) : std::all_of(model.Materials().begin(), model.Materials().end(), isSurface);
+	}
 
 	void AddRayTracingInOneWeekendCommonScene(std::vector<Assets::Model>& models, const bool& isProc, std::function<float ()>& random)
 	{
@@ -19,7 +71,8 @@ namespace
 		// Calls to random() are always explicit and non-inlined to avoid C++ undefined evaluation order of function arguments,
 		// this guarantees consistent and reproducible behaviour across different platforms and compilers.
 
-		models.push_back(Model::CreateSphere(vec3(0, -1000, 0), 1000, Material::Lambertian(vec3(0.5f, 0.5f, 0.5f)), isProc));
+		// The ground stays procedural, the tessellation is far too coarse for such a large sphere.
+		models.push_back(Model::CreateSphere(vec3(0, -1000, 0), 1000, Material::Lambertian(vec3(0.5f, 0.5f, 0.5f)), true));
 
 		for (int i = -11; i < 11; ++i)
 		{
@@ -58,9 +111,82 @@ namespace
 		}
 	}
 
+	// The TLAS stress scenes, a few meshes instanced on a square grid with a random orientation and size.
+	// None of the instances override their material, the shader binding table stays the same whatever the instance count.
+	SceneAssets Instancing(SceneList::CameraInitialSate& camera, const SceneList::SceneOptions& options, Utilities::TaskSystem& tasks, const uint32_t instanceCount)
+	{
+		const auto side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+		const float spacing = 2.0f;
+		const float extent = side * spacing;
+
+		camera.ModelView = lookAt(vec3(0, extent * 0.15f + 4, extent * 0.5f + 8), vec3(0, 0, 0), vec3(0, 1, 0));
+		camera.FieldOfView = 40;
+		camera.Aperture = 0.0f;
+		camera.FocusDistance = 10.0f;
+		camera.ControlSpeed = std::max(extent * 0.1f, 5.0f);
+		camera.GammaCorrection = true;
+		camera.HasSky = true;
+
+		auto cube = tasks.Run([]() { return Model::LoadModel("../assets/models/cube_multi.obj"); });
+
+		std::vector<Model> models;
+		models.push_back(Model::CreateBox(vec3(-extent, -1, -extent), vec3(extent, 0, extent), Material::Lambertian(vec3(0.5f, 0.5f, 0.5f))));
+		models.push_back(Model::CreateSphere(vec3(0, 0, 0), 0.5f, Material::Metallic(vec3(0.7f, 0.6f, 0.5f), 0.1f), !options.TessellatedSpheres));
+		models.push_back(Model::CreateBox(vec3(-0.4f, -0.4f, -0.4f), vec3(0.4f, 0.4f, 0.4f), Material::Lambertian(vec3(0.8f, 0.3f, 0.2f))));
+		models.push_back(cube.get());
+
+		std::mt19937 engine(42);
+		std::function<float()> random = std::bind(std::uniform_real_distribution<float>(), engine);
+
+		std::vector<ModelInstance> instances;
+		instances.reserve(instanceCount + 1);
+		instances.push_back({ 0, mat4(1), {} });
+
+		for (uint32_t i = 0; i != instanceCount; ++i)
+		{
+			const uint32_t modelId = 1 + i % 3;
+			const float x = (static_cast<float>(i % side) - side * 0.5f) * spacing;
+			const float z = (static_cast<float>(i / side) - side * 0.5f) * spacing;
+			const float angle = random() * 360.0f;
+			const float size = 0.5f + random();
+
+			instances.push_back({ modelId, scale(rotate(translate(mat4(1), vec3(x, size * 0.5f, z)), radians(angle), vec3(0, 1, 0)), vec3(size)), {} });
+		}
+
+		return std::forward_as_tuple(std::move(models), std::vector<Texture>(), std::move(instances));
+	}
+
+	// The micro-benchmark scenes all look down the -z axis at the origin, under the sky, with no depth of field.
+	void SetMicroCamera(SceneList::CameraInitialSate& camera, const vec3& eye, const float fieldOfView)
+	{
+		camera.ModelView = lookAt(eye, vec3(0, 0, 0), vec3(0, 1, 0));
+		camera.FieldOfView = fieldOfView;
+		camera.Aperture = 0.0f;
+		camera.FocusDistance = length(eye);
+		camera.ControlSpeed = 2.0f;
+		camera.GammaCorrection = true;
+		camera.HasSky = true;
+	}
+
+	// A quad of the z = depth plane facing +z, its texture coordinates repeated the given number of times.
+	void AddQuad(std::vector<Assets::Vertex>& vertices, std::vector<uint32_t>& indices, const vec2& min, const vec2& max, const float depth, const float repeat)
+	{
+		const auto first = static_cast<uint32_t>(vertices.size());
+
+		vertices.push_back({ vec3(min.x, min.y, depth), vec3(0, 0, 1), vec2(0, repeat), 0 });
+		vertices.push_back({ vec3(max.x, min.y, depth), vec3(0, 0, 1), vec2(repeat, repeat), 0 });
+		vertices.push_back({ vec3(max.x, max.y, depth), vec3(0, 0, 1), vec2(repeat, 0), 0 });
+		vertices.push_back({ vec3(min.x, max.y, depth), vec3(0, 0, 1), vec2(0, 0), 0 });
+
+		for (const uint32_t i : { 0, 1, 2, 0, 2, 3 })
+		{
+			indices.push_back(first + i);
+		}
+	}
+
 }
 
-const std::vector<std::pair<std::string, std::function<SceneAssets (SceneList::CameraInitialSate&)>>> SceneList::AllScenes =
+const std::vector<std::pair<std::string, std::function<SceneAssets (SceneList::CameraInitialSate&, const SceneList::SceneOptions&, Utilities::TaskSystem&)>>> SceneList::AllScenes =
 {
 	{"Cube And Spheres", CubeAndSpheres},
 	{"Ray Tracing In One Weekend", RayTracingInOneWeekend},
@@ -68,9 +194,19 @@ const std::vector<std::pair<std::string, std::function<SceneAssets (SceneList::C
 	{"Lucy In One Weekend", LucyInOneWeekend},
 	{"Cornell Box", CornellBox},
 	{"Cornell Box & Lucy", CornellBoxLucy},
+	{"Instancing 10K", Instancing10K},
+	{"Instancing 100K", Instancing100K},
+	{"Instancing 1M", Instancing1M},
+	{"Micro: Single Triangle", MicroTriangle},
+	{"Micro: Dense Grid", MicroDenseGrid},
+	{"Micro: 1K Spheres", MicroSphereField},
+	{"Micro: Deep Instancing", MicroDeepInstancing},
+	{"Micro: Alpha Test", MicroAlphaTest},
 };
 
-SceneAssets SceneList::CubeAndSpheres(CameraInitialSate& camera)
+const size_t SceneList::FirstMicroScene = 9;
+
+SceneAssets SceneList::CubeAndSpheres(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks)
 {
 	// Basic test scene.
 	
@@ -82,20 +218,24 @@ SceneAssets SceneList::CubeAndSpheres(CameraInitialSate& camera)
 	camera.GammaCorrection = false;
 	camera.HasSky = true;
 
+	// Parse the model and decode the texture concurrently.
+	auto cube = tasks.Run([]() { return Model::LoadModel("../assets/models/cube_multi.obj"); });
+	auto earth = tasks.Run([]() { return Texture::LoadTexture("../assets/textures/land_ocean_ice_cloud_2048.png", Vulkan::SamplerConfig()); });
+
 	std::vector<Model> models;
 	std::vector<Texture> textures;
 
-	models.push_back(Model::LoadModel("../assets/models/cube_multi.obj"));
-	models.push_back(Model::CreateSphere(vec3(1, 0, 0), 0.5, Material::Metallic(vec3(0.7f, 0.5f, 0.8f), 0.2f), true));
-	models.push_back(Model::CreateSphere(vec3(-1, 0, 0), 0.5, Material::Dielectric(1.5f), true));
-	models.push_back(Model::CreateSphere(vec3(0, 1, 0), 0.5, Material::Lambertian(vec3(1.0f), 0), true));
+	models.push_back(cube.get());
+	models.push_back(Model::CreateSphere(vec3(1, 0, 0), 0.5, Material::Metallic(vec3(0.7f, 0.5f, 0.8f), 0.2f), !options.TessellatedSpheres));
+	models.push_back(Model::CreateSphere(vec3(-1, 0, 0), 0.5, Material::Dielectric(1.5f), !options.TessellatedSpheres));
+	models.push_back(Model::CreateSphere(vec3(0, 1, 0), 0.5, Material::Lambertian(vec3(1.0f), 0), !options.TessellatedSpheres));
 
-	textures.push_back(Texture::LoadTexture("../assets/textures/land_ocean_ice_cloud_2048.png", Vulkan::SamplerConfig()));
+	textures.push_back(earth.get());
 
-	return std::forward_as_tuple(std::move(models), std::move(textures));
+	return std::forward_as_tuple(std::move(models), std::move(textures), std::vector<ModelInstance>());
 }
 
-SceneAssets SceneList::RayTracingInOneWeekend(CameraInitialSate& camera)
+SceneAssets SceneList::RayTracingInOneWeekend(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem&)
 {
 	// Final scene from Ray Tracing In One Weekend book.
 	
@@ -107,7 +247,7 @@ SceneAssets SceneList::RayTracingInOneWeekend(CameraInitialSate& camera)
 	camera.GammaCorrection = true;
 	camera.HasSky = true;
 
-	const bool isProc = true;
+	const bool isProc = !options.TessellatedSpheres;
 
 	std::mt19937 engine(42);
 	std::function<float ()> random = std::bind(std::uniform_real_distribution<float>(), engine);
@@ -120,10 +260,10 @@ SceneAssets SceneList::RayTracingInOneWeekend(CameraInitialSate& camera)
 	models.push_back(Model::CreateSphere(vec3(-4, 1, 0), 1.0f, Material::Lambertian(vec3(0.4f, 0.2f, 0.1f)), isProc));
 	models.push_back(Model::CreateSphere(vec3(4, 1, 0), 1.0f, Material::Metallic(vec3(0.7f, 0.6f, 0.5f), 0.0f), isProc));
 
-	return std::forward_as_tuple(std::move(models), std::vector<Texture>());
+	return std::forward_as_tuple(std::move(models), std::vector<Texture>(), std::vector<ModelInstance>());
 }
 
-SceneAssets SceneList::PlanetsInOneWeekend(CameraInitialSate& camera)
+SceneAssets SceneList::PlanetsInOneWeekend(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks)
 {
 	// Same as RayTracingInOneWeekend but using textures.
 	
@@ -135,7 +275,12 @@ SceneAssets SceneList::PlanetsInOneWeekend(CameraInitialSate& camera)
 	camera.GammaCorrection = true;
 	camera.HasSky = true;
 
-	const bool isProc = true;
+	// Decode the textures in the background while the spheres are generated.
+	auto mars = tasks.Run([]() { return Texture::LoadTexture("../assets/textures/2k_mars.jpg", Vulkan::SamplerConfig()); });
+	auto moon = tasks.Run([]() { return Texture::LoadTexture("../assets/textures/2k_moon.jpg", Vulkan::SamplerConfig()); });
+	auto earth = tasks.Run([]() { return Texture::LoadTexture("../assets/textures/land_ocean_ice_cloud_2048.png", Vulkan::SamplerConfig()); });
+
+	const bool isProc = !options.TessellatedSpheres;
 
 	std::mt19937 engine(42);
 	std::function<float()> random = std::bind(std::uniform_real_distribution<float>(), engine);
@@ -149,14 +294,14 @@ SceneAssets SceneList::PlanetsInOneWeekend(CameraInitialSate& camera)
 	models.push_back(Model::CreateSphere(vec3(-4, 1, 0), 1.0f, Material::Lambertian(vec3(1.0f), 0), isProc));
 	models.push_back(Model::CreateSphere(vec3(4, 1, 0), 1.0f, Material::Metallic(vec3(1.0f), 0.0f, 1), isProc));
 
-	textures.push_back(Texture::LoadTexture("../assets/textures/2k_mars.jpg", Vulkan::SamplerConfig()));
-	textures.push_back(Texture::LoadTexture("../assets/textures/2k_moon.jpg", Vulkan::SamplerConfig()));
-	textures.push_back(Texture::LoadTexture("../assets/textures/land_ocean_ice_cloud_2048.png", Vulkan::SamplerConfig()));
+	textures.push_back(mars.get());
+	textures.push_back(moon.get());
+	textures.push_back(earth.get());
 
-	return std::forward_as_tuple(std::move(models), std::move(textures));
+	return std::forward_as_tuple(std::move(models), std::move(textures), std::vector<ModelInstance>());
 }
 
-SceneAssets SceneList::LucyInOneWeekend(CameraInitialSate& camera)
+SceneAssets SceneList::LucyInOneWeekend(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks)
 {
 	// Same as RayTracingInOneWeekend but using the Lucy 3D model.
 	
@@ -168,7 +313,10 @@ SceneAssets SceneList::LucyInOneWeekend(CameraInitialSate& camera)
 	camera.GammaCorrection = true;
 	camera.HasSky = true;
 
-	const bool isProc = true;
+	// Parse Lucy in the background while the spheres are generated.
+	auto lucy = tasks.Run([gpuNormals = options.GpuNormals]() { return Model::LoadModel("../assets/models/lucy.obj", gpuNormals); });
+
+	const bool isProc = !options.TessellatedSpheres;
 
 	std::mt19937 engine(42);
 	std::function<float()> random = std::bind(std::uniform_real_distribution<float>(), engine);
@@ -177,46 +325,48 @@ SceneAssets SceneList::LucyInOneWeekend(CameraInitialSate& camera)
 	
 	AddRayTracingInOneWeekendCommonScene(models, isProc, random);
 
-	auto lucy0 = Model::LoadModel("../assets/models/lucy.obj");
-	auto lucy1 = lucy0;
-	auto lucy2 = lucy0;
+	// Place the spheres as is, then instance the same Lucy model three times.
+	std::vector<ModelInstance> instances;
+
+	for (uint32_t m = 0; m != models.size(); ++m)
+	{
+		instances.push_back({ m, mat4(1), {} });
+	}
+
+	const auto lucyId = static_cast<uint32_t>(models.size());
+	models.push_back(lucy.get());
 
 	const auto i = mat4(1);
 	const float scaleFactor = 0.0035f;
 
-	lucy0.Transform(
+	instances.push_back({ lucyId,
 		rotate(
 			scale(
 				translate(i, vec3(0, -0.08f, 0)), 
 				vec3(scaleFactor)),
-			radians(90.0f), vec3(0, 1, 0)));
+			radians(90.0f), vec3(0, 1, 0)),
+		Material::Dielectric(1.5f) });
 
-	lucy1.Transform(
+	instances.push_back({ lucyId,
 		rotate(
 			scale(
 				translate(i, vec3(-4, -0.08f, 0)),
 				vec3(scaleFactor)),
-			radians(90.0f), vec3(0, 1, 0)));
+			radians(90.0f), vec3(0, 1, 0)),
+		Material::Lambertian(vec3(0.4f, 0.2f, 0.1f)) });
 
-	lucy2.Transform(
+	instances.push_back({ lucyId,
 		rotate(
 			scale(
 				translate(i, vec3(4, -0.08f, 0)),
 				vec3(scaleFactor)),
-			radians(90.0f), vec3(0, 1, 0)));
-
-	lucy0.SetMaterial(Material::Dielectric(1.5f));
-	lucy1.SetMaterial(Material::Lambertian(vec3(0.4f, 0.2f, 0.1f)));
-	lucy2.SetMaterial(Material::Metallic(vec3(0.7f, 0.6f, 0.5f), 0.05f));
+			radians(90.0f), vec3(0, 1, 0)),
+		Material::Metallic(vec3(0.7f, 0.6f, 0.5f), 0.05f) });
 
-	models.push_back(std::move(lucy0));
-	models.push_back(std::move(lucy1));
-	models.push_back(std::move(lucy2));
-
-	return std::forward_as_tuple(std::move(models), std::vector<Texture>());
+	return std::forward_as_tuple(std::move(models), std::vector<Texture>(), std::move(instances));
 }
 
-SceneAssets SceneList::CornellBox(CameraInitialSate& camera)
+SceneAssets SceneList::CornellBox(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem&)
 {
 	camera.ModelView = lookAt(vec3(278, 278, 800), vec3(278, 278, 0), vec3(0, 1, 0));
 	camera.FieldOfView = 40;
@@ -240,10 +390,10 @@ SceneAssets SceneList::CornellBox(CameraInitialSate& camera)
 	models.push_back(box0);
 	models.push_back(box1);
 
-	return std::make_tuple(std::move(models), std::vector<Texture>());
+	return std::make_tuple(std::move(models), std::vector<Texture>(), std::vector<ModelInstance>());
 }
 
-SceneAssets SceneList::CornellBoxLucy(CameraInitialSate& camera)
+SceneAssets SceneList::CornellBoxLucy(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks)
 {
 	camera.ModelView = lookAt(vec3(278, 278, 800), vec3(278, 278, 0), vec3(0, 1, 0));
 	camera.FieldOfView = 40;
@@ -253,9 +403,11 @@ SceneAssets SceneList::CornellBoxLucy(CameraInitialSate& camera)
 	camera.GammaCorrection = true;
 	camera.HasSky = false;
 
+	auto lucy = tasks.Run([gpuNormals = options.GpuNormals]() { return Model::LoadModel("../assets/models/lucy.obj", gpuNormals); });
+
 	const auto i = mat4(1);
-	const auto sphere = Model::CreateSphere(vec3(555 - 130, 165.0f, -165.0f / 2 - 65), 80.0f, Material::Dielectric(1.5f), true);
-	auto lucy0 = Model::LoadModel("../assets/models/lucy.obj");
+	const auto sphere = Model::CreateSphere(vec3(555 - 130, 165.0f, -165.0f / 2 - 65), 80.0f, Material::Dielectric(1.5f), !options.TessellatedSpheres);
+	auto lucy0 = lucy.get();
 
 	lucy0.Transform(
 		rotate(
@@ -269,5 +421,321 @@ SceneAssets SceneList::CornellBoxLucy(CameraInitialSate& camera)
 	models.push_back(sphere);
 	models.push_back(lucy0);
 
-	return std::forward_as_tuple(std::move(models), std::vector<Texture>());
+	return std::forward_as_tuple(std::move(models), std::vector<Texture>(), std::vector<ModelInstance>());
+}
+
+SceneAssets SceneList::Instancing10K(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks)
+{
+	return Instancing(camera, options, tasks, 10000);
+}
+
+SceneAssets SceneList::Instancing100K(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks)
+{
+	return Instancing(camera, options, tasks, 100000);
+}
+
+SceneAssets SceneList::Instancing1M(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks)
+{
+	return Instancing(camera, options, tasks, 1000000);
+}
+
+SceneAssets SceneList::MicroTriangle(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem&)
+{
+	// The cheapest possible hit: a single triangle covering most of the view, the traversal cost being that of the fixed overheads.
+	SetMicroCamera(camera, vec3(0, 0, 2), 60);
+
+	std::vector<Assets::Vertex> vertices
+	{
+		{ vec3(-2, -1.5f, 0), vec3(0, 0, 1), vec2(0, 1), 0 },
+		{ vec3(2, -1.5f, 0), vec3(0, 0, 1), vec2(1, 1), 0 },
+		{ vec3(0, 2, 0), vec3(0, 0, 1), vec2(0.5f, 0), 0 },
+	};
+
+	std::vector<Model> models;
+	models.push_back(Model::CreateMesh(std::move(vertices), { 0, 1, 2 }, { Material::Lambertian(vec3(0.7f, 0.7f, 0.7f)) }));
+
+	return std::forward_as_tuple(std::move(models), std::vector<Texture>(), std::vector<ModelInstance>());
+}
+
+SceneAssets SceneList::MicroDenseGrid(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem&)
+{
+	// A single BLAS of 2M small triangles, a rippled 1024 x 1024 grid filling the view, so that the bottom level traversal dominates.
+	SetMicroCamera(camera, vec3(0, 0, 2.2f), 60);
+
+	const uint32_t side = 1024;
+	std::vector<Assets::Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	vertices.reserve(size_t(side + 1) * (side + 1));
+	indices.reserve(size_t(side) * side * 6);
+
+	for (uint32_t y = 0; y <= side; ++y)
+	{
+		for (uint32_t x = 0; x <= side; ++x)
+		{
+			const vec2 uv(static_cast<float>(x) / side, static_cast<float>(y) / side);
+			const vec2 p = uv * 4.0f - 2.0f;
+			const float height = 0.05f * std::sin(p.x * 20) * std::cos(p.y * 20);
+			const vec3 normal = normalize(vec3(-std::cos(p.x * 20) * std::cos(p.y * 20), std::sin(p.x * 20) * std::sin(p.y * 20), 1));
+
+			vertices.push_back({ vec3(p.x, p.y, height), normal, uv, 0 });
+		}
+	}
+
+	for (uint32_t y = 0; y != side; ++y)
+	{
+		for (uint32_t x = 0; x != side; ++x)
+		{
+			const uint32_t i = y * (side + 1) + x;
+
+			for (const uint32_t index : { i, i + 1, i + side + 2, i, i + side + 2, i + side + 1 })
+			{
+				indices.push_back(index);
+			}
+		}
+	}
+
+	std::vector<Model> models;
+	models.push_back(Model::CreateMesh(std::move(vertices), std::move(indices), { Material::Lambertian(vec3(0.7f, 0.7f, 0.7f)) }));
+
+	return std::forward_as_tuple(std::move(models), std::vector<Texture>(), std::vector<ModelInstance>());
+}
+
+SceneAssets SceneList::MicroSphereField(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem&)
+{
+	// 32 x 32 diffuse spheres on a plane, procedural ones exercising the intersection shader unless tessellated.
+	SetMicroCamera(camera, vec3(0, 12, 20), 45);
+
+	std::vector<Model> models;
+	models.push_back(Model::CreateBox(vec3(-20, -1, -20), vec3(20, 0, 20), Material::Lambertian(vec3(0.5f, 0.5f, 0.5f))));
+
+	for (int z = 0; z != 32; ++z)
+	{
+		for (int x = 0; x != 32; ++x)
+		{
+			const vec3 center((x - 15.5f) * 1.1f, 0.5f, (z - 15.5f) * 1.1f);
+			const vec3 color(0.2f + 0.6f * x / 31, 0.5f, 0.2f + 0.6f * z / 31);
+
+			models.push_back(Model::CreateSphere(center, 0.5f, Material::Lambertian(color), !options.TessellatedSpheres));
+		}
+	}
+
+	return std::forward_as_tuple(std::move(models), std::vector<Texture>(), std::vector<ModelInstance>());
+}
+
+SceneAssets SceneList::MicroDeepInstancing(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem&)
+{
+	// 4096 instances of a thin box frame whose bounds all overlap around the origin, so that every ray enters hundreds of BLAS
+	// through the TLAS while rarely hitting anything: the cost of the instance transitions rather than of the triangles.
+	SetMicroCamera(camera, vec3(0, 0, 6), 60);
+
+	const Material material = Material::Lambertian(vec3(0.8f, 0.5f, 0.3f));
+	std::vector<Assets::Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	// The four bars of a square frame facing the camera.
+	AddQuad(vertices, indices, vec2(-1, -1), vec2(1, -0.98f), 0, 1);
+	AddQuad(vertices, indices, vec2(-1, 0.98f), vec2(1, 1), 0, 1);
+	AddQuad(vertices, indices, vec2(-1, -1), vec2(-0.98f, 1), 0, 1);
+	AddQuad(vertices, indices, vec2(0.98f, -1), vec2(1, 1), 0, 1);
+
+	std::vector<Model> models;
+	models.push_back(Model::CreateMesh(std::move(vertices), std::move(indices), { material }));
+
+	std::mt19937 engine(42);
+	std::function<float()> random = std::bind(std::uniform_real_distribution<float>(), engine);
+
+	std::vector<ModelInstance> instances;
+	instances.reserve(4096);
+
+	for (uint32_t i = 0; i != 4096; ++i)
+	{
+		const float x = random() - 0.5f;
+		const float y = random() - 0.5f;
+		const float z = -4 * random();
+		const float angle = random() * 360.0f;
+
+		instances.push_back({ 0, rotate(translate(mat4(1), vec3(x, y, z)), radians(angle), vec3(0, 0, 1)), {} });
+	}
+
+	return std::forward_as_tuple(std::move(models), std::vector<Texture>(), std::move(instances));
+}
+
+SceneAssets SceneList::MicroAlphaTest(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks)
+{
+	// 32 stacked quads tiled with the mostly transparent Vulkan logo, every ray crossing many of them through the any-hit shader.
+	SetMicroCamera(camera, vec3(0, 0, 3), 60);
+
+	Vulkan::SamplerConfig repeated;
+	repeated.AddressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	repeated.AddressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+	auto logo = tasks.Run([repeated]() { return Texture::LoadTexture("../assets/textures/Vulkan.png", repeated); });
+
+	Material material = Material::Lambertian(vec3(1.0f), 0);
+	material.AlphaCutoff = 0.5f;
+
+	std::vector<Assets::Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	for (uint32_t layer = 0; layer != 32; ++layer)
+	{
+		const float shift = 0.37f * layer;
+		AddQuad(vertices, indices, vec2(-2 + shift, -2), vec2(2 + shift, 2), -0.1f * layer, 8);
+	}
+
+	std::vector<Model> models;
+	std::vector<Texture> textures;
+
+	models.push_back(Model::CreateMesh(std::move(vertices), std::move(indices), { material }));
+	textures.push_back(logo.get());
+
+	return std::forward_as_tuple(std::move(models), std::move(textures), std::vector<ModelInstance>());
+}
+
+void SceneList::SelectLevelsOfDetail(SceneAssets& assets, const CameraInitialSate& camera, const float viewportHeight, LevelsOfDetail* const levels)
+{
+	auto& models = std::get<0>(assets);
+	auto& instances = std::get<2>(assets);
+
+	// Same default as Assets::Scene, every model placed once as is.
+	if (instances.empty())
+	{
+		for (uint32_t i = 0; i != models.size(); ++i)
+		{
+			instances.push_back({ i, mat4(1), {} });
+		}
+	}
+
+	// The chain of every model with levels of detail, with the bounding sphere of the full model.
+	// Its simplified models are only created once an instance selects them, or all at once for the later selections.
+	LevelsOfDetail selection;
+	auto& chains = selection.Chains;
+	const auto modelCount = models.size();
+	std::vector<uint32_t> modelChains(modelCount, LevelsOfDetail::NoChain);
+
+	for (size_t m = 0; m != modelCount; ++m)
+	{
+		const auto& vertices = models[m].Vertices();
+		const auto& lods = models[m].LevelsOfDetail();
+
+		if (lods.empty() || vertices.empty())
+		{
+			continue;
+		}
+
+		vec3 minimum = vertices[0].Position;
+		vec3 maximum = vertices[0].Position;
+
+		for (const auto& vertex : vertices)
+		{
+			minimum = min(minimum, vertex.Position);
+			maximum = max(maximum, vertex.Position);
+		}
+
+		LevelsOfDetail::Chain chain;
+		chain.Sphere = vec4((minimum + maximum) * 0.5f, length(maximum - minimum) * 0.5f);
+		chain.Models.assign(lods.size() + 1, NoLevelModel);
+		chain.Models[0] = static_cast<uint32_t>(m);
+		chain.TriangleCounts.push_back(models[m].NumberOfIndices() / 3);
+
+		for (const auto& lod : lods)
+		{
+			chain.TriangleCounts.push_back(static_cast<uint32_t>(lod.size() / 3));
+		}
+
+		modelChains[m] = static_cast<uint32_t>(chains.size());
+		chains.push_back(std::move(chain));
+	}
+
+	const auto levelModel = [&models, &chains](const uint32_t chainId, const size_t level)
+	{
+		auto& chain = chains[chainId];
+
+		if (chain.Models[level] == NoLevelModel)
+		{
+			chain.Models[level] = static_cast<uint32_t>(models.size());
+			models.push_back(models[chain.Models[0]].CreateLevelOfDetail(level - 1));
+		}
+
+		return chain.Models[level];
+	};
+
+	const float pixelsPerUnit = PixelsPerUnit(camera.FieldOfView, viewportHeight);
+	uint32_t replaced = 0;
+
+	selection.InstanceChains.assign(instances.size(), LevelsOfDetail::NoChain);
+	selection.InstanceLevels.assign(instances.size(), 0);
+
+	for (size_t i = 0; i != instances.size(); ++i)
+	{
+		auto& instance = instances[i];
+		const auto chainId = instance.ModelId < modelCount ? modelChains[instance.ModelId] : LevelsOfDetail::NoChain;
+
+		if (chainId == LevelsOfDetail::NoChain)
+		{
+			continue;
+		}
+
+		const auto& chain = chains[chainId];
+		const auto level = SelectLevel(chain, CoveredPixels(chain.Sphere, instance.Transform, camera.ModelView, pixelsPerUnit));
+
+		if (levels != nullptr && IsSwitchable(models[instance.ModelId], instance))
+		{
+			for (size_t l = 1; l != chains[chainId].Models.size(); ++l)
+			{
+				levelModel(chainId, l);
+			}
+
+			selection.InstanceChains[i] = chainId;
+			selection.InstanceLevels[i] = static_cast<uint32_t>(level);
+		}
+
+		if (level != 0)
+		{
+			instance.ModelId = levelModel(chainId, level);
+			++replaced;
+		}
+	}
+
+	if (replaced != 0 || models.size() != modelCount)
+	{
+		std::cout << "- selected levels of detail for " << replaced << " instances (" << models.size() - modelCount << " simplified models)" << std::endl;
+	}
+
+	if (levels != nullptr)
+	{
+		*levels = std::move(selection);
+	}
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> SceneList::UpdateLevelsOfDetail(LevelsOfDetail& levels, const std::vector<ModelInstance>& instances, const mat4& modelView, const float fieldOfView, const float viewportHeight)
+{
+	const float pixelsPerUnit = PixelsPerUnit(fieldOfView, viewportHeight);
+	std::vector<std::pair<uint32_t, uint32_t>> switched;
+
+	for (size_t i = 0; i != levels.InstanceChains.size(); ++i)
+	{
+		const auto chainId = levels.InstanceChains[i];
+
+		if (chainId == LevelsOfDetail::NoChain)
+		{
+			continue;
+		}
+
+		// The level stays within those of a slightly larger and a slightly smaller instance.
+		const auto& chain = levels.Chains[chainId];
+		const auto coveredPixels = CoveredPixels(chain.Sphere, instances[i].Transform, modelView, pixelsPerUnit);
+		const auto finest = SelectLevel(chain, coveredPixels * LevelOfDetailHysteresis);
+		const auto coarsest = SelectLevel(chain, coveredPixels / LevelOfDetailHysteresis);
+		const auto level = std::clamp<size_t>(levels.InstanceLevels[i], finest, coarsest);
+
+		if (level != levels.InstanceLevels[i])
+		{
+			levels.InstanceLevels[i] = static_cast<uint32_t>(level);
+			switched.emplace_back(static_cast<uint32_t>(i), chain.Models[level]);
+		}
+	}
+
+	return switched;
 }
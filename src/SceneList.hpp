@@ -3,15 +3,22 @@
 #include <functional>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 namespace Assets
 {
 	class Model;
 	class Texture;
+	struct ModelInstance;
 }
 
-typedef std::tuple<std::vector<Assets::Model>, std::vector<Assets::Texture>> SceneAssets;
+namespace Utilities
+{
+	class TaskSystem;
+}
+
+typedef std::tuple<std::vector<Assets::Model>, std::vector<Assets::Texture>, std::vector<Assets::ModelInstance>> SceneAssets;
 
 class SceneList final
 {
@@ -26,14 +33,61 @@ public:
 		float ControlSpeed;
 		bool GammaCorrection;
 		bool HasSky;
+		uint32_t OpaqueDepth; // The bounce from which the rays skip the alpha tests, 0 = never.
+	};
+
+	struct SceneOptions
+	{
+		bool TessellatedSpheres; // Triangle meshes rather than procedural spheres, skipping the intersection shader.
+		bool GpuNormals; // The meshes without normals get them on the GPU once uploaded (see Vulkan::NormalsPipeline).
 	};
 
-	static SceneAssets CubeAndSpheres(CameraInitialSate& camera);
-	static SceneAssets RayTracingInOneWeekend(CameraInitialSate& camera);
-	static SceneAssets PlanetsInOneWeekend(CameraInitialSate& camera);
-	static SceneAssets LucyInOneWeekend(CameraInitialSate& camera);
-	static SceneAssets CornellBox(CameraInitialSate& camera);
-	static SceneAssets CornellBoxLucy(CameraInitialSate& camera);
+	static SceneAssets CubeAndSpheres(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets RayTracingInOneWeekend(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets PlanetsInOneWeekend(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets LucyInOneWeekend(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets CornellBox(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets CornellBoxLucy(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets Instancing10K(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets Instancing100K(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets Instancing1M(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+
+	// The synthetic micro-benchmark scenes, each stressing one part of the ray tracing (see --micro-benchmark).
+	static SceneAssets MicroTriangle(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets MicroDenseGrid(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets MicroSphereField(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets MicroDeepInstancing(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+	static SceneAssets MicroAlphaTest(CameraInitialSate& camera, const SceneOptions& options, Utilities::TaskSystem& tasks);
+
+	// The levels of detail the instances switch between as the camera moves, see SelectLevelsOfDetail() and UpdateLevelsOfDetail().
+	struct LevelsOfDetail final
+	{
+		static constexpr uint32_t NoChain = ~0u;
+
+		struct Chain final
+		{
+			glm::vec4 Sphere; // Bounds the full model, in its object space.
+			std::vector<uint32_t> Models; // From the full model on, each with a quarter of the triangles of the previous one.
+			std::vector<uint32_t> TriangleCounts;
+		};
+
+		std::vector<Chain> Chains;
+		std::vector<uint32_t> InstanceChains; // NoChain for the instances that keep their model.
+		std::vector<uint32_t> InstanceLevels; // The selected level of every instance in its chain.
+	};
+
+	// Replaces the models of the distant instances by their simplified levels of detail (see Assets::Model::LevelsOfDetail()).
+	// Each instance gets the coarsest level that still has a triangle per pixel it covers from the initial camera, given the viewport height in pixels.
+	// This is the first selection when levels is given: every level of the instanced models then becomes a model of its own, and the
+	// instances that can switch between them (not the emissive ones nor the media) are recorded in levels.
+	static void SelectLevelsOfDetail(SceneAssets& assets, const CameraInitialSate& camera, float viewportHeight, LevelsOfDetail* levels);
+
+	// Selects the levels again for the camera, returning the instances that switched along with their new model. An instance only
+	// switches once it covers 1.5 times more (or fewer) pixels than the threshold of its level, not back and forth around it.
+	static std::vector<std::pair<uint32_t, uint32_t>> UpdateLevelsOfDetail(LevelsOfDetail& levels, const std::vector<Assets::ModelInstance>& instances, const glm::mat4& modelView, float fieldOfView, float viewportHeight);
+
+	static const std::vector<std::pair<std::string, std::function<SceneAssets (CameraInitialSate&, const SceneOptions&, Utilities::TaskSystem&)>>> AllScenes;
 
-	static const std::vector<std::pair<std::string, std::function<SceneAssets (CameraInitialSate&)>>> AllScenes;
+	// The micro-benchmark scenes are the last ones of AllScenes, --next-scenes only walks through them when started on one.
+	static const size_t FirstMicroScene;
 };
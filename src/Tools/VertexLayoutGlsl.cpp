@@ -0,0 +1,40 @@
+#include "Assets/VertexLayout.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+// Writes the GLSL constants of the vertex layouts (see Assets/VertexLayout.hpp) to the given file, the shaders include it as
+// VertexLayout.glsl. Run by assets/CMakeLists.txt before the shaders are compiled.
+int main(const int argc, const char* argv[])
+{
+	if (argc != 2)
+	{
+		std::cerr << "usage: VertexLayoutGlsl <output file>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream out(argv[1]);
+
+	out << "// Generated from src/Assets/VertexLayout.hpp by src/Tools/VertexLayoutGlsl.cpp, do not edit.\n";
+	out << "// The strides and attribute offsets are in 32-bit words.\n";
+
+	Assets::VertexLayouts::ForEach([&out](const char* const name, const uint32_t stride, const auto& attributes)
+	{
+		out << "\nconst uint " << name << "Words = " << stride / 4 << ";\n";
+
+		for (const auto& attribute : attributes)
+		{
+			out << "const uint " << name << attribute.Name << "Word = " << attribute.Offset / 4 << ";\n";
+		}
+	});
+
+	out.close();
+
+	if (!out)
+	{
+		std::cerr << "ERROR: cannot write '" << argv[1] << "'" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
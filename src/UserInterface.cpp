@@ -4,7 +4,9 @@
 #include "Utilities/Exception.hpp"
 #include "Vulkan/DescriptorPool.hpp"
 #include "Vulkan/Device.hpp"
+#include "Vulkan/DynamicRendering.hpp"
 #include "Vulkan/FrameBuffer.hpp"
+#include "Vulkan/ImageView.hpp"
 #include "Vulkan/Instance.hpp"
 #include "Vulkan/RenderPass.hpp"
 #include "Vulkan/SingleTimeCommands.hpp"
@@ -17,10 +19,23 @@
 #include "ImGui/imgui_impl_glfw.h"
 #include "ImGui/imgui_impl_vulkan.h"
 
+#include <algorithm>
 #include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
 
 namespace
 {
+	// The stages of Profile.glsl, and the heatmap choices (see UserSettings::HeatmapStage).
+	const char* const ProfileStageNames[] = { "Ray generation", "Bounce rays", "Light sampling", "- closest hit", "- intersection" };
+	const char* const HeatmapStages[] = { "Whole ray generation", "Ray generation only", "Bounce rays", "Light sampling" };
+
+	// The counters of RayCounters.glsl, the rays per bounce follow.
+	enum RayCounter { RayCounterTraceCalls, RayCounterShadowRays, RayCounterMisses, RayCounterAbsorptions, RayCounterRoulette, RayCounterBounceLimit, RayCounterRadianceCache, RayCounterMediumCollisions, RayCounterBounceRays };
+
 	void CheckVulkanResultCallback(const VkResult err)
 	{
 		if (err != VK_SUCCESS)
@@ -28,17 +43,107 @@ namespace
 			Throw(std::runtime_error(std::string("ImGui Vulkan error (") + Vulkan::ToString(err) + ")"));
 		}
 	}
+
+	// The GLFW standard cursor of an ImGui one, as ImGui_ImplGlfw_NewFrame() picks them (without the GLFW 3.4 shapes), 0 hides it.
+	int GetCursorShape(const ImGuiMouseCursor cursor)
+	{
+		switch (cursor)
+		{
+		case ImGuiMouseCursor_None: return 0;
+		case ImGuiMouseCursor_TextInput: return GLFW_IBEAM_CURSOR;
+		case ImGuiMouseCursor_ResizeNS: return GLFW_VRESIZE_CURSOR;
+		case ImGuiMouseCursor_ResizeEW: return GLFW_HRESIZE_CURSOR;
+		case ImGuiMouseCursor_Hand: return GLFW_HAND_CURSOR;
+		default: return GLFW_ARROW_CURSOR;
+		}
+	}
+
+	// The workaround of ImGui_ImplGlfw_TranslateUntranslatedKey() for the lettered shortcuts, with the key names the window cached.
+	int TranslateUntranslatedKey(const Vulkan::Window& window, int key, const int scancode)
+	{
+		if (key >= GLFW_KEY_KP_0 && key <= GLFW_KEY_KP_EQUAL)
+		{
+			return key;
+		}
+
+		const char* const name = window.GetKeyName(key, scancode);
+		if (name == nullptr || name[0] == 0 || name[1] != 0)
+		{
+			return key;
+		}
+
+		const char charNames[] = "`-=[]\\,;\'./";
+		const int charKeys[] = { GLFW_KEY_GRAVE_ACCENT, GLFW_KEY_MINUS, GLFW_KEY_EQUAL, GLFW_KEY_LEFT_BRACKET, GLFW_KEY_RIGHT_BRACKET, GLFW_KEY_BACKSLASH, GLFW_KEY_COMMA, GLFW_KEY_SEMICOLON, GLFW_KEY_APOSTROPHE, GLFW_KEY_PERIOD, GLFW_KEY_SLASH, 0 };
+
+		if (name[0] >= '0' && name[0] <= '9')
+		{
+			key = GLFW_KEY_0 + (name[0] - '0');
+		}
+		else if (name[0] >= 'A' && name[0] <= 'Z')
+		{
+			key = GLFW_KEY_A + (name[0] - 'A');
+		}
+		else if (const char* const p = std::strchr(charNames, name[0]))
+		{
+			key = charKeys[p - charNames];
+		}
+
+		return key;
+	}
+
+	void UpdateKeyModifiers(ImGuiIO& io, const int mods)
+	{
+		io.AddKeyEvent(ImGuiKey_ModCtrl, (mods & GLFW_MOD_CONTROL) != 0);
+		io.AddKeyEvent(ImGuiKey_ModShift, (mods & GLFW_MOD_SHIFT) != 0);
+		io.AddKeyEvent(ImGuiKey_ModAlt, (mods & GLFW_MOD_ALT) != 0);
+		io.AddKeyEvent(ImGuiKey_ModSuper, (mods & GLFW_MOD_SUPER) != 0);
+	}
+
+	// The union of the draw command clip rectangles in frame buffer pixels, the backend scissors every command to its own.
+	VkRect2D GetDrawArea(const ImDrawData& drawData, const VkExtent2D extent)
+	{
+		float minX = static_cast<float>(extent.width);
+		float minY = static_cast<float>(extent.height);
+		float maxX = 0;
+		float maxY = 0;
+
+		for (int i = 0; i != drawData.CmdListsCount; ++i)
+		{
+			for (const auto& command : drawData.CmdLists[i]->CmdBuffer)
+			{
+				minX = std::min(minX, (command.ClipRect.x - drawData.DisplayPos.x) * drawData.FramebufferScale.x);
+				minY = std::min(minY, (command.ClipRect.y - drawData.DisplayPos.y) * drawData.FramebufferScale.y);
+				maxX = std::max(maxX, (command.ClipRect.z - drawData.DisplayPos.x) * drawData.FramebufferScale.x);
+				maxY = std::max(maxY, (command.ClipRect.w - drawData.DisplayPos.y) * drawData.FramebufferScale.y);
+			}
+		}
+
+		const int32_t x = static_cast<int32_t>(std::max(minX, 0.0f));
+		const int32_t y = static_cast<int32_t>(std::max(minY, 0.0f));
+		const int32_t right = static_cast<int32_t>(std::ceil(std::min(maxX, static_cast<float>(extent.width))));
+		const int32_t bottom = static_cast<int32_t>(std::ceil(std::min(maxY, static_cast<float>(extent.height))));
+
+		VkRect2D area = {};
+		area.offset = { x, y };
+		area.extent = { static_cast<uint32_t>(std::max(right - x, 0)), static_cast<uint32_t>(std::max(bottom - y, 0)) };
+		return area;
+	}
 }
 
 UserInterface::UserInterface(
 	Vulkan::CommandPool& commandPool, 
 	const Vulkan::SwapChain& swapChain, 
 	const Vulkan::DepthBuffer& depthBuffer,
+	const Vulkan::DynamicRendering* const dynamicRendering,
+	Vulkan::Window& window,
 	UserSettings& userSettings) :
-	userSettings_(userSettings)
+	swapChain_(swapChain),
+	dynamicRendering_(dynamicRendering),
+	userSettings_(userSettings),
+	window_(window),
+	renderThread_(window.Config().RenderThread)
 {
 	const auto& device = swapChain.Device();
-	const auto& window = device.Surface().Instance().Window();
 
 	// Initialise descriptor pool and render pass for ImGui.
 	const std::vector<Vulkan::DescriptorBinding> descriptorBindings =
@@ -46,14 +151,18 @@ UserInterface::UserInterface(
 		{0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0},
 	};
 	descriptorPool_.reset(new Vulkan::DescriptorPool(device, descriptorBindings, 1));
-	renderPass_.reset(new Vulkan::RenderPass(swapChain, depthBuffer, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_LOAD_OP_LOAD));
+
+	if (!dynamicRendering_)
+	{
+		renderPass_.reset(new Vulkan::RenderPass(swapChain, depthBuffer, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_LOAD_OP_LOAD));
+	}
 
 	// Initialise ImGui
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 
-	// Initialise ImGui GLFW adapter
-	if (!ImGui_ImplGlfw_InitForVulkan(window.Handle(), true))
+	// Initialise ImGui GLFW adapter, not with a render thread (see NewPlatformFrame()).
+	if (!renderThread_ && !ImGui_ImplGlfw_InitForVulkan(window.Handle(), true))
 	{
 		Throw(std::runtime_error("failed to initialise ImGui GLFW adapter"));
 	}
@@ -71,8 +180,10 @@ UserInterface::UserInterface(
 	vulkanInit.ImageCount = static_cast<uint32_t>(swapChain.Images().size());
 	vulkanInit.Allocator = nullptr;
 	vulkanInit.CheckVkResultFn = CheckVulkanResultCallback;
+	vulkanInit.UseDynamicRendering = dynamicRendering_ != nullptr;
+	vulkanInit.ColorAttachmentFormat = swapChain.Format();
 
-	if (!ImGui_ImplVulkan_Init(&vulkanInit, renderPass_->Handle()))
+	if (!ImGui_ImplVulkan_Init(&vulkanInit, renderPass_ ? renderPass_->Handle() : nullptr))
 	{
 		Throw(std::runtime_error("failed to initialise ImGui vulkan adapter"));
 	}
@@ -82,6 +193,11 @@ UserInterface::UserInterface(
 	// No ini file.
 	io.IniFilename = nullptr;
 
+	if (renderThread_)
+	{
+		io.BackendFlags |= ImGuiBackendFlags_HasMouseCursors;
+	}
+
 	// Window scaling and style.
 	const auto scaleFactor = window.ContentScale();
 
@@ -109,27 +225,60 @@ UserInterface::UserInterface(
 UserInterface::~UserInterface()
 {
 	ImGui_ImplVulkan_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
+
+	if (!renderThread_)
+	{
+		ImGui_ImplGlfw_Shutdown();
+	}
+
 	ImGui::DestroyContext();
 }
 
-void UserInterface::Render(VkCommandBuffer commandBuffer, const Vulkan::FrameBuffer& frameBuffer, const Statistics& statistics)
+void UserInterface::Render(VkCommandBuffer commandBuffer, const uint32_t imageIndex, const Vulkan::FrameBuffer* const frameBuffer, const Statistics& statistics)
 {
-	ImGui_ImplGlfw_NewFrame();
+	if (renderThread_)
+	{
+		NewPlatformFrame();
+	}
+	else
+	{
+		ImGui_ImplGlfw_NewFrame();
+	}
+
 	ImGui_ImplVulkan_NewFrame();
 	ImGui::NewFrame();
 
+	RecordPerformance(statistics);
+
 	DrawSettings();
 	DrawOverlay(statistics);
+	DrawPerformance(statistics);
 	//ImGui::ShowStyleEditor();
 	ImGui::Render();
 
+	// The swap chain image is already in the present layout, so there is nothing to transition when the pass is skipped.
+	const VkRect2D drawArea = GetDrawArea(*ImGui::GetDrawData(), swapChain_.Extent());
+
+	if (drawArea.extent.width == 0 || drawArea.extent.height == 0)
+	{
+		return;
+	}
+
+	if (dynamicRendering_)
+	{
+		const VkImage image = swapChain_.Images()[imageIndex];
+
+		dynamicRendering_->Begin(commandBuffer, image, swapChain_.ImageViews()[imageIndex]->Handle(), nullptr, drawArea, VK_ATTACHMENT_LOAD_OP_LOAD);
+		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+		dynamicRendering_->End(commandBuffer, image);
+		return;
+	}
+
 	VkRenderPassBeginInfo renderPassInfo = {};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassInfo.renderPass = renderPass_->Handle();
-	renderPassInfo.framebuffer = frameBuffer.Handle();
-	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = renderPass_->SwapChain().Extent();
+	renderPassInfo.framebuffer = frameBuffer->Handle();
+	renderPassInfo.renderArea = drawArea;
 	renderPassInfo.clearValueCount = 0;
 	renderPassInfo.pClearValues = nullptr;
 
@@ -138,14 +287,110 @@ void UserInterface::Render(VkCommandBuffer commandBuffer, const Vulkan::FrameBuf
 	vkCmdEndRenderPass(commandBuffer);
 }
 
+bool UserInterface::IsVisible() const
+{
+	return userSettings_.ShowSettings || userSettings_.ShowOverlay || userSettings_.ShowPerformance;
+}
+
+void UserInterface::OnInputEvent(const Vulkan::Window::InputEvent& event)
+{
+	using Vulkan::Window;
+
+	const auto& values = event.Values;
+	auto& io = ImGui::GetIO();
+
+	// The same as the GLFW backend callbacks.
+	switch (event.Type)
+	{
+	case Window::InputEvent::Key:
+		if (values[2] == GLFW_PRESS || values[2] == GLFW_RELEASE)
+		{
+			const int key = TranslateUntranslatedKey(window_, values[0], values[1]);
+			const ImGuiKey imguiKey = ImGui_ImplGlfw_KeyToImGuiKey(key);
+
+			UpdateKeyModifiers(io, values[3]);
+			io.AddKeyEvent(imguiKey, values[2] == GLFW_PRESS);
+			io.SetKeyEventNativeData(imguiKey, key, values[1]);
+		}
+		break;
+
+	case Window::InputEvent::Char:
+		io.AddInputCharacter(static_cast<unsigned int>(values[0]));
+		break;
+
+	case Window::InputEvent::CursorPosition:
+		io.AddMousePosEvent(static_cast<float>(event.X), static_cast<float>(event.Y));
+		lastCursorX_ = event.X;
+		lastCursorY_ = event.Y;
+		break;
+
+	case Window::InputEvent::CursorEnter:
+		if (values[0])
+		{
+			io.AddMousePosEvent(static_cast<float>(lastCursorX_), static_cast<float>(lastCursorY_));
+		}
+		else
+		{
+			io.AddMousePosEvent(-FLT_MAX, -FLT_MAX);
+		}
+		break;
+
+	case Window::InputEvent::MouseButton:
+		UpdateKeyModifiers(io, values[2]);
+
+		if (values[0] >= 0 && values[0] < ImGuiMouseButton_COUNT)
+		{
+			io.AddMouseButtonEvent(values[0], values[1] == GLFW_PRESS);
+		}
+		break;
+
+	case Window::InputEvent::Scroll:
+		io.AddMouseWheelEvent(static_cast<float>(event.X), static_cast<float>(event.Y));
+		break;
+
+	case Window::InputEvent::Focus:
+		io.AddFocusEvent(values[0] != 0);
+		break;
+	}
+}
+
+void UserInterface::NewPlatformFrame()
+{
+	auto& io = ImGui::GetIO();
+
+	const auto windowSize = window_.WindowSize();
+	const auto framebufferSize = window_.FramebufferSize();
+
+	io.DisplaySize = ImVec2(static_cast<float>(windowSize.width), static_cast<float>(windowSize.height));
+
+	if (windowSize.width > 0 && windowSize.height > 0)
+	{
+		io.DisplayFramebufferScale = ImVec2(
+			static_cast<float>(framebufferSize.width) / windowSize.width,
+			static_cast<float>(framebufferSize.height) / windowSize.height);
+	}
+
+	// Unlike the other GLFW calls of the backend, glfwGetTime() may be called from any thread.
+	const double time = window_.GetTime();
+	io.DeltaTime = time_ > 0 ? static_cast<float>(time - time_) : 1.0f / 60.0f;
+	time_ = time;
+
+	// The cursor of the last frame, as the backend does.
+	if ((io.ConfigFlags & ImGuiConfigFlags_NoMouseCursorChange) == 0)
+	{
+		window_.SetCursor(GetCursorShape(io.MouseDrawCursor ? ImGuiMouseCursor_None : ImGui::GetMouseCursor()));
+	}
+}
+
 bool UserInterface::WantsToCaptureKeyboard() const
 {
-	return ImGui::GetIO().WantCaptureKeyboard;
+	// The IO state of the last drawn frame is stale once hidden.
+	return IsVisible() && ImGui::GetIO().WantCaptureKeyboard;
 }
 
 bool UserInterface::WantsToCaptureMouse() const
 {
-	return ImGui::GetIO().WantCaptureMouse;
+	return IsVisible() && ImGui::GetIO().WantCaptureMouse;
 }
 
 void UserInterface::DrawSettings()
@@ -175,12 +420,18 @@ void UserInterface::DrawSettings()
 			scenes.push_back(scene.first.c_str());
 		}
 
+		if (!Settings().SceneFile.empty())
+		{
+			scenes.push_back(Settings().SceneFile.c_str());
+		}
+
 		const auto& window = descriptorPool_->Device().Surface().Instance().Window();
 
 		ImGui::Text("Help");
 		ImGui::Separator();
 		ImGui::BulletText("F1: toggle Settings.");
 		ImGui::BulletText("F2: toggle Statistics.");
+		ImGui::BulletText("F12: export the accumulated image (PNG and EXR).");
 		ImGui::BulletText(
 			"%c%c%c%c/SHIFT/CTRL: move camera.", 
 			std::toupper(window.GetKeyName(GLFW_KEY_W, 0)[0]),
@@ -195,16 +446,42 @@ void UserInterface::DrawSettings()
 		ImGui::PushItemWidth(-1);
 		ImGui::Combo("##SceneList", &Settings().SceneIndex, scenes.data(), static_cast<int>(scenes.size()));
 		ImGui::PopItemWidth();
+		ImGui::Checkbox("Tessellate the spheres", &Settings().TessellatedSpheres);
 		ImGui::NewLine();
 
 		ImGui::Text("Ray Tracing");
 		ImGui::Separator();
 		ImGui::Checkbox("Enable ray tracing", &Settings().IsRayTraced);
 		ImGui::Checkbox("Accumulate rays between frames", &Settings().AccumulateRays);
+		ImGui::Checkbox("Sample the lights", &Settings().LightSampling);
+		ImGui::Checkbox("Select the lights through their tree", &Settings().LightTree);
+		ImGui::Checkbox("Resample the lights (ReSTIR)", &Settings().Restir);
+		ImGui::Checkbox("Cache the diffuse radiance", &Settings().RadianceCache);
+		ImGui::Checkbox("Guide the diffuse bounces", &Settings().PathGuiding);
+		ImGui::Checkbox("Reorder hits by material", &Settings().InvocationReorder);
+		ImGui::Checkbox("Compact materials", &Settings().CompactMaterials);
+		ImGui::Checkbox("Regenerate the ended paths", &Settings().RegeneratePaths);
+		ImGui::Checkbox("Wavefront ray queries", &Settings().Wavefront);
+		ImGui::Checkbox("Rasterized primary visibility", &Settings().Hybrid);
+		ImGui::Checkbox("Half float accumulation", &Settings().HalfAccumulation);
 		uint32_t min = 1, max = 128;
 		ImGui::SliderScalar("Samples", ImGuiDataType_U32, &Settings().NumberOfSamples, &min, &max);
 		min = 1, max = 32;
 		ImGui::SliderScalar("Bounces", ImGuiDataType_U32, &Settings().NumberOfBounces, &min, &max);
+		min = 0, max = 32;
+		ImGui::SliderScalar("Roulette depth", ImGuiDataType_U32, &Settings().RussianRouletteDepth, &min, &max, Settings().RussianRouletteDepth == 0 ? "Off" : "%u");
+		ImGui::SliderFloat("Adaptive", &Settings().AdaptiveSamplingThreshold, 0.0f, 0.1f, Settings().AdaptiveSamplingThreshold == 0 ? "Off" : "%.3f");
+		ImGui::SliderFloat("Foveation", &Settings().FoveaRadius, 0.0f, 0.5f, Settings().FoveaRadius == 0 ? "Off" : "%.2f");
+		min = 0, max = 5;
+		ImGui::SliderScalar("Denoise", ImGuiDataType_U32, &Settings().DenoiseIterations, &min, &max, Settings().DenoiseIterations == 0 ? "Off" : "%u");
+		min = 0, max = 1024;
+		ImGui::SliderScalar("Reprojection", ImGuiDataType_U32, &Settings().ReprojectedSamples, &min, &max, Settings().ReprojectedSamples == 0 ? "Off" : "%u");
+		min = 0, max = 2;
+		ImGui::SliderScalar("Interleave", ImGuiDataType_U32, &Settings().Interleave, &min, &max, Settings().Interleave == 0 ? "Off" : Settings().Interleave == 1 ? "Checkerboard" : "2x2");
+		ImGui::SliderScalar("Isolate rays", ImGuiDataType_U32, &Settings().RayIsolation, &min, &max, Settings().RayIsolation == 0 ? "Off" : Settings().RayIsolation == 1 ? "Primary" : "Shadow");
+		ImGui::SliderFloat("Budget (ms)", &Settings().FrameBudget, 0.0f, 100.0f, Settings().FrameBudget == 0 ? "Off" : "%.0f");
+		ImGui::SliderFloat("Sample budget (ms)", &Settings().SampleBudget, 0.0f, 100.0f, Settings().SampleBudget == 0 ? "Off" : "%.0f");
+		ImGui::SliderFloat("Render scale", &Settings().RenderScale, 0.25f, 1.0f, "%.2f");
 		ImGui::NewLine();
 
 		ImGui::Text("Camera");
@@ -212,12 +489,18 @@ void UserInterface::DrawSettings()
 		ImGui::SliderFloat("FoV", &Settings().FieldOfView, UserSettings::FieldOfViewMinValue, UserSettings::FieldOfViewMaxValue, "%.0f");
 		ImGui::SliderFloat("Aperture", &Settings().Aperture, 0.0f, 1.0f, "%.2f");
 		ImGui::SliderFloat("Focus", &Settings().FocusDistance, 0.1f, 20.0f, "%.1f");
+		min = 1, max = 8;
+		ImGui::SliderScalar("Views", ImGuiDataType_U32, &Settings().Views, &min, &max);
+		ImGui::SliderFloat("View orbit", &Settings().ViewOrbit, -90.0f, 90.0f, "%.0f");
 		ImGui::NewLine();
 
 		ImGui::Text("Profiler");
 		ImGui::Separator();
 		ImGui::Checkbox("Show heatmap", &Settings().ShowHeatmap);
 		ImGui::SliderFloat("Scaling", &Settings().HeatmapScale, 0.10f, 10.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+		ImGui::Combo("Stage", &Settings().HeatmapStage, HeatmapStages, static_cast<int>(std::size(HeatmapStages)));
+		ImGui::SliderInt("Bounce", &Settings().HeatmapBounce, 0, 8, Settings().HeatmapBounce == 0 ? "all" : "%d");
+		ImGui::Checkbox("Profile stages", &Settings().ProfileStages);
 		ImGui::NewLine();
 	}
 	ImGui::End();
@@ -251,7 +534,222 @@ void UserInterface::DrawOverlay(const Statistics& statistics)
 		ImGui::Separator();
 		ImGui::Text("Frame rate: %.1f fps", statistics.FrameRate);
 		ImGui::Text("Primary ray rate: %.2f Gr/s", statistics.RayRate);
+		if (statistics.TotalRayRate >= 0) ImGui::Text("Total ray rate: %.2f Gr/s", statistics.TotalRayRate);
 		ImGui::Text("Accumulated samples:  %u", statistics.TotalSamples);
+
+		// GPU timings are only shown once they have been measured.
+		if (statistics.TraceTime >= 0 || statistics.DenoiseTime >= 0 || statistics.CopyTime >= 0 || statistics.UserInterfaceTime >= 0)
+		{
+			ImGui::Separator();
+		}
+
+		if (statistics.TraceTime >= 0) ImGui::Text("GPU trace: %.2f ms", statistics.TraceTime);
+		if (statistics.DenoiseTime >= 0) ImGui::Text("GPU denoise: %.2f ms", statistics.DenoiseTime);
+		if (statistics.DenoiseTime >= 0 && statistics.DenoiseOverlapTime >= 0) ImGui::Text("  overlapped with trace: %.2f ms", statistics.DenoiseOverlapTime);
+		if (statistics.CopyTime >= 0) ImGui::Text("GPU copy: %.2f ms", statistics.CopyTime);
+		if (statistics.UserInterfaceTime >= 0) ImGui::Text("GPU UI: %.2f ms", statistics.UserInterfaceTime);
+		if (statistics.Latency >= 0) ImGui::Text("Input latency: %.1f ms", statistics.Latency);
+
+		if (statistics.IsStreaming)
+		{
+			ImGui::Separator();
+			ImGui::Text("Streaming: %.1f fps, %.1f Mbit/s", statistics.StreamFrameRate, statistics.StreamBitRate);
+			ImGui::Text("Stream encode: %.1f ms", statistics.StreamEncodeTime);
+			if (statistics.StreamRoundTrip >= 0) ImGui::Text("Stream latency: %.1f ms", statistics.StreamRoundTrip);
+		}
+
+		// The shares of the ray tracing stages in the profiled clocks, the hit shaders being part of the traces.
+		if (!statistics.StageClocks.empty())
+		{
+			const double traced = static_cast<double>(statistics.StageClocks[0] + statistics.StageClocks[1] + statistics.StageClocks[2]);
+
+			ImGui::Separator();
+
+			for (size_t i = 0; i != statistics.StageClocks.size(); ++i)
+			{
+				ImGui::Text("%s: %.1f%%", ProfileStageNames[i], traced > 0 ? 100 * statistics.StageClocks[i] / traced : 0.0);
+			}
+		}
+
+		// How the paths of the last counted frame ended, and the share of the rays at each depth.
+		if (!statistics.RayCounters.empty() && statistics.RayCounters[RayCounterTraceCalls] != 0)
+		{
+			const auto& counters = statistics.RayCounters;
+			const double rays = static_cast<double>(counters[RayCounterTraceCalls]);
+			const double paths = static_cast<double>(counters[RayCounterBounceRays]);
+
+			ImGui::Separator();
+			ImGui::Text("Rays: %.2f M (%.1f%% shadow)", rays / 1000000, 100 * counters[RayCounterShadowRays] / rays);
+
+			if (paths > 0)
+			{
+				ImGui::Text("Paths: %.1f%% missed, %.1f%% absorbed", 100 * counters[RayCounterMisses] / paths, 100 * counters[RayCounterAbsorptions] / paths);
+				ImGui::Text("Paths: %.1f%% roulette, %.1f%% bounce limit", 100 * counters[RayCounterRoulette] / paths, 100 * counters[RayCounterBounceLimit] / paths);
+
+				if (counters[RayCounterRadianceCache] != 0)
+				{
+					ImGui::Text("Paths: %.1f%% ended in the radiance cache", 100 * counters[RayCounterRadianceCache] / paths);
+				}
+
+				if (counters[RayCounterMediumCollisions] != 0)
+				{
+					ImGui::Text("Medium scatterings: %.2f per path", counters[RayCounterMediumCollisions] / paths);
+				}
+
+				std::string depths;
+
+				for (size_t i = RayCounterBounceRays; i != counters.size() && counters[i] != 0; ++i)
+				{
+					char depth[16];
+					std::snprintf(depth, sizeof(depth), "%s%.0f%%", depths.empty() ? "" : " ", 100 * counters[i] / paths);
+					depths += depth;
+				}
+
+				ImGui::Text("Rays per depth: %s", depths.c_str());
+			}
+		}
+
+		// The paged BLAS (see --geometry-budget), the others being traced through their proxy.
+		if (statistics.GeometryPages != 0)
+		{
+			const float megabyte = 1024 * 1024;
+
+			ImGui::Separator();
+			ImGui::Text("Geometry: %u / %u BLAS resident, %.0f / %.0f MB", statistics.ResidentPages, statistics.GeometryPages, statistics.PagePoolUsage / megabyte, statistics.PagePoolSize / megabyte);
+			ImGui::Text("Page ins / evictions: %llu / %llu", static_cast<unsigned long long>(statistics.PageIns), static_cast<unsigned long long>(statistics.PageEvictions));
+		}
+
+		// The heaps usage (and budget with VK_EXT_memory_budget), then what the application allocated.
+		if (!statistics.HeapBudgets.empty())
+		{
+			const float megabyte = 1024 * 1024;
+
+			ImGui::Separator();
+
+			for (size_t i = 0; i != statistics.HeapBudgets.size(); ++i)
+			{
+				const auto& heap = statistics.HeapBudgets[i];
+
+				ImGui::Text("Heap %u (%s): %.0f / %.0f MB", static_cast<uint32_t>(i), heap.IsDeviceLocal ? "device" : "host", heap.Usage / megabyte, heap.Budget / megabyte);
+			}
+
+			for (size_t i = 0; i != statistics.MemoryCategories.size(); ++i)
+			{
+				if (statistics.MemoryCategories[i] != 0)
+				{
+					const auto name = Vulkan::MemoryAllocator::CategoryName(static_cast<Vulkan::MemoryAllocator::Category>(i));
+					ImGui::Text("- %s: %.1f MB", name, statistics.MemoryCategories[i] / megabyte);
+				}
+			}
+		}
+	}
+	ImGui::End();
+}
+
+void UserInterface::DrawPerformance(const Statistics& statistics)
+{
+	if (!Settings().ShowPerformance)
+	{
+		return;
+	}
+
+	const auto& io = ImGui::GetIO();
+	const float distance = 10.0f;
+	const ImVec2 pos = ImVec2(io.DisplaySize.x - distance, io.DisplaySize.y - distance);
+	const ImVec2 posPivot = ImVec2(1.0f, 1.0f);
+	ImGui::SetNextWindowPos(pos, ImGuiCond_Always, posPivot);
+	ImGui::SetNextWindowBgAlpha(0.3f); // Transparent background
+
+	const auto flags =
+		ImGuiWindowFlags_AlwaysAutoResize |
+		ImGuiWindowFlags_NoDecoration |
+		ImGuiWindowFlags_NoFocusOnAppearing |
+		ImGuiWindowFlags_NoMove |
+		ImGuiWindowFlags_NoNav |
+		ImGuiWindowFlags_NoSavedSettings;
+
+	struct Series final
+	{
+		const PerformanceHistory* History;
+		size_t Value;
+	};
+
+	// Reads the history in place, nothing is copied per frame.
+	const auto getValue = [](void* const data, const int index)
+	{
+		const auto& series = *static_cast<const Series*>(data);
+		return (*series.History)[index].Values[series.Value];
+	};
+
+	const auto plot = [this, getValue](const char* const name, const char* const unit, const size_t value)
+	{
+		const int count = static_cast<int>(performanceHistory_.Size());
+
+		if (count == 0)
+		{
+			return;
+		}
+
+		Series series = { &performanceHistory_, value };
+		const float latest = performanceHistory_[count - 1].Values[value];
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "%s: %.2f %s", name, latest, unit);
+
+		ImGui::PlotLines((std::string("##") + name).c_str(), getValue, &series, count, 0, overlay, 0.0f, FLT_MAX, ImVec2(320, 40));
+	};
+
+	if (ImGui::Begin("Performance", &Settings().ShowPerformance, flags))
+	{
+		ImGui::Text("Performance (last %u frames):", static_cast<uint32_t>(PerformanceHistory::MaxSize()));
+		ImGui::Separator();
+		plot("CPU frame", "ms", PerformanceSample::FrameTime);
+		plot("Present wait", "ms", PerformanceSample::PresentWaitTime);
+		plot("GPU trace", "ms", PerformanceSample::TraceTime);
+		plot("GPU denoise", "ms", PerformanceSample::DenoiseTime);
+		plot("GPU copy", "ms", PerformanceSample::CopyTime);
+		plot("GPU UI", "ms", PerformanceSample::UserInterfaceTime);
+		plot("GPU TLAS build", "ms", PerformanceSample::TopLevelBuildTime);
+		plot("Primary rays", "Gr/s", PerformanceSample::RayRate);
+		plot("All rays", "Gr/s", PerformanceSample::TotalRayRate);
+
+		if (statistics.BuildTime >= 0)
+		{
+			ImGui::Text("Acceleration structures built in %.2f s", statistics.BuildTime);
+		}
+
+		ImGui::Separator();
+
+		for (size_t i = 0; i != statistics.MemoryCategories.size(); ++i)
+		{
+			if (statistics.MemoryCategories[i] != 0)
+			{
+				plot(Vulkan::MemoryAllocator::CategoryName(static_cast<Vulkan::MemoryAllocator::Category>(i)), "MB", PerformanceSample::MemoryCategory + i);
+			}
+		}
 	}
 	ImGui::End();
 }
+
+void UserInterface::RecordPerformance(const Statistics& statistics)
+{
+	const float megabyte = 1024 * 1024;
+	const auto measured = [](const float value) { return value > 0 ? value : 0.0f; };
+
+	PerformanceSample sample = {};
+	sample.Values[PerformanceSample::FrameTime] = measured(statistics.FrameTime);
+	sample.Values[PerformanceSample::TraceTime] = measured(statistics.TraceTime);
+	sample.Values[PerformanceSample::DenoiseTime] = measured(statistics.DenoiseTime);
+	sample.Values[PerformanceSample::CopyTime] = measured(statistics.CopyTime);
+	sample.Values[PerformanceSample::UserInterfaceTime] = measured(statistics.UserInterfaceTime);
+	sample.Values[PerformanceSample::TopLevelBuildTime] = measured(statistics.TopLevelBuildTime);
+	sample.Values[PerformanceSample::RayRate] = measured(statistics.RayRate);
+	sample.Values[PerformanceSample::TotalRayRate] = measured(statistics.TotalRayRate);
+	sample.Values[PerformanceSample::PresentWaitTime] = measured(statistics.PresentWaitTime);
+
+	for (size_t i = 0; i != statistics.MemoryCategories.size(); ++i)
+	{
+		sample.Values[PerformanceSample::MemoryCategory + i] = statistics.MemoryCategories[i] / megabyte;
+	}
+
+	performanceHistory_.Push(sample);
+}
@@ -1,12 +1,18 @@
 #pragma once
+#include "Utilities/RingBuffer.hpp"
+#include "Vulkan/MemoryAllocator.hpp"
 #include "Vulkan/Vulkan.hpp"
+#include "Vulkan/Window.hpp"
+#include <array>
 #include <memory>
+#include <vector>
 
 namespace Vulkan
 {
 	class CommandPool;
 	class DepthBuffer;
 	class DescriptorPool;
+	class DynamicRendering;
 	class FrameBuffer;
 	class RenderPass;
 	class SwapChain;
@@ -18,8 +24,34 @@ struct Statistics final
 {
 	VkExtent2D FramebufferSize;
 	float FrameRate;
-	float RayRate;
+	float RayRate; // Billion primary rays per second.
+	float TotalRayRate; // Billion rays traced per second, the bounce and shadow rays included. Negative when not counted.
 	uint32_t TotalSamples;
+	float TraceTime; // GPU milliseconds, negative when not measured.
+	float DenoiseTime;
+	float DenoiseOverlapTime; // Of an asynchronous denoise with the trace of the next frame, negative when not measured.
+	float CopyTime;
+	float UserInterfaceTime;
+	float Latency; // CPU milliseconds from input to present with --low-latency, negative when not measured.
+	float FrameTime; // CPU milliseconds between the last two frames.
+	float PresentWaitTime; // CPU milliseconds blocked on the presentation engine.
+	bool IsStreaming; // A viewer is connected, see FrameStreamer.
+	float StreamFrameRate;
+	float StreamBitRate; // Mbit/s
+	float StreamEncodeTime; // CPU milliseconds per frame.
+	float StreamRoundTrip; // Milliseconds from the send of a frame to the viewer showing it, negative until measured.
+	float TopLevelBuildTime; // GPU milliseconds of the last TLAS build, negative until measured.
+	float BuildTime; // Seconds of the last acceleration structures build, negative until done.
+	uint32_t GeometryPages; // BLAS paged through the geometry budget pool, 0 without paging.
+	uint32_t ResidentPages;
+	VkDeviceSize PagePoolSize;
+	VkDeviceSize PagePoolUsage;
+	uint64_t PageIns; // Since the scene was loaded.
+	uint64_t PageEvictions;
+	std::vector<Vulkan::MemoryAllocator::HeapBudget> HeapBudgets;
+	Vulkan::MemoryAllocator::CategoryBytes MemoryCategories; // What the application allocated.
+	std::vector<uint64_t> StageClocks; // GPU clocks of the last frame per profiled stage (see Profile.glsl), empty unless profiled.
+	std::vector<uint64_t> RayCounters; // Of the last counted frame (see RayCounters.glsl), empty when not counted.
 };
 
 class UserInterface final
@@ -32,10 +64,21 @@ public:
 		Vulkan::CommandPool& commandPool, 
 		const Vulkan::SwapChain& swapChain, 
 		const Vulkan::DepthBuffer& depthBuffer,
+		const Vulkan::DynamicRendering* dynamicRendering,
+		Vulkan::Window& window,
 		UserSettings& userSettings);
 	~UserInterface();
 
-	void Render(VkCommandBuffer commandBuffer, const Vulkan::FrameBuffer& frameBuffer, const Statistics& statistics);
+	// Only loads and stores the part of the frame buffer the windows cover, and records nothing when they are all clipped out.
+	// Draws into the swap chain image itself with dynamic rendering, into its frame buffer otherwise.
+	void Render(VkCommandBuffer commandBuffer, uint32_t imageIndex, const Vulkan::FrameBuffer* frameBuffer, const Statistics& statistics);
+
+	// False when both the settings and the overlay are hidden, the caller then skips the UI altogether.
+	bool IsVisible() const;
+
+	// With a render thread, ImGui gets the window events queued for it rather than installing its GLFW callbacks.
+	// They are fed to the IO without the GLFW backend, whose calls are main thread only.
+	void OnInputEvent(const Vulkan::Window::InputEvent& event);
 
 	bool WantsToCaptureKeyboard() const;
 	bool WantsToCaptureMouse() const;
@@ -44,10 +87,36 @@ public:
 
 private:
 
+	// One frame of the performance panel graphs, the unmeasured values being zero.
+	struct PerformanceSample final
+	{
+		enum Value { FrameTime, TraceTime, DenoiseTime, CopyTime, UserInterfaceTime, TopLevelBuildTime, RayRate, TotalRayRate, PresentWaitTime, MemoryCategory };
+		static constexpr size_t ValueCount = MemoryCategory + static_cast<size_t>(Vulkan::MemoryAllocator::Category::Count);
+
+		std::array<float, ValueCount> Values;
+	};
+
+	using PerformanceHistory = Utilities::RingBuffer<PerformanceSample, 240>;
+
 	void DrawSettings();
 	void DrawOverlay(const Statistics& statistics);
+	void DrawPerformance(const Statistics& statistics);
+	void RecordPerformance(const Statistics& statistics);
+
+	// With a render thread, stands in for ImGui_ImplGlfw_NewFrame() with the sizes the window cached, the cursor is left to the main thread.
+	void NewPlatformFrame();
 
+	const Vulkan::SwapChain& swapChain_;
+	const Vulkan::DynamicRendering* const dynamicRendering_;
 	std::unique_ptr<Vulkan::DescriptorPool> descriptorPool_;
-	std::unique_ptr<Vulkan::RenderPass> renderPass_;
+	std::unique_ptr<Vulkan::RenderPass> renderPass_; // Only without dynamic rendering.
 	UserSettings& userSettings_;
+	PerformanceHistory performanceHistory_; // Only filled while the UI is shown.
+
+	// Without the GLFW backend, see NewPlatformFrame().
+	Vulkan::Window& window_;
+	const bool renderThread_;
+	double time_{};
+	double lastCursorX_{};
+	double lastCursorY_{};
 };
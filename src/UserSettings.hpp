@@ -1,4 +1,6 @@
 #pragma once
+#include <string>
+#include <vector>
 
 struct UserSettings final
 {
@@ -8,16 +10,93 @@ struct UserSettings final
 	// Benchmark
 	bool BenchmarkNextScenes{};
 	uint32_t BenchmarkMaxTime{};
+	std::string BenchmarkOutput;
+	std::string BenchmarkReference;
+	bool BenchmarkDeterministic{};
+	std::vector<std::string> BenchmarkSweep;
+	float BenchmarkWarmUp{}; // seconds
+	std::string BenchmarkBaseline;
+	float RegressionThreshold{}; // percent
+	bool MeasurePower{};
+
+	// Export
+	std::string ExportOutput;
+	std::string HeadlessOutput;
+	std::string CameraPath; // An image sequence rather than a single image when not empty.
+	std::string SequencePipe;
+	std::string BakeProbes; // A probe bake rather than the camera view when not empty.
+	std::string Checkpoint; // Resumed, then rewritten every CheckpointInterval seconds when not empty.
+	float CheckpointInterval;
+	std::vector<uint32_t> ProbeGrid;
+	uint32_t ProbeEncoding{}; // See ProbeBaker::Encoding.
 	
 	// Scene
 	int SceneIndex;
+	std::string SceneFile; // The last scene index when not empty.
+	bool TessellatedSpheres; // Reloads the scene when changed.
+	bool LevelOfDetail; // Applied when the scene is loaded, then updated as the camera moves.
+	bool GpuNormals; // Applied when the scene is loaded.
+	std::string Environment; // Replaces the sky of every scene when not empty.
+	float EnvironmentIntensity;
 
 	// Renderer
 	bool IsRayTraced;
 	bool AccumulateRays;
 	uint32_t NumberOfSamples;
 	uint32_t NumberOfBounces;
+	uint32_t RussianRouletteDepth; // 0 = disabled
+	bool LightSampling;
+	bool LightTree; // Only with the light sampling.
+	float AdaptiveSamplingThreshold; // 0 = disabled
+	float FoveaRadius; // Of the image diagonal, 0 = every pixel traces all its samples. Not with the wavefront backend.
+	float FoveaMinFraction; // Of the samples, traced by the pixels far from the gaze point.
+	float GazeX; // In [0, 1] of the image width.
+	float GazeY; // In [0, 1] of the image height.
+	uint32_t DenoiseIterations; // 0 = disabled
+	bool AsyncDenoise; // Fixed when the swap chain is created.
+	uint32_t ReprojectedSamples; // 0 = disabled, the camera motions reset the accumulation
+	uint32_t Interleave; // 0 = disabled, 1 = checkerboard, 2 = 2x2 blocks, only while reprojecting.
 	uint32_t MaxNumberOfSamples;
+	float FrameBudget; // GPU trace milliseconds per frame, 0 = the whole image every frame.
+	float SampleBudget; // Same, the samples per frame being picked up to NumberOfSamples, 0 = always NumberOfSamples.
+	float RenderScale; // Of the window size, recreates the traced images when changed.
+	bool HalfAccumulation; // Recreates the traced images when changed.
+	bool CompactAccelerationStructures;
+	bool MergeProcedurals;
+	bool CacheAccelerationStructures;
+	bool HostBuildAccelerationStructures; // Ignored when the device does not support it.
+	uint32_t GeometryBudget; // MB of the paged BLAS pool, 0 = all resident.
+	bool AnimateInstances;
+	bool DeformVertices;
+	uint32_t DeformRebuildInterval; // Refits between the rebuilds of the deformed BLAS, 0 = never rebuilt.
+	uint32_t BuildPolicy;
+	uint32_t Sampler; // Fixed when the ray tracing pipeline is created.
+	uint32_t LaunchOrder; // Fixed when the ray tracing pipeline is created.
+	bool PushConstants;
+	bool HostVisibleShaderBindingTable;
+	bool InvocationReorder; // Ignored without VK_NV_ray_tracing_invocation_reorder.
+	bool Wavefront; // Ignored without VK_KHR_ray_query.
+	bool Hybrid; // Only with the wavefront backend.
+	bool Restir; // Only with the light sampling, not with the wavefront backend.
+	bool RadianceCache; // Not with the wavefront backend.
+	bool PathGuiding; // Not with the wavefront backend.
+	uint32_t Views{1}; // Cameras traced by every launch, recreates the traced images when changed. Not with the wavefront backend.
+	float ViewOrbit; // Degrees between consecutive views about the focus point.
+	uint32_t TextureBudget;
+	bool CompactVertices;
+	bool PositionStream;
+	bool CompactMaterials; // A pipeline variant, the scene has both material layouts.
+	bool RegeneratePaths; // A pipeline variant, the same samples traced in another order.
+	uint32_t FramesInFlight;
+	bool LowLatency;
+	bool RenderPasses; // Rather than dynamic rendering, read when setting the physical device.
+	bool KeepDrawing; // Otherwise the window waits for input once the accumulation has converged.
+	uint32_t StreamPort; // 0 = not streamed, see FrameStreamer.
+	uint32_t StreamQuality;
+	uint32_t MetricsPort; // 0 = not served, see MetricsExporter.
+	std::string MetricsFile;
+	uint32_t SampleStreamIndex{}; // The interleaved share of the samples traced by this device (see --devices), or the first sample of a render farm range.
+	uint32_t SampleStreamCount{1};
 
 	// Camera
 	float FieldOfView;
@@ -27,10 +106,15 @@ struct UserSettings final
 	// Profiler
 	bool ShowHeatmap;
 	float HeatmapScale;
+	int HeatmapStage; // 0 = the whole ray generation, otherwise 1 + the stage of Profile.glsl.
+	int HeatmapBounce; // 0 = all the bounces.
+	bool ProfileStages; // Accumulate the stage clocks even without the heatmap, for the benchmark report.
+	uint32_t RayIsolation; // 0 = whole paths, 1 = the camera rays only, 2 = the camera rays traced as shadow rays. Not with the wavefront backend.
 
 	// UI
 	bool ShowSettings;
 	bool ShowOverlay;
+	bool ShowPerformance;
 
 	inline const static float FieldOfViewMinValue = 10.0f;
 	inline const static float FieldOfViewMaxValue = 90.0f;
@@ -39,8 +123,20 @@ struct UserSettings final
 	{
 		return
 			IsRayTraced != prev.IsRayTraced ||
+			Wavefront != prev.Wavefront ||
+			Hybrid != prev.Hybrid ||
+			Restir != prev.Restir ||
+			RadianceCache != prev.RadianceCache ||
+			PathGuiding != prev.PathGuiding ||
+			RayIsolation != prev.RayIsolation ||
+			ViewOrbit != prev.ViewOrbit ||
 			AccumulateRays != prev.AccumulateRays ||
 			NumberOfBounces != prev.NumberOfBounces ||
+			RussianRouletteDepth != prev.RussianRouletteDepth ||
+			LightSampling != prev.LightSampling ||
+			LightTree != prev.LightTree ||
+			CompactMaterials != prev.CompactMaterials ||
+			AdaptiveSamplingThreshold != prev.AdaptiveSamplingThreshold ||
 			FieldOfView != prev.FieldOfView ||
 			Aperture != prev.Aperture ||
 			FocusDistance != prev.FocusDistance;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <cstddef>
+#include <memory_resource>
+
+namespace Utilities
+{
+	// A monotonic arena for the temporaries of a single build (e.g. the Scene constructor), handed to std::pmr containers. Its first block
+	// is sized upfront from what the build is about to reserve, it only takes more blocks from the heap when the estimate falls short.
+	// The containers never give anything back, the whole arena is released at once when destroyed.
+	class Arena final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(Arena)
+
+		explicit Arena(const size_t initialSize) :
+			arena_(initialSize, &upstream_)
+		{
+		}
+
+		~Arena() = default;
+
+		std::pmr::memory_resource* Resource() { return &arena_; }
+
+		// What the arena took from the heap so far.
+		size_t Size() const { return upstream_.Size; }
+		size_t BlockCount() const { return upstream_.BlockCount; }
+
+	private:
+
+		class Upstream final : public std::pmr::memory_resource
+		{
+		public:
+
+			size_t Size{};
+			size_t BlockCount{};
+
+		private:
+
+			void* do_allocate(const size_t bytes, const size_t alignment) override
+			{
+				void* const block = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+				Size += bytes;
+				BlockCount++;
+				return block;
+			}
+
+			void do_deallocate(void* const block, const size_t bytes, const size_t alignment) override
+			{
+				std::pmr::new_delete_resource()->deallocate(block, bytes, alignment);
+			}
+
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+			{
+				return this == &other;
+			}
+		};
+
+		Upstream upstream_;
+		std::pmr::monotonic_buffer_resource arena_;
+	};
+
+	// The peak resident set size of the process so far in bytes, zero where unknown.
+	size_t PeakResidentSetSize();
+}
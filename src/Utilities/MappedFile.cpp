@@ -0,0 +1,92 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Utilities {
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef _WIN32
+	file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file_ == INVALID_HANDLE_VALUE)
+	{
+		file_ = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER size = {};
+
+	if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+	{
+		return;
+	}
+
+	mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mapping_ == nullptr)
+	{
+		return;
+	}
+
+	data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+	size_ = data_ != nullptr ? static_cast<size_t>(size.QuadPart) : 0;
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+
+	if (file < 0)
+	{
+		return;
+	}
+
+	struct stat status = {};
+
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		void* const data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (data != MAP_FAILED)
+		{
+			data_ = static_cast<const uint8_t*>(data);
+			size_ = static_cast<size_t>(status.st_size);
+		}
+	}
+
+	// The mapping stays valid once the descriptor is closed.
+	close(file);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data_ != nullptr)
+	{
+		UnmapViewOfFile(data_);
+	}
+
+	if (mapping_ != nullptr)
+	{
+		CloseHandle(mapping_);
+	}
+
+	if (file_ != nullptr)
+	{
+		CloseHandle(file_);
+	}
+#else
+	if (data_ != nullptr)
+	{
+		munmap(const_cast<uint8_t*>(data_), size_);
+	}
+#endif
+}
+
+}
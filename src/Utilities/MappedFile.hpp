@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Utilities
+{
+	// Read-only memory mapping of a whole file, empty when the file cannot be opened.
+	class MappedFile final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(MappedFile)
+
+		explicit MappedFile(const std::string& path);
+		~MappedFile();
+
+		bool IsMapped() const { return data_ != nullptr; }
+		const uint8_t* Data() const { return data_; }
+		size_t Size() const { return size_; }
+
+	private:
+
+		const uint8_t* data_{};
+		size_t size_{};
+
+#ifdef _WIN32
+		void* file_{};
+		void* mapping_{};
+#endif
+	};
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Utilities
+{
+	// Runs function(i) for every i in [0, count) over the hardware threads, rethrowing the first exception once they are all done.
+	// The assets already load on the task system, whose workers would deadlock waiting for nested tasks, hence the threads of its own.
+	template <class Function>
+	void ParallelFor(const size_t count, const Function& function)
+	{
+		const size_t threadCount = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+
+		if (threadCount <= 1)
+		{
+			for (size_t i = 0; i != count; ++i)
+			{
+				function(i);
+			}
+
+			return;
+		}
+
+		std::atomic<size_t> next{};
+		std::mutex mutex;
+		std::exception_ptr error;
+		std::vector<std::thread> threads;
+
+		for (size_t t = 0; t != threadCount; ++t)
+		{
+			threads.emplace_back([&]()
+			{
+				try
+				{
+					for (size_t i = next++; i < count; i = next++)
+					{
+						function(i);
+					}
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					error = error ? error : std::current_exception();
+					next = count;
+				}
+			});
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	// Runs function(begin, end) over the ranges of at most rangeSize elements covering [0, count).
+	template <class Function>
+	void ParallelForRanges(const size_t count, const size_t rangeSize, const Function& function)
+	{
+		ParallelFor((count + rangeSize - 1) / rangeSize, [&](const size_t range)
+		{
+			function(range * rangeSize, std::min(count, (range + 1) * rangeSize));
+		});
+	}
+}
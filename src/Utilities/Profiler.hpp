@@ -0,0 +1,24 @@
+#pragma once
+
+// The optional Tracy instrumentation (see the TRACY CMake option), every macro compiles to nothing without it.
+// PROFILE_ZONE() names its enclosing scope on the calling thread, PROFILE_FRAME() ends a frame. PROFILE_GPU_ZONE() times the
+// commands recorded in its enclosing scope, its profiler being the Vulkan::GpuProfiler of the application whose
+// PROFILE_GPU_COLLECT() reads the results back, once per frame and outside of any render pass.
+#ifdef RAYTRACER_TRACY
+
+#include <tracy/Tracy.hpp>
+#include <tracy/TracyVulkan.hpp>
+
+#define PROFILE_ZONE(name) ZoneScopedN(name)
+#define PROFILE_FRAME() FrameMark
+#define PROFILE_GPU_ZONE(profiler, commandBuffer, name) TracyVkZone((profiler).Context(), commandBuffer, name)
+#define PROFILE_GPU_COLLECT(profiler, commandBuffer) TracyVkCollect((profiler).Context(), commandBuffer)
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_FRAME()
+#define PROFILE_GPU_ZONE(profiler, commandBuffer, name)
+#define PROFILE_GPU_COLLECT(profiler, commandBuffer)
+
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace Utilities
+{
+	// A fixed size history of the last Capacity values, the oldest one being overwritten once full. Lock-free for a single producer:
+	// a value is only published once written, so a reader on another thread sees complete values as long as it only looks at the
+	// ones the producer will not overwrite while it reads them. Nothing is allocated after construction.
+	template <class T, size_t Capacity>
+	class RingBuffer final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(RingBuffer)
+
+		RingBuffer() = default;
+		~RingBuffer() = default;
+
+		void Push(const T& value)
+		{
+			const size_t count = count_.load(std::memory_order_relaxed);
+			values_[count % Capacity] = value;
+			count_.store(count + 1, std::memory_order_release);
+		}
+
+		size_t Size() const
+		{
+			const size_t count = count_.load(std::memory_order_acquire);
+			return count < Capacity ? count : Capacity;
+		}
+
+		// From the oldest (0) to the latest (Size() - 1) value.
+		const T& operator [] (const size_t index) const
+		{
+			const size_t count = count_.load(std::memory_order_acquire);
+			const size_t first = count < Capacity ? 0 : count - Capacity;
+			return values_[(first + index) % Capacity];
+		}
+
+		static constexpr size_t MaxSize() { return Capacity; }
+
+	private:
+
+		std::array<T, Capacity> values_{};
+		std::atomic<size_t> count_{};
+	};
+}
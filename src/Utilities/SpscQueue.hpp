@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace Utilities
+{
+	// A fixed size first in first out queue, lock-free for a single producer and a single consumer thread. A value is only published
+	// once written, and its slot only reused once read. Push() fails rather than blocks when Capacity values are waiting. Nothing is
+	// allocated after construction.
+	template <class T, size_t Capacity>
+	class SpscQueue final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(SpscQueue)
+
+		SpscQueue() = default;
+		~SpscQueue() = default;
+
+		// From the producer thread only.
+		bool Push(const T& value)
+		{
+			const size_t tail = tail_.load(std::memory_order_relaxed);
+
+			if (tail - head_.load(std::memory_order_acquire) == Capacity)
+			{
+				return false;
+			}
+
+			values_[tail % Capacity] = value;
+			tail_.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// From the consumer thread only.
+		bool Pop(T& value)
+		{
+			const size_t head = head_.load(std::memory_order_relaxed);
+
+			if (head == tail_.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			value = values_[head % Capacity];
+			head_.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// From either thread, only exact from the consumer one.
+		bool Empty() const
+		{
+			return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+		}
+
+	private:
+
+		std::array<T, Capacity> values_{};
+
+		// On cache lines of their own, each thread only writes one of them.
+		alignas(64) std::atomic<size_t> head_{};
+		alignas(64) std::atomic<size_t> tail_{};
+	};
+}
@@ -6,7 +6,7 @@
 #define STBI_NO_PSD
 #define STBI_NO_TGA
 #define STBI_NO_GIF
-#define STBI_NO_HDR
 #define STBI_NO_PIC
 #define STBI_NO_PNM
 #include <stb_image.h>
+#include <stb_image_write.h>
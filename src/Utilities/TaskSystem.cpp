@@ -0,0 +1,64 @@
+#include "TaskSystem.hpp"
+
+namespace Utilities {
+
+TaskSystem::TaskSystem(const uint32_t threadCount)
+{
+	threads_.reserve(threadCount);
+
+	for (uint32_t i = 0; i != threadCount; ++i)
+	{
+		threads_.emplace_back(&TaskSystem::Work, this);
+	}
+}
+
+TaskSystem::~TaskSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isStopping_ = true;
+	}
+
+	condition_.notify_all();
+
+	for (auto& thread : threads_)
+	{
+		thread.join();
+	}
+}
+
+void TaskSystem::Enqueue(std::function<void ()>&& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		tasks_.push_back(std::move(task));
+	}
+
+	condition_.notify_one();
+}
+
+void TaskSystem::Work()
+{
+	for (;;)
+	{
+		std::function<void ()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [this]() { return isStopping_ || !tasks_.empty(); });
+
+			// Drain the queue before stopping, pending futures are still waited upon.
+			if (tasks_.empty())
+			{
+				return;
+			}
+
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+		}
+
+		task();
+	}
+}
+
+}
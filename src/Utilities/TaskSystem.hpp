@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Utilities
+{
+	// Fixed pool of worker threads running independent tasks, e.g. decoding the assets of a scene.
+	class TaskSystem final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(TaskSystem)
+
+		explicit TaskSystem(uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency()));
+		~TaskSystem();
+
+		// The future rethrows any exception thrown by the task.
+		template <class Function>
+		auto Run(Function&& function) -> std::future<std::invoke_result_t<Function>>
+		{
+			using Result = std::invoke_result_t<Function>;
+
+			// The run time is added before the result is set, a thread waiting on the future always sees it.
+			auto task = std::make_shared<std::packaged_task<Result ()>>([this, function = std::forward<Function>(function)]() mutable -> Result
+			{
+				const BusyTimer timer(busyTime_);
+				return function();
+			});
+			auto future = task->get_future();
+
+			Enqueue([task]() { (*task)(); });
+
+			return future;
+		}
+
+		uint32_t ThreadCount() const { return static_cast<uint32_t>(threads_.size()); }
+
+		// Summed run time of all the completed tasks, in seconds.
+		double BusyTime() const { return static_cast<double>(busyTime_.load()) * 1e-9; }
+
+	private:
+
+		// Adds the time until its destruction to the busy time.
+		class BusyTimer final
+		{
+		public:
+
+			VULKAN_NON_COPIABLE(BusyTimer)
+
+			explicit BusyTimer(std::atomic<int64_t>& busyTime) : busyTime_(busyTime), start_(std::chrono::high_resolution_clock::now()) {}
+			~BusyTimer() { busyTime_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start_).count(); }
+
+		private:
+
+			std::atomic<int64_t>& busyTime_;
+			const std::chrono::high_resolution_clock::time_point start_;
+		};
+
+		void Enqueue(std::function<void ()>&& task);
+		void Work();
+
+		std::mutex mutex_;
+		std::condition_variable condition_;
+		std::deque<std::function<void ()>> tasks_;
+		std::vector<std::thread> threads_;
+		std::atomic<int64_t> busyTime_{}; // Nanoseconds
+		bool isStopping_{};
+	};
+}
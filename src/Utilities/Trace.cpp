@@ -0,0 +1,97 @@
+#include "Trace.hpp"
+#include "Exception.hpp"
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace Utilities
+{
+	namespace
+	{
+		struct Event final
+		{
+			const char* Name;
+			double Begin; // microseconds
+			double Duration; // microseconds, negative for an instant
+			uint32_t Thread;
+		};
+
+		// Long runs tracing every frame stop recording there, a few tens of megabytes of JSON.
+		constexpr size_t MaxEventCount = 1000000;
+
+		const Trace::Clock::time_point Epoch = Trace::Clock::now();
+
+		std::mutex EventMutex;
+		std::vector<Event> Events;
+		std::atomic<uint32_t> ThreadCount{};
+
+		uint32_t ThreadIndex()
+		{
+			thread_local const uint32_t index = ThreadCount++;
+			return index;
+		}
+
+		double Microseconds(const Trace::Clock::duration duration)
+		{
+			return std::chrono::duration<double, std::micro>(duration).count();
+		}
+
+		void Add(const Event& event)
+		{
+			std::lock_guard<std::mutex> lock(EventMutex);
+
+			if (Events.size() < MaxEventCount)
+			{
+				Events.push_back(event);
+			}
+		}
+	}
+
+	void Trace::AddScope(const char* const name, const Clock::time_point begin, const Clock::time_point end)
+	{
+		if (IsEnabled())
+		{
+			Add(Event{ name, Microseconds(begin - Epoch), Microseconds(end - begin), ThreadIndex() });
+		}
+	}
+
+	void Trace::AddInstant(const char* const name)
+	{
+		if (IsEnabled())
+		{
+			Add(Event{ name, Microseconds(Clock::now() - Epoch), -1, ThreadIndex() });
+		}
+	}
+
+	double Trace::Elapsed()
+	{
+		return Microseconds(Clock::now() - Epoch) / 1000;
+	}
+
+	void Trace::Write(const std::string& path)
+	{
+		std::ofstream file(path, std::ios::trunc);
+
+		if (!file)
+		{
+			Throw(std::runtime_error("failed to open trace output '" + path + "'"));
+		}
+
+		std::lock_guard<std::mutex> lock(EventMutex);
+
+		file << std::fixed;
+		file.precision(3);
+		file << "{\"traceEvents\":[";
+
+		for (size_t i = 0; i != Events.size(); ++i)
+		{
+			const auto& event = Events[i];
+
+			file << (i == 0 ? "\n" : ",\n");
+			file << "{\"name\":\"" << event.Name << "\",\"pid\":1,\"tid\":" << event.Thread << ",\"ts\":" << event.Begin;
+			file << (event.Duration < 0 ? std::string(",\"ph\":\"i\",\"s\":\"g\"") : ",\"ph\":\"X\",\"dur\":" + std::to_string(event.Duration)) << "}";
+		}
+
+		file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace Utilities
+{
+	// Records timed scopes from any thread and writes them as a Chrome trace (chrome://tracing, Perfetto), see --trace.
+	// The timestamps start with the process. Nothing is recorded until Enable() is called, a disabled scope only costs an atomic load.
+	class Trace final
+	{
+	public:
+
+		using Clock = std::chrono::steady_clock;
+
+		static void Enable() { isEnabled_.store(true, std::memory_order_relaxed); }
+		static bool IsEnabled() { return isEnabled_.load(std::memory_order_relaxed); }
+
+		// The names must outlive the trace, e.g. string literals. Both do nothing unless enabled.
+		static void AddScope(const char* name, Clock::time_point begin, Clock::time_point end);
+		static void AddInstant(const char* name);
+
+		// Milliseconds since the process started.
+		static double Elapsed();
+
+		static void Write(const std::string& path);
+
+	private:
+
+		static inline std::atomic<bool> isEnabled_{};
+	};
+
+	class TraceScope final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(TraceScope)
+
+		explicit TraceScope(const char* const name) :
+			name_(Trace::IsEnabled() ? name : nullptr),
+			begin_(name_ != nullptr ? Trace::Clock::now() : Trace::Clock::time_point())
+		{
+		}
+
+		~TraceScope()
+		{
+			if (name_ != nullptr)
+			{
+				Trace::AddScope(name_, begin_, Trace::Clock::now());
+			}
+		}
+
+	private:
+
+		const char* const name_;
+		const Trace::Clock::time_point begin_;
+	};
+}
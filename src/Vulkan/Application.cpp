@@ -2,44 +2,83 @@
 #include "Buffer.hpp"
 #include "CommandPool.hpp"
 #include "CommandBuffers.hpp"
+#include "CullingPipeline.hpp"
 #include "DebugUtilsMessenger.hpp"
 #include "DepthBuffer.hpp"
 #include "Device.hpp"
-#include "Fence.hpp"
+#include "DynamicRendering.hpp"
+#include "Enumerate.hpp"
 #include "FrameBuffer.hpp"
+#include "GpuProfiler.hpp"
 #include "GraphicsPipeline.hpp"
 #include "Instance.hpp"
+#include "PipelineCache.hpp"
 #include "PipelineLayout.hpp"
 #include "RenderPass.hpp"
 #include "Semaphore.hpp"
+#include "StagingRing.hpp"
 #include "Surface.hpp"
 #include "SwapChain.hpp"
+#include "TimelineSemaphore.hpp"
 #include "Window.hpp"
-#include "Assets/Model.hpp"
 #include "Assets/Scene.hpp"
 #include "Assets/UniformBuffer.hpp"
 #include "Utilities/Exception.hpp"
+#include "Utilities/Profiler.hpp"
+#include "Utilities/Trace.hpp"
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
 
 namespace Vulkan {
 
+namespace
+{
+	// Large enough for most scene buffers and textures to be staged without an intermediate flush.
+	constexpr VkDeviceSize StagingRingSize = 64 * 1024 * 1024;
+
+	const char* const PipelineCacheDirectory = "../cache/pipelines";
+
+	// The low latency wait gives up on a present that takes longer than this (e.g. a hidden window), in nanoseconds.
+	constexpr uint64_t PresentWaitTimeout = 100 * 1000 * 1000;
+}
+
 Application::Application(const WindowConfig& windowConfig, const VkPresentModeKHR presentMode, const bool enableValidationLayers) :
-	presentMode_(presentMode)
+	presentMode_(presentMode),
+	headlessExtent_{ windowConfig.Width, windowConfig.Height },
+	startTime_(std::chrono::steady_clock::now())
 {
 	const auto validationLayers = enableValidationLayers
 		? std::vector<const char*>{"VK_LAYER_KHRONOS_validation"}
 		: std::vector<const char*>();
 
-	window_.reset(new class Window(windowConfig));
-	instance_.reset(new Instance(*window_, validationLayers, VK_API_VERSION_1_2));
+	const Utilities::TraceScope trace("CreateInstance");
+	PROFILE_ZONE("CreateInstance");
+
+	window_.reset(windowConfig.Headless ? nullptr : new class Window(windowConfig));
+	instance_.reset(new Instance(window_.get(), validationLayers, VK_API_VERSION_1_2));
 	debugUtilsMessenger_.reset(enableValidationLayers ? new DebugUtilsMessenger(*instance_, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT) : nullptr);
-	surface_.reset(new Surface(*instance_));
+	surface_.reset(window_ ? new Surface(*instance_) : nullptr);
 }
 
 Application::~Application()
 {
 	Application::DeleteSwapChain();
 
+	if (pipelineCache_)
+	{
+		pipelineCache_->Save();
+	}
+
+	pipelineCache_.reset();
+	gpuProfiler_.reset();
+	uniformBuffers_.clear();
+	frameTimeline_.reset();
+	dynamicRendering_.reset();
+	stagingRing_.reset();
+	transferCommandPool_.reset();
 	commandPool_.reset();
 	device_.reset();
 	surface_.reset();
@@ -70,13 +109,18 @@ void Application::SetPhysicalDevice(VkPhysicalDevice physicalDevice)
 		Throw(std::logic_error("physical device has already been set"));
 	}
 
-	std::vector<const char*> requiredExtensions = 
+	std::vector<const char*> requiredExtensions;
+
+	if (!IsHeadless())
 	{
 		// VK_KHR_swapchain
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME
-	};
+		requiredExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
 
+	// The rasterizer draws all the instances with one indirect call per index width, the draws carrying their instance index.
 	VkPhysicalDeviceFeatures deviceFeatures = {};
+	deviceFeatures.multiDrawIndirect = true;
+	deviceFeatures.drawIndirectFirstInstance = true;
 	
 	SetPhysicalDevice(physicalDevice, requiredExtensions, deviceFeatures, nullptr);
 	OnDeviceSet();
@@ -94,11 +138,28 @@ void Application::Run()
 
 	currentFrame_ = 0;
 
-	window_->DrawFrame = [this]() { DrawFrame(); };
+	// Without a window there are no events to poll, draw until the application asks to close.
+	if (IsHeadless())
+	{
+		while (!isClosing_)
+		{
+			const Utilities::TraceScope trace("Frame");
+			PROFILE_ZONE("DrawFrame");
+			DrawFrame();
+			PROFILE_FRAME();
+		}
+
+		device_->WaitIdle();
+		return;
+	}
+
+	window_->DrawFrame = [this]() { const Utilities::TraceScope trace("Frame"); PROFILE_ZONE("DrawFrame"); DrawFrame(); PROFILE_FRAME(); };
+	window_->IsIdle = [this]() { return IsIdle(); };
 	window_->OnKey = [this](const int key, const int scancode, const int action, const int mods) { OnKey(key, scancode, action, mods); };
 	window_->OnCursorPosition = [this](const double xpos, const double ypos) { OnCursorPosition(xpos, ypos); };
 	window_->OnMouseButton = [this](const int button, const int action, const int mods) { OnMouseButton(button, action, mods); };
 	window_->OnScroll = [this](const double xoffset, const double yoffset) { OnScroll(xoffset, yoffset); };
+	window_->OnInputEvent = [this](const Window::InputEvent& event) { OnInputEvent(event); };
 	window_->Run();
 	device_->WaitIdle();
 }
@@ -109,8 +170,97 @@ void Application::SetPhysicalDevice(
 	VkPhysicalDeviceFeatures& deviceFeatures,
 	void* nextDeviceFeatures)
 {
-	device_.reset(new class Device(physicalDevice, *surface_, requiredExtensions, deviceFeatures, nextDeviceFeatures));
+	// The frames in flight are paced with a timeline semaphore, see FrameTimeline().
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = {};
+	timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	timelineSemaphoreFeatures.pNext = nextDeviceFeatures;
+	timelineSemaphoreFeatures.timelineSemaphore = true;
+
+	// The draw parameters of the vertex shader.
+	VkPhysicalDeviceShaderDrawParametersFeatures drawParametersFeatures = {};
+	drawParametersFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES;
+	drawParametersFeatures.pNext = &timelineSemaphoreFeatures;
+	drawParametersFeatures.shaderDrawParameters = true;
+
+	void* features = &drawParametersFeatures;
+
+	// The low latency mode waits on the presents themselves when the device can tell when they are done.
+	const auto extensions = GetEnumerateVector(physicalDevice, static_cast<const char*>(nullptr), vkEnumerateDeviceExtensionProperties);
+	const auto hasExtension = [&extensions](const char* const name)
+	{
+		return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& extension)
+		{
+			return strcmp(extension.extensionName, name) == 0;
+		});
+	};
+
+	const bool supportsPresentWait = lowLatency_ && !IsHeadless() &&
+		hasExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+		hasExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+	presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	presentIdFeatures.pNext = features;
+	presentIdFeatures.presentId = true;
+
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+	presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	presentWaitFeatures.pNext = &presentIdFeatures;
+	presentWaitFeatures.presentWait = true;
+
+	if (supportsPresentWait)
+	{
+		requiredExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		requiredExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		features = &presentWaitFeatures;
+	}
+
+	// The raster preview and the user interface draw straight into the swap chain images when they can, see DynamicRendering.
+	const bool supportsDynamicRendering = useDynamicRendering_ && !IsHeadless() &&
+		hasExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+	dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+	dynamicRenderingFeatures.pNext = features;
+	dynamicRenderingFeatures.dynamicRendering = true;
+
+	if (supportsDynamicRendering)
+	{
+		requiredExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		features = &dynamicRenderingFeatures;
+	}
+
+	// The memory heap budgets are shown in the statistics overlay and the benchmark report, see MemoryAllocator::GetHeapBudgets().
+	if (hasExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+	{
+		requiredExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
+	const Utilities::TraceScope trace("CreateDevice");
+	PROFILE_ZONE("CreateDevice");
+
+	device_.reset(new class Device(physicalDevice, *instance_, surface_.get(), requiredExtensions, deviceFeatures, features));
+
+	waitForPresent_ = supportsPresentWait
+		? reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device_->Handle(), "vkWaitForPresentKHR"))
+		: nullptr;
+	dynamicRendering_.reset(supportsDynamicRendering ? new class DynamicRendering(*device_) : nullptr);
 	commandPool_.reset(new class CommandPool(*device_, device_->GraphicsFamilyIndex(), true));
+	transferCommandPool_.reset(new class CommandPool(*device_, device_->TransferFamilyIndex(), false));
+	stagingRing_.reset(new class StagingRing(*transferCommandPool_, *commandPool_, StagingRingSize));
+	pipelineCache_.reset(new class PipelineCache(*device_, PipelineCacheDirectory));
+	gpuProfiler_.reset(new class GpuProfiler(*device_, *commandPool_));
+
+	// The timeline outlives the swap chain, its values keep growing across recreations.
+	frameTimeline_.reset(new TimelineSemaphore(*device_, 0));
+	frameSlotValues_.assign(maxFramesInFlight_, 0);
+	frameValue_ = 0;
+
+	// Uniform buffers don't depend on the swap chain, keep them (and the descriptors using them) across recreations.
+	for (size_t i = 0; i != maxFramesInFlight_; ++i)
+	{
+		uniformBuffers_.emplace_back(*device_);
+	}
 }
 
 void Application::OnDeviceSet()
@@ -119,6 +269,17 @@ void Application::OnDeviceSet()
 
 void Application::CreateSwapChain()
 {
+	const Utilities::TraceScope trace("CreateSwapChain");
+	PROFILE_ZONE("CreateSwapChain");
+
+	// Headless rendering only needs the per-frame command buffers.
+	if (IsHeadless())
+	{
+		currentFrame_ = 0;
+		commandBuffers_.reset(new CommandBuffers(*commandPool_, maxFramesInFlight_));
+		return;
+	}
+
 	// Wait until the window is visible.
 	while (window_->IsMinimized())
 	{
@@ -126,33 +287,45 @@ void Application::CreateSwapChain()
 	}
 
 	swapChain_.reset(new class SwapChain(*device_, presentMode_));
+	swapChainFirstPresentId_ = presentId_ + 1;
 	depthBuffer_.reset(new class DepthBuffer(*commandPool_, swapChain_->Extent()));
 
+	// The presentation engine holds on to the render finished semaphore, so keep one per image.
 	for (size_t i = 0; i != swapChain_->ImageViews().size(); ++i)
 	{
-		imageAvailableSemaphores_.emplace_back(*device_);
 		renderFinishedSemaphores_.emplace_back(*device_);
-		inFlightFences_.emplace_back(*device_, true);
-		uniformBuffers_.emplace_back(*device_);
 	}
 
-	graphicsPipeline_.reset(new class GraphicsPipeline(*swapChain_, *depthBuffer_, uniformBuffers_, GetScene(), isWireFrame_));
+	// Everything else is only needed once per frame in flight, independently of the image count.
+	for (size_t i = 0; i != maxFramesInFlight_; ++i)
+	{
+		imageAvailableSemaphores_.emplace_back(*device_);
+	}
+
+	currentFrame_ = 0;
 
-	for (const auto& imageView : swapChain_->ImageViews())
+	// The user interface draws into the same framebuffers whether rasterizing or not, the graphics pipelines are created on first use.
+	// Dynamic rendering needs neither, it draws into the swap chain image views themselves.
+	if (!dynamicRendering_)
 	{
-		swapChainFramebuffers_.emplace_back(*imageView, graphicsPipeline_->RenderPass());
+		renderPass_.reset(new class RenderPass(*swapChain_, *depthBuffer_, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_LOAD_OP_CLEAR));
+
+		for (const auto& imageView : swapChain_->ImageViews())
+		{
+			swapChainFramebuffers_.emplace_back(*imageView, *renderPass_);
+		}
 	}
 
-	commandBuffers_.reset(new CommandBuffers(*commandPool_, static_cast<uint32_t>(swapChainFramebuffers_.size())));
+	commandBuffers_.reset(new CommandBuffers(*commandPool_, maxFramesInFlight_));
 }
 
 void Application::DeleteSwapChain()
 {
 	commandBuffers_.reset();
 	swapChainFramebuffers_.clear();
+	renderPass_.reset();
+	cullingPipeline_.reset();
 	graphicsPipeline_.reset();
-	uniformBuffers_.clear();
-	inFlightFences_.clear();
 	renderFinishedSemaphores_.clear();
 	imageAvailableSemaphores_.clear();
 	depthBuffer_.reset();
@@ -161,18 +334,34 @@ void Application::DeleteSwapChain()
 
 void Application::DrawFrame()
 {
+	if (IsHeadless())
+	{
+		DrawHeadlessFrame();
+		return;
+	}
+
 	const auto noTimeout = std::numeric_limits<uint64_t>::max();
 
-	auto& inFlightFence = inFlightFences_[currentFrame_];
 	const auto imageAvailableSemaphore = imageAvailableSemaphores_[currentFrame_].Handle();
-	const auto renderFinishedSemaphore = renderFinishedSemaphores_[currentFrame_].Handle();
 
-	inFlightFence.Wait(noTimeout);
+	WaitForFrameSlot();
+	ReleaseUnusedGraphicsPipelines();
+
+	const auto presentWaitStart = std::chrono::steady_clock::now();
+
+	if (lowLatency_)
+	{
+		WaitForLowLatency();
+	}
+
+	const auto inputTime = std::chrono::steady_clock::now();
 
 	uint32_t imageIndex;
 	auto result = vkAcquireNextImageKHR(device_->Handle(), swapChain_->Handle(), noTimeout, imageAvailableSemaphore, nullptr, &imageIndex);
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || isWireFrame_ != graphicsPipeline_->IsWireFrame())
+	presentWaitTime_ = queuePresentTime_ + std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - presentWaitStart).count();
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || (graphicsPipeline_ && isWireFrame_ != graphicsPipeline_->IsWireFrame()))
 	{
 		RecreateSwapChain();
 		return;
@@ -183,36 +372,33 @@ void Application::DrawFrame()
 		Throw(std::runtime_error(std::string("failed to acquire next image (") + ToString(result) + ")"));
 	}
 
-	const auto commandBuffer = commandBuffers_->Begin(imageIndex);
-	Render(commandBuffer, imageIndex);
-	commandBuffers_->End(imageIndex);
+	const auto renderFinishedSemaphore = renderFinishedSemaphores_[imageIndex].Handle();
 
-	UpdateUniformBuffer(imageIndex);
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-	VkCommandBuffer commandBuffers[]{ commandBuffer };
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
+	const auto commandBuffer = commandBuffers_->Begin(currentFrame_);
+	{
+		const Utilities::TraceScope trace("Render");
+		PROFILE_ZONE("Render");
+		PROFILE_GPU_COLLECT(*gpuProfiler_, commandBuffer);
+		Render(commandBuffer, imageIndex);
+	}
+	commandBuffers_->End(currentFrame_);
 
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = commandBuffers;
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	UpdateUniformBuffer(currentFrame_);
+	SubmitFrame(commandBuffer, { imageAvailableSemaphore }, { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT }, renderFinishedSemaphore);
 
-	inFlightFence.Reset();
+	// The present ids let the low latency mode wait on a given present.
+	const uint64_t presentIds[] = { presentId_ + 1 };
 
-	Check(vkQueueSubmit(device_->GraphicsQueue(), 1, &submitInfo, inFlightFence.Handle()),
-		"submit draw command buffer");
+	VkPresentIdKHR presentIdInfo = {};
+	presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+	presentIdInfo.swapchainCount = 1;
+	presentIdInfo.pPresentIds = presentIds;
 
+	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
 	VkSwapchainKHR swapChains[] = { swapChain_->Handle() };
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.pNext = waitForPresent_ != nullptr ? &presentIdInfo : nullptr;
 	presentInfo.waitSemaphoreCount = 1;
 	presentInfo.pWaitSemaphores = signalSemaphores;
 	presentInfo.swapchainCount = 1;
@@ -220,7 +406,12 @@ void Application::DrawFrame()
 	presentInfo.pImageIndices = &imageIndex;
 	presentInfo.pResults = nullptr; // Optional
 
+	const auto presentStart = std::chrono::steady_clock::now();
 	result = vkQueuePresentKHR(device_->PresentQueue(), &presentInfo);
+	queuePresentTime_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - presentStart).count();
+
+	presentId_++;
+	inputTimes_[presentId_ % 2] = inputTime;
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
 	{
@@ -233,58 +424,149 @@ void Application::DrawFrame()
 		Throw(std::runtime_error(std::string("failed to present next image (") + ToString(result) + ")"));
 	}
 
-	currentFrame_ = (currentFrame_ + 1) % inFlightFences_.size();
+	TraceFirstFrame();
+
+	currentFrame_ = (currentFrame_ + 1) % frameSlotValues_.size();
 }
 
 void Application::Render(VkCommandBuffer commandBuffer, const uint32_t imageIndex)
 {
-	std::array<VkClearValue, 2> clearValues = {};
-	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-	clearValues[1].depthStencil = { 1.0f, 0 };
+	if (!graphicsPipeline_)
+	{
+		CreateGraphicsPipelines();
+	}
+
+	graphicsPresentId_ = presentId_ + 1;
+	graphicsTime_ = Time();
+
+	VkRect2D renderArea = {};
+	renderArea.offset = { 0, 0 };
+	renderArea.extent = swapChain_->Extent();
 
-	VkRenderPassBeginInfo renderPassInfo = {};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = graphicsPipeline_->RenderPass().Handle();
-	renderPassInfo.framebuffer = swapChainFramebuffers_[imageIndex].Handle();
-	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = swapChain_->Extent();
-	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassInfo.pClearValues = clearValues.data();
+	// The instances outside of the view frustum are culled on the GPU, before the render pass.
+	cullingPipeline_->Dispatch(commandBuffer, static_cast<uint32_t>(currentFrame_));
+
+	const VkImage image = swapChain_->Images()[imageIndex];
+
+	if (dynamicRendering_)
+	{
+		dynamicRendering_->Begin(commandBuffer, image, swapChain_->ImageViews()[imageIndex]->Handle(), depthBuffer_.get(), renderArea, VK_ATTACHMENT_LOAD_OP_CLEAR);
+	}
+	else
+	{
+		std::array<VkClearValue, 2> clearValues = {};
+		clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = graphicsPipeline_->RenderPass().Handle();
+		renderPassInfo.framebuffer = swapChainFramebuffers_[imageIndex].Handle();
+		renderPassInfo.renderArea = renderArea;
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 	{
 		const auto& scene = GetScene();
 
-		VkDescriptorSet descriptorSets[] = { graphicsPipeline_->DescriptorSet(imageIndex) };
-		VkBuffer vertexBuffers[] = { scene.VertexBuffer().Handle() };
+		graphicsPipeline_->UpdateTextures(static_cast<uint32_t>(currentFrame_), scene);
+
+		VkDescriptorSet descriptorSets[] = { graphicsPipeline_->DescriptorSet(static_cast<uint32_t>(currentFrame_)) };
 		const VkBuffer indexBuffer = scene.IndexBuffer().Handle();
-		VkDeviceSize offsets[] = { 0 };
 
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline_->Handle());
 		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline_->PipelineLayout().Handle(), 0, 1, descriptorSets, 0, nullptr);
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-		uint32_t vertexOffset = 0;
-		uint32_t indexOffset = 0;
+		// One draw per instance, those with 16-bit indices first. The first instance of the draw is used by the vertex shader
+		// to fetch the instance transform and its model vertices, the model indices are then used as is.
+		const auto& drawCommands = cullingPipeline_->DrawCommandBuffer(static_cast<uint32_t>(currentFrame_));
+		const uint32_t shortDrawCount = scene.ShortIndexDrawCount();
+		const uint32_t longDrawCount = cullingPipeline_->DrawCount() - shortDrawCount;
 
-		for (const auto& model : scene.Models())
+		if (shortDrawCount != 0)
 		{
-			const auto vertexCount = static_cast<uint32_t>(model.NumberOfVertices());
-			const auto indexCount = static_cast<uint32_t>(model.NumberOfIndices());
-
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, indexOffset, vertexOffset, 0);
+			vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+			vkCmdDrawIndexedIndirect(commandBuffer, drawCommands.Handle(), 0, shortDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
 
-			vertexOffset += vertexCount;
-			indexOffset += indexCount;
+		if (longDrawCount != 0)
+		{
+			vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdDrawIndexedIndirect(commandBuffer, drawCommands.Handle(), shortDrawCount * sizeof(VkDrawIndexedIndirectCommand), longDrawCount, sizeof(VkDrawIndexedIndirectCommand));
 		}
 	}
-	vkCmdEndRenderPass(commandBuffer);
+
+	if (dynamicRendering_)
+	{
+		dynamicRendering_->End(commandBuffer, image);
+	}
+	else
+	{
+		vkCmdEndRenderPass(commandBuffer);
+	}
+}
+
+void Application::CreateGraphicsPipelines()
+{
+	const auto pipelineStart = std::chrono::high_resolution_clock::now();
+	{
+		const Utilities::TraceScope pipelineTrace("CreateGraphicsPipeline");
+		PROFILE_ZONE("CreateGraphicsPipeline");
+		graphicsPipeline_.reset(new class GraphicsPipeline(*swapChain_, *pipelineCache_, *depthBuffer_, uniformBuffers_, GetScene(), isWireFrame_, dynamicRendering_ != nullptr));
+	}
+
+	// Only the first creation is interesting, the cache is warm for any later one.
+	if (!isGraphicsPipelineReported_)
+	{
+		const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - pipelineStart).count();
+		std::cout << "- created graphics pipeline in " << elapsed << "ms (" << (pipelineCache_->IsLoadedFromDisk() ? "warm" : "cold") << " pipeline cache)" << std::endl;
+		isGraphicsPipelineReported_ = true;
+	}
+
+	cullingPipeline_.reset(new class CullingPipeline(*device_, *pipelineCache_, uniformBuffers_, GetScene()));
+}
+
+void Application::ReleaseUnusedGraphicsPipelines()
+{
+	// Called once the current frame slot has been waited on, every frame slot has then been waited on since the last rasterized frame.
+	constexpr double releaseDelay = 30.0;
+
+	if (graphicsPipeline_ && presentId_ >= graphicsPresentId_ + maxFramesInFlight_ && Time() - graphicsTime_ > releaseDelay)
+	{
+		cullingPipeline_.reset();
+		graphicsPipeline_.reset();
+	}
+}
+
+VkExtent2D Application::Extent() const
+{
+	return swapChain_ ? swapChain_->Extent() : headlessExtent_;
+}
+
+double Application::Time() const
+{
+	return window_
+		? window_->GetTime()
+		: std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime_).count();
+}
+
+void Application::Close()
+{
+	if (window_)
+	{
+		window_->Close();
+	}
+
+	isClosing_ = true;
 }
 
-void Application::UpdateUniformBuffer(const uint32_t imageIndex)
+void Application::UpdateUniformBuffer(const size_t frameIndex)
 {
-	uniformBuffers_[imageIndex].SetValue(GetUniformBufferObject(swapChain_->Extent()));
+	PROFILE_ZONE("UpdateUniformBuffer");
+	uniformBuffers_[frameIndex].SetValue(GetUniformBufferObject(Extent()));
 }
 
 void Application::RecreateSwapChain()
@@ -294,4 +576,138 @@ void Application::RecreateSwapChain()
 	CreateSwapChain();
 }
 
+void Application::DrawHeadlessFrame()
+{
+	WaitForFrameSlot();
+
+	// There is no swap chain image to acquire or present, the frame only renders into the application images.
+	const auto commandBuffer = commandBuffers_->Begin(currentFrame_);
+	{
+		const Utilities::TraceScope trace("Render");
+		PROFILE_ZONE("Render");
+		PROFILE_GPU_COLLECT(*gpuProfiler_, commandBuffer);
+		Render(commandBuffer, 0);
+	}
+	commandBuffers_->End(currentFrame_);
+
+	UpdateUniformBuffer(currentFrame_);
+	SubmitFrame(commandBuffer, {}, {}, nullptr);
+	TraceFirstFrame();
+
+	currentFrame_ = (currentFrame_ + 1) % frameSlotValues_.size();
+}
+
+void Application::TraceFirstFrame()
+{
+	if (isFirstFrameTraced_ || !Utilities::Trace::IsEnabled())
+	{
+		return;
+	}
+
+	// The end of the startup, whatever the scene took to load.
+	Utilities::Trace::AddInstant("FirstFrame");
+	std::cout << "- first frame submitted " << Utilities::Trace::Elapsed() << "ms after startup" << std::endl;
+	isFirstFrameTraced_ = true;
+}
+
+void Application::WaitForFrameSlot()
+{
+	const Utilities::TraceScope trace("WaitForFrameSlot");
+	PROFILE_ZONE("WaitForFrameSlot");
+	const auto noTimeout = std::numeric_limits<uint64_t>::max();
+
+	// Only the submission that last used this frame slot has to be done, the later ones keep running.
+	frameTimeline_->Wait(frameSlotValues_[currentFrame_], noTimeout);
+}
+
+void Application::WaitForLowLatency()
+{
+	// Keep at most one present queued behind the one on screen, so that the input sampled next is displayed as soon as possible.
+	// Without present waits, wait for the GPU to be done with the previous frame instead.
+	const auto waitedId = waitForPresent_ != nullptr ? presentId_ - 1 : presentId_;
+
+	if (presentId_ == 0 || waitedId < swapChainFirstPresentId_)
+	{
+		return;
+	}
+
+	if (waitForPresent_ != nullptr)
+	{
+		const auto result = waitForPresent_(device_->Handle(), swapChain_->Handle(), waitedId, PresentWaitTimeout);
+
+		if (result == VK_TIMEOUT || result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		{
+			latency_ = -1;
+			return;
+		}
+
+		Check(result, "wait for present");
+	}
+	else
+	{
+		frameTimeline_->Wait(frameValue_, std::numeric_limits<uint64_t>::max());
+	}
+
+	latency_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inputTimes_[waitedId % 2]).count();
+
+	// Sample the input now rather than before the wait.
+	window_->PollEvents();
+}
+
+void Application::SubmitFrame(
+	VkCommandBuffer commandBuffer,
+	std::vector<VkSemaphore> waitSemaphores,
+	std::vector<VkPipelineStageFlags> waitStages,
+	const VkSemaphore renderFinishedSemaphore)
+{
+	std::vector<uint64_t> waitValues(waitSemaphores.size(), 0);
+
+	AddFrameWaitSemaphores(waitSemaphores, waitStages, waitValues);
+
+	// The uploads staged while recording the frame (e.g. a shader binding table) are submitted ahead of it rather than waited for.
+	if (stagingRing_->Submit())
+	{
+		waitSemaphores.push_back(stagingRing_->Timeline().Handle());
+		waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		waitValues.push_back(stagingRing_->SubmittedValue());
+	}
+
+	frameSlotValues_[currentFrame_] = ++frameValue_;
+
+	// The binary render finished semaphore ignores its value.
+	std::vector<VkSemaphore> signalSemaphores = { frameTimeline_->Handle() };
+	std::vector<uint64_t> signalValues = { frameValue_ };
+
+	if (renderFinishedSemaphore != nullptr)
+	{
+		signalSemaphores.push_back(renderFinishedSemaphore);
+		signalValues.push_back(0);
+	}
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+	VkCommandBuffer commandBuffers[]{ commandBuffer };
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = commandBuffers;
+	submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+	Check(vkQueueSubmit(device_->GraphicsQueue(), 1, &submitInfo, nullptr),
+		"submit draw command buffer");
+
+	OnFrameSubmitted(frameValue_);
+}
+
 }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "FrameBuffer.hpp"
+#include "Window.hpp"
 #include "WindowConfig.hpp"
+#include <chrono>
 #include <vector>
 #include <memory>
 
@@ -31,6 +33,8 @@ namespace Vulkan
 		const class Window& Window() const { return *window_; }
 
 		bool HasSwapChain() const { return swapChain_.operator bool(); }
+		bool IsHeadless() const { return !window_; }
+		uint32_t MaxFramesInFlight() const { return maxFramesInFlight_; }
 
 		void SetPhysicalDevice(VkPhysicalDevice physicalDevice);
 		void Run();
@@ -41,10 +45,41 @@ namespace Vulkan
 
 		const class Device& Device() const { return *device_; }
 		class CommandPool& CommandPool() { return *commandPool_; }
+		class StagingRing& StagingRing() { return *stagingRing_; }
+		const class PipelineCache& PipelineCache() const { return *pipelineCache_; }
+		const class GpuProfiler& GpuProfiler() const { return *gpuProfiler_; }
 		const class DepthBuffer& DepthBuffer() const { return *depthBuffer_; }
 		const std::vector<Assets::UniformBuffer>& UniformBuffers() const { return uniformBuffers_; }
-		const class GraphicsPipeline& GraphicsPipeline() const { return *graphicsPipeline_; }
 		const class FrameBuffer& SwapChainFrameBuffer(const size_t i) const { return swapChainFramebuffers_[i]; }
+
+		// Null when drawing through render passes, there are then swap chain framebuffers instead.
+		const class DynamicRendering* DynamicRendering() const { return dynamicRendering_.get(); }
+
+		// The rendered image size, the swap chain extent or the requested size when headless.
+		VkExtent2D Extent() const;
+
+		// Only taken into account when the swap chain is (re)created.
+		void SetHeadlessExtent(VkExtent2D extent) { headlessExtent_ = extent; }
+
+		// Window independent versions of the GLFW time and close calls, they also work headless.
+		double Time() const;
+		void Close();
+
+		// The frame in flight being recorded, per-frame resources (uniform buffers, descriptor sets) are indexed with it.
+		size_t CurrentFrame() const { return currentFrame_; }
+
+		// Every frame submission signals the next value of the frame timeline, the one being recorded signals FrameValue().
+		// The host waits for the value of a frame slot before reusing it, other work can wait on or poll any earlier frame.
+		const class TimelineSemaphore& FrameTimeline() const { return *frameTimeline_; }
+		uint64_t FrameValue() const { return frameValue_ + 1; }
+
+		// With low latency, the milliseconds from the input sampling of a frame to its presentation (or to the end of its rendering
+		// without VK_KHR_present_wait). Negative when not measured.
+		double Latency() const { return latency_; }
+
+		// The host milliseconds blocked on the presentation engine: queuing the previous present, then the low latency wait and
+		// the image acquisition of the frame being recorded.
+		double PresentWaitTime() const { return presentWaitTime_; }
 		
 		virtual const Assets::Scene& GetScene() const = 0;
 		virtual Assets::UniformBufferObject GetUniformBufferObject(VkExtent2D extent) const = 0;
@@ -61,19 +96,43 @@ namespace Vulkan
 		virtual void DrawFrame();
 		virtual void Render(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
+		// The window then waits for input rather than drawing frames that would not change anything.
+		virtual bool IsIdle() const { return false; }
+
+		// Extra semaphores the next draw submission has to wait on (e.g. asynchronous GPU work), with the value to wait for (ignored for binary semaphores).
+		virtual void AddFrameWaitSemaphores(std::vector<VkSemaphore>& semaphores, std::vector<VkPipelineStageFlags>& stages, std::vector<uint64_t>& values) { }
+
+		// Right after the draw submission signaling the given value of the frame timeline, e.g. to submit work depending on it to another queue.
+		virtual void OnFrameSubmitted(uint64_t frameValue) { }
+
 		virtual void OnKey(int key, int scancode, int action, int mods) { }
 		virtual void OnCursorPosition(double xpos, double ypos) { }
 		virtual void OnMouseButton(int button, int action, int mods) { }
 		virtual void OnScroll(double xoffset, double yoffset) { }
+		virtual void OnInputEvent(const Window::InputEvent& event) { }
 
 		bool isWireFrame_{};
+		uint32_t maxFramesInFlight_{2};
+		bool lowLatency_{}; // Read when setting the physical device, see WaitForLowLatency().
+		bool useDynamicRendering_{true}; // Read when setting the physical device, render passes are used without VK_KHR_dynamic_rendering.
 
 	private:
 
-		void UpdateUniformBuffer(uint32_t imageIndex);
+		void UpdateUniformBuffer(size_t frameIndex);
 		void RecreateSwapChain();
+		void CreateGraphicsPipelines();
+		void ReleaseUnusedGraphicsPipelines();
+		void DrawHeadlessFrame();
+		void TraceFirstFrame();
+		void WaitForFrameSlot();
+		void WaitForLowLatency();
+		void SubmitFrame(VkCommandBuffer commandBuffer, std::vector<VkSemaphore> waitSemaphores, std::vector<VkPipelineStageFlags> waitStages, VkSemaphore renderFinishedSemaphore);
 
 		const VkPresentModeKHR presentMode_;
+		VkExtent2D headlessExtent_;
+		const std::chrono::steady_clock::time_point startTime_;
+		bool isClosing_{};
+		bool isFirstFrameTraced_{};
 		
 		std::unique_ptr<class Window> window_;
 		std::unique_ptr<class Instance> instance_;
@@ -83,15 +142,35 @@ namespace Vulkan
 		std::unique_ptr<class SwapChain> swapChain_;
 		std::vector<Assets::UniformBuffer> uniformBuffers_;
 		std::unique_ptr<class DepthBuffer> depthBuffer_;
-		std::unique_ptr<class GraphicsPipeline> graphicsPipeline_;
+		std::unique_ptr<class RenderPass> renderPass_; // Of the swap chain framebuffers, compatible with the graphics and user interface ones.
+		std::unique_ptr<class GraphicsPipeline> graphicsPipeline_; // Only created once rasterizing (see CreateGraphicsPipelines()).
+		std::unique_ptr<class CullingPipeline> cullingPipeline_;
+		uint64_t graphicsPresentId_{}; // The last present rasterized.
+		double graphicsTime_{}; // The time of that present.
 		std::vector<class FrameBuffer> swapChainFramebuffers_;
 		std::unique_ptr<class CommandPool> commandPool_;
+		std::unique_ptr<class CommandPool> transferCommandPool_;
+		std::unique_ptr<class StagingRing> stagingRing_;
+		std::unique_ptr<class DynamicRendering> dynamicRendering_;
+		std::unique_ptr<class PipelineCache> pipelineCache_;
+		std::unique_ptr<class GpuProfiler> gpuProfiler_;
 		std::unique_ptr<class CommandBuffers> commandBuffers_;
 		std::vector<class Semaphore> imageAvailableSemaphores_;
 		std::vector<class Semaphore> renderFinishedSemaphores_;
-		std::vector<class Fence> inFlightFences_;
+		std::unique_ptr<class TimelineSemaphore> frameTimeline_;
+		std::vector<uint64_t> frameSlotValues_; // The frame timeline value signaled by the last submission of each frame in flight.
+		uint64_t frameValue_{}; // The last value submitted.
+
+		PFN_vkWaitForPresentKHR waitForPresent_{}; // Only with low latency and VK_KHR_present_wait.
+		uint64_t presentId_{}; // The last present, see VkPresentIdKHR.
+		uint64_t swapChainFirstPresentId_{}; // A new swap chain never reaches the ids presented to the previous one.
+		std::chrono::steady_clock::time_point inputTimes_[2]; // The input sampling time of the last two presents, indexed by their id.
+		double latency_{-1};
+		double presentWaitTime_{};
+		double queuePresentTime_{};
 
 		size_t currentFrame_{};
+		bool isGraphicsPipelineReported_{};
 	};
 
 }
@@ -1,4 +1,5 @@
 #include "Buffer.hpp"
+#include "Device.hpp"
 #include "SingleTimeCommands.hpp"
 
 namespace Vulkan {
@@ -12,6 +13,24 @@ Buffer::Buffer(const class Device& device, const size_t size, const VkBufferUsag
 	bufferInfo.usage = usage;
 	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+	// Acceleration structures are built on the compute queue but used on the graphics queue.
+	// Their inputs are also uploaded on the transfer queue (see StagingRing), which then has to be listed as well.
+	const VkBufferUsageFlags accelerationStructureUsage =
+		VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
+		VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR;
+
+	const uint32_t queueFamilyIndices[] = { device.GraphicsFamilyIndex(), device.ComputeFamilyIndex(), device.TransferFamilyIndex() };
+
+	if ((usage & accelerationStructureUsage) != 0 && queueFamilyIndices[0] != queueFamilyIndices[1])
+	{
+		const bool hasOwnTransferFamily = queueFamilyIndices[2] != queueFamilyIndices[0] && queueFamilyIndices[2] != queueFamilyIndices[1];
+
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = hasOwnTransferFamily ? 3 : 2;
+		bufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+		isConcurrent_ = true;
+	}
+
 	Check(vkCreateBuffer(device.Handle(), &bufferInfo, nullptr, &buffer_),
 		"create buffer");
 }
@@ -33,11 +52,13 @@ DeviceMemory Buffer::AllocateMemory(const VkMemoryPropertyFlags propertyFlags)
 DeviceMemory Buffer::AllocateMemory(const VkMemoryAllocateFlags allocateFlags, const VkMemoryPropertyFlags propertyFlags)
 {
 	const auto requirements = GetMemoryRequirements();
-	DeviceMemory memory(device_, requirements.size, requirements.memoryTypeBits, allocateFlags, propertyFlags);
+	DeviceMemory memory(device_, requirements, allocateFlags, propertyFlags);
 
-	Check(vkBindBufferMemory(device_.Handle(), buffer_, memory.Handle(), 0),
+	Check(vkBindBufferMemory(device_.Handle(), buffer_, memory.Handle(), memory.Offset()),
 		"bind buffer memory");
 
+	memory.SetOwner(reinterpret_cast<const uint64_t&>(buffer_));
+
 	return memory;
 }
 
@@ -62,13 +83,18 @@ void Buffer::CopyFrom(CommandPool& commandPool, const Buffer& src, VkDeviceSize
 {
 	SingleTimeCommands::Submit(commandPool, [&](VkCommandBuffer commandBuffer)
 	{
-		VkBufferCopy copyRegion = {};
-		copyRegion.srcOffset = 0; // Optional
-		copyRegion.dstOffset = 0; // Optional
-		copyRegion.size = size;
-
-		vkCmdCopyBuffer(commandBuffer, src.Handle(), Handle(), 1, &copyRegion);
+		CopyFrom(commandBuffer, src, 0, 0, size);
 	});
 }
 
+void Buffer::CopyFrom(VkCommandBuffer commandBuffer, const Buffer& src, const VkDeviceSize srcOffset, const VkDeviceSize dstOffset, const VkDeviceSize size)
+{
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+
+	vkCmdCopyBuffer(commandBuffer, src.Handle(), Handle(), 1, &copyRegion);
+}
+
 }
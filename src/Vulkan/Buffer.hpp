@@ -25,11 +25,16 @@ namespace Vulkan
 		VkMemoryRequirements GetMemoryRequirements() const;
 		VkDeviceAddress GetDeviceAddress() const;
 
+		// Shared by the graphics, compute and transfer queue families, it needs no ownership transfers.
+		bool IsConcurrent() const { return isConcurrent_; }
+
 		void CopyFrom(CommandPool& commandPool, const Buffer& src, VkDeviceSize size);
+		void CopyFrom(VkCommandBuffer commandBuffer, const Buffer& src, VkDeviceSize srcOffset, VkDeviceSize dstOffset, VkDeviceSize size);
 
 	private:
 
 		const class Device& device_;
+		bool isConcurrent_{};
 
 		VULKAN_HANDLE(VkBuffer, buffer_)
 	};
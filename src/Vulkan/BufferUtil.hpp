@@ -1,10 +1,11 @@
 #pragma once
 
 #include "Buffer.hpp"
-#include "CommandPool.hpp"
 #include "Device.hpp"
 #include "DeviceMemory.hpp"
+#include "StagingRing.hpp"
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -17,52 +18,74 @@ namespace Vulkan
 	public:
 
 		template <class T>
-		static void CopyFromStagingBuffer(CommandPool& commandPool, Buffer& dstBuffer, const std::vector<T>& content);
+		static void CopyFromStagingBuffer(StagingRing& stagingRing, Buffer& dstBuffer, const std::vector<T>& content);
 
+		// Any allocator, e.g. the std::pmr one of a build arena.
+		template <class T, class Allocator>
+		static void CreateDeviceBuffer(
+			StagingRing& stagingRing,
+			const char* name,
+			VkBufferUsageFlags usage,
+			const std::vector<T, Allocator>& content,
+			std::unique_ptr<Buffer>& buffer,
+			std::unique_ptr<DeviceMemory>& memory);
+
+		// Fills the buffer straight into the staging ring, write(elements, first, count) is called with whole elements.
 		template <class T>
 		static void CreateDeviceBuffer(
-			CommandPool& commandPool,
+			StagingRing& stagingRing,
 			const char* name,
 			VkBufferUsageFlags usage,
-			const std::vector<T>& content,
+			size_t count,
+			const std::function<void(T*, size_t, size_t)>& write,
 			std::unique_ptr<Buffer>& buffer,
 			std::unique_ptr<DeviceMemory>& memory);
 	};
 
 	template <class T>
-	void BufferUtil::CopyFromStagingBuffer(CommandPool& commandPool, Buffer& dstBuffer, const std::vector<T>& content)
+	void BufferUtil::CopyFromStagingBuffer(StagingRing& stagingRing, Buffer& dstBuffer, const std::vector<T>& content)
 	{
-		const auto& device = commandPool.Device();
 		const auto contentSize = sizeof(content[0]) * content.size();
-		
-		// Create a temporary host-visible staging buffer.
-		auto stagingBuffer = std::make_unique<Buffer>(device, contentSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-		auto stagingBufferMemory = stagingBuffer->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-		// Copy the host data into the staging buffer.
-		const auto data = stagingBufferMemory.Map(0, contentSize);
-		std::memcpy(data, content.data(), contentSize);
-		stagingBufferMemory.Unmap();
+		// Stage the host data through the persistent ring, the copies are submitted with the next flush.
+		stagingRing.Upload(content.data(), contentSize, 1, [&dstBuffer](VkCommandBuffer commandBuffer, const Buffer& stagingBuffer, VkDeviceSize stagingOffset, VkDeviceSize offset, VkDeviceSize size)
+		{
+			dstBuffer.CopyFrom(commandBuffer, stagingBuffer, stagingOffset, offset, size);
+		});
+
+		stagingRing.Release(dstBuffer);
+	}
 
-		// Copy the staging buffer to the device buffer.
-		dstBuffer.CopyFrom(commandPool, *stagingBuffer, contentSize);
+	template <class T, class Allocator>
+	void BufferUtil::CreateDeviceBuffer(
+		StagingRing& stagingRing,
+		const char* const name,
+		const VkBufferUsageFlags usage, 
+		const std::vector<T, Allocator>& content,
+		std::unique_ptr<Buffer>& buffer,
+		std::unique_ptr<DeviceMemory>& memory)
+	{
+		const std::function<void(T*, size_t, size_t)> write = [&content](T* const elements, const size_t first, const size_t count)
+		{
+			std::memcpy(elements, content.data() + first, sizeof(T) * count);
+		};
 
-		// Delete the buffer before the memory
-		stagingBuffer.reset();
+		CreateDeviceBuffer(stagingRing, name, usage, content.size(), write, buffer, memory);
 	}
 
 	template <class T>
 	void BufferUtil::CreateDeviceBuffer(
-		CommandPool& commandPool,
+		StagingRing& stagingRing,
 		const char* const name,
-		const VkBufferUsageFlags usage, 
-		const std::vector<T>& content,
+		const VkBufferUsageFlags usage,
+		const size_t count,
+		const std::function<void(T*, size_t, size_t)>& write,
 		std::unique_ptr<Buffer>& buffer,
 		std::unique_ptr<DeviceMemory>& memory)
 	{
-		const auto& device = commandPool.Device();
+		const auto& device = stagingRing.Device();
 		const auto& debugUtils = device.DebugUtils();
-		const auto contentSize = sizeof(content[0]) * content.size();
+		const auto contentSize = sizeof(T) * count;
 		const VkMemoryAllocateFlags allocateFlags = usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
 			? VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT
 			: 0;
@@ -73,6 +96,18 @@ namespace Vulkan
 		debugUtils.SetObjectName(buffer->Handle(), (name + std::string(" Buffer")).c_str());
 		debugUtils.SetObjectName(memory->Handle(), (name + std::string(" Memory")).c_str());
 
-		CopyFromStagingBuffer(commandPool, *buffer, content);
+		auto& dstBuffer = *buffer;
+
+		stagingRing.Upload(contentSize, sizeof(T),
+			[&write](void* const data, const VkDeviceSize offset, const VkDeviceSize size)
+			{
+				write(static_cast<T*>(data), static_cast<size_t>(offset / sizeof(T)), static_cast<size_t>(size / sizeof(T)));
+			},
+			[&dstBuffer](VkCommandBuffer commandBuffer, const Buffer& stagingBuffer, VkDeviceSize stagingOffset, VkDeviceSize offset, VkDeviceSize size)
+			{
+				dstBuffer.CopyFrom(commandBuffer, stagingBuffer, stagingOffset, offset, size);
+			});
+
+		stagingRing.Release(dstBuffer);
 	}
 }
@@ -4,13 +4,14 @@
 
 namespace Vulkan {
 
-CommandBuffers::CommandBuffers(CommandPool& commandPool, const uint32_t size) :
-	commandPool_(commandPool)
+CommandBuffers::CommandBuffers(CommandPool& commandPool, const uint32_t size, const VkCommandBufferLevel level) :
+	commandPool_(commandPool),
+	level_(level)
 {
 	VkCommandBufferAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.commandPool = commandPool.Handle();
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.level = level;
 	allocInfo.commandBufferCount = size;
 
 	commandBuffers_.resize(size);
@@ -30,10 +31,14 @@ CommandBuffers::~CommandBuffers()
 
 VkCommandBuffer CommandBuffers::Begin(const size_t i)
 {
+	// The secondary command buffers are only executed outside of render passes, they inherit nothing.
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-	beginInfo.pInheritanceInfo = nullptr; // Optional
+	beginInfo.pInheritanceInfo = level_ == VK_COMMAND_BUFFER_LEVEL_SECONDARY ? &inheritanceInfo : nullptr;
 
 	Check(vkBeginCommandBuffer(commandBuffers_[i], &beginInfo),
 		"begin recording command buffer");
@@ -13,7 +13,7 @@ namespace Vulkan
 
 		VULKAN_NON_COPIABLE(CommandBuffers)
 
-		CommandBuffers(CommandPool& commandPool, uint32_t size);
+		CommandBuffers(CommandPool& commandPool, uint32_t size, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 		~CommandBuffers();
 
 		uint32_t Size() const { return static_cast<uint32_t>(commandBuffers_.size()); }
@@ -25,6 +25,7 @@ namespace Vulkan
 	private:
 
 		const CommandPool& commandPool_;
+		const VkCommandBufferLevel level_;
 
 		std::vector<VkCommandBuffer> commandBuffers_;
 	};
@@ -4,7 +4,8 @@
 namespace Vulkan {
 
 CommandPool::CommandPool(const class Device& device, const uint32_t queueFamilyIndex, const bool allowReset) :
-	device_(device)
+	device_(device),
+	queueFamilyIndex_(queueFamilyIndex)
 {
 	VkCommandPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
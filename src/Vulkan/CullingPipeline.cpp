@@ -0,0 +1,119 @@
+#include "CullingPipeline.hpp"
+#include "Buffer.hpp"
+#include "DescriptorBinding.hpp"
+#include "DescriptorSetManager.hpp"
+#include "DescriptorSets.hpp"
+#include "Device.hpp"
+#include "DeviceMemory.hpp"
+#include "PipelineCache.hpp"
+#include "PipelineLayout.hpp"
+#include "ShaderCache.hpp"
+#include "ShaderModule.hpp"
+#include "Assets/Scene.hpp"
+#include "Assets/UniformBuffer.hpp"
+
+namespace Vulkan {
+
+CullingPipeline::CullingPipeline(
+	const class Device& device,
+	const PipelineCache& pipelineCache,
+	const std::vector<Assets::UniformBuffer>& uniformBuffers,
+	const Assets::Scene& scene) :
+	device_(device),
+	drawCount_(scene.DrawCount())
+{
+	// The previous frames may still be drawing with their commands, each frame in flight gets its own.
+	for (size_t i = 0; i != uniformBuffers.size(); ++i)
+	{
+		drawCommandBuffers_.emplace_back(new Buffer(device, drawCount_ * sizeof(VkDrawIndexedIndirectCommand),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT));
+		drawCommandBufferMemories_.emplace_back(new DeviceMemory(drawCommandBuffers_.back()->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+
+		device.DebugUtils().SetObjectName(drawCommandBuffers_.back()->Handle(), "Draw Commands");
+	}
+
+	const std::vector<DescriptorBinding> descriptorBindings =
+	{
+		{0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{2, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{3, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT}
+	};
+
+	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, uniformBuffers.size()));
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	for (uint32_t i = 0; i != uniformBuffers.size(); ++i)
+	{
+		VkDescriptorBufferInfo uniformBufferInfo = {};
+		uniformBufferInfo.buffer = uniformBuffers[i].Buffer().Handle();
+		uniformBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorBufferInfo instanceBufferInfo = {};
+		instanceBufferInfo.buffer = scene.InstanceBuffer().Handle();
+		instanceBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorBufferInfo drawBufferInfo = {};
+		drawBufferInfo.buffer = scene.DrawBuffer().Handle();
+		drawBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorBufferInfo drawCommandBufferInfo = {};
+		drawCommandBufferInfo.buffer = drawCommandBuffers_[i]->Handle();
+		drawCommandBufferInfo.range = VK_WHOLE_SIZE;
+
+		const std::vector<VkWriteDescriptorSet> descriptorWrites =
+		{
+			descriptorSets.Bind(i, 0, uniformBufferInfo),
+			descriptorSets.Bind(i, 1, instanceBufferInfo),
+			descriptorSets.Bind(i, 2, drawBufferInfo),
+			descriptorSets.Bind(i, 3, drawCommandBufferInfo)
+		};
+
+		descriptorSets.UpdateDescriptors(i, descriptorWrites);
+	}
+
+	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout()));
+
+	const auto& computeShader = device.Shaders().Get("Culling.comp.spv");
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT);
+	pipelineInfo.layout = pipelineLayout_->Handle();
+
+	Check(vkCreateComputePipelines(device.Handle(), pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipeline_),
+		"create culling pipeline");
+}
+
+CullingPipeline::~CullingPipeline()
+{
+	if (pipeline_ != nullptr)
+	{
+		vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
+		pipeline_ = nullptr;
+	}
+
+	pipelineLayout_.reset();
+	descriptorSetManager_.reset();
+	drawCommandBuffers_.clear();
+	drawCommandBufferMemories_.clear();
+}
+
+void CullingPipeline::Dispatch(VkCommandBuffer commandBuffer, const uint32_t index) const
+{
+	VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(index) };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 0, nullptr);
+	vkCmdDispatch(commandBuffer, (drawCount_ + 63) / 64, 1, 1);
+
+	VkMemoryBarrier memoryBarrier = {};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+}
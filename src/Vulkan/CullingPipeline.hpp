@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <memory>
+#include <vector>
+
+namespace Assets
+{
+	class Scene;
+	class UniformBuffer;
+}
+
+namespace Vulkan
+{
+	class Buffer;
+	class DescriptorSetManager;
+	class Device;
+	class DeviceMemory;
+	class PipelineCache;
+	class PipelineLayout;
+
+	// The frustum culling of the rasterized instances on the GPU (see Culling.comp).
+	// It turns the per instance draws of the scene into the indirect draw commands of a frame in flight, the culled ones without any instance.
+	class CullingPipeline final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(CullingPipeline)
+
+		CullingPipeline(
+			const Device& device,
+			const PipelineCache& pipelineCache,
+			const std::vector<Assets::UniformBuffer>& uniformBuffers,
+			const Assets::Scene& scene);
+		~CullingPipeline();
+
+		// One VkDrawIndexedIndirectCommand per scene draw, in the draw buffer order (see Assets::Scene::ShortIndexDrawCount()).
+		const Buffer& DrawCommandBuffer(uint32_t index) const { return *drawCommandBuffers_[index]; }
+		uint32_t DrawCount() const { return drawCount_; }
+
+		// Writes the draw commands of the given frame in flight, the barrier up to the indirect draw is inserted here.
+		void Dispatch(VkCommandBuffer commandBuffer, uint32_t index) const;
+
+	private:
+
+		const Device& device_;
+		const uint32_t drawCount_;
+
+		VULKAN_HANDLE(VkPipeline, pipeline_)
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+		std::vector<std::unique_ptr<Buffer>> drawCommandBuffers_;
+		std::vector<std::unique_ptr<DeviceMemory>> drawCommandBufferMemories_;
+	};
+
+}
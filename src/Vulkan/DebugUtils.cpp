@@ -1,4 +1,5 @@
 #include "DebugUtils.hpp"
+#include "MemoryAllocator.hpp"
 #include "Utilities/Exception.hpp"
 
 namespace Vulkan {
@@ -14,4 +15,9 @@ DebugUtils::DebugUtils(VkInstance instance)
 #endif
 }
 
-}
\ No newline at end of file
+void DebugUtils::SetOwnerName(const uint64_t owner, const char* const name) const
+{
+	allocator_->SetOwnerName(owner, name);
+}
+
+}
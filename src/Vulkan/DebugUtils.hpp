@@ -4,6 +4,8 @@
 
 namespace Vulkan
 {
+	class MemoryAllocator;
+
 	class DebugUtils final
 	{
 	public:
@@ -14,21 +16,23 @@ namespace Vulkan
 		~DebugUtils() = default;
 
 
-		void SetDevice(VkDevice device)
+		void SetDevice(VkDevice device, MemoryAllocator& allocator)
 		{
 			device_ = device;
+			allocator_ = &allocator;
 		}
 
 		void SetObjectName(const VkAccelerationStructureKHR& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR); }
-		void SetObjectName(const VkBuffer& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_BUFFER); }
+		void SetObjectName(const VkBuffer& object, const char* name) const { SetOwnerName(object, name); SetObjectName(object, name, VK_OBJECT_TYPE_BUFFER); }
 		void SetObjectName(const VkCommandBuffer& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_COMMAND_BUFFER); }
 		void SetObjectName(const VkDescriptorSet& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_DESCRIPTOR_SET); }
 		void SetObjectName(const VkDescriptorSetLayout& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT); }
 		void SetObjectName(const VkDeviceMemory& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_DEVICE_MEMORY); }
 		void SetObjectName(const VkFramebuffer& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_FRAMEBUFFER); }
-		void SetObjectName(const VkImage& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_IMAGE); }
+		void SetObjectName(const VkImage& object, const char* name) const { SetOwnerName(object, name); SetObjectName(object, name, VK_OBJECT_TYPE_IMAGE); }
 		void SetObjectName(const VkImageView& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_IMAGE_VIEW); }
 		void SetObjectName(const VkPipeline& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_PIPELINE); }
+		void SetObjectName(const VkQueryPool& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_QUERY_POOL); }
 		void SetObjectName(const VkQueue& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_QUEUE); }
 		void SetObjectName(const VkRenderPass& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_RENDER_PASS); }
 		void SetObjectName(const VkSemaphore& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_SEMAPHORE); }
@@ -37,6 +41,15 @@ namespace Vulkan
 		
 	private:
 
+		// The buffer and image names also tell the memory allocator what their memory is for, even in release builds.
+		template <typename T>
+		void SetOwnerName(const T& object, const char* name) const
+		{
+			SetOwnerName(reinterpret_cast<const uint64_t&>(object), name);
+		}
+
+		void SetOwnerName(uint64_t owner, const char* name) const;
+
 		template <typename T>
 		void SetObjectName(const T& object, const char* name, VkObjectType type) const
 		{
@@ -55,6 +68,7 @@ namespace Vulkan
 		const PFN_vkSetDebugUtilsObjectNameEXT vkSetDebugUtilsObjectNameEXT_;
 
 		VkDevice device_{};
+		MemoryAllocator* allocator_{};
 	};
 
 }
@@ -0,0 +1,185 @@
+#include "DeformPipeline.hpp"
+#include "Buffer.hpp"
+#include "DescriptorBinding.hpp"
+#include "DescriptorSetManager.hpp"
+#include "DescriptorSets.hpp"
+#include "Device.hpp"
+#include "DeviceMemory.hpp"
+#include "PipelineLayout.hpp"
+#include "ShaderCache.hpp"
+#include "ShaderModule.hpp"
+#include <algorithm>
+
+namespace Vulkan {
+
+namespace
+{
+	// Matches the push constants of Deform.comp.
+	struct PushConstants
+	{
+		uint32_t FirstVertex;
+		uint32_t VertexCount;
+		uint32_t FirstRest;
+		uint32_t Stage; // 0 captures the rest vertices, 1 deforms them.
+		uint32_t WritePositions;
+		float Time;
+		float Amplitude;
+		float Frequency;
+	};
+
+	// The invocations loop over the vertices past the group count limit every device supports.
+	constexpr uint32_t GroupSize = 64;
+	constexpr uint32_t MaxGroupCount = 65535;
+
+	uint32_t GroupCount(const uint32_t vertexCount)
+	{
+		return std::min((vertexCount + GroupSize - 1) / GroupSize, MaxGroupCount);
+	}
+}
+
+DeformPipeline::DeformPipeline(
+	const class Device& device,
+	const Buffer& vertexBuffer,
+	const Buffer* const positionBuffer,
+	const bool compactVertices,
+	const std::vector<Range>& ranges) :
+	device_(device),
+	ranges_(ranges),
+	writePositions_(positionBuffer != nullptr)
+{
+	// The rest positions and normals of every range, one after the other.
+	VkDeviceSize restCount = 0;
+
+	for (const auto& range : ranges_)
+	{
+		restCount += 6 * VkDeviceSize(range.VertexCount);
+	}
+
+	restBuffer_.reset(new Buffer(device, std::max<VkDeviceSize>(restCount, 1) * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT));
+	restBufferMemory_.reset(new DeviceMemory(restBuffer_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+
+	device.DebugUtils().SetObjectName(restBuffer_->Handle(), "Rest Vertices");
+
+	const std::vector<DescriptorBinding> descriptorBindings =
+	{
+		{0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{2, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT}
+	};
+
+	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, 1));
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	VkDescriptorBufferInfo vertexBufferInfo = {};
+	vertexBufferInfo.buffer = vertexBuffer.Handle();
+	vertexBufferInfo.range = VK_WHOLE_SIZE;
+
+	// Without a position stream, the binding is only there to be valid and never written.
+	VkDescriptorBufferInfo positionBufferInfo = {};
+	positionBufferInfo.buffer = positionBuffer != nullptr ? positionBuffer->Handle() : vertexBuffer.Handle();
+	positionBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo restBufferInfo = {};
+	restBufferInfo.buffer = restBuffer_->Handle();
+	restBufferInfo.range = VK_WHOLE_SIZE;
+
+	const std::vector<VkWriteDescriptorSet> descriptorWrites =
+	{
+		descriptorSets.Bind(0, 0, vertexBufferInfo),
+		descriptorSets.Bind(0, 1, positionBufferInfo),
+		descriptorSets.Bind(0, 2, restBufferInfo)
+	};
+
+	descriptorSets.UpdateDescriptors(0, descriptorWrites);
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout(), { pushConstantRange }));
+
+	const auto& computeShader = device.Shaders().Get("Deform.comp.spv");
+
+	// Select the vertex layout of the scene.
+	const VkBool32 compact = compactVertices;
+	const VkSpecializationMapEntry specializationEntry = { 0, 0, sizeof(VkBool32) };
+	const VkSpecializationInfo specializationInfo = { 1, &specializationEntry, sizeof(compact), &compact };
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT, &specializationInfo);
+	pipelineInfo.layout = pipelineLayout_->Handle();
+
+	// Created with the acceleration structures of every scene, hence without the application pipeline cache like the normals one.
+	Check(vkCreateComputePipelines(device.Handle(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline_),
+		"create deform pipeline");
+}
+
+DeformPipeline::~DeformPipeline()
+{
+	if (pipeline_ != nullptr)
+	{
+		vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
+		pipeline_ = nullptr;
+	}
+
+	pipelineLayout_.reset();
+	descriptorSetManager_.reset();
+	restBuffer_.reset();
+	restBufferMemory_.reset();
+}
+
+void DeformPipeline::Dispatch(VkCommandBuffer commandBuffer, const float time)
+{
+	const auto barrier = [commandBuffer](VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+	{
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = srcAccess;
+		memoryBarrier.dstAccessMask = dstAccess;
+
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	};
+
+	// The previous frames may still be reading the vertices, from the shaders or the acceleration structure refits.
+	barrier(
+		VK_ACCESS_MEMORY_READ_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(0) };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 0, nullptr);
+
+	// The rest vertices are captured once, before the first deformation overwrites them.
+	for (const uint32_t stage : { 0u, 1u })
+	{
+		if (stage == 0 && isCaptured_)
+		{
+			continue;
+		}
+
+		uint32_t firstRest = 0;
+
+		for (const auto& range : ranges_)
+		{
+			const PushConstants constants = { range.FirstVertex, range.VertexCount, firstRest, stage, writePositions_ ? 1u : 0u, time, range.Amplitude, range.Frequency };
+
+			vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+			vkCmdDispatch(commandBuffer, GroupCount(range.VertexCount), 1, 1);
+
+			firstRest += range.VertexCount;
+		}
+
+		// The rest vertices are complete before any is deformed, and the positions are written before the refits and the shaders read them.
+		barrier(
+			VK_ACCESS_SHADER_WRITE_BIT, stage == 0 ? VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_MEMORY_READ_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, stage == 0 ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+	}
+
+	isCaptured_ = true;
+}
+
+}
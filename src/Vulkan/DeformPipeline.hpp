@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <memory>
+#include <vector>
+
+namespace Vulkan
+{
+	class Buffer;
+	class DescriptorSetManager;
+	class Device;
+	class DeviceMemory;
+	class PipelineLayout;
+
+	// The vertex animation of --deform (see Deform.comp), displacing the positions of the deformed models in place in the vertex buffer
+	// (and the position stream) every frame, from their rest positions captured by the first dispatch.
+	class DeformPipeline final
+	{
+	public:
+
+		// The vertices of a deformed model in the scene buffers, and the wave displacing them in its object space.
+		struct Range final
+		{
+			uint32_t FirstVertex;
+			uint32_t VertexCount;
+			float Amplitude;
+			float Frequency; // Radians per object space unit.
+		};
+
+		VULKAN_NON_COPIABLE(DeformPipeline)
+
+		DeformPipeline(
+			const Device& device,
+			const Buffer& vertexBuffer,
+			const Buffer* positionBuffer,
+			bool compactVertices,
+			const std::vector<Range>& ranges);
+		~DeformPipeline();
+
+		// Waits for any earlier read of the vertices, the barrier up to the acceleration structure builds and the shaders is inserted here.
+		// The pipeline must outlive the execution of the command buffer.
+		void Dispatch(VkCommandBuffer commandBuffer, float time);
+
+	private:
+
+		const Device& device_;
+		const std::vector<Range> ranges_;
+		const bool writePositions_;
+		bool isCaptured_{};
+
+		VULKAN_HANDLE(VkPipeline, pipeline_)
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+		std::unique_ptr<Buffer> restBuffer_;
+		std::unique_ptr<DeviceMemory> restBufferMemory_;
+	};
+
+}
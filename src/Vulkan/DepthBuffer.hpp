@@ -21,6 +21,7 @@ namespace Vulkan
 		~DepthBuffer();
 
 		VkFormat Format() const { return format_; }
+		const class Image& Image() const { return *image_; }
 		const class ImageView& ImageView() const { return *imageView_; }
 
 		static bool HasStencilComponent(const VkFormat format)
@@ -31,7 +32,7 @@ namespace Vulkan
 	private:
 
 		const VkFormat format_;
-		std::unique_ptr<Image> image_;
+		std::unique_ptr<class Image> image_;
 		std::unique_ptr<DeviceMemory> imageMemory_;
 		std::unique_ptr<class ImageView> imageView_;
 	};
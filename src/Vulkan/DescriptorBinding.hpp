@@ -10,5 +10,6 @@ namespace Vulkan
 		uint32_t DescriptorCount; // Number of descriptors to bind
 		VkDescriptorType Type; // Type of the bound descriptor(s)
 		VkShaderStageFlags Stage; // Shader stage at which the bound resources will be available
+		VkDescriptorBindingFlags Flags; // Optional, e.g. an array that can be partially bound and updated after bind
 	};
 }
\ No newline at end of file
@@ -7,14 +7,18 @@ DescriptorPool::DescriptorPool(const Vulkan::Device& device, const std::vector<D
 	device_(device)
 {
 	std::vector<VkDescriptorPoolSize> poolSizes;
+	bool isUpdateAfterBind = false;
 
 	for (const auto& binding : descriptorBindings)
 	{
 		poolSizes.push_back(VkDescriptorPoolSize{ binding.Type, static_cast<uint32_t>(binding.DescriptorCount*maxSets )});
+		isUpdateAfterBind |= (binding.Flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0;
 	}
 
+	// The sets of an update after bind layout must come from a pool created with the same flag (see DescriptorSetLayout).
 	VkDescriptorPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = isUpdateAfterBind ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0;
 	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	poolInfo.pPoolSizes = poolSizes.data();
 	poolInfo.maxSets = static_cast<uint32_t>(maxSets);
@@ -7,6 +7,8 @@ DescriptorSetLayout::DescriptorSetLayout(const Device& device, const std::vector
 	device_(device)
 {
 	std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+	std::vector<VkDescriptorBindingFlags> bindingFlags;
+	bool isUpdateAfterBind = false;
 
 	for (const auto& binding : descriptorBindings)
 	{
@@ -17,10 +19,19 @@ DescriptorSetLayout::DescriptorSetLayout(const Device& device, const std::vector
 		b.stageFlags = binding.Stage;
 
 		layoutBindings.push_back(b);
+		bindingFlags.push_back(binding.Flags);
+		isUpdateAfterBind |= (binding.Flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0;
 	}
 
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
 	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = isUpdateAfterBind ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0;
 	layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
 	layoutInfo.pBindings = layoutBindings.data();
 
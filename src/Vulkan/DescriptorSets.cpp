@@ -58,13 +58,13 @@ VkWriteDescriptorSet DescriptorSets::Bind(const uint32_t index, const uint32_t b
 	return descriptorWrite;
 }
 
-VkWriteDescriptorSet DescriptorSets::Bind(const uint32_t index, const uint32_t binding, const VkDescriptorImageInfo& imageInfo, const uint32_t count) const
+VkWriteDescriptorSet DescriptorSets::Bind(const uint32_t index, const uint32_t binding, const VkDescriptorImageInfo& imageInfo, const uint32_t count, const uint32_t arrayElement) const
 {
 	VkWriteDescriptorSet descriptorWrite = {};
 	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptorWrite.dstSet = descriptorSets_[index];
 	descriptorWrite.dstBinding = binding;
-	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.dstArrayElement = arrayElement;
 	descriptorWrite.descriptorType = GetBindingType(binding);
 	descriptorWrite.descriptorCount = count;
 	descriptorWrite.pImageInfo = &imageInfo;
@@ -94,6 +94,59 @@ void DescriptorSets::UpdateDescriptors(uint32_t index, const std::vector<VkWrite
 		descriptorWrites.data(), 0, nullptr);
 }
 
+size_t DescriptorSets::UpdateImageArray(const uint32_t index, const uint32_t binding, const std::vector<VkDescriptorImageInfo>& imageInfos, std::vector<VkDescriptorImageInfo>& written)
+{
+	const auto isSame = [](const VkDescriptorImageInfo& a, const VkDescriptorImageInfo& b)
+	{
+		return a.sampler == b.sampler && a.imageView == b.imageView && a.imageLayout == b.imageLayout;
+	};
+
+	written.resize(imageInfos.size());
+
+	// One write per run of changed elements.
+	std::vector<VkWriteDescriptorSet> descriptorWrites;
+	size_t count = 0;
+
+	for (size_t i = 0; i != imageInfos.size();)
+	{
+		if (isSame(imageInfos[i], written[i]))
+		{
+			++i;
+			continue;
+		}
+
+		const size_t first = i;
+
+		while (i != imageInfos.size() && !isSame(imageInfos[i], written[i]))
+		{
+			written[i] = imageInfos[i];
+			++i;
+		}
+
+		descriptorWrites.push_back(Bind(index, binding, imageInfos[first], static_cast<uint32_t>(i - first), static_cast<uint32_t>(first)));
+		count += i - first;
+	}
+
+	if (!descriptorWrites.empty())
+	{
+		UpdateDescriptors(index, descriptorWrites);
+	}
+
+	return count;
+}
+
+size_t DescriptorSets::UpdateImageArray(const uint32_t index, const uint32_t binding, const std::vector<VkDescriptorImageInfo>& imageInfos, const uint64_t generation, WrittenImageArray& written)
+{
+	if (written.Generation == generation)
+	{
+		return 0;
+	}
+
+	written.Generation = generation;
+
+	return UpdateImageArray(index, binding, imageInfos, written.ImageInfos);
+}
+
 VkDescriptorType DescriptorSets::GetBindingType(uint32_t binding) const
 {
 	const auto it = bindingTypes_.find(binding);
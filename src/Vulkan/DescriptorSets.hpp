@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vulkan.hpp"
+#include <cstdint>
 #include <map>
 #include <vector>
 
@@ -17,6 +18,13 @@ namespace Vulkan
 
 		VULKAN_NON_COPIABLE(DescriptorSets)
 
+		// The elements of an image array last written to a descriptor set, and the generation of their source.
+		struct WrittenImageArray final
+		{
+			uint64_t Generation{ ~0ull };
+			std::vector<VkDescriptorImageInfo> ImageInfos;
+		};
+
 		DescriptorSets(
 			const DescriptorPool& descriptorPool, 
 			const DescriptorSetLayout& layout,
@@ -28,11 +36,18 @@ namespace Vulkan
 		VkDescriptorSet Handle(uint32_t index) const { return descriptorSets_[index]; }
 
 		VkWriteDescriptorSet Bind(uint32_t index, uint32_t binding, const VkDescriptorBufferInfo& bufferInfo, uint32_t count = 1) const;
-		VkWriteDescriptorSet Bind(uint32_t index, uint32_t binding, const VkDescriptorImageInfo& imageInfo, uint32_t count = 1) const;
+		VkWriteDescriptorSet Bind(uint32_t index, uint32_t binding, const VkDescriptorImageInfo& imageInfo, uint32_t count = 1, uint32_t arrayElement = 0) const;
 		VkWriteDescriptorSet Bind(uint32_t index, uint32_t binding, const VkWriteDescriptorSetAccelerationStructureKHR& structureInfo, uint32_t count = 1) const;
 
 		void UpdateDescriptors(uint32_t index, const std::vector<VkWriteDescriptorSet>& descriptorWrites);
 
+		// Only writes the elements of an image array that differ from the last ones written, which are then updated.
+		// Returns the number of elements written.
+		size_t UpdateImageArray(uint32_t index, uint32_t binding, const std::vector<VkDescriptorImageInfo>& imageInfos, std::vector<VkDescriptorImageInfo>& written);
+
+		// Same, nothing being compared while the generation of the image infos is the one last written.
+		size_t UpdateImageArray(uint32_t index, uint32_t binding, const std::vector<VkDescriptorImageInfo>& imageInfos, uint64_t generation, WrittenImageArray& written);
+
 	private:
 
 		VkDescriptorType GetBindingType(uint32_t binding) const;
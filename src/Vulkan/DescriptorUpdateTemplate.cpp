@@ -0,0 +1,35 @@
+#include "DescriptorUpdateTemplate.hpp"
+#include "DescriptorSetLayout.hpp"
+#include "Device.hpp"
+
+namespace Vulkan {
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate(const Device& device, const DescriptorSetLayout& layout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries) :
+	device_(device)
+{
+	VkDescriptorUpdateTemplateCreateInfo templateInfo = {};
+	templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	templateInfo.pDescriptorUpdateEntries = entries.data();
+	templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateInfo.descriptorSetLayout = layout.Handle();
+
+	Check(vkCreateDescriptorUpdateTemplate(device.Handle(), &templateInfo, nullptr, &updateTemplate_),
+		"create descriptor update template");
+}
+
+DescriptorUpdateTemplate::~DescriptorUpdateTemplate()
+{
+	if (updateTemplate_ != nullptr)
+	{
+		vkDestroyDescriptorUpdateTemplate(device_.Handle(), updateTemplate_, nullptr);
+		updateTemplate_ = nullptr;
+	}
+}
+
+void DescriptorUpdateTemplate::Update(const VkDescriptorSet descriptorSet, const void* const data) const
+{
+	vkUpdateDescriptorSetWithTemplate(device_.Handle(), descriptorSet, updateTemplate_, data);
+}
+
+}
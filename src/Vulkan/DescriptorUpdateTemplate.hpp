@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <vector>
+
+namespace Vulkan
+{
+	class DescriptorSetLayout;
+	class Device;
+
+	// Writes a fixed group of bindings of a descriptor set from a single host struct in one call, the entries giving the offset
+	// of each binding descriptor info in that struct. Cheaper than building the matching VkWriteDescriptorSet every time.
+	class DescriptorUpdateTemplate final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(DescriptorUpdateTemplate)
+
+		DescriptorUpdateTemplate(const Device& device, const DescriptorSetLayout& layout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries);
+		~DescriptorUpdateTemplate();
+
+		void Update(VkDescriptorSet descriptorSet, const void* data) const;
+
+	private:
+
+		const Device& device_;
+
+		VULKAN_HANDLE(VkDescriptorUpdateTemplate, updateTemplate_)
+	};
+
+}
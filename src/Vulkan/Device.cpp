@@ -1,9 +1,13 @@
 #include "Device.hpp"
 #include "Enumerate.hpp"
 #include "Instance.hpp"
+#include "MemoryAllocator.hpp"
+#include "SamplerCache.hpp"
+#include "ShaderCache.hpp"
 #include "Surface.hpp"
 #include "Utilities/Exception.hpp"
 #include <algorithm>
+#include <cstring>
 #include <set>
 
 namespace Vulkan {
@@ -35,13 +39,15 @@ namespace
 
 Device::Device(
 	VkPhysicalDevice physicalDevice, 
-	const class Surface& surface, 
+	const class Instance& instance,
+	const class Surface* const surface, 
 	const std::vector<const char*>& requiredExtensions,
 	const VkPhysicalDeviceFeatures& deviceFeatures,
 	const void* nextDeviceFeatures) :
 	physicalDevice_(physicalDevice),
+	instance_(instance),
 	surface_(surface),
-	debugUtils_(surface.Instance().Handle())
+	debugUtils_(instance.Handle())
 {
 	CheckRequiredExtensions(physicalDevice, requiredExtensions);
 
@@ -51,16 +57,25 @@ Device::Device(
 	const auto graphicsFamily = FindQueue(queueFamilies, "graphics", VK_QUEUE_GRAPHICS_BIT, 0);
 	const auto computeFamily = FindQueue(queueFamilies, "compute", VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
 
-	//Commented out the dedicated transfer queue, as it's never used (relic from Vulkan tutorial) 
-	//and causes problems with RADV (see https://github.com/NVIDIA/Q2RTX/issues/147).
-	//const auto transferFamily = FindQueue(queueFamilies, "transfer", VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+	// The dedicated transfer queue is optional, some drivers do not have one (see https://github.com/NVIDIA/Q2RTX/issues/147).
+	// The staging ring uploads rows of texels at any offset, a coarser image transfer granularity is not supported.
+	const auto transferFamily = std::find_if(queueFamilies.begin(), queueFamilies.end(), [](const VkQueueFamilyProperties& queueFamily)
+	{
+		const auto& granularity = queueFamily.minImageTransferGranularity;
+
+		return
+			queueFamily.queueCount > 0 &&
+			queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT &&
+			!(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+			granularity.width == 1 && granularity.height == 1 && granularity.depth == 1;
+	});
 
-	// Find the presentation queue (usually the same as graphics queue).
-	const auto presentFamily = std::find_if(queueFamilies.begin(), queueFamilies.end(), [&](const VkQueueFamilyProperties& queueFamily)
+	// Find the presentation queue (usually the same as graphics queue), there is nothing to present to when headless.
+	const auto presentFamily = surface == nullptr ? graphicsFamily : std::find_if(queueFamilies.begin(), queueFamilies.end(), [&](const VkQueueFamilyProperties& queueFamily)
 	{
 		VkBool32 presentSupport = false;
 		const uint32_t i = static_cast<uint32_t>(&*queueFamilies.cbegin() - &queueFamily);
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface.Handle(), &presentSupport);
+		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface->Handle(), &presentSupport);
 		return queueFamily.queueCount > 0 && presentSupport;
 	});
 
@@ -72,7 +87,7 @@ Device::Device(
 	graphicsFamilyIndex_ = static_cast<uint32_t>(graphicsFamily - queueFamilies.begin());
 	computeFamilyIndex_ = static_cast<uint32_t>(computeFamily - queueFamilies.begin());
 	presentFamilyIndex_ = static_cast<uint32_t>(presentFamily - queueFamilies.begin());
-	//transferFamilyIndex_ = static_cast<uint32_t>(transferFamily - queueFamilies.begin());
+	transferFamilyIndex_ = transferFamily != queueFamilies.end() ? static_cast<uint32_t>(transferFamily - queueFamilies.begin()) : graphicsFamilyIndex_;
 
 	// Queues can be the same
 	const std::set<uint32_t> uniqueQueueFamilies =
@@ -80,7 +95,7 @@ Device::Device(
 		graphicsFamilyIndex_,
 		computeFamilyIndex_,
 		presentFamilyIndex_,
-		//transferFamilyIndex_
+		transferFamilyIndex_
 	};
 
 	// Create queues
@@ -105,24 +120,37 @@ Device::Device(
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledLayerCount = static_cast<uint32_t>(surface_.Instance().ValidationLayers().size());
-	createInfo.ppEnabledLayerNames = surface_.Instance().ValidationLayers().data();
+	createInfo.enabledLayerCount = static_cast<uint32_t>(instance_.ValidationLayers().size());
+	createInfo.ppEnabledLayerNames = instance_.ValidationLayers().data();
 	createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
 	createInfo.ppEnabledExtensionNames = requiredExtensions.data();
 
 	Check(vkCreateDevice(physicalDevice, &createInfo, nullptr, &device_),
 		"create logical device");
 
-	debugUtils_.SetDevice(device_);
+	// The memory heap budgets are only known with VK_EXT_memory_budget (see Vulkan::Application::SetPhysicalDevice()).
+	const bool hasMemoryBudget = std::any_of(requiredExtensions.begin(), requiredExtensions.end(), [](const char* const extension)
+	{
+		return strcmp(extension, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+	});
+
+	allocator_.reset(new MemoryAllocator(*this, hasMemoryBudget));
+	debugUtils_.SetDevice(device_, *allocator_);
+	shaderCache_.reset(new ShaderCache(*this));
+	samplerCache_.reset(new SamplerCache(*this));
 
 	vkGetDeviceQueue(device_, graphicsFamilyIndex_, 0, &graphicsQueue_);
 	vkGetDeviceQueue(device_, computeFamilyIndex_, 0, &computeQueue_);
 	vkGetDeviceQueue(device_, presentFamilyIndex_, 0, &presentQueue_);
-	//vkGetDeviceQueue(device_, transferFamilyIndex_, 0, &transferQueue_);
+	vkGetDeviceQueue(device_, transferFamilyIndex_, 0, &transferQueue_);
 }
 
 Device::~Device()
 {
+	samplerCache_.reset();
+	shaderCache_.reset();
+	allocator_.reset();
+
 	if (device_ != nullptr)
 	{
 		vkDestroyDevice(device_, nullptr);
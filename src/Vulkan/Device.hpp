@@ -2,10 +2,15 @@
 
 #include "DebugUtils.hpp"
 #include "Vulkan.hpp"
+#include <memory>
 #include <vector>
 
 namespace Vulkan
 {
+	class Instance;
+	class MemoryAllocator;
+	class SamplerCache;
+	class ShaderCache;
 	class Surface;
 
 	class Device final
@@ -16,7 +21,8 @@ namespace Vulkan
 
 		Device(
 			VkPhysicalDevice physicalDevice, 
-			const Surface& surface, 
+			const Instance& instance,
+			const Surface* surface, 
 			const std::vector<const char*>& requiredExtensionsconst,
 			const VkPhysicalDeviceFeatures& deviceFeatures,
 			const void* nextDeviceFeatures);
@@ -24,19 +30,26 @@ namespace Vulkan
 		~Device();
 
 		VkPhysicalDevice PhysicalDevice() const { return physicalDevice_; }
-		const class Surface& Surface() const { return surface_; }
+		const class Instance& Instance() const { return instance_; }
+		const class Surface& Surface() const { return *surface_; }
 
 		const class DebugUtils& DebugUtils() const { return debugUtils_; }
+		class MemoryAllocator& Allocator() const { return *allocator_; }
+		class ShaderCache& Shaders() const { return *shaderCache_; }
+		class SamplerCache& Samplers() const { return *samplerCache_; }
 
 		uint32_t GraphicsFamilyIndex() const { return graphicsFamilyIndex_; }
 		uint32_t ComputeFamilyIndex() const { return computeFamilyIndex_; }
 		uint32_t PresentFamilyIndex() const { return presentFamilyIndex_; }
-		//uint32_t TransferFamilyIndex() const { return transferFamilyIndex_; }
+		uint32_t TransferFamilyIndex() const { return transferFamilyIndex_; }
 		
 		VkQueue GraphicsQueue() const { return graphicsQueue_; }
 		VkQueue ComputeQueue() const { return computeQueue_; }
 		VkQueue PresentQueue() const { return presentQueue_; }
-		//VkQueue TransferQueue() const { return transferQueue_; }
+		VkQueue TransferQueue() const { return transferQueue_; }
+
+		// Without a suitable dedicated transfer family, the transfer queue is the graphics queue.
+		bool HasDedicatedTransferQueue() const { return transferFamilyIndex_ != graphicsFamilyIndex_; }
 
 		void WaitIdle() const;
 
@@ -45,21 +58,25 @@ namespace Vulkan
 		void CheckRequiredExtensions(VkPhysicalDevice physicalDevice, const std::vector<const char*>& requiredExtensions) const;
 
 		const VkPhysicalDevice physicalDevice_;
-		const class Surface& surface_;
+		const class Instance& instance_;
+		const class Surface* const surface_;
 
 		VULKAN_HANDLE(VkDevice, device_)
 
 		class DebugUtils debugUtils_;
+		std::unique_ptr<class MemoryAllocator> allocator_;
+		std::unique_ptr<class ShaderCache> shaderCache_;
+		std::unique_ptr<class SamplerCache> samplerCache_;
 
 		uint32_t graphicsFamilyIndex_ {};
 		uint32_t computeFamilyIndex_{};
 		uint32_t presentFamilyIndex_{};
-		//uint32_t transferFamilyIndex_{};
+		uint32_t transferFamilyIndex_{};
 
 		VkQueue graphicsQueue_{};
 		VkQueue computeQueue_{};
 		VkQueue presentQueue_{};
-		//VkQueue transferQueue_{};
+		VkQueue transferQueue_{};
 	};
 
 }
@@ -6,29 +6,18 @@ namespace Vulkan {
 
 DeviceMemory::DeviceMemory(
 	const class Device& device, 
-	const size_t size, 
-	const uint32_t memoryTypeBits,
+	const VkMemoryRequirements& requirements,
 	const VkMemoryAllocateFlags allocateFLags,
 	const VkMemoryPropertyFlags propertyFlags) :
-	device_(device)
+	device_(device),
+	allocation_(device.Allocator().Allocate(requirements, allocateFLags, propertyFlags)),
+	memory_(allocation_.Memory)
 {
-	VkMemoryAllocateFlagsInfo flagsInfo = {};
-	flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
-	flagsInfo.pNext = nullptr;
-	flagsInfo.flags = allocateFLags;
-	
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.pNext = &flagsInfo;
-	allocInfo.allocationSize = size;
-	allocInfo.memoryTypeIndex = FindMemoryType(memoryTypeBits, propertyFlags);
-
-	Check(vkAllocateMemory(device.Handle(), &allocInfo, nullptr, &memory_),
-		"allocate memory");
 }
 
 DeviceMemory::DeviceMemory(DeviceMemory&& other) noexcept :
 	device_(other.device_),
+	allocation_(other.allocation_),
 	memory_(other.memory_)
 {
 	other.memory_ = nullptr;
@@ -38,39 +27,25 @@ DeviceMemory::~DeviceMemory()
 {
 	if (memory_ != nullptr)
 	{
-		vkFreeMemory(device_.Handle(), memory_, nullptr);
+		device_.Allocator().Free(allocation_);
 		memory_ = nullptr;
 	}
 }
 
 void* DeviceMemory::Map(const size_t offset, const size_t size)
 {
-	void* data;
-	Check(vkMapMemory(device_.Handle(), memory_, offset, size, 0, &data),
-		"map memory");
-
-	return data;
+	// The whole block is mapped, the size is implied.
+	return static_cast<uint8_t*>(device_.Allocator().Map(allocation_)) + offset;
 }
 
 void DeviceMemory::Unmap()
 {
-	vkUnmapMemory(device_.Handle(), memory_);
+	device_.Allocator().Unmap(allocation_);
 }
 
-uint32_t DeviceMemory::FindMemoryType(const uint32_t typeFilter, const VkMemoryPropertyFlags propertyFlags) const
+void DeviceMemory::SetOwner(const uint64_t owner)
 {
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(device_.PhysicalDevice(), &memProperties);
-
-	for (uint32_t i = 0; i != memProperties.memoryTypeCount; ++i)
-	{
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & propertyFlags) == propertyFlags)
-		{
-			return i;
-		}
-	}
-
-	Throw(std::runtime_error("failed to find suitable memory type"));
+	device_.Allocator().SetOwner(allocation_, owner);
 }
 
 }
@@ -1,11 +1,14 @@
 #pragma once
 
+#include "MemoryAllocator.hpp"
 #include "Vulkan.hpp"
 
 namespace Vulkan
 {
 	class Device;
 
+	// A range of device memory sub-allocated from the device MemoryAllocator.
+	// Resources must be bound at Offset() within the Handle() memory.
 	class DeviceMemory final
 	{
 	public:
@@ -14,21 +17,25 @@ namespace Vulkan
 		DeviceMemory& operator = (const DeviceMemory&) = delete;
 		DeviceMemory& operator = (DeviceMemory&&) = delete;
 
-		DeviceMemory(const Device& device, size_t size, uint32_t memoryTypeBits, VkMemoryAllocateFlags allocateFLags, VkMemoryPropertyFlags propertyFlags);
+		DeviceMemory(const Device& device, const VkMemoryRequirements& requirements, VkMemoryAllocateFlags allocateFLags, VkMemoryPropertyFlags propertyFlags);
 		DeviceMemory(DeviceMemory&& other) noexcept;
 		~DeviceMemory();
 
 		const class Device& Device() const { return device_; }
+		VkDeviceSize Offset() const { return allocation_.Offset; }
 
 		void* Map(size_t offset, size_t size);
 		void Unmap();
 
-	private:
+		// The buffer or image bound to the memory, see MemoryAllocator::SetOwner().
+		void SetOwner(uint64_t owner);
 
-		uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	private:
 
 		const class Device& device_;
 
+		MemoryAllocator::Allocation allocation_{};
+
 		VULKAN_HANDLE(VkDeviceMemory, memory_)
 	};
 
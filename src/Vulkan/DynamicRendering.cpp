@@ -0,0 +1,144 @@
+#include "DynamicRendering.hpp"
+#include "DepthBuffer.hpp"
+#include "Device.hpp"
+#include "Image.hpp"
+#include "ImageView.hpp"
+#include "Utilities/Exception.hpp"
+#include <string>
+
+namespace Vulkan {
+
+namespace
+{
+	template <class Func>
+	Func GetProcedure(const Device& device, const char* const name)
+	{
+		const auto func = reinterpret_cast<Func>(vkGetDeviceProcAddr(device.Handle(), name));
+		if (func == nullptr)
+		{
+			Throw(std::runtime_error(std::string("failed to get address of '") + name + "'"));
+		}
+
+		return func;
+	}
+
+	VkImageMemoryBarrier ImageBarrier(
+		const VkImage image,
+		const VkImageAspectFlags aspectMask,
+		const VkAccessFlags srcAccessMask,
+		const VkAccessFlags dstAccessMask,
+		const VkImageLayout oldLayout,
+		const VkImageLayout newLayout)
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccessMask;
+		barrier.dstAccessMask = dstAccessMask;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { aspectMask, 0, 1, 0, 1 };
+
+		return barrier;
+	}
+}
+
+DynamicRendering::DynamicRendering(const class Device& device) :
+	device_(device),
+	vkCmdBeginRenderingKHR(GetProcedure<PFN_vkCmdBeginRenderingKHR>(device, "vkCmdBeginRenderingKHR")),
+	vkCmdEndRenderingKHR(GetProcedure<PFN_vkCmdEndRenderingKHR>(device, "vkCmdEndRenderingKHR"))
+{
+}
+
+void DynamicRendering::Begin(
+	const VkCommandBuffer commandBuffer,
+	const VkImage image,
+	const VkImageView imageView,
+	const class DepthBuffer* const depthBuffer,
+	const VkRect2D& renderArea,
+	const VkAttachmentLoadOp colorLoadOp) const
+{
+	const bool isLoaded = colorLoadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+
+	// A cleared image only has to wait for its acquisition, which the frame submission does at the color output stage.
+	// A loaded one was last written by anything earlier in the frame (a blit, a compute pass), so wait for all of it.
+	VkPipelineStageFlags srcStages = isLoaded ? VK_PIPELINE_STAGE_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+	VkImageMemoryBarrier barriers[2];
+	uint32_t barrierCount = 0;
+
+	barriers[barrierCount++] = ImageBarrier(
+		image, VK_IMAGE_ASPECT_COLOR_BIT,
+		isLoaded ? VK_ACCESS_MEMORY_WRITE_BIT : 0,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (isLoaded ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0),
+		isLoaded ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+	VkRenderingAttachmentInfoKHR colorAttachment = {};
+	colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+	colorAttachment.imageView = imageView;
+	colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+	colorAttachment.loadOp = colorLoadOp;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.clearValue.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+
+	// The depth buffer content is never kept from one pass to the next, only its stencil aspect is left unused.
+	VkRenderingAttachmentInfoKHR depthAttachment = {};
+	depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+
+	if (depthBuffer != nullptr)
+	{
+		const VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT |
+			(DepthBuffer::HasStencilComponent(depthBuffer->Format()) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+
+		barriers[barrierCount++] = ImageBarrier(
+			depthBuffer->Image().Handle(), aspectMask,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+		const VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		srcStages |= depthStages;
+		dstStages |= depthStages;
+
+		depthAttachment.imageView = depthBuffer->ImageView().Handle();
+		depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, barrierCount, barriers);
+
+	VkRenderingInfoKHR renderingInfo = {};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+	renderingInfo.renderArea = renderArea;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colorAttachment;
+	renderingInfo.pDepthAttachment = depthBuffer != nullptr ? &depthAttachment : nullptr;
+
+	vkCmdBeginRenderingKHR(commandBuffer, &renderingInfo);
+}
+
+void DynamicRendering::End(const VkCommandBuffer commandBuffer, const VkImage image) const
+{
+	vkCmdEndRenderingKHR(commandBuffer);
+
+	// Presentation waits on the render finished semaphore, which covers all the commands of the frame.
+	const auto barrier = ImageBarrier(
+		image, VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+}
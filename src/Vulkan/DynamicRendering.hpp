@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Vulkan.hpp"
+
+namespace Vulkan
+{
+	class DepthBuffer;
+	class Device;
+
+	// Draws straight into the swap chain image views with VK_KHR_dynamic_rendering, without any render pass nor framebuffer objects
+	// to recreate along with the swap chain. The layout transitions the render passes did are recorded explicitly: the swap chain image
+	// is in the present layout before Begin() (or undefined when cleared) and back in it after End().
+	class DynamicRendering final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(DynamicRendering)
+
+		explicit DynamicRendering(const Device& device);
+		~DynamicRendering() = default;
+
+		const class Device& Device() const { return device_; }
+
+		// Without a depth buffer, there is no depth attachment. Otherwise it is cleared, as the color one is unless loaded.
+		void Begin(
+			VkCommandBuffer commandBuffer,
+			VkImage image,
+			VkImageView imageView,
+			const class DepthBuffer* depthBuffer,
+			const VkRect2D& renderArea,
+			VkAttachmentLoadOp colorLoadOp) const;
+
+		void End(VkCommandBuffer commandBuffer, VkImage image) const;
+
+	private:
+
+		const class Device& device_;
+		const PFN_vkCmdBeginRenderingKHR vkCmdBeginRenderingKHR;
+		const PFN_vkCmdEndRenderingKHR vkCmdEndRenderingKHR;
+	};
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Vulkan
+{
+	// A SPIR-V module compiled into the executable by the assets build (see assets/CMakeLists.txt).
+	struct EmbeddedShader final
+	{
+		const char* Name; // The .spv file name, e.g. "RayTracing.rgen.spv".
+		const uint32_t* Code;
+		size_t Size; // bytes
+	};
+
+	// Nullptr if no such shader has been embedded.
+	const EmbeddedShader* FindEmbeddedShader(const std::string& name);
+}
@@ -30,6 +30,18 @@ Fence::~Fence()
 	}
 }
 
+bool Fence::IsSignaled() const
+{
+	const auto result = vkGetFenceStatus(device_.Handle(), fence_);
+
+	if (result != VK_NOT_READY)
+	{
+		Check(result, "get fence status");
+	}
+
+	return result == VK_SUCCESS;
+}
+
 void Fence::Reset()
 {
 	Check(vkResetFences(device_.Handle(), 1, &fence_),
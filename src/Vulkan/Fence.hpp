@@ -21,6 +21,7 @@ namespace Vulkan
 		const class Device& Device() const { return device_; }
 		const VkFence& Handle() const { return fence_; }
 
+		bool IsSignaled() const;
 		void Reset();
 		void Wait(uint64_t timeout) const;
 
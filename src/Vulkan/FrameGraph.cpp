@@ -0,0 +1,87 @@
+#include "FrameGraph.hpp"
+
+namespace Vulkan {
+
+namespace
+{
+	constexpr VkAccessFlags WriteAccessMask =
+		VK_ACCESS_SHADER_WRITE_BIT |
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_TRANSFER_WRITE_BIT |
+		VK_ACCESS_HOST_WRITE_BIT |
+		VK_ACCESS_MEMORY_WRITE_BIT;
+}
+
+void FrameGraph::Use(VkCommandBuffer commandBuffer, const std::vector<ImageUse>& uses)
+{
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+
+	barriers_.clear();
+
+	for (const auto& use : uses)
+	{
+		auto& state = states_[use.Image];
+
+		const bool writes = (use.Access & WriteAccessMask) != 0;
+		const bool isTransition = use.Layout != state.Layout;
+
+		// The last write has to be available to this use, unless it already is to its stages, and to any other write.
+		const bool isReadAfterWrite = state.WriteAccess != 0 &&
+			(writes || (use.Stages & ~state.VisibleStages) != 0 || (use.Access & ~state.VisibleAccess) != 0);
+
+		// A write only waits for the reads before it.
+		const bool isWriteAfterRead = writes && state.ReadStages != 0;
+
+		if (isTransition || isReadAfterWrite || isWriteAfterRead)
+		{
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = state.WriteAccess;
+			barrier.dstAccessMask = use.Access;
+			barrier.oldLayout = use.Discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.Layout;
+			barrier.newLayout = use.Layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = use.Image;
+			barrier.subresourceRange = use.Range;
+
+			barriers_.push_back(barrier);
+			srcStages |= state.WriteStages | state.ReadStages;
+			dstStages |= use.Stages;
+
+			state.ReadStages = 0;
+			state.VisibleStages = use.Stages;
+			state.VisibleAccess = use.Access;
+		}
+
+		if (writes)
+		{
+			state.WriteStages = use.Stages;
+			state.WriteAccess = use.Access & WriteAccessMask;
+			state.ReadStages = 0;
+			state.VisibleStages = 0;
+			state.VisibleAccess = 0;
+		}
+		else
+		{
+			state.ReadStages |= use.Stages;
+		}
+
+		state.Layout = use.Layout;
+	}
+
+	if (barriers_.empty())
+	{
+		return;
+	}
+
+	// Images never used before only wait for whatever the queue submission waits on, e.g. the acquisition of a swap chain image.
+	vkCmdPipelineBarrier(commandBuffer,
+		srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		dstStages != 0 ? dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers_.size()), barriers_.data());
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace Vulkan
+{
+	// The layouts and last accesses of the images a frame goes through, from which the barriers between its passes are derived.
+	// Each pass declares the images it uses before recording its commands, and gets a single pipeline barrier holding the layout
+	// transitions and the hazards of all of them (read after write, write after write, write after read), nothing if there is none.
+	// The states carry over to the next frames, so that the images keep their content, e.g. the accumulation, and only the ones a pass
+	// discards (an acquired swap chain image, a transient one) start again from the undefined layout.
+	// Only the images are tracked, the buffers keep their hand written barriers. There is one graph per queue, see Acquire().
+	class FrameGraph final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(FrameGraph)
+
+		struct ImageUse final
+		{
+			VkImage Image;
+			VkImageSubresourceRange Range;
+			VkPipelineStageFlags Stages;
+			VkAccessFlags Access;
+			VkImageLayout Layout;
+			bool Discard; // Whatever the image holds is not needed by the pass.
+		};
+
+		FrameGraph() = default;
+		~FrameGraph() = default;
+
+		// Records the barrier needed before a pass using these images.
+		void Use(VkCommandBuffer commandBuffer, const std::vector<ImageUse>& uses);
+
+		// The image has been used by another queue since, which left it in this layout. The semaphore between the two submissions
+		// synchronizes those accesses, the next use only waits for what this queue does next.
+		void Acquire(VkImage image, VkImageLayout layout) { states_[image] = State{ layout }; }
+
+		// Once the images are recreated, an image handle may then be reused.
+		void Reset() { states_.clear(); }
+
+	private:
+
+		struct State final
+		{
+			VkImageLayout Layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+			VkPipelineStageFlags WriteStages{}; // Of the last write.
+			VkAccessFlags WriteAccess{};
+			VkPipelineStageFlags ReadStages{}; // Since the last write or barrier.
+			VkPipelineStageFlags VisibleStages{}; // Those the last write has been made visible to.
+			VkAccessFlags VisibleAccess{};
+		};
+
+		std::unordered_map<VkImage, State> states_;
+		std::vector<VkImageMemoryBarrier> barriers_;
+	};
+
+}
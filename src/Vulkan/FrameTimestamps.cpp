@@ -0,0 +1,90 @@
+#include "FrameTimestamps.hpp"
+#include "Device.hpp"
+#include "QueryPool.hpp"
+#include "Utilities/Exception.hpp"
+
+namespace Vulkan {
+
+FrameTimestamps::FrameTimestamps(const class Device& device, const uint32_t framesInFlight, const uint32_t passCount) :
+	passCount_(passCount),
+	written_(framesInFlight),
+	results_(passCount, -1.0),
+	begins_(passCount),
+	ends_(passCount)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device.PhysicalDevice(), &properties);
+
+	// Without timestamps on every graphics and compute queue, stay disabled rather than checking each queue family.
+	if (!properties.limits.timestampComputeAndGraphics)
+	{
+		return;
+	}
+
+	timestampPeriod_ = properties.limits.timestampPeriod;
+	queryPool_.reset(new QueryPool(device, VK_QUERY_TYPE_TIMESTAMP, framesInFlight * passCount * 2));
+}
+
+FrameTimestamps::~FrameTimestamps()
+{
+	queryPool_.reset();
+}
+
+void FrameTimestamps::BeginFrame(VkCommandBuffer commandBuffer, const uint32_t frameIndex)
+{
+	if (!queryPool_)
+	{
+		return;
+	}
+
+	frameIndex_ = frameIndex;
+
+	// The frame fence has been waited on, the results are either available or the pass was not recorded in that frame.
+	if (written_[frameIndex_])
+	{
+		const auto queryCount = passCount_ * 2;
+		std::vector<uint64_t> values(queryCount * 2);
+
+		const auto result = vkGetQueryPoolResults(
+			queryPool_->Device().Handle(), queryPool_->Handle(), FirstQuery(0), queryCount,
+			values.size() * sizeof(uint64_t), values.data(), 2 * sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		if (result != VK_NOT_READY)
+		{
+			Check(result, "get timestamp query results");
+		}
+
+		for (uint32_t pass = 0; pass != passCount_; ++pass)
+		{
+			const auto* const begin = &values[pass * 4];
+			const auto* const end = &values[pass * 4 + 2];
+			const bool available = begin[1] != 0 && end[1] != 0;
+
+			results_[pass] = available ? static_cast<double>(end[0] - begin[0]) * timestampPeriod_ / 1000000.0 : -1.0;
+			begins_[pass] = static_cast<double>(begin[0]) * timestampPeriod_ / 1000000.0;
+			ends_[pass] = static_cast<double>(end[0]) * timestampPeriod_ / 1000000.0;
+		}
+	}
+
+	queryPool_->Reset(commandBuffer, FirstQuery(0), passCount_ * 2);
+	written_[frameIndex_] = true;
+}
+
+void FrameTimestamps::BeginPass(VkCommandBuffer commandBuffer, const uint32_t pass)
+{
+	if (queryPool_)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool_->Handle(), FirstQuery(pass));
+	}
+}
+
+void FrameTimestamps::EndPass(VkCommandBuffer commandBuffer, const uint32_t pass)
+{
+	if (queryPool_)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool_->Handle(), FirstQuery(pass) + 1);
+	}
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <memory>
+#include <vector>
+
+namespace Vulkan
+{
+	class Device;
+	class QueryPool;
+
+	// GPU timestamps written around a fixed number of passes, one set of queries per frame in flight.
+	// The results of a frame are read back the next time its slot is recorded, i.e. once its fence has been waited on.
+	class FrameTimestamps final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(FrameTimestamps)
+
+		FrameTimestamps(const Device& device, uint32_t framesInFlight, uint32_t passCount);
+		~FrameTimestamps();
+
+		// Whether the graphics queue supports timestamps, all the calls are no-ops otherwise.
+		bool IsSupported() const { return static_cast<bool>(queryPool_); }
+
+		// Reads back the previous results of the frame slot and resets its queries.
+		void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+		void BeginPass(VkCommandBuffer commandBuffer, uint32_t pass);
+		void EndPass(VkCommandBuffer commandBuffer, uint32_t pass);
+
+		// Whether the last read back results of the pass are available.
+		bool HasResult(uint32_t pass) const { return results_[pass] >= 0; }
+
+		// The GPU time of the pass (in milliseconds) in the last read back frame, negative if it has not been measured.
+		double Milliseconds(uint32_t pass) const { return results_[pass]; }
+
+		// When the pass started and ended in the last read back frame, in milliseconds of the device clock shared by all its queues.
+		// Only meaningful when HasResult(), e.g. to compare with the passes of another queue.
+		double BeginTime(uint32_t pass) const { return begins_[pass]; }
+		double EndTime(uint32_t pass) const { return ends_[pass]; }
+
+	private:
+
+		uint32_t FirstQuery(uint32_t pass) const { return (frameIndex_ * passCount_ + pass) * 2; }
+
+		const uint32_t passCount_;
+		double timestampPeriod_{};
+
+		std::unique_ptr<QueryPool> queryPool_;
+		std::vector<bool> written_;
+		std::vector<double> results_;
+		std::vector<double> begins_;
+		std::vector<double> ends_;
+		uint32_t frameIndex_{};
+	};
+
+}
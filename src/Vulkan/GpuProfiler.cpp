@@ -0,0 +1,28 @@
+#include "GpuProfiler.hpp"
+#include "CommandBuffers.hpp"
+#include "CommandPool.hpp"
+#include "Device.hpp"
+#include "Utilities/Profiler.hpp"
+
+namespace Vulkan {
+
+GpuProfiler::GpuProfiler(const Device& device, CommandPool& commandPool)
+{
+#ifdef RAYTRACER_TRACY
+	// The context calibrates its clock with a submission of its own, the command buffer is only needed until then.
+	CommandBuffers commandBuffers(commandPool, 1);
+	context_ = TracyVkContext(device.PhysicalDevice(), device.Handle(), device.GraphicsQueue(), commandBuffers[0]);
+#else
+	(void)device;
+	(void)commandPool;
+#endif
+}
+
+GpuProfiler::~GpuProfiler()
+{
+#ifdef RAYTRACER_TRACY
+	TracyVkDestroy(context_);
+#endif
+}
+
+}
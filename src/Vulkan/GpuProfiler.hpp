@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Vulkan.hpp"
+
+#ifdef RAYTRACER_TRACY
+namespace tracy
+{
+	class VkCtx;
+}
+#endif
+
+namespace Vulkan
+{
+	class CommandPool;
+	class Device;
+
+	// The Tracy GPU context of the graphics queue, whose timestamps the PROFILE_GPU_ZONE() scopes write (see Utilities/Profiler.hpp).
+	// Without the TRACY CMake option it is an empty object.
+	class GpuProfiler final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(GpuProfiler)
+
+		GpuProfiler(const Device& device, CommandPool& commandPool);
+		~GpuProfiler();
+
+#ifdef RAYTRACER_TRACY
+		tracy::VkCtx* Context() const { return context_; }
+
+	private:
+
+		tracy::VkCtx* context_{};
+#endif
+	};
+
+}
@@ -4,35 +4,35 @@
 #include "DescriptorPool.hpp"
 #include "DescriptorSets.hpp"
 #include "Device.hpp"
+#include "PipelineCache.hpp"
 #include "PipelineLayout.hpp"
 #include "RenderPass.hpp"
+#include "ShaderCache.hpp"
 #include "ShaderModule.hpp"
 #include "SwapChain.hpp"
 #include "Assets/Scene.hpp"
 #include "Assets/UniformBuffer.hpp"
-#include "Assets/Vertex.hpp"
 
 namespace Vulkan {
 
 GraphicsPipeline::GraphicsPipeline(
 	const SwapChain& swapChain, 
+	const PipelineCache& pipelineCache,
 	const DepthBuffer& depthBuffer,
 	const std::vector<Assets::UniformBuffer>& uniformBuffers,
 	const Assets::Scene& scene,
-	const bool isWireFrame) :
+	const bool isWireFrame,
+	const bool dynamicRendering) :
 	swapChain_(swapChain),
 	isWireFrame_(isWireFrame)
 {
 	const auto& device = swapChain.Device();
-	const auto bindingDescription = Assets::Vertex::GetBindingDescription();
-	const auto attributeDescriptions = Assets::Vertex::GetAttributeDescriptions();
 
+	// The vertex shader pulls the vertices through the instance device addresses, in either layout (see Vertex.glsl).
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+	vertexInputInfo.vertexBindingDescriptionCount = 0;
+	vertexInputInfo.vertexAttributeDescriptionCount = 0;
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -118,14 +118,18 @@ GraphicsPipeline::GraphicsPipeline(
 	{
 		{0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
 		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT},
-		{2, static_cast<uint32_t>(scene.TextureSamplers().size()), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
+		{2, static_cast<uint32_t>(scene.TextureImageInfos().size()), VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT},
+		{3, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
+		{4, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
+		{5, 1, VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
 	};
 
 	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, uniformBuffers.size()));
+	textureArrays_.resize(uniformBuffers.size());
 
 	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
 
-	for (uint32_t i = 0; i != swapChain.Images().size(); ++i)
+	for (uint32_t i = 0; i != uniformBuffers.size(); ++i)
 	{
 		// Uniform buffer
 		VkDescriptorBufferInfo uniformBufferInfo = {};
@@ -137,44 +141,68 @@ GraphicsPipeline::GraphicsPipeline(
 		materialBufferInfo.buffer = scene.MaterialBuffer().Handle();
 		materialBufferInfo.range = VK_WHOLE_SIZE;
 
-		// Image and texture samplers
-		std::vector<VkDescriptorImageInfo> imageInfos(scene.TextureSamplers().size());
+		// Instance buffer
+		VkDescriptorBufferInfo instanceBufferInfo = {};
+		instanceBufferInfo.buffer = scene.InstanceBuffer().Handle();
+		instanceBufferInfo.range = VK_WHOLE_SIZE;
 
-		for (size_t t = 0; t != imageInfos.size(); ++t)
-		{
-			auto& imageInfo = imageInfos[t];
-			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageInfo.imageView = scene.TextureImageViews()[t];
-			imageInfo.sampler = scene.TextureSamplers()[t];
-		}
+		// Procedural buffer, the spheres drawn from the shared mesh.
+		VkDescriptorBufferInfo proceduralBufferInfo = {};
+		proceduralBufferInfo.buffer = scene.ProceduralBuffer().Handle();
+		proceduralBufferInfo.range = VK_WHOLE_SIZE;
+
+		// The sampler shared by the texture images, which are written on their own below.
+		VkDescriptorImageInfo samplerInfo = {};
+		samplerInfo.sampler = scene.TextureSampler();
 
 		const std::vector<VkWriteDescriptorSet> descriptorWrites =
 		{
 			descriptorSets.Bind(i, 0, uniformBufferInfo),
 			descriptorSets.Bind(i, 1, materialBufferInfo),
-			descriptorSets.Bind(i, 2, *imageInfos.data(), static_cast<uint32_t>(imageInfos.size()))
+			descriptorSets.Bind(i, 3, instanceBufferInfo),
+			descriptorSets.Bind(i, 4, proceduralBufferInfo),
+			descriptorSets.Bind(i, 5, samplerInfo)
 		};
 
 		descriptorSets.UpdateDescriptors(i, descriptorWrites);
+		descriptorSets.UpdateImageArray(i, 2, scene.TextureImageInfos(), scene.TextureGeneration(), textureArrays_[i]);
 	}
 
-	// Create pipeline layout and render pass.
+	// Create pipeline layout and render pass, dynamic rendering only needs the attachment formats.
 	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout()));
-	renderPass_.reset(new class RenderPass(swapChain, depthBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_LOAD_OP_CLEAR));
+
+	const VkFormat colorFormat = swapChain.Format();
+
+	VkPipelineRenderingCreateInfoKHR renderingInfo = {};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &colorFormat;
+	renderingInfo.depthAttachmentFormat = depthBuffer.Format();
+
+	if (!dynamicRendering)
+	{
+		renderPass_.reset(new class RenderPass(swapChain, depthBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_LOAD_OP_CLEAR));
+	}
 
 	// Load shaders.
-	const ShaderModule vertShader(device, "../assets/shaders/Graphics.vert.spv");
-	const ShaderModule fragShader(device, "../assets/shaders/Graphics.frag.spv");
+	const auto& vertShader = device.Shaders().Get("Graphics.vert.spv");
+	const auto& fragShader = device.Shaders().Get("Graphics.frag.spv");
+
+	// Select the vertex layout of the scene.
+	const VkBool32 compactVertices = scene.CompactVertices();
+	const VkSpecializationMapEntry specializationEntry = { 0, 0, sizeof(VkBool32) };
+	const VkSpecializationInfo specializationInfo = { 1, &specializationEntry, sizeof(compactVertices), &compactVertices };
 
 	VkPipelineShaderStageCreateInfo shaderStages[] =
 	{
-		vertShader.CreateShaderStage(VK_SHADER_STAGE_VERTEX_BIT),
+		vertShader.CreateShaderStage(VK_SHADER_STAGE_VERTEX_BIT, &specializationInfo),
 		fragShader.CreateShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT)
 	};
 
 	// Create graphic pipeline
 	VkGraphicsPipelineCreateInfo pipelineInfo = {};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = dynamicRendering ? &renderingInfo : nullptr;
 	pipelineInfo.stageCount = 2;
 	pipelineInfo.pStages = shaderStages;
 	pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -188,10 +216,10 @@ GraphicsPipeline::GraphicsPipeline(
 	pipelineInfo.basePipelineHandle = nullptr; // Optional
 	pipelineInfo.basePipelineIndex = -1; // Optional
 	pipelineInfo.layout = pipelineLayout_->Handle();
-	pipelineInfo.renderPass = renderPass_->Handle();
+	pipelineInfo.renderPass = renderPass_ ? renderPass_->Handle() : nullptr;
 	pipelineInfo.subpass = 0;
 
-	Check(vkCreateGraphicsPipelines(device.Handle(), nullptr, 1, &pipelineInfo, nullptr, &pipeline_),
+	Check(vkCreateGraphicsPipelines(device.Handle(), pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipeline_),
 		"create graphics pipeline");
 }
 
@@ -213,4 +241,9 @@ VkDescriptorSet GraphicsPipeline::DescriptorSet(const uint32_t index) const
 	return descriptorSetManager_->DescriptorSets().Handle(index);
 }
 
+void GraphicsPipeline::UpdateTextures(const uint32_t index, const Assets::Scene& scene)
+{
+	descriptorSetManager_->DescriptorSets().UpdateImageArray(index, 2, scene.TextureImageInfos(), scene.TextureGeneration(), textureArrays_[index]);
+}
+
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vulkan.hpp"
+#include "DescriptorSets.hpp"
 #include <memory>
 #include <vector>
 
@@ -13,6 +14,7 @@ namespace Assets
 namespace Vulkan
 {
 	class DepthBuffer;
+	class PipelineCache;
 	class PipelineLayout;
 	class RenderPass;
 	class SwapChain;
@@ -25,16 +27,22 @@ namespace Vulkan
 
 		GraphicsPipeline(
 			const SwapChain& swapChain, 
+			const PipelineCache& pipelineCache,
 			const DepthBuffer& depthBuffer,
 			const std::vector<Assets::UniformBuffer>& uniformBuffers,
 			const Assets::Scene& scene,
-			bool isWireFrame);
+			bool isWireFrame,
+			bool dynamicRendering);
 		~GraphicsPipeline();
 
 		VkDescriptorSet DescriptorSet(uint32_t index) const;
+
+		// Rebinds the scene textures of a descriptor set no frame in flight is using, if they have been streamed since it was last written.
+		void UpdateTextures(uint32_t index, const Assets::Scene& scene);
+
 		bool IsWireFrame() const { return isWireFrame_; }
 		const class PipelineLayout& PipelineLayout() const { return *pipelineLayout_; }
-		const class RenderPass& RenderPass() const { return *renderPass_; }
+		const class RenderPass& RenderPass() const { return *renderPass_; } // There is none with dynamic rendering.
 
 	private:
 
@@ -46,6 +54,7 @@ namespace Vulkan
 		std::unique_ptr<class DescriptorSetManager> descriptorSetManager_;
 		std::unique_ptr<class PipelineLayout> pipelineLayout_;
 		std::unique_ptr<class RenderPass> renderPass_;
+		std::vector<DescriptorSets::WrittenImageArray> textureArrays_; // The scene textures last written to each descriptor set.
 	};
 
 }
@@ -4,6 +4,8 @@
 #include "Device.hpp"
 #include "SingleTimeCommands.hpp"
 #include "Utilities/Exception.hpp"
+#include <algorithm>
+#include <vector>
 
 namespace Vulkan {
 
@@ -18,8 +20,34 @@ Image::Image(
 	const VkFormat format,
 	const VkImageTiling tiling,
 	const VkImageUsageFlags usage) :
+	Image(device, extent, 1, format, tiling, usage)
+{
+}
+
+Image::Image(
+	const class Device& device, 
+	const VkExtent2D extent,
+	const uint32_t mipLevels,
+	const VkFormat format,
+	const VkImageTiling tiling,
+	const VkImageUsageFlags usage) :
+	Image(device, extent, mipLevels, 1, format, tiling, usage)
+{
+}
+
+Image::Image(
+	const class Device& device, 
+	const VkExtent2D extent,
+	const uint32_t mipLevels,
+	const uint32_t arrayLayers,
+	const VkFormat format,
+	const VkImageTiling tiling,
+	const VkImageUsageFlags usage,
+	const bool concurrent) :
 	device_(device),
 	extent_(extent),
+	mipLevels_(mipLevels),
+	arrayLayers_(arrayLayers),
 	format_(format),
 	imageLayout_(VK_IMAGE_LAYOUT_UNDEFINED)
 {
@@ -29,8 +57,8 @@ Image::Image(
 	imageInfo.extent.width = extent.width;
 	imageInfo.extent.height = extent.height;
 	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
-	imageInfo.arrayLayers = 1;
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = arrayLayers;
 	imageInfo.format = format;
 	imageInfo.tiling = tiling;
 	imageInfo.initialLayout = imageLayout_;
@@ -39,6 +67,15 @@ Image::Image(
 	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 	imageInfo.flags = 0; // Optional
 
+	const uint32_t queueFamilyIndices[] = { device.GraphicsFamilyIndex(), device.ComputeFamilyIndex() };
+
+	if (concurrent && queueFamilyIndices[0] != queueFamilyIndices[1])
+	{
+		imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		imageInfo.queueFamilyIndexCount = 2;
+		imageInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+
 	Check(vkCreateImage(device.Handle(), &imageInfo, nullptr, &image_),
 		"create image");
 }
@@ -46,6 +83,8 @@ Image::Image(
 Image::Image(Image&& other) noexcept :
 	device_(other.device_),
 	extent_(other.extent_),
+	mipLevels_(other.mipLevels_),
+	arrayLayers_(other.arrayLayers_),
 	format_(other.format_),
 	imageLayout_(other.imageLayout_),
 	image_(other.image_)
@@ -65,11 +104,13 @@ Image::~Image()
 DeviceMemory Image::AllocateMemory(const VkMemoryPropertyFlags properties) const
 {
 	const auto requirements = GetMemoryRequirements();
-	DeviceMemory memory(device_, requirements.size, requirements.memoryTypeBits, 0, properties);
+	DeviceMemory memory(device_, requirements, 0, properties);
 
-	Check(vkBindImageMemory(device_.Handle(), image_, memory.Handle(), 0),
+	Check(vkBindImageMemory(device_.Handle(), image_, memory.Handle(), memory.Offset()),
 		"bind image memory");
 
+	memory.SetOwner(reinterpret_cast<const uint64_t&>(image_));
+
 	return memory;
 }
 
@@ -80,91 +121,235 @@ VkMemoryRequirements Image::GetMemoryRequirements() const
 	return requirements;
 }
 
-void Image::TransitionImageLayout(CommandPool& commandPool, VkImageLayout newLayout)
+void Image::TransitionImageLayout(CommandPool& commandPool, const VkImageLayout newLayout)
 {
 	SingleTimeCommands::Submit(commandPool, [&](VkCommandBuffer commandBuffer)
 	{
-		VkImageMemoryBarrier barrier = {};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = imageLayout_;
-		barrier.newLayout = newLayout;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = image_;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-
-		if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) 
-		{
-			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		TransitionImageLayout(commandBuffer, newLayout);
+	});
+}
 
-			if (DepthBuffer::HasStencilComponent(format_)) 
-			{
-				barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-			}
-		}
-		else 
-		{
-			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		}
+void Image::TransitionImageLayout(VkCommandBuffer commandBuffer, const VkImageLayout newLayout)
+{
+	VkPipelineStageFlags sourceStage;
+	VkPipelineStageFlags destinationStage;
 
-		VkPipelineStageFlags sourceStage;
-		VkPipelineStageFlags destinationStage;
+	const auto barrier = LayoutBarrier(newLayout, sourceStage, destinationStage);
 
-		if (imageLayout_ == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) 
-		{
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		}
-		else if (imageLayout_ == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-		{
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	imageLayout_ = newLayout;
+}
 
-			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		}
-		else if (imageLayout_ == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) 
-		{
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+void Image::TransferOwnership(
+	VkCommandBuffer releaseCommandBuffer, const uint32_t srcQueueFamilyIndex,
+	VkCommandBuffer acquireCommandBuffer, const uint32_t dstQueueFamilyIndex,
+	const VkImageLayout newLayout)
+{
+	VkPipelineStageFlags sourceStage;
+	VkPipelineStageFlags destinationStage;
 
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-		}
-		else 
+	auto barrier = LayoutBarrier(newLayout, sourceStage, destinationStage);
+	barrier.srcQueueFamilyIndex = srcQueueFamilyIndex;
+	barrier.dstQueueFamilyIndex = dstQueueFamilyIndex;
+
+	// The release ignores the destination access, the acquire the source one. Both perform the same layout transition.
+	auto release = barrier;
+	release.dstAccessMask = 0;
+
+	auto acquire = barrier;
+	acquire.srcAccessMask = 0;
+
+	vkCmdPipelineBarrier(releaseCommandBuffer, sourceStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &release);
+	vkCmdPipelineBarrier(acquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &acquire);
+
+	imageLayout_ = newLayout;
+}
+
+VkImageMemoryBarrier Image::LayoutBarrier(const VkImageLayout newLayout, VkPipelineStageFlags& sourceStage, VkPipelineStageFlags& destinationStage) const
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = imageLayout_;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image_;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels_;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = arrayLayers_;
+
+	if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) 
+	{
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+		if (DepthBuffer::HasStencilComponent(format_)) 
 		{
-			Throw(std::invalid_argument("unsupported layout transition"));
+			barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
 		}
+	}
+	else 
+	{
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	}
 
-		vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-	});
+	if (imageLayout_ == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) 
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 
-	imageLayout_ = newLayout;
+		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	else if (imageLayout_ == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+	{
+		// Only makes the copies available, e.g. to the mipmaps generation after an ownership transfer.
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	else if (imageLayout_ == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	}
+	else if (imageLayout_ == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+	{
+		// The image may have been sampled by any shader stage of the previous frames.
+		barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		sourceStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	else if (imageLayout_ == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) 
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	}
+	else 
+	{
+		Throw(std::invalid_argument("unsupported layout transition"));
+	}
+
+	return barrier;
 }
 
 void Image::CopyFrom(CommandPool& commandPool, const Buffer& buffer)
 {
 	SingleTimeCommands::Submit(commandPool, [&](VkCommandBuffer commandBuffer)
 	{
-		VkBufferImageCopy region = {};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = 1;
-		region.imageOffset = { 0, 0, 0 };
-		region.imageExtent = { extent_.width, extent_.height, 1 };
-
-		vkCmdCopyBufferToImage(commandBuffer, buffer.Handle(), image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		CopyFrom(commandBuffer, buffer, 0, 0, 0, extent_.height);
 	});
 }
 
+void Image::CopyFrom(VkCommandBuffer commandBuffer, const Buffer& buffer, const VkDeviceSize bufferOffset, const uint32_t mipLevel, const uint32_t firstRow, const uint32_t rowCount)
+{
+	VkBufferImageCopy region = {};
+	region.bufferOffset = bufferOffset;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = mipLevel;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, static_cast<int32_t>(firstRow), 0 };
+	region.imageExtent = { std::max(extent_.width >> mipLevel, 1u), rowCount, 1 };
+
+	vkCmdCopyBufferToImage(commandBuffer, buffer.Handle(), image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+void Image::CopyFrom(VkCommandBuffer commandBuffer, Image& source, const uint32_t sourceMipLevel)
+{
+	if (source.format_ != format_ || sourceMipLevel + mipLevels_ > source.mipLevels_)
+	{
+		Throw(std::invalid_argument("source image levels do not match"));
+	}
+
+	source.TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+	std::vector<VkImageCopy> regions(mipLevels_);
+
+	for (uint32_t level = 0; level != mipLevels_; ++level)
+	{
+		auto& region = regions[level];
+		region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, sourceMipLevel + level, 0, 1 };
+		region.srcOffset = { 0, 0, 0 };
+		region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		region.dstOffset = { 0, 0, 0 };
+		region.extent = { std::max(extent_.width >> level, 1u), std::max(extent_.height >> level, 1u), 1 };
+	}
+
+	vkCmdCopyImage(commandBuffer,
+		source.image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()), regions.data());
+}
+
+void Image::GenerateMipmaps(VkCommandBuffer commandBuffer)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image_;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = arrayLayers_;
+
+	auto width = static_cast<int32_t>(extent_.width);
+	auto height = static_cast<int32_t>(extent_.height);
+
+	for (uint32_t level = 1; level <= mipLevels_; ++level)
+	{
+		// The previous level has been written (copied or blitted), make it the blit source.
+		barrier.subresourceRange.baseMipLevel = level - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		if (level != mipLevels_)
+		{
+			const auto nextWidth = std::max(width / 2, 1);
+			const auto nextHeight = std::max(height / 2, 1);
+
+			VkImageBlit blit = {};
+			blit.srcOffsets[1] = { width, height, 1 };
+			blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+			blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+			blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+
+			vkCmdBlitImage(commandBuffer,
+				image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit, VK_FILTER_LINEAR);
+
+			width = nextWidth;
+			height = nextHeight;
+		}
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	imageLayout_ = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
 }
@@ -19,23 +19,50 @@ namespace Vulkan
 
 		Image(const Device& device, VkExtent2D extent, VkFormat format);
 		Image(const Device& device, VkExtent2D extent, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage);
+		Image(const Device& device, VkExtent2D extent, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage);
+		// A concurrent image is shared by the graphics and compute queue families without ownership transfers.
+		Image(const Device& device, VkExtent2D extent, uint32_t mipLevels, uint32_t arrayLayers, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, bool concurrent = false);
 		Image(Image&& other) noexcept;
 		~Image();
 
 		const class Device& Device() const { return device_; }
 		VkExtent2D Extent() const { return extent_; }
 		VkFormat Format() const { return format_; }
+		uint32_t MipLevels() const { return mipLevels_; }
+		uint32_t ArrayLayers() const { return arrayLayers_; }
 
 		DeviceMemory AllocateMemory(VkMemoryPropertyFlags properties) const;
 		VkMemoryRequirements GetMemoryRequirements() const;
 
 		void TransitionImageLayout(CommandPool& commandPool, VkImageLayout newLayout);
+		void TransitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout newLayout);
+
+		// Layout transition combined with a queue family ownership transfer, the release and acquire halves
+		// are recorded into command buffers of the source and destination families respectively.
+		void TransferOwnership(
+			VkCommandBuffer releaseCommandBuffer, uint32_t srcQueueFamilyIndex,
+			VkCommandBuffer acquireCommandBuffer, uint32_t dstQueueFamilyIndex,
+			VkImageLayout newLayout);
+
 		void CopyFrom(CommandPool& commandPool, const Buffer& buffer);
+		void CopyFrom(VkCommandBuffer commandBuffer, const Buffer& buffer, VkDeviceSize bufferOffset, uint32_t mipLevel, uint32_t firstRow, uint32_t rowCount);
+
+		// Copies every level of this image (in the transfer destination layout) from the source levels starting at sourceMipLevel.
+		// The source, usually being sampled, is left in the transfer source layout.
+		void CopyFrom(VkCommandBuffer commandBuffer, Image& source, uint32_t sourceMipLevel);
+
+		// Fills the mip chain by successive blits from the first level, which must be in the transfer destination layout.
+		// All the levels end up in the shader read only layout.
+		void GenerateMipmaps(VkCommandBuffer commandBuffer);
 
 	private:
 
+		VkImageMemoryBarrier LayoutBarrier(VkImageLayout newLayout, VkPipelineStageFlags& sourceStage, VkPipelineStageFlags& destinationStage) const;
+
 		const class Device& device_;
 		const VkExtent2D extent_;
+		const uint32_t mipLevels_;
+		const uint32_t arrayLayers_;
 		const VkFormat format_;
 		VkImageLayout imageLayout_;
 
@@ -4,6 +4,21 @@
 namespace Vulkan {
 
 ImageView::ImageView(const class Device& device, const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags) :
+	ImageView(device, image, format, aspectFlags, 1)
+{
+}
+
+ImageView::ImageView(const class Device& device, const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const uint32_t mipLevels) :
+	ImageView(device, image, format, aspectFlags, mipLevels, VK_IMAGE_VIEW_TYPE_2D, 1)
+{
+}
+
+ImageView::ImageView(const class Device& device, const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const VkImageViewType viewType, const uint32_t layerCount) :
+	ImageView(device, image, format, aspectFlags, 1, viewType, layerCount)
+{
+}
+
+ImageView::ImageView(const class Device& device, const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const uint32_t mipLevels, const VkImageViewType viewType, const uint32_t layerCount) :
 	device_(device),
 	image_(image),
 	format_(format)
@@ -11,7 +26,7 @@ ImageView::ImageView(const class Device& device, const VkImage image, const VkFo
 	VkImageViewCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	createInfo.image = image;
-	createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	createInfo.viewType = viewType;
 	createInfo.format = format;
 	createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
 	createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -19,9 +34,9 @@ ImageView::ImageView(const class Device& device, const VkImage image, const VkFo
 	createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
 	createInfo.subresourceRange.aspectMask = aspectFlags;
 	createInfo.subresourceRange.baseMipLevel = 0;
-	createInfo.subresourceRange.levelCount = 1;
+	createInfo.subresourceRange.levelCount = mipLevels;
 	createInfo.subresourceRange.baseArrayLayer = 0;
-	createInfo.subresourceRange.layerCount = 1;
+	createInfo.subresourceRange.layerCount = layerCount;
 
 	Check(vkCreateImageView(device_.Handle(), &createInfo, nullptr, &imageView_),
 		"create image view");
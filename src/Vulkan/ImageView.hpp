@@ -13,12 +13,18 @@ namespace Vulkan
 		VULKAN_NON_COPIABLE(ImageView)
 
 		explicit ImageView(const Device& device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+		ImageView(const Device& device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
+
+		// All the layers of an array image, from the first one.
+		ImageView(const Device& device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageViewType viewType, uint32_t layerCount);
 		~ImageView();
 
 		const class Device& Device() const { return device_; }
 
 	private:
 
+		ImageView(const Device& device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, VkImageViewType viewType, uint32_t layerCount);
+
 		const class Device& device_;
 		const VkImage image_;
 		const VkFormat format_;
@@ -8,7 +8,7 @@
 
 namespace Vulkan {
 
-Instance::Instance(const class Window& window, const std::vector<const char*>& validationLayers, uint32_t vulkanVersion) :
+Instance::Instance(const class Window* const window, const std::vector<const char*>& validationLayers, uint32_t vulkanVersion) :
 	window_(window),
 	validationLayers_(validationLayers)
 {
@@ -16,7 +16,7 @@ Instance::Instance(const class Window& window, const std::vector<const char*>& v
 	CheckVulkanMinimumVersion(vulkanVersion);
 
 	// Get the list of required extensions.
-	auto extensions = window.GetRequiredInstanceExtensions();
+	auto extensions = window != nullptr ? window->GetRequiredInstanceExtensions() : std::vector<const char*>();
 
 	// Check the validation layers and add them to the list of required extensions.
 	CheckVulkanValidationLayerSupport(validationLayers);
@@ -0,0 +1,443 @@
+#include "MemoryAllocator.hpp"
+#include "Device.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/Exception.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace Vulkan {
+
+namespace
+{
+	// Large enough to hold most scene buffers and textures, small enough not to waste memory.
+	const VkDeviceSize BlockSize = 64 * 1024 * 1024;
+
+	VkDeviceSize RoundUp(const VkDeviceSize size, const VkDeviceSize granularity)
+	{
+		return (size + granularity - 1) / granularity * granularity;
+	}
+
+	// The buffers of the scene, see Assets::Scene.
+	const char* const GeometryNames[] =
+	{
+		"AABBs",
+		"Draws",
+		"Indices",
+		"Instances",
+		"Lights",
+		"Materials",
+		"Offsets",
+		"Positions",
+		"Procedurals",
+		"Scene Buffer Table",
+		"Triangle Materials",
+		"Vertices",
+	};
+
+	MemoryAllocator::Category Categorize(const char* const name)
+	{
+		using Category = MemoryAllocator::Category;
+
+		const auto startsWith = [name](const char* const prefix) { return strncmp(name, prefix, strlen(prefix)) == 0; };
+
+		if (strstr(name, "Scratch") != nullptr) return Category::Scratch;
+		if (startsWith("BLAS")) return Category::BottomLevel;
+		if (startsWith("TLAS")) return Category::TopLevel;
+		if (startsWith("Texture")) return Category::Textures;
+
+		for (const auto geometryName : GeometryNames)
+		{
+			if (startsWith(geometryName)) return Category::Geometry;
+		}
+
+		if (strstr(name, "Image") != nullptr) return Category::Images;
+
+		return Category::Other;
+	}
+}
+
+MemoryAllocator::MemoryAllocator(const class Device& device, const bool hasMemoryBudget) :
+	device_(device),
+	hasMemoryBudget_(hasMemoryBudget)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device.PhysicalDevice(), &properties);
+	vkGetPhysicalDeviceMemoryProperties(device.PhysicalDevice(), &memoryProperties_);
+
+	bufferImageGranularity_ = properties.limits.bufferImageGranularity;
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	for (uint32_t i = 0; i != blocks_.size(); ++i)
+	{
+		FreeBlock(i);
+	}
+}
+
+MemoryAllocator::Allocation MemoryAllocator::Allocate(
+	const VkMemoryRequirements& requirements,
+	const VkMemoryAllocateFlags allocateFlags,
+	const VkMemoryPropertyFlags propertyFlags)
+{
+	const auto memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, propertyFlags);
+
+	// Buffers and images share the blocks, so keep them apart by the buffer/image granularity.
+	const auto alignment = std::max(requirements.alignment, bufferImageGranularity_);
+	const auto size = std::max<VkDeviceSize>(requirements.size, 1);
+
+	Allocation allocation;
+	totalAllocations_++;
+
+	// Large resources would waste most of a shared block, give them their own.
+	if (size > BlockSize / 2)
+	{
+		const auto blockIndex = AllocateBlock(size, memoryTypeIndex, allocateFlags, true);
+		TryAllocate(blockIndex, size, alignment, allocation);
+		return allocation;
+	}
+
+	for (uint32_t i = 0; i != blocks_.size(); ++i)
+	{
+		const auto& block = blocks_[i];
+
+		if (block.Memory != nullptr &&
+			!block.Dedicated &&
+			block.MemoryTypeIndex == memoryTypeIndex &&
+			block.AllocateFlags == allocateFlags &&
+			TryAllocate(i, size, alignment, allocation))
+		{
+			return allocation;
+		}
+	}
+
+	const auto blockIndex = AllocateBlock(BlockSize, memoryTypeIndex, allocateFlags, false);
+	TryAllocate(blockIndex, size, alignment, allocation);
+
+	return allocation;
+}
+
+void MemoryAllocator::Free(const Allocation& allocation)
+{
+	if (allocation.Owner != 0)
+	{
+		const auto owner = owners_.find(allocation.Owner);
+
+		if (owner != owners_.end() && (owner->second.Bytes -= allocation.RangeSize) == 0)
+		{
+			owners_.erase(owner);
+		}
+	}
+
+	auto& block = blocks_[allocation.BlockIndex];
+	auto& ranges = block.FreeRanges;
+
+	// Insert the range back and merge it with its neighbours.
+	const auto next = std::lower_bound(ranges.begin(), ranges.end(), allocation.RangeOffset,
+		[](const Range& range, const VkDeviceSize offset) { return range.Offset < offset; });
+
+	auto it = ranges.insert(next, Range{ allocation.RangeOffset, allocation.RangeSize });
+
+	if (it + 1 != ranges.end() && it->Offset + it->Size == (it + 1)->Offset)
+	{
+		it->Size += (it + 1)->Size;
+		ranges.erase(it + 1);
+	}
+
+	if (it != ranges.begin() && (it - 1)->Offset + (it - 1)->Size == it->Offset)
+	{
+		(it - 1)->Size += it->Size;
+		ranges.erase(it);
+	}
+
+	block.AllocationCount--;
+
+	if (block.AllocationCount != 0)
+	{
+		return;
+	}
+
+	// Keep a single empty block per memory type around, so that short lived staging buffers do not hit vkAllocateMemory.
+	const bool hasOtherEmptyBlock = std::any_of(blocks_.begin(), blocks_.end(), [&](const Block& other)
+	{
+		return &other != &block &&
+			other.Memory != nullptr &&
+			!other.Dedicated &&
+			other.AllocationCount == 0 &&
+			other.MemoryTypeIndex == block.MemoryTypeIndex &&
+			other.AllocateFlags == block.AllocateFlags;
+	});
+
+	if (block.Dedicated || hasOtherEmptyBlock)
+	{
+		FreeBlock(allocation.BlockIndex);
+	}
+}
+
+void MemoryAllocator::SetOwner(Allocation& allocation, const uint64_t owner)
+{
+	allocation.Owner = owner;
+	owners_[owner].Bytes += allocation.RangeSize;
+}
+
+void MemoryAllocator::SetOwnerName(const uint64_t owner, const char* const name)
+{
+	owners_[owner].Type = Categorize(name);
+}
+
+void* MemoryAllocator::Map(const Allocation& allocation)
+{
+	// A block can only be mapped once, share the mapping between its allocations.
+	auto& block = blocks_[allocation.BlockIndex];
+
+	if (block.MapCount++ == 0)
+	{
+		Check(vkMapMemory(device_.Handle(), block.Memory, 0, VK_WHOLE_SIZE, 0, &block.MappedData),
+			"map memory");
+	}
+
+	return static_cast<uint8_t*>(block.MappedData) + allocation.Offset;
+}
+
+void MemoryAllocator::Unmap(const Allocation& allocation)
+{
+	auto& block = blocks_[allocation.BlockIndex];
+
+	if (--block.MapCount == 0)
+	{
+		vkUnmapMemory(device_.Handle(), block.Memory);
+		block.MappedData = nullptr;
+	}
+}
+
+MemoryAllocator::Statistics MemoryAllocator::GetStatistics() const
+{
+	Statistics statistics = {};
+	statistics.TotalAllocations = totalAllocations_;
+	statistics.TotalBlockAllocations = totalBlockAllocations_;
+
+	for (const auto& block : blocks_)
+	{
+		if (block.Memory == nullptr)
+		{
+			continue;
+		}
+
+		VkDeviceSize freeBytes = 0;
+
+		for (const auto& range : block.FreeRanges)
+		{
+			freeBytes += range.Size;
+		}
+
+		statistics.BlockCount++;
+		statistics.AllocationCount += block.AllocationCount;
+		statistics.BlockBytes += block.Size;
+		statistics.UsedBytes += block.Size - freeBytes;
+	}
+
+	return statistics;
+}
+
+std::vector<MemoryAllocator::HeapBudget> MemoryAllocator::GetHeapBudgets() const
+{
+	std::vector<HeapBudget> heaps(memoryProperties_.memoryHeapCount);
+
+	for (uint32_t i = 0; i != memoryProperties_.memoryHeapCount; ++i)
+	{
+		const auto& heap = memoryProperties_.memoryHeaps[i];
+
+		heaps[i].IsDeviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		heaps[i].Size = heap.size;
+		heaps[i].Budget = heap.size;
+	}
+
+	if (!hasMemoryBudget_)
+	{
+		for (const auto& block : blocks_)
+		{
+			if (block.Memory != nullptr)
+			{
+				heaps[memoryProperties_.memoryTypes[block.MemoryTypeIndex].heapIndex].Usage += block.Size;
+			}
+		}
+
+		return heaps;
+	}
+
+	// Unlike the memory properties, the budget changes as this process and the others allocate memory.
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+	budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+	VkPhysicalDeviceMemoryProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	properties.pNext = &budget;
+
+	vkGetPhysicalDeviceMemoryProperties2(device_.PhysicalDevice(), &properties);
+
+	for (uint32_t i = 0; i != memoryProperties_.memoryHeapCount; ++i)
+	{
+		heaps[i].Usage = budget.heapUsage[i];
+		heaps[i].Budget = budget.heapBudget[i];
+	}
+
+	return heaps;
+}
+
+MemoryAllocator::CategoryBytes MemoryAllocator::GetCategoryBytes() const
+{
+	CategoryBytes bytes = {};
+
+	for (const auto& owner : owners_)
+	{
+		bytes[static_cast<size_t>(owner.second.Type)] += owner.second.Bytes;
+	}
+
+	return bytes;
+}
+
+const char* MemoryAllocator::CategoryName(const Category category)
+{
+	switch (category)
+	{
+	case Category::Geometry: return "geometry";
+	case Category::Textures: return "textures";
+	case Category::BottomLevel: return "BLAS";
+	case Category::TopLevel: return "TLAS";
+	case Category::Scratch: return "scratch";
+	case Category::Images: return "images";
+	default: return "other";
+	}
+}
+
+bool MemoryAllocator::HasMemoryType(const uint32_t typeFilter, const VkMemoryPropertyFlags propertyFlags) const
+{
+	for (uint32_t i = 0; i != memoryProperties_.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1 << i)) && (memoryProperties_.memoryTypes[i].propertyFlags & propertyFlags) == propertyFlags)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t MemoryAllocator::FindMemoryType(const uint32_t typeFilter, const VkMemoryPropertyFlags propertyFlags) const
+{
+	for (uint32_t i = 0; i != memoryProperties_.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1 << i)) && (memoryProperties_.memoryTypes[i].propertyFlags & propertyFlags) == propertyFlags)
+		{
+			return i;
+		}
+	}
+
+	Throw(std::runtime_error("failed to find suitable memory type"));
+}
+
+uint32_t MemoryAllocator::AllocateBlock(const VkDeviceSize size, const uint32_t memoryTypeIndex, const VkMemoryAllocateFlags allocateFlags, const bool dedicated)
+{
+	VkMemoryAllocateFlagsInfo flagsInfo = {};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+	flagsInfo.pNext = nullptr;
+	flagsInfo.flags = allocateFlags;
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.pNext = &flagsInfo;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	Block block;
+	block.Size = size;
+	block.MemoryTypeIndex = memoryTypeIndex;
+	block.AllocateFlags = allocateFlags;
+	block.Dedicated = dedicated;
+	block.FreeRanges.push_back(Range{ 0, size });
+
+	// Warn before going over the budget, the driver may then start paging or simply fail the allocation.
+	if (hasMemoryBudget_)
+	{
+		const auto heapIndex = memoryProperties_.memoryTypes[memoryTypeIndex].heapIndex;
+		const auto heap = GetHeapBudgets()[heapIndex];
+
+		if (heap.Usage + size > heap.Budget)
+		{
+			Utilities::Console::Write(Utilities::Severity::Warning, [&]()
+			{
+				const double megabyte = 1024 * 1024;
+				std::cerr << "WARNING: allocating " << size / megabyte << "MB out of memory heap " << heapIndex << " goes over its budget (";
+				std::cerr << heap.Usage / megabyte << "MB used out of " << heap.Budget / megabyte << "MB)" << std::endl;
+			});
+		}
+	}
+
+	Check(vkAllocateMemory(device_.Handle(), &allocInfo, nullptr, &block.Memory),
+		"allocate memory");
+
+	totalBlockAllocations_++;
+
+	// Reuse the slot of a released block if any, allocations refer to their block by index.
+	const auto freeSlot = std::find_if(blocks_.begin(), blocks_.end(), [](const Block& other) { return other.Memory == nullptr; });
+
+	if (freeSlot != blocks_.end())
+	{
+		*freeSlot = std::move(block);
+		return static_cast<uint32_t>(freeSlot - blocks_.begin());
+	}
+
+	blocks_.push_back(std::move(block));
+	return static_cast<uint32_t>(blocks_.size() - 1);
+}
+
+void MemoryAllocator::FreeBlock(const uint32_t blockIndex)
+{
+	auto& block = blocks_[blockIndex];
+
+	if (block.Memory != nullptr)
+	{
+		vkFreeMemory(device_.Handle(), block.Memory, nullptr);
+	}
+
+	block = Block();
+}
+
+bool MemoryAllocator::TryAllocate(const uint32_t blockIndex, const VkDeviceSize size, const VkDeviceSize alignment, Allocation& allocation)
+{
+	auto& block = blocks_[blockIndex];
+
+	// First fit, the alignment padding is simply part of the allocated range.
+	for (auto it = block.FreeRanges.begin(); it != block.FreeRanges.end(); ++it)
+	{
+		const auto offset = RoundUp(it->Offset, alignment);
+		const auto end = offset + size;
+
+		if (end > it->Offset + it->Size)
+		{
+			continue;
+		}
+
+		allocation.Memory = block.Memory;
+		allocation.Offset = offset;
+		allocation.BlockIndex = blockIndex;
+		allocation.RangeOffset = it->Offset;
+		allocation.RangeSize = end - it->Offset;
+
+		it->Size -= allocation.RangeSize;
+		it->Offset = end;
+
+		if (it->Size == 0)
+		{
+			block.FreeRanges.erase(it);
+		}
+
+		block.AllocationCount++;
+		return true;
+	}
+
+	return false;
+}
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace Vulkan
+{
+	class Device;
+
+	// Sub-allocates device memory out of large blocks, rather than calling vkAllocateMemory for every resource.
+	// Blocks are grouped per memory type and allocate flags, large resources get a dedicated block.
+	// The allocations are also accounted per category, from the names given to the buffers and images they are bound to.
+	class MemoryAllocator final
+	{
+	public:
+
+		struct Allocation final
+		{
+			VkDeviceMemory Memory{};
+			VkDeviceSize Offset{};
+			uint32_t BlockIndex{};
+			VkDeviceSize RangeOffset{};
+			VkDeviceSize RangeSize{};
+			uint64_t Owner{}; // The buffer or image handle bound to the allocation, if any.
+		};
+
+		// What the memory is used for, see DebugUtils::SetObjectName().
+		enum class Category
+		{
+			Geometry,
+			Textures,
+			BottomLevel,
+			TopLevel,
+			Scratch,
+			Images,
+			Other,
+			Count
+		};
+
+		using CategoryBytes = std::array<VkDeviceSize, static_cast<size_t>(Category::Count)>;
+
+		struct HeapBudget final
+		{
+			bool IsDeviceLocal;
+			VkDeviceSize Size;
+			VkDeviceSize Usage; // By the whole process, or only by the allocator blocks without VK_EXT_memory_budget.
+			VkDeviceSize Budget; // What the process can use before running out, the heap size without VK_EXT_memory_budget.
+		};
+
+		struct Statistics final
+		{
+			uint32_t BlockCount;
+			uint32_t AllocationCount;
+			VkDeviceSize BlockBytes;
+			VkDeviceSize UsedBytes;
+			uint64_t TotalAllocations;
+			uint64_t TotalBlockAllocations;
+		};
+
+		VULKAN_NON_COPIABLE(MemoryAllocator)
+
+		MemoryAllocator(const Device& device, bool hasMemoryBudget);
+		~MemoryAllocator();
+
+		Allocation Allocate(const VkMemoryRequirements& requirements, VkMemoryAllocateFlags allocateFlags, VkMemoryPropertyFlags propertyFlags);
+		void Free(const Allocation& allocation);
+
+		// Accounts the allocation to the buffer or image it is bound to, whose name (given before or after) tells its category.
+		void SetOwner(Allocation& allocation, uint64_t owner);
+		void SetOwnerName(uint64_t owner, const char* name);
+
+		bool HasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags propertyFlags) const;
+
+		void* Map(const Allocation& allocation);
+		void Unmap(const Allocation& allocation);
+
+		Statistics GetStatistics() const;
+
+		bool HasMemoryBudget() const { return hasMemoryBudget_; }
+		std::vector<HeapBudget> GetHeapBudgets() const;
+		CategoryBytes GetCategoryBytes() const;
+
+		static const char* CategoryName(Category category);
+
+	private:
+
+		struct Range final
+		{
+			VkDeviceSize Offset;
+			VkDeviceSize Size;
+		};
+
+		struct Block final
+		{
+			VkDeviceMemory Memory{};
+			VkDeviceSize Size{};
+			uint32_t MemoryTypeIndex{};
+			VkMemoryAllocateFlags AllocateFlags{};
+			bool Dedicated{};
+			std::vector<Range> FreeRanges; // Sorted by offset.
+			uint32_t AllocationCount{};
+			uint32_t MapCount{};
+			void* MappedData{};
+		};
+
+		uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags propertyFlags) const;
+		uint32_t AllocateBlock(VkDeviceSize size, uint32_t memoryTypeIndex, VkMemoryAllocateFlags allocateFlags, bool dedicated);
+		void FreeBlock(uint32_t blockIndex);
+		bool TryAllocate(uint32_t blockIndex, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation);
+
+		struct Owner final
+		{
+			Category Type{ Category::Other };
+			VkDeviceSize Bytes{};
+		};
+
+		const class Device& device_;
+		const bool hasMemoryBudget_;
+
+		VkPhysicalDeviceMemoryProperties memoryProperties_{};
+		VkDeviceSize bufferImageGranularity_{};
+
+		std::vector<Block> blocks_; // Released blocks have a null memory handle and get reused.
+		uint64_t totalAllocations_{};
+		uint64_t totalBlockAllocations_{};
+
+		std::unordered_map<uint64_t, Owner> owners_;
+	};
+
+}
@@ -0,0 +1,176 @@
+#include "NormalsPipeline.hpp"
+#include "Buffer.hpp"
+#include "DescriptorBinding.hpp"
+#include "DescriptorSetManager.hpp"
+#include "DescriptorSets.hpp"
+#include "Device.hpp"
+#include "DeviceMemory.hpp"
+#include "PipelineLayout.hpp"
+#include "ShaderCache.hpp"
+#include "ShaderModule.hpp"
+#include <algorithm>
+
+namespace Vulkan {
+
+namespace
+{
+	// Matches the push constants of GenerateNormals.comp.
+	struct PushConstants
+	{
+		uint32_t FirstVertex;
+		uint32_t VertexCount;
+		uint32_t FirstIndex;
+		uint32_t TriangleCount;
+		uint32_t FirstSum;
+		uint32_t Stage; // 0 sums the face normals, 1 writes the vertex normals.
+		uint32_t ShortIndices;
+	};
+
+	// The invocations loop over the elements past the group count limit every device supports.
+	constexpr uint32_t GroupSize = 64;
+	constexpr uint32_t MaxGroupCount = 65535;
+
+	uint32_t GroupCount(const uint32_t elementCount)
+	{
+		return std::min((elementCount + GroupSize - 1) / GroupSize, MaxGroupCount);
+	}
+}
+
+NormalsPipeline::NormalsPipeline(
+	const class Device& device,
+	const Buffer& vertexBuffer,
+	const Buffer& indexBuffer,
+	const bool compactVertices,
+	const std::vector<Range>& ranges) :
+	device_(device),
+	ranges_(ranges)
+{
+	// The fixed point sums of every range, one after the other.
+	VkDeviceSize sumCount = 0;
+
+	for (const auto& range : ranges_)
+	{
+		sumCount += 3 * VkDeviceSize(range.VertexCount);
+	}
+
+	sumBuffer_.reset(new Buffer(device, std::max<VkDeviceSize>(sumCount, 1) * sizeof(int32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT));
+	sumBufferMemory_.reset(new DeviceMemory(sumBuffer_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+
+	device.DebugUtils().SetObjectName(sumBuffer_->Handle(), "Normal Sums");
+
+	const std::vector<DescriptorBinding> descriptorBindings =
+	{
+		{0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{2, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT}
+	};
+
+	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, 1));
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	VkDescriptorBufferInfo vertexBufferInfo = {};
+	vertexBufferInfo.buffer = vertexBuffer.Handle();
+	vertexBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo indexBufferInfo = {};
+	indexBufferInfo.buffer = indexBuffer.Handle();
+	indexBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo sumBufferInfo = {};
+	sumBufferInfo.buffer = sumBuffer_->Handle();
+	sumBufferInfo.range = VK_WHOLE_SIZE;
+
+	const std::vector<VkWriteDescriptorSet> descriptorWrites =
+	{
+		descriptorSets.Bind(0, 0, vertexBufferInfo),
+		descriptorSets.Bind(0, 1, indexBufferInfo),
+		descriptorSets.Bind(0, 2, sumBufferInfo)
+	};
+
+	descriptorSets.UpdateDescriptors(0, descriptorWrites);
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout(), { pushConstantRange }));
+
+	const auto& computeShader = device.Shaders().Get("GenerateNormals.comp.spv");
+
+	// Select the vertex layout of the scene.
+	const VkBool32 compact = compactVertices;
+	const VkSpecializationMapEntry specializationEntry = { 0, 0, sizeof(VkBool32) };
+	const VkSpecializationInfo specializationInfo = { 1, &specializationEntry, sizeof(compact), &compact };
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT, &specializationInfo);
+	pipelineInfo.layout = pipelineLayout_->Handle();
+
+	// Only created while a scene is uploaded, hence without the application pipeline cache.
+	Check(vkCreateComputePipelines(device.Handle(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline_),
+		"create normals pipeline");
+}
+
+NormalsPipeline::~NormalsPipeline()
+{
+	if (pipeline_ != nullptr)
+	{
+		vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
+		pipeline_ = nullptr;
+	}
+
+	pipelineLayout_.reset();
+	descriptorSetManager_.reset();
+	sumBuffer_.reset();
+	sumBufferMemory_.reset();
+}
+
+void NormalsPipeline::Dispatch(VkCommandBuffer commandBuffer) const
+{
+	const auto barrier = [commandBuffer](VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+	{
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = srcAccess;
+		memoryBarrier.dstAccessMask = dstAccess;
+
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	};
+
+	// The cleared sums and the uploaded vertices and indices.
+	vkCmdFillBuffer(commandBuffer, sumBuffer_->Handle(), 0, VK_WHOLE_SIZE, 0);
+
+	barrier(
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(0) };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 0, nullptr);
+
+	for (const uint32_t stage : { 0u, 1u })
+	{
+		uint32_t firstSum = 0;
+
+		for (const auto& range : ranges_)
+		{
+			const PushConstants constants = { range.FirstVertex, range.VertexCount, range.FirstIndex, range.IndexCount / 3, firstSum, stage, range.ShortIndices ? 1u : 0u };
+
+			vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+			vkCmdDispatch(commandBuffer, GroupCount(stage == 0 ? constants.TriangleCount : constants.VertexCount), 1, 1);
+
+			firstSum += range.VertexCount;
+		}
+
+		// The sums are complete before any vertex is normalized, and the normals are written before the vertices are read again.
+		barrier(
+			VK_ACCESS_SHADER_WRITE_BIT, stage == 0 ? VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_MEMORY_READ_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, stage == 0 ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+	}
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <memory>
+#include <vector>
+
+namespace Vulkan
+{
+	class Buffer;
+	class DescriptorSetManager;
+	class Device;
+	class DeviceMemory;
+	class PipelineLayout;
+
+	// The smooth normals of the uploaded models that were loaded without any (see GenerateNormals.comp and Assets::Model::NeedsNormals()).
+	// The face normals are summed into their vertices with fixed point atomics, then normalized and written in place in the vertex buffer.
+	class NormalsPipeline final
+	{
+	public:
+
+		// The vertices and indices of a model in the scene buffers, its indices being relative to its first vertex.
+		// The first index is in 32-bit words, short indices are packed two per word (see Assets::Scene::IndexType()).
+		struct Range final
+		{
+			uint32_t FirstVertex;
+			uint32_t VertexCount;
+			uint32_t FirstIndex;
+			uint32_t IndexCount;
+			bool ShortIndices;
+		};
+
+		VULKAN_NON_COPIABLE(NormalsPipeline)
+
+		NormalsPipeline(
+			const Device& device,
+			const Buffer& vertexBuffer,
+			const Buffer& indexBuffer,
+			bool compactVertices,
+			const std::vector<Range>& ranges);
+		~NormalsPipeline();
+
+		// Waits for the uploads of the vertices and indices, the barrier up to any later vertex read is inserted here.
+		// The pipeline must outlive the execution of the command buffer.
+		void Dispatch(VkCommandBuffer commandBuffer) const;
+
+	private:
+
+		const Device& device_;
+		const std::vector<Range> ranges_;
+
+		VULKAN_HANDLE(VkPipeline, pipeline_)
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+		std::unique_ptr<Buffer> sumBuffer_;
+		std::unique_ptr<DeviceMemory> sumBufferMemory_;
+	};
+
+}
@@ -0,0 +1,120 @@
+#include "PipelineCache.hpp"
+#include "Device.hpp"
+#include "Utilities/Exception.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace Vulkan {
+
+namespace
+{
+	// Matches VkPipelineCacheHeaderVersionOne, tightly packed.
+	const size_t HeaderSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+
+	bool IsCompatible(const std::vector<uint8_t>& data, const VkPhysicalDeviceProperties& properties)
+	{
+		if (data.size() < HeaderSize)
+		{
+			return false;
+		}
+
+		uint32_t header[4];
+		std::memcpy(header, data.data(), sizeof(header));
+
+		return
+			header[0] >= HeaderSize &&
+			header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header[2] == properties.vendorID &&
+			header[3] == properties.deviceID &&
+			std::memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+}
+
+PipelineCache::PipelineCache(const class Device& device, const std::string& directory) :
+	device_(device)
+{
+	VkPhysicalDeviceIDProperties idProperties = {};
+	idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &idProperties;
+
+	vkGetPhysicalDeviceProperties2(device.PhysicalDevice(), &properties);
+
+	// Keyed by device and driver, so switching GPU or updating the driver starts from a clean cache.
+	std::ostringstream name;
+	name << std::hex << std::setfill('0') << std::setw(4) << properties.properties.vendorID << '-' << std::setw(4) << properties.properties.deviceID << '-';
+
+	for (const auto byte : idProperties.driverUUID)
+	{
+		name << std::setw(2) << static_cast<uint32_t>(byte);
+	}
+
+	name << ".bin";
+	path_ = (std::filesystem::path(directory) / name.str()).string();
+
+	// Load the previous run data, if any.
+	std::vector<uint8_t> data;
+	std::ifstream file(path_, std::ios::binary);
+
+	if (file)
+	{
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	if (!IsCompatible(data, properties.properties))
+	{
+		data.clear();
+	}
+
+	VkPipelineCacheCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = data.size();
+	createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	Check(vkCreatePipelineCache(device.Handle(), &createInfo, nullptr, &pipelineCache_),
+		"create pipeline cache");
+
+	isLoadedFromDisk_ = !data.empty();
+}
+
+PipelineCache::~PipelineCache()
+{
+	if (pipelineCache_ != nullptr)
+	{
+		vkDestroyPipelineCache(device_.Handle(), pipelineCache_, nullptr);
+		pipelineCache_ = nullptr;
+	}
+}
+
+void PipelineCache::Save() const
+{
+	size_t size = 0;
+	Check(vkGetPipelineCacheData(device_.Handle(), pipelineCache_, &size, nullptr),
+		"get pipeline cache data size");
+
+	std::vector<uint8_t> data(size);
+	Check(vkGetPipelineCacheData(device_.Handle(), pipelineCache_, &size, data.data()),
+		"get pipeline cache data");
+
+	// A failure to write the cache is not fatal, the pipelines are simply compiled again next time.
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path_).parent_path(), error);
+
+	std::ofstream file(path_, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(data.data()), size);
+
+	if (error || !file)
+	{
+		std::cerr << "WARNING: failed to write pipeline cache '" << path_ << "'" << std::endl;
+	}
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <string>
+
+namespace Vulkan
+{
+	class Device;
+
+	// A pipeline cache loaded from disk at creation and saved back with Save().
+	// There is one file per device and driver, mismatching data is ignored.
+	class PipelineCache final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(PipelineCache)
+
+		PipelineCache(const Device& device, const std::string& directory);
+		~PipelineCache();
+
+		const class Device& Device() const { return device_; }
+
+		// Whether the cache was primed with data from a previous run.
+		bool IsLoadedFromDisk() const { return isLoadedFromDisk_; }
+
+		void Save() const;
+
+	private:
+
+		const class Device& device_;
+		std::string path_;
+		bool isLoadedFromDisk_{};
+
+		VULKAN_HANDLE(VkPipelineCache, pipelineCache_)
+	};
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vulkan.hpp"
+#include <vector>
 
 namespace Vulkan
 {
@@ -14,6 +15,8 @@ namespace Vulkan
 		VULKAN_NON_COPIABLE(PipelineLayout)
 
 		PipelineLayout(const Device& device, const DescriptorSetLayout& descriptorSetLayout);
+		PipelineLayout(const Device& device, const DescriptorSetLayout& descriptorSetLayout, const std::vector<VkPushConstantRange>& pushConstantRanges);
+		PipelineLayout(const Device& device, const std::vector<const DescriptorSetLayout*>& descriptorSetLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
 		~PipelineLayout();
 
 	private:
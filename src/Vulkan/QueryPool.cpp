@@ -0,0 +1,52 @@
+#include "QueryPool.hpp"
+#include "Device.hpp"
+
+namespace Vulkan {
+
+QueryPool::QueryPool(const class Device& device, const VkQueryType queryType, const uint32_t queryCount) :
+	device_(device),
+	queryType_(queryType),
+	queryCount_(queryCount)
+{
+	VkQueryPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = queryType;
+	poolInfo.queryCount = queryCount;
+
+	Check(vkCreateQueryPool(device.Handle(), &poolInfo, nullptr, &queryPool_),
+		"create query pool");
+}
+
+QueryPool::~QueryPool()
+{
+	if (queryPool_ != nullptr)
+	{
+		vkDestroyQueryPool(device_.Handle(), queryPool_, nullptr);
+		queryPool_ = nullptr;
+	}
+}
+
+void QueryPool::Reset(VkCommandBuffer commandBuffer)
+{
+	vkCmdResetQueryPool(commandBuffer, queryPool_, 0, queryCount_);
+}
+
+void QueryPool::Reset(VkCommandBuffer commandBuffer, const uint32_t firstQuery, const uint32_t queryCount)
+{
+	vkCmdResetQueryPool(commandBuffer, queryPool_, firstQuery, queryCount);
+}
+
+std::vector<uint64_t> QueryPool::GetResults() const
+{
+	std::vector<uint64_t> results(queryCount_);
+
+	Check(vkGetQueryPoolResults(
+		device_.Handle(), queryPool_, 0, queryCount_,
+		results.size() * sizeof(uint64_t), results.data(), sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT),
+		"get query pool results");
+
+	return results;
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <vector>
+
+namespace Vulkan
+{
+	class Device;
+
+	class QueryPool final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(QueryPool)
+
+		QueryPool(const Device& device, VkQueryType queryType, uint32_t queryCount);
+		~QueryPool();
+
+		const class Device& Device() const { return device_; }
+		VkQueryType QueryType() const { return queryType_; }
+		uint32_t QueryCount() const { return queryCount_; }
+
+		void Reset(VkCommandBuffer commandBuffer);
+		void Reset(VkCommandBuffer commandBuffer, uint32_t firstQuery, uint32_t queryCount);
+		std::vector<uint64_t> GetResults() const;
+
+	private:
+
+		const class Device& device_;
+		const VkQueryType queryType_;
+		const uint32_t queryCount_;
+
+		VULKAN_HANDLE(VkQueryPool, queryPool_)
+	};
+
+}
@@ -17,9 +17,12 @@ namespace
 	}
 }
 
-AccelerationStructure::AccelerationStructure(const class DeviceProcedures& deviceProcedures, const RayTracingProperties& rayTracingProperties) :
+AccelerationStructure::AccelerationStructure(
+	const class DeviceProcedures& deviceProcedures, 
+	const class RayTracingProperties& rayTracingProperties,
+	const VkBuildAccelerationStructureFlagsKHR flags) :
 	deviceProcedures_(deviceProcedures),
-	flags_(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR),
+	flags_(flags),
 	device_(deviceProcedures.Device()),
 	rayTracingProperties_(rayTracingProperties)
 {
@@ -46,7 +49,7 @@ AccelerationStructure::~AccelerationStructure()
 	}
 }
 
-VkAccelerationStructureBuildSizesInfoKHR AccelerationStructure::GetBuildSizes(const uint32_t* pMaxPrimitiveCounts) const
+VkAccelerationStructureBuildSizesInfoKHR AccelerationStructure::GetBuildSizes(const uint32_t* pMaxPrimitiveCounts, const VkAccelerationStructureBuildTypeKHR buildType) const
 {
 	// Query both the size of the finished acceleration structure and the amount of scratch memory needed.
 	VkAccelerationStructureBuildSizesInfoKHR sizeInfo = {};
@@ -54,7 +57,7 @@ VkAccelerationStructureBuildSizesInfoKHR AccelerationStructure::GetBuildSizes(co
 
 	deviceProcedures_.vkGetAccelerationStructureBuildSizesKHR(
 		device_.Handle(), 
-		VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+		buildType,
 		&buildGeometryInfo_,
 		pMaxPrimitiveCounts,
 		&sizeInfo);
@@ -65,6 +68,7 @@ VkAccelerationStructureBuildSizesInfoKHR AccelerationStructure::GetBuildSizes(co
 
 	sizeInfo.accelerationStructureSize = RoundUp(sizeInfo.accelerationStructureSize, AccelerationStructureAlignment);
 	sizeInfo.buildScratchSize = RoundUp(sizeInfo.buildScratchSize, ScratchAlignment);
+	sizeInfo.updateScratchSize = RoundUp(sizeInfo.updateScratchSize, ScratchAlignment);
 	
 	return sizeInfo;
 }
@@ -83,6 +87,23 @@ void AccelerationStructure::CreateAccelerationStructure(Buffer& resultBuffer, co
 		"create acceleration structure");
 }
 
+VkAccelerationStructureBuildGeometryInfoKHR AccelerationStructure::GetUpdateGeometryInfo(Buffer& scratchBuffer, const VkDeviceSize scratchOffset) const
+{
+	if (!AllowUpdate())
+	{
+		Throw(std::logic_error("acceleration structure has not been built with VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR"));
+	}
+
+	// Refit the structure in place, the geometry description must be the same as the initial build.
+	auto updateInfo = buildGeometryInfo_;
+	updateInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+	updateInfo.srcAccelerationStructure = Handle();
+	updateInfo.dstAccelerationStructure = Handle();
+	updateInfo.scratchData.deviceAddress = scratchBuffer.GetDeviceAddress() + scratchOffset;
+
+	return updateInfo;
+}
+
 void AccelerationStructure::MemoryBarrier(VkCommandBuffer commandBuffer)
 {
 	// Wait for the builder to complete by setting a barrier on the resulting buffer. This is
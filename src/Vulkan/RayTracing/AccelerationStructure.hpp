@@ -26,16 +26,23 @@ namespace Vulkan::RayTracing
 
 		const class Device& Device() const { return device_; }
 		const class DeviceProcedures& DeviceProcedures() const { return deviceProcedures_; }
+		const class RayTracingProperties& RayTracingProperties() const { return rayTracingProperties_; }
+		VkBuildAccelerationStructureFlagsKHR Flags() const { return flags_; }
+		bool AllowUpdate() const { return (flags_ & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR) != 0; }
 		const VkAccelerationStructureBuildSizesInfoKHR BuildSizes() const { return buildSizesInfo_; }
 
 		static void MemoryBarrier(VkCommandBuffer commandBuffer);
 	
 	protected:
 
-		explicit AccelerationStructure(const class DeviceProcedures& deviceProcedures, const class RayTracingProperties& rayTracingProperties);
+		AccelerationStructure(
+			const class DeviceProcedures& deviceProcedures, 
+			const class RayTracingProperties& rayTracingProperties,
+			VkBuildAccelerationStructureFlagsKHR flags);
 
-		VkAccelerationStructureBuildSizesInfoKHR GetBuildSizes(const uint32_t* pMaxPrimitiveCounts) const;
+		VkAccelerationStructureBuildSizesInfoKHR GetBuildSizes(const uint32_t* pMaxPrimitiveCounts, VkAccelerationStructureBuildTypeKHR buildType) const;
 		void CreateAccelerationStructure(Buffer& resultBuffer, VkDeviceSize resultOffset);
+		VkAccelerationStructureBuildGeometryInfoKHR GetUpdateGeometryInfo(Buffer& scratchBuffer, VkDeviceSize scratchOffset) const;
 
 		const class DeviceProcedures& deviceProcedures_;
 		const VkBuildAccelerationStructureFlagsKHR flags_;
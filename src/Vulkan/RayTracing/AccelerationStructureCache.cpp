@@ -0,0 +1,141 @@
+#include "AccelerationStructureCache.hpp"
+#include "DeviceProcedures.hpp"
+#include "Assets/Model.hpp"
+#include "Vulkan/Device.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace Vulkan::RayTracing {
+
+namespace
+{
+	// Serialized acceleration structure header: driver UUID, compatibility UUID,
+	// serialized size, deserialized size and number of bottom level handles.
+	const size_t SerializedHeaderSize = 2 * VK_UUID_SIZE + 3 * sizeof(uint64_t);
+	const size_t DeserializedSizeOffset = 2 * VK_UUID_SIZE + sizeof(uint64_t);
+
+	// FNV-1a, good enough to tell geometries apart.
+	class Hash final
+	{
+	public:
+
+		void Add(const void* const data, const size_t size)
+		{
+			const auto* const bytes = static_cast<const uint8_t*>(data);
+
+			for (size_t i = 0; i != size; ++i)
+			{
+				value_ = (value_ ^ bytes[i]) * 1099511628211ull;
+			}
+		}
+
+		uint64_t Value() const { return value_; }
+
+	private:
+
+		uint64_t value_ = 14695981039346656037ull;
+	};
+}
+
+AccelerationStructureCache::AccelerationStructureCache(const class DeviceProcedures& deviceProcedures, const std::string& directory) :
+	deviceProcedures_(deviceProcedures),
+	directory_(directory)
+{
+	VkPhysicalDeviceIDProperties idProperties = {};
+	idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &idProperties;
+
+	vkGetPhysicalDeviceProperties2(deviceProcedures.Device().PhysicalDevice(), &properties);
+
+	std::memcpy(driverUuid_.data(), idProperties.driverUUID, VK_UUID_SIZE);
+}
+
+AccelerationStructureCache::~AccelerationStructureCache()
+{
+}
+
+std::string AccelerationStructureCache::GetKey(const Assets::Model& model, const VkBuildAccelerationStructureFlagsKHR flags, const bool isOpaque) const
+{
+	// Only the positions, the indices and the geometry opacity end up in the structure, the host copies are gone by now.
+	Hash hash;
+	const auto geometryHash = model.GeometryHash();
+
+	hash.Add(&geometryHash, sizeof(geometryHash));
+	hash.Add(&flags, sizeof(flags));
+	hash.Add(&isOpaque, sizeof(isOpaque));
+	hash.Add(driverUuid_.data(), driverUuid_.size());
+
+	std::ostringstream key;
+	key << std::hex << std::setw(16) << std::setfill('0') << hash.Value();
+
+	return key.str();
+}
+
+std::vector<uint8_t> AccelerationStructureCache::Load(const std::string& key) const
+{
+	std::ifstream file(GetPath(key), std::ios::binary);
+
+	if (!file)
+	{
+		return {};
+	}
+
+	std::vector<uint8_t> serialized((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (serialized.size() < SerializedHeaderSize)
+	{
+		return {};
+	}
+
+	// The driver tells whether it is able to deserialize the structure, e.g. after a driver update.
+	VkAccelerationStructureVersionInfoKHR versionInfo = {};
+	versionInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_VERSION_INFO_KHR;
+	versionInfo.pVersionData = serialized.data();
+
+	VkAccelerationStructureCompatibilityKHR compatibility{};
+	deviceProcedures_.vkGetDeviceAccelerationStructureCompatibilityKHR(deviceProcedures_.Device().Handle(), &versionInfo, &compatibility);
+
+	if (compatibility != VK_ACCELERATION_STRUCTURE_COMPATIBILITY_COMPATIBLE_KHR)
+	{
+		return {};
+	}
+
+	return serialized;
+}
+
+void AccelerationStructureCache::Store(const std::string& key, const std::vector<uint8_t>& serialized) const
+{
+	// A failure to write the cache is not fatal, the structure is simply rebuilt next time.
+	std::error_code error;
+	std::filesystem::create_directories(directory_, error);
+
+	std::ofstream file(GetPath(key), std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(serialized.data()), serialized.size());
+
+	if (error || !file)
+	{
+		std::cerr << "WARNING: failed to write acceleration structure cache entry '" << GetPath(key) << "'" << std::endl;
+	}
+}
+
+VkDeviceSize AccelerationStructureCache::GetDeserializedSize(const std::vector<uint8_t>& serialized)
+{
+	uint64_t size = 0;
+	std::memcpy(&size, serialized.data() + DeserializedSizeOffset, sizeof(size));
+	return size;
+}
+
+std::string AccelerationStructureCache::GetPath(const std::string& key) const
+{
+	return (std::filesystem::path(directory_) / (key + ".blas")).string();
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <array>
+#include <string>
+#include <vector>
+
+namespace Assets
+{
+	class Model;
+}
+
+namespace Vulkan::RayTracing
+{
+	class DeviceProcedures;
+
+	// On disk cache of serialized bottom level acceleration structures.
+	// Entries are keyed by the model geometry, the build flags and the driver UUID.
+	class AccelerationStructureCache final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(AccelerationStructureCache)
+
+		AccelerationStructureCache(const class DeviceProcedures& deviceProcedures, const std::string& directory);
+		~AccelerationStructureCache();
+
+		std::string GetKey(const Assets::Model& model, VkBuildAccelerationStructureFlagsKHR flags, bool isOpaque) const;
+
+		// Returns an empty vector if the entry is missing or is not compatible with the device.
+		std::vector<uint8_t> Load(const std::string& key) const;
+		void Store(const std::string& key, const std::vector<uint8_t>& serialized) const;
+
+		static VkDeviceSize GetDeserializedSize(const std::vector<uint8_t>& serialized);
+
+	private:
+
+		std::string GetPath(const std::string& key) const;
+
+		const class DeviceProcedures& deviceProcedures_;
+		const std::string directory_;
+		std::array<uint8_t, VK_UUID_SIZE> driverUuid_{};
+	};
+
+}
@@ -0,0 +1,114 @@
+#include "AdaptiveSamplingPipeline.hpp"
+#include "Vulkan/Buffer.hpp"
+#include "Vulkan/DescriptorBinding.hpp"
+#include "Vulkan/DescriptorSetManager.hpp"
+#include "Vulkan/DescriptorSets.hpp"
+#include "Vulkan/Device.hpp"
+#include "Vulkan/ImageView.hpp"
+#include "Vulkan/PipelineCache.hpp"
+#include "Vulkan/PipelineLayout.hpp"
+#include "Vulkan/ShaderCache.hpp"
+#include "Vulkan/ShaderModule.hpp"
+
+namespace Vulkan::RayTracing {
+
+VkDeviceSize AdaptiveSamplingPipeline::TileBufferSize(const VkExtent2D extent)
+{
+	const VkDeviceSize tileCount = static_cast<VkDeviceSize>((extent.width + TileSize - 1) / TileSize) * ((extent.height + TileSize - 1) / TileSize);
+
+	return TileListOffset + tileCount * 2 * sizeof(uint32_t);
+}
+
+AdaptiveSamplingPipeline::AdaptiveSamplingPipeline(
+	const class Device& device,
+	const PipelineCache& pipelineCache,
+	const ImageView& accumulationImageView,
+	const ImageView& momentImageView,
+	const Buffer& tileBuffer) :
+	device_(device)
+{
+	const std::vector<DescriptorBinding> descriptorBindings =
+	{
+		{0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{2, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT}
+	};
+
+	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, 1));
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	VkDescriptorImageInfo accumulationImageInfo = {};
+	accumulationImageInfo.imageView = accumulationImageView.Handle();
+	accumulationImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkDescriptorImageInfo momentImageInfo = {};
+	momentImageInfo.imageView = momentImageView.Handle();
+	momentImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkDescriptorBufferInfo tileBufferInfo = {};
+	tileBufferInfo.buffer = tileBuffer.Handle();
+	tileBufferInfo.range = VK_WHOLE_SIZE;
+
+	const std::vector<VkWriteDescriptorSet> descriptorWrites =
+	{
+		descriptorSets.Bind(0, 0, accumulationImageInfo),
+		descriptorSets.Bind(0, 1, momentImageInfo),
+		descriptorSets.Bind(0, 2, tileBufferInfo)
+	};
+
+	descriptorSets.UpdateDescriptors(0, descriptorWrites);
+
+	// The convergence threshold.
+	VkPushConstantRange thresholdRange = {};
+	thresholdRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	thresholdRange.offset = 0;
+	thresholdRange.size = sizeof(float);
+
+	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout(), { thresholdRange }));
+
+	const auto& computeShader = device.Shaders().Get("AdaptiveSampling.comp.spv");
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT);
+	pipelineInfo.layout = pipelineLayout_->Handle();
+
+	Check(vkCreateComputePipelines(device.Handle(), pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipeline_),
+		"create adaptive sampling pipeline");
+}
+
+AdaptiveSamplingPipeline::~AdaptiveSamplingPipeline()
+{
+	if (pipeline_ != nullptr)
+	{
+		vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
+		pipeline_ = nullptr;
+	}
+
+	pipelineLayout_.reset();
+	descriptorSetManager_.reset();
+}
+
+void AdaptiveSamplingPipeline::Dispatch(VkCommandBuffer commandBuffer, const Buffer& tileBuffer, const VkExtent2D extent, const float threshold) const
+{
+	// The shader appends the tiles by incrementing the dispatch depth.
+	const VkTraceRaysIndirectCommandKHR command = { TileSize, TileSize, 0 };
+	vkCmdUpdateBuffer(commandBuffer, tileBuffer.Handle(), 0, sizeof(command), &command);
+
+	VkMemoryBarrier resetBarrier = {};
+	resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &resetBarrier, 0, nullptr, 0, nullptr);
+
+	VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(0) };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(threshold), &threshold);
+	vkCmdDispatch(commandBuffer, (extent.width + TileSize - 1) / TileSize, (extent.height + TileSize - 1) / TileSize, 1);
+}
+
+}
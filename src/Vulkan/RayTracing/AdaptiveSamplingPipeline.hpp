@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <memory>
+
+namespace Vulkan
+{
+	class Buffer;
+	class DescriptorSetManager;
+	class Device;
+	class ImageView;
+	class PipelineCache;
+	class PipelineLayout;
+}
+
+namespace Vulkan::RayTracing
+{
+	// Compute pass listing the tiles whose accumulated samples have not converged yet (see AdaptiveSampling.comp).
+	// The tile buffer starts with a VkTraceRaysIndirectCommandKHR of TileSize x TileSize x active tiles, followed by the tile coordinates.
+	class AdaptiveSamplingPipeline final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(AdaptiveSamplingPipeline)
+
+		static constexpr uint32_t TileSize = 8; // Matches SampleTileSize in FrameConstants.glsl.
+		static constexpr VkDeviceSize TileListOffset = 16;
+
+		static VkDeviceSize TileBufferSize(VkExtent2D extent);
+
+		AdaptiveSamplingPipeline(
+			const Device& device,
+			const PipelineCache& pipelineCache,
+			const ImageView& accumulationImageView,
+			const ImageView& momentImageView,
+			const Buffer& tileBuffer);
+		~AdaptiveSamplingPipeline();
+
+		// Resets the tile count and appends the tiles with a relative standard error above the threshold.
+		// The barriers around it are left to the caller.
+		void Dispatch(VkCommandBuffer commandBuffer, const Buffer& tileBuffer, VkExtent2D extent, float threshold) const;
+
+	private:
+
+		const Device& device_;
+
+		VULKAN_HANDLE(VkPipeline, pipeline_)
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+	};
+
+}
@@ -1,22 +1,56 @@
 #include "Application.hpp"
+#include "AccelerationStructureCache.hpp"
+#include "AdaptiveSamplingPipeline.hpp"
+#include "DenoisePipeline.hpp"
 #include "BottomLevelAccelerationStructure.hpp"
 #include "DeviceProcedures.hpp"
+#include "PathGuidingPipeline.hpp"
+#include "RadianceCachePipeline.hpp"
 #include "RayTracingPipeline.hpp"
+#include "SampleMapPipeline.hpp"
 #include "ShaderBindingTable.hpp"
 #include "TopLevelAccelerationStructure.hpp"
+#include "UpscalePipeline.hpp"
+#include "WavefrontPipeline.hpp"
 #include "Assets/Model.hpp"
 #include "Assets/Scene.hpp"
+#include "Assets/TextureStreamer.hpp"
+#include "Assets/UniformBuffer.hpp"
+#include "Utilities/Console.hpp"
+#include "Utilities/Exception.hpp"
 #include "Utilities/Glm.hpp"
+#include "Utilities/Profiler.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include "Utilities/Trace.hpp"
 #include "Vulkan/Buffer.hpp"
 #include "Vulkan/BufferUtil.hpp"
+#include "Vulkan/CommandBuffers.hpp"
+#include "Vulkan/CommandPool.hpp"
+#include "Vulkan/DeformPipeline.hpp"
+#include "Vulkan/Enumerate.hpp"
+#include "Vulkan/FrameGraph.hpp"
+#include "Vulkan/FrameTimestamps.hpp"
+#include "Vulkan/GpuProfiler.hpp"
 #include "Vulkan/Image.hpp"
-#include "Vulkan/ImageMemoryBarrier.hpp"
 #include "Vulkan/ImageView.hpp"
+#include "Vulkan/MemoryAllocator.hpp"
+#include "Vulkan/PipelineCache.hpp"
 #include "Vulkan/PipelineLayout.hpp"
+#include "Vulkan/QueryPool.hpp"
 #include "Vulkan/SingleTimeCommands.hpp"
+#include "Vulkan/StagingRing.hpp"
 #include "Vulkan/SwapChain.hpp"
+#include "Vulkan/TimelineSemaphore.hpp"
+#include "Vulkan/VisibilityPipeline.hpp"
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <numeric>
 
 
@@ -38,10 +72,216 @@ namespace
 
 		return total;
 	}
+
+	VkDeviceSize RoundUp(const VkDeviceSize size, const VkDeviceSize granularity)
+	{
+		return (size + granularity - 1) / granularity * granularity;
+	}
+
+	// The radical inverse of the index in the given base, the low discrepancy pixel jitter of the hybrid camera rays.
+	float Halton(uint32_t index, const uint32_t base)
+	{
+		float result = 0;
+		float fraction = 1;
+
+		while (index != 0)
+		{
+			fraction /= static_cast<float>(base);
+			result += fraction * static_cast<float>(index % base);
+			index /= base;
+		}
+
+		return result;
+	}
+
+	// AccelerationStructure offset needs to be 256 bytes aligned.
+	const VkDeviceSize AccelerationStructureAlignment = 256;
+
+	// The BLAS builds share a scratch buffer of at most this size (unless a single build needs more), reused by the successive build batches.
+	const VkDeviceSize BottomScratchBudget = 256 * 1024 * 1024;
+
+	// Same for the BLAS paged in by a frame, which also bounds the time their builds add to it.
+	const VkDeviceSize PageScratchBudget = 64 * 1024 * 1024;
+
+	const uint32_t NoPage = ~0u;
+
+	void InsertMemoryBarrier(
+		VkCommandBuffer commandBuffer,
+		const VkPipelineStageFlags srcStageMask,
+		const VkAccessFlags srcAccessMask,
+		const VkPipelineStageFlags dstStageMask,
+		const VkAccessFlags dstAccessMask)
+	{
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = srcAccessMask;
+		memoryBarrier.dstAccessMask = dstAccessMask;
+
+		vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	// Every layer of the single mip level the render targets have.
+	FrameGraph::ImageUse UseImage(
+		const VkImage image,
+		const uint32_t layerCount,
+		const VkPipelineStageFlags stages,
+		const VkAccessFlags access,
+		const VkImageLayout layout,
+		const bool discard = false)
+	{
+		return FrameGraph::ImageUse{ image, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layerCount }, stages, access, layout, discard };
+	}
+
+	FrameGraph::ImageUse UseImage(
+		const Image& image,
+		const VkPipelineStageFlags stages,
+		const VkAccessFlags access,
+		const VkImageLayout layout,
+		const bool discard = false)
+	{
+		return UseImage(image.Handle(), image.ArrayLayers(), stages, access, layout, discard);
+	}
+
+	VkBuildAccelerationStructureFlagsKHR GetBuildFlags(const Assets::BuildPolicy policy)
+	{
+		switch (policy)
+		{
+		case Assets::BuildPolicy::FastTrace: return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+		case Assets::BuildPolicy::FastBuild: return VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
+		case Assets::BuildPolicy::LowMemory: return VK_BUILD_ACCELERATION_STRUCTURE_LOW_MEMORY_BIT_KHR;
+		default: Throw(std::invalid_argument("unknown acceleration structure build policy"));
+		}
+	}
+
+	const char* ToString(const Assets::BuildPolicy policy)
+	{
+		switch (policy)
+		{
+		case Assets::BuildPolicy::FastTrace: return "fast trace";
+		case Assets::BuildPolicy::FastBuild: return "fast build";
+		case Assets::BuildPolicy::LowMemory: return "low memory";
+		default: return "unknown";
+		}
+	}
+
+	// Serialized acceleration structure cache location, relative to the working directory like the assets.
+	const char* const CacheDirectory = "../cache/acceleration_structures";
+
+	// Instance custom index of the BLAS holding all the merged procedurals (see Instance.glsl).
+	const uint32_t MergedProceduralsInstanceId = 0xFFFFFF;
+
+	// How much of the sharpening lobe allowed by Upscale.comp is applied to the upscaled output image.
+	const float UpscaleSharpness = 0.8f;
+
+	bool CanMergeProcedurals(const Assets::Scene& scene)
+	{
+		// Every procedural model must be placed exactly once, untransformed, visible to all the rays and with its own material.
+		std::vector<uint32_t> placements(scene.Models().size());
+
+		for (const auto& instance : scene.Instances())
+		{
+			if (scene.Models()[instance.ModelId].Procedural() == nullptr)
+			{
+				continue;
+			}
+
+			if (instance.Transform != glm::mat4(1) || instance.MaterialOverride || instance.RayMask != 0xFF || ++placements[instance.ModelId] != 1)
+			{
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i != placements.size(); ++i)
+		{
+			if (scene.Models()[i].Procedural() != nullptr && placements[i] != 1)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// The material of the instances using a single one, which get their own hit group record with it (see Scatter.glsl).
+	// The others, like the merged procedurals, go through the generic hit groups and the material buffers.
+	const Assets::Material* GetInstanceMaterial(const Assets::Scene& scene, const Assets::ModelInstance& instance)
+	{
+		const auto& materials = scene.Models()[instance.ModelId].Materials();
+
+		return instance.MaterialOverride ? &*instance.MaterialOverride : materials.size() == 1 ? &materials[0] : nullptr;
+	}
+
+	// The models with an alpha tested material, either their own ones or an instance override. Their structure is not opaque,
+	// the any-hit shader and the ray query loops then run the alpha test on their triangles only (see AlphaTest.glsl).
+	std::vector<bool> GetAlphaTestedModels(const Assets::Scene& scene)
+	{
+		std::vector<bool> alphaTested(scene.Models().size());
+
+		for (size_t i = 0; i != alphaTested.size(); ++i)
+		{
+			const auto& materials = scene.Models()[i].Materials();
+			alphaTested[i] = std::any_of(materials.begin(), materials.end(), [](const Assets::Material& material) { return material.AlphaCutoff > 0; });
+		}
+
+		for (const auto& instance : scene.Instances())
+		{
+			if (instance.MaterialOverride && instance.MaterialOverride->AlphaCutoff > 0)
+			{
+				alphaTested[instance.ModelId] = true;
+			}
+		}
+
+		return alphaTested;
+	}
+
+	// The models with an emissive material, either their own ones or an instance override. Their lights are found back through the
+	// triangles of their full geometry, they are never paged.
+	std::vector<bool> GetEmissiveModels(const Assets::Scene& scene)
+	{
+		std::vector<bool> emissive(scene.Models().size());
+
+		for (size_t i = 0; i != emissive.size(); ++i)
+		{
+			const auto& materials = scene.Models()[i].Materials();
+			emissive[i] = std::any_of(materials.begin(), materials.end(), [](const Assets::Material& material) { return material.MaterialModel == Assets::Material::Enum::DiffuseLight; });
+		}
+
+		for (const auto& instance : scene.Instances())
+		{
+			if (instance.MaterialOverride && instance.MaterialOverride->MaterialModel == Assets::Material::Enum::DiffuseLight)
+			{
+				emissive[instance.ModelId] = true;
+			}
+		}
+
+		return emissive;
+	}
 }
 
+struct Application::TraceRecording final
+{
+	VkPipeline Pipeline{};
+	const ShaderBindingTable* ShaderBindingTable{};
+	uint64_t DescriptorSetGeneration{};
+	Assets::FrameConstants FrameConstants{};
+	VkExtent2D Extent{};
+	uint32_t RowCount{};
+	bool SampleTiles{};
+	bool IsRecorded{};
+};
+
+struct Application::PagedModel final
+{
+	uint32_t Model;
+	uint32_t ProxyAs; // In bottomAs_.
+	BottomLevelGeometry Geometries;
+	VkBuildAccelerationStructureFlagsKHR Flags;
+	std::unique_ptr<BottomLevelAccelerationStructure> Structure; // While resident, in the pool at the offset of its page.
+};
+
 Application::Application(const WindowConfig& windowConfig, const VkPresentModeKHR presentMode, const bool enableValidationLayers) :
-	Vulkan::Application(windowConfig, presentMode, enableValidationLayers)
+	Vulkan::Application(windowConfig, presentMode, enableValidationLayers),
+	taskSystem_(new Utilities::TaskSystem())
 {
 }
 
@@ -50,7 +290,19 @@ Application::~Application()
 	Application::DeleteSwapChain();
 	DeleteAccelerationStructures();
 
+	computeCommandPool_.reset();
+	denoiseGraph_.reset();
+	denoiseTimestamps_.reset();
+	denoiseTimeline_.reset();
+	denoiseCommandBuffers_.reset();
+	denoiseCommandPool_.reset();
+	frameGraph_.reset();
+	frameTimestamps_.reset();
+	cache_.reset();
 	rayTracingProperties_.reset();
+
+	// The joining tasks of the completed deferred operations may still be queued.
+	taskSystem_.reset();
 	deviceProcedures_.reset();
 }
 
@@ -79,6 +331,7 @@ void Application::SetPhysicalDevice(
 	indexingFeatures.pNext = &bufferDeviceAddressFeatures;
 	indexingFeatures.runtimeDescriptorArray = true;
 	indexingFeatures.shaderSampledImageArrayNonUniformIndexing = true;
+	indexingFeatures.descriptorBindingPartiallyBound = true;
 
 	VkPhysicalDeviceAccelerationStructureFeaturesKHR accelerationStructureFeatures = {};
 	accelerationStructureFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
@@ -89,8 +342,102 @@ void Application::SetPhysicalDevice(
 	rayTracingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR;
 	rayTracingFeatures.pNext = &accelerationStructureFeatures;
 	rayTracingFeatures.rayTracingPipeline = true;
+	rayTracingFeatures.rayTracingPipelineTraceRaysIndirect = true;
+
+	// Optional host builds of the acceleration structures, only enabled when asked for.
+	// Optional update after bind of the texture array, the trace recordings are recorded again whenever the textures are streamed without it.
+	VkPhysicalDeviceDescriptorIndexingFeatures supportedIndexingFeatures = {};
+	supportedIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+	VkPhysicalDeviceAccelerationStructureFeaturesKHR supportedAccelerationStructureFeatures = {};
+	supportedAccelerationStructureFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
+	supportedAccelerationStructureFeatures.pNext = &supportedIndexingFeatures;
+
+	VkPhysicalDeviceFeatures2 supportedFeatures = {};
+	supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures.pNext = &supportedAccelerationStructureFeatures;
+
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+	// The hybrid visibility image and the streamed textures are only written once they are used.
+	if (!supportedIndexingFeatures.descriptorBindingPartiallyBound)
+	{
+		Throw(std::runtime_error("the device does not support descriptorBindingPartiallyBound"));
+	}
+
+	supportsUpdateAfterBind_ = supportedIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind;
+	indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = supportsUpdateAfterBind_;
+
+	supportsHostBuild_ = supportedAccelerationStructureFeatures.accelerationStructureHostCommands;
+	accelerationStructureFeatures.accelerationStructureHostCommands = supportsHostBuild_ && hostBuildAccelerationStructures_;
+
+	if (hostBuildAccelerationStructures_ && !supportsHostBuild_)
+	{
+		Utilities::Console::Write(Utilities::Severity::Warning, []()
+		{
+			std::cerr << "WARNING: the device does not support accelerationStructureHostCommands, the acceleration structures are built on the device" << std::endl;
+		});
+	}
+
+	// Optional hit reordering and ray queries, the shaders needing them are only used when the device has them.
+	const auto extensions = GetEnumerateVector(physicalDevice, static_cast<const char*>(nullptr), vkEnumerateDeviceExtensionProperties);
+	const auto hasExtension = [&extensions](const char* const name)
+	{
+		return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& extension)
+		{
+			return strcmp(extension.extensionName, name) == 0;
+		});
+	};
+
+	supportsInvocationReorder_ = hasExtension(VK_NV_RAY_TRACING_INVOCATION_REORDER_EXTENSION_NAME);
+	supportsRayQuery_ = hasExtension(VK_KHR_RAY_QUERY_EXTENSION_NAME);
+	supportsPipelineLibrary_ = hasExtension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+
+	// The ray counts are summed per subgroup when the ray generation stage has the arithmetic operations, as all the current GPUs do.
+	VkPhysicalDeviceSubgroupProperties subgroupProperties = {};
+	subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
 
-	Vulkan::Application::SetPhysicalDevice(physicalDevice, requiredExtensions, deviceFeatures, &rayTracingFeatures);
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &subgroupProperties;
+
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	supportsSubgroupRayCounters_ =
+		(subgroupProperties.supportedStages & VK_SHADER_STAGE_RAYGEN_BIT_KHR) != 0 &&
+		(subgroupProperties.supportedOperations & VK_SUBGROUP_FEATURE_ARITHMETIC_BIT) != 0;
+
+	// No features to enable, the ray tracing pipeline variants are then linked from libraries (see RayTracingPipeline).
+	if (supportsPipelineLibrary_)
+	{
+		requiredExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+	}
+
+	void* features = &rayTracingFeatures;
+
+	VkPhysicalDeviceRayTracingInvocationReorderFeaturesNV reorderFeatures = {};
+	reorderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_INVOCATION_REORDER_FEATURES_NV;
+	reorderFeatures.pNext = features;
+	reorderFeatures.rayTracingInvocationReorder = true;
+
+	if (supportsInvocationReorder_)
+	{
+		requiredExtensions.push_back(VK_NV_RAY_TRACING_INVOCATION_REORDER_EXTENSION_NAME);
+		features = &reorderFeatures;
+	}
+
+	VkPhysicalDeviceRayQueryFeaturesKHR rayQueryFeatures = {};
+	rayQueryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR;
+	rayQueryFeatures.pNext = features;
+	rayQueryFeatures.rayQuery = true;
+
+	if (supportsRayQuery_)
+	{
+		requiredExtensions.push_back(VK_KHR_RAY_QUERY_EXTENSION_NAME);
+		features = &rayQueryFeatures;
+	}
+
+	Vulkan::Application::SetPhysicalDevice(physicalDevice, requiredExtensions, deviceFeatures, features);
 }
 
 void Application::OnDeviceSet()
@@ -99,274 +446,420 @@ void Application::OnDeviceSet()
 
 	deviceProcedures_.reset(new DeviceProcedures(Device()));
 	rayTracingProperties_.reset(new RayTracingProperties(Device()));
+	computeCommandPool_.reset(new class CommandPool(Device(), Device().ComputeFamilyIndex(), false));
+	cache_.reset(cacheAccelerationStructures_ ? new AccelerationStructureCache(*deviceProcedures_, CacheDirectory) : nullptr);
+	frameTimestamps_.reset(new class FrameTimestamps(Device(), MaxFramesInFlight(), TimestampPassCount));
+	frameGraph_.reset(new FrameGraph());
+
+	// The denoise of a frame is recorded right after its submission, into a command buffer of its frame slot.
+	if (asyncDenoise_)
+	{
+		denoiseCommandPool_.reset(new class CommandPool(Device(), Device().ComputeFamilyIndex(), true));
+		denoiseCommandBuffers_.reset(new CommandBuffers(*denoiseCommandPool_, MaxFramesInFlight()));
+		denoiseTimeline_.reset(new TimelineSemaphore(Device(), 0));
+		denoiseTimestamps_.reset(new class FrameTimestamps(Device(), MaxFramesInFlight(), 1));
+		denoiseGraph_.reset(new FrameGraph());
+		denoiseSlotValues_.assign(MaxFramesInFlight(), 0);
+	}
+
+	readbacks_.resize(MaxFramesInFlight());
+	outputReadbacks_.resize(MaxFramesInFlight());
+	retiredPages_.resize(MaxFramesInFlight());
 }
 
 void Application::CreateAccelerationStructures()
 {
-	const auto timer = std::chrono::high_resolution_clock::now();
+	buildStart_ = std::chrono::steady_clock::now();
+	buildTime_ = -1;
 
-	SingleTimeCommands::Submit(CommandPool(), [this](VkCommandBuffer commandBuffer)
+	// The compacted sizes are only known once the builds have completed.
+	// The BLAS are therefore built and compacted synchronously, the TLAS has to reference the compacted ones.
+	if (compactAccelerationStructures_)
+	{
+		SingleTimeCommands::Submit(CommandPool(), [this](VkCommandBuffer commandBuffer)
+		{
+			CreateBottomLevelStructures(commandBuffer);
+		});
+
+		buildBottomSize_ = GetTotalRequirements(bottomAs_).accelerationStructureSize;
+
+		CompactBottomLevelStructures();
+
+		bottomScratchBuffer_.reset();
+		bottomScratchBufferMemory_.reset();
+	}
+
+	// Build on the compute queue without waiting, the next frame submission waits on the timeline instead.
+	buildCommandBuffers_.reset(new CommandBuffers(*computeCommandPool_, 1));
+	buildTimeline_.reset(new TimelineSemaphore(Device(), 0));
+
+	const auto commandBuffer = buildCommandBuffers_->Begin(0);
+
+	if (!compactAccelerationStructures_)
 	{
 		CreateBottomLevelStructures(commandBuffer);
-		CreateTopLevelStructures(commandBuffer);
-	});
+	}
 
-	topScratchBuffer_.reset();
-	topScratchBufferMemory_.reset();
-	bottomScratchBuffer_.reset();
-	bottomScratchBufferMemory_.reset();
+	CreateTopLevelStructures(commandBuffer);
+
+	buildCommandBuffers_->End(0);
+
+	VkCommandBuffer commandBuffers[]{ commandBuffer };
+	VkSemaphore signalSemaphores[] = { buildTimeline_->Handle() };
+	const uint64_t signalValues[] = { 1 };
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = commandBuffers;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = signalSemaphores;
+
+	Check(vkQueueSubmit(Device().ComputeQueue(), 1, &submitInfo, nullptr),
+		"submit acceleration structures build command buffer");
 
-	const auto elapsed = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - timer).count();
-	std::cout << "- built acceleration structures in " << elapsed << "s" << std::endl;
+	buildSemaphorePending_ = true;
 }
 
-void Application::DeleteAccelerationStructures()
+void Application::CompleteAccelerationStructures()
 {
-	topAs_.clear();
-	instancesBuffer_.reset();
-	instancesBufferMemory_.reset();
-	topScratchBuffer_.reset();
-	topScratchBufferMemory_.reset();
-	topBuffer_.reset();
-	topBufferMemory_.reset();
+	// Only called once the build timeline has been signaled.
+	const auto buildEnd = std::chrono::steady_clock::now();
+	const auto elapsed = std::chrono::duration<float, std::chrono::seconds::period>(buildEnd - buildStart_).count();
+
+	// Up to the first frame that waited on the build timeline.
+	Utilities::Trace::AddScope("BuildAccelerationStructures", buildStart_, buildEnd);
+
+	buildTime_ = elapsed;
+	buildCommandBuffers_.reset();
+
+	if (bottomBuildQueries_ || topBuildQueries_)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(Device().PhysicalDevice(), &properties);
+
+		const auto elapsedMs = [&properties](const QueryPool& queries)
+		{
+			const auto timestamps = queries.GetResults();
+			return static_cast<double>(timestamps[1] - timestamps[0]) * properties.limits.timestampPeriod / 1000000.0;
+		};
+
+		if (bottomBuildQueries_)
+		{
+			bottomBuildTime_ = elapsedMs(*bottomBuildQueries_);
+			bottomBuildQueries_.reset();
+		}
+
+		if (topBuildQueries_)
+		{
+			topBuildTime_ = elapsedMs(*topBuildQueries_);
+			topBuildQueries_.reset();
+		}
+	}
+
+	// Newly built structures are written to the cache once the build is done.
+	if (bottomSerializedSizeQueries_)
+	{
+		StoreBottomLevelStructures();
+	}
+
+	bottomSerializedBuffer_.reset();
+	bottomSerializedBufferMemory_.reset();
+
+	// The clones of the host structures are done.
+	bottomHostAs_.clear();
+	bottomHostBuffer_.reset();
+	bottomHostBufferMemory_.reset();
+
+	// The paging rebuilds the TLAS whenever a page comes in or goes out.
+	if (!pager_)
+	{
+		topScratchBuffer_.reset();
+		topScratchBufferMemory_.reset();
+	}
 
-	bottomAs_.clear();
 	bottomScratchBuffer_.reset();
 	bottomScratchBufferMemory_.reset();
-	bottomBuffer_.reset();
-	bottomBufferMemory_.reset();
-}
 
-void Application::CreateSwapChain()
-{
-	Vulkan::Application::CreateSwapChain();
+	const auto totalSize = GetTotalRequirements(bottomAs_).accelerationStructureSize + GetTotalRequirements(topAs_).accelerationStructureSize;
 
-	CreateOutputImage();
+	std::cout << "- built acceleration structures in " << elapsed << "s (" << ToString(buildPolicy_) << " policy, " << totalSize << " bytes)";
+	std::cout << " (" << instances_.size() << " TLAS instances uploaded in " << instanceUploadTime_ << "ms";
 
-	rayTracingPipeline_.reset(new RayTracingPipeline(*deviceProcedures_, SwapChain(), topAs_[0], *accumulationImageView_, *outputImageView_, UniformBuffers(), GetScene()));
+	if (topBuildTime_ >= 0)
+	{
+		std::cout << ", built in " << topBuildTime_ << "ms";
+	}
 
-	const std::vector<ShaderBindingTable::Entry> rayGenPrograms = { {rayTracingPipeline_->RayGenShaderIndex(), {}} };
-	const std::vector<ShaderBindingTable::Entry> missPrograms = { {rayTracingPipeline_->MissShaderIndex(), {}} };
-	const std::vector<ShaderBindingTable::Entry> hitGroups = { {rayTracingPipeline_->TriangleHitGroupIndex(), {}}, {rayTracingPipeline_->ProceduralHitGroupIndex(), {}} };
+	std::cout << ")";
 
-	shaderBindingTable_.reset(new ShaderBindingTable(*deviceProcedures_, *rayTracingPipeline_, *rayTracingProperties_, rayGenPrograms, missPrograms, hitGroups));
-}
+	if (hasMergedProcedurals_)
+	{
+		std::cout << " (procedurals merged into a single BLAS)";
+	}
 
-void Application::DeleteSwapChain()
-{
-	shaderBindingTable_.reset();
-	rayTracingPipeline_.reset();
-	outputImageView_.reset();
-	outputImage_.reset();
-	outputImageMemory_.reset();
-	accumulationImageView_.reset();
-	accumulationImage_.reset();
-	accumulationImageMemory_.reset();
-
-	Vulkan::Application::DeleteSwapChain();
-}
+	if (cache_)
+	{
+		std::cout << " (" << bottomCacheHits_ << " BLAS loaded from cache)";
+	}
 
-void Application::Render(VkCommandBuffer commandBuffer, const uint32_t imageIndex)
-{
-	const auto extent = SwapChain().Extent();
-
-	VkDescriptorSet descriptorSets[] = { rayTracingPipeline_->DescriptorSet(imageIndex) };
-
-	VkImageSubresourceRange subresourceRange = {};
-	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	subresourceRange.baseMipLevel = 0;
-	subresourceRange.levelCount = 1;
-	subresourceRange.baseArrayLayer = 0;
-	subresourceRange.layerCount = 1;
-
-	// Acquire destination images for rendering.
-	ImageMemoryBarrier::Insert(commandBuffer, accumulationImage_->Handle(), subresourceRange, 0,
-		VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-
-	ImageMemoryBarrier::Insert(commandBuffer, outputImage_->Handle(), subresourceRange, 0,
-		VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-
-	// Bind ray tracing pipeline.
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rayTracingPipeline_->Handle());
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rayTracingPipeline_->PipelineLayout().Handle(), 0, 1, descriptorSets, 0, nullptr);
-
-	// Describe the shader binding table.
-	VkStridedDeviceAddressRegionKHR raygenShaderBindingTable = {};
-	raygenShaderBindingTable.deviceAddress = shaderBindingTable_->RayGenDeviceAddress();
-	raygenShaderBindingTable.stride = shaderBindingTable_->RayGenEntrySize();
-	raygenShaderBindingTable.size = shaderBindingTable_->RayGenSize();
-
-	VkStridedDeviceAddressRegionKHR missShaderBindingTable = {};
-	missShaderBindingTable.deviceAddress = shaderBindingTable_->MissDeviceAddress();
-	missShaderBindingTable.stride = shaderBindingTable_->MissEntrySize();
-	missShaderBindingTable.size = shaderBindingTable_->MissSize();
-
-	VkStridedDeviceAddressRegionKHR hitShaderBindingTable = {};
-	hitShaderBindingTable.deviceAddress = shaderBindingTable_->HitGroupDeviceAddress();
-	hitShaderBindingTable.stride = shaderBindingTable_->HitGroupEntrySize();
-	hitShaderBindingTable.size = shaderBindingTable_->HitGroupSize();
-
-	VkStridedDeviceAddressRegionKHR callableShaderBindingTable = {};
-
-	// Execute ray tracing shaders.
-	deviceProcedures_->vkCmdTraceRaysKHR(commandBuffer,
-		&raygenShaderBindingTable, &missShaderBindingTable, &hitShaderBindingTable, &callableShaderBindingTable,
-		extent.width, extent.height, 1);
-
-	// Acquire output image and swap-chain image for copying.
-	ImageMemoryBarrier::Insert(commandBuffer, outputImage_->Handle(), subresourceRange, 
-		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-
-	ImageMemoryBarrier::Insert(commandBuffer, SwapChain().Images()[imageIndex], subresourceRange, 0,
-		VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-	// Copy output image into swap-chain image.
-	VkImageCopy copyRegion;
-	copyRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-	copyRegion.srcOffset = { 0, 0, 0 };
-	copyRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-	copyRegion.dstOffset = { 0, 0, 0 };
-	copyRegion.extent = { extent.width, extent.height, 1 };
-
-	vkCmdCopyImage(commandBuffer,
-		outputImage_->Handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-		SwapChain().Images()[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1, &copyRegion);
-
-	ImageMemoryBarrier::Insert(commandBuffer, SwapChain().Images()[imageIndex], subresourceRange, VK_ACCESS_TRANSFER_WRITE_BIT,
-		0, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	if (bottomHostBuilds_ != 0)
+	{
+		std::cout << " (" << bottomHostBuilds_ << " BLAS built on the host in " << bottomHostBuildTime_ << "ms)";
+	}
+
+	if (bottomBuildBatches_ != 0)
+	{
+		std::cout << " (BLAS built in " << bottomBuildBatches_ << " batches";
+
+		if (bottomBuildTime_ >= 0)
+		{
+			std::cout << ", " << bottomBuildTime_ << "ms";
+		}
+
+		std::cout << (GetScene().HasPositionBuffer() ? " from the position buffer)" : " from the vertex buffer)");
+	}
+
+	if (pager_)
+	{
+		std::cout << " (" << pager_->PageCount() << " BLAS paged through a " << geometryBudget_ / (1024 * 1024) << "MB pool)";
+	}
+
+	if (compactAccelerationStructures_)
+	{
+		std::cout << " (BLAS compacted from " << buildBottomSize_ << " to " << GetTotalRequirements(bottomAs_).accelerationStructureSize << " bytes)";
+	}
+
+	std::cout << std::endl;
 }
 
-void Application::CreateBottomLevelStructures(VkCommandBuffer commandBuffer)
+void Application::DeleteAccelerationStructures()
 {
-	const auto& scene = GetScene();
-	const auto& debugUtils = Device().DebugUtils();
-	
-	// Bottom level acceleration structure
-	// Triangles via vertex buffers. Procedurals via AABBs.
-	uint32_t vertexOffset = 0;
-	uint32_t indexOffset = 0;
-	uint32_t aabbOffset = 0;
+	// Make sure an asynchronous build is not still using the structures.
+	if (buildCommandBuffers_)
+	{
+		buildTimeline_->Wait(1, std::numeric_limits<uint64_t>::max());
+		CompleteAccelerationStructures();
+	}
 
-	for (const auto& model : scene.Models())
+	// The pipeline descriptors reference the scene and its top level acceleration structure.
+	traceRecordings_.assign(traceRecordings_.size(), TraceRecording());
+	shaderBindingTables_.clear();
+	rayTracingPipeline_.reset();
+	radianceCachePipeline_.reset();
+	radianceCacheBuffer_.reset();
+	radianceCacheBufferMemory_.reset();
+	pathGuidingPipeline_.reset();
+	pathGuidingBuffer_.reset();
+	pathGuidingBufferMemory_.reset();
+
+	if (textureRequests_ != nullptr)
 	{
-		const auto vertexCount = static_cast<uint32_t>(model.NumberOfVertices());
-		const auto indexCount = static_cast<uint32_t>(model.NumberOfIndices());
-		BottomLevelGeometry geometries;
-		
-		model.Procedural()
-			? geometries.AddGeometryAabb(scene, aabbOffset, 1, true)
-			: geometries.AddGeometryTriangles(scene, vertexOffset, vertexCount, indexOffset, indexCount, true);
+		textureRequestBufferMemory_->Unmap();
+		textureRequests_ = nullptr;
+	}
 
-		bottomAs_.emplace_back(*deviceProcedures_, *rayTracingProperties_, geometries);
+	textureRequestBuffer_.reset();
+	textureRequestBufferMemory_.reset();
 
-		vertexOffset += vertexCount * sizeof(Assets::Vertex);
-		indexOffset += indexCount * sizeof(uint32_t);
-		aabbOffset += sizeof(VkAabbPositionsKHR);
+	if (stageClocks_ != nullptr)
+	{
+		stageClockBufferMemory_->Unmap();
+		stageClocks_ = nullptr;
 	}
 
-	// Allocate the structures memory.
-	const auto total = GetTotalRequirements(bottomAs_);
+	stageClockBuffer_.reset();
+	stageClockBufferMemory_.reset();
 
-	bottomBuffer_.reset(new Buffer(Device(), total.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR));
-	bottomBufferMemory_.reset(new DeviceMemory(bottomBuffer_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
-	bottomScratchBuffer_.reset(new Buffer(Device(), total.buildScratchSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT));
-	bottomScratchBufferMemory_.reset(new DeviceMemory(bottomScratchBuffer_->AllocateMemory(VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+	if (rayCounters_ != nullptr)
+	{
+		rayCounterBufferMemory_->Unmap();
+		rayCounters_ = nullptr;
+	}
 
-	debugUtils.SetObjectName(bottomBuffer_->Handle(), "BLAS Buffer");
-	debugUtils.SetObjectName(bottomBufferMemory_->Handle(), "BLAS Memory");
-	debugUtils.SetObjectName(bottomScratchBuffer_->Handle(), "BLAS Scratch Buffer");
-	debugUtils.SetObjectName(bottomScratchBufferMemory_->Handle(), "BLAS Scratch Memory");
+	rayCounterBuffer_.reset();
+	rayCounterBufferMemory_.reset();
 
-	// Generate the structures.
-	VkDeviceSize resultOffset = 0;
-	VkDeviceSize scratchOffset = 0;
+	// A signaled semaphore can be destroyed once its signal operation has completed.
+	buildTimeline_.reset();
+	buildSemaphorePending_ = false;
 
-	for (size_t i = 0; i != bottomAs_.size(); ++i)
+	topAs_.clear();
+	instances_.clear();
+
+	if (instanceUploads_ != nullptr)
 	{
-		bottomAs_[i].Generate(commandBuffer, *bottomScratchBuffer_, scratchOffset, *bottomBuffer_, resultOffset);
-		
-		resultOffset += bottomAs_[i].BuildSizes().accelerationStructureSize;
-		scratchOffset += bottomAs_[i].BuildSizes().buildScratchSize;
+		instanceUploadBufferMemory_->Unmap();
+		instanceUploads_ = nullptr;
+	}
 
-		debugUtils.SetObjectName(bottomAs_[i].Handle(), ("BLAS #" + std::to_string(i)).c_str());
+	instanceUploadBuffer_.reset();
+	instanceUploadBufferMemory_.reset();
+	instanceUploadRanges_.clear();
+	instancesBuffer_.reset();
+	instancesBufferMemory_.reset();
+	topUpdateScratchBuffer_.reset();
+	topUpdateScratchBufferMemory_.reset();
+	topScratchBuffer_.reset();
+	topScratchBufferMemory_.reset();
+	topBuffer_.reset();
+	topBufferMemory_.reset();
+
+	// The paged structures before their pool.
+	for (auto& retired : retiredPages_)
+	{
+		retired.clear();
 	}
+
+	pagedModels_.clear();
+	modelPages_.clear();
+	instanceSpheres_.clear();
+	pager_.reset();
+	pageScratchBuffer_.reset();
+	pageScratchBufferMemory_.reset();
+	pageBuffer_.reset();
+	pageBufferMemory_.reset();
+
+	deformPipeline_.reset();
+	deformedBottomAs_.clear();
+	deformScratchBuffer_.reset();
+	deformScratchBufferMemory_.reset();
+	deformRefits_ = 0;
+
+	bottomAs_.clear();
+	modelBottomAs_.clear();
+	bottomCompactedSizeQueries_.reset();
+	bottomSerializedSizeQueries_.reset();
+	bottomSerializedBuffer_.reset();
+	bottomSerializedBufferMemory_.reset();
+	bottomCacheKeys_.clear();
+	bottomHostAs_.clear();
+	bottomHostBuffer_.reset();
+	bottomHostBufferMemory_.reset();
+	bottomScratchBuffer_.reset();
+	bottomScratchBufferMemory_.reset();
+	bottomBuffer_.reset();
+	bottomBufferMemory_.reset();
 }
 
-void Application::CreateTopLevelStructures(VkCommandBuffer commandBuffer)
+void Application::UpdateTopLevelStructures(VkCommandBuffer commandBuffer, const std::vector<glm::mat4>& transforms)
 {
-	const auto& scene = GetScene();
-	const auto& debugUtils = Device().DebugUtils();
+	// Patch the transforms of the scene instances, the merged procedurals instance never moves.
+	// Only the range of instances that actually moved is uploaded.
+	size_t first = instances_.size();
+	size_t last = 0;
 
-	// Top level acceleration structure
-	std::vector<VkAccelerationStructureInstanceKHR> instances;
+	for (size_t i = 0; i != instances_.size(); ++i)
+	{
+		auto& instance = instances_[i];
 
-	// Hit group 0: triangles
-	// Hit group 1: procedurals
-	uint32_t instanceId = 0;
+		if (instance.instanceCustomIndex != MergedProceduralsInstanceId)
+		{
+			const auto previous = instance.transform;
+			TopLevelAccelerationStructure::SetInstanceTransform(instance, transforms[instance.instanceCustomIndex]);
+
+			if (std::memcmp(&previous, &instance.transform, sizeof(previous)) != 0)
+			{
+				first = std::min(first, i);
+				last = i + 1;
+			}
+		}
+	}
 
-	for (const auto& model : scene.Models())
+	if (first >= last)
 	{
-		instances.push_back(TopLevelAccelerationStructure::CreateInstance(
-			bottomAs_[instanceId], glm::mat4(1), instanceId, model.Procedural() ? 1 : 0));
-		instanceId++;
+		return;
 	}
 
-	// Create and copy instances buffer (do it in a separate one-time synchronous command buffer).
-	BufferUtil::CreateDeviceBuffer(CommandPool(), "TLAS Instances", VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, instances, instancesBuffer_, instancesBufferMemory_);
+	UploadTopLevelInstances(commandBuffer, first, last);
+}
 
-	// Memory barrier for the bottom level acceleration structure builds.
-	AccelerationStructure::MemoryBarrier(commandBuffer);
-	
-	topAs_.emplace_back(*deviceProcedures_, *rayTracingProperties_, instancesBuffer_->GetDeviceAddress(), static_cast<uint32_t>(instances.size()));
+void Application::UpdateInstanceModels(VkCommandBuffer commandBuffer, const std::vector<std::pair<uint32_t, uint32_t>>& instanceModels)
+{
+	// The paged models re-point their instances on their own, their TLAS is rebuilt rather than refitted.
+	if (instanceModels.empty() || !topUpdateScratchBuffer_ || pager_)
+	{
+		return;
+	}
 
-	// Allocate the structure memory.
-	const auto total = GetTotalRequirements(topAs_);
+	// Point the TLAS instances at the BLAS of their new model, keeping their transform, hit group record and mask.
+	// The levels of a model share its materials, hence its material record.
+	size_t first = instances_.size();
+	size_t last = 0;
 
-	topBuffer_.reset(new Buffer(Device(), total.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR));
-	topBufferMemory_.reset(new DeviceMemory(topBuffer_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+	for (const auto& [index, modelId] : instanceModels)
+	{
+		const auto blasId = modelBottomAs_[modelId];
 
-	topScratchBuffer_.reset(new Buffer(Device(), total.buildScratchSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT));
-	topScratchBufferMemory_.reset(new DeviceMemory(topScratchBuffer_->AllocateMemory(VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+		if (blasId == MergedProceduralsInstanceId)
+		{
+			Throw(std::runtime_error("instance " + std::to_string(index) + " cannot switch to a merged procedural model"));
+		}
 
-	
-	debugUtils.SetObjectName(topBuffer_->Handle(), "TLAS Buffer");
-	debugUtils.SetObjectName(topBufferMemory_->Handle(), "TLAS Memory");
-	debugUtils.SetObjectName(topScratchBuffer_->Handle(), "TLAS Scratch Buffer");
-	debugUtils.SetObjectName(topScratchBufferMemory_->Handle(), "TLAS Scratch Memory");
-	debugUtils.SetObjectName(instancesBuffer_->Handle(), "TLAS Instances Buffer");
-	debugUtils.SetObjectName(instancesBufferMemory_->Handle(), "TLAS Instances Memory");
+		const auto i = static_cast<size_t>(std::find_if(instances_.begin(), instances_.end(),
+			[index](const VkAccelerationStructureInstanceKHR& instance) { return instance.instanceCustomIndex == index; }) - instances_.begin());
 
-	// Generate the structures.
-	topAs_[0].Generate(commandBuffer, *topScratchBuffer_, 0, *topBuffer_, 0);
+		if (i == instances_.size())
+		{
+			Throw(std::runtime_error("instance " + std::to_string(index) + " is not in the TLAS"));
+		}
+
+		auto& instance = instances_[i];
+		const auto transform = instance.transform;
+
+		instance = TopLevelAccelerationStructure::CreateInstance(
+			bottomAs_[blasId], glm::mat4(1), index, instance.instanceShaderBindingTableRecordOffset, instance.mask);
+		instance.transform = transform;
 
-	debugUtils.SetObjectName(topAs_[0].Handle(), "TLAS");
+		first = std::min(first, i);
+		last = std::max(last, i + 1);
+	}
+
+	UploadTopLevelInstances(commandBuffer, first, last);
 }
 
-void Application::CreateOutputImage()
+void Application::UploadTopLevelInstances(VkCommandBuffer commandBuffer, const size_t first, const size_t last)
 {
-	const auto extent = SwapChain().Extent();
-	const auto format = SwapChain().Format();
-	const auto tiling = VK_IMAGE_TILING_OPTIMAL;
+	// Every slice lacks the new transforms, the one of this frame is brought up to date right away.
+	for (auto& range : instanceUploadRanges_)
+	{
+		range = range.first < range.second ? std::make_pair(std::min(range.first, first), std::max(range.second, last)) : std::make_pair(first, last);
+	}
 
-	accumulationImage_.reset(new Image(Device(), extent, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT));
-	accumulationImageMemory_.reset(new DeviceMemory(accumulationImage_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
-	accumulationImageView_.reset(new ImageView(Device(), accumulationImage_->Handle(), VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT));
+	const auto slice = CurrentFrame();
+	auto& range = instanceUploadRanges_[slice];
+	auto* const uploads = instanceUploads_ + slice * instances_.size();
 
-	outputImage_.reset(new Image(Device(), extent, format, tiling, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT));
-	outputImageMemory_.reset(new DeviceMemory(outputImage_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
-	outputImageView_.reset(new ImageView(Device(), outputImage_->Handle(), format, VK_IMAGE_ASPECT_COLOR_BIT));
+	std::memcpy(uploads + range.first, instances_.data() + range.first, (range.second - range.first) * sizeof(VkAccelerationStructureInstanceKHR));
+	range = std::make_pair(0, 0);
 
-	const auto& debugUtils = Device().DebugUtils();
-	
-	debugUtils.SetObjectName(accumulationImage_->Handle(), "Accumulation Image");
-	debugUtils.SetObjectName(accumulationImageMemory_->Handle(), "Accumulation Image Memory");
-	debugUtils.SetObjectName(accumulationImageView_->Handle(), "Accumulation ImageView");
-	
-	debugUtils.SetObjectName(outputImage_->Handle(), "Output Image");
-	debugUtils.SetObjectName(outputImageMemory_->Handle(), "Output Image Memory");
-	debugUtils.SetObjectName(outputImageView_->Handle(), "Output ImageView");
+	// The previous frames may still be tracing rays against the TLAS, from either backend.
+	InsertMemoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0);
 
-}
+	VkBufferCopy copy = {};
+	copy.srcOffset = (slice * instances_.size() + first) * sizeof(VkAccelerationStructureInstanceKHR);
+	copy.dstOffset = first * sizeof(VkAccelerationStructureInstanceKHR);
+	copy.size = (last - first) * sizeof(VkAccelerationStructureInstanceKHR);
+
+	vkCmdCopyBuffer(commandBuffer, instanceUploadBuffer_->Handle(), instancesBuffer_->Handle(), 1, &copy);
 
+	InsertMemoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_SHADER_READ_BIT);
+
+	topAs_[0].Update(commandBuffer, *topUpdateScratchBuffer_, 0);
+
+	InsertMemoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
 }
+
+bool Application::UpdateDeformedStructures(
\ No newline at end of file
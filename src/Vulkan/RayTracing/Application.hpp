@@ -1,15 +1,41 @@
 #pragma once
 
 #include "Vulkan/Application.hpp"
+#include "BottomLevelPager.hpp"
 #include "RayTracingProperties.hpp"
+#include "Assets/BuildPolicy.hpp"
+#include "Utilities/Glm.hpp"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Assets
+{
+	class FrameConstants;
+}
+
+namespace Utilities
+{
+	class TaskSystem;
+}
 
 namespace Vulkan
 {
 	class CommandBuffers;
+	class CommandPool;
 	class Buffer;
+	class DeformPipeline;
 	class DeviceMemory;
+	class FrameGraph;
+	class FrameTimestamps;
 	class Image;
 	class ImageView;
+	class QueryPool;
+	class TimelineSemaphore;
+	class VisibilityPipeline;
 }
 
 namespace Vulkan::RayTracing
@@ -22,6 +48,32 @@ namespace Vulkan::RayTracing
 
 	protected:
 
+		// The GPU passes measured by FrameTimestamps().
+		static constexpr uint32_t TraceTimestampPass = 0;
+		static constexpr uint32_t CopyTimestampPass = 1;
+		static constexpr uint32_t UserInterfaceTimestampPass = 2;
+		static constexpr uint32_t DenoiseTimestampPass = 3;
+		static constexpr uint32_t TimestampPassCount = 4;
+
+		// The profiled stages and bounce buckets of Profile.glsl, every counter being two 32-bit words.
+		static constexpr uint32_t ProfileStageCount = 5;
+		static constexpr uint32_t ProfileBounceCount = 8;
+
+		// The ray counts of RayCounters.glsl, also two 32-bit words each.
+		enum RayCounter : uint32_t
+		{
+			RayCounterTraceCalls, RayCounterShadowRays, RayCounterMisses, RayCounterAbsorptions, RayCounterRoulette, RayCounterBounceLimit, RayCounterRadianceCache, RayCounterMediumCollisions, RayCounterBounceRays
+		};
+
+		static constexpr uint32_t RayCounterBounceCount = 8;
+		static constexpr uint32_t RayCounterCount = RayCounterBounceRays + RayCounterBounceCount;
+
+		// The samples kept per pixel by the half float accumulation, its sums have 11 bits of precision (see Accumulation.glsl).
+		static constexpr uint32_t HalfAccumulationSamples = 1024;
+
+		// The cameras traced by one launch, matches UniformBufferObject::ViewModelViewInverse.
+		static constexpr uint32_t MaxViewCount = 8;
+
 		Application(const WindowConfig& windowConfig, VkPresentModeKHR presentMode, bool enableValidationLayers);
 		~Application();
 
@@ -30,45 +82,397 @@ namespace Vulkan::RayTracing
 			VkPhysicalDeviceFeatures& deviceFeatures,
 			void* nextDeviceFeatures) override;
 		
+		class FrameTimestamps& FrameTimestamps() { return *frameTimestamps_; }
+
+		// The GPU milliseconds of the denoise, on either queue, and with asyncDenoise_ how long the one of a frame ran alongside the trace
+		// of the next. Negative if not measured. Read after FrameTimestamps().BeginFrame(), they pair with its trace time.
+		double DenoiseTime() const;
+		double DenoiseOverlapTime() const;
+
+		// Copies the accumulation image (RGBA32F sample sums, alpha being their count) into a host buffer at the end of the next traced frame.
+		// The callback runs on the render thread once that frame has completed, the graphics queue is never stalled.
+		// Several requests made before that frame share its readback.
+		using AccumulationReadback = std::function<void(VkExtent2D extent, std::vector<float>&& pixels)>;
+		void RequestAccumulationReadback(AccumulationReadback callback);
+		void FlushAccumulationReadbacks();
+
+		// The other way round, replaces the accumulation of the main view with these RGBA32F sums (alpha being their count) at the start of
+		// the next traced frame, e.g. to resume a checkpoint. The moments start again from zero. Dropped with the swap chain if not recorded by then.
+		void UploadAccumulation(std::vector<float>&& pixels) { requestedUpload_ = std::move(pixels); }
+
+		// Same for the accumulation layers of the other views of a multi-view launch, the callback runs once per view from the second one.
+		// A new request replaces the previous one.
+		using ViewReadback = std::function<void(VkExtent2D extent, uint32_t view, std::vector<float>&& pixels)>;
+		void RequestViewReadback(ViewReadback callback) { requestedViewReadback_ = std::move(callback); }
+
+		// Copies the output image as displayed (RGBA8, gamma corrected and denoised) the same way, once its frame has completed.
+		// While requested, the ray generation shader writes the output image rather than the swap chain image. A new request replaces the previous one.
+		// The pending ones are dropped with the swap chain.
+		using OutputReadback = std::function<void(VkExtent2D extent, std::vector<uint8_t>&& pixels)>;
+		void RequestOutputReadback(OutputReadback callback) { requestedOutputReadback_ = std::move(callback); }
+
+		// Either kind of readback requested or not completed yet, the frames have to go on until their callbacks have run.
+		bool HasPendingReadbacks() const;
+
+		// Copies the texture footprints sampled by the last frame traced in the current frame slot (see TextureStreamer) and clears them.
+		// Only valid once the frame fence has been waited on, i.e. from Render().
+		void ReadTextureRequests(std::vector<int32_t>& requests);
+
+		// Copies the stage clocks of the last frame traced in the current frame slot (stage major, ProfileBounceCount per stage) and clears them.
+		// All zero unless that frame was traced by a profiled variant. Same constraints as above.
+		void ReadStageClocks(std::vector<uint64_t>& clocks);
+
+		// Copies the ray counts of the last frame traced in the current frame slot (see RayCounter, the bounce rays last) and clears them.
+		// All zero for the frames traced by the wavefront backend. Same constraints as above.
+		void ReadRayCounters(std::vector<uint64_t>& counters);
+
+		// Traces an image of the given size regardless of the window, whose swap chain only gets a downscaled preview of it.
+		// Beyond the device image limits or the given tile size (0 = no limit), the image is split into tiles traced one after the other,
+		// RenderExtent() being the size of a tile. To be set before the device, it is read when creating the swap chain.
+		void SetOfflineRender(VkExtent2D extent, uint32_t tileSize) { offlineExtent_ = extent; offlineTileSize_ = tileSize; }
+		bool IsOfflineRender() const { return offlineExtent_.width != 0 && offlineExtent_.height != 0; }
+		VkExtent2D OfflineExtent() const { return offlineExtent_; }
+		VkExtent2D OfflineTileCount() const { return offlineTileCount_; } // Columns and rows of tiles.
+
+		// Builds the BLAS with ALLOW_COMPACTION and copies them into a tightly packed buffer before the TLAS build.
+		// Read when creating the acceleration structures.
+		void SetCompactAccelerationStructures(const bool compact) { compactAccelerationStructures_ = compact; }
+
+		// The worker threads shared by the scene loading and the deferred host operations (see DeferredOperation).
+		Utilities::TaskSystem& TaskSystem() const { return *taskSystem_; }
+
+		// Whether the device exposes VK_NV_ray_tracing_invocation_reorder, enabling invocationReorder_.
+		bool SupportsInvocationReorder() const { return supportsInvocationReorder_; }
+
+		// Whether the device supports accelerationStructureHostCommands, enabling hostBuildAccelerationStructures_.
+		bool SupportsHostAccelerationStructureBuild() const { return supportsHostBuild_; }
+
+		// Whether the device exposes VK_KHR_ray_query, enabling wavefront_.
+		bool SupportsRayQuery() const { return supportsRayQuery_; }
+
+		// Whether the last traced frame used the previous ray tracing pipeline variant, the new one still being linked in the background.
+		bool IsPipelineVariantPending() const { return isPipelineVariantPending_; }
+
+		// The duration of the last acceleration structure build in seconds, negative until it has completed.
+		double AccelerationStructureBuildTime() const { return buildTime_; }
+
+		// The GPU time of the last TLAS build and the host time of its instance upload in milliseconds, negative until measured.
+		double TopLevelBuildTime() const { return topBuildTime_; }
+		double BottomLevelBuildTime() const { return bottomBuildTime_; } // Of the BLAS builds, clones and restores alike.
+		double InstanceUploadTime() const { return instanceUploadTime_; }
+		uint32_t TopLevelInstanceCount() const { return static_cast<uint32_t>(instances_.size()); }
+
 		void OnDeviceSet() override;
 		void CreateAccelerationStructures();
 		void DeleteAccelerationStructures();
+		void UpdateTopLevelStructures(VkCommandBuffer commandBuffer, const std::vector<glm::mat4>& transforms);
+
+		// With updatableAccelerationStructures_, points the TLAS instances given by their scene index at the BLAS of other models
+		// (the view-dependent levels of detail) and refits the TLAS. Does nothing with geometry paging.
+		void UpdateInstanceModels(VkCommandBuffer commandBuffer, const std::vector<std::pair<uint32_t, uint32_t>>& instanceModels);
+
+		// With a geometry budget, pages the BLAS of the large triangle models in and out of its pool by how large their instances look
+		// from the camera, then rebuilds the TLAS over the resident ones and the proxies of the others. Returns whether any changed.
+		bool UpdateGeometryPaging(VkCommandBuffer commandBuffer, const glm::vec3& eye);
+
+		// With deformVertices_, animates the vertices of the deformed models (see DeformPipeline) and refits their BLAS and the TLAS,
+		// rebuilding the BLAS in place once every deformRebuildInterval_ refits. Returns whether any vertex moved.
+		bool UpdateDeformedStructures(VkCommandBuffer commandBuffer, double time);
+		BottomLevelPager::Statistics GeometryPagingStatistics() const; // All zero without paging.
 		void CreateSwapChain() override;
 		void DeleteSwapChain() override;
 		void Render(VkCommandBuffer commandBuffer, uint32_t imageIndex) override;
+		void AddFrameWaitSemaphores(std::vector<VkSemaphore>& semaphores, std::vector<VkPipelineStageFlags>& stages, std::vector<uint64_t>& values) override;
+		void OnFrameSubmitted(uint64_t frameValue) override;
+
+		// The size of the traced images, the extent scaled by renderScale_ (or an offline tile) as of the last swap chain creation.
+		VkExtent2D RenderExtent() const { return renderExtent_; }
+
+		// Only used when usePushConstants_ is set, the uniform buffer fields are used otherwise.
+		virtual Assets::FrameConstants GetFrameConstants() const = 0;
+
+		// Adaptive sampling, either every pixel is traced or only the tiles found active by the last update (see AdaptiveSamplingPipeline).
+		enum class TileSampling
+		{
+			AllPixels,
+			ActiveTiles,
+			UpdateActiveTiles
+		};
+
+		bool mergeProcedurals_{};
+		bool updatableAccelerationStructures_{};
+		bool deformVertices_{}; // Read when creating the acceleration structures, the deformed BLAS are built with ALLOW_UPDATE.
+		uint32_t deformRebuildInterval_{}; // 0 = only refitted.
+		bool cacheAccelerationStructures_{};
+		bool hostBuildAccelerationStructures_{}; // Build the triangle BLAS on the CPU threads and clone them into device memory, only if supported.
+		VkDeviceSize geometryBudget_{}; // The pool of the paged BLAS in bytes, 0 = every BLAS resident (see BottomLevelPager).
+		Assets::BuildPolicy buildPolicy_{};
+		bool usePushConstants_{};
+		bool hostVisibleShaderBindingTable_{}; // Rather than staged into device local memory, to measure the difference.
+		uint32_t sampler_{}; // The random sequence of the shaders, see Random.glsl.
+		uint32_t launchOrder_{}; // The pixel order of the launches, see LaunchOrder.glsl.
+		TileSampling tileSampling_{};
+		float adaptiveSamplingThreshold_{}; // The relative standard error above which a tile stays active.
+		float foveaRadius_{}; // In fractions of the image diagonal, 0 = every pixel traces all its samples (see SampleMapPipeline).
+		float foveaMinFraction_{}; // The fraction of its samples a pixel far from the gaze point still traces.
+		glm::vec2 gaze_{0.5f, 0.5f}; // In [0, 1]^2 of the image, updated every frame.
+		bool sampleMapVariance_{}; // The accumulation holds samples of the current view, the noisy pixels trace all their samples.
+		uint32_t denoiseIterations_{}; // The a-trous iterations filtering the output image (see DenoisePipeline), 0 = disabled.
+		bool asyncDenoise_{}; // Read when creating the swap chain, the denoiser then runs on the compute queue during the trace of the next frame.
+		bool reprojectAccumulation_{}; // The camera has moved, the ray generation shader reprojects a copy of the previous accumulation.
+		bool showHeatmap_{}; // Baked into the ray tracing pipeline variant, like the ones below (see RayTracingPipeline::Variant).
+		bool profileStages_{}; // Implied by the heatmap.
+		bool hasSky_{true};
+		bool compactMaterials_{}; // Only read by the wavefront pipeline when it is created, with the swap chain.
+		bool regeneratePaths_{};
+		uint32_t specializedBounces_{}; // 0 = read from the uniform buffer.
+		bool invocationReorder_{}; // Sort the hits by material before shading them, only if supported.
+		bool wavefront_{}; // Trace with the compute kernels of WavefrontPipeline rather than the ray tracing pipeline, only if supported.
+		bool hybrid_{}; // With wavefront_, the camera rays start from the rasterized visibility (see VisibilityPipeline).
+		bool restir_{}; // The ray tracing pipeline resamples the light reservoirs of the previous frame (see Restir.glsl).
+		bool radianceCache_{}; // The ray tracing pipeline ends its paths in the radiance cache and trains it (see RadianceCachePipeline).
+		bool resetRadianceCache_{}; // The next frame using the radiance cache clears it first, set when it is created.
+		bool pathGuiding_{}; // The ray tracing pipeline guides its diffuse bounces and trains the lobes (see PathGuidingPipeline).
+		bool resetPathGuiding_{}; // The next frame guiding the bounces clears the lobes first, set when they are created.
+		uint32_t numberOfBounces_{}; // The wavefront bounce loop is recorded on the host.
+		uint32_t traceRowOffset_{}; // The band of rows traced by the ray tracing pipeline when every pixel is, 0 rows = the whole image.
+		uint32_t traceRowCount_{};
+		float renderScale_{1}; // Read when creating the swap chain, below 1 the output image is upscaled into the swap chain one (see UpscalePipeline).
+		bool halfAccumulation_{}; // Read when creating the swap chain, the accumulation and its history are then RGBA16F rather than RGBA32F.
+		uint32_t viewCount_{1}; // Read when creating the swap chain, the layers of the accumulation, one per camera of the launch depth.
 			   
 	private:
 
 		void CreateBottomLevelStructures(VkCommandBuffer commandBuffer);
+		void CompactBottomLevelStructures();
+		void StoreBottomLevelStructures();
 		void CreateTopLevelStructures(VkCommandBuffer commandBuffer);
+		void CompleteAccelerationStructures();
+		void UploadTopLevelInstances(VkCommandBuffer commandBuffer, size_t first, size_t last); // Of the patched instances_ [first, last), then refits the TLAS.
 		void CreateOutputImage();
+		void CreateRayTracingPipeline();
+		void CreateShaderBindingTable(); // For the current pipeline variant.
+		void CreateWavefrontPipeline();
+		void CreateVisibilityPipeline(); // With the first hybrid frame, released with the wavefront pipeline.
+		void TraceRays(VkCommandBuffer commandBuffer, VkExtent2D extent);
+		void RecordTraceRays(VkCommandBuffer commandBuffer, const class ShaderBindingTable& shaderBindingTable, const Assets::FrameConstants& frameConstants, VkExtent2D extent);
+
+		// What the trace commands of a frame in flight were last recorded with, see TraceRays().
+		struct TraceRecording;
 
+		// The BLAS of a model paged through the geometry budget pool, see UpdateGeometryPaging().
+		struct PagedModel;
+		void TraceWavefront(VkCommandBuffer commandBuffer, VkExtent2D extent);
+		void CopyAsyncDenoiseImages(VkCommandBuffer commandBuffer, VkExtent2D extent);
+
+		struct PendingReadback final
+		{
+			std::unique_ptr<Buffer> HostBuffer;
+			std::unique_ptr<DeviceMemory> HostMemory;
+			VkExtent2D Extent{};
+			VkFormat Format{};
+			uint32_t LayerCount{}; // The views of the accumulation, one after the other.
+			uint64_t FrameValue{}; // The frame timeline value after which the host buffer can be read.
+			AccumulationReadback Callback;
+			ViewReadback ViewCallback;
+			OutputReadback OutputCallback;
+		};
+
+		void RecordReadback(VkCommandBuffer commandBuffer, PendingReadback& readback, const Image& image, const char* name);
+		static void CompleteReadback(PendingReadback& readback);
+
+		bool compactAccelerationStructures_{};
+		bool supportsInvocationReorder_{};
+		bool supportsRayQuery_{};
+		bool supportsSubgroupRayCounters_{};
+		bool supportsPipelineLibrary_{};
+		bool supportsHostBuild_{};
+		bool supportsUpdateAfterBind_{};
+		bool isPipelineVariantPending_{};
+
+		std::unique_ptr<Utilities::TaskSystem> taskSystem_;
 		std::unique_ptr<class DeviceProcedures> deviceProcedures_;
 		std::unique_ptr<class RayTracingProperties> rayTracingProperties_;
+		std::unique_ptr<class CommandPool> computeCommandPool_;
+		std::unique_ptr<class AccelerationStructureCache> cache_;
+		std::unique_ptr<class FrameTimestamps> frameTimestamps_;
+		std::unique_ptr<class FrameGraph> frameGraph_;
+
+		std::unique_ptr<CommandBuffers> buildCommandBuffers_;
+		std::unique_ptr<TimelineSemaphore> buildTimeline_; // Reaches 1 once the asynchronous build is done.
+		std::chrono::steady_clock::time_point buildStart_;
+		double buildTime_{-1};
+		VkDeviceSize buildBottomSize_{};
+		bool buildSemaphorePending_{};
 
 		std::vector<class BottomLevelAccelerationStructure> bottomAs_;
+		std::vector<uint32_t> modelBottomAs_;
+		bool hasMergedProcedurals_{};
 		std::unique_ptr<Buffer> bottomBuffer_;
 		std::unique_ptr<DeviceMemory> bottomBufferMemory_;
 		std::unique_ptr<Buffer> bottomScratchBuffer_;
 		std::unique_ptr<DeviceMemory> bottomScratchBufferMemory_;
+		std::unique_ptr<QueryPool> bottomCompactedSizeQueries_;
+		std::unique_ptr<QueryPool> bottomSerializedSizeQueries_;
+		std::unique_ptr<QueryPool> bottomBuildQueries_; // Timestamps around the BLAS builds, reset once read back.
+		std::unique_ptr<QueryPool> topBuildQueries_; // Timestamps around the TLAS build, reset once read back.
+		double bottomBuildTime_{-1};
+		double topBuildTime_{-1};
+		double instanceUploadTime_{-1};
+		std::unique_ptr<Buffer> bottomSerializedBuffer_;
+		std::unique_ptr<DeviceMemory> bottomSerializedBufferMemory_;
+		std::vector<std::string> bottomCacheKeys_;
+		uint32_t bottomCacheHits_{};
+		std::vector<class BottomLevelAccelerationStructure> bottomHostAs_; // The sources of the clones, until the build completes.
+		std::unique_ptr<Buffer> bottomHostBuffer_;
+		std::unique_ptr<DeviceMemory> bottomHostBufferMemory_;
+		uint32_t bottomHostBuilds_{};
+		double bottomHostBuildTime_{}; // milliseconds
+		uint32_t bottomBuildBatches_{};
+		std::unique_ptr<BottomLevelPager> pager_;
+		std::vector<PagedModel> pagedModels_; // One per page.
+		std::vector<uint32_t> modelPages_; // The page of every model, ~0 for the resident ones.
+		std::vector<glm::vec4> instanceSpheres_; // The world bounding sphere of every scene instance.
+		std::vector<std::vector<std::unique_ptr<class BottomLevelAccelerationStructure>>> retiredPages_; // Evicted by each frame slot, until it comes around again.
+		std::unique_ptr<Buffer> pageBuffer_;
+		std::unique_ptr<DeviceMemory> pageBufferMemory_;
+		std::unique_ptr<Buffer> pageScratchBuffer_;
+		std::unique_ptr<DeviceMemory> pageScratchBufferMemory_;
+		VkDeviceSize pageScratchSize_{};
+		std::unique_ptr<class DeformPipeline> deformPipeline_;
+		std::vector<uint32_t> deformedBottomAs_;
+		std::unique_ptr<Buffer> deformScratchBuffer_; // One build scratch slice per deformed BLAS, refitted or rebuilt by a single command.
+		std::unique_ptr<DeviceMemory> deformScratchBufferMemory_;
+		uint32_t deformRefits_{}; // Since the last rebuild.
 		std::vector<class TopLevelAccelerationStructure> topAs_;
 		std::unique_ptr<Buffer> topBuffer_;
 		std::unique_ptr<DeviceMemory> topBufferMemory_;
 		std::unique_ptr<Buffer> topScratchBuffer_;
 		std::unique_ptr<DeviceMemory> topScratchBufferMemory_;
+		std::unique_ptr<Buffer> topUpdateScratchBuffer_;
+		std::unique_ptr<DeviceMemory> topUpdateScratchBufferMemory_;
 		std::unique_ptr<Buffer> instancesBuffer_;
 		std::unique_ptr<DeviceMemory> instancesBufferMemory_;
+		std::vector<VkAccelerationStructureInstanceKHR> instances_;
+		std::unique_ptr<Buffer> instanceUploadBuffer_; // One persistently mapped slice of instances per frame in flight, only with updatable structures.
+		std::unique_ptr<DeviceMemory> instanceUploadBufferMemory_;
+		VkAccelerationStructureInstanceKHR* instanceUploads_{};
+		std::vector<std::pair<size_t, size_t>> instanceUploadRanges_; // The instances each slice lacks, empty when first == second.
 
 		std::unique_ptr<Image> accumulationImage_;
 		std::unique_ptr<DeviceMemory> accumulationImageMemory_;
 		std::unique_ptr<ImageView> accumulationImageView_;
+		std::unique_ptr<ImageView> viewAccumulationImageView_; // Every layer of the accumulation image, one per view.
 
 		std::unique_ptr<Image> outputImage_;
 		std::unique_ptr<DeviceMemory> outputImageMemory_;
 		std::unique_ptr<ImageView> outputImageView_;
+
+		std::unique_ptr<Image> momentImage_;
+		std::unique_ptr<DeviceMemory> momentImageMemory_;
+		std::unique_ptr<ImageView> momentImageView_;
+
+		std::unique_ptr<Buffer> tileBuffer_;
+		std::unique_ptr<DeviceMemory> tileBufferMemory_;
+		std::unique_ptr<class AdaptiveSamplingPipeline> adaptiveSamplingPipeline_;
+
+		std::unique_ptr<Image> sampleMapImage_;
+		std::unique_ptr<DeviceMemory> sampleMapImageMemory_;
+		std::unique_ptr<ImageView> sampleMapImageView_;
+		std::unique_ptr<class SampleMapPipeline> sampleMapPipeline_;
+
+		std::unique_ptr<Buffer> reservoirBuffer_;
+		std::unique_ptr<DeviceMemory> reservoirBufferMemory_;
+
+		std::unique_ptr<Buffer> radianceCacheBuffer_; // Lives with the ray tracing pipeline, the cells are in world space.
+		std::unique_ptr<DeviceMemory> radianceCacheBufferMemory_;
+		std::unique_ptr<class RadianceCachePipeline> radianceCachePipeline_;
+
+		std::unique_ptr<Buffer> pathGuidingBuffer_; // Same as the radiance cache.
+		std::unique_ptr<DeviceMemory> pathGuidingBufferMemory_;
+		std::unique_ptr<class PathGuidingPipeline> pathGuidingPipeline_;
+
+		std::unique_ptr<Image> albedoImage_;
+		std::unique_ptr<DeviceMemory> albedoImageMemory_;
+		std::unique_ptr<ImageView> albedoImageView_;
+
+		std::unique_ptr<Image> normalDepthImage_;
+		std::unique_ptr<DeviceMemory> normalDepthImageMemory_;
+		std::unique_ptr<ImageView> normalDepthImageView_;
+
+		std::unique_ptr<Image> filteredImages_[2];
+		std::unique_ptr<DeviceMemory> filteredImageMemories_[2];
+		std::unique_ptr<ImageView> filteredImageViews_[2];
+		std::unique_ptr<class DenoisePipeline> denoisePipeline_;
+
+		// With asyncDenoise_, the copies of the denoiser inputs (accumulation, albedo, normal and depth, moments) it reads on the compute
+		// queue while the next frame is traced, and the image it writes, copied into the output image of the next frame.
+		std::unique_ptr<Image> denoiseInputImages_[4];
+		std::unique_ptr<DeviceMemory> denoiseInputImageMemories_[4];
+		std::unique_ptr<ImageView> denoiseInputImageViews_[4];
+		std::unique_ptr<Image> denoisedImage_;
+		std::unique_ptr<DeviceMemory> denoisedImageMemory_;
+		std::unique_ptr<ImageView> denoisedImageView_;
+		std::unique_ptr<class CommandPool> denoiseCommandPool_;
+		std::unique_ptr<CommandBuffers> denoiseCommandBuffers_; // One per frame in flight.
+		std::unique_ptr<TimelineSemaphore> denoiseTimeline_; // Reaches the frame timeline value of a frame once its denoise is done.
+		std::unique_ptr<class FrameTimestamps> denoiseTimestamps_;
+		std::unique_ptr<class FrameGraph> denoiseGraph_; // The image barriers of the compute queue.
+		std::vector<uint64_t> denoiseSlotValues_; // The last denoise submitted from each frame slot.
+		uint64_t denoiseValue_{}; // Of the last denoise submitted since the images were created, 0 if none.
+		uint32_t pendingDenoiseIterations_{}; // Recorded by Render(), for OnFrameSubmitted() to dispatch.
+
+		std::unique_ptr<Image> upscaledImages_[2];
+		std::unique_ptr<DeviceMemory> upscaledImageMemories_[2];
+		std::unique_ptr<ImageView> upscaledImageViews_[2];
+		std::unique_ptr<class UpscalePipeline> upscalePipeline_;
+		VkExtent2D renderExtent_{};
+		VkExtent2D offlineExtent_{};
+		VkExtent2D offlineTileCount_{};
+		uint32_t offlineTileSize_{};
+
+		std::unique_ptr<Image> historyImage_;
+		std::unique_ptr<DeviceMemory> historyImageMemory_;
+		std::unique_ptr<ImageView> historyImageView_;
+
+		std::unique_ptr<Image> historyMomentImage_;
+		std::unique_ptr<DeviceMemory> historyMomentImageMemory_;
+		std::unique_ptr<ImageView> historyMomentImageView_;
+
+		std::unique_ptr<Image> previousNormalDepthImage_;
+		std::unique_ptr<DeviceMemory> previousNormalDepthImageMemory_;
+		std::unique_ptr<ImageView> previousNormalDepthImageView_;
+
+		std::unique_ptr<Buffer> textureRequestBuffer_;
+		std::unique_ptr<DeviceMemory> textureRequestBufferMemory_;
+		int32_t* textureRequests_{};
+		VkDeviceSize textureRequestStride_{};
+
+		std::unique_ptr<Buffer> stageClockBuffer_;
+		std::unique_ptr<DeviceMemory> stageClockBufferMemory_;
+		uint32_t* stageClocks_{};
+		VkDeviceSize stageClockStride_{};
+
+		std::unique_ptr<Buffer> rayCounterBuffer_;
+		std::unique_ptr<DeviceMemory> rayCounterBufferMemory_;
+		uint32_t* rayCounters_{};
+		VkDeviceSize rayCounterStride_{};
+
+		AccumulationReadback requestedReadback_;
+		ViewReadback requestedViewReadback_;
+		std::vector<PendingReadback> readbacks_; // One per frame in flight.
+		OutputReadback requestedOutputReadback_;
+		std::vector<PendingReadback> outputReadbacks_; // Same.
+		std::vector<float> requestedUpload_;
+		std::unique_ptr<Buffer> uploadBuffer_; // Kept until the swap chain goes, the frame copying it may still be in flight.
+		std::unique_ptr<DeviceMemory> uploadBufferMemory_;
 		
 		std::unique_ptr<class RayTracingPipeline> rayTracingPipeline_;
-		std::unique_ptr<class ShaderBindingTable> shaderBindingTable_;
+		std::vector<std::unique_ptr<class ShaderBindingTable>> shaderBindingTables_; // One per pipeline variant.
+		std::unique_ptr<CommandBuffers> traceCommandBuffers_; // Secondary, one per frame in flight.
+		std::vector<TraceRecording> traceRecordings_;
+		std::unique_ptr<class WavefrontPipeline> wavefrontPipeline_;
+		std::unique_ptr<VisibilityPipeline> visibilityPipeline_;
 	};
 
 }
@@ -1,17 +1,21 @@
 #include "BottomLevelAccelerationStructure.hpp"
+#include "DeferredOperation.hpp"
 #include "DeviceProcedures.hpp"
 #include "Assets/Scene.hpp"
 #include "Assets/Vertex.hpp"
 #include "Utilities/Exception.hpp"
 #include "Vulkan/Buffer.hpp"
+#include "Vulkan/Device.hpp"
 
 namespace Vulkan::RayTracing {
 
 BottomLevelAccelerationStructure::BottomLevelAccelerationStructure(
 	const class DeviceProcedures& deviceProcedures,
 	const class RayTracingProperties& rayTracingProperties,
-	const BottomLevelGeometry& geometries) :
-	AccelerationStructure(deviceProcedures, rayTracingProperties),
+	const BottomLevelGeometry& geometries,
+	const VkBuildAccelerationStructureFlagsKHR flags,
+	const VkAccelerationStructureBuildTypeKHR buildType) :
+	AccelerationStructure(deviceProcedures, rayTracingProperties, flags),
 	geometries_(geometries)
 {
 	buildGeometryInfo_.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
@@ -29,7 +33,43 @@ BottomLevelAccelerationStructure::BottomLevelAccelerationStructure(
 		maxPrimCount[i] = geometries_.BuildOffsetInfo()[i].primitiveCount;
 	}
 	
-	buildSizesInfo_ = GetBuildSizes(maxPrimCount.data());
+	buildSizesInfo_ = GetBuildSizes(maxPrimCount.data(), buildType);
+}
+
+BottomLevelAccelerationStructure::BottomLevelAccelerationStructure(
+	const class DeviceProcedures& deviceProcedures,
+	const class RayTracingProperties& rayTracingProperties,
+	const BottomLevelGeometry& geometries,
+	const VkBuildAccelerationStructureFlagsKHR flags,
+	const VkDeviceSize deserializedSize) :
+	AccelerationStructure(deviceProcedures, rayTracingProperties, flags),
+	geometries_(geometries)
+{
+	// Restored from a serialized copy or cloned, nothing gets built hence no scratch memory is needed.
+	// The given size must already be rounded up to the 256 bytes alignment.
+	buildGeometryInfo_.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+	buildGeometryInfo_.flags = flags_;
+	buildGeometryInfo_.geometryCount = static_cast<uint32_t>(geometries_.Geometry().size());
+	buildGeometryInfo_.pGeometries = geometries_.Geometry().data();
+	buildGeometryInfo_.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+	buildGeometryInfo_.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+	buildGeometryInfo_.srcAccelerationStructure = nullptr;
+
+	buildSizesInfo_.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+	buildSizesInfo_.accelerationStructureSize = deserializedSize;
+}
+
+BottomLevelAccelerationStructure::BottomLevelAccelerationStructure(const BottomLevelAccelerationStructure& source, const VkDeviceSize compactedSize) :
+	AccelerationStructure(source.DeviceProcedures(), source.RayTracingProperties(), source.Flags()),
+	geometries_(source.geometries_)
+{
+	// Same geometry description as the source, only the storage size differs.
+	buildGeometryInfo_ = source.buildGeometryInfo_;
+	buildGeometryInfo_.pGeometries = geometries_.Geometry().data();
+	buildGeometryInfo_.dstAccelerationStructure = nullptr;
+
+	buildSizesInfo_ = source.buildSizesInfo_;
+	buildSizesInfo_.accelerationStructureSize = compactedSize;
 }
 
 BottomLevelAccelerationStructure::BottomLevelAccelerationStructure(BottomLevelAccelerationStructure&& other) noexcept :
@@ -42,8 +82,7 @@ BottomLevelAccelerationStructure::~BottomLevelAccelerationStructure()
 {
 }
 
-void BottomLevelAccelerationStructure::Generate(
-	VkCommandBuffer commandBuffer,
+const VkAccelerationStructureBuildGeometryInfoKHR& BottomLevelAccelerationStructure::PrepareBuild(
 	Buffer& scratchBuffer,
 	const VkDeviceSize scratchOffset,
 	Buffer& resultBuffer,
@@ -52,13 +91,128 @@ void BottomLevelAccelerationStructure::Generate(
 	// Create the acceleration structure.
 	CreateAccelerationStructure(resultBuffer, resultOffset);
 
-	// Build the actual bottom-level acceleration structure
+	// The build of the actual bottom-level acceleration structure.
+	buildGeometryInfo_.dstAccelerationStructure = Handle();
+	buildGeometryInfo_.scratchData.deviceAddress = scratchBuffer.GetDeviceAddress() + scratchOffset;
+
+	return buildGeometryInfo_;
+}
+
+void BottomLevelAccelerationStructure::GenerateOnHost(
+	Utilities::TaskSystem& tasks,
+	Buffer& resultBuffer,
+	const VkDeviceSize resultOffset)
+{
+	// Create the acceleration structure.
+	CreateAccelerationStructure(resultBuffer, resultOffset);
+
+	// The scratch memory is plain host memory, only needed for the duration of the build.
 	const VkAccelerationStructureBuildRangeInfoKHR* pBuildOffsetInfo = geometries_.BuildOffsetInfo().data();
+	std::vector<uint8_t> scratch(BuildSizes().buildScratchSize);
 
 	buildGeometryInfo_.dstAccelerationStructure = Handle();
-	buildGeometryInfo_.scratchData.deviceAddress = scratchBuffer.GetDeviceAddress() + scratchOffset;
+	buildGeometryInfo_.scratchData.hostAddress = scratch.data();
+
+	Check(DeferredOperation::Run(deviceProcedures_, tasks, [this, pBuildOffsetInfo](const VkDeferredOperationKHR deferredOperation)
+	{
+		return deviceProcedures_.vkBuildAccelerationStructuresKHR(Device().Handle(), deferredOperation, 1, &buildGeometryInfo_, &pBuildOffsetInfo);
+	}), "build acceleration structure on host");
+
+	buildGeometryInfo_.scratchData.hostAddress = nullptr;
+}
+
+void BottomLevelAccelerationStructure::Update(
+	VkCommandBuffer commandBuffer,
+	Buffer& scratchBuffer,
+	const VkDeviceSize scratchOffset)
+{
+	// Refit the bottom-level acceleration structure to the current vertex positions.
+	const VkAccelerationStructureBuildRangeInfoKHR* pBuildOffsetInfo = geometries_.BuildOffsetInfo().data();
+	const auto updateInfo = GetUpdateGeometryInfo(scratchBuffer, scratchOffset);
+
+	deviceProcedures_.vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &updateInfo, &pBuildOffsetInfo);
+}
+
+VkAccelerationStructureBuildGeometryInfoKHR BottomLevelAccelerationStructure::PrepareUpdate(Buffer& scratchBuffer, const VkDeviceSize scratchOffset) const
+{
+	return GetUpdateGeometryInfo(scratchBuffer, scratchOffset);
+}
+
+VkAccelerationStructureBuildGeometryInfoKHR BottomLevelAccelerationStructure::PrepareRebuild(Buffer& scratchBuffer, const VkDeviceSize scratchOffset) const
+{
+	// Same as the refit, but from scratch into the same storage, the refits having only moved the bounds of the initial hierarchy.
+	auto rebuildInfo = GetUpdateGeometryInfo(scratchBuffer, scratchOffset);
+	rebuildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+	rebuildInfo.srcAccelerationStructure = nullptr;
+
+	return rebuildInfo;
+}
+
+void BottomLevelAccelerationStructure::Compact(
+	VkCommandBuffer commandBuffer,
+	const BottomLevelAccelerationStructure& source,
+	Buffer& resultBuffer,
+	const VkDeviceSize resultOffset)
+{
+	// Create the acceleration structure.
+	CreateAccelerationStructure(resultBuffer, resultOffset);
+
+	// Copy the source structure into its tightly packed storage.
+	VkCopyAccelerationStructureInfoKHR copyInfo = {};
+	copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+	copyInfo.src = source.Handle();
+	copyInfo.dst = Handle();
+	copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+
+	deviceProcedures_.vkCmdCopyAccelerationStructureKHR(commandBuffer, &copyInfo);
+}
+
+void BottomLevelAccelerationStructure::Clone(
+	VkCommandBuffer commandBuffer,
+	const BottomLevelAccelerationStructure& source,
+	Buffer& resultBuffer,
+	const VkDeviceSize resultOffset)
+{
+	// Create the acceleration structure.
+	CreateAccelerationStructure(resultBuffer, resultOffset);
+
+	VkCopyAccelerationStructureInfoKHR copyInfo = {};
+	copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+	copyInfo.src = source.Handle();
+	copyInfo.dst = Handle();
+	copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_CLONE_KHR;
+
+	deviceProcedures_.vkCmdCopyAccelerationStructureKHR(commandBuffer, &copyInfo);
+}
+
+void BottomLevelAccelerationStructure::Serialize(VkCommandBuffer commandBuffer, const VkDeviceAddress serializedAddress) const
+{
+	VkCopyAccelerationStructureToMemoryInfoKHR copyInfo = {};
+	copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR;
+	copyInfo.src = Handle();
+	copyInfo.dst.deviceAddress = serializedAddress;
+	copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR;
+
+	deviceProcedures_.vkCmdCopyAccelerationStructureToMemoryKHR(commandBuffer, &copyInfo);
+}
+
+void BottomLevelAccelerationStructure::Deserialize(
+	VkCommandBuffer commandBuffer,
+	const VkDeviceAddress serializedAddress,
+	Buffer& resultBuffer,
+	const VkDeviceSize resultOffset)
+{
+	// Create the acceleration structure.
+	CreateAccelerationStructure(resultBuffer, resultOffset);
+
+	// Restore the structure from its serialized copy.
+	VkCopyMemoryToAccelerationStructureInfoKHR copyInfo = {};
+	copyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_ACCELERATION_STRUCTURE_INFO_KHR;
+	copyInfo.src.deviceAddress = serializedAddress;
+	copyInfo.dst = Handle();
+	copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_DESERIALIZE_KHR;
 
-	deviceProcedures_.vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &buildGeometryInfo_, &pBuildOffsetInfo);
+	deviceProcedures_.vkCmdCopyMemoryToAccelerationStructureKHR(commandBuffer, &copyInfo);
 }
 
 }
@@ -9,6 +9,11 @@ namespace Assets
 	class Scene;
 }
 
+namespace Utilities
+{
+	class TaskSystem;
+}
+
 namespace Vulkan::RayTracing
 {
 
@@ -23,17 +28,67 @@ namespace Vulkan::RayTracing
 		BottomLevelAccelerationStructure(
 			const class DeviceProcedures& deviceProcedures, 
 			const class RayTracingProperties& rayTracingProperties, 
-			const BottomLevelGeometry& geometries);
+			const BottomLevelGeometry& geometries,
+			VkBuildAccelerationStructureFlagsKHR flags,
+			VkAccelerationStructureBuildTypeKHR buildType = VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR);
+		BottomLevelAccelerationStructure(
+			const class DeviceProcedures& deviceProcedures,
+			const class RayTracingProperties& rayTracingProperties,
+			const BottomLevelGeometry& geometries,
+			VkBuildAccelerationStructureFlagsKHR flags,
+			VkDeviceSize deserializedSize);
+		BottomLevelAccelerationStructure(const BottomLevelAccelerationStructure& source, VkDeviceSize compactedSize);
 		BottomLevelAccelerationStructure(BottomLevelAccelerationStructure&& other) noexcept;
 		~BottomLevelAccelerationStructure();
 
-		void Generate(
-			VkCommandBuffer commandBuffer,
+		// Creates the structure, its build is then recorded along with the others of the batch by a single vkCmdBuildAccelerationStructuresKHR.
+		const VkAccelerationStructureBuildGeometryInfoKHR& PrepareBuild(
 			Buffer& scratchBuffer,
 			VkDeviceSize scratchOffset,
 			Buffer& resultBuffer,
 			VkDeviceSize resultOffset);
 
+		const VkAccelerationStructureBuildRangeInfoKHR* BuildRanges() const { return geometries_.BuildOffsetInfo().data(); }
+
+		// Builds the structure right away on the CPU (accelerationStructureHostCommands), the geometries having host addresses.
+		// The result buffer must be bound to host visible memory, the build joined by the task system (see DeferredOperation).
+		void GenerateOnHost(
+			Utilities::TaskSystem& tasks,
+			Buffer& resultBuffer,
+			VkDeviceSize resultOffset);
+
+		void Update(
+			VkCommandBuffer commandBuffer,
+			Buffer& scratchBuffer,
+			VkDeviceSize scratchOffset);
+
+		// The refit and the in place rebuild of a structure built with ALLOW_UPDATE, from its current vertex positions, to be recorded
+		// along with BuildRanges() by a single vkCmdBuildAccelerationStructuresKHR. The rebuild needs the build scratch size and is
+		// not valid once compacted.
+		VkAccelerationStructureBuildGeometryInfoKHR PrepareUpdate(Buffer& scratchBuffer, VkDeviceSize scratchOffset) const;
+		VkAccelerationStructureBuildGeometryInfoKHR PrepareRebuild(Buffer& scratchBuffer, VkDeviceSize scratchOffset) const;
+
+		void Compact(
+			VkCommandBuffer commandBuffer,
+			const BottomLevelAccelerationStructure& source,
+			Buffer& resultBuffer,
+			VkDeviceSize resultOffset);
+
+		// Copies a structure of the same size, e.g. built on the host, into this one.
+		void Clone(
+			VkCommandBuffer commandBuffer,
+			const BottomLevelAccelerationStructure& source,
+			Buffer& resultBuffer,
+			VkDeviceSize resultOffset);
+
+		void Serialize(VkCommandBuffer commandBuffer, VkDeviceAddress serializedAddress) const;
+
+		void Deserialize(
+			VkCommandBuffer commandBuffer,
+			VkDeviceAddress serializedAddress,
+			Buffer& resultBuffer,
+			VkDeviceSize resultOffset);
+
 	private:
 
 		BottomLevelGeometry geometries_;
@@ -1,7 +1,8 @@
 #include "BottomLevelGeometry.hpp"
 #include "DeviceProcedures.hpp"
+#include "Assets/Model.hpp"
 #include "Assets/Scene.hpp"
-#include "Assets/Vertex.hpp"
+#include "Assets/VertexLayout.hpp"
 #include "Vulkan/Buffer.hpp"
 
 namespace Vulkan::RayTracing {
@@ -10,6 +11,7 @@ void BottomLevelGeometry::AddGeometryTriangles(
 	const Assets::Scene& scene,
 	const uint32_t vertexOffset, const uint32_t vertexCount,
 	const uint32_t indexOffset, const uint32_t indexCount,
+	const VkIndexType indexType,
 	const bool isOpaque)
 {
 	VkAccelerationStructureGeometryKHR geometry = {};
@@ -18,17 +20,18 @@ void BottomLevelGeometry::AddGeometryTriangles(
 	geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
 	geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
 	geometry.geometry.triangles.pNext = nullptr;
-	geometry.geometry.triangles.vertexData.deviceAddress = scene.VertexBuffer().GetDeviceAddress();
-	geometry.geometry.triangles.vertexStride = sizeof(Assets::Vertex);
+	// Every layout keeps full precision positions (see Assets::IsValidVertexLayout()).
+	geometry.geometry.triangles.vertexData.deviceAddress = scene.HasPositionBuffer() ? scene.PositionBuffer().GetDeviceAddress() : scene.VertexBuffer().GetDeviceAddress() + scene.VertexPositionOffset();
+	geometry.geometry.triangles.vertexStride = scene.HasPositionBuffer() ? sizeof(glm::vec3) : scene.VertexStride();
 	geometry.geometry.triangles.maxVertex = vertexCount;
-	geometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+	geometry.geometry.triangles.vertexFormat = Assets::VertexLayout<Assets::Vertex>::Position.Format;
 	geometry.geometry.triangles.indexData.deviceAddress = scene.IndexBuffer().GetDeviceAddress();
-	geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+	geometry.geometry.triangles.indexType = indexType;
 	geometry.geometry.triangles.transformData = {};
 	geometry.flags = isOpaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : 0;
 
 	VkAccelerationStructureBuildRangeInfoKHR buildOffsetInfo = {};
-	buildOffsetInfo.firstVertex = vertexOffset / sizeof(Assets::Vertex);
+	buildOffsetInfo.firstVertex = vertexOffset / scene.VertexStride(); // The position buffer has the same vertex offsets.
 	buildOffsetInfo.primitiveOffset = indexOffset;
 	buildOffsetInfo.primitiveCount = indexCount / 3;
 	buildOffsetInfo.transformOffset = 0;
@@ -37,6 +40,33 @@ void BottomLevelGeometry::AddGeometryTriangles(
 	buildOffsetInfo_.emplace_back(buildOffsetInfo);
 }
 
+void BottomLevelGeometry::AddHostGeometryTriangles(const Assets::Model& model, const bool isOpaque)
+{
+	VkAccelerationStructureGeometryKHR geometry = {};
+	geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+	geometry.pNext = nullptr;
+	geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+	geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+	geometry.geometry.triangles.pNext = nullptr;
+	geometry.geometry.triangles.vertexData.hostAddress = reinterpret_cast<const char*>(model.Vertices().data()) + Assets::VertexLayout<Assets::Vertex>::Position.Offset;
+	geometry.geometry.triangles.vertexStride = Assets::VertexLayout<Assets::Vertex>::Stride;
+	geometry.geometry.triangles.maxVertex = static_cast<uint32_t>(model.Vertices().size());
+	geometry.geometry.triangles.vertexFormat = Assets::VertexLayout<Assets::Vertex>::Position.Format;
+	geometry.geometry.triangles.indexData.hostAddress = model.Indices().data();
+	geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+	geometry.geometry.triangles.transformData = {};
+	geometry.flags = isOpaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : 0;
+
+	VkAccelerationStructureBuildRangeInfoKHR buildOffsetInfo = {};
+	buildOffsetInfo.firstVertex = 0;
+	buildOffsetInfo.primitiveOffset = 0;
+	buildOffsetInfo.primitiveCount = static_cast<uint32_t>(model.Indices().size()) / 3;
+	buildOffsetInfo.transformOffset = 0;
+
+	geometry_.emplace_back(geometry);
+	buildOffsetInfo_.emplace_back(buildOffsetInfo);
+}
+
 void BottomLevelGeometry::AddGeometryAabb(
 	const Assets::Scene& scene,
 	const uint32_t aabbOffset,
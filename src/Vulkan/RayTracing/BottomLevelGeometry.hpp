@@ -5,6 +5,7 @@
 
 namespace Assets
 {
+	class Model;
 	class Procedural;
 	class Scene;
 }
@@ -25,8 +26,14 @@ namespace Vulkan::RayTracing
 			const Assets::Scene& scene,
 			uint32_t vertexOffset,
 			uint32_t vertexCount,
-			uint32_t indexOffset, 
+			uint32_t indexOffset, // In bytes.
 			uint32_t indexCount,
+			VkIndexType indexType,
+			bool isOpaque);
+
+		// The same triangles read from the host vertices and indices of the model, for the builds on the host.
+		void AddHostGeometryTriangles(
+			const Assets::Model& model,
 			bool isOpaque);
 
 		void AddGeometryAabb(
@@ -0,0 +1,169 @@
+#include "BottomLevelPager.hpp"
+#include <algorithm>
+
+namespace Vulkan::RayTracing {
+
+namespace
+{
+	// How many times more a missing page has to be wanted than a resident one to evict it.
+	constexpr float EvictionMargin = 1.5f;
+}
+
+BottomLevelPager::BottomLevelPager(const VkDeviceSize poolSize) :
+	poolSize_(poolSize)
+{
+	if (poolSize_ != 0)
+	{
+		freeRanges_.emplace(0, poolSize_);
+	}
+}
+
+uint32_t BottomLevelPager::AddPage(const VkDeviceSize size, const VkDeviceSize scratchSize)
+{
+	pages_.push_back({ size, scratchSize, 0, 0, 0, false });
+
+	return static_cast<uint32_t>(pages_.size() - 1);
+}
+
+void BottomLevelPager::Update(const std::vector<float>& priorities, const VkDeviceSize scratchBudget, std::vector<uint32_t>& evicted, std::vector<uint32_t>& pagedIn)
+{
+	evicted.clear();
+	pagedIn.clear();
+	++update_;
+
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> victims;
+
+	for (uint32_t i = 0; i != pages_.size(); ++i)
+	{
+		auto& page = pages_[i];
+
+		page.Priority = priorities[i];
+		page.LastWanted = page.Priority > 0 ? update_ : page.LastWanted;
+
+		if (page.IsResident)
+		{
+			victims.push_back(i);
+		}
+		else if (page.Priority > 0 && page.Size <= poolSize_)
+		{
+			candidates.push_back(i);
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [this](const uint32_t a, const uint32_t b)
+	{
+		return pages_[a].Priority > pages_[b].Priority;
+	});
+
+	std::sort(victims.begin(), victims.end(), [this](const uint32_t a, const uint32_t b)
+	{
+		return pages_[a].Priority != pages_[b].Priority ? pages_[a].Priority < pages_[b].Priority : pages_[a].LastWanted < pages_[b].LastWanted;
+	});
+
+	size_t nextVictim = 0;
+	VkDeviceSize scratchSize = 0;
+
+	for (const auto candidate : candidates)
+	{
+		auto& page = pages_[candidate];
+
+		if (scratchSize + page.ScratchSize > scratchBudget)
+		{
+			break;
+		}
+
+		// Only start evicting when the free memory and the victims would make room, fragmentation aside.
+		VkDeviceSize available = poolSize_ - usedSize_;
+
+		for (size_t i = nextVictim; i != victims.size() && available < page.Size && pages_[victims[i]].Priority * EvictionMargin < page.Priority; ++i)
+		{
+			available += pages_[victims[i]].Size;
+		}
+
+		if (available < page.Size)
+		{
+			continue;
+		}
+
+		while (!Allocate(page) && nextVictim != victims.size() && pages_[victims[nextVictim]].Priority * EvictionMargin < page.Priority)
+		{
+			Free(pages_[victims[nextVictim]]);
+			evicted.push_back(victims[nextVictim++]);
+		}
+
+		if (page.IsResident)
+		{
+			scratchSize += page.ScratchSize;
+			pagedIn.push_back(candidate);
+		}
+	}
+
+	pageIns_ += pagedIn.size();
+	evictions_ += evicted.size();
+}
+
+BottomLevelPager::Statistics BottomLevelPager::GetStatistics() const
+{
+	const auto resident = std::count_if(pages_.begin(), pages_.end(), [](const Page& page) { return page.IsResident; });
+
+	return { PageCount(), static_cast<uint32_t>(resident), poolSize_, usedSize_, pageIns_, evictions_ };
+}
+
+bool BottomLevelPager::Allocate(Page& page)
+{
+	for (auto i = freeRanges_.begin(); i != freeRanges_.end(); ++i)
+	{
+		if (i->second < page.Size)
+		{
+			continue;
+		}
+
+		const auto [offset, size] = *i;
+
+		freeRanges_.erase(i);
+
+		if (size != page.Size)
+		{
+			freeRanges_.emplace(offset + page.Size, size - page.Size);
+		}
+
+		page.Offset = offset;
+		page.IsResident = true;
+		usedSize_ += page.Size;
+
+		return true;
+	}
+
+	return false;
+}
+
+void BottomLevelPager::Free(Page& page)
+{
+	auto range = freeRanges_.emplace(page.Offset, page.Size).first;
+
+	// Merge with the free ranges right after and right before.
+	const auto next = std::next(range);
+
+	if (next != freeRanges_.end() && range->first + range->second == next->first)
+	{
+		range->second += next->second;
+		freeRanges_.erase(next);
+	}
+
+	if (range != freeRanges_.begin())
+	{
+		const auto previous = std::prev(range);
+
+		if (previous->first + previous->second == range->first)
+		{
+			previous->second += range->second;
+			freeRanges_.erase(range);
+		}
+	}
+
+	page.IsResident = false;
+	usedSize_ -= page.Size;
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace Vulkan::RayTracing
+{
+	// Decides which of the paged bottom level acceleration structures live in the fixed pool of device memory (see --geometry-budget),
+	// the others being traced through their proxy. The pages are placed first fit in the pool, which merges its free ranges back.
+	// Every update pages in the most wanted missing pages as long as their build scratch memory fits, evicting for them the resident
+	// pages that are wanted less, the least recently wanted first. Only pages wanted well over their victims evict them, so that two
+	// pages of about the same priority do not keep swapping. Host side only, the application builds and releases the structures.
+	class BottomLevelPager final
+	{
+	public:
+
+		struct Statistics final
+		{
+			uint32_t PageCount;
+			uint32_t ResidentPages;
+			VkDeviceSize PoolSize;
+			VkDeviceSize UsedSize;
+			uint64_t PageIns; // Since the pager was created.
+			uint64_t Evictions;
+		};
+
+		explicit BottomLevelPager(VkDeviceSize poolSize);
+
+		// A page of the given structure size and build scratch size, both already aligned. Returns its index.
+		uint32_t AddPage(VkDeviceSize size, VkDeviceSize scratchSize);
+
+		uint32_t PageCount() const { return static_cast<uint32_t>(pages_.size()); }
+		bool IsResident(const uint32_t page) const { return pages_[page].IsResident; }
+		VkDeviceSize Offset(const uint32_t page) const { return pages_[page].Offset; } // In the pool, when resident.
+
+		// The priorities of the pages for this frame (0 = not wanted), at most scratchBudget of build scratch memory being paged in.
+		// Returns the evicted pages then the paged in ones, both to be applied before the next update.
+		void Update(const std::vector<float>& priorities, VkDeviceSize scratchBudget, std::vector<uint32_t>& evicted, std::vector<uint32_t>& pagedIn);
+
+		Statistics GetStatistics() const;
+
+	private:
+
+		struct Page final
+		{
+			VkDeviceSize Size;
+			VkDeviceSize ScratchSize;
+			VkDeviceSize Offset;
+			float Priority;
+			uint64_t LastWanted; // The last update the page had a non zero priority.
+			bool IsResident;
+		};
+
+		bool Allocate(Page& page);
+		void Free(Page& page);
+
+		const VkDeviceSize poolSize_;
+		std::vector<Page> pages_;
+		std::map<VkDeviceSize, VkDeviceSize> freeRanges_; // Offset to size, never adjacent.
+		VkDeviceSize usedSize_{};
+		uint64_t update_{};
+		uint64_t pageIns_{};
+		uint64_t evictions_{};
+	};
+
+}
@@ -0,0 +1,85 @@
+#include "DeferredOperation.hpp"
+#include "DeviceProcedures.hpp"
+#include "Utilities/TaskSystem.hpp"
+#include "Vulkan/Device.hpp"
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+namespace Vulkan::RayTracing {
+
+namespace
+{
+	// Shared with the joining tasks, which may only get to run once the operation has completed.
+	struct SharedOperation final
+	{
+		VULKAN_NON_COPIABLE(SharedOperation)
+
+		explicit SharedOperation(const DeviceProcedures& deviceProcedures) :
+			Procedures(deviceProcedures)
+		{
+			Check(deviceProcedures.vkCreateDeferredOperationKHR(deviceProcedures.Device().Handle(), nullptr, &Handle),
+				"create deferred operation");
+		}
+
+		~SharedOperation()
+		{
+			Procedures.vkDestroyDeferredOperationKHR(Procedures.Device().Handle(), Handle, nullptr);
+		}
+
+		// Returns VK_SUCCESS once the operation is complete, VK_THREAD_DONE_KHR when the other threads are finishing it.
+		VkResult Join() const
+		{
+			VkResult result;
+
+			while ((result = Procedures.vkDeferredOperationJoinKHR(Procedures.Device().Handle(), Handle)) == VK_THREAD_IDLE_KHR)
+			{
+				std::this_thread::yield();
+			}
+
+			return result;
+		}
+
+		const DeviceProcedures& Procedures;
+		VkDeferredOperationKHR Handle{};
+	};
+}
+
+VkResult DeferredOperation::Run(
+	const DeviceProcedures& deviceProcedures,
+	Utilities::TaskSystem& tasks,
+	const std::function<VkResult (VkDeferredOperationKHR operation)>& command)
+{
+	const auto device = deviceProcedures.Device().Handle();
+	const auto operation = std::make_shared<SharedOperation>(deviceProcedures);
+	const VkResult commandResult = command(operation->Handle);
+
+	if (commandResult != VK_OPERATION_DEFERRED_KHR)
+	{
+		return commandResult == VK_OPERATION_NOT_DEFERRED_KHR
+			? deviceProcedures.vkGetDeferredOperationResultKHR(device, operation->Handle)
+			: commandResult;
+	}
+
+	// The calling thread is one of the joining threads, the futures are not waited upon.
+	const uint32_t concurrency = std::max(1u, deviceProcedures.vkGetDeferredOperationMaxConcurrencyKHR(device, operation->Handle));
+	const uint32_t taskCount = std::min(concurrency - 1, tasks.ThreadCount());
+
+	for (uint32_t i = 0; i != taskCount; ++i)
+	{
+		tasks.Run([operation]() { operation->Join(); });
+	}
+
+	operation->Join();
+
+	VkResult result;
+
+	while ((result = deviceProcedures.vkGetDeferredOperationResultKHR(device, operation->Handle)) == VK_NOT_READY)
+	{
+		std::this_thread::yield();
+	}
+
+	return result;
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <functional>
+
+namespace Utilities
+{
+	class TaskSystem;
+}
+
+namespace Vulkan::RayTracing
+{
+	class DeviceProcedures;
+
+	// Runs a command taking a VkDeferredOperationKHR (VK_KHR_deferred_host_operations), e.g. a ray tracing pipeline creation.
+	// When the driver defers it, the calling thread joins the operation along with as many task system threads as it can use.
+	// The other tasks of the system can delay those threads, never the completion, since the calling thread keeps joining.
+	class DeferredOperation final
+	{
+	public:
+
+		// Returns the result of the operation, or the one of the command if it failed without being deferred.
+		static VkResult Run(
+			const DeviceProcedures& deviceProcedures,
+			Utilities::TaskSystem& tasks,
+			const std::function<VkResult (VkDeferredOperationKHR operation)>& command);
+	};
+
+}
@@ -0,0 +1,139 @@
+#include "DenoisePipeline.hpp"
+#include "Vulkan/DescriptorBinding.hpp"
+#include "Vulkan/DescriptorSetManager.hpp"
+#include "Vulkan/DescriptorSets.hpp"
+#include "Vulkan/Device.hpp"
+#include "Vulkan/ImageView.hpp"
+#include "Vulkan/PipelineCache.hpp"
+#include "Vulkan/PipelineLayout.hpp"
+#include "Vulkan/ShaderCache.hpp"
+#include "Vulkan/ShaderModule.hpp"
+#include <algorithm>
+
+namespace Vulkan::RayTracing {
+
+namespace
+{
+	struct DenoiseConstants final
+	{
+		uint32_t Iteration;
+		uint32_t IterationCount;
+	};
+
+	VkDescriptorImageInfo GetImageInfo(const ImageView& imageView)
+	{
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageView = imageView.Handle();
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		return imageInfo;
+	}
+}
+
+DenoisePipeline::DenoisePipeline(
+	const class Device& device,
+	const PipelineCache& pipelineCache,
+	const ImageView& accumulationImageView,
+	const ImageView& outputImageView,
+	const ImageView& albedoImageView,
+	const ImageView& normalDepthImageView,
+	const ImageView& momentImageView,
+	const ImageView& filteredImageView0,
+	const ImageView& filteredImageView1) :
+	device_(device)
+{
+	const std::vector<DescriptorBinding> descriptorBindings =
+	{
+		{0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{2, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{3, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{4, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{5, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT}
+	};
+
+	// One set per direction: accumulation to filtered 0, then filtered 0 to 1 and 1 to 0.
+	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, 3));
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	const VkDescriptorImageInfo inputImageInfos[] = { GetImageInfo(accumulationImageView), GetImageInfo(filteredImageView0), GetImageInfo(filteredImageView1) };
+	const VkDescriptorImageInfo filteredImageInfos[] = { GetImageInfo(filteredImageView0), GetImageInfo(filteredImageView1), GetImageInfo(filteredImageView0) };
+	const VkDescriptorImageInfo outputImageInfo = GetImageInfo(outputImageView);
+	const VkDescriptorImageInfo albedoImageInfo = GetImageInfo(albedoImageView);
+	const VkDescriptorImageInfo normalDepthImageInfo = GetImageInfo(normalDepthImageView);
+	const VkDescriptorImageInfo momentImageInfo = GetImageInfo(momentImageView);
+
+	for (uint32_t i = 0; i != 3; ++i)
+	{
+		const std::vector<VkWriteDescriptorSet> descriptorWrites =
+		{
+			descriptorSets.Bind(i, 0, inputImageInfos[i]),
+			descriptorSets.Bind(i, 1, filteredImageInfos[i]),
+			descriptorSets.Bind(i, 2, outputImageInfo),
+			descriptorSets.Bind(i, 3, albedoImageInfo),
+			descriptorSets.Bind(i, 4, normalDepthImageInfo),
+			descriptorSets.Bind(i, 5, momentImageInfo)
+		};
+
+		descriptorSets.UpdateDescriptors(i, descriptorWrites);
+	}
+
+	VkPushConstantRange constantsRange = {};
+	constantsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	constantsRange.offset = 0;
+	constantsRange.size = sizeof(DenoiseConstants);
+
+	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout(), { constantsRange }));
+
+	const auto& computeShader = device.Shaders().Get("Denoise.comp.spv");
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT);
+	pipelineInfo.layout = pipelineLayout_->Handle();
+
+	Check(vkCreateComputePipelines(device.Handle(), pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipeline_),
+		"create denoise pipeline");
+}
+
+DenoisePipeline::~DenoisePipeline()
+{
+	if (pipeline_ != nullptr)
+	{
+		vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
+		pipeline_ = nullptr;
+	}
+
+	pipelineLayout_.reset();
+	descriptorSetManager_.reset();
+}
+
+void DenoisePipeline::Dispatch(VkCommandBuffer commandBuffer, const VkExtent2D extent, const uint32_t iterationCount) const
+{
+	const uint32_t count = std::min(iterationCount, MaxIterations);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+
+	for (uint32_t i = 0; i != count; ++i)
+	{
+		if (i != 0)
+		{
+			VkMemoryBarrier iterationBarrier = {};
+			iterationBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			iterationBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			iterationBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &iterationBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		const DenoiseConstants constants = { i, count };
+		VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(i == 0 ? 0 : 1 + (i - 1) % 2) };
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(commandBuffer, (extent.width + 7) / 8, (extent.height + 7) / 8, 1);
+	}
+}
+
+}
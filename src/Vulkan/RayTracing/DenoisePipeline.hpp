@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <memory>
+
+namespace Vulkan
+{
+	class DescriptorSetManager;
+	class Device;
+	class ImageView;
+	class PipelineCache;
+	class PipelineLayout;
+}
+
+namespace Vulkan::RayTracing
+{
+	// Edge-avoiding a-trous filter of the accumulated image into the output image (see Denoise.comp).
+	// It is guided by the first hit albedo, normal and depth written by the ray generation shader, and by the luminance variance of the samples.
+	// The iterations ping-pong between two filtered images; the first one reads the accumulation image, the last one writes the output image.
+	class DenoisePipeline final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(DenoisePipeline)
+
+		static constexpr uint32_t MaxIterations = 5;
+
+		DenoisePipeline(
+			const Device& device,
+			const PipelineCache& pipelineCache,
+			const ImageView& accumulationImageView,
+			const ImageView& outputImageView,
+			const ImageView& albedoImageView,
+			const ImageView& normalDepthImageView,
+			const ImageView& momentImageView,
+			const ImageView& filteredImageView0,
+			const ImageView& filteredImageView1);
+		~DenoisePipeline();
+
+		// The barriers before the first iteration are left to the caller, the ones in between are inserted here.
+		void Dispatch(VkCommandBuffer commandBuffer, VkExtent2D extent, uint32_t iterationCount) const;
+
+	private:
+
+		const Device& device_;
+
+		VULKAN_HANDLE(VkPipeline, pipeline_)
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+	};
+
+}
@@ -27,12 +27,22 @@ DeviceProcedures::DeviceProcedures(const class Device& device) :
 	vkDestroyAccelerationStructureKHR(GetProcedure<PFN_vkDestroyAccelerationStructureKHR>(device, "vkDestroyAccelerationStructureKHR")),
 	vkGetAccelerationStructureBuildSizesKHR(GetProcedure<PFN_vkGetAccelerationStructureBuildSizesKHR>(device, "vkGetAccelerationStructureBuildSizesKHR")),
 	vkCmdBuildAccelerationStructuresKHR(GetProcedure<PFN_vkCmdBuildAccelerationStructuresKHR>(device, "vkCmdBuildAccelerationStructuresKHR")),
+	vkBuildAccelerationStructuresKHR(GetProcedure<PFN_vkBuildAccelerationStructuresKHR>(device, "vkBuildAccelerationStructuresKHR")),
 	vkCmdCopyAccelerationStructureKHR(GetProcedure<PFN_vkCmdCopyAccelerationStructureKHR>(device, "vkCmdCopyAccelerationStructureKHR")),
+	vkCmdCopyAccelerationStructureToMemoryKHR(GetProcedure<PFN_vkCmdCopyAccelerationStructureToMemoryKHR>(device, "vkCmdCopyAccelerationStructureToMemoryKHR")),
+	vkCmdCopyMemoryToAccelerationStructureKHR(GetProcedure<PFN_vkCmdCopyMemoryToAccelerationStructureKHR>(device, "vkCmdCopyMemoryToAccelerationStructureKHR")),
+	vkGetDeviceAccelerationStructureCompatibilityKHR(GetProcedure<PFN_vkGetDeviceAccelerationStructureCompatibilityKHR>(device, "vkGetDeviceAccelerationStructureCompatibilityKHR")),
 	vkCmdTraceRaysKHR(GetProcedure<PFN_vkCmdTraceRaysKHR>(device, "vkCmdTraceRaysKHR")),
+	vkCmdTraceRaysIndirectKHR(GetProcedure<PFN_vkCmdTraceRaysIndirectKHR>(device, "vkCmdTraceRaysIndirectKHR")),
 	vkCreateRayTracingPipelinesKHR(GetProcedure<PFN_vkCreateRayTracingPipelinesKHR>(device, "vkCreateRayTracingPipelinesKHR")),
 	vkGetRayTracingShaderGroupHandlesKHR(GetProcedure<PFN_vkGetRayTracingShaderGroupHandlesKHR>(device, "vkGetRayTracingShaderGroupHandlesKHR")),
 	vkGetAccelerationStructureDeviceAddressKHR(GetProcedure<PFN_vkGetAccelerationStructureDeviceAddressKHR>(device, "vkGetAccelerationStructureDeviceAddressKHR")),
 	vkCmdWriteAccelerationStructuresPropertiesKHR(GetProcedure<PFN_vkCmdWriteAccelerationStructuresPropertiesKHR>(device, "vkCmdWriteAccelerationStructuresPropertiesKHR")),
+	vkCreateDeferredOperationKHR(GetProcedure<PFN_vkCreateDeferredOperationKHR>(device, "vkCreateDeferredOperationKHR")),
+	vkDestroyDeferredOperationKHR(GetProcedure<PFN_vkDestroyDeferredOperationKHR>(device, "vkDestroyDeferredOperationKHR")),
+	vkGetDeferredOperationMaxConcurrencyKHR(GetProcedure<PFN_vkGetDeferredOperationMaxConcurrencyKHR>(device, "vkGetDeferredOperationMaxConcurrencyKHR")),
+	vkGetDeferredOperationResultKHR(GetProcedure<PFN_vkGetDeferredOperationResultKHR>(device, "vkGetDeferredOperationResultKHR")),
+	vkDeferredOperationJoinKHR(GetProcedure<PFN_vkDeferredOperationJoinKHR>(device, "vkDeferredOperationJoinKHR")),
 	device_(device)
 {
 }
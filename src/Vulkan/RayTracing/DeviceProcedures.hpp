@@ -48,11 +48,35 @@ namespace Vulkan
 				const VkAccelerationStructureBuildRangeInfoKHR* const* ppBuildRangeInfos)>
 			vkCmdBuildAccelerationStructuresKHR;
 
+			const std::function<VkResult(
+				VkDevice device,
+				VkDeferredOperationKHR deferredOperation,
+				uint32_t infoCount,
+				const VkAccelerationStructureBuildGeometryInfoKHR* pInfos,
+				const VkAccelerationStructureBuildRangeInfoKHR* const* ppBuildRangeInfos)>
+			vkBuildAccelerationStructuresKHR;
+
 			const std::function<void(
 				VkCommandBuffer commandBuffer,
 				const VkCopyAccelerationStructureInfoKHR* pInfo)>
 			vkCmdCopyAccelerationStructureKHR;
 
+			const std::function<void(
+				VkCommandBuffer commandBuffer,
+				const VkCopyAccelerationStructureToMemoryInfoKHR* pInfo)>
+			vkCmdCopyAccelerationStructureToMemoryKHR;
+
+			const std::function<void(
+				VkCommandBuffer commandBuffer,
+				const VkCopyMemoryToAccelerationStructureInfoKHR* pInfo)>
+			vkCmdCopyMemoryToAccelerationStructureKHR;
+
+			const std::function<void(
+				VkDevice device,
+				const VkAccelerationStructureVersionInfoKHR* pVersionInfo,
+				VkAccelerationStructureCompatibilityKHR* pCompatibility)>
+			vkGetDeviceAccelerationStructureCompatibilityKHR;
+
 			const std::function<void(
 				VkCommandBuffer commandBuffer,
 				const VkStridedDeviceAddressRegionKHR* pRaygenShaderBindingTable, 
@@ -64,6 +88,15 @@ namespace Vulkan
 				uint32_t depth)>
 			vkCmdTraceRaysKHR;
 
+			const std::function<void(
+				VkCommandBuffer commandBuffer,
+				const VkStridedDeviceAddressRegionKHR* pRaygenShaderBindingTable,
+				const VkStridedDeviceAddressRegionKHR* pMissShaderBindingTable,
+				const VkStridedDeviceAddressRegionKHR* pHitShaderBindingTable,
+				const VkStridedDeviceAddressRegionKHR* pCallableShaderBindingTable,
+				VkDeviceAddress indirectDeviceAddress)>
+			vkCmdTraceRaysIndirectKHR;
+
 			const std::function<VkResult(
 				VkDevice device,
 				VkDeferredOperationKHR deferredOperation,
@@ -96,6 +129,33 @@ namespace Vulkan
 				VkQueryPool queryPool,
 				uint32_t firstQuery)>
 			vkCmdWriteAccelerationStructuresPropertiesKHR;
+
+			const std::function<VkResult(
+				VkDevice device,
+				const VkAllocationCallbacks* pAllocator,
+				VkDeferredOperationKHR* pDeferredOperation)>
+			vkCreateDeferredOperationKHR;
+
+			const std::function<void(
+				VkDevice device,
+				VkDeferredOperationKHR operation,
+				const VkAllocationCallbacks* pAllocator)>
+			vkDestroyDeferredOperationKHR;
+
+			const std::function<uint32_t(
+				VkDevice device,
+				VkDeferredOperationKHR operation)>
+			vkGetDeferredOperationMaxConcurrencyKHR;
+
+			const std::function<VkResult(
+				VkDevice device,
+				VkDeferredOperationKHR operation)>
+			vkGetDeferredOperationResultKHR;
+
+			const std::function<VkResult(
+				VkDevice device,
+				VkDeferredOperationKHR operation)>
+			vkDeferredOperationJoinKHR;
 			
 		private:
 
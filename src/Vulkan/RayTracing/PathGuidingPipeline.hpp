@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <memory>
+
+namespace Vulkan
+{
+	class Buffer;
+	class DescriptorSetManager;
+	class Device;
+	class PipelineCache;
+	class PipelineLayout;
+}
+
+namespace Vulkan::RayTracing
+{
+	// Compute pass resolving the guiding lobes trained by the ray tracing pipeline during the frame (see PathGuiding.comp),
+	// so that the next frame samples what this one learnt. The buffer holds the keys of the hash grid followed by its entries,
+	// zero being an empty grid.
+	class PathGuidingPipeline final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(PathGuidingPipeline)
+
+		static constexpr uint32_t Capacity = 1u << 18; // Matches PathGuidingCapacity in PathGuiding.glsl.
+		static constexpr VkDeviceSize EntrySize = 48;
+		static constexpr VkDeviceSize BufferSize = Capacity * (sizeof(uint32_t) + EntrySize);
+
+		PathGuidingPipeline(
+			const Device& device,
+			const PipelineCache& pipelineCache,
+			const Buffer& pathGuidingBuffer);
+		~PathGuidingPipeline();
+
+		// Blends the samples of the frame into the mean directions of the cells and evicts the stale ones.
+		// The barriers around it are left to the caller.
+		void Dispatch(VkCommandBuffer commandBuffer) const;
+
+	private:
+
+		const Device& device_;
+
+		VULKAN_HANDLE(VkPipeline, pipeline_)
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+	};
+
+}
@@ -0,0 +1,76 @@
+#include "RadianceCachePipeline.hpp"
+#include "Vulkan/Buffer.hpp"
+#include "Vulkan/DescriptorBinding.hpp"
+#include "Vulkan/DescriptorSetManager.hpp"
+#include "Vulkan/DescriptorSets.hpp"
+#include "Vulkan/Device.hpp"
+#include "Vulkan/PipelineCache.hpp"
+#include "Vulkan/PipelineLayout.hpp"
+#include "Vulkan/ShaderCache.hpp"
+#include "Vulkan/ShaderModule.hpp"
+
+namespace Vulkan::RayTracing {
+
+namespace
+{
+	// The workgroup size of RadianceCache.comp.
+	constexpr uint32_t GroupSize = 256;
+}
+
+RadianceCachePipeline::RadianceCachePipeline(
+	const class Device& device,
+	const PipelineCache& pipelineCache,
+	const Buffer& radianceCacheBuffer) :
+	device_(device)
+{
+	// The same binding as in the ray tracing pipeline, both include RadianceCache.glsl.
+	const std::vector<DescriptorBinding> descriptorBindings =
+	{
+		{24, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT}
+	};
+
+	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, 1));
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	VkDescriptorBufferInfo radianceCacheInfo = {};
+	radianceCacheInfo.buffer = radianceCacheBuffer.Handle();
+	radianceCacheInfo.range = VK_WHOLE_SIZE;
+
+	descriptorSets.UpdateDescriptors(0, { descriptorSets.Bind(0, 24, radianceCacheInfo) });
+
+	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout()));
+
+	const auto& computeShader = device.Shaders().Get("RadianceCache.comp.spv");
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT);
+	pipelineInfo.layout = pipelineLayout_->Handle();
+
+	Check(vkCreateComputePipelines(device.Handle(), pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipeline_),
+		"create radiance cache pipeline");
+}
+
+RadianceCachePipeline::~RadianceCachePipeline()
+{
+	if (pipeline_ != nullptr)
+	{
+		vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
+		pipeline_ = nullptr;
+	}
+
+	pipelineLayout_.reset();
+	descriptorSetManager_.reset();
+}
+
+void RadianceCachePipeline::Dispatch(VkCommandBuffer commandBuffer) const
+{
+	VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(0) };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 0, nullptr);
+	vkCmdDispatch(commandBuffer, Capacity / GroupSize, 1, 1);
+}
+
+}
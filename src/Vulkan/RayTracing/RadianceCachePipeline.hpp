@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <memory>
+
+namespace Vulkan
+{
+	class Buffer;
+	class DescriptorSetManager;
+	class Device;
+	class PipelineCache;
+	class PipelineLayout;
+}
+
+namespace Vulkan::RayTracing
+{
+	// Compute pass resolving the radiance cache trained by the ray tracing pipeline during the frame (see RadianceCache.comp).
+	// The cache buffer holds the keys of the hash grid followed by its entries, zero being an empty cache.
+	class RadianceCachePipeline final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(RadianceCachePipeline)
+
+		static constexpr uint32_t Capacity = 1u << 20; // Matches RadianceCacheCapacity in RadianceCache.glsl.
+		static constexpr VkDeviceSize EntrySize = 32;
+		static constexpr VkDeviceSize BufferSize = Capacity * (sizeof(uint32_t) + EntrySize);
+
+		RadianceCachePipeline(
+			const Device& device,
+			const PipelineCache& pipelineCache,
+			const Buffer& radianceCacheBuffer);
+		~RadianceCachePipeline();
+
+		// Blends the samples of the frame into the cached radiance and evicts the stale cells.
+		// The barriers around it are left to the caller.
+		void Dispatch(VkCommandBuffer commandBuffer) const;
+
+	private:
+
+		const Device& device_;
+
+		VULKAN_HANDLE(VkPipeline, pipeline_)
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+	};
+
+}
@@ -1,4 +1,5 @@
 #include "RayTracingPipeline.hpp"
+#include "DeferredOperation.hpp"
 #include "DeviceProcedures.hpp"
 #include "TopLevelAccelerationStructure.hpp"
 #include "Assets/Scene.hpp"
@@ -9,25 +10,119 @@
 #include "Vulkan/DescriptorBinding.hpp"
 #include "Vulkan/DescriptorSetManager.hpp"
 #include "Vulkan/DescriptorSets.hpp"
+#include "Vulkan/DescriptorUpdateTemplate.hpp"
 #include "Vulkan/ImageView.hpp"
+#include "Vulkan/PipelineCache.hpp"
 #include "Vulkan/PipelineLayout.hpp"
+#include "Vulkan/ShaderCache.hpp"
 #include "Vulkan/ShaderModule.hpp"
-#include "Vulkan/SwapChain.hpp"
+#include <chrono>
+#include <cstddef>
+#include <iterator>
 
 namespace Vulkan::RayTracing {
 
+namespace
+{
+	// The material models with their own hit groups, the closest hit shaders being specialized for each (see Scatter.glsl).
+	const Assets::Material::Enum SpecializedMaterials[] =
+	{
+		Assets::Material::Enum::Lambertian,
+		Assets::Material::Enum::Metallic,
+		Assets::Material::Enum::Dielectric,
+		Assets::Material::Enum::DiffuseLight
+	};
+
+	const uint32_t SpecializedMaterialCount = static_cast<uint32_t>(std::size(SpecializedMaterials));
+
+	// The shader stages and groups of the specialized hit groups follow the generic ones, a triangle then a procedural one per material model.
+	const uint32_t SpecializedStageOffset = 6;
+	const uint32_t SpecializedGroupOffset = 5;
+
+	// The any-hit shader of the alpha tested triangles comes last, shared by all the triangle hit groups.
+	const uint32_t AnyHitStage = SpecializedStageOffset + 2 * SpecializedMaterialCount;
+
+	// The ray generation and miss shaders are the first stages and groups, the library of the hit groups holds all the others.
+	const uint32_t RayGenAndMissCount = 2;
+
+	// The pipeline libraries and the pipelines linked from them must agree on the largest payload (the unpacked RayPayload.glsl)
+	// and hit attributes (the procedural spheres) of their shaders.
+	const uint32_t MaxRayPayloadSize = 64;
+	const uint32_t MaxRayHitAttributeSize = 16;
+
+	// The bindings that depend on the swap chain extent, see outputImagesTemplate_.
+	struct OutputImageDescriptors final
+	{
+		VkDescriptorImageInfo Accumulation;
+		VkDescriptorImageInfo Output;
+		VkDescriptorImageInfo Moment;
+		VkDescriptorBufferInfo Tiles;
+		VkDescriptorImageInfo Albedo;
+		VkDescriptorImageInfo NormalDepth;
+		VkDescriptorImageInfo History;
+		VkDescriptorImageInfo HistoryMoment;
+		VkDescriptorImageInfo PreviousNormalDepth;
+		VkDescriptorBufferInfo Reservoirs;
+		VkDescriptorImageInfo ViewAccumulation;
+		VkDescriptorImageInfo SampleMap;
+	};
+
+	VkDescriptorImageInfo GetStorageImageInfo(const ImageView& imageView)
+	{
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageView = imageView.Handle();
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		return imageInfo;
+	}
+}
+
 RayTracingPipeline::RayTracingPipeline(
 	const DeviceProcedures& deviceProcedures,
-	const SwapChain& swapChain,
+	const class Device& device,
+	const PipelineCache& pipelineCache,
 	const TopLevelAccelerationStructure& accelerationStructure,
 	const ImageView& accumulationImageView,
+	const ImageView& viewAccumulationImageView,
 	const ImageView& outputImageView,
+	const ImageView& momentImageView,
+	const Buffer& tileBuffer,
+	const ImageView& albedoImageView,
+	const ImageView& normalDepthImageView,
+	const ImageView& historyImageView,
+	const ImageView& historyMomentImageView,
+	const ImageView& previousNormalDepthImageView,
+	const Buffer& reservoirBuffer,
+	const ImageView& sampleMapImageView,
 	const std::vector<Assets::UniformBuffer>& uniformBuffers,
-	const Assets::Scene& scene) :
-	swapChain_(swapChain)
+	const Buffer& textureRequestBuffer,
+	const VkDeviceSize textureRequestStride,
+	const Buffer& stageClockBuffer,
+	const VkDeviceSize stageClockStride,
+	const Buffer& rayCounterBuffer,
+	const VkDeviceSize rayCounterStride,
+	const Buffer& radianceCacheBuffer,
+	const Buffer& pathGuidingBuffer,
+	const Assets::Scene& scene,
+	const uint32_t sampler,
+	const uint32_t launchOrder,
+	const bool subgroupRayCounters,
+	const bool usePipelineLibraries,
+	const bool updateAfterBind,
+	Utilities::TaskSystem& tasks) :
+	deviceProcedures_(deviceProcedures),
+	device_(device),
+	pipelineCache_(pipelineCache),
+	descriptorSetCount_(static_cast<uint32_t>(uniformBuffers.size())),
+	compactVertices_(scene.CompactVertices()),
+	sampler_(sampler),
+	launchOrder_(launchOrder),
+	subgroupRayCounters_(subgroupRayCounters),
+	usePipelineLibraries_(usePipelineLibraries),
+	updateAfterBind_(updateAfterBind),
+	tasks_(tasks)
 {
 	// Create descriptor pool/sets.
-	const auto& device = swapChain.Device();
 	const std::vector<DescriptorBinding> descriptorBindings =
 	{
 		// Top level acceleration structure.
@@ -40,24 +135,92 @@ RayTracingPipeline::RayTracingPipeline(
 		// Camera information & co
 		{3, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR},
 
-		// Vertex buffer, Index buffer, Material buffer, Offset buffer
-		{4, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR},
-		{5, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR},
-		{6, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR},
-		{7, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR},
+		// Textures, only the streamed ones get rewritten and the recorded command buffers stay valid if updated after bind (see UpdateTextures()).
+		// The sampler they share is bound on its own.
+		{8, static_cast<uint32_t>(scene.TextureImageInfos().size()), VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR,
+			static_cast<VkDescriptorBindingFlags>(updateAfterBind ? VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT : 0) | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT},
+		{9, 1, VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR},
+
+		// The texture streaming requests, one slice per frame in flight.
+		{11, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR},
+
+		// The luminance moments and the active tiles of adaptive sampling.
+		{14, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
+		{15, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
+
+		// The first hit albedo and normal + depth, guiding the denoiser.
+		{16, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
+		{17, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
+
+		// The previous accumulation, moments and first hits, reprojected when the camera moves.
+		{18, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
+		{19, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
+		{20, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
+
+		// The profiled stage clocks, one slice per frame in flight (see Profile.glsl).
+		{21, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_INTERSECTION_BIT_KHR},
+
+		// The ray counts, same (see RayCounters.glsl).
+		{22, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
+
+		// The light reservoirs of this frame and the previous one (see Restir.glsl).
+		{23, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
+
+		// The radiance cache, shared by every frame in flight and resolved after each of them (see RadianceCache.glsl).
+		{24, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
+
+		// The path guiding lobes, likewise (see PathGuiding.glsl).
+		{25, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
 
-		// Textures and image samplers
-		{8, static_cast<uint32_t>(scene.TextureSamplers().size()), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR},
+		// Every layer of the accumulation image, the other views of a multi-view launch accumulate into theirs.
+		{26, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_RAYGEN_BIT_KHR},
 
-		// The Procedural buffer.
-		{9, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_INTERSECTION_BIT_KHR}
+		// The fraction of its samples every pixel traces with foveated sampling (see SampleMapPipeline).
+		{27, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_RAYGEN_BIT_KHR}
 	};
 
 	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, uniformBuffers.size()));
+	textureArrays_.resize(uniformBuffers.size());
+	outputImageViews_.assign(uniformBuffers.size(), outputImageView.Handle());
+	descriptorSetGenerations_.assign(uniformBuffers.size(), 0);
+
+	// The scene buffer table is the same for every frame, it lives in its own set written once and shared with WavefrontPipeline.
+	const std::vector<DescriptorBinding> sceneDescriptorBindings =
+	{
+		{0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_INTERSECTION_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT}
+	};
+
+	sceneDescriptorSetManager_.reset(new DescriptorSetManager(device, sceneDescriptorBindings, 1));
+
+	VkDescriptorBufferInfo sceneBufferTableInfo = {};
+	sceneBufferTableInfo.buffer = scene.SceneBufferTable().Handle();
+	sceneBufferTableInfo.range = VK_WHOLE_SIZE;
+
+	auto& sceneDescriptorSets = sceneDescriptorSetManager_->DescriptorSets();
+	sceneDescriptorSets.UpdateDescriptors(0, { sceneDescriptorSets.Bind(0, 0, sceneBufferTableInfo) });
+
+	// The swap chain dependent images are written through a template, again on every resize (see UpdateOutputImages()).
+	const std::vector<VkDescriptorUpdateTemplateEntry> outputImageEntries =
+	{
+		{1, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(OutputImageDescriptors, Accumulation), 0},
+		{2, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(OutputImageDescriptors, Output), 0},
+		{14, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(OutputImageDescriptors, Moment), 0},
+		{15, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, offsetof(OutputImageDescriptors, Tiles), 0},
+		{16, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(OutputImageDescriptors, Albedo), 0},
+		{17, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(OutputImageDescriptors, NormalDepth), 0},
+		{18, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(OutputImageDescriptors, History), 0},
+		{19, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(OutputImageDescriptors, HistoryMoment), 0},
+		{20, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(OutputImageDescriptors, PreviousNormalDepth), 0},
+		{23, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, offsetof(OutputImageDescriptors, Reservoirs), 0},
+		{26, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(OutputImageDescriptors, ViewAccumulation), 0},
+		{27, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(OutputImageDescriptors, SampleMap), 0}
+	};
+
+	outputImagesTemplate_.reset(new DescriptorUpdateTemplate(device, descriptorSetManager_->DescriptorSetLayout(), outputImageEntries));
 
 	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
 
-	for (uint32_t i = 0; i != swapChain.Images().size(); ++i)
+	for (uint32_t i = 0; i != uniformBuffers.size(); ++i)
 	{
 		// Top level acceleration structure.
 		const auto accelerationStructureHandle = accelerationStructure.Handle();
@@ -67,96 +230,78 @@ RayTracingPipeline::RayTracingPipeline(
 		structureInfo.accelerationStructureCount = 1;
 		structureInfo.pAccelerationStructures = &accelerationStructureHandle;
 
-		// Accumulation image
-		VkDescriptorImageInfo accumulationImageInfo = {};
-		accumulationImageInfo.imageView = accumulationImageView.Handle();
-		accumulationImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-
-		// Output image
-		VkDescriptorImageInfo outputImageInfo = {};
-		outputImageInfo.imageView = outputImageView.Handle();
-		outputImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-
 		// Uniform buffer
 		VkDescriptorBufferInfo uniformBufferInfo = {};
 		uniformBufferInfo.buffer = uniformBuffers[i].Buffer().Handle();
 		uniformBufferInfo.range = VK_WHOLE_SIZE;
 
-		// Vertex buffer
-		VkDescriptorBufferInfo vertexBufferInfo = {};
-		vertexBufferInfo.buffer = scene.VertexBuffer().Handle();
-		vertexBufferInfo.range = VK_WHOLE_SIZE;
-
-		// Index buffer
-		VkDescriptorBufferInfo indexBufferInfo = {};
-		indexBufferInfo.buffer = scene.IndexBuffer().Handle();
-		indexBufferInfo.range = VK_WHOLE_SIZE;
-
-		// Material buffer
-		VkDescriptorBufferInfo materialBufferInfo = {};
-		materialBufferInfo.buffer = scene.MaterialBuffer().Handle();
-		materialBufferInfo.range = VK_WHOLE_SIZE;
-
-		// Offsets buffer
-		VkDescriptorBufferInfo offsetsBufferInfo = {};
-		offsetsBufferInfo.buffer = scene.OffsetsBuffer().Handle();
-		offsetsBufferInfo.range = VK_WHOLE_SIZE;
-
-		// Image and texture samplers.
-		std::vector<VkDescriptorImageInfo> imageInfos(scene.TextureSamplers().size());
-
-		for (size_t t = 0; t != imageInfos.size(); ++t)
-		{
-			auto& imageInfo = imageInfos[t];
-			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageInfo.imageView = scene.TextureImageViews()[t];
-			imageInfo.sampler = scene.TextureSamplers()[t];
-		}
-
-		std::vector<VkWriteDescriptorSet> descriptorWrites =
+		// Texture requests
+		VkDescriptorBufferInfo textureRequestBufferInfo = {};
+		textureRequestBufferInfo.buffer = textureRequestBuffer.Handle();
+		textureRequestBufferInfo.offset = i * textureRequestStride;
+		textureRequestBufferInfo.range = textureRequestStride;
+
+		// Stage clocks
+		VkDescriptorBufferInfo stageClockBufferInfo = {};
+		stageClockBufferInfo.buffer = stageClockBuffer.Handle();
+		stageClockBufferInfo.offset = i * stageClockStride;
+		stageClockBufferInfo.range = stageClockStride;
+
+		// Ray counts
+		VkDescriptorBufferInfo rayCounterBufferInfo = {};
+		rayCounterBufferInfo.buffer = rayCounterBuffer.Handle();
+		rayCounterBufferInfo.offset = i * rayCounterStride;
+		rayCounterBufferInfo.range = rayCounterStride;
+
+		// Radiance cache
+		VkDescriptorBufferInfo radianceCacheBufferInfo = {};
+		radianceCacheBufferInfo.buffer = radianceCacheBuffer.Handle();
+		radianceCacheBufferInfo.range = VK_WHOLE_SIZE;
+
+		// Path guiding
+		VkDescriptorBufferInfo pathGuidingBufferInfo = {};
+		pathGuidingBufferInfo.buffer = pathGuidingBuffer.Handle();
+		pathGuidingBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorImageInfo textureSamplerInfo = {};
+		textureSamplerInfo.sampler = scene.TextureSampler();
+
+		const std::vector<VkWriteDescriptorSet> descriptorWrites =
 		{
 			descriptorSets.Bind(i, 0, structureInfo),
-			descriptorSets.Bind(i, 1, accumulationImageInfo),
-			descriptorSets.Bind(i, 2, outputImageInfo),
 			descriptorSets.Bind(i, 3, uniformBufferInfo),
-			descriptorSets.Bind(i, 4, vertexBufferInfo),
-			descriptorSets.Bind(i, 5, indexBufferInfo),
-			descriptorSets.Bind(i, 6, materialBufferInfo),
-			descriptorSets.Bind(i, 7, offsetsBufferInfo),
-			descriptorSets.Bind(i, 8, *imageInfos.data(), static_cast<uint32_t>(imageInfos.size()))
+			descriptorSets.Bind(i, 9, textureSamplerInfo),
+			descriptorSets.Bind(i, 11, textureRequestBufferInfo),
+			descriptorSets.Bind(i, 21, stageClockBufferInfo),
+			descriptorSets.Bind(i, 22, rayCounterBufferInfo),
+			descriptorSets.Bind(i, 24, radianceCacheBufferInfo),
+			descriptorSets.Bind(i, 25, pathGuidingBufferInfo)
 		};
 
-		// Procedural buffer (optional)
-		VkDescriptorBufferInfo proceduralBufferInfo = {};
-		
-		if (scene.HasProcedurals())
-		{
-			proceduralBufferInfo.buffer = scene.ProceduralBuffer().Handle();
-			proceduralBufferInfo.range = VK_WHOLE_SIZE;
-
-			descriptorWrites.push_back(descriptorSets.Bind(i, 9, proceduralBufferInfo));
-		}
-
 		descriptorSets.UpdateDescriptors(i, descriptorWrites);
+		descriptorSets.UpdateImageArray(i, 8, scene.TextureImageInfos(), scene.TextureGeneration(), textureArrays_[i]);
 	}
 
-	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout()));
+	UpdateOutputImages(accumulationImageView, viewAccumulationImageView, outputImageView, momentImageView, tileBuffer, albedoImageView, normalDepthImageView,
+		historyImageView, historyMomentImageView, previousNormalDepthImageView, reservoirBuffer, sampleMapImageView);
 
-	// Load shaders.
-	const ShaderModule rayGenShader(device, "../assets/shaders/RayTracing.rgen.spv");
-	const ShaderModule missShader(device, "../assets/shaders/RayTracing.rmiss.spv");
-	const ShaderModule closestHitShader(device, "../assets/shaders/RayTracing.rchit.spv");
-	const ShaderModule proceduralClosestHitShader(device, "../assets/shaders/RayTracing.Procedural.rchit.spv");
-	const ShaderModule proceduralIntersectionShader(device, "../assets/shaders/RayTracing.Procedural.rint.spv");
+	// The per-frame sample counts and seed can be pushed to the ray generation shader.
+	VkPushConstantRange frameConstantsRange = {};
+	frameConstantsRange.stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+	frameConstantsRange.offset = 0;
+	frameConstantsRange.size = sizeof(Assets::FrameConstants);
 
-	std::vector<VkPipelineShaderStageCreateInfo> shaderStages =
-	{
-		rayGenShader.CreateShaderStage(VK_SHADER_STAGE_RAYGEN_BIT_KHR),
-		missShader.CreateShaderStage(VK_SHADER_STAGE_MISS_BIT_KHR),
-		closestHitShader.CreateShaderStage(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR),
-		proceduralClosestHitShader.CreateShaderStage(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR),
-		proceduralIntersectionShader.CreateShaderStage(VK_SHADER_STAGE_INTERSECTION_BIT_KHR)
-	};
+	pipelineLayout_.reset(new class PipelineLayout(device,
+		{ &descriptorSetManager_->DescriptorSetLayout(), &sceneDescriptorSetManager_->DescriptorSetLayout() }, { frameConstantsRange }));
+
+	// Load shaders, they are kept around to specialize the pipeline variants.
+	rayGenShader_ = &device.Shaders().Get("RayTracing.rgen.spv");
+	missShader_ = &device.Shaders().Get("RayTracing.rmiss.spv");
+	shadowMissShader_ = &device.Shaders().Get("RayTracing.Shadow.rmiss.spv");
+	closestHitShader_ = &device.Shaders().Get("RayTracing.rchit.spv");
+	proceduralClosestHitShader_ = &device.Shaders().Get("RayTracing.Procedural.rchit.spv");
+	proceduralIntersectionShader_ = &device.Shaders().Get("RayTracing.Procedural.rint.spv");
+	anyHitShader_ = &device.Shaders().Get("RayTracing.rahit.spv");
 
 	// Shader groups
 	VkRayTracingShaderGroupCreateInfoKHR rayGenGroupInfo = {};
@@ -185,7 +330,7 @@ RayTracingPipeline::RayTracingPipeline(
 	triangleHitGroupInfo.type = VK_RAY_TRACING_SHADER_GROUP_TYPE_TRIANGLES_HIT_GROUP_KHR;
 	triangleHitGroupInfo.generalShader = VK_SHADER_UNUSED_KHR;
 	triangleHitGroupInfo.closestHitShader = 2;
-	triangleHitGroupInfo.anyHitShader = VK_SHADER_UNUSED_KHR;
+	triangleHitGroupInfo.anyHitShader = AnyHitStage;
 	triangleHitGroupInfo.intersectionShader = VK_SHADER_UNUSED_KHR;
 	triangleHitGroupIndex_ = 2;
 
@@ -199,42 +344,325 @@ RayTracingPipeline::RayTracingPipeline(
 	proceduralHitGroupInfo.intersectionShader = 4;
 	proceduralHitGroupIndex_ = 3;
 
-	std::vector<VkRayTracingShaderGroupCreateInfoKHR> groups =
+	// The shadow rays of the light sampling only need to know whether they reached the light.
+	VkRayTracingShaderGroupCreateInfoKHR shadowMissGroupInfo = {};
+	shadowMissGroupInfo.sType = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR;
+	shadowMissGroupInfo.pNext = nullptr;
+	shadowMissGroupInfo.type = VK_RAY_TRACING_SHADER_GROUP_TYPE_GENERAL_KHR;
+	shadowMissGroupInfo.generalShader = 5;
+	shadowMissGroupInfo.closestHitShader = VK_SHADER_UNUSED_KHR;
+	shadowMissGroupInfo.anyHitShader = VK_SHADER_UNUSED_KHR;
+	shadowMissGroupInfo.intersectionShader = VK_SHADER_UNUSED_KHR;
+	shadowMissIndex_ = 4;
+
+	groups_ =
 	{
 		rayGenGroupInfo, 
 		missGroupInfo, 
 		triangleHitGroupInfo, 
 		proceduralHitGroupInfo,
+		shadowMissGroupInfo,
 	};
 
+	// The same hit groups again for each specialized material model.
+	for (uint32_t i = 0; i != SpecializedMaterialCount; ++i)
+	{
+		auto triangleGroupInfo = triangleHitGroupInfo;
+		triangleGroupInfo.closestHitShader = SpecializedStageOffset + 2 * i;
+
+		auto proceduralGroupInfo = proceduralHitGroupInfo;
+		proceduralGroupInfo.closestHitShader = SpecializedStageOffset + 2 * i + 1;
+
+		groups_.push_back(triangleGroupInfo);
+		groups_.push_back(proceduralGroupInfo);
+	}
+
+	if (usePipelineLibraries_)
+	{
+		libraries_.push_back(CreatePipeline(Variant{}, Stages::HitGroups));
+	}
+
+	SelectVariant(Variant{});
+}
+
+RayTracingPipeline::~RayTracingPipeline()
+{
+	if (pendingPipelines_.valid())
+	{
+		try
+		{
+			AddPendingPipelines(pendingPipelines_.get());
+		}
+		catch (const std::exception&)
+		{
+		}
+	}
+
+	// The current pipeline is one of the variants.
+	for (const auto& variant : variants_)
+	{
+		vkDestroyPipeline(device_.Handle(), variant.second, nullptr);
+	}
+
+	for (const auto library : libraries_)
+	{
+		vkDestroyPipeline(device_.Handle(), library, nullptr);
+	}
+
+	variants_.clear();
+	libraries_.clear();
+	pipeline_ = nullptr;
+
+	pipelineLayout_.reset();
+	outputImagesTemplate_.reset();
+	sceneDescriptorSetManager_.reset();
+	descriptorSetManager_.reset();
+}
+
+bool RayTracingPipeline::SelectVariant(const Variant& variant)
+{
+	// A variant linked in the background is selected as soon as it is ready, even if another one has been asked for since.
+	// The new variants thereby always come last when they are first selected.
+	if (pendingPipelines_.valid() && pendingPipelines_.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		AddPendingPipelines(pendingPipelines_.get());
+		variantIndex_ = static_cast<uint32_t>(variants_.size() - 1);
+		pipeline_ = variants_.back().second;
+	}
+
+	for (size_t i = 0; i != variants_.size(); ++i)
+	{
+		if (variants_[i].first == variant)
+		{
+			variantIndex_ = static_cast<uint32_t>(i);
+			pipeline_ = variants_[i].second;
+			return true;
+		}
+	}
+
+	// Without libraries or a first pipeline to keep using, the variant has to be compiled right away.
+	if (!usePipelineLibraries_ || pipeline_ == nullptr)
+	{
+		VkPipeline pipeline = nullptr;
+
+		if (usePipelineLibraries_)
+		{
+			if (variant.ProfileStages && profiledHitGroupLibrary_ == nullptr)
+			{
+				profiledHitGroupLibrary_ = CreatePipeline(variant, Stages::HitGroups);
+				libraries_.push_back(profiledHitGroupLibrary_);
+			}
+
+			libraries_.push_back(CreatePipeline(variant, Stages::RayGenAndMiss));
+			pipeline = LinkPipeline(libraries_.back(), variant.ProfileStages ? profiledHitGroupLibrary_ : libraries_.front());
+		}
+		else
+		{
+			pipeline = CreatePipeline(variant, Stages::All);
+		}
+
+		variants_.emplace_back(variant, pipeline);
+		variantIndex_ = static_cast<uint32_t>(variants_.size() - 1);
+		pipeline_ = variants_.back().second;
+		return true;
+	}
+
+	// One variant at a time, the one asked for last is started once the pending one is in.
+	if (!pendingPipelines_.valid())
+	{
+		// The hit groups only depend on the profiling, the profiled ones are compiled along with the first variant that needs them.
+		const bool needsHitGroups = variant.ProfileStages && profiledHitGroupLibrary_ == nullptr;
+		const VkPipeline hitGroupLibrary = variant.ProfileStages ? profiledHitGroupLibrary_ : libraries_.front();
+
+		pendingVariant_ = variant;
+		pendingPipelines_ = std::async(std::launch::async, [this, variant, needsHitGroups, hitGroupLibrary]()
+		{
+			const auto hitGroups = needsHitGroups ? CreatePipeline(variant, Stages::HitGroups) : VkPipeline(nullptr);
+			const auto library = CreatePipeline(variant, Stages::RayGenAndMiss);
+			return std::make_tuple(hitGroups, library, LinkPipeline(library, needsHitGroups ? hitGroups : hitGroupLibrary));
+		});
+	}
+
+	return false;
+}
+
+uint32_t RayTracingPipeline::MaterialHitGroupIndex(const Assets::Material::Enum materialModel, const bool isProcedural) const
+{
+	for (uint32_t i = 0; i != SpecializedMaterialCount; ++i)
+	{
+		if (SpecializedMaterials[i] == materialModel)
+		{
+			return SpecializedGroupOffset + 2 * i + (isProcedural ? 1 : 0);
+		}
+	}
+
+	return isProcedural ? proceduralHitGroupIndex_ : triangleHitGroupIndex_;
+}
+
+VkPipeline RayTracingPipeline::CreatePipeline(const Variant& variant, const Stages stages)
+{
+	// Only loaded when used, the device may not support the reordering.
+	if (variant.InvocationReorder && !reorderRayGenShader_)
+	{
+		reorderRayGenShader_ = &device_.Shaders().Get("RayTracing.Reorder.rgen.spv");
+	}
+
+	// Select the vertex layout of the scene (Vertex.glsl), the random sequence (Random.glsl) and the variant branches (RayTracing.rgen/rmiss, Profile.glsl, RayCounters.glsl, SceneBuffers.glsl).
+	struct SpecializationConstants
+	{
+		VkBool32 CompactVertices;
+		uint32_t Sampler;
+		VkBool32 ShowHeatmap;
+		uint32_t NumberOfBounces;
+		VkBool32 HasSky;
+		uint32_t MaterialModel;
+		VkBool32 ProfileStages;
+		VkBool32 SubgroupRayCounters;
+		VkBool32 CompactMaterials;
+		uint32_t LaunchOrder;
+		VkBool32 RegeneratePaths;
+	};
+
+	const SpecializationConstants specializationConstants =
+	{
+		compactVertices_, sampler_, variant.ShowHeatmap, variant.NumberOfBounces, variant.HasSky, ~0u, variant.ProfileStages, subgroupRayCounters_, variant.CompactMaterials, launchOrder_, variant.RegeneratePaths
+	};
+	const VkSpecializationMapEntry specializationEntries[] =
+	{
+		{ 0, offsetof(SpecializationConstants, CompactVertices), sizeof(VkBool32) },
+		{ 1, offsetof(SpecializationConstants, Sampler), sizeof(uint32_t) },
+		{ 2, offsetof(SpecializationConstants, ShowHeatmap), sizeof(VkBool32) },
+		{ 3, offsetof(SpecializationConstants, NumberOfBounces), sizeof(uint32_t) },
+		{ 4, offsetof(SpecializationConstants, HasSky), sizeof(VkBool32) },
+		{ 5, offsetof(SpecializationConstants, MaterialModel), sizeof(uint32_t) },
+		{ 6, offsetof(SpecializationConstants, ProfileStages), sizeof(VkBool32) },
+		{ 7, offsetof(SpecializationConstants, SubgroupRayCounters), sizeof(VkBool32) },
+		{ 8, offsetof(SpecializationConstants, CompactMaterials), sizeof(VkBool32) },
+		{ 9, offsetof(SpecializationConstants, LaunchOrder), sizeof(uint32_t) },
+		{ 10, offsetof(SpecializationConstants, RegeneratePaths), sizeof(VkBool32) }
+	};
+	const VkSpecializationInfo specializationInfo = { 11, specializationEntries, sizeof(specializationConstants), &specializationConstants };
+
+	// The specialized closest hit shaders only differ by their material model.
+	std::vector<SpecializationConstants> materialConstants(SpecializedMaterialCount, specializationConstants);
+	std::vector<VkSpecializationInfo> materialInfos(SpecializedMaterialCount, specializationInfo);
+
+	for (uint32_t i = 0; i != SpecializedMaterialCount; ++i)
+	{
+		materialConstants[i].MaterialModel = static_cast<uint32_t>(SpecializedMaterials[i]);
+		materialInfos[i].pData = &materialConstants[i];
+	}
+
+	std::vector<VkPipelineShaderStageCreateInfo> shaderStages =
+	{
+		(variant.InvocationReorder ? *reorderRayGenShader_ : *rayGenShader_).CreateShaderStage(VK_SHADER_STAGE_RAYGEN_BIT_KHR, &specializationInfo),
+		missShader_->CreateShaderStage(VK_SHADER_STAGE_MISS_BIT_KHR, &specializationInfo),
+		closestHitShader_->CreateShaderStage(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, &specializationInfo),
+		proceduralClosestHitShader_->CreateShaderStage(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, &specializationInfo),
+		proceduralIntersectionShader_->CreateShaderStage(VK_SHADER_STAGE_INTERSECTION_BIT_KHR, &specializationInfo),
+		shadowMissShader_->CreateShaderStage(VK_SHADER_STAGE_MISS_BIT_KHR)
+	};
+
+	for (const auto& materialInfo : materialInfos)
+	{
+		shaderStages.push_back(closestHitShader_->CreateShaderStage(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, &materialInfo));
+		shaderStages.push_back(proceduralClosestHitShader_->CreateShaderStage(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, &materialInfo));
+	}
+
+	shaderStages.push_back(anyHitShader_->CreateShaderStage(VK_SHADER_STAGE_ANY_HIT_BIT_KHR, &specializationInfo));
+
+	// The libraries each get their share of the stages and groups, the hit groups referring to their stages from the start of their library.
+	auto groups = groups_;
+
+	if (stages == Stages::RayGenAndMiss)
+	{
+		shaderStages.resize(RayGenAndMissCount);
+		groups.resize(RayGenAndMissCount);
+	}
+	else if (stages == Stages::HitGroups)
+	{
+		shaderStages.erase(shaderStages.begin(), shaderStages.begin() + RayGenAndMissCount);
+		groups.erase(groups.begin(), groups.begin() + RayGenAndMissCount);
+
+		for (auto& group : groups)
+		{
+			for (auto* shader : { &group.generalShader, &group.closestHitShader, &group.anyHitShader, &group.intersectionShader })
+			{
+				*shader = *shader != VK_SHADER_UNUSED_KHR ? *shader - RayGenAndMissCount : *shader;
+			}
+		}
+	}
+
+	VkRayTracingPipelineInterfaceCreateInfoKHR interfaceInfo = {};
+	interfaceInfo.sType = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_INTERFACE_CREATE_INFO_KHR;
+	interfaceInfo.maxPipelineRayPayloadSize = MaxRayPayloadSize;
+	interfaceInfo.maxPipelineRayHitAttributeSize = MaxRayHitAttributeSize;
+
 	// Create graphic pipeline
 	VkRayTracingPipelineCreateInfoKHR pipelineInfo = {};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_CREATE_INFO_KHR;
 	pipelineInfo.pNext = nullptr;
-	pipelineInfo.flags = 0;
+	pipelineInfo.flags = stages != Stages::All ? VK_PIPELINE_CREATE_LIBRARY_BIT_KHR : 0;
 	pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
 	pipelineInfo.pStages = shaderStages.data();
 	pipelineInfo.groupCount = static_cast<uint32_t>(groups.size());
 	pipelineInfo.pGroups = groups.data();
 	pipelineInfo.maxPipelineRayRecursionDepth = 1;
+	pipelineInfo.pLibraryInterface = stages != Stages::All ? &interfaceInfo : nullptr;
 	pipelineInfo.layout = pipelineLayout_->Handle();
 	pipelineInfo.basePipelineHandle = nullptr;
 	pipelineInfo.basePipelineIndex = 0;
 
-	Check(deviceProcedures.vkCreateRayTracingPipelinesKHR(device.Handle(), nullptr, nullptr, 1, &pipelineInfo, nullptr, &pipeline_), 
-		"create ray tracing pipeline");
+	return CreateRayTracingPipeline(pipelineInfo, "create ray tracing pipeline");
 }
 
-RayTracingPipeline::~RayTracingPipeline()
+void RayTracingPipeline::AddPendingPipelines(const std::tuple<VkPipeline, VkPipeline, VkPipeline>& pipelines)
 {
-	if (pipeline_ != nullptr)
+	if (std::get<0>(pipelines) != nullptr)
 	{
-		vkDestroyPipeline(swapChain_.Device().Handle(), pipeline_, nullptr);
-		pipeline_ = nullptr;
+		profiledHitGroupLibrary_ = std::get<0>(pipelines);
+		libraries_.push_back(profiledHitGroupLibrary_);
 	}
 
-	pipelineLayout_.reset();
-	descriptorSetManager_.reset();
+	libraries_.push_back(std::get<1>(pipelines));
+	variants_.emplace_back(pendingVariant_, std::get<2>(pipelines));
+}
+
+VkPipeline RayTracingPipeline::LinkPipeline(const VkPipeline rayGenLibrary, const VkPipeline hitGroupLibrary) const
+{
+	// The groups of the libraries follow each other in the linked pipeline, keeping the indices of the whole pipeline.
+	const VkPipeline libraries[] = { rayGenLibrary, hitGroupLibrary };
+
+	VkPipelineLibraryCreateInfoKHR libraryInfo = {};
+	libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+	libraryInfo.libraryCount = static_cast<uint32_t>(std::size(libraries));
+	libraryInfo.pLibraries = libraries;
+
+	VkRayTracingPipelineInterfaceCreateInfoKHR interfaceInfo = {};
+	interfaceInfo.sType = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_INTERFACE_CREATE_INFO_KHR;
+	interfaceInfo.maxPipelineRayPayloadSize = MaxRayPayloadSize;
+	interfaceInfo.maxPipelineRayHitAttributeSize = MaxRayHitAttributeSize;
+
+	VkRayTracingPipelineCreateInfoKHR pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_CREATE_INFO_KHR;
+	pipelineInfo.maxPipelineRayRecursionDepth = 1;
+	pipelineInfo.pLibraryInfo = &libraryInfo;
+	pipelineInfo.pLibraryInterface = &interfaceInfo;
+	pipelineInfo.layout = pipelineLayout_->Handle();
+
+	return CreateRayTracingPipeline(pipelineInfo, "link ray tracing pipeline");
+}
+
+VkPipeline RayTracingPipeline::CreateRayTracingPipeline(const VkRayTracingPipelineCreateInfoKHR& pipelineInfo, const char* const operation) const
+{
+	VkPipeline pipeline = nullptr;
+
+	Check(DeferredOperation::Run(deviceProcedures_, tasks_, [this, &pipelineInfo, &pipeline](const VkDeferredOperationKHR deferredOperation)
+	{
+		return deviceProcedures_.vkCreateRayTracingPipelinesKHR(device_.Handle(), deferredOperation, pipelineCache_.Handle(), 1, &pipelineInfo, nullptr, &pipeline);
+	}), operation);
+
+	return pipeline;
 }
 
 VkDescriptorSet RayTracingPipeline::DescriptorSet(const uint32_t index) const
@@ -242,4 +670,84 @@ VkDescriptorSet RayTracingPipeline::DescriptorSet(const uint32_t index) const
 	return descriptorSetManager_->DescriptorSets().Handle(index);
 }
 
+VkDescriptorSet RayTracingPipeline::SceneDescriptorSet() const
+{
+	return sceneDescriptorSetManager_->DescriptorSets().Handle(0);
+}
+
+const DescriptorSetLayout& RayTracingPipeline::SceneDescriptorSetLayout() const
+{
+	return sceneDescriptorSetManager_->DescriptorSetLayout();
+}
+
+void RayTracingPipeline::UpdateOutputImages(
+	const ImageView& accumulationImageView,
+	const ImageView& viewAccumulationImageView,
+	const ImageView& outputImageView,
+	const ImageView& momentImageView,
+	const Buffer& tileBuffer,
+	const ImageView& albedoImageView,
+	const ImageView& normalDepthImageView,
+	const ImageView& historyImageView,
+	const ImageView& historyMomentImageView,
+	const ImageView& previousNormalDepthImageView,
+	const Buffer& reservoirBuffer,
+	const ImageView& sampleMapImageView)
+{
+	OutputImageDescriptors descriptors = {};
+	descriptors.Accumulation = GetStorageImageInfo(accumulationImageView);
+	descriptors.Output = GetStorageImageInfo(outputImageView);
+	descriptors.Moment = GetStorageImageInfo(momentImageView);
+	descriptors.Tiles.buffer = tileBuffer.Handle();
+	descriptors.Tiles.range = VK_WHOLE_SIZE;
+	descriptors.Albedo = GetStorageImageInfo(albedoImageView);
+	descriptors.NormalDepth = GetStorageImageInfo(normalDepthImageView);
+	descriptors.History = GetStorageImageInfo(historyImageView);
+	descriptors.HistoryMoment = GetStorageImageInfo(historyMomentImageView);
+	descriptors.PreviousNormalDepth = GetStorageImageInfo(previousNormalDepthImageView);
+	descriptors.Reservoirs.buffer = reservoirBuffer.Handle();
+	descriptors.Reservoirs.range = VK_WHOLE_SIZE;
+	descriptors.ViewAccumulation = GetStorageImageInfo(viewAccumulationImageView);
+	descriptors.SampleMap = GetStorageImageInfo(sampleMapImageView);
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	for (uint32_t i = 0; i != descriptorSetCount_; ++i)
+	{
+		outputImagesTemplate_->Update(descriptorSets.Handle(i), &descriptors);
+		descriptorSetGenerations_[i]++;
+	}
+
+	outputImageViews_.assign(descriptorSetCount_, outputImageView.Handle());
+}
+
+void RayTracingPipeline::UpdateOutputImage(const uint32_t index, const ImageView& outputImageView)
+{
+	if (outputImageViews_[index] == outputImageView.Handle())
+	{
+		return;
+	}
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	VkDescriptorImageInfo outputImageInfo = {};
+	outputImageInfo.imageView = outputImageView.Handle();
+	outputImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	descriptorSets.UpdateDescriptors(index, { descriptorSets.Bind(index, 2, outputImageInfo) });
+	outputImageViews_[index] = outputImageView.Handle();
+	descriptorSetGenerations_[index]++;
+}
+
+void RayTracingPipeline::UpdateTextures(const uint32_t index, const Assets::Scene& scene)
+{
+	// Updated after bind, the command buffers recorded with this descriptor set remain valid. Otherwise they have to be recorded again.
+	const size_t count = descriptorSetManager_->DescriptorSets().UpdateImageArray(index, 8, scene.TextureImageInfos(), scene.TextureGeneration(), textureArrays_[index]);
+
+	if (count != 0 && !updateAfterBind_)
+	{
+		descriptorSetGenerations_[index]++;
+	}
+}
+
 }
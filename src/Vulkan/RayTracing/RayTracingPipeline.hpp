@@ -1,7 +1,12 @@
 #pragma once
 
 #include "Vulkan/Vulkan.hpp"
+#include "Vulkan/DescriptorSets.hpp"
+#include "Assets/Material.hpp"
+#include <future>
 #include <memory>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 namespace Assets
@@ -10,12 +15,22 @@ namespace Assets
 	class UniformBuffer;
 }
 
+namespace Utilities
+{
+	class TaskSystem;
+}
+
 namespace Vulkan
 {
+	class Buffer;
+	class DescriptorSetLayout;
 	class DescriptorSetManager;
+	class DescriptorUpdateTemplate;
+	class Device;
 	class ImageView;
+	class PipelineCache;
 	class PipelineLayout;
-	class SwapChain;
+	class ShaderModule;
 }
 
 namespace Vulkan::RayTracing
@@ -29,37 +44,180 @@ namespace Vulkan::RayTracing
 
 		VULKAN_NON_COPIABLE(RayTracingPipeline)
 
+		// The settings baked into the shaders as specialization constants, zero bounces leaves the loop bound to the uniform buffer.
+		struct Variant
+		{
+			bool ShowHeatmap{};
+			bool ProfileStages{}; // Implied by the heatmap.
+			bool HasSky{true};
+			bool CompactMaterials{}; // The hits fetch the packed materials, see Assets::CompactMaterial.
+			uint32_t NumberOfBounces{};
+			bool RegeneratePaths{}; // The lanes start their next sample without waiting for the subgroup, see RayTracing.rgen.
+			bool InvocationReorder{}; // Not a specialization, a second ray generation shader (requires VK_NV_ray_tracing_invocation_reorder).
+
+			bool operator == (const Variant& other) const
+			{
+				return
+					ShowHeatmap == other.ShowHeatmap &&
+					ProfileStages == other.ProfileStages &&
+					HasSky == other.HasSky &&
+					CompactMaterials == other.CompactMaterials &&
+					NumberOfBounces == other.NumberOfBounces &&
+					RegeneratePaths == other.RegeneratePaths &&
+					InvocationReorder == other.InvocationReorder;
+			}
+		};
+
 		RayTracingPipeline(
 			const DeviceProcedures& deviceProcedures,
-			const SwapChain& swapChain,
+			const Device& device,
+			const PipelineCache& pipelineCache,
 			const TopLevelAccelerationStructure& accelerationStructure,
 			const ImageView& accumulationImageView,
+			const ImageView& viewAccumulationImageView,
 			const ImageView& outputImageView,
+			const ImageView& momentImageView,
+			const Buffer& tileBuffer,
+			const ImageView& albedoImageView,
+			const ImageView& normalDepthImageView,
+			const ImageView& historyImageView,
+			const ImageView& historyMomentImageView,
+			const ImageView& previousNormalDepthImageView,
+			const Buffer& reservoirBuffer,
+			const ImageView& sampleMapImageView,
 			const std::vector<Assets::UniformBuffer>& uniformBuffers,
-			const Assets::Scene& scene);
+			const Buffer& textureRequestBuffer,
+			VkDeviceSize textureRequestStride,
+			const Buffer& stageClockBuffer,
+			VkDeviceSize stageClockStride,
+			const Buffer& rayCounterBuffer,
+			VkDeviceSize rayCounterStride,
+			const Buffer& radianceCacheBuffer,
+			const Buffer& pathGuidingBuffer,
+			const Assets::Scene& scene,
+			uint32_t sampler,
+			uint32_t launchOrder,
+			bool subgroupRayCounters,
+			bool usePipelineLibraries,
+			bool updateAfterBind,
+			Utilities::TaskSystem& tasks);
 		~RayTracingPipeline();
 
 		uint32_t RayGenShaderIndex() const { return rayGenIndex_; }
 		uint32_t MissShaderIndex() const { return missIndex_; }
+		uint32_t ShadowMissShaderIndex() const { return shadowMissIndex_; }
 		uint32_t TriangleHitGroupIndex() const { return triangleHitGroupIndex_; }
 		uint32_t ProceduralHitGroupIndex() const { return proceduralHitGroupIndex_; }
+		uint32_t GroupCount() const { return static_cast<uint32_t>(groups_.size()); }
+
+		// The hit group whose closest hit shader is specialized for the material model, taking the material as its shader record.
+		// The generic hit groups are returned for the models without one.
+		uint32_t MaterialHitGroupIndex(Assets::Material::Enum materialModel, bool isProcedural) const;
 
 		VkDescriptorSet DescriptorSet(uint32_t index) const;
+
+		// The scene buffer table, bound as the second set (see SceneBuffers.glsl). Written once, it is shared by all the frames.
+		VkDescriptorSet SceneDescriptorSet() const;
+		const DescriptorSetLayout& SceneDescriptorSetLayout() const;
+
+		// Incremented by every update of the descriptor set but the texture array updated after bind, which invalidates the command buffers it is bound in.
+		uint64_t DescriptorSetGeneration(uint32_t index) const { return descriptorSetGenerations_[index]; }
+
+		// Makes Handle() the pipeline of the given variant, compiling it the first time it is used.
+		// With pipeline libraries, a new variant is linked on a background thread and false is returned until it is ready,
+		// Handle() staying the previously selected pipeline in the meantime.
+		bool SelectVariant(const Variant& variant);
+		uint32_t VariantIndex() const { return variantIndex_; }
+
+		// Rebinds the scene textures of a descriptor set no frame in flight is using, if they have been streamed since it was last written.
+		// Only the changed elements of the texture array are written, without affecting DescriptorSetGeneration() when it is updated after bind.
+		void UpdateTextures(uint32_t index, const Assets::Scene& scene);
+
+		// Only the storage images, the sample tiles and the reservoirs depend on the swap chain extent, rebind them after a resize.
+		void UpdateOutputImages(
+			const ImageView& accumulationImageView,
+			const ImageView& viewAccumulationImageView,
+			const ImageView& outputImageView,
+			const ImageView& momentImageView,
+			const Buffer& tileBuffer,
+			const ImageView& albedoImageView,
+			const ImageView& normalDepthImageView,
+			const ImageView& historyImageView,
+			const ImageView& historyMomentImageView,
+			const ImageView& previousNormalDepthImageView,
+			const Buffer& reservoirBuffer,
+			const ImageView& sampleMapImageView);
+
+		// Rebinds the output image of a descriptor set no frame in flight is using, e.g. to the acquired swap chain image.
+		void UpdateOutputImage(uint32_t index, const ImageView& outputImageView);
+
 		const class PipelineLayout& PipelineLayout() const { return *pipelineLayout_; }
 
 	private:
 
-		const SwapChain& swapChain_;
+		// Either the whole pipeline, or one of the two libraries it is linked from (VK_KHR_pipeline_library).
+		// Only the ray generation and miss shaders depend on the variant, the hit groups are compiled once.
+		enum class Stages
+		{
+			All,
+			RayGenAndMiss,
+			HitGroups
+		};
+
+		VkPipeline CreatePipeline(const Variant& variant, Stages stages);
+		VkPipeline LinkPipeline(VkPipeline rayGenLibrary, VkPipeline hitGroupLibrary) const;
+		void AddPendingPipelines(const std::tuple<VkPipeline, VkPipeline, VkPipeline>& pipelines);
+
+		// Compiles on the task system threads as well (see DeferredOperation).
+		VkPipeline CreateRayTracingPipeline(const VkRayTracingPipelineCreateInfoKHR& pipelineInfo, const char* operation) const;
+
+		const DeviceProcedures& deviceProcedures_;
+		const Device& device_;
+		const PipelineCache& pipelineCache_;
+		const uint32_t descriptorSetCount_;
+		const bool compactVertices_;
+		const uint32_t sampler_;
+		const uint32_t launchOrder_; // See LaunchOrder.glsl.
+		const bool subgroupRayCounters_;
+		const bool usePipelineLibraries_;
+		const bool updateAfterBind_; // The texture array, see UpdateTextures().
+		Utilities::TaskSystem& tasks_;
 
 		VULKAN_HANDLE(VkPipeline, pipeline_)
 
+		std::vector<std::pair<Variant, VkPipeline>> variants_;
+		uint32_t variantIndex_{};
+
+		std::vector<VkPipeline> libraries_; // The hit groups first, then the ray generation and miss shaders of each variant.
+		VkPipeline profiledHitGroupLibrary_{}; // One of libraries_, only created with the first profiled variant.
+		Variant pendingVariant_;
+		std::future<std::tuple<VkPipeline, VkPipeline, VkPipeline>> pendingPipelines_; // The profiled hit groups if new, the library and the linked pipeline.
+
 		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<DescriptorSetManager> sceneDescriptorSetManager_;
+		std::unique_ptr<DescriptorUpdateTemplate> outputImagesTemplate_;
 		std::unique_ptr<class PipelineLayout> pipelineLayout_;
 
 		uint32_t rayGenIndex_;
 		uint32_t missIndex_;
+		uint32_t shadowMissIndex_;
 		uint32_t triangleHitGroupIndex_;
 		uint32_t proceduralHitGroupIndex_;
+
+		// Owned by the shader cache of the device.
+		const ShaderModule* rayGenShader_{};
+		const ShaderModule* reorderRayGenShader_{};
+		const ShaderModule* missShader_{};
+		const ShaderModule* shadowMissShader_{};
+		const ShaderModule* closestHitShader_{};
+		const ShaderModule* proceduralClosestHitShader_{};
+		const ShaderModule* proceduralIntersectionShader_{};
+		const ShaderModule* anyHitShader_{};
+		std::vector<VkRayTracingShaderGroupCreateInfoKHR> groups_;
+
+		std::vector<DescriptorSets::WrittenImageArray> textureArrays_; // The scene textures last written to each descriptor set.
+		std::vector<VkImageView> outputImageViews_;
+		std::vector<uint64_t> descriptorSetGenerations_;
 	};
 
 }
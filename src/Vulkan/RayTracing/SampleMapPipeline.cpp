@@ -0,0 +1,101 @@
+#include "SampleMapPipeline.hpp"
+#include "Vulkan/DescriptorBinding.hpp"
+#include "Vulkan/DescriptorSetManager.hpp"
+#include "Vulkan/DescriptorSets.hpp"
+#include "Vulkan/Device.hpp"
+#include "Vulkan/ImageView.hpp"
+#include "Vulkan/PipelineCache.hpp"
+#include "Vulkan/PipelineLayout.hpp"
+#include "Vulkan/ShaderCache.hpp"
+#include "Vulkan/ShaderModule.hpp"
+
+namespace Vulkan::RayTracing {
+
+SampleMapPipeline::SampleMapPipeline(
+	const class Device& device,
+	const PipelineCache& pipelineCache,
+	const ImageView& accumulationImageView,
+	const ImageView& momentImageView,
+	const ImageView& normalDepthImageView,
+	const ImageView& sampleMapImageView) :
+	device_(device)
+{
+	const std::vector<DescriptorBinding> descriptorBindings =
+	{
+		{0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{2, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{3, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT}
+	};
+
+	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, 1));
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	VkDescriptorImageInfo accumulationImageInfo = {};
+	accumulationImageInfo.imageView = accumulationImageView.Handle();
+	accumulationImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkDescriptorImageInfo momentImageInfo = {};
+	momentImageInfo.imageView = momentImageView.Handle();
+	momentImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkDescriptorImageInfo normalDepthImageInfo = {};
+	normalDepthImageInfo.imageView = normalDepthImageView.Handle();
+	normalDepthImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkDescriptorImageInfo sampleMapImageInfo = {};
+	sampleMapImageInfo.imageView = sampleMapImageView.Handle();
+	sampleMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	const std::vector<VkWriteDescriptorSet> descriptorWrites =
+	{
+		descriptorSets.Bind(0, 0, accumulationImageInfo),
+		descriptorSets.Bind(0, 1, momentImageInfo),
+		descriptorSets.Bind(0, 2, normalDepthImageInfo),
+		descriptorSets.Bind(0, 3, sampleMapImageInfo)
+	};
+
+	descriptorSets.UpdateDescriptors(0, descriptorWrites);
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(Parameters);
+
+	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout(), { pushConstantRange }));
+
+	const auto& computeShader = device.Shaders().Get("SampleMap.comp.spv");
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT);
+	pipelineInfo.layout = pipelineLayout_->Handle();
+
+	Check(vkCreateComputePipelines(device.Handle(), pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipeline_),
+		"create sample map pipeline");
+}
+
+SampleMapPipeline::~SampleMapPipeline()
+{
+	if (pipeline_ != nullptr)
+	{
+		vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
+		pipeline_ = nullptr;
+	}
+
+	pipelineLayout_.reset();
+	descriptorSetManager_.reset();
+}
+
+void SampleMapPipeline::Dispatch(VkCommandBuffer commandBuffer, const VkExtent2D extent, const Parameters& parameters) const
+{
+	VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(0) };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(parameters), &parameters);
+	vkCmdDispatch(commandBuffer, (extent.width + GroupSize - 1) / GroupSize, (extent.height + GroupSize - 1) / GroupSize, 1);
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <memory>
+
+namespace Vulkan
+{
+	class DescriptorSetManager;
+	class Device;
+	class ImageView;
+	class PipelineCache;
+	class PipelineLayout;
+}
+
+namespace Vulkan::RayTracing
+{
+	// Compute pass of --foveation writing the fraction of its samples every pixel traces this frame (see SampleMap.comp), from the
+	// distance to the gaze point and from the edges and the noise the previous frames left in the normal-depth, accumulation and moment images.
+	class SampleMapPipeline final
+	{
+	public:
+
+		// Matches the push constants of SampleMap.comp.
+		struct Parameters final
+		{
+			float GazeX; // In [0, 1] of the image width.
+			float GazeY; // In [0, 1] of the image height.
+			float FoveaRadius; // In fractions of the image diagonal.
+			float MinFraction;
+			float VarianceThreshold;
+			uint32_t UseVariance;
+		};
+
+		VULKAN_NON_COPIABLE(SampleMapPipeline)
+
+		static constexpr uint32_t GroupSize = 8;
+
+		SampleMapPipeline(
+			const Device& device,
+			const PipelineCache& pipelineCache,
+			const ImageView& accumulationImageView,
+			const ImageView& momentImageView,
+			const ImageView& normalDepthImageView,
+			const ImageView& sampleMapImageView);
+		~SampleMapPipeline();
+
+		// The barriers around it are left to the caller.
+		void Dispatch(VkCommandBuffer commandBuffer, VkExtent2D extent, const Parameters& parameters) const;
+
+	private:
+
+		const Device& device_;
+
+		VULKAN_HANDLE(VkPipeline, pipeline_)
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+	};
+
+}
@@ -4,8 +4,10 @@
 #include "RayTracingProperties.hpp"
 #include "Utilities/Exception.hpp"
 #include "Vulkan/Buffer.hpp"
+#include "Vulkan/BufferUtil.hpp"
 #include "Vulkan/Device.hpp"
 #include "Vulkan/DeviceMemory.hpp"
+#include "Vulkan/StagingRing.hpp"
 #include <algorithm>
 #include <cstring>
 
@@ -64,7 +66,9 @@ ShaderBindingTable::ShaderBindingTable(
 	const RayTracingProperties& rayTracingProperties,
 	const std::vector<Entry>& rayGenPrograms,
 	const std::vector<Entry>& missPrograms, 
-	const std::vector<Entry>& hitGroups) :
+	const std::vector<Entry>& hitGroups,
+	StagingRing& stagingRing,
+	const bool deviceLocal) :
 	
 	rayGenEntrySize_(GetEntrySize(rayTracingProperties, rayGenPrograms)),
 	missEntrySize_(GetEntrySize(rayTracingProperties, missPrograms)),
@@ -84,15 +88,11 @@ ShaderBindingTable::ShaderBindingTable(
 		missPrograms.size() * missEntrySize_ +
 		hitGroups.size() * hitGroupEntrySize_;
 
-	// Allocate buffer & memory.
 	const auto& device = rayTracingProperties.Device();
 
-	buffer_.reset(new class Buffer(device, sbtSize, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT));
-	bufferMemory_.reset(new DeviceMemory(buffer_->AllocateMemory(VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)));
-
-	// Generate the table.
+	// Generate the table, several entries may share a group.
 	const uint32_t handleSize = rayTracingProperties.ShaderGroupHandleSize();
-	const size_t groupCount = rayGenPrograms.size() + missPrograms.size() + hitGroups.size();
+	const size_t groupCount = rayTracingPipeline.GroupCount();
 	std::vector<uint8_t> shaderHandleStorage(groupCount * handleSize);
 
 	Check(deviceProcedures.vkGetRayTracingShaderGroupHandlesKHR(
@@ -105,13 +105,29 @@ ShaderBindingTable::ShaderBindingTable(
 
 	// Copy the shader identifiers followed by their resource pointers or root constants: 
 	// first the ray generation, then the miss shaders, and finally the set of hit groups.
-	auto* pData = static_cast<uint8_t*>(bufferMemory_->Map(0, sbtSize));
+	std::vector<uint8_t> table(sbtSize);
+	auto* pData = table.data();
 
 	pData += CopyShaderData(pData, rayTracingProperties, rayGenPrograms, rayGenEntrySize_, shaderHandleStorage.data());
 	pData += CopyShaderData(pData, rayTracingProperties, missPrograms, missEntrySize_, shaderHandleStorage.data());
 	         CopyShaderData(pData, rayTracingProperties, hitGroups, hitGroupEntrySize_, shaderHandleStorage.data());
 
-	bufferMemory_->Unmap();
+	const VkBufferUsageFlags usage = VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+	// Every hit reads its record, on a discrete GPU they had better not come across the bus. The table is only staged once,
+	// the submission of the frame being recorded picks up the upload and waits for it (see Application::SubmitFrame()).
+	if (deviceLocal)
+	{
+		BufferUtil::CreateDeviceBuffer(stagingRing, "Shader Binding Table", usage, table, buffer_, bufferMemory_);
+	}
+	else
+	{
+		buffer_.reset(new class Buffer(device, sbtSize, usage));
+		bufferMemory_.reset(new DeviceMemory(buffer_->AllocateMemory(VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)));
+
+		std::memcpy(bufferMemory_->Map(0, sbtSize), table.data(), sbtSize);
+		bufferMemory_->Unmap();
+	}
 }
 
 ShaderBindingTable::~ShaderBindingTable()
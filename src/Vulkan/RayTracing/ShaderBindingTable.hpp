@@ -11,6 +11,7 @@ namespace Vulkan
 	class Buffer;
 	class Device;
 	class DeviceMemory;
+	class StagingRing;
 }
 
 namespace Vulkan::RayTracing
@@ -37,7 +38,9 @@ namespace Vulkan::RayTracing
 			const RayTracingProperties& rayTracingProperties,
 			const std::vector<Entry>& rayGenPrograms,
 			const std::vector<Entry>& missPrograms,
-			const std::vector<Entry>& hitGroups);
+			const std::vector<Entry>& hitGroups,
+			StagingRing& stagingRing,
+			bool deviceLocal);
 
 		~ShaderBindingTable();
 
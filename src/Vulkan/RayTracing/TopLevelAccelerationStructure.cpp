@@ -12,8 +12,9 @@ TopLevelAccelerationStructure::TopLevelAccelerationStructure(
 	const class DeviceProcedures& deviceProcedures,
 	const class RayTracingProperties& rayTracingProperties,
 	const VkDeviceAddress instanceAddress,
-	const uint32_t instancesCount) :
-	AccelerationStructure(deviceProcedures, rayTracingProperties),
+	const uint32_t instancesCount,
+	const VkBuildAccelerationStructureFlagsKHR flags) :
+	AccelerationStructure(deviceProcedures, rayTracingProperties, flags),
 	instancesCount_(instancesCount)
 {
 	// Create VkAccelerationStructureGeometryInstancesDataKHR. This wraps a device pointer to the above uploaded instances.
@@ -35,7 +36,7 @@ TopLevelAccelerationStructure::TopLevelAccelerationStructure(
 	buildGeometryInfo_.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
 	buildGeometryInfo_.srcAccelerationStructure = nullptr;
 	
-	buildSizesInfo_ = GetBuildSizes(&instancesCount);
+	buildSizesInfo_ = GetBuildSizes(&instancesCount, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR);
 }
 
 TopLevelAccelerationStructure::TopLevelAccelerationStructure(TopLevelAccelerationStructure&& other) noexcept :
@@ -70,11 +71,44 @@ void TopLevelAccelerationStructure::Generate(
 	deviceProcedures_.vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &buildGeometryInfo_, &pBuildOffsetInfo);
 }
 
+void TopLevelAccelerationStructure::Update(
+	VkCommandBuffer commandBuffer,
+	Buffer& scratchBuffer,
+	const VkDeviceSize scratchOffset)
+{
+	// Refit the top-level acceleration structure to the current instance transforms.
+	VkAccelerationStructureBuildRangeInfoKHR buildOffsetInfo = {};
+	buildOffsetInfo.primitiveCount = instancesCount_;
+
+	const VkAccelerationStructureBuildRangeInfoKHR* pBuildOffsetInfo = &buildOffsetInfo;
+	const auto updateInfo = GetUpdateGeometryInfo(scratchBuffer, scratchOffset);
+
+	deviceProcedures_.vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &updateInfo, &pBuildOffsetInfo);
+}
+
+void TopLevelAccelerationStructure::Rebuild(
+	VkCommandBuffer commandBuffer,
+	Buffer& scratchBuffer,
+	const VkDeviceSize scratchOffset)
+{
+	// Same build as Generate(), into the existing structure.
+	VkAccelerationStructureBuildRangeInfoKHR buildOffsetInfo = {};
+	buildOffsetInfo.primitiveCount = instancesCount_;
+
+	const VkAccelerationStructureBuildRangeInfoKHR* pBuildOffsetInfo = &buildOffsetInfo;
+
+	buildGeometryInfo_.dstAccelerationStructure = Handle();
+	buildGeometryInfo_.scratchData.deviceAddress = scratchBuffer.GetDeviceAddress() + scratchOffset;
+
+	deviceProcedures_.vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &buildGeometryInfo_, &pBuildOffsetInfo);
+}
+
 VkAccelerationStructureInstanceKHR TopLevelAccelerationStructure::CreateInstance(
 	const BottomLevelAccelerationStructure& bottomLevelAs,
 	const glm::mat4& transform,
 	const uint32_t instanceId,
-	const uint32_t hitGroupId)
+	const uint32_t hitGroupId,
+	const uint32_t mask)
 {
 	const auto& device = bottomLevelAs.Device();
 	const auto& deviceProcedure = bottomLevelAs.DeviceProcedures();
@@ -87,17 +121,23 @@ VkAccelerationStructureInstanceKHR TopLevelAccelerationStructure::CreateInstance
 
 	VkAccelerationStructureInstanceKHR instance = {};
 	instance.instanceCustomIndex = instanceId;
-	instance.mask = 0xFF; // The visibility mask is always set of 0xFF, but if some instances would need to be ignored in some cases, this flag should be passed by the application.
+	instance.mask = mask; // The instance is only visible to the rays whose cull mask shares a bit with it (see Assets::ModelInstance::RayMask).
 	instance.instanceShaderBindingTableRecordOffset = hitGroupId; // Set the hit group index, that will be used to find the shader code to execute when hitting the geometry.
 	instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR; // Disable culling - more fine control could be provided by the application
 	instance.accelerationStructureReference = address;
 
-	// The instance.transform value only contains 12 values, corresponding to a 4x3 matrix,
-	// hence saving the last row that is anyway always (0,0,0,1).
-	// Since the matrix is row-major, we simply copy the first 12 values of the original 4x4 matrix
-	std::memcpy(&instance.transform, &transform, sizeof(instance.transform));
+	SetInstanceTransform(instance, transform);
 
 	return instance;
 }
 
+void TopLevelAccelerationStructure::SetInstanceTransform(VkAccelerationStructureInstanceKHR& instance, const glm::mat4& transform)
+{
+	// The instance.transform value only contains 12 values, corresponding to a 3x4 row-major matrix,
+	// hence saving the last row that is anyway always (0,0,0,1).
+	// GLM matrices are column-major, so transpose first and then copy the first 12 values.
+	const auto transposed = glm::transpose(transform);
+	std::memcpy(&instance.transform, &transposed, sizeof(instance.transform));
+}
+
 }
@@ -20,7 +20,8 @@ namespace Vulkan::RayTracing
 			const class DeviceProcedures& deviceProcedures,
 			const class RayTracingProperties& rayTracingProperties,
 			VkDeviceAddress instanceAddress, 
-			uint32_t instancesCount);
+			uint32_t instancesCount,
+			VkBuildAccelerationStructureFlagsKHR flags);
 		TopLevelAccelerationStructure(TopLevelAccelerationStructure&& other) noexcept;
 		virtual ~TopLevelAccelerationStructure();
 
@@ -31,11 +32,26 @@ namespace Vulkan::RayTracing
 			Buffer& resultBuffer,
 			VkDeviceSize resultOffset);
 
+		void Update(
+			VkCommandBuffer commandBuffer,
+			Buffer& scratchBuffer,
+			VkDeviceSize scratchOffset);
+
+		// Builds the generated structure again in place, e.g. once some instances reference other BLAS, which an update cannot follow.
+		// The handle stays the same.
+		void Rebuild(
+			VkCommandBuffer commandBuffer,
+			Buffer& scratchBuffer,
+			VkDeviceSize scratchOffset);
+
 		static VkAccelerationStructureInstanceKHR CreateInstance(
 			const BottomLevelAccelerationStructure& bottomLevelAs,
 			const glm::mat4& transform,
 			uint32_t instanceId,
-			uint32_t hitGroupId);
+			uint32_t hitGroupId,
+			uint32_t mask);
+
+		static void SetInstanceTransform(VkAccelerationStructureInstanceKHR& instance, const glm::mat4& transform);
 
 	private:
 
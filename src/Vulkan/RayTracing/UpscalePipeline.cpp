@@ -0,0 +1,133 @@
+#include "UpscalePipeline.hpp"
+#include "Vulkan/DescriptorBinding.hpp"
+#include "Vulkan/DescriptorSetManager.hpp"
+#include "Vulkan/DescriptorSets.hpp"
+#include "Vulkan/Device.hpp"
+#include "Vulkan/ImageView.hpp"
+#include "Vulkan/PipelineCache.hpp"
+#include "Vulkan/PipelineLayout.hpp"
+#include "Vulkan/ShaderCache.hpp"
+#include "Vulkan/ShaderModule.hpp"
+
+namespace Vulkan::RayTracing {
+
+namespace
+{
+	struct UpscaleConstants final
+	{
+		uint32_t Pass;
+		float Sharpness;
+	};
+
+	VkDescriptorImageInfo GetImageInfo(const ImageView& imageView)
+	{
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageView = imageView.Handle();
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		return imageInfo;
+	}
+}
+
+UpscalePipeline::UpscalePipeline(
+	const class Device& device,
+	const PipelineCache& pipelineCache,
+	const ImageView& outputImageView,
+	const ImageView& upscaledImageView,
+	const ImageView& sharpenedImageView) :
+	device_(device)
+{
+	const std::vector<DescriptorBinding> descriptorBindings =
+	{
+		{0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{2, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT}
+	};
+
+	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, 1));
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	const VkDescriptorImageInfo outputImageInfo = GetImageInfo(outputImageView);
+	const VkDescriptorImageInfo upscaledImageInfo = GetImageInfo(upscaledImageView);
+	const VkDescriptorImageInfo sharpenedImageInfo = GetImageInfo(sharpenedImageView);
+
+	const std::vector<VkWriteDescriptorSet> descriptorWrites =
+	{
+		descriptorSets.Bind(0, 0, outputImageInfo),
+		descriptorSets.Bind(0, 1, upscaledImageInfo),
+		descriptorSets.Bind(0, 2, sharpenedImageInfo)
+	};
+
+	descriptorSets.UpdateDescriptors(0, descriptorWrites);
+
+	VkPushConstantRange constantsRange = {};
+	constantsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	constantsRange.offset = 0;
+	constantsRange.size = sizeof(UpscaleConstants);
+
+	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout(), { constantsRange }));
+
+	const auto& computeShader = device.Shaders().Get("Upscale.comp.spv");
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT);
+	pipelineInfo.layout = pipelineLayout_->Handle();
+
+	Check(vkCreateComputePipelines(device.Handle(), pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipeline_),
+		"create upscale pipeline");
+}
+
+UpscalePipeline::~UpscalePipeline()
+{
+	if (pipeline_ != nullptr)
+	{
+		vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
+		pipeline_ = nullptr;
+	}
+
+	pipelineLayout_.reset();
+	descriptorSetManager_.reset();
+}
+
+void UpscalePipeline::Dispatch(VkCommandBuffer commandBuffer, const VkExtent2D extent, const float sharpness) const
+{
+	VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(0) };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 0, nullptr);
+
+	for (uint32_t pass = 0; pass != 2; ++pass)
+	{
+		if (pass != 0)
+		{
+			VkMemoryBarrier passBarrier = {};
+			passBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			passBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			passBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &passBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		const UpscaleConstants constants = { pass, sharpness };
+
+		vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(commandBuffer, (extent.width + 7) / 8, (extent.height + 7) / 8, 1);
+	}
+}
+
+void UpscalePipeline::Downscale(VkCommandBuffer commandBuffer, const VkExtent2D extent) const
+{
+	VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(0) };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 0, nullptr);
+
+	const UpscaleConstants constants = { 2, 0 };
+
+	vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(commandBuffer, (extent.width + 7) / 8, (extent.height + 7) / 8, 1);
+}
+
+}
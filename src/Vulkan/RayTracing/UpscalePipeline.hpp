@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include <memory>
+
+namespace Vulkan
+{
+	class DescriptorSetManager;
+	class Device;
+	class ImageView;
+	class PipelineCache;
+	class PipelineLayout;
+}
+
+namespace Vulkan::RayTracing
+{
+	// The spatial upscaling of the output image, traced at a fraction of the swap chain size, into the sharpened image (see Upscale.comp).
+	// An edge adaptive Lanczos pass fills the upscaled image, a contrast adaptive sharpening pass then reads it into the sharpened one.
+	class UpscalePipeline final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(UpscalePipeline)
+
+		UpscalePipeline(
+			const Device& device,
+			const PipelineCache& pipelineCache,
+			const ImageView& outputImageView,
+			const ImageView& upscaledImageView,
+			const ImageView& sharpenedImageView);
+		~UpscalePipeline();
+
+		// The extent is the upscaled one. The barriers before the first pass are left to the caller, the one in between is inserted here.
+		void Dispatch(VkCommandBuffer commandBuffer, VkExtent2D extent, float sharpness) const;
+
+		// Box filters the output image into the sharpened one instead, keeping its aspect ratio. For the preview of an offline render.
+		void Downscale(VkCommandBuffer commandBuffer, VkExtent2D extent) const;
+
+	private:
+
+		const Device& device_;
+
+		VULKAN_HANDLE(VkPipeline, pipeline_)
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+	};
+
+}
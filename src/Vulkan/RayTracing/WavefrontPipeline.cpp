@@ -0,0 +1,372 @@
+#include "WavefrontPipeline.hpp"
+#include "TopLevelAccelerationStructure.hpp"
+#include "Assets/Scene.hpp"
+#include "Assets/UniformBuffer.hpp"
+#include "Vulkan/Buffer.hpp"
+#include "Vulkan/DescriptorBinding.hpp"
+#include "Vulkan/DescriptorSetManager.hpp"
+#include "Vulkan/DescriptorSets.hpp"
+#include "Vulkan/Device.hpp"
+#include "Vulkan/ImageView.hpp"
+#include "Vulkan/PipelineCache.hpp"
+#include "Vulkan/PipelineLayout.hpp"
+#include "Vulkan/ShaderCache.hpp"
+#include "Vulkan/ShaderModule.hpp"
+#include <cstddef>
+
+namespace Vulkan::RayTracing {
+
+namespace
+{
+	// Matches WavefrontConstants in Wavefront.glsl.
+	struct WavefrontConstants final
+	{
+		uint32_t TotalNumberOfSamples;
+		uint32_t NumberOfSamples;
+		uint32_t Sample;
+		uint32_t Bounce;
+		uint32_t InputQueue;
+		uint32_t Hybrid;
+		glm::vec2 PrimaryJitter;
+	};
+
+	// Matches WavefrontQueue in Wavefront.glsl, an empty queue is an indirect dispatch of no group.
+	struct WavefrontQueue final
+	{
+		uint32_t Count;
+		uint32_t GroupCountX;
+		uint32_t GroupCountY;
+		uint32_t GroupCountZ;
+	};
+
+	// The sizes of the Wavefront.glsl structures.
+	const VkDeviceSize RaySize = 64;
+	const VkDeviceSize HitSize = 48;
+	const VkDeviceSize ShadowRaySize = 48;
+	const VkDeviceSize PixelSize = 48;
+
+	const uint32_t ShadowQueue = 2;
+
+	// Every kernel consumes what the previous one produced, either through the buffers or the indirect dispatch arguments.
+	void InsertKernelBarrier(VkCommandBuffer commandBuffer)
+	{
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	void ClearQueue(VkCommandBuffer commandBuffer, const Buffer& queueBuffer, const uint32_t queue)
+	{
+		const WavefrontQueue empty = { 0, 0, 1, 1 };
+
+		vkCmdUpdateBuffer(commandBuffer, queueBuffer.Handle(), queue * sizeof(WavefrontQueue), sizeof(empty), &empty);
+	}
+
+	VkDescriptorImageInfo GetImageInfo(const ImageView& imageView)
+	{
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageView = imageView.Handle();
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		return imageInfo;
+	}
+
+	VkDescriptorBufferInfo GetBufferInfo(const Buffer& buffer)
+	{
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = buffer.Handle();
+		bufferInfo.range = VK_WHOLE_SIZE;
+
+		return bufferInfo;
+	}
+}
+
+WavefrontPipeline::WavefrontPipeline(
+	const class Device& device,
+	const PipelineCache& pipelineCache,
+	const TopLevelAccelerationStructure& accelerationStructure,
+	const ImageView& accumulationImageView,
+	const ImageView& outputImageView,
+	const ImageView& momentImageView,
+	const ImageView& albedoImageView,
+	const ImageView& normalDepthImageView,
+	const std::vector<Assets::UniformBuffer>& uniformBuffers,
+	const Buffer& textureRequestBuffer,
+	const VkDeviceSize textureRequestStride,
+	const DescriptorSetLayout& sceneDescriptorSetLayout,
+	const VkDescriptorSet sceneDescriptorSet,
+	const Assets::Scene& scene,
+	const uint32_t sampler,
+	const uint32_t launchOrder,
+	const bool compactMaterials,
+	const bool updateAfterBind,
+	const VkExtent2D extent) :
+	device_(device),
+	sceneDescriptorSet_(sceneDescriptorSet)
+{
+	// The queues hold up to a ray per pixel, the ray queue twice for the ping-pong.
+	const VkDeviceSize pixelCount = static_cast<VkDeviceSize>(extent.width) * extent.height;
+
+	CreateBuffer(2 * pixelCount * RaySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, "Wavefront Ray Buffer", rayBuffer_, rayBufferMemory_);
+	CreateBuffer(pixelCount * HitSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, "Wavefront Hit Buffer", hitBuffer_, hitBufferMemory_);
+	CreateBuffer(pixelCount * ShadowRaySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, "Wavefront Shadow Ray Buffer", shadowRayBuffer_, shadowRayBufferMemory_);
+	CreateBuffer(QueueCount * sizeof(WavefrontQueue), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		"Wavefront Queue Buffer", queueBuffer_, queueBufferMemory_);
+	CreateBuffer(pixelCount * PixelSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, "Wavefront Pixel Buffer", pixelBuffer_, pixelBufferMemory_);
+
+	// The same binding numbers as RayTracingPipeline, the queues follow. The scene buffer table is its second set.
+	const std::vector<DescriptorBinding> descriptorBindings =
+	{
+		{0, 1, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_SHADER_STAGE_COMPUTE_BIT},
+		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{2, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{3, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{8, static_cast<uint32_t>(scene.TextureImageInfos().size()), VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT,
+			static_cast<VkDescriptorBindingFlags>(updateAfterBind ? VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT : 0) | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT},
+		{9, 1, VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{11, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{14, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{16, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+		{17, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
+
+		// Rays, hits, shadow rays, queue counters and pixel sums.
+		{21, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{22, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{23, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{24, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+		{25, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+
+		// The rasterized visibility of the hybrid mode, only written once it is used.
+		{26, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT}
+	};
+
+	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, uniformBuffers.size()));
+	textureArrays_.resize(uniformBuffers.size());
+	visibilityImageViews_.resize(uniformBuffers.size());
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	for (uint32_t i = 0; i != uniformBuffers.size(); ++i)
+	{
+		const auto accelerationStructureHandle = accelerationStructure.Handle();
+		VkWriteDescriptorSetAccelerationStructureKHR structureInfo = {};
+		structureInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
+		structureInfo.pNext = nullptr;
+		structureInfo.accelerationStructureCount = 1;
+		structureInfo.pAccelerationStructures = &accelerationStructureHandle;
+
+		VkDescriptorBufferInfo textureRequestBufferInfo = {};
+		textureRequestBufferInfo.buffer = textureRequestBuffer.Handle();
+		textureRequestBufferInfo.offset = i * textureRequestStride;
+		textureRequestBufferInfo.range = textureRequestStride;
+
+		const VkDescriptorImageInfo accumulationImageInfo = GetImageInfo(accumulationImageView);
+		const VkDescriptorImageInfo outputImageInfo = GetImageInfo(outputImageView);
+		const VkDescriptorImageInfo momentImageInfo = GetImageInfo(momentImageView);
+		const VkDescriptorImageInfo albedoImageInfo = GetImageInfo(albedoImageView);
+		const VkDescriptorImageInfo normalDepthImageInfo = GetImageInfo(normalDepthImageView);
+		const VkDescriptorBufferInfo uniformBufferInfo = GetBufferInfo(uniformBuffers[i].Buffer());
+		const VkDescriptorBufferInfo rayBufferInfo = GetBufferInfo(*rayBuffer_);
+		const VkDescriptorBufferInfo hitBufferInfo = GetBufferInfo(*hitBuffer_);
+		const VkDescriptorBufferInfo shadowRayBufferInfo = GetBufferInfo(*shadowRayBuffer_);
+		const VkDescriptorBufferInfo queueBufferInfo = GetBufferInfo(*queueBuffer_);
+		const VkDescriptorBufferInfo pixelBufferInfo = GetBufferInfo(*pixelBuffer_);
+
+		VkDescriptorImageInfo textureSamplerInfo = {};
+		textureSamplerInfo.sampler = scene.TextureSampler();
+
+		std::vector<VkWriteDescriptorSet> descriptorWrites =
+		{
+			descriptorSets.Bind(i, 0, structureInfo),
+			descriptorSets.Bind(i, 1, accumulationImageInfo),
+			descriptorSets.Bind(i, 2, outputImageInfo),
+			descriptorSets.Bind(i, 3, uniformBufferInfo),
+			descriptorSets.Bind(i, 9, textureSamplerInfo),
+			descriptorSets.Bind(i, 11, textureRequestBufferInfo),
+			descriptorSets.Bind(i, 14, momentImageInfo),
+			descriptorSets.Bind(i, 16, albedoImageInfo),
+			descriptorSets.Bind(i, 17, normalDepthImageInfo),
+			descriptorSets.Bind(i, 21, rayBufferInfo),
+			descriptorSets.Bind(i, 22, hitBufferInfo),
+			descriptorSets.Bind(i, 23, shadowRayBufferInfo),
+			descriptorSets.Bind(i, 24, queueBufferInfo),
+			descriptorSets.Bind(i, 25, pixelBufferInfo)
+		};
+
+		descriptorSets.UpdateDescriptors(i, descriptorWrites);
+		descriptorSets.UpdateImageArray(i, 8, scene.TextureImageInfos(), scene.TextureGeneration(), textureArrays_[i]);
+	}
+
+	VkPushConstantRange constantsRange = {};
+	constantsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	constantsRange.offset = 0;
+	constantsRange.size = sizeof(WavefrontConstants);
+
+	pipelineLayout_.reset(new class PipelineLayout(device, { &descriptorSetManager_->DescriptorSetLayout(), &sceneDescriptorSetLayout }, { constantsRange }));
+
+	// The vertex layout, the random sequence, the material layout and the launch order, as in RayTracingPipeline.
+	struct SpecializationConstants
+	{
+		VkBool32 CompactVertices;
+		uint32_t Sampler;
+		VkBool32 CompactMaterials;
+		uint32_t LaunchOrder;
+	};
+
+	const SpecializationConstants specializationConstants = { scene.CompactVertices(), sampler, compactMaterials, launchOrder };
+	const VkSpecializationMapEntry specializationEntries[] =
+	{
+		{ 0, offsetof(SpecializationConstants, CompactVertices), sizeof(VkBool32) },
+		{ 1, offsetof(SpecializationConstants, Sampler), sizeof(uint32_t) },
+		{ 8, offsetof(SpecializationConstants, CompactMaterials), sizeof(VkBool32) },
+		{ 9, offsetof(SpecializationConstants, LaunchOrder), sizeof(uint32_t) }
+	};
+	const VkSpecializationInfo specializationInfo = { 4, specializationEntries, sizeof(specializationConstants), &specializationConstants };
+
+	const char* const shaderFiles[KernelCount] =
+	{
+		"Wavefront.Generate.comp.spv",
+		"Wavefront.Extend.comp.spv",
+		"Wavefront.Shade.comp.spv",
+		"Wavefront.Connect.comp.spv",
+		"Wavefront.Accumulate.comp.spv"
+	};
+
+	for (uint32_t i = 0; i != KernelCount; ++i)
+	{
+		const auto& computeShader = device.Shaders().Get(shaderFiles[i]);
+
+		VkComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT, &specializationInfo);
+		pipelineInfo.layout = pipelineLayout_->Handle();
+
+		Check(vkCreateComputePipelines(device.Handle(), pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipelines_[i]),
+			"create wavefront pipeline");
+	}
+}
+
+WavefrontPipeline::~WavefrontPipeline()
+{
+	for (auto& pipeline : pipelines_)
+	{
+		if (pipeline != nullptr)
+		{
+			vkDestroyPipeline(device_.Handle(), pipeline, nullptr);
+			pipeline = nullptr;
+		}
+	}
+
+	pipelineLayout_.reset();
+	descriptorSetManager_.reset();
+
+	pixelBuffer_.reset();
+	pixelBufferMemory_.reset();
+	queueBuffer_.reset();
+	queueBufferMemory_.reset();
+	shadowRayBuffer_.reset();
+	shadowRayBufferMemory_.reset();
+	hitBuffer_.reset();
+	hitBufferMemory_.reset();
+	rayBuffer_.reset();
+	rayBufferMemory_.reset();
+}
+
+void WavefrontPipeline::UpdateTextures(const uint32_t index, const Assets::Scene& scene)
+{
+	descriptorSetManager_->DescriptorSets().UpdateImageArray(index, 8, scene.TextureImageInfos(), scene.TextureGeneration(), textureArrays_[index]);
+}
+
+void WavefrontPipeline::UpdateVisibilityImage(const uint32_t index, const ImageView& visibilityImageView)
+{
+	if (visibilityImageViews_[index] == visibilityImageView.Handle())
+	{
+		return;
+	}
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	descriptorSets.UpdateDescriptors(index, { descriptorSets.Bind(index, 26, GetImageInfo(visibilityImageView)) });
+	visibilityImageViews_[index] = visibilityImageView.Handle();
+}
+
+void WavefrontPipeline::Dispatch(
+	VkCommandBuffer commandBuffer,
+	const uint32_t index,
+	const VkExtent2D extent,
+	const uint32_t totalNumberOfSamples,
+	const uint32_t numberOfSamples,
+	const uint32_t numberOfBounces,
+	const bool hybrid,
+	const glm::vec2 primaryJitter) const
+{
+	const uint32_t isHybrid = hybrid ? 1 : 0;
+
+	VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(index), sceneDescriptorSet_ };
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 2, descriptorSets, 0, nullptr);
+
+	// The queues and pixel sums are shared by the frames in flight.
+	InsertKernelBarrier(commandBuffer);
+
+	const auto bind = [&](const Kernel kernel, const WavefrontConstants& constants)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines_[kernel]);
+		vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	};
+
+	for (uint32_t s = 0; s != numberOfSamples; ++s)
+	{
+		// The camera rays fill the first queue.
+		bind(Generate, { totalNumberOfSamples, numberOfSamples, s, 0, 0, isHybrid, primaryJitter });
+		vkCmdDispatch(commandBuffer, (extent.width + 7) / 8, (extent.height + 7) / 8, 1);
+
+		for (uint32_t b = 0; b != numberOfBounces; ++b)
+		{
+			const uint32_t inputQueue = b % 2;
+			const WavefrontConstants constants = { totalNumberOfSamples, numberOfSamples, s, b, inputQueue, isHybrid, primaryJitter };
+
+			InsertKernelBarrier(commandBuffer);
+			ClearQueue(commandBuffer, *queueBuffer_, 1 - inputQueue);
+			ClearQueue(commandBuffer, *queueBuffer_, ShadowQueue);
+			InsertKernelBarrier(commandBuffer);
+
+			bind(Extend, constants);
+			vkCmdDispatchIndirect(commandBuffer, queueBuffer_->Handle(), inputQueue * sizeof(WavefrontQueue) + offsetof(WavefrontQueue, GroupCountX));
+			InsertKernelBarrier(commandBuffer);
+
+			bind(Shade, constants);
+			vkCmdDispatchIndirect(commandBuffer, queueBuffer_->Handle(), inputQueue * sizeof(WavefrontQueue) + offsetof(WavefrontQueue, GroupCountX));
+			InsertKernelBarrier(commandBuffer);
+
+			bind(Connect, constants);
+			vkCmdDispatchIndirect(commandBuffer, queueBuffer_->Handle(), ShadowQueue * sizeof(WavefrontQueue) + offsetof(WavefrontQueue, GroupCountX));
+		}
+
+		InsertKernelBarrier(commandBuffer);
+	}
+
+	bind(Accumulate, { totalNumberOfSamples, numberOfSamples, 0, 0, 0, isHybrid, primaryJitter });
+	vkCmdDispatch(commandBuffer, (extent.width + 7) / 8, (extent.height + 7) / 8, 1);
+}
+
+void WavefrontPipeline::CreateBuffer(
+	const VkDeviceSize size,
+	const VkBufferUsageFlags usage,
+	const char* const name,
+	std::unique_ptr<Buffer>& buffer,
+	std::unique_ptr<DeviceMemory>& memory)
+{
+	buffer.reset(new Buffer(device_, size, usage));
+	memory.reset(new DeviceMemory(buffer->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+
+	device_.DebugUtils().SetObjectName(buffer->Handle(), name);
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include "Vulkan/DescriptorSets.hpp"
+#include "Utilities/Glm.hpp"
+#include <memory>
+#include <vector>
+
+namespace Assets
+{
+	class Scene;
+	class UniformBuffer;
+}
+
+namespace Vulkan
+{
+	class Buffer;
+	class DescriptorSetLayout;
+	class DescriptorSetManager;
+	class Device;
+	class DeviceMemory;
+	class ImageView;
+	class PipelineCache;
+	class PipelineLayout;
+}
+
+namespace Vulkan::RayTracing
+{
+	class TopLevelAccelerationStructure;
+
+	// The wavefront path tracer, an alternative to RayTracingPipeline built on ray queries in compute shaders (requires VK_KHR_ray_query).
+	// Each sample runs the generate kernel once, then the extend, shade and connect kernels once per bounce (see Wavefront.glsl).
+	// The rays ping-pong between two queues, every kernel but generate is an indirect dispatch over the rays still alive.
+	// It writes the same accumulation, moment, output and denoiser guide images, without adaptive sampling, reprojection nor heatmap.
+	// In the hybrid mode, the first extend kernel reads the closest surfaces of the camera rays from a rasterized visibility image (see Vulkan::VisibilityPipeline).
+	class WavefrontPipeline final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(WavefrontPipeline)
+
+		WavefrontPipeline(
+			const Device& device,
+			const PipelineCache& pipelineCache,
+			const TopLevelAccelerationStructure& accelerationStructure,
+			const ImageView& accumulationImageView,
+			const ImageView& outputImageView,
+			const ImageView& momentImageView,
+			const ImageView& albedoImageView,
+			const ImageView& normalDepthImageView,
+			const std::vector<Assets::UniformBuffer>& uniformBuffers,
+			const Buffer& textureRequestBuffer,
+			VkDeviceSize textureRequestStride,
+			const DescriptorSetLayout& sceneDescriptorSetLayout,
+			VkDescriptorSet sceneDescriptorSet,
+			const Assets::Scene& scene,
+			uint32_t sampler,
+			uint32_t launchOrder,
+			bool compactMaterials,
+			bool updateAfterBind,
+			VkExtent2D extent);
+		~WavefrontPipeline();
+
+		// Rebinds the scene textures of a descriptor set no frame in flight is using, see RayTracingPipeline::UpdateTextures().
+		void UpdateTextures(uint32_t index, const Assets::Scene& scene);
+
+		// Binds the visibility image of the hybrid mode to a descriptor set no frame in flight is using, if it is not already.
+		void UpdateVisibilityImage(uint32_t index, const ImageView& visibilityImageView);
+
+		// Traces the samples of the frame with the descriptor set of the given frame in flight.
+		// The bounce count must match the uniform buffer one. The barriers in between the kernels are inserted here, the ones around it are left to the caller.
+		// When hybrid, the camera rays go through the jitter of the visibility image, which must be bound and rasterized by then.
+		void Dispatch(VkCommandBuffer commandBuffer, uint32_t index, VkExtent2D extent,
+			uint32_t totalNumberOfSamples, uint32_t numberOfSamples, uint32_t numberOfBounces,
+			bool hybrid, glm::vec2 primaryJitter) const;
+
+	private:
+
+		// The queue buffer holds the two ray queues then the shadow ray queue.
+		static constexpr uint32_t QueueCount = 3;
+
+		enum Kernel
+		{
+			Generate,
+			Extend,
+			Shade,
+			Connect,
+			Accumulate,
+			KernelCount
+		};
+
+		void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, const char* name, std::unique_ptr<Buffer>& buffer, std::unique_ptr<DeviceMemory>& memory);
+
+		const Device& device_;
+
+		VkPipeline pipelines_[KernelCount]{};
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		VkDescriptorSet sceneDescriptorSet_; // Owned by RayTracingPipeline.
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+
+		std::unique_ptr<Buffer> rayBuffer_;
+		std::unique_ptr<DeviceMemory> rayBufferMemory_;
+		std::unique_ptr<Buffer> hitBuffer_;
+		std::unique_ptr<DeviceMemory> hitBufferMemory_;
+		std::unique_ptr<Buffer> shadowRayBuffer_;
+		std::unique_ptr<DeviceMemory> shadowRayBufferMemory_;
+		std::unique_ptr<Buffer> queueBuffer_;
+		std::unique_ptr<DeviceMemory> queueBufferMemory_;
+		std::unique_ptr<Buffer> pixelBuffer_;
+		std::unique_ptr<DeviceMemory> pixelBufferMemory_;
+
+		std::vector<DescriptorSets::WrittenImageArray> textureArrays_; // The scene textures last written to each descriptor set.
+		std::vector<VkImageView> visibilityImageViews_; // Likewise, null until the hybrid mode is used.
+	};
+
+}
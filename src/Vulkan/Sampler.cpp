@@ -31,6 +31,26 @@ Sampler::Sampler(const class Device& device, const SamplerConfig& config) :
 	}
 }
 
+bool SamplerConfig::operator == (const SamplerConfig& other) const
+{
+	return
+		MagFilter == other.MagFilter &&
+		MinFilter == other.MinFilter &&
+		AddressModeU == other.AddressModeU &&
+		AddressModeV == other.AddressModeV &&
+		AddressModeW == other.AddressModeW &&
+		AnisotropyEnable == other.AnisotropyEnable &&
+		MaxAnisotropy == other.MaxAnisotropy &&
+		BorderColor == other.BorderColor &&
+		UnnormalizedCoordinates == other.UnnormalizedCoordinates &&
+		CompareEnable == other.CompareEnable &&
+		CompareOp == other.CompareOp &&
+		MipmapMode == other.MipmapMode &&
+		MipLodBias == other.MipLodBias &&
+		MinLod == other.MinLod &&
+		MaxLod == other.MaxLod;
+}
+
 Sampler::~Sampler()
 {
 	if (sampler_ != nullptr)
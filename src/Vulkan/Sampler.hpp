@@ -23,6 +23,9 @@ namespace Vulkan
 		float MipLodBias = 0.0f;
 		float MinLod = 0.0f;
 		float MaxLod = 0.0f;
+
+		bool operator == (const SamplerConfig& other) const;
+		bool operator != (const SamplerConfig& other) const { return !(*this == other); }
 	};
 
 	class Sampler final
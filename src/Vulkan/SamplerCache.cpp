@@ -0,0 +1,31 @@
+#include "SamplerCache.hpp"
+
+namespace Vulkan {
+
+SamplerCache::SamplerCache(const class Device& device) :
+	device_(device)
+{
+}
+
+SamplerCache::~SamplerCache()
+{
+}
+
+const Sampler& SamplerCache::Get(const SamplerConfig& config)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	for (const auto& sampler : samplers_)
+	{
+		if (sampler.first == config)
+		{
+			return *sampler.second;
+		}
+	}
+
+	samplers_.emplace_back(config, std::make_unique<Sampler>(device_, config));
+
+	return *samplers_.back().second;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Sampler.hpp"
+#include "Vulkan.hpp"
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Vulkan
+{
+	class Device;
+
+	// The samplers of a device, one per distinct configuration, created on first use and kept until the device goes away.
+	// Drivers cap the number of sampler objects (maxSamplerAllocationCount), the textures share them rather than creating their own.
+	// The textures are created on the loading threads too, hence the lock.
+	class SamplerCache final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(SamplerCache)
+
+		explicit SamplerCache(const Device& device);
+		~SamplerCache();
+
+		const Sampler& Get(const SamplerConfig& config);
+
+	private:
+
+		const class Device& device_;
+
+		// Only a handful of distinct configurations, a linear search is enough.
+		std::mutex mutex_;
+		std::vector<std::pair<SamplerConfig, std::unique_ptr<Sampler>>> samplers_;
+	};
+
+}
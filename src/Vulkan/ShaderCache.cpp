@@ -0,0 +1,50 @@
+#include "ShaderCache.hpp"
+#include "EmbeddedShaders.hpp"
+#include "ShaderModule.hpp"
+#include "Utilities/Exception.hpp"
+#include <filesystem>
+
+namespace Vulkan {
+
+ShaderCache::ShaderCache(const class Device& device) :
+	device_(device)
+{
+}
+
+ShaderCache::~ShaderCache()
+{
+}
+
+const ShaderModule& ShaderCache::Get(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto& module = modules_[name];
+
+	if (module)
+	{
+		return *module;
+	}
+
+	const auto path = std::filesystem::path(overrideDirectory_) / name;
+	std::error_code error;
+
+	if (!overrideDirectory_.empty() && std::filesystem::exists(path, error))
+	{
+		module.reset(new ShaderModule(device_, path.string()));
+		return *module;
+	}
+
+	const auto* const embedded = FindEmbeddedShader(name);
+
+	if (embedded == nullptr)
+	{
+		modules_.erase(name);
+		Throw(std::runtime_error("shader '" + name + "' has not been embedded"));
+	}
+
+	module.reset(new ShaderModule(device_, embedded->Code, embedded->Size));
+	return *module;
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Vulkan
+{
+	class Device;
+	class ShaderModule;
+
+	// The shader modules of a device, created on first use from the SPIR-V embedded into the executable and kept until the device goes away.
+	// The pipelines built on other threads share it, hence the lock.
+	class ShaderCache final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(ShaderCache)
+
+		explicit ShaderCache(const Device& device);
+		~ShaderCache();
+
+		// The module of a compiled shader, e.g. "RayTracing.rgen.spv".
+		const ShaderModule& Get(const std::string& name);
+
+		// Loads the shaders from the .spv files of this directory instead when they exist, to iterate on them without relinking (see --shader-directory).
+		static void SetOverrideDirectory(const std::string& directory) { overrideDirectory_ = directory; }
+
+	private:
+
+		const class Device& device_;
+
+		std::mutex mutex_;
+		std::unordered_map<std::string, std::unique_ptr<ShaderModule>> modules_;
+
+		static inline std::string overrideDirectory_;
+	};
+
+}
@@ -11,12 +11,17 @@ ShaderModule::ShaderModule(const class Device& device, const std::string& filena
 }
 
 ShaderModule::ShaderModule(const class Device& device, const std::vector<char>& code) :
+	ShaderModule(device, reinterpret_cast<const uint32_t*>(code.data()), code.size())
+{
+}
+
+ShaderModule::ShaderModule(const class Device& device, const uint32_t* const code, const size_t size) :
 	device_(device)
 {
 	VkShaderModuleCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	createInfo.codeSize = size;
+	createInfo.pCode = code;
 
 	Check(vkCreateShaderModule(device.Handle(), &createInfo, nullptr, &shaderModule_),
 		"create shader module");
@@ -31,13 +36,14 @@ ShaderModule::~ShaderModule()
 	}
 }
 
-VkPipelineShaderStageCreateInfo ShaderModule::CreateShaderStage(VkShaderStageFlagBits stage) const
+VkPipelineShaderStageCreateInfo ShaderModule::CreateShaderStage(VkShaderStageFlagBits stage, const VkSpecializationInfo* const specializationInfo) const
 {
 	VkPipelineShaderStageCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	createInfo.stage = stage;
 	createInfo.module = shaderModule_;
 	createInfo.pName = "main";
+	createInfo.pSpecializationInfo = specializationInfo;
 
 	return createInfo;
 }
@@ -16,11 +16,13 @@ namespace Vulkan
 
 		ShaderModule(const Device& device, const std::string& filename);
 		ShaderModule(const Device& device, const std::vector<char>& code);
+		ShaderModule(const Device& device, const uint32_t* code, size_t size);
 		~ShaderModule();
 
 		const class Device& Device() const { return device_; }
 
-		VkPipelineShaderStageCreateInfo CreateShaderStage(VkShaderStageFlagBits stage) const;
+		// The specialization info, if any, must outlive the pipeline creation.
+		VkPipelineShaderStageCreateInfo CreateShaderStage(VkShaderStageFlagBits stage, const VkSpecializationInfo* specializationInfo = nullptr) const;
 
 	private:
 
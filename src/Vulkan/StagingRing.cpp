@@ -0,0 +1,305 @@
+#include "StagingRing.hpp"
+#include "Buffer.hpp"
+#include "CommandBuffers.hpp"
+#include "CommandPool.hpp"
+#include "Device.hpp"
+#include "DeviceMemory.hpp"
+#include "Fence.hpp"
+#include "Image.hpp"
+#include "Semaphore.hpp"
+#include "TimelineSemaphore.hpp"
+#include "Utilities/Exception.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace Vulkan {
+
+namespace
+{
+	// Satisfies the buffer copy offset requirements of every format and the usual optimal copy alignment.
+	constexpr VkDeviceSize StagingAlignment = 256;
+
+	VkDeviceSize RoundUp(const VkDeviceSize size, const VkDeviceSize granularity)
+	{
+		return (size + granularity - 1) / granularity * granularity;
+	}
+
+	void BeginCommandBuffer(VkCommandBuffer commandBuffer)
+	{
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		Check(vkBeginCommandBuffer(commandBuffer, &beginInfo),
+			"begin recording staging command buffer");
+	}
+}
+
+StagingRing::StagingRing(class CommandPool& transferCommandPool, class CommandPool& graphicsCommandPool, const VkDeviceSize size) :
+	commandPool_(transferCommandPool),
+	graphicsCommandPool_(graphicsCommandPool),
+	size_(size)
+{
+	const auto& device = transferCommandPool.Device();
+
+	buffer_.reset(new Buffer(device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT));
+	bufferMemory_.reset(new DeviceMemory(buffer_->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)));
+	commandBuffers_.reset(new CommandBuffers(transferCommandPool, 1));
+	fence_.reset(new Fence(device, false));
+	timeline_.reset(new TimelineSemaphore(device, 0));
+
+	if (TransfersOwnership())
+	{
+		acquireCommandBuffers_.reset(new CommandBuffers(graphicsCommandPool, 1));
+		acquireSemaphore_.reset(new Semaphore(device));
+	}
+
+	device.DebugUtils().SetObjectName(buffer_->Handle(), "Staging Ring Buffer");
+	device.DebugUtils().SetObjectName(bufferMemory_->Handle(), "Staging Ring Memory");
+
+	data_ = static_cast<uint8_t*>(bufferMemory_->Map(0, size));
+}
+
+StagingRing::~StagingRing()
+{
+	if (recording_)
+	{
+		commandBuffers_->End(0);
+	}
+
+	if (recordingAcquire_)
+	{
+		acquireCommandBuffers_->End(0);
+	}
+
+	bufferMemory_->Unmap();
+
+	timeline_.reset();
+	fence_.reset();
+	acquireSemaphore_.reset();
+	acquireCommandBuffers_.reset();
+	commandBuffers_.reset();
+	buffer_.reset();
+	bufferMemory_.reset(); // release memory after bound buffer has been destroyed
+}
+
+const class Device& StagingRing::Device() const
+{
+	return commandPool_.Device();
+}
+
+VkCommandBuffer StagingRing::CommandBuffer()
+{
+	if (!recording_)
+	{
+		WaitSubmitted();
+		BeginCommandBuffer((*commandBuffers_)[0]);
+		recording_ = true;
+	}
+
+	return (*commandBuffers_)[0];
+}
+
+VkCommandBuffer StagingRing::AcquireCommandBuffer()
+{
+	if (!recordingAcquire_)
+	{
+		BeginCommandBuffer((*acquireCommandBuffers_)[0]);
+		recordingAcquire_ = true;
+	}
+
+	return (*acquireCommandBuffers_)[0];
+}
+
+VkCommandBuffer StagingRing::GraphicsCommandBuffer()
+{
+	if (!TransfersOwnership())
+	{
+		return CommandBuffer();
+	}
+
+	// The acquire batch is only submitted along with a transfer one, which may then be empty.
+	CommandBuffer();
+	return AcquireCommandBuffer();
+}
+
+bool StagingRing::TransfersOwnership() const
+{
+	return commandPool_.QueueFamilyIndex() != graphicsCommandPool_.QueueFamilyIndex();
+}
+
+void StagingRing::Upload(const void* const content, const VkDeviceSize size, const VkDeviceSize granularity, const CopyFunction& copy)
+{
+	const auto* const bytes = static_cast<const uint8_t*>(content);
+
+	Upload(size, granularity, [bytes](void* const data, const VkDeviceSize offset, const VkDeviceSize pieceSize)
+	{
+		std::memcpy(data, bytes + offset, pieceSize);
+	}, copy);
+}
+
+void StagingRing::Upload(const VkDeviceSize size, const VkDeviceSize granularity, const WriteFunction& write, const CopyFunction& copy)
+{
+	if (granularity == 0 || granularity > size_)
+	{
+		Throw(std::invalid_argument("staging granularity is larger than the staging ring"));
+	}
+
+	// The ring is still read by the uploads submitted last.
+	WaitSubmitted();
+
+	VkDeviceSize offset = 0;
+
+	while (offset != size)
+	{
+		// Wrap around once the pending uploads have filled the ring.
+		head_ = RoundUp(head_, StagingAlignment);
+
+		if (size_ - std::min(head_, size_) < granularity)
+		{
+			Flush();
+		}
+
+		const auto available = (size_ - head_) / granularity * granularity;
+		const auto pieceSize = std::min(size - offset, available);
+
+		write(data_ + head_, offset, pieceSize);
+		copy(CommandBuffer(), *buffer_, head_, offset, pieceSize);
+
+		head_ += pieceSize;
+		offset += pieceSize;
+	}
+}
+
+void StagingRing::Release(const Buffer& buffer)
+{
+	// On a single queue family or for a concurrent buffer, waiting for the submission (see Submit()) is all the synchronisation needed.
+	if (!TransfersOwnership() || buffer.IsConcurrent())
+	{
+		return;
+	}
+
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.srcQueueFamilyIndex = commandPool_.QueueFamilyIndex();
+	barrier.dstQueueFamilyIndex = graphicsCommandPool_.QueueFamilyIndex();
+	barrier.buffer = buffer.Handle();
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(CommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+	vkCmdPipelineBarrier(AcquireCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void StagingRing::Release(Image& image, const VkImageLayout newLayout)
+{
+	if (!TransfersOwnership())
+	{
+		image.TransitionImageLayout(CommandBuffer(), newLayout);
+		return;
+	}
+
+	image.TransferOwnership(
+		CommandBuffer(), commandPool_.QueueFamilyIndex(),
+		AcquireCommandBuffer(), graphicsCommandPool_.QueueFamilyIndex(),
+		newLayout);
+}
+
+void StagingRing::Flush()
+{
+	Submit();
+	WaitSubmitted();
+
+	head_ = 0;
+}
+
+bool StagingRing::Submit()
+{
+	if (!recording_)
+	{
+		return false;
+	}
+
+	commandBuffers_->End(0);
+	recording_ = false;
+
+	// The last batch signals the timeline, which the frames using the uploads wait on.
+	const uint64_t signalValues[] = { ++submittedValue_ };
+	VkSemaphore timelines[] = { timeline_->Handle() };
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &(*commandBuffers_)[0];
+
+	fence_->Reset();
+
+	// The copies run on the transfer queue, concurrently with the frames in flight on the graphics queue.
+	// The acquire half of the ownership transfers then waits for them on the graphics queue.
+	if (recordingAcquire_)
+	{
+		acquireCommandBuffers_->End(0);
+		recordingAcquire_ = false;
+
+		VkSemaphore semaphores[] = { acquireSemaphore_->Handle() };
+		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = semaphores;
+
+		Check(vkQueueSubmit(Device().TransferQueue(), 1, &submitInfo, nullptr),
+			"submit staging command buffer");
+
+		VkSubmitInfo acquireInfo = {};
+		acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireInfo.pNext = &timelineInfo;
+		acquireInfo.waitSemaphoreCount = 1;
+		acquireInfo.pWaitSemaphores = semaphores;
+		acquireInfo.pWaitDstStageMask = waitStages;
+		acquireInfo.commandBufferCount = 1;
+		acquireInfo.pCommandBuffers = &(*acquireCommandBuffers_)[0];
+		acquireInfo.signalSemaphoreCount = 1;
+		acquireInfo.pSignalSemaphores = timelines;
+
+		Check(vkQueueSubmit(Device().GraphicsQueue(), 1, &acquireInfo, fence_->Handle()),
+			"submit staging acquire command buffer");
+	}
+	else
+	{
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = timelines;
+
+		Check(vkQueueSubmit(Device().TransferQueue(), 1, &submitInfo, fence_->Handle()),
+			"submit staging command buffer");
+	}
+
+	submitted_ = true;
+	return true;
+}
+
+void StagingRing::WaitSubmitted()
+{
+	if (!submitted_)
+	{
+		return;
+	}
+
+	fence_->Wait(std::numeric_limits<uint64_t>::max());
+	submitted_ = false;
+	head_ = 0;
+}
+
+}
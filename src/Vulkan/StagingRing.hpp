@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <functional>
+#include <memory>
+
+namespace Vulkan
+{
+	class Buffer;
+	class CommandBuffers;
+	class CommandPool;
+	class Device;
+	class DeviceMemory;
+	class Fence;
+	class Image;
+	class Semaphore;
+	class TimelineSemaphore;
+
+	// A persistently mapped host-visible buffer used to stage uploads to device local resources.
+	// Uploads are recorded into a single command buffer and only submitted on Flush() or Submit() (or when
+	// the ring runs out of space), replacing a staging allocation and a queue wait idle per upload.
+	// The copies run on the transfer queue when the device has a dedicated one, the uploaded resources
+	// are then handed over to the graphics queue family with ownership transfers.
+	class StagingRing final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(StagingRing)
+
+		// Records the copy of a staged piece: (commandBuffer, staging buffer, staging offset, content offset, size).
+		using CopyFunction = std::function<void(VkCommandBuffer, const Buffer&, VkDeviceSize, VkDeviceSize, VkDeviceSize)>;
+
+		// Writes a piece of the content straight into the mapped ring: (destination, content offset, size).
+		using WriteFunction = std::function<void(void*, VkDeviceSize, VkDeviceSize)>;
+
+		// The transfer command pool belongs to the device transfer family, which may be the graphics one.
+		StagingRing(class CommandPool& transferCommandPool, class CommandPool& graphicsCommandPool, VkDeviceSize size);
+		~StagingRing();
+
+		const class Device& Device() const;
+		class CommandPool& CommandPool() { return commandPool_; }
+
+		// The command buffer the pending uploads are recorded into, starting a new batch if needed.
+		VkCommandBuffer CommandBuffer();
+
+		// Stages the content in pieces of a whole number of granularity bytes, the copy function is called once per piece.
+		void Upload(const void* content, VkDeviceSize size, VkDeviceSize granularity, const CopyFunction& copy);
+
+		// Same, but the content is produced piece by piece by the write function instead of being copied from host memory.
+		void Upload(VkDeviceSize size, VkDeviceSize granularity, const WriteFunction& write, const CopyFunction& copy);
+
+		// Hands a fully uploaded resource over to the graphics queue family, the image also gets its final layout.
+		void Release(const Buffer& buffer);
+		void Release(Image& image, VkImageLayout newLayout);
+
+		// Records graphics queue work, e.g. on released resources after their acquisition. It runs after the frames already submitted.
+		VkCommandBuffer GraphicsCommandBuffer();
+
+		// Submits the pending uploads and waits for their completion.
+		void Flush();
+
+		// Submits the pending uploads without waiting, returns whether there were any. They are complete once Timeline() reaches SubmittedValue().
+		bool Submit();
+
+		const TimelineSemaphore& Timeline() const { return *timeline_; }
+		uint64_t SubmittedValue() const { return submittedValue_; }
+
+	private:
+
+		bool TransfersOwnership() const;
+		VkCommandBuffer AcquireCommandBuffer();
+		void WaitSubmitted();
+
+		class CommandPool& commandPool_;
+		class CommandPool& graphicsCommandPool_;
+		const VkDeviceSize size_;
+
+		std::unique_ptr<Buffer> buffer_;
+		std::unique_ptr<DeviceMemory> bufferMemory_;
+		std::unique_ptr<CommandBuffers> commandBuffers_;
+		std::unique_ptr<CommandBuffers> acquireCommandBuffers_;
+		std::unique_ptr<Semaphore> acquireSemaphore_;
+		std::unique_ptr<Fence> fence_;
+		std::unique_ptr<TimelineSemaphore> timeline_;
+
+		uint8_t* data_{};
+		VkDeviceSize head_{};
+		bool recording_{};
+		bool recordingAcquire_{};
+		bool submitted_{};
+		uint64_t submittedValue_{};
+	};
+
+}
@@ -29,6 +29,14 @@ SwapChain::SwapChain(const class Device& device, const VkPresentModeKHR presentM
 	const auto extent = ChooseSwapExtent(window, details.Capabilities);
 	const auto imageCount = ChooseImageCount(details.Capabilities);
 
+	// The ray tracer can then write into the swap chain images, rather than copying its output image into them.
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(device.PhysicalDevice(), surfaceFormat.format, &formatProperties);
+
+	const bool supportsStorage =
+		(details.Capabilities.supportedUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT) != 0 &&
+		(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+
 	VkSwapchainCreateInfoKHR createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
 	createInfo.surface = surface.Handle();
@@ -37,7 +45,7 @@ SwapChain::SwapChain(const class Device& device, const VkPresentModeKHR presentM
 	createInfo.imageColorSpace = surfaceFormat.colorSpace;
 	createInfo.imageExtent = extent;
 	createInfo.imageArrayLayers = 1;
-	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | (supportsStorage ? VK_IMAGE_USAGE_STORAGE_BIT : 0);
 	createInfo.preTransform = details.Capabilities.currentTransform;
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode = actualPresentMode;
@@ -65,6 +73,7 @@ SwapChain::SwapChain(const class Device& device, const VkPresentModeKHR presentM
 	minImageCount_ = std::max(2u, details.Capabilities.minImageCount);
 	presentMode_ = actualPresentMode;
 	format_ = surfaceFormat.format;
+	supportsStorage_ = supportsStorage;
 	extent_ = extent;
 	images_ = GetEnumerateVector(device_.Handle(), swapChain_, vkGetSwapchainImagesKHR);
 	imageViews_.reserve(images_.size());
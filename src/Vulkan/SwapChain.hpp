@@ -27,6 +27,7 @@ namespace Vulkan
 		const VkExtent2D& Extent() const { return extent_; }
 		VkFormat Format() const { return format_; }
 		VkPresentModeKHR PresentMode() const { return presentMode_; }
+		bool SupportsStorage() const { return supportsStorage_; } // The images have VK_IMAGE_USAGE_STORAGE_BIT.
 
 	private:
 
@@ -51,6 +52,7 @@ namespace Vulkan
 		uint32_t minImageCount_;
 		VkPresentModeKHR presentMode_;
 		VkFormat format_;
+		bool supportsStorage_{};
 		VkExtent2D extent_{};
 		std::vector<VkImage> images_;
 		std::vector<std::unique_ptr<ImageView>> imageViews_;
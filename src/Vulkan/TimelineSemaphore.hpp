@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Vulkan.hpp"
+
+namespace Vulkan
+{
+	class Device;
+
+	// A Vulkan 1.2 timeline semaphore, its counter only ever grows. The queue submissions signal and wait on given values,
+	// the host can also wait on a value or poll the counter (unlike a fence, it never has to be reset).
+	class TimelineSemaphore final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(TimelineSemaphore)
+
+		TimelineSemaphore(const Device& device, uint64_t initialValue);
+		~TimelineSemaphore();
+
+		const class Device& Device() const { return device_; }
+
+		uint64_t Value() const;
+		bool IsReached(uint64_t value) const { return Value() >= value; }
+		void Wait(uint64_t value, uint64_t timeout) const;
+
+	private:
+
+		const class Device& device_;
+
+		VULKAN_HANDLE(VkSemaphore, semaphore_)
+	};
+
+}
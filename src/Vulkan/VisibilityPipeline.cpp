@@ -0,0 +1,371 @@
+#include "VisibilityPipeline.hpp"
+#include "Buffer.hpp"
+#include "CommandPool.hpp"
+#include "CullingPipeline.hpp"
+#include "DepthBuffer.hpp"
+#include "DescriptorBinding.hpp"
+#include "DescriptorSetManager.hpp"
+#include "DescriptorSets.hpp"
+#include "Device.hpp"
+#include "DeviceMemory.hpp"
+#include "Image.hpp"
+#include "ImageView.hpp"
+#include "PipelineCache.hpp"
+#include "PipelineLayout.hpp"
+#include "ShaderCache.hpp"
+#include "ShaderModule.hpp"
+#include "Assets/Scene.hpp"
+#include "Assets/UniformBuffer.hpp"
+#include <array>
+
+namespace Vulkan {
+
+VisibilityPipeline::VisibilityPipeline(
+	CommandPool& commandPool,
+	const PipelineCache& pipelineCache,
+	const std::vector<Assets::UniformBuffer>& uniformBuffers,
+	const Assets::Scene& scene,
+	const VkExtent2D extent,
+	const DepthBuffer* const sharedDepthBuffer) :
+	device_(commandPool.Device()),
+	extent_(extent),
+	sharedDepthBuffer_(sharedDepthBuffer)
+{
+	const auto& device = device_;
+	const auto& debugUtils = device.DebugUtils();
+
+	cullingPipeline_.reset(new CullingPipeline(device, pipelineCache, uniformBuffers, scene));
+
+	if (sharedDepthBuffer_ == nullptr)
+	{
+		depthBuffer_.reset(new DepthBuffer(commandPool, extent));
+	}
+
+	const auto& depthBuffer = sharedDepthBuffer_ != nullptr ? *sharedDepthBuffer_ : *depthBuffer_;
+
+	// The visibility image, written as a color attachment and read as a storage image. Its layout is set by the render pass.
+	const auto format = VK_FORMAT_R32G32_UINT;
+
+	image_.reset(new Image(device, extent, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT));
+	imageMemory_.reset(new DeviceMemory(image_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+	imageView_.reset(new class ImageView(device, image_->Handle(), format, VK_IMAGE_ASPECT_COLOR_BIT));
+
+	debugUtils.SetObjectName(image_->Handle(), "Visibility Image");
+	debugUtils.SetObjectName(imageMemory_->Handle(), "Visibility Image Memory");
+	debugUtils.SetObjectName(imageView_->Handle(), "Visibility ImageView");
+
+	// Both attachments are cleared, the visibility being left in the general layout for the compute shaders.
+	VkAttachmentDescription colorAttachment = {};
+	colorAttachment.format = format;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkAttachmentDescription depthAttachment = {};
+	depthAttachment.format = depthBuffer.Format();
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentRef = {};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef = {};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	// The previous frame may still be reading the visibility in its wavefront kernels, or drawing in the shared depth buffer.
+	// The visibility drawn here is then read by the wavefront kernels of this frame.
+	std::array<VkSubpassDependency, 2> dependencies = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	const std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
+
+	Check(vkCreateRenderPass(device.Handle(), &renderPassInfo, nullptr, &renderPass_),
+		"create visibility render pass");
+
+	const std::array<VkImageView, 2> framebufferAttachments = { imageView_->Handle(), depthBuffer.ImageView().Handle() };
+
+	VkFramebufferCreateInfo framebufferInfo = {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = renderPass_;
+	framebufferInfo.attachmentCount = static_cast<uint32_t>(framebufferAttachments.size());
+	framebufferInfo.pAttachments = framebufferAttachments.data();
+	framebufferInfo.width = extent.width;
+	framebufferInfo.height = extent.height;
+	framebufferInfo.layers = 1;
+
+	Check(vkCreateFramebuffer(device.Handle(), &framebufferInfo, nullptr, &framebuffer_),
+		"create visibility framebuffer");
+
+	// Same descriptors as the graphics pipeline, the fragment shader also reading the instances for the ray masks.
+	const std::vector<DescriptorBinding> descriptorBindings =
+	{
+		{0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
+		{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT},
+		{2, static_cast<uint32_t>(scene.TextureImageInfos().size()), VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT},
+		{3, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT},
+		{4, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
+		{5, 1, VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}
+	};
+
+	descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, uniformBuffers.size()));
+	textureArrays_.resize(uniformBuffers.size());
+
+	auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+
+	for (uint32_t i = 0; i != uniformBuffers.size(); ++i)
+	{
+		VkDescriptorBufferInfo uniformBufferInfo = {};
+		uniformBufferInfo.buffer = uniformBuffers[i].Buffer().Handle();
+		uniformBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorBufferInfo materialBufferInfo = {};
+		materialBufferInfo.buffer = scene.MaterialBuffer().Handle();
+		materialBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorBufferInfo instanceBufferInfo = {};
+		instanceBufferInfo.buffer = scene.InstanceBuffer().Handle();
+		instanceBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorBufferInfo proceduralBufferInfo = {};
+		proceduralBufferInfo.buffer = scene.ProceduralBuffer().Handle();
+		proceduralBufferInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorImageInfo samplerInfo = {};
+		samplerInfo.sampler = scene.TextureSampler();
+
+		const std::vector<VkWriteDescriptorSet> descriptorWrites =
+		{
+			descriptorSets.Bind(i, 0, uniformBufferInfo),
+			descriptorSets.Bind(i, 1, materialBufferInfo),
+			descriptorSets.Bind(i, 3, instanceBufferInfo),
+			descriptorSets.Bind(i, 4, proceduralBufferInfo),
+			descriptorSets.Bind(i, 5, samplerInfo)
+		};
+
+		descriptorSets.UpdateDescriptors(i, descriptorWrites);
+		descriptorSets.UpdateImageArray(i, 2, scene.TextureImageInfos(), scene.TextureGeneration(), textureArrays_[i]);
+	}
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(glm::vec2);
+
+	pipelineLayout_.reset(new class PipelineLayout(device, descriptorSetManager_->DescriptorSetLayout(), { pushConstantRange }));
+
+	// The vertices are pulled by the vertex shader, in the layout of the scene (see Vertex.glsl).
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkViewport viewport = {};
+	viewport.width = static_cast<float>(extent.width);
+	viewport.height = static_cast<float>(extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor = {};
+	scissor.extent = extent;
+
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.pViewports = &viewport;
+	viewportState.scissorCount = 1;
+	viewportState.pScissors = &scissor;
+
+	// The camera rays hit both faces of the triangles, none is culled.
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	const auto& vertShader = device.Shaders().Get("Visibility.vert.spv");
+	const auto& fragShader = device.Shaders().Get("Visibility.frag.spv");
+
+	const VkBool32 compactVertices = scene.CompactVertices();
+	const VkSpecializationMapEntry specializationEntry = { 0, 0, sizeof(VkBool32) };
+	const VkSpecializationInfo specializationInfo = { 1, &specializationEntry, sizeof(compactVertices), &compactVertices };
+
+	VkPipelineShaderStageCreateInfo shaderStages[] =
+	{
+		vertShader.CreateShaderStage(VK_SHADER_STAGE_VERTEX_BIT, &specializationInfo),
+		fragShader.CreateShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, &specializationInfo)
+	};
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.basePipelineIndex = -1;
+	pipelineInfo.layout = pipelineLayout_->Handle();
+	pipelineInfo.renderPass = renderPass_;
+	pipelineInfo.subpass = 0;
+
+	Check(vkCreateGraphicsPipelines(device.Handle(), pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipeline_),
+		"create visibility pipeline");
+}
+
+VisibilityPipeline::~VisibilityPipeline()
+{
+	if (pipeline_ != nullptr)
+	{
+		vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
+		pipeline_ = nullptr;
+	}
+
+	if (framebuffer_ != nullptr)
+	{
+		vkDestroyFramebuffer(device_.Handle(), framebuffer_, nullptr);
+		framebuffer_ = nullptr;
+	}
+
+	if (renderPass_ != nullptr)
+	{
+		vkDestroyRenderPass(device_.Handle(), renderPass_, nullptr);
+		renderPass_ = nullptr;
+	}
+
+	pipelineLayout_.reset();
+	descriptorSetManager_.reset();
+	imageView_.reset();
+	image_.reset();
+	imageMemory_.reset();
+	depthBuffer_.reset();
+	cullingPipeline_.reset();
+}
+
+void VisibilityPipeline::Render(const VkCommandBuffer commandBuffer, const uint32_t index, const Assets::Scene& scene, const glm::vec2 pixelJitter)
+{
+	UpdateTextures(index, scene);
+
+	// The pixel centres are moved onto the jittered camera rays, in clip space.
+	const glm::vec2 clipJitter = (glm::vec2(0.5f) - pixelJitter) * 2.0f / glm::vec2(extent_.width, extent_.height);
+
+	std::array<VkClearValue, 2> clearValues = {};
+	clearValues[0].color.uint32[0] = 0;
+	clearValues[0].color.uint32[1] = 0;
+	clearValues[1].depthStencil = { 1.0f, 0 };
+
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass_;
+	renderPassInfo.framebuffer = framebuffer_;
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = extent_;
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	cullingPipeline_->Dispatch(commandBuffer, index);
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	{
+		VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(index) };
+		const VkBuffer indexBuffer = scene.IndexBuffer().Handle();
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout_->Handle(), 0, 1, descriptorSets, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(clipJitter), &clipJitter);
+
+		// Drawn like the rasterizer does, those with 16-bit indices first (see Vulkan::Application::Render()).
+		const auto& drawCommands = cullingPipeline_->DrawCommandBuffer(index);
+		const uint32_t shortDrawCount = scene.ShortIndexDrawCount();
+		const uint32_t longDrawCount = cullingPipeline_->DrawCount() - shortDrawCount;
+
+		if (shortDrawCount != 0)
+		{
+			vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+			vkCmdDrawIndexedIndirect(commandBuffer, drawCommands.Handle(), 0, shortDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+
+		if (longDrawCount != 0)
+		{
+			vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdDrawIndexedIndirect(commandBuffer, drawCommands.Handle(), shortDrawCount * sizeof(VkDrawIndexedIndirectCommand), longDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+	vkCmdEndRenderPass(commandBuffer);
+}
+
+void VisibilityPipeline::UpdateTextures(const uint32_t index, const Assets::Scene& scene)
+{
+	descriptorSetManager_->DescriptorSets().UpdateImageArray(index, 2, scene.TextureImageInfos(), scene.TextureGeneration(), textureArrays_[index]);
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include "DescriptorSets.hpp"
+#include "Utilities/Glm.hpp"
+#include <memory>
+#include <vector>
+
+namespace Assets
+{
+	class Scene;
+	class UniformBuffer;
+}
+
+namespace Vulkan
+{
+	class CommandPool;
+	class CullingPipeline;
+	class DepthBuffer;
+	class DescriptorSetManager;
+	class Device;
+	class DeviceMemory;
+	class Image;
+	class ImageView;
+	class PipelineCache;
+	class PipelineLayout;
+
+	// The rasterized primary visibility of the hybrid mode (see Visibility.vert/frag).
+	// Every pixel of the R32G32 image holds the instance + 1 and the primitive seen through the jittered camera ray of
+	// the frame, 0 when nothing is. The first wavefront bounce then rebuilds its hits from it rather than tracing them.
+	class VisibilityPipeline final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(VisibilityPipeline)
+
+		// The depth buffer of the window is shared when given, it must then be of the render extent.
+		VisibilityPipeline(
+			CommandPool& commandPool,
+			const PipelineCache& pipelineCache,
+			const std::vector<Assets::UniformBuffer>& uniformBuffers,
+			const Assets::Scene& scene,
+			VkExtent2D extent,
+			const DepthBuffer* sharedDepthBuffer);
+		~VisibilityPipeline();
+
+		// In the general layout once rendered, read by the compute shaders.
+		const ImageView& VisibilityImageView() const { return *imageView_; }
+
+		// Draws the visible instances with the given pixel jitter (in [0, 1), the one of the wavefront camera rays),
+		// after culling them. The visibility image is ready for the compute shaders once the render pass ends.
+		void Render(VkCommandBuffer commandBuffer, uint32_t index, const Assets::Scene& scene, glm::vec2 pixelJitter);
+
+	private:
+
+		void UpdateTextures(uint32_t index, const Assets::Scene& scene);
+
+		const Device& device_;
+		const VkExtent2D extent_;
+
+		VULKAN_HANDLE(VkPipeline, pipeline_)
+
+		std::unique_ptr<CullingPipeline> cullingPipeline_;
+		std::unique_ptr<DepthBuffer> depthBuffer_; // Only when the window one is not shared.
+		const DepthBuffer* sharedDepthBuffer_;
+		std::unique_ptr<Image> image_;
+		std::unique_ptr<DeviceMemory> imageMemory_;
+		std::unique_ptr<class ImageView> imageView_;
+		VkRenderPass renderPass_{};
+		VkFramebuffer framebuffer_{};
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+		std::vector<DescriptorSets::WrittenImageArray> textureArrays_; // The scene textures last written to each descriptor set.
+	};
+
+}
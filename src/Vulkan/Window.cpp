@@ -1,7 +1,10 @@
 #include "Window.hpp"
 #include "Utilities/Exception.hpp"
 #include "Utilities/StbImage.hpp"
+#include <chrono>
+#include <exception>
 #include <iostream>
+#include <thread>
 
 namespace Vulkan {
 
@@ -12,8 +15,37 @@ namespace
 		std::cerr << "ERROR: GLFW: " << description << " (code: " << error << ")" << std::endl;
 	}
 
+	// The sizes are packed into a single atomic, so that the render thread never reads a torn one.
+	uint64_t PackExtent(const int width, const int height)
+	{
+		return (static_cast<uint64_t>(width) << 32) | static_cast<uint32_t>(height);
+	}
+
+	VkExtent2D UnpackExtent(const uint64_t extent)
+	{
+		return VkExtent2D{ static_cast<uint32_t>(extent >> 32), static_cast<uint32_t>(extent) };
+	}
+
+	// With a render thread, the events are queued for it rather than handled on the main thread.
+	bool QueueForRenderThread(GLFWwindow* window, const Window::InputEvent& event)
+	{
+		auto* const this_ = static_cast<Window*>(glfwGetWindowUserPointer(window));
+		if (!this_->Config().RenderThread)
+		{
+			return false;
+		}
+
+		this_->QueueEvent(event);
+		return true;
+	}
+
 	void GlfwKeyCallback(GLFWwindow* window, const int key, const int scancode, const int action, const int mods)
 	{
+		if (QueueForRenderThread(window, { Window::InputEvent::Key, { key, scancode, action, mods } }))
+		{
+			return;
+		}
+
 		auto* const this_ = static_cast<Window*>(glfwGetWindowUserPointer(window));
 		if (this_->OnKey)
 		{
@@ -23,6 +55,11 @@ namespace
 
 	void GlfwCursorPositionCallback(GLFWwindow* window, const double xpos, const double ypos)
 	{
+		if (QueueForRenderThread(window, { Window::InputEvent::CursorPosition, {}, xpos, ypos }))
+		{
+			return;
+		}
+
 		auto* const this_ = static_cast<Window*>(glfwGetWindowUserPointer(window));
 		if (this_->OnCursorPosition)
 		{
@@ -32,6 +69,11 @@ namespace
 
 	void GlfwMouseButtonCallback(GLFWwindow* window, const int button, const int action, const int mods)
 	{
+		if (QueueForRenderThread(window, { Window::InputEvent::MouseButton, { button, action, mods } }))
+		{
+			return;
+		}
+
 		auto* const this_ = static_cast<Window*>(glfwGetWindowUserPointer(window));
 		if (this_->OnMouseButton)
 		{
@@ -41,12 +83,33 @@ namespace
 
 	void GlfwScrollCallback(GLFWwindow* window, const double xoffset, const double yoffset)
 	{
+		if (QueueForRenderThread(window, { Window::InputEvent::Scroll, {}, xoffset, yoffset }))
+		{
+			return;
+		}
+
 		auto* const this_ = static_cast<Window*>(glfwGetWindowUserPointer(window));
 		if (this_->OnScroll)
 		{
 			this_->OnScroll(xoffset, yoffset);
 		}
 	}
+
+	// Only needed by the user interface with a render thread, ImGui installs its own callbacks otherwise.
+	void GlfwCharCallback(GLFWwindow* window, const unsigned int codepoint)
+	{
+		QueueForRenderThread(window, { Window::InputEvent::Char, { static_cast<int32_t>(codepoint) } });
+	}
+
+	void GlfwCursorEnterCallback(GLFWwindow* window, const int entered)
+	{
+		QueueForRenderThread(window, { Window::InputEvent::CursorEnter, { entered } });
+	}
+
+	void GlfwWindowFocusCallback(GLFWwindow* window, const int focused)
+	{
+		QueueForRenderThread(window, { Window::InputEvent::Focus, { focused } });
+	}
 }
 
 Window::Window(const WindowConfig& config) :
@@ -95,10 +158,50 @@ Window::Window(const WindowConfig& config) :
 	glfwSetCursorPosCallback(window_, GlfwCursorPositionCallback);
 	glfwSetMouseButtonCallback(window_, GlfwMouseButtonCallback);
 	glfwSetScrollCallback(window_, GlfwScrollCallback);
+
+	if (config.RenderThread)
+	{
+		glfwSetCharCallback(window_, GlfwCharCallback);
+		glfwSetCursorEnterCallback(window_, GlfwCursorEnterCallback);
+		glfwSetWindowFocusCallback(window_, GlfwWindowFocusCallback);
+
+		glfwSetFramebufferSizeCallback(window_, [](GLFWwindow* window, const int width, const int height)
+		{
+			static_cast<Window*>(glfwGetWindowUserPointer(window))->framebufferSize_ = PackExtent(width, height);
+		});
+
+		glfwSetWindowSizeCallback(window_, [](GLFWwindow* window, const int width, const int height)
+		{
+			static_cast<Window*>(glfwGetWindowUserPointer(window))->windowSize_ = PackExtent(width, height);
+		});
+
+		int width, height;
+		glfwGetFramebufferSize(window_, &width, &height);
+		framebufferSize_ = PackExtent(width, height);
+		glfwGetWindowSize(window_, &width, &height);
+		windowSize_ = PackExtent(width, height);
+
+		// The GLFW functions below are main thread only, their results are cached for the render thread.
+		float yscale;
+		glfwGetWindowContentScale(window_, &contentScale_, &yscale);
+
+		keyNames_.resize(GLFW_KEY_LAST + 1);
+
+		for (int key = 0; key <= GLFW_KEY_LAST; ++key)
+		{
+			const char* const name = glfwGetKeyName(key, 0);
+			keyNames_[key] = name != nullptr ? name : "";
+		}
+	}
 }
 
 Window::~Window()
 {
+	for (const auto& cursor : cursors_)
+	{
+		glfwDestroyCursor(cursor.second);
+	}
+
 	if (window_ != nullptr)
 	{
 		glfwDestroyWindow(window_);
@@ -111,6 +214,11 @@ Window::~Window()
 
 float Window::ContentScale() const
 {
+	if (config_.RenderThread)
+	{
+		return contentScale_;
+	}
+
 	float xscale;
 	float yscale;
 	glfwGetWindowContentScale(window_, &xscale, &yscale);
@@ -120,6 +228,11 @@ float Window::ContentScale() const
 
 VkExtent2D Window::FramebufferSize() const
 {
+	if (config_.RenderThread)
+	{
+		return UnpackExtent(framebufferSize_);
+	}
+
 	int width, height;
 	glfwGetFramebufferSize(window_, &width, &height);
 	return VkExtent2D{ static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
@@ -127,6 +240,11 @@ VkExtent2D Window::FramebufferSize() const
 
 VkExtent2D Window::WindowSize() const
 {
+	if (config_.RenderThread)
+	{
+		return UnpackExtent(windowSize_);
+	}
+
 	int width, height;
 	glfwGetWindowSize(window_, &width, &height);
 	return VkExtent2D{ static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
@@ -134,7 +252,18 @@ VkExtent2D Window::WindowSize() const
 
 const char* Window::GetKeyName(const int key, const int scancode) const
 {
-	return glfwGetKeyName(key, scancode);
+	if (!config_.RenderThread)
+	{
+		return glfwGetKeyName(key, scancode);
+	}
+
+	// The printable keys only have a name without the scancode, which GLFW ignores for a known key.
+	if (key < 0 || key > GLFW_KEY_LAST || keyNames_[key].empty())
+	{
+		return nullptr;
+	}
+
+	return keyNames_[key].c_str();
 }
 
 std::vector<const char*> Window::GetRequiredInstanceExtensions() const
@@ -152,6 +281,13 @@ double Window::GetTime() const
 void Window::Close()
 {
 	glfwSetWindowShouldClose(window_, 1);
+
+	// Wakes the main thread up, the render thread stops after this frame.
+	if (config_.RenderThread)
+	{
+		isClosing_ = true;
+		glfwPostEmptyEvent();
+	}
 }
 
 bool Window::IsMinimized() const
@@ -164,9 +300,26 @@ void Window::Run()
 {
 	glfwSetTime(0.0);
 
+	if (config_.RenderThread)
+	{
+		RunRenderThread();
+		return;
+	}
+
+	// While idle, the last presented image stays on screen until some input comes in.
+	// The timeout still picks up the asynchronous work completing meanwhile (e.g. streamed textures).
+	constexpr double idleTimeout = 0.25;
+
 	while (!glfwWindowShouldClose(window_))
 	{
-		glfwPollEvents();
+		if (IsIdle && IsIdle())
+		{
+			glfwWaitEventsTimeout(idleTimeout);
+		}
+		else
+		{
+			glfwPollEvents();
+		}
 
 		if (DrawFrame)
 		{
@@ -175,9 +328,181 @@ void Window::Run()
 	}
 }
 
-void Window::WaitForEvents() const
+void Window::PollEvents()
 {
-	glfwWaitEvents();
+	if (!config_.RenderThread)
+	{
+		glfwPollEvents();
+		return;
+	}
+
+	InputEvent event;
+	while (events_.Pop(event))
+	{
+		DispatchEvent(event);
+	}
+}
+
+void Window::WaitForEvents()
+{
+	if (!config_.RenderThread)
+	{
+		glfwWaitEvents();
+		return;
+	}
+
+	WaitForQueuedEvents(-1);
+}
+
+void Window::SetCursor(const int shape)
+{
+	if (!config_.RenderThread)
+	{
+		ApplyCursor(shape);
+		return;
+	}
+
+	if (cursorShape_.exchange(shape) != shape)
+	{
+		glfwPostEmptyEvent();
+	}
+}
+
+void Window::ApplyCursor(const int shape)
+{
+	// A disabled cursor stays so, e.g. for the camera controls.
+	if (shape == appliedCursorShape_ || glfwGetInputMode(window_, GLFW_CURSOR) == GLFW_CURSOR_DISABLED)
+	{
+		return;
+	}
+
+	appliedCursorShape_ = shape;
+
+	if (shape == 0)
+	{
+		glfwSetInputMode(window_, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+		return;
+	}
+
+	auto& cursor = cursors_[shape];
+	if (cursor == nullptr)
+	{
+		cursor = glfwCreateStandardCursor(shape);
+	}
+
+	glfwSetCursor(window_, cursor);
+	glfwSetInputMode(window_, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+}
+
+void Window::QueueEvent(const InputEvent& event)
+{
+	// Dropped once the render thread is that far behind, which would take thousands of events within a single frame.
+	if (!events_.Push(event))
+	{
+		return;
+	}
+
+	// Locking orders the push with the check of a render thread about to sleep, so that it cannot miss the wake up.
+	{
+		std::lock_guard<std::mutex> lock(eventMutex_);
+	}
+
+	eventCondition_.notify_one();
+}
+
+void Window::DispatchEvent(const InputEvent& event) const
+{
+	if (OnInputEvent)
+	{
+		OnInputEvent(event);
+	}
+
+	switch (event.Type)
+	{
+	case InputEvent::Key: if (OnKey) OnKey(event.Values[0], event.Values[1], event.Values[2], event.Values[3]); break;
+	case InputEvent::CursorPosition: if (OnCursorPosition) OnCursorPosition(event.X, event.Y); break;
+	case InputEvent::MouseButton: if (OnMouseButton) OnMouseButton(event.Values[0], event.Values[1], event.Values[2]); break;
+	case InputEvent::Scroll: if (OnScroll) OnScroll(event.X, event.Y); break;
+	default: break;
+	}
+}
+
+void Window::RunRenderThread()
+{
+	// See Run(), the render thread only waits on the queued events rather than on the GLFW ones.
+	constexpr double idleTimeout = 0.25;
+
+	std::exception_ptr renderError;
+
+	std::thread renderThread([this, &renderError]()
+	{
+		try
+		{
+			while (!isClosing_)
+			{
+				if (IsIdle && IsIdle())
+				{
+					WaitForQueuedEvents(idleTimeout);
+				}
+				else
+				{
+					PollEvents();
+				}
+
+				if (DrawFrame && !isClosing_)
+				{
+					DrawFrame();
+				}
+			}
+		}
+		catch (...)
+		{
+			renderError = std::current_exception();
+		}
+
+		// Either way, the main thread has to stop waiting for events.
+		isClosing_ = true;
+		glfwPostEmptyEvent();
+	});
+
+	// However long a frame takes, the window keeps handling its events: moves, resizes and input.
+	while (!glfwWindowShouldClose(window_) && !isClosing_)
+	{
+		glfwWaitEvents();
+		ApplyCursor(cursorShape_);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(eventMutex_);
+		isClosing_ = true;
+	}
+
+	eventCondition_.notify_one();
+	renderThread.join();
+
+	if (renderError)
+	{
+		std::rethrow_exception(renderError);
+	}
+}
+
+void Window::WaitForQueuedEvents(const double timeout)
+{
+	{
+		std::unique_lock<std::mutex> lock(eventMutex_);
+		const auto isReady = [this]() { return !events_.Empty() || isClosing_; };
+
+		if (timeout < 0)
+		{
+			eventCondition_.wait(lock, isReady);
+		}
+		else
+		{
+			eventCondition_.wait_for(lock, std::chrono::duration<double>(timeout), isReady);
+		}
+	}
+
+	PollEvents();
 }
 
 }
@@ -2,7 +2,14 @@
 
 #include "WindowConfig.hpp"
 #include "Vulkan.hpp"
+#include "Utilities/SpscQueue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <string>
 #include <vector>
 
 namespace Vulkan
@@ -14,6 +21,26 @@ namespace Vulkan
 
 		VULKAN_NON_COPIABLE(Window)
 
+		// A GLFW event, as queued by the main thread for the render thread (see WindowConfig::RenderThread).
+		struct InputEvent final
+		{
+			enum EventType : uint32_t
+			{
+				Key, // Values: key, scancode, action, mods.
+				Char, // Values: codepoint.
+				CursorPosition, // X, Y.
+				CursorEnter, // Values: entered.
+				MouseButton, // Values: button, action, mods.
+				Scroll, // X, Y offsets.
+				Focus // Values: focused.
+			};
+
+			EventType Type;
+			int32_t Values[4];
+			double X;
+			double Y;
+		};
+
 		explicit Window(const WindowConfig& config);
 		~Window();
 
@@ -25,27 +52,57 @@ namespace Vulkan
 		VkExtent2D WindowSize() const;
 
 		// GLFW instance properties (i.e. not bound to a window handler).
+		// With a render thread, the key names are the ones of the keyboard layout when the window was created.
 		const char* GetKeyName(int key, int scancode) const;
 		std::vector<const char*> GetRequiredInstanceExtensions() const;
 		double GetTime() const;
 
-		// Callbacks
+		// Callbacks, all called from the thread drawing the frames.
 		std::function<void()> DrawFrame;
+		std::function<bool()> IsIdle; // Nothing to draw until some input comes in.
 		std::function<void(int key, int scancode, int action, int mods)> OnKey;
 		std::function<void(double xpos, double ypos)> OnCursorPosition;
 		std::function<void(int button, int action, int mods)> OnMouseButton;
 		std::function<void(double xoffset, double yoffset)> OnScroll;
+		std::function<void(const InputEvent& event)> OnInputEvent; // With a render thread only, every event ahead of the handlers above.
 
-		// Methods
+		// Methods, with a render thread the event ones dispatch the queued events on it.
 		void Close();
 		bool IsMinimized() const;
+		void PollEvents();
 		void Run();
-		void WaitForEvents() const;
+		void WaitForEvents();
+
+		// A GLFW standard cursor shape, or 0 to hide the cursor. With a render thread, the main thread applies it on its next event.
+		void SetCursor(int shape);
+
+		// From the GLFW callbacks on the main thread, hands the event over to the render thread.
+		void QueueEvent(const InputEvent& event);
 
 	private:
 
+		void ApplyCursor(int shape);
+		void DispatchEvent(const InputEvent& event) const;
+		void RunRenderThread();
+		void WaitForQueuedEvents(double timeout);
+
 		const WindowConfig config_;
 		GLFWwindow* window_{};
+
+		// With a render thread, the main thread handles the GLFW events and caches the sizes the render thread needs.
+		Utilities::SpscQueue<InputEvent, 4096> events_;
+		std::mutex eventMutex_; // Only to sleep until some event comes in, the queue itself is lock-free.
+		std::condition_variable eventCondition_;
+		std::atomic<bool> isClosing_{};
+		std::atomic<uint64_t> framebufferSize_{};
+		std::atomic<uint64_t> windowSize_{};
+		std::atomic<int> cursorShape_{GLFW_ARROW_CURSOR};
+		std::vector<std::string> keyNames_;
+		float contentScale_{};
+
+		// Only touched by the main thread.
+		std::map<int, GLFWcursor*> cursors_;
+		int appliedCursorShape_{GLFW_ARROW_CURSOR};
 	};
 
 }
@@ -13,5 +13,7 @@ namespace Vulkan
 		bool CursorDisabled;
 		bool Fullscreen;
 		bool Resizable;
+		bool Headless; // Render offscreen, without creating any window or swap chain.
+		bool RenderThread; // Draw the frames on a thread of their own, the main thread only handling the window events.
 	};
 }
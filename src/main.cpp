@@ -1,16 +1,29 @@
 
-#include "Vulkan/Enumerate.hpp"
+#include "Assets/TextureCache.hpp"
+#include "Cpu/Tracer.hpp"
+#include "Vulkan/ShaderCache.hpp"
 #include "Vulkan/Strings.hpp"
 #include "Vulkan/SwapChain.hpp"
 #include "Vulkan/Version.hpp"
 #include "Utilities/Console.hpp"
 #include "Utilities/Exception.hpp"
+#include "Utilities/Trace.hpp"
+#include "DeviceSelector.hpp"
+#include "ImageExporter.hpp"
 #include "Options.hpp"
 #include "RayTracer.hpp"
+#include "RenderFarm.hpp"
+#include "RenderQueue.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <exception>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace
 {
@@ -20,7 +33,9 @@ namespace
 	void PrintVulkanLayersInformation(const Vulkan::Application& application, bool benchmark);
 	void PrintVulkanDevices(const Vulkan::Application& application);
 	void PrintVulkanSwapChainInformation(const Vulkan::Application& application, bool benchmark);
-	void SetVulkanDevice(Vulkan::Application& application);
+	void SetVulkanDevice(Vulkan::Application& application, uint32_t physicalDeviceIndex);
+	void RenderOnDevices(const UserSettings& userSettings, const Vulkan::WindowConfig& windowConfig, VkPresentModeKHR presentMode, uint32_t deviceCount, bool probeDevices);
+	void RenderOnCpu(const UserSettings& userSettings, VkExtent2D extent, const std::string& coordinator);
 }
 
 int main(int argc, const char* argv[]) noexcept
@@ -29,6 +44,16 @@ int main(int argc, const char* argv[]) noexcept
 	{
 		const Options options(argc, argv);
 		const UserSettings userSettings = CreateUserSettings(options);
+
+		Vulkan::ShaderCache::SetOverrideDirectory(options.ShaderDirectory);
+		Assets::TextureCache::SetBudget(size_t(options.TextureCache) * 1024 * 1024);
+
+		// Everything from here to the end of the run, the options are parsed in a blink.
+		if (!options.TraceOutput.empty())
+		{
+			Utilities::Trace::Enable();
+		}
+
 		const Vulkan::WindowConfig windowConfig
 		{
 			"Vulkan Window",
@@ -36,22 +61,101 @@ int main(int argc, const char* argv[]) noexcept
 			options.Height,
 			options.Benchmark && options.Fullscreen,
 			options.Fullscreen,
-			!options.Fullscreen
+			!options.Fullscreen,
+			options.Headless,
+			options.RenderThread
 		};
 
+		// The coordinator only merges what the workers trace, it needs no device.
+		if (options.Coordinator != 0)
+		{
+			RenderFarmCoordinator coordinator(static_cast<uint16_t>(options.Coordinator), { options.Width, options.Height }, options.MaxSamples, options.FarmRange);
+			coordinator.Run(options.HeadlessOutput);
+			return EXIT_SUCCESS;
+		}
+
+		if (options.Cpu)
+		{
+			RenderOnCpu(userSettings, { options.Width, options.Height }, options.Worker);
+			return EXIT_SUCCESS;
+		}
+
+		if (options.Devices > 1)
+		{
+			RenderOnDevices(userSettings, windowConfig, static_cast<VkPresentModeKHR>(options.PresentMode), options.Devices, options.DeviceProbe);
+			return EXIT_SUCCESS;
+		}
+
+		// Outlives the application, whose sink sends it the sums.
+		std::unique_ptr<RenderFarmWorker> worker(options.Worker.empty() ? nullptr : new RenderFarmWorker(options.Worker, { options.Width, options.Height }));
+
+		// The jobs leave out what the command line sets, its output extension included.
+		std::unique_ptr<RenderQueue> queue;
+
+		if (!options.Queue.empty())
+		{
+			RenderJob defaults{};
+			defaults.SceneIndex = static_cast<uint32_t>(userSettings.SceneIndex);
+			defaults.SceneFile = userSettings.SceneFile;
+			defaults.Extent = { options.Width, options.Height };
+			defaults.Samples = userSettings.MaxNumberOfSamples;
+			defaults.Output = userSettings.HeadlessOutput;
+
+			queue.reset(new RenderQueue(options.Queue, defaults));
+		}
+
 		RayTracer application(userSettings, windowConfig, static_cast<VkPresentModeKHR>(options.PresentMode));
 
-		PrintVulkanSdkInformation();
-		PrintVulkanInstanceInformation(application, options.Benchmark);
-		PrintVulkanLayersInformation(application, options.Benchmark);
-		PrintVulkanDevices(application);
+		if (worker)
+		{
+			application.SetAccumulationSink([&worker](const VkExtent2D extent, std::vector<float>&& pixels) { worker->SendResult(extent, pixels); });
+			application.SetSampleRangeSource([&worker](uint32_t& firstSample, uint32_t& sampleCount) { return worker->NextRange(firstSample, sampleCount); });
+		}
 
-		SetVulkanDevice(application);
+		if (queue)
+		{
+			application.SetRenderJobSource(
+				[&queue](RenderJob& job) { return queue->Next(job); },
+				[&queue](const RenderJob& job, const uint32_t samples, const bool isDone) { queue->Report(job, samples, isDone); });
+		}
+
+		{
+			const Utilities::TraceScope trace("PrintVulkanInformation");
+			PrintVulkanSdkInformation();
+			PrintVulkanInstanceInformation(application, options.Benchmark);
+			PrintVulkanLayersInformation(application, options.Benchmark);
+			PrintVulkanDevices(application);
+		}
+
+		if (options.OutputWidth != 0)
+		{
+			application.SetOfflineRender({ options.OutputWidth, options.OutputHeight }, options.OutputTile);
+		}
+
+		{
+			const Utilities::TraceScope trace("SetVulkanDevice");
+			const DeviceSelector selector(application.PhysicalDevices(), options.DeviceProbe);
+			selector.Print();
+			SetVulkanDevice(application, selector.Select(options.Device));
+		}
 
 		PrintVulkanSwapChainInformation(application, options.Benchmark);
 
 		application.Run();
 
+		if (!options.TraceOutput.empty())
+		{
+			Utilities::Trace::Write(options.TraceOutput);
+			std::cout << "Trace written to '" << options.TraceOutput << "'" << std::endl;
+		}
+
+		// A regression fails the run, for the scripts comparing the builds.
+		if (const auto regressions = application.BenchmarkRegressions())
+		{
+			std::cout << "Benchmark: " << regressions << " regressions against '" << options.BenchmarkBaseline << "'" << std::endl;
+			return EXIT_FAILURE;
+		}
+
 		return EXIT_SUCCESS;
 	}
 
@@ -96,20 +200,105 @@ namespace
 		userSettings.Benchmark = options.Benchmark;
 		userSettings.BenchmarkNextScenes = options.BenchmarkNextScenes;
 		userSettings.BenchmarkMaxTime = options.BenchmarkMaxTime;
+		userSettings.BenchmarkOutput = options.BenchmarkOutput;
+		userSettings.BenchmarkReference = options.BenchmarkReference;
+		userSettings.BenchmarkDeterministic = options.BenchmarkDeterministic;
+		userSettings.BenchmarkSweep = options.BenchmarkSweep;
+		userSettings.BenchmarkWarmUp = options.BenchmarkWarmUp;
+		userSettings.BenchmarkBaseline = options.BenchmarkBaseline;
+		userSettings.RegressionThreshold = options.RegressionThreshold;
+		userSettings.MeasurePower = options.MeasurePower;
+		userSettings.ExportOutput = options.ExportOutput;
+		userSettings.HeadlessOutput = options.HeadlessOutput;
+		userSettings.CameraPath = options.CameraPath;
+		userSettings.SequencePipe = options.SequencePipe;
+		userSettings.BakeProbes = options.BakeProbes;
+		userSettings.Checkpoint = options.Checkpoint;
+		userSettings.CheckpointInterval = options.CheckpointInterval;
+		userSettings.ProbeGrid = options.ProbeGrid;
+		userSettings.ProbeEncoding = options.ProbeEncoding;
 		
 		userSettings.SceneIndex = options.SceneIndex;
+		userSettings.SceneFile = options.SceneFile;
+		userSettings.TessellatedSpheres = options.TessellateSpheres;
+		userSettings.LevelOfDetail = options.LevelOfDetail;
+		userSettings.GpuNormals = options.GpuNormals;
+		userSettings.Environment = options.Environment;
+		userSettings.EnvironmentIntensity = options.EnvironmentIntensity;
 
 		userSettings.IsRayTraced = true;
 		userSettings.AccumulateRays = true;
 		userSettings.NumberOfSamples = options.Samples;
 		userSettings.NumberOfBounces = options.Bounces;
+		userSettings.RussianRouletteDepth = options.RouletteDepth;
+		userSettings.LightSampling = options.LightSampling;
+		userSettings.LightTree = options.LightTree;
+		userSettings.AdaptiveSamplingThreshold = options.AdaptiveThreshold;
+		userSettings.FoveaRadius = options.Foveation;
+		userSettings.FoveaMinFraction = options.FoveationMin;
+		userSettings.GazeX = options.GazeX;
+		userSettings.GazeY = options.GazeY;
+		userSettings.DenoiseIterations = options.DenoiseIterations;
+		userSettings.AsyncDenoise = options.AsyncDenoise;
+		userSettings.ReprojectedSamples = options.ReprojectedSamples;
+		userSettings.Interleave = options.Interleave;
 		userSettings.MaxNumberOfSamples = options.MaxSamples;
+		userSettings.FrameBudget = options.FrameBudget;
+		userSettings.SampleBudget = options.SampleBudget;
+
+		// Each trace of an offline render stays well under the GPU timeout of the OS (two seconds on Windows), unless told otherwise.
+		if (options.OutputWidth != 0 && options.FrameBudget == 0)
+		{
+			userSettings.FrameBudget = 250;
+		}
+
+		userSettings.RenderScale = options.RenderScale;
+		userSettings.HalfAccumulation = options.HalfAccumulation;
+		userSettings.CompactAccelerationStructures = options.CompactAccelerationStructures;
+		userSettings.MergeProcedurals = options.MergeProcedurals;
+		userSettings.CacheAccelerationStructures = options.CacheAccelerationStructures;
+		userSettings.HostBuildAccelerationStructures = options.HostBuildAccelerationStructures;
+		userSettings.GeometryBudget = options.GeometryBudget;
+		userSettings.AnimateInstances = options.AnimateInstances;
+		userSettings.DeformVertices = options.DeformVertices;
+		userSettings.DeformRebuildInterval = options.DeformRebuildInterval;
+		userSettings.BuildPolicy = options.BuildPolicy;
+		userSettings.Sampler = options.Sampler;
+		userSettings.LaunchOrder = options.LaunchOrder;
+		userSettings.PushConstants = options.PushConstants;
+		userSettings.HostVisibleShaderBindingTable = options.HostVisibleShaderBindingTable;
+		userSettings.InvocationReorder = options.InvocationReorder;
+		userSettings.Wavefront = options.Wavefront;
+		userSettings.Hybrid = options.Hybrid;
+		userSettings.Restir = options.Restir;
+		userSettings.RadianceCache = options.RadianceCache;
+		userSettings.PathGuiding = options.PathGuiding;
+		userSettings.Views = options.Views;
+		userSettings.ViewOrbit = options.ViewOrbit;
+		userSettings.TextureBudget = options.TextureBudget;
+		userSettings.CompactVertices = options.CompactVertices;
+		userSettings.PositionStream = options.PositionStream;
+		userSettings.CompactMaterials = options.CompactMaterials;
+		userSettings.RegeneratePaths = options.RegeneratePaths;
+		userSettings.FramesInFlight = options.FramesInFlight;
+		userSettings.LowLatency = options.LowLatency;
+		userSettings.RenderPasses = options.RenderPasses;
+		userSettings.KeepDrawing = options.KeepDrawing;
+		userSettings.StreamPort = options.StreamPort;
+		userSettings.StreamQuality = options.StreamQuality;
+		userSettings.MetricsPort = options.MetricsPort;
+		userSettings.MetricsFile = options.MetricsFile;
 
 		userSettings.ShowSettings = !options.Benchmark;
 		userSettings.ShowOverlay = true;
+		userSettings.ShowPerformance = false;
 
 		userSettings.ShowHeatmap = false;
 		userSettings.HeatmapScale = 1.5f;
+		userSettings.HeatmapStage = 0;
+		userSettings.HeatmapBounce = 0;
+		userSettings.ProfileStages = options.ProfileStages;
+		userSettings.RayIsolation = options.RayIsolation;
 
 		return userSettings;
 	}
@@ -161,8 +350,12 @@ namespace
 	{
 		std::cout << "Vulkan Devices: " << std::endl;
 
-		for (const auto& device : application.PhysicalDevices())
+		const auto& physicalDevices = application.PhysicalDevices();
+
+		for (uint32_t i = 0; i != physicalDevices.size(); ++i)
 		{
+			const auto device = physicalDevices[i];
+
 			VkPhysicalDeviceDriverProperties driverProp{};
 			driverProp.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DRIVER_PROPERTIES;
 			
@@ -180,7 +373,7 @@ namespace
 			const Vulkan::Version vulkanVersion(prop.apiVersion);
 			const Vulkan::Version driverVersion(prop.driverVersion, prop.vendorID);
 
-			std::cout << "- [" << prop.deviceID << "] ";
+			std::cout << "- " << i << ": [" << prop.deviceID << "] ";
 			std::cout << Vulkan::Strings::VendorId(prop.vendorID) << " '" << prop.deviceName;
 			std::cout << "' (";
 			std::cout << Vulkan::Strings::DeviceType(prop.deviceType) << ": ";
@@ -194,64 +387,207 @@ namespace
 
 	void PrintVulkanSwapChainInformation(const Vulkan::Application& application, const bool benchmark)
 	{
+		if (application.IsHeadless())
+		{
+			std::cout << "Swap Chain: none (headless)" << std::endl;
+			std::cout << "- frames in flight: " << application.MaxFramesInFlight() << std::endl;
+			std::cout << std::endl;
+			return;
+		}
+
 		const auto& swapChain = application.SwapChain();
 
 		std::cout << "Swap Chain: " << std::endl;
 		std::cout << "- image count: " << swapChain.Images().size() << std::endl;
 		std::cout << "- present mode: " << swapChain.PresentMode() << std::endl;
+		std::cout << "- frames in flight: " << application.MaxFramesInFlight() << std::endl;
 		std::cout << std::endl;
 	}
 
-	void SetVulkanDevice(Vulkan::Application& application)
+	void SetVulkanDevice(Vulkan::Application& application, const uint32_t physicalDeviceIndex)
 	{
-		const auto& physicalDevices = application.PhysicalDevices();
-		const auto result = std::find_if(physicalDevices.begin(), physicalDevices.end(), [](const VkPhysicalDevice& device)
+		const auto device = application.PhysicalDevices()[physicalDeviceIndex];
+
+		VkPhysicalDeviceProperties2 deviceProp{};
+		deviceProp.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		vkGetPhysicalDeviceProperties2(device, &deviceProp);
+
+		std::cout << "Setting Device [" << deviceProp.properties.deviceID << "]:" << std::endl;
+
+		application.SetPhysicalDevice(device);
+
+		std::cout << std::endl;
+	}
+
+	// Every device gets its own application, which loads the scene and builds its acceleration structures. They are set up one after the
+	// other so that the on-disk caches are never written concurrently, then trace on their own thread. Device i traces the samples
+	// i, i + n, i + 2n, ... of every pixel, the exported image is the sum of their accumulations.
+	void RenderOnDevices(const UserSettings& userSettings, const Vulkan::WindowConfig& windowConfig, const VkPresentModeKHR presentMode, const uint32_t deviceCount, const bool probeDevices)
+	{
+		const auto sampleShare = [&userSettings, deviceCount](const uint32_t deviceIndex)
 		{
-			// We want a device with geometry shader support.
-			VkPhysicalDeviceFeatures deviceFeatures;
-			vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+			return (userSettings.MaxNumberOfSamples + deviceCount - 1 - deviceIndex) / deviceCount;
+		};
 
-			if (!deviceFeatures.geometryShader)
-			{
-				return false;
-			}
+		std::mutex mutex;
+		VkExtent2D extent{};
+		std::vector<float> merged;
+		std::vector<std::unique_ptr<RayTracer>> applications;
+		std::vector<uint32_t> physicalDeviceIndices;
 
-			// We want a device that supports the ray tracing extension.
-			const auto extensions = Vulkan::GetEnumerateVector(device, static_cast<const char*>(nullptr), vkEnumerateDeviceExtensionProperties);
-			const auto hasRayTracing = std::find_if(extensions.begin(), extensions.end(), [](const VkExtensionProperties& extension)
+		PrintVulkanSdkInformation();
+
+		for (uint32_t i = 0; i != deviceCount; ++i)
+		{
+			UserSettings settings = userSettings;
+			settings.Benchmark = false;
+			settings.MaxNumberOfSamples = sampleShare(i);
+			settings.SampleStreamIndex = i;
+			settings.SampleStreamCount = deviceCount;
+
+			applications.emplace_back(new RayTracer(settings, windowConfig, presentMode));
+			applications.back()->SetAccumulationSink([&mutex, &extent, &merged](const VkExtent2D imageExtent, std::vector<float>&& pixels)
 			{
-				return strcmp(extension.extensionName, VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME) == 0;
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (merged.empty())
+				{
+					extent = imageExtent;
+					merged = std::move(pixels);
+					return;
+				}
+
+				for (size_t j = 0; j != merged.size(); ++j)
+				{
+					merged[j] += pixels[j];
+				}
 			});
 
-			if (hasRayTracing == extensions.end())
+			// Every instance enumerates the devices in the same order, the first one ranks them for all.
+			if (i == 0)
 			{
-				return false;
+				PrintVulkanDevices(*applications.back());
+
+				const DeviceSelector selector(applications.back()->PhysicalDevices(), probeDevices);
+				selector.Print();
+
+				if (selector.Candidates().size() < deviceCount)
+				{
+					Throw(std::runtime_error("cannot find " + std::to_string(deviceCount) + " suitable devices"));
+				}
+
+				for (const auto& candidate : selector.Candidates())
+				{
+					physicalDeviceIndices.push_back(candidate.Index);
+				}
 			}
 
-			// We want a device with a graphics queue.
-			const auto queueFamilies = Vulkan::GetEnumerateVector(device, vkGetPhysicalDeviceQueueFamilyProperties);
-			const auto hasGraphicsQueue = std::find_if(queueFamilies.begin(), queueFamilies.end(), [](const VkQueueFamilyProperties& queueFamily)
+			SetVulkanDevice(*applications.back(), physicalDeviceIndices[i]);
+		}
+
+		std::vector<double> renderTimes(deviceCount);
+		std::vector<std::exception_ptr> errors(deviceCount);
+		std::vector<std::thread> threads;
+
+		for (uint32_t i = 0; i != deviceCount; ++i)
+		{
+			threads.emplace_back([&applications, &renderTimes, &errors, i]()
 			{
-				return queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+				try
+				{
+					const auto start = std::chrono::steady_clock::now();
+					applications[i]->Run();
+					renderTimes[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				}
+				catch (...)
+				{
+					errors[i] = std::current_exception();
+				}
 			});
+		}
 
-			return hasGraphicsQueue != queueFamilies.end();
-		});
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
 
-		if (result == physicalDevices.end())
+		for (const auto& error : errors)
 		{
-			Throw(std::runtime_error("cannot find a suitable device"));
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
 		}
 
-		VkPhysicalDeviceProperties2 deviceProp{};
-		deviceProp.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
-		vkGetPhysicalDeviceProperties2(*result, &deviceProp);
+		// The last readbacks complete while shutting down.
+		applications.clear();
 
-		std::cout << "Setting Device [" << deviceProp.properties.deviceID << "]:" << std::endl;
+		{
+			ImageExporter exporter;
+			exporter.Export(userSettings.HeadlessOutput, extent, userSettings.MaxNumberOfSamples, std::make_shared<const std::vector<float>>(std::move(merged)));
+		}
+
+		// The sample rate of every device while they all trace, each added one is compared to as many copies of the first.
+		const double pixelCount = double(windowConfig.Width) * windowConfig.Height;
+		double firstRate = 0;
+		double totalRate = 0;
+
+		std::cout << "Multi-device rendering: " << deviceCount << " devices, ";
+		std::cout << std::fixed << std::setprecision(2) << *std::max_element(renderTimes.begin(), renderTimes.end()) << "s to the final image" << std::endl;
+
+		for (uint32_t i = 0; i != deviceCount; ++i)
+		{
+			const double rate = renderTimes[i] > 0 ? pixelCount * sampleShare(i) / renderTimes[i] / 1000000 : 0;
+			firstRate = i == 0 ? rate : firstRate;
+			totalRate += rate;
 
-		application.SetPhysicalDevice(*result);
+			std::cout << "- device " << i << ": " << sampleShare(i) << " samples in " << renderTimes[i] << "s, ";
+			std::cout << rate << " Msamples/s, scaling efficiency " << (firstRate > 0 ? 100 * totalRate / (firstRate * (i + 1)) : 0) << "%" << std::endl;
+		}
 
 		std::cout << std::endl;
 	}
 
+	void RenderOnCpu(const UserSettings& userSettings, const VkExtent2D extent, const std::string& coordinator)
+	{
+		const Cpu::Tracer tracer(userSettings, extent);
+		std::vector<float> sums;
+
+		// A render farm worker traces the ranges it is assigned, each range sent as the sums of its own samples.
+		if (!coordinator.empty())
+		{
+			RenderFarmWorker worker(coordinator, extent);
+			uint32_t firstSample = 0;
+			uint32_t sampleCount = 0;
+
+			while (worker.NextRange(firstSample, sampleCount))
+			{
+				sums.assign(size_t(extent.width) * extent.height * 4, 0.0f);
+				tracer.Render(firstSample, sampleCount, sums);
+				worker.SendResult(extent, sums);
+			}
+
+			return;
+		}
+
+		// Otherwise the passes of --samples until --max-samples, then the image.
+		const auto start = std::chrono::steady_clock::now();
+		const uint32_t passSize = std::max(userSettings.NumberOfSamples, 1u);
+
+		for (uint32_t sample = 0; sample < userSettings.MaxNumberOfSamples; sample += passSize)
+		{
+			tracer.Render(sample, std::min(passSize, userSettings.MaxNumberOfSamples - sample), sums);
+			std::cout << "\rCPU samples: " << std::min(sample + passSize, userSettings.MaxNumberOfSamples) << "/" << userSettings.MaxNumberOfSamples << std::flush;
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		const double rate = seconds > 0 ? double(extent.width) * extent.height * userSettings.MaxNumberOfSamples / seconds / 1000000 : 0;
+
+		std::cout << std::endl << "CPU rendering: " << std::thread::hardware_concurrency() << " threads, ";
+		std::cout << std::fixed << std::setprecision(2) << seconds << "s, " << rate << " Msamples/s" << std::endl;
+
+		ImageExporter exporter;
+		exporter.Export(userSettings.HeadlessOutput, extent, userSettings.MaxNumberOfSamples, std::make_shared<const std::vector<float>>(std::move(sums)));
+	}
+
 }
@@ -10,6 +10,8 @@ git checkout 18e6e8855d2da137fada2387b6d137583c02b77c
 ./bootstrap-vcpkg.sh
 
 ./vcpkg install \
+	benchmark:x64-linux \
+	boost-asio:x64-linux \
 	boost-exception:x64-linux \
 	boost-program-options:x64-linux \
 	boost-stacktrace:x64-linux \
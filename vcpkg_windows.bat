@@ -7,6 +7,8 @@ git checkout 18e6e8855d2da137fada2387b6d137583c02b77c || goto :error
 call bootstrap-vcpkg.bat || goto :error
 
 vcpkg.exe install ^
+	benchmark:x64-windows-static ^
+	boost-asio:x64-windows-static ^
 	boost-exception:x64-windows-static ^
 	boost-program-options:x64-windows-static ^
 	boost-stacktrace:x64-windows-static ^